@@ -0,0 +1,337 @@
+#include "BatchCall.h"
+#include "Exports.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "PackedData.h"
+#include "SoSharedLibDefs.h"
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+// callBatch runs many exports in a single call from ExtendScript, so a script that loops over hundreds of
+// clips pays for one ExtendScript -> native transition instead of hundreds.
+//
+// Command buffer format (ThioUtilsLib.jsx's callBatch builds this for you):
+//      - One operation per line ('\n')
+//      - Fields within a line are separated by tabs. The first field is the function name without its
+//        signature (e.g. "addTicks"), the rest are arguments
+//      - Each argument starts with a type character:
+//          s<text>    String. Backslash, tab and newline must be escaped as \\, \t and \n
+//          n<number>  Number
+//          b1 / b0    Boolean
+//          u          Undefined
+//
+// Arguments are converted according to the target function's signature, the same way ExtendScript does when
+// calling the function directly, so the functions themselves don't know they were called from a batch. A number
+// passed where the signature wants an integer ('d' or 'u') must be finite and fit in the type, otherwise that
+// operation fails with kESErrRange.
+// ------------------------------------------------------------------------------------------------
+
+struct BatchOp {
+    const char* name = nullptr;
+    size_t nameLength = 0;
+    std::vector<BatchArg> args;
+};
+
+bool unescapeBatchString(const char* begin, const char* end, std::string& out) {
+    out.clear();
+    out.reserve(end - begin);
+    for (const char* p = begin; p < end; ++p) {
+        if (*p != '\\') {
+            out += *p;
+            continue;
+        }
+        if (++p >= end) {
+            return false;
+        }
+        switch (*p) {
+        case '\\': out += '\\'; break;
+        case 't':  out += '\t'; break;
+        case 'n':  out += '\n'; break;
+        default:   return false;
+        }
+    }
+    return true;
+}
+
+bool parseBatchArg(const char* begin, const char* end, BatchArg& arg) {
+    if (begin >= end) {
+        return false;
+    }
+    arg.type = *begin++;
+    switch (arg.type) {
+    case 's':
+        return unescapeBatchString(begin, end, arg.text);
+    case 'n': {
+        auto result = std::from_chars(begin, end, arg.number);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+    case 'b':
+        if (end - begin != 1 || (*begin != '0' && *begin != '1')) {
+            return false;
+        }
+        arg.number = (*begin == '1') ? 1 : 0;
+        return true;
+    case 'u':
+        return begin == end;
+    default:
+        return false;
+    }
+}
+
+static bool parseBatchCommands(const char* buffer, std::vector<BatchOp>& ops) {
+    const char* p = buffer;
+    while (*p != '\0') {
+        const char* lineEnd = strchr(p, '\n');
+        if (lineEnd == nullptr) {
+            lineEnd = p + strlen(p);
+        }
+
+        if (lineEnd > p) { // Skip blank lines
+            BatchOp op;
+            const char* field = p;
+            bool isName = true;
+            while (field <= lineEnd) {
+                const char* fieldEnd = static_cast<const char*>(memchr(field, '\t', lineEnd - field));
+                if (fieldEnd == nullptr) {
+                    fieldEnd = lineEnd;
+                }
+                if (isName) {
+                    op.name = field;
+                    op.nameLength = fieldEnd - field;
+                    isName = false;
+                }
+                else {
+                    op.args.emplace_back();
+                    if (!parseBatchArg(field, fieldEnd, op.args.back())) {
+                        return false;
+                    }
+                }
+                field = fieldEnd + 1;
+            }
+            ops.push_back(std::move(op));
+        }
+
+        p = (*lineEnd == '\0') ? lineEnd : lineEnd + 1;
+    }
+    return true;
+}
+
+// Converts a parsed argument into TaggedData following one character of the function's signature.
+// Returns kESErrOK, kESErrTypeMismatch if the value can't be converted, or kESErrRange if a number given for an
+// integer type is NaN, infinite or doesn't fit in it.
+static long convertBatchArg(BatchArg& arg, char signatureChar, TaggedData& data) {
+    data.filler = 0;
+
+    // Get a numeric view of the argument for the numeric signature types
+    double numeric = arg.number;
+    if (arg.type == 's' && (signatureChar == 'd' || signatureChar == 'u' || signatureChar == 'f')) {
+        const char* begin = arg.text.c_str();
+        auto result = std::from_chars(begin, begin + arg.text.size(), numeric);
+        if (result.ec != std::errc() || result.ptr != begin + arg.text.size()) {
+            return kESErrTypeMismatch;
+        }
+    }
+
+    switch (signatureChar) {
+    case 's':
+        if (arg.type == 'n') {
+            arg.text.clear();
+            appendJsNumber(arg.text, arg.number);
+        }
+        else if (arg.type == 'b') {
+            arg.text = arg.number != 0 ? "true" : "false";
+        }
+        else if (arg.type == 'u') {
+            arg.text = "undefined";
+        }
+        data.type = kTypeString;
+        data.data.string = &arg.text[0];
+        return kESErrOK;
+    case 'd':
+        // Checked as doubles, since casting a value that doesn't fit is undefined. NaN fails both comparisons.
+        if (!(numeric >= (double)LONG_MIN && numeric < -(double)LONG_MIN)) {
+            return kESErrRange;
+        }
+        data.type = kTypeInteger;
+        data.data.intval = (long)numeric;
+        return kESErrOK;
+    case 'u':
+        // Anything above -1 truncates to 0 or more
+        if (!(numeric > -1.0 && numeric < (double)ULONG_MAX + 1.0)) {
+            return kESErrRange;
+        }
+        data.type = kTypeUInteger;
+        data.data.intval = (long)(unsigned long)numeric;
+        return kESErrOK;
+    case 'f':
+        data.type = kTypeDouble;
+        data.data.fltval = numeric;
+        return kESErrOK;
+    case 'b':
+        data.type = kTypeBool;
+        data.data.intval = (arg.type == 's') ? !arg.text.empty() : (numeric != 0);
+        return kESErrOK;
+    default:
+        // 'a' (any), or past the end of the signature: pass along as-is
+        if (arg.type == 's') {
+            data.type = kTypeString;
+            data.data.string = &arg.text[0];
+        }
+        else if (arg.type == 'n') {
+            data.type = kTypeDouble;
+            data.data.fltval = arg.number;
+        }
+        else if (arg.type == 'b') {
+            data.type = kTypeBool;
+            data.data.intval = arg.number != 0;
+        }
+        else {
+            data.type = kTypeUndefined;
+        }
+        return kESErrOK;
+    }
+}
+
+void appendBatchResult(std::string& out, TaggedData& result) {
+    switch (result.type) {
+    case kTypeBool:
+        out += result.data.intval ? "true" : "false";
+        break;
+    case kTypeDouble:
+        appendJsNumber(out, result.data.fltval);
+        break;
+    case kTypeInteger:
+        appendJsNumber(out, (double)result.data.intval);
+        break;
+    case kTypeUInteger:
+        appendJsNumber(out, (double)(unsigned long)result.data.intval);
+        break;
+    case kTypeString:
+        if (result.data.string != nullptr) {
+            appendJsString(out, result.data.string, strlen(result.data.string));
+            ESFreeMem(result.data.string);
+        }
+        else {
+            out += "null";
+        }
+        break;
+    case kTypeScript:
+        // Our scripts are all single expressions, so they can be embedded directly
+        if (result.data.string != nullptr) {
+            out += "(";
+            out += result.data.string;
+            out += ")";
+            ESFreeMem(result.data.string);
+        }
+        else {
+            out += "undefined";
+        }
+        break;
+    default:
+        // Undefined, or LiveObjects which can't be returned through a script
+        out += "undefined";
+        break;
+    }
+}
+
+// Runs one parsed operation. 'result' receives the function's return value, which the caller must release.
+static long runBatchOp(BatchOp& op, std::vector<TaggedData>& callArgs, TaggedData& result) {
+    long err = kESErrOK;
+    const ExportEntry* entry = findExport(op.name, op.nameLength);
+    if (entry == nullptr) {
+        err = kESErrCannotResolve;
+    }
+    else if (entry->function == callBatch || entry->function == callChunked) {
+        err = kESErrBadAction; // No nesting
+    }
+
+    // Convert the arguments following the function's signature
+    callArgs.resize(op.args.size());
+    const char* signature = (entry != nullptr) ? entry->signature : "";
+    const size_t signatureLength = strlen(signature);
+    for (size_t a = 0; a < op.args.size() && err == kESErrOK; a++) {
+        const char signatureChar = (a < signatureLength) ? signature[a] : 'a';
+        err = convertBatchArg(op.args[a], signatureChar, callArgs[a]);
+    }
+
+    result.type = kTypeUndefined; // ExtendScript presets the return value to undefined, so do the same
+    result.filler = 0;
+    result.data.intval = 0;
+    if (err == kESErrOK) {
+        err = entry->function(callArgs.data(), (long)callArgs.size(), &result);
+    }
+    return err;
+}
+
+long runCommand(const char* command, TaggedData& result) {
+    result.type = kTypeUndefined;
+    result.data.intval = 0;
+
+    std::vector<BatchOp> ops;
+    if (command == nullptr || !parseBatchCommands(command, ops) || ops.size() != 1) {
+        return kESErrBadArgumentList;
+    }
+    std::vector<TaggedData> callArgs;
+    return runBatchOp(ops[0], callArgs, result);
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Runs many registered exports in a single call.
+ * @param argv JavaScript arguments. Expects one string, the command buffer (see the format at the top of this file).
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. A script that evaluates to {results: [...], errors: [...]}, with one entry per
+ *               operation in each. errors[i] is 0 if operation i succeeded, otherwise its error code, in which
+ *               case results[i] is undefined.
+ * @return kESErrOK if the buffer was valid (even if individual operations failed), or an error code.
+ *
+ * JavaScript Usage: var batch = externalLibrary.callBatch("addTicks\ts100\ts200\nticksToSecondsBatch\ts254016000000");
+ */
+THIO_EXPORT(callBatch)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr) return kESErrBadArgumentList;
+
+    std::vector<BatchOp> ops;
+    if (!parseBatchCommands(argv[0].data.string, ops)) return kESErrBadArgumentList;
+
+    std::string results = "({results:[";
+    std::string errors = "errors:[";
+    std::vector<TaggedData> callArgs;
+
+    for (size_t i = 0; i < ops.size(); i++) {
+        BatchOp& op = ops[i];
+        if (i > 0) {
+            results += ",";
+            errors += ",";
+        }
+
+        TaggedData result;
+        const long err = runBatchOp(op, callArgs, result);
+
+        if (err == kESErrOK) {
+            appendBatchResult(results, result);
+        }
+        else {
+            // Still release anything the function may have returned before failing
+            if ((result.type == kTypeString || result.type == kTypeScript) && result.data.string != nullptr) {
+                ESFreeMem(result.data.string);
+            }
+            results += "undefined";
+        }
+        appendJsNumber(errors, (double)err);
+    }
+
+    results += "],";
+    errors += "]})";
+    return setScriptResult(retval, results + errors);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// BatchCall.h
+// Running exports by name from a command string, shared by callBatch and other exports that wrap a call.
+// The command format is described at the top of BatchCall.cpp.
+
+#include "SoSharedLibDefs.h"
+#include <string>
+
+// One parsed argument. Strings are kept in 'text' so TaggedData can point into them during the call.
+struct BatchArg {
+    char type = 'u';
+    std::string text;
+    double number = 0;
+};
+
+// Decodes the \\, \t and \n escapes in a string field. Returns false on any other escape.
+bool unescapeBatchString(const char* begin, const char* end, std::string& out);
+
+/**
+ * @brief Parses one type-tagged field (s<text>, n<number>, b1 / b0, u). Also used by other exports that take typed fields.
+ * @return false if the field is malformed.
+ */
+bool parseBatchArg(const char* begin, const char* end, BatchArg& arg);
+
+/**
+ * @brief Parses a single command line (function name plus type-tagged arguments) and calls the function.
+ * Wrapper exports (callBatch, callChunked) can't be called this way.
+ * @param result Receives the return value. The caller must release string and script results with ESFreeMem.
+ * @return The function's error code, or kESErrBadArgumentList / kESErrCannotResolve / kESErrBadAction / kESErrTypeMismatch /
+ *         kESErrRange if it couldn't be called.
+ */
+long runCommand(const char* command, TaggedData& result);
+
+/**
+ * @brief Appends a return value to a script as an expression, then releases any memory it held.
+ */
+void appendBatchResult(std::string& out, TaggedData& result);
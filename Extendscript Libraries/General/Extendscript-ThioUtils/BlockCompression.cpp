@@ -0,0 +1,144 @@
+#include "BlockCompression.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Matches are at least this long, and the last few bytes of a block are always literals, as in LZ4
+#define MIN_MATCH 4
+#define LAST_LITERALS 5
+#define MATCH_SEARCH_LIMIT 12
+#define MAX_OFFSET 65535
+#define HASH_BITS 14
+
+static inline uint32_t read32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hashPosition(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 or more continue in extra bytes of 255 until one is smaller
+static void appendLengthExtension(std::string& out, size_t length) {
+    while (length >= 255) {
+        out += (char)255;
+        length -= 255;
+    }
+    out += (char)length;
+}
+
+static void appendSequence(std::string& out, const char* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    const size_t matchCode = (matchLength > 0) ? matchLength - MIN_MATCH : 0;
+    const unsigned char token = (unsigned char)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    out += (char)token;
+    if (literalLength >= 15) appendLengthExtension(out, literalLength - 15);
+    out.append(literals, literalLength);
+
+    if (matchLength == 0) {
+        return; // The last sequence is literals only
+    }
+    out += (char)(offset & 0xFF);
+    out += (char)(offset >> 8);
+    if (matchCode >= 15) appendLengthExtension(out, matchCode - 15);
+}
+
+size_t compressBlock(const char* data, size_t length, std::string& out) {
+    out.clear();
+    out.reserve(length + length / 255 + 16);
+
+    size_t anchor = 0; // Start of the literals not written yet
+    if (length > MATCH_SEARCH_LIMIT) {
+        std::vector<int64_t> lastSeen((size_t)1 << HASH_BITS, -1);
+        const size_t searchEnd = length - MATCH_SEARCH_LIMIT;
+        const size_t matchEnd = length - LAST_LITERALS;
+
+        size_t position = 0;
+        while (position < searchEnd) {
+            const uint32_t sequence = read32(data + position);
+            const uint32_t hash = hashPosition(sequence);
+            const int64_t candidate = lastSeen[hash];
+            lastSeen[hash] = (int64_t)position;
+
+            if (candidate < 0 || position - (size_t)candidate > MAX_OFFSET || read32(data + candidate) != sequence) {
+                // Step further the longer nothing has matched, so incompressible data goes quickly
+                position += 1 + ((position - anchor) >> 6);
+                continue;
+            }
+
+            size_t start = position;
+            size_t source = (size_t)candidate;
+            size_t matchLength = MIN_MATCH;
+            while (start + matchLength < matchEnd && data[source + matchLength] == data[start + matchLength]) {
+                matchLength++;
+            }
+            // The match may also extend back into the literals
+            while (start > anchor && source > 0 && data[start - 1] == data[source - 1]) {
+                start--;
+                source--;
+                matchLength++;
+            }
+
+            appendSequence(out, data + anchor, start - anchor, start - source, matchLength);
+            position = start + matchLength;
+            anchor = position;
+        }
+    }
+
+    appendSequence(out, data + anchor, length - anchor, 0, 0);
+    return out.size();
+}
+
+// Reads a length extension. Returns false if it runs past the end of the block.
+static bool readLengthExtension(const unsigned char*& in, const unsigned char* end, size_t& length) {
+    unsigned char byte;
+    do {
+        if (in >= end) return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool decompressBlock(const char* block, size_t blockLength, char* dest, size_t destLength) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(block);
+    const unsigned char* const inEnd = in + blockLength;
+    char* out = dest;
+    char* const outEnd = dest + destLength;
+
+    while (in < inEnd) {
+        const unsigned char token = *in++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLengthExtension(in, inEnd, literalLength)) return false;
+        if (literalLength > (size_t)(inEnd - in) || literalLength > (size_t)(outEnd - out)) return false;
+        memcpy(out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+
+        if (in == inEnd) {
+            break; // The last sequence has no match
+        }
+
+        if (inEnd - in < 2) return false;
+        const size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - dest)) return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLengthExtension(in, inEnd, matchLength)) return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > (size_t)(outEnd - out)) return false;
+
+        // The source can overlap what's being written (a run), so copy forwards one byte at a time when it does
+        const char* source = out - offset;
+        if (offset >= matchLength) {
+            memcpy(out, source, matchLength);
+        } else {
+            for (size_t i = 0; i < matchLength; i++) out[i] = source[i];
+        }
+        out += matchLength;
+    }
+    return out == outEnd;
+}
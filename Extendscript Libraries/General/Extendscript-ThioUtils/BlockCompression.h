@@ -0,0 +1,27 @@
+#pragma once
+
+// BlockCompression.h
+// A small LZ77 compressor for cached results, in the LZ4 block format.
+//
+// Cached results are mostly JSON and packed numbers with a lot of repeated keys and digits, which this shrinks to a
+// fraction of their size at memory speed. Each block stands alone: its original length is stored by the caller, and
+// decompression writes straight into a buffer of exactly that length, so a cached value can be expanded directly into
+// the memory returned to ExtendScript.
+//
+// The format is LZ4's: a token byte with the literal and match lengths, the literals, then a two byte offset back into
+// the output. There's no frame or checksum, callers keep their own.
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Compresses 'length' bytes into 'out', replacing its contents.
+ * @return The compressed size. Can be slightly larger than the input when it doesn't compress.
+ */
+size_t compressBlock(const char* data, size_t length, std::string& out);
+
+/**
+ * @brief Decompresses a block from compressBlock into 'dest', which must be exactly the original length.
+ * @return false if the block is corrupt or doesn't expand to exactly 'destLength' bytes. Never reads or writes out of bounds.
+ */
+bool decompressBlock(const char* block, size_t blockLength, char* dest, size_t destLength);
@@ -0,0 +1,52 @@
+#include "Checksum.h"
+#include <cstring>
+
+namespace {
+    // table[0] is the usual byte-at-a-time table. table[k][b] is the CRC of byte b followed by k zero bytes,
+    // so eight bytes can be combined with one lookup each.
+    struct Crc32Tables {
+        uint32_t table[8][256];
+
+        Crc32Tables() {
+            for (uint32_t b = 0; b < 256; b++) {
+                uint32_t crc = b;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+                }
+                table[0][b] = crc;
+            }
+            for (uint32_t b = 0; b < 256; b++) {
+                for (int k = 1; k < 8; k++) {
+                    table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+                }
+            }
+        }
+    };
+
+    const Crc32Tables& crc32Tables() {
+        static const Crc32Tables tables; // Built on first use. Function statics are thread-safe to initialize.
+        return tables;
+    }
+}
+
+uint32_t crc32Update(uint32_t crc, const void* data, size_t length) {
+    const uint32_t (*table)[256] = crc32Tables().table;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+
+    // Little-endian only, like the rest of the library
+    while (length >= 8) {
+        uint32_t low, high;
+        memcpy(&low, p, 4);
+        memcpy(&high, p + 4, 4);
+        low ^= crc;
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xFF];
+    }
+    return ~crc;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// Checksum.h
+// CRC-32 (the one used by zip, gzip and PNG), for identifying media files and checking compressed data.
+//
+// Computed 8 bytes at a time with the slicing-by-8 tables, so hashing a file is limited by the disk, not the CRC.
+// The result matches zlib's crc32() and the usual command line tools, so scripts can compare with hashes made elsewhere.
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Continues a CRC-32 over more data. Start with crc = 0, and pass the previous result for each following piece.
+ */
+uint32_t crc32Update(uint32_t crc, const void* data, size_t length);
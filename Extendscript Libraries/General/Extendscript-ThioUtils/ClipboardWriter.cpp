@@ -0,0 +1,351 @@
+#include "ClipboardWriter.h"
+#include "Exports.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "TextEncoding.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>    // For SIZE_MAX
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>  // For std::bad_alloc
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// ------------------------------------------------------------------------------------------------
+// Backends
+// ------------------------------------------------------------------------------------------------
+
+long MemoryClipboardBackend::setText(const char* utf8, size_t length) {
+    if (busyCount > 0) {
+        busyCount--;
+        return THIO_ERR_CLIPBOARD_BUSY;
+    }
+    text.assign(utf8, length);
+    writeCount++;
+    return kESErrOK;
+}
+
+#ifdef _WIN32
+class WindowsClipboardBackend : public ClipboardBackend {
+public:
+    long setText(const char* utf8, size_t length) override {
+        // Convert the UTF-8 string from ExtendScript to UTF-16 (WCHAR) for the Windows API, straight into the memory
+        // that will be handed to the clipboard. The UTF-16 text has at most one unit per UTF-8 byte, plus the null
+        // terminator that CF_UNICODETEXT needs. This is done before opening the clipboard so it's held for less time.
+        if (length > (SIZE_MAX / sizeof(wchar_t)) - 1) return kESErrConversion;
+        HGLOBAL hGlobal = GlobalAlloc(GMEM_MOVEABLE, (length + 1) * sizeof(wchar_t));
+        if (hGlobal == NULL) {
+            return THIO_ERR_NO_MEMORY;
+        }
+
+        // Lock the memory and convert the string into it
+        wchar_t* pGlobal = static_cast<wchar_t*>(GlobalLock(hGlobal));
+        if (pGlobal == NULL) {
+            GlobalFree(hGlobal);
+            return THIO_ERR_CLIPBOARD_LOCK_FAILED;
+        }
+        const Utf16Conversion converted = utf8ToUtf16(utf8, length, reinterpret_cast<char16_t*>(pGlobal));
+        pGlobal[converted.length] = L'\0';
+        GlobalUnlock(hGlobal);
+
+        // Open the clipboard
+        if (!OpenClipboard(NULL)) {
+            GlobalFree(hGlobal);
+            return THIO_ERR_CLIPBOARD_BUSY;
+        }
+
+        // Empty the clipboard
+        EmptyClipboard();
+
+        // Set the clipboard data
+        if (SetClipboardData(CF_UNICODETEXT, hGlobal) == NULL) {
+            GlobalFree(hGlobal); // Free if SetClipboardData fails and system does not take ownership
+            CloseClipboard();
+            return THIO_ERR_CLIPBOARD_SET_FAILED;
+        }
+
+        // Note: Do not call GlobalFree(hGlobal) after a successful SetClipboardData, as the system now owns that memory.
+        // It will be freed when EmptyClipboard is called again or the clipboard is closed by another app.
+        CloseClipboard();
+        return kESErrOK;
+    }
+};
+#elif defined(__APPLE__)
+class UnsupportedClipboardBackend : public ClipboardBackend {
+public:
+    long setText(const char* utf8, size_t length) override {
+        return THIO_ERR_NOT_IMPLEMENTED;
+    }
+};
+#endif
+
+static ClipboardBackend& platformBackend() {
+#ifdef _WIN32
+    static WindowsClipboardBackend backend;
+#elif defined(__APPLE__)
+    static UnsupportedClipboardBackend backend;
+#else
+    // Stub backend for other platforms (the Linux profiling build)
+    static MemoryClipboardBackend backend;
+#endif
+    return backend;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Write queue
+// ------------------------------------------------------------------------------------------------
+
+// How many finished tickets to remember the result of
+#define CLIPBOARD_RESULT_HISTORY 256
+
+namespace {
+    struct ClipboardQueue {
+        std::mutex mutex;               // Guards everything below except the backend calls themselves
+        std::mutex writeMutex;          // Held around each backend call, so writes happen one at a time and in order
+        std::condition_variable wake;
+        std::thread worker;
+        bool stopping = false;
+
+        ClipboardBackend* backend = nullptr;
+        unsigned long lastTicket = 0;   // Most recently issued ticket, including ones for immediate writes
+        unsigned long pendingTicket = 0;// Queued text waiting for the worker, 0 if none
+        std::string pendingText;
+        unsigned long activeTicket = 0; // Ticket the worker is currently writing, 0 if none
+        std::map<unsigned long, long> results;
+
+        ~ClipboardQueue() {
+            // If ESTerminate never ran, joining here could deadlock while the library unloads, so just let it go
+            if (worker.joinable()) {
+                worker.detach();
+            }
+        }
+
+        ClipboardBackend& currentBackend() {
+            return backend != nullptr ? *backend : platformBackend();
+        }
+
+        // Requires 'mutex' to be held
+        void finish(unsigned long ticket, long result) {
+            results[ticket] = result;
+            while (results.size() > CLIPBOARD_RESULT_HISTORY) {
+                results.erase(results.begin());
+            }
+        }
+
+        // Requires 'mutex' to be held. Marks waiting text as replaced by a newer ticket.
+        void supersedePending() {
+            if (pendingTicket != 0) {
+                finish(pendingTicket, CLIPBOARD_STATUS_SUPERSEDED);
+                pendingTicket = 0;
+                pendingText.clear();
+            }
+        }
+
+        void run();
+        long writeWithRetry(unsigned long ticket, const std::string& text);
+    };
+
+    ClipboardQueue clipboardQueue;
+}
+
+long ClipboardQueue::writeWithRetry(unsigned long ticket, const std::string& text) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CLIPBOARD_RETRY_TIMEOUT_MS);
+    int delayMs = CLIPBOARD_RETRY_FIRST_MS;
+
+    while (true) {
+        long result;
+        {
+            std::lock_guard<std::mutex> writeLock(writeMutex);
+            {
+                // Checked while holding writeMutex, so a newer write can't be overwritten by this older text
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) return CLIPBOARD_STATUS_SUPERSEDED;
+                if (lastTicket != ticket) return CLIPBOARD_STATUS_SUPERSEDED;
+            }
+            result = currentBackend().setText(text.data(), text.size());
+        }
+
+        if (result != THIO_ERR_CLIPBOARD_BUSY || std::chrono::steady_clock::now() >= deadline) {
+            return result;
+        }
+
+        // Back off, but wake early if newer text arrives or we're shutting down
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait_for(lock, std::chrono::milliseconds(delayMs), [&] { return stopping || lastTicket != ticket; });
+        delayMs = std::min(delayMs * 2, CLIPBOARD_RETRY_MAX_MS);
+    }
+}
+
+void ClipboardQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || pendingTicket != 0; });
+        if (stopping) return;
+
+        const unsigned long ticket = pendingTicket;
+        std::string text;
+        text.swap(pendingText);
+        pendingTicket = 0;
+        activeTicket = ticket;
+
+        lock.unlock();
+        const long result = writeWithRetry(ticket, text);
+        lock.lock();
+
+        activeTicket = 0;
+        finish(ticket, result);
+    }
+}
+
+void setClipboardBackend(ClipboardBackend* backend) {
+    std::lock_guard<std::mutex> writeLock(clipboardQueue.writeMutex);
+    std::lock_guard<std::mutex> lock(clipboardQueue.mutex);
+    clipboardQueue.backend = backend;
+}
+
+long writeClipboardText(const char* utf8, size_t length) {
+    ClipboardQueue& queue = clipboardQueue;
+    unsigned long ticket;
+    {
+        // Takes a ticket so a queued write that hasn't happened yet can't land on top of this one afterwards
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.supersedePending();
+        ticket = ++queue.lastTicket;
+    }
+    queue.wake.notify_all();
+
+    std::lock_guard<std::mutex> writeLock(queue.writeMutex);
+    const long result = queue.currentBackend().setText(utf8, length);
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.finish(ticket, result);
+    return result;
+}
+
+unsigned long queueClipboardText(const char* utf8, size_t length) {
+    ClipboardQueue& queue = clipboardQueue;
+    unsigned long ticket;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.stopping) {
+            return 0;
+        }
+
+        try {
+            if (!queue.worker.joinable()) {
+                queue.worker = std::thread([&queue] { queue.run(); });
+            }
+            std::string text(utf8, length);
+            queue.supersedePending();
+            queue.pendingText.swap(text);
+        }
+        catch (...) {
+            return 0; // Out of memory, or the thread couldn't be started
+        }
+
+        ticket = ++queue.lastTicket;
+        if (ticket == 0) {
+            ticket = ++queue.lastTicket; // 0 means failure, skip it if the counter ever wraps
+        }
+        queue.pendingTicket = ticket;
+    }
+    queue.wake.notify_all();
+    return ticket;
+}
+
+long getClipboardWriteStatus(unsigned long ticket) {
+    std::lock_guard<std::mutex> lock(clipboardQueue.mutex);
+    if (ticket != 0 && (ticket == clipboardQueue.pendingTicket || ticket == clipboardQueue.activeTicket)) {
+        return CLIPBOARD_STATUS_PENDING;
+    }
+    auto found = clipboardQueue.results.find(ticket);
+    return (found != clipboardQueue.results.end()) ? found->second : CLIPBOARD_STATUS_UNKNOWN;
+}
+
+void shutdownClipboardWriter() {
+    {
+        std::lock_guard<std::mutex> lock(clipboardQueue.mutex);
+        clipboardQueue.stopping = true;
+        clipboardQueue.supersedePending();
+    }
+    clipboardQueue.wake.notify_all();
+    if (clipboardQueue.worker.joinable()) {
+        clipboardQueue.worker.join();
+    }
+
+    // Allow the library to be used again if ExtendScript initializes it again without unloading
+    std::lock_guard<std::mutex> lock(clipboardQueue.mutex);
+    clipboardQueue.stopping = false;
+    clipboardQueue.backend = nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Functions ------------------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Queues text to be copied to the clipboard and returns immediately, without waiting for the clipboard.
+ * The copy happens on a background thread, which retries for a couple of seconds if another app has the clipboard open.
+ * If more text is queued before the earlier text is written, only the newest is copied.
+ * @param argv JavaScript arguments. Expects one string.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. A ticket number to pass to getClipboardStatus.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var ticket = externalLibrary.copyTextToClipboardAsync("Text to copy");
+ */
+THIO_EXPORT(copyTextToClipboardAsync)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr) return kESErrBadArgumentList;
+
+    const unsigned long ticket = queueClipboardText(argv[0].data.string, strlen(argv[0].data.string));
+    if (ticket == 0) return THIO_ERR_NO_MEMORY;
+
+    retval->type = kTypeDouble; // Tickets can go past the 32 bit integer range
+    retval->data.fltval = (double)ticket;
+    return kESErrOK;
+}
+
+/**
+ * @brief Gets the status of a copy queued with copyTextToClipboardAsync.
+ * @param argv JavaScript arguments. Expects the ticket number.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. 0 once copied, -1 while still pending, -2 if newer text replaced it before it was copied,
+ * -3 for an unknown ticket, or the error code the copy failed with (e.g. 10001 if the clipboard stayed busy).
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var status = externalLibrary.getClipboardStatus(ticket);
+ */
+THIO_EXPORT(getClipboardStatus)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    double ticket;
+    if (argv[0].type == kTypeDouble) {
+        ticket = argv[0].data.fltval;
+    } else if (argv[0].type == kTypeInteger || argv[0].type == kTypeUInteger) {
+        ticket = (double)argv[0].data.intval;
+    } else {
+        return kESErrTypeMismatch;
+    }
+
+    long status = CLIPBOARD_STATUS_UNKNOWN;
+    if (ticket >= 1 && ticket <= (double)ULONG_MAX && ticket == (double)(unsigned long)ticket) {
+        status = getClipboardWriteStatus((unsigned long)ticket);
+    }
+
+    retval->type = kTypeInteger;
+    retval->data.intval = status;
+    return kESErrOK;
+}
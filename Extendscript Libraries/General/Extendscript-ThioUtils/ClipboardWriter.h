@@ -0,0 +1,70 @@
+#pragma once
+
+// ClipboardWriter.h
+// Clipboard writes, either immediately or queued to a background thread.
+//
+// A queued write returns a ticket right away, and a worker thread does the UTF-16 conversion and the clipboard
+// calls. If another process has the clipboard open, the worker retries with backoff instead of failing. Only the
+// newest queued text matters, so a write queued while another is still waiting replaces it, and the replaced ticket
+// reports CLIPBOARD_STATUS_SUPERSEDED.
+//
+// The platform calls are behind ClipboardBackend so the queue can run on Linux against MemoryClipboardBackend.
+
+#include <cstddef>
+#include <string>
+
+// Ticket status values from getClipboardWriteStatus. Otherwise it returns kESErrOK or the error code of the write.
+#define CLIPBOARD_STATUS_PENDING    -1  // Still queued or being written
+#define CLIPBOARD_STATUS_SUPERSEDED -2  // Replaced by newer text before it was written
+#define CLIPBOARD_STATUS_UNKNOWN    -3  // Never issued, or too old to still be remembered
+
+// How long the worker keeps retrying while the clipboard is busy, and the backoff between attempts
+#define CLIPBOARD_RETRY_TIMEOUT_MS  2000
+#define CLIPBOARD_RETRY_FIRST_MS    2
+#define CLIPBOARD_RETRY_MAX_MS      100
+
+class ClipboardBackend {
+public:
+    virtual ~ClipboardBackend() {}
+
+    /**
+     * @brief Replaces the clipboard contents with UTF-8 text.
+     * @return kESErrOK, or an error code. THIO_ERR_CLIPBOARD_BUSY means another process has the clipboard open and the
+     * write can be retried.
+     */
+    virtual long setText(const char* utf8, size_t length) = 0;
+};
+
+// Keeps the text in memory. Used on platforms without a clipboard backend, and for exercising the queue.
+class MemoryClipboardBackend : public ClipboardBackend {
+public:
+    long setText(const char* utf8, size_t length) override;
+
+    std::string text;
+    int busyCount = 0;  // Number of upcoming writes that should fail with THIO_ERR_CLIPBOARD_BUSY
+    int writeCount = 0; // Successful writes
+};
+
+/**
+ * @brief Replaces the backend used for all writes. Pass nullptr to go back to the platform's own.
+ * The caller keeps ownership and must keep it alive until it's replaced or shutdownClipboardWriter is called.
+ */
+void setClipboardBackend(ClipboardBackend* backend);
+
+/**
+ * @brief Writes text to the clipboard and waits for the result. Replaces any text still waiting in the queue.
+ * @return kESErrOK or the backend's error code.
+ */
+long writeClipboardText(const char* utf8, size_t length);
+
+/**
+ * @brief Queues text to be written by the worker thread, starting the thread if needed.
+ * @return A ticket (always above zero) to pass to getClipboardWriteStatus, or 0 if the text couldn't be queued.
+ */
+unsigned long queueClipboardText(const char* utf8, size_t length);
+
+// Status of a queued write. One of the CLIPBOARD_STATUS_* values, kESErrOK, or the error code the write failed with.
+long getClipboardWriteStatus(unsigned long ticket);
+
+// Stops the worker thread. Text still waiting in the queue is dropped. Called from ESTerminate.
+void shutdownClipboardWriter();
@@ -0,0 +1,453 @@
+#include "EllipseFit.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "NativeBuffer.h"
+#include "PackedData.h"
+#include "SoSharedLibDefs.h"
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+// How this works (same math as fitEllipse() in Path-Points-To-Ellipse.jsx):
+//    - Each point gives a design matrix row d = [x^2, xy, y^2, x, y, 1]
+//    - The scatter matrix S = D^T * D is split into 3x3 blocks S11, S12, S22
+//    - T = -inv(S22) * S12^T, M = S11 + S12 * T
+//    - Solve the eigen problem inv(C1) * M for the quadratic coefficients, then the linear ones are T * a1
+//
+// Differences from the JS version, none of which change the result:
+//    - S only contains the 15 distinct moments sum(x^i * y^j) for i + j <= 4, so we accumulate those in one
+//      pass over the points instead of building D. Memory use no longer depends on the number of points.
+//    - Coordinates are taken relative to the first point while accumulating. The fit is translation
+//      invariant, and this keeps the 4th order moments from losing precision with large pixel coordinates.
+//    - inv(C1) is constant so it's written out directly instead of regularizing and inverting C1
+//    - The 3x3 eigen problem is solved in closed form from its characteristic cubic
+// ------------------------------------------------------------------------------------------------
+
+typedef double Mat3[3][3];
+
+// Power sums of the (shifted) points. Named by exponent, e.g. x3y = sum(x^3 * y)
+struct EllipseMoments {
+    double x4 = 0, x3y = 0, x2y2 = 0, xy3 = 0, y4 = 0;
+    double x3 = 0, x2y = 0, xy2 = 0, y3 = 0;
+    double x2 = 0, xy = 0, y2 = 0;
+    double x = 0, y = 0;
+    double n = 0;
+};
+
+static void accumulateMoments(const double* xy, size_t pointCount, double shiftX, double shiftY, EllipseMoments& m) {
+    for (size_t i = 0; i < pointCount; i++) {
+        const double x = xy[i * 2] - shiftX;
+        const double y = xy[i * 2 + 1] - shiftY;
+        const double xx = x * x;
+        const double xY = x * y;
+        const double yy = y * y;
+
+        m.x4 += xx * xx;
+        m.x3y += xx * xY;
+        m.x2y2 += xx * yy;
+        m.xy3 += xY * yy;
+        m.y4 += yy * yy;
+
+        m.x3 += xx * x;
+        m.x2y += xx * y;
+        m.xy2 += x * yy;
+        m.y3 += yy * y;
+
+        m.x2 += xx;
+        m.xy += xY;
+        m.y2 += yy;
+
+        m.x += x;
+        m.y += y;
+    }
+    m.n += (double)pointCount;
+}
+
+static double det3(const Mat3& m) {
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+         - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+         + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// Inverts a 3x3 matrix via the adjugate. Returns false if it's singular (or too close to it to be useful).
+static bool invert3(const Mat3& m, Mat3& inv) {
+    const double det = det3(m);
+
+    // Compare against the scale of the matrix, since the raw determinant of a scatter matrix can be huge or tiny
+    double maxAbs = 0;
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            maxAbs = std::fmax(maxAbs, std::fabs(m[r][c]));
+        }
+    }
+    if (!std::isfinite(det) || maxAbs == 0 || std::fabs(det) <= 1e-14 * maxAbs * maxAbs * maxAbs) {
+        return false;
+    }
+
+    const double invDet = 1.0 / det;
+    inv[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * invDet;
+    inv[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+    inv[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+    inv[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * invDet;
+    inv[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+    inv[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+    inv[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * invDet;
+    inv[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+    inv[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+    return true;
+}
+
+// result = a * b
+static void multiply3(const Mat3& a, const Mat3& b, Mat3& result) {
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            result[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c];
+        }
+    }
+}
+
+// Finds the real roots of x^3 + a*x^2 + b*x + c = 0. Returns the number of roots written to 'roots'.
+static int solveCubicReal(double a, double b, double c, double roots[3]) {
+    const double pi = 3.14159265358979323846;
+
+    // Substitute x = t - a/3 to get the depressed cubic t^3 + p*t + q = 0
+    const double aThird = a / 3.0;
+    const double p = b - a * aThird;
+    const double q = 2.0 * aThird * aThird * aThird - aThird * b + c;
+
+    int count = 0;
+    const double halfQ = q / 2.0;
+    const double thirdP = p / 3.0;
+    const double discriminant = halfQ * halfQ + thirdP * thirdP * thirdP;
+
+    if (p == 0.0) {
+        roots[count++] = std::cbrt(-q) - aThird;
+    }
+    else if (discriminant > 0.0) {
+        // One real root (Cardano)
+        const double sqrtDisc = std::sqrt(discriminant);
+        roots[count++] = std::cbrt(-halfQ + sqrtDisc) + std::cbrt(-halfQ - sqrtDisc) - aThird;
+    }
+    else {
+        // Three real roots (trigonometric method). p is negative here.
+        const double radius = 2.0 * std::sqrt(-thirdP);
+        double cosArg = (3.0 * q / (2.0 * p)) * std::sqrt(-3.0 / p);
+        cosArg = std::fmax(-1.0, std::fmin(1.0, cosArg)); // Guard against rounding pushing it out of acos's domain
+        const double phi = std::acos(cosArg) / 3.0;
+        for (int k = 0; k < 3; k++) {
+            roots[count++] = radius * std::cos(phi - 2.0 * pi * k / 3.0) - aThird;
+        }
+    }
+
+    // Polish the roots with a couple of Newton steps, the closed form can lose a few digits
+    for (int i = 0; i < count; i++) {
+        for (int iter = 0; iter < 2; iter++) {
+            const double x = roots[i];
+            const double f = ((x + a) * x + b) * x + c;
+            const double df = (3.0 * x + 2.0 * a) * x + b;
+            if (df == 0.0) {
+                break;
+            }
+            const double next = x - f / df;
+            if (!std::isfinite(next)) {
+                break;
+            }
+            roots[i] = next;
+        }
+    }
+    return count;
+}
+
+// Finds an eigenvector of m for the given eigenvalue, as the largest cross product of two rows of (m - lambda*I)
+static bool eigenvector3(const Mat3& m, double lambda, double vec[3]) {
+    double rows[3][3];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            rows[r][c] = m[r][c] - (r == c ? lambda : 0.0);
+        }
+    }
+
+    static const int pairs[3][2] = { {0, 1}, {0, 2}, {1, 2} };
+    double bestNorm = 0;
+    for (const auto& pair : pairs) {
+        const double* u = rows[pair[0]];
+        const double* v = rows[pair[1]];
+        const double cross[3] = {
+            u[1] * v[2] - u[2] * v[1],
+            u[2] * v[0] - u[0] * v[2],
+            u[0] * v[1] - u[1] * v[0]
+        };
+        const double norm = cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
+        if (norm > bestNorm) {
+            bestNorm = norm;
+            vec[0] = cross[0];
+            vec[1] = cross[1];
+            vec[2] = cross[2];
+        }
+    }
+
+    if (!(bestNorm > 0) || !std::isfinite(bestNorm)) {
+        return false;
+    }
+    const double invLen = 1.0 / std::sqrt(bestNorm);
+    vec[0] *= invLen;
+    vec[1] *= invLen;
+    vec[2] *= invLen;
+    return true;
+}
+
+// Port of ellipseCoefficientsToParameters() from Path-Points-To-Ellipse.jsx
+static bool ellipseCoefficientsToParameters(const double coeffs[6], EllipseParams& out) {
+    const double pi = 3.14159265358979323846;
+    const double A = coeffs[0], B = coeffs[1], C = coeffs[2], D = coeffs[3], E = coeffs[4], F = coeffs[5];
+
+    double theta = 0.5 * std::atan2(B, A - C);
+    const double sinT = std::sin(theta);
+    const double cosT = std::cos(theta);
+
+    // Rotate the coordinate system to eliminate the cross-product term B
+    const double Ao = A * cosT * cosT + B * cosT * sinT + C * sinT * sinT;
+    const double Co = A * sinT * sinT - B * cosT * sinT + C * cosT * cosT;
+    const double Do = D * cosT + E * sinT;
+    const double Eo = -D * sinT + E * cosT;
+
+    if (Ao == 0 || Co == 0) {
+        return false; // Degenerate ellipse
+    }
+
+    // Center in rotated coordinates
+    const double x0Prime = -Do / (2 * Ao);
+    const double y0Prime = -Eo / (2 * Co);
+
+    const double F0 = F + Ao * x0Prime * x0Prime + Do * x0Prime + Co * y0Prime * y0Prime + Eo * y0Prime;
+
+    double aAxis = std::sqrt(std::fabs(-F0 / Ao));
+    double bAxis = std::sqrt(std::fabs(-F0 / Co));
+
+    // Ensure that aAxis is the semi-major axis
+    if (aAxis < bAxis) {
+        const double temp = aAxis;
+        aAxis = bAxis;
+        bAxis = temp;
+        theta += pi / 2;
+    }
+
+    out.cx = x0Prime * cosT - y0Prime * sinT;
+    out.cy = x0Prime * sinT + y0Prime * cosT;
+    out.a = aAxis;
+    out.b = bAxis;
+    out.theta = std::fmod(theta, 2 * pi); // Same as JS's % operator, which keeps the sign of the dividend
+
+    return std::isfinite(out.cx) && std::isfinite(out.cy) && std::isfinite(out.a) && std::isfinite(out.b) && std::isfinite(out.theta);
+}
+
+bool fitEllipseToPoints(const double* xy, size_t pointCount, EllipseParams& out) {
+    if (xy == nullptr || pointCount < ELLIPSE_FIT_MIN_POINTS) {
+        return false;
+    }
+
+    const double shiftX = xy[0];
+    const double shiftY = xy[1];
+    EllipseMoments m;
+    accumulateMoments(xy, pointCount, shiftX, shiftY, m);
+
+    const Mat3 S11 = {
+        { m.x4,   m.x3y,  m.x2y2 },
+        { m.x3y,  m.x2y2, m.xy3  },
+        { m.x2y2, m.xy3,  m.y4   }
+    };
+    const Mat3 S12 = {
+        { m.x3,  m.x2y, m.x2 },
+        { m.x2y, m.xy2, m.xy },
+        { m.xy2, m.y3,  m.y2 }
+    };
+    const Mat3 S21 = {
+        { S12[0][0], S12[1][0], S12[2][0] },
+        { S12[0][1], S12[1][1], S12[2][1] },
+        { S12[0][2], S12[1][2], S12[2][2] }
+    };
+    const Mat3 S22 = {
+        { m.x2, m.xy, m.x },
+        { m.xy, m.y2, m.y },
+        { m.x,  m.y,  m.n }
+    };
+
+    // T = -inv(S22) * S21
+    Mat3 S22Inv;
+    if (!invert3(S22, S22Inv)) {
+        return false;
+    }
+    Mat3 T;
+    multiply3(S22Inv, S21, T);
+    for (auto& row : T) {
+        for (double& v : row) {
+            v = -v;
+        }
+    }
+
+    // M = S11 + S12 * T
+    Mat3 M;
+    multiply3(S12, T, M);
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            M[r][c] += S11[r][c];
+        }
+    }
+
+    // N = inv(C1) * M, where C1 = [[0,0,2],[0,-1,0],[2,0,0]] so inv(C1) = [[0,0,1/2],[0,-1,0],[1/2,0,0]]
+    const Mat3 N = {
+        { M[2][0] / 2, M[2][1] / 2, M[2][2] / 2 },
+        { -M[1][0],    -M[1][1],    -M[1][2]    },
+        { M[0][0] / 2, M[0][1] / 2, M[0][2] / 2 }
+    };
+
+    // Characteristic polynomial: lambda^3 - trace*lambda^2 + (sum of principal 2x2 minors)*lambda - det = 0
+    const double trace = N[0][0] + N[1][1] + N[2][2];
+    const double minors = (N[0][0] * N[1][1] - N[0][1] * N[1][0])
+                        + (N[0][0] * N[2][2] - N[0][2] * N[2][0])
+                        + (N[1][1] * N[2][2] - N[1][2] * N[2][1]);
+    double eigenvalues[3];
+    const int eigenCount = solveCubicReal(-trace, minors, -det3(N), eigenvalues);
+
+    // Like the JS version, use the eigenvector for the smallest positive eigenvalue. But also require that it
+    // actually satisfies the ellipse constraint 4AC - B^2 > 0, so rounding noise can't pick a hyperbola.
+    bool found = false;
+    double bestLambda = 0;
+    double a1[3] = { 0, 0, 0 };
+    for (int i = 0; i < eigenCount; i++) {
+        const double lambda = eigenvalues[i];
+        if (!(lambda > 0) || !std::isfinite(lambda) || (found && lambda >= bestLambda)) {
+            continue;
+        }
+        double vec[3] = { 0, 0, 0 };
+        if (!eigenvector3(N, lambda, vec)) {
+            continue;
+        }
+        if (4 * vec[0] * vec[2] - vec[1] * vec[1] <= 0) {
+            continue;
+        }
+        found = true;
+        bestLambda = lambda;
+        a1[0] = vec[0];
+        a1[1] = vec[1];
+        a1[2] = vec[2];
+    }
+    if (!found) {
+        return false;
+    }
+
+    // a2 = T * a1, then the full coefficient vector is [a1; a2]
+    double coeffs[6] = { a1[0], a1[1], a1[2], 0, 0, 0 };
+    for (int r = 0; r < 3; r++) {
+        coeffs[3 + r] = T[r][0] * a1[0] + T[r][1] * a1[1] + T[r][2] * a1[2];
+    }
+
+    // The JS version normalizes so the last element is 1, which also fixes the overall sign of the coefficients.
+    // The sign decides which of the two equivalent orientations theta lands on, so divide by the constant term
+    // the unshifted equation would have to match it: F + A*sx^2 + B*sx*sy + C*sy^2 - D*sx - E*sy
+    const double unshiftedF = coeffs[5] + coeffs[0] * shiftX * shiftX + coeffs[1] * shiftX * shiftY + coeffs[2] * shiftY * shiftY
+                            - coeffs[3] * shiftX - coeffs[4] * shiftY;
+    if (unshiftedF != 0) {
+        for (double& c : coeffs) {
+            c /= unshiftedF;
+        }
+    }
+
+    if (!ellipseCoefficientsToParameters(coeffs, out)) {
+        return false;
+    }
+
+    // Undo the shift from accumulateMoments. The axes and rotation aren't affected by translation.
+    out.cx += shiftX;
+    out.cy += shiftY;
+    return true;
+}
+
+// Appends the ellipse as a JS object literal, or null if the fit failed
+static void appendEllipseLiteral(std::string& out, bool success, const EllipseParams& params) {
+    if (!success) {
+        out += "null";
+        return;
+    }
+    out += "{cx:";
+    appendJsNumber(out, params.cx);
+    out += ",cy:";
+    appendJsNumber(out, params.cy);
+    out += ",a:";
+    appendJsNumber(out, params.a);
+    out += ",b:";
+    appendJsNumber(out, params.b);
+    out += ",theta:";
+    appendJsNumber(out, params.theta);
+    out += "}";
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Fits an ellipse to the given points.
+ * @param argv JavaScript arguments. Expects one string of packed coordinates: "x0,y0,x1,y1,..."
+ *             Or an f64 NativeBuffer of the same coordinates, which is read in place.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. A script that evaluates to {cx, cy, a, b, theta}, or null if no ellipse could be fitted.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var ellipse = externalLibrary.fitEllipse("10,20,30,40,...");
+ */
+THIO_EXPORT(fitEllipse)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    NumericSpan<double> coords;
+    const long err = getNumericArg(argv[0], coords);
+    if (err != kESErrOK) return err;
+    if (coords.size() % 2 != 0) return kESErrBadArgumentList; // Must be x,y pairs
+
+    EllipseParams params;
+    bool success = fitEllipseToPoints(coords.data(), coords.size() / 2, params);
+
+    std::string script = "(";
+    appendEllipseLiteral(script, success, params);
+    script += ")";
+    return setScriptResult(retval, script);
+}
+
+/**
+ * @brief Fits an ellipse to each of several sets of points in one call.
+ * @param argv JavaScript arguments. Expects one string of packed coordinates, with each set separated by ';'
+ *             For example: "x0,y0,x1,y1,...;x0,y0,x1,y1,..."
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. A script that evaluates to an array with one {cx, cy, a, b, theta} object per
+ *               set of points, in the same order. Sets that couldn't be fitted are null.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var ellipses = externalLibrary.fitEllipseBatch("10,20,30,40,...;50,60,70,80,...");
+ */
+THIO_EXPORT(fitEllipseBatch)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr) return kESErrBadArgumentList;
+
+    std::vector<std::vector<double>> records;
+    if (!parsePackedDoubleRecords(argv[0].data.string, records)) return kESErrConversion;
+
+    std::string script = "[";
+    for (size_t i = 0; i < records.size(); i++) {
+        const std::vector<double>& coords = records[i];
+        EllipseParams params;
+        bool success = (coords.size() % 2 == 0) && fitEllipseToPoints(coords.data(), coords.size() / 2, params);
+
+        if (i > 0) {
+            script += ",";
+        }
+        appendEllipseLiteral(script, success, params);
+    }
+    script += "]";
+    return setScriptResult(retval, script);
+}
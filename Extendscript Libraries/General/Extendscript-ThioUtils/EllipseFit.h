@@ -0,0 +1,28 @@
+#pragma once
+
+// EllipseFit.h
+// Native direct least-squares ellipse fitting (Halir & Flusser's numerically stable version of Fitzgibbon's method).
+// This is the same algorithm as fitEllipse() in Scripts/Photoshop/Path-Points-To-Ellipse.jsx, which uses numeric.js.
+
+#include <cstddef>
+
+// Same fields and meaning as the object returned by ellipseCoefficientsToParameters() in Path-Points-To-Ellipse.jsx
+struct EllipseParams {
+    double cx;      // Center X
+    double cy;      // Center Y
+    double a;       // Semi-major axis
+    double b;       // Semi-minor axis
+    double theta;   // Rotation of the major axis in radians
+};
+
+// The JS version requires six points, so we do too, to keep results consistent between the two
+#define ELLIPSE_FIT_MIN_POINTS 6
+
+/**
+ * @brief Fits an ellipse to a set of points.
+ * @param xy Interleaved coordinates: x0, y0, x1, y1, ...
+ * @param pointCount Number of points (so xy has pointCount * 2 values)
+ * @param out Receives the ellipse parameters on success
+ * @return true on success. false if there are too few points or the points don't describe an ellipse.
+ */
+bool fitEllipseToPoints(const double* xy, size_t pointCount, EllipseParams& out);
@@ -0,0 +1,234 @@
+#pragma once
+
+// ExportBinding.h
+// Typed exports: an export written as a plain C++ function, with the TaggedData marshalling generated from its parameters.
+//
+//      long addTicksTyped(std::string& result, const char* ticksA, const char* ticksB) { ... }
+//      THIO_BIND_EXPORT(addTicks, addTicksTyped)
+//
+// The first parameter receives the result and the rest are the JavaScript arguments, in order. THIO_BIND_EXPORT
+// defines the exported addTicks, which checks the argument count, converts each argument with ExportArg, calls the
+// typed function and stores its result with ExportResult. It's timed and counted for getStats like a THIO_EXPORT.
+// The typed function returns kESErrOK or an error code as usual. A converter that rejects an argument returns its error
+// without calling the function, and running out of memory anywhere in the call becomes THIO_ERR_NO_MEMORY.
+//
+// exportSignature<addTicksTyped> is the function's ExtendScript signature ("ss" here), worked out at compile time, so
+// the export table takes it from the parameters instead of a hand-written string that can drift from them. For that
+// the typed function is declared in Exports.h.
+//
+// Argument types, with their signature character:
+//      const char*                 s   The string as ExtendScript passed it, never null
+//      std::vector<long long>      s   Packed integers such as tick values (parsePackedInt64s), kESErrConversion if malformed
+//      std::vector<double>         s   Packed numbers (parsePackedDoubles), kESErrConversion if malformed
+//      NumericSpan<long long>      a   Like std::vector<long long>, but also takes a number, or a NativeBuffer read in place if it's i64
+//      NumericSpan<double>         a   Like std::vector<double>, but also takes a number, or a NativeBuffer read in place if it's f64
+//      long                        d
+//      unsigned long               u
+//      double                      f   Integers are accepted too
+//      bool                        b
+// Result types: std::string (returned as a string), ScriptResult (evaluated as a script), long, double and bool.
+// Vectors and spans can be taken by const reference. Other types fail to compile until they get an ExportArg or ExportResult.
+
+#include "ExportStats.h"
+#include "NativeBuffer.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include "SoSharedLibDefs.h"
+#include <cstring>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A result that ExtendScript evaluates, like setScriptResult. The script must be a complete expression, e.g. "[1,2]".
+struct ScriptResult {
+    std::string script;
+};
+
+//--------------------------------------------------------------------------------------
+//------------------------------------- Arguments --------------------------------------
+//--------------------------------------------------------------------------------------
+
+template <typename T>
+struct ExportArg;
+
+template <>
+struct ExportArg<const char*> {
+    static constexpr char signature = 's';
+    static long convert(const TaggedData& arg, const char*& value) {
+        if (arg.type != kTypeString) return kESErrTypeMismatch;
+        if (arg.data.string == nullptr) return kESErrBadArgumentList;
+        value = arg.data.string;
+        return kESErrOK;
+    }
+};
+
+template <>
+struct ExportArg<std::vector<long long>> {
+    static constexpr char signature = 's';
+    static long convert(const TaggedData& arg, std::vector<long long>& values) {
+        const char* packed = nullptr;
+        const long err = ExportArg<const char*>::convert(arg, packed);
+        if (err != kESErrOK) return err;
+        return parsePackedInt64s(packed, packed + strlen(packed), values) ? kESErrOK : kESErrConversion;
+    }
+};
+
+template <>
+struct ExportArg<std::vector<double>> {
+    static constexpr char signature = 's';
+    static long convert(const TaggedData& arg, std::vector<double>& values) {
+        const char* packed = nullptr;
+        const long err = ExportArg<const char*>::convert(arg, packed);
+        if (err != kESErrOK) return err;
+        return parsePackedDoubles(packed, packed + strlen(packed), values) ? kESErrOK : kESErrConversion;
+    }
+};
+
+template <typename T>
+struct ExportArg<NumericSpan<T>> {
+    static constexpr char signature = 'a';
+    static long convert(const TaggedData& arg, NumericSpan<T>& values) {
+        return getNumericArg(arg, values);
+    }
+};
+
+template <>
+struct ExportArg<long> {
+    static constexpr char signature = 'd';
+    static long convert(const TaggedData& arg, long& value) {
+        if (arg.type != kTypeInteger && arg.type != kTypeUInteger) return kESErrTypeMismatch;
+        value = arg.data.intval;
+        return kESErrOK;
+    }
+};
+
+template <>
+struct ExportArg<unsigned long> {
+    static constexpr char signature = 'u';
+    static long convert(const TaggedData& arg, unsigned long& value) {
+        if (arg.type != kTypeInteger && arg.type != kTypeUInteger) return kESErrTypeMismatch;
+        value = (unsigned long)arg.data.intval;
+        return kESErrOK;
+    }
+};
+
+template <>
+struct ExportArg<double> {
+    static constexpr char signature = 'f';
+    static long convert(const TaggedData& arg, double& value) {
+        if (arg.type == kTypeDouble) value = arg.data.fltval;
+        else if (arg.type == kTypeInteger) value = (double)arg.data.intval;
+        else if (arg.type == kTypeUInteger) value = (double)(unsigned long)arg.data.intval;
+        else return kESErrTypeMismatch;
+        return kESErrOK;
+    }
+};
+
+template <>
+struct ExportArg<bool> {
+    static constexpr char signature = 'b';
+    static long convert(const TaggedData& arg, bool& value) {
+        if (arg.type != kTypeBool) return kESErrTypeMismatch;
+        value = arg.data.intval != 0;
+        return kESErrOK;
+    }
+};
+
+//--------------------------------------------------------------------------------------
+//-------------------------------------- Results ---------------------------------------
+//--------------------------------------------------------------------------------------
+
+template <typename T>
+struct ExportResult;
+
+template <>
+struct ExportResult<std::string> {
+    static long store(TaggedData* retval, const std::string& value) { return setStringResult(retval, value); }
+};
+
+template <>
+struct ExportResult<ScriptResult> {
+    static long store(TaggedData* retval, const ScriptResult& value) { return setScriptResult(retval, value.script); }
+};
+
+template <>
+struct ExportResult<long> {
+    static long store(TaggedData* retval, long value) {
+        retval->type = kTypeInteger;
+        retval->data.intval = value;
+        return kESErrOK;
+    }
+};
+
+template <>
+struct ExportResult<double> {
+    static long store(TaggedData* retval, double value) {
+        retval->type = kTypeDouble;
+        retval->data.fltval = value;
+        return kESErrOK;
+    }
+};
+
+template <>
+struct ExportResult<bool> {
+    static long store(TaggedData* retval, bool value) {
+        retval->type = kTypeBool;
+        retval->data.intval = value ? 1 : 0;
+        return kESErrOK;
+    }
+};
+
+//--------------------------------------------------------------------------------------
+//-------------------------------------- Binding ---------------------------------------
+//--------------------------------------------------------------------------------------
+
+template <typename Function>
+struct ExportBinding;
+
+template <typename Result, typename... Args>
+struct ExportBinding<long (*)(Result&, Args...)> {
+    static constexpr char signature[] = { ExportArg<std::decay_t<Args>>::signature..., '\0' };
+
+    // The ExportImplementation that THIO_BIND_EXPORT wraps. Function is a template argument so the call to it can be inlined.
+    template <long (*Function)(Result&, Args...)>
+    static long call(TaggedData* argv, long argc, TaggedData* retval) {
+        retval->type = kTypeUndefined;
+        if (argc != (long)sizeof...(Args)) return kESErrBadArgumentList;
+        try {
+            return invoke<Function>(argv, retval, std::index_sequence_for<Args...>());
+        }
+        catch (const std::bad_alloc&) {
+            return THIO_ERR_NO_MEMORY;
+        }
+    }
+
+private:
+    template <long (*Function)(Result&, Args...), size_t... Index>
+    static long invoke(TaggedData* argv, TaggedData* retval, std::index_sequence<Index...>) {
+        std::tuple<std::decay_t<Args>...> values;
+        long err = kESErrOK;
+        // Left to right, stopping at the first argument that doesn't convert
+        const bool converted = (((err = ExportArg<std::decay_t<Args>>::convert(argv[Index], std::get<Index>(values))) == kESErrOK) && ...);
+        if (!converted) return err;
+        (void)argv;
+
+        Result result{};
+        err = Function(result, std::get<Index>(values)...);
+        if (err != kESErrOK) return err;
+        return ExportResult<Result>::store(retval, result);
+    }
+};
+
+// The ExtendScript signature of a typed export function, e.g. "ss". Used in the export table.
+template <auto Function>
+constexpr const char* exportSignature = ExportBinding<decltype(Function)>::signature;
+
+// Defines the extern "C" export 'name' for a typed function. Use it after the function, at namespace scope.
+#define THIO_BIND_EXPORT(name, typedFunction) \
+    extern "C" THIOUTILS_API long name(TaggedData* argv, long argc, TaggedData* retval) { \
+        static const int statsIndex = getExportStatsIndex(#name); \
+        return callInstrumentedExport(statsIndex, ExportBinding<decltype(&typedFunction)>::call<typedFunction>, argv, argc, retval); \
+    }
@@ -0,0 +1,407 @@
+#include "ExportStats.h"
+#include "Exports.h"
+#include "PackedData.h"
+#include "ResultMemory.h"
+#include "ThioUtils.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define HISTOGRAM_SUB_BUCKETS   (1 << STATS_HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKET_COUNT  ((STATS_HISTOGRAM_MAX_BITS - STATS_HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+// ------------------------------------------------------------------------------------------------
+// Counters. Each thread that calls an export gets one ExportCounters per export in the table. Only the owning thread
+// writes them, so updates are a plain load and store. They're atomics only so getStats can read them from any thread.
+// ------------------------------------------------------------------------------------------------
+
+struct ExportCounters {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> errors;
+    std::atomic<uint64_t> otherErrorCodes;  // Errors whose code didn't fit in errorCodes
+    std::atomic<uint64_t> bytesIn;
+    std::atomic<uint64_t> bytesOut;
+    std::atomic<uint64_t> totalNs;
+    std::atomic<long> errorCodes[STATS_ERROR_CODE_SLOTS];       // 0 = slot unused
+    std::atomic<uint64_t> errorCounts[STATS_ERROR_CODE_SLOTS];
+    std::atomic<uint64_t> histogram[HISTOGRAM_BUCKET_COUNT];
+};
+
+// Sum of all threads' counters for one export
+struct MergedExportStats {
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    uint64_t otherErrorCodes = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t totalNs = 0;
+    std::map<long, uint64_t> errorCodes;
+    std::vector<uint64_t> histogram = std::vector<uint64_t>(HISTOGRAM_BUCKET_COUNT, 0);
+};
+
+namespace {
+    std::mutex registryMutex; // Guards the lists below. Never taken on the call path except on a thread's first call.
+    std::vector<std::unique_ptr<ExportCounters[]>> threadCounters;
+    std::vector<MergedExportStats> resetBaseline; // Totals at the last resetStats, subtracted from every snapshot
+    ResultMemoryStats resetMemoryBaseline = {};
+    std::chrono::steady_clock::time_point resetTime = std::chrono::steady_clock::now();
+}
+
+static size_t getExportCount() {
+    size_t count = 0;
+    getExportTable(count);
+    return count;
+}
+
+// The calling thread's counters, created on its first call
+static ExportCounters* getThreadCounters() {
+    thread_local ExportCounters* counters = nullptr;
+    if (counters == nullptr) {
+        std::unique_ptr<ExportCounters[]> block(new ExportCounters[getExportCount()]()); // Value-initialized, so all zero
+        counters = block.get();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadCounters.push_back(std::move(block));
+    }
+    return counters;
+}
+
+// Single writer, so no read-modify-write instruction is needed
+static inline void bumpCounter(std::atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static inline int highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    // _BitScanReverse64 isn't available in 32-bit builds, so check each half
+    unsigned long index;
+    if (_BitScanReverse(&index, (unsigned long)(value >> 32))) {
+        return (int)index + 32;
+    }
+    _BitScanReverse(&index, (unsigned long)value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+// Values below 2 * HISTOGRAM_SUB_BUCKETS get one bucket each. Above that, each power of two is split into
+// HISTOGRAM_SUB_BUCKETS buckets by the bits following the highest one.
+static inline int histogramBucket(uint64_t ns) {
+    if (ns < 2 * HISTOGRAM_SUB_BUCKETS) {
+        return (int)ns;
+    }
+    if (ns >> STATS_HISTOGRAM_MAX_BITS) {
+        return HISTOGRAM_BUCKET_COUNT - 1;
+    }
+    const int shift = highestBit(ns) - STATS_HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)(ns >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+// Largest value that falls in a bucket
+static uint64_t histogramBucketUpperBound(int bucket) {
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    const int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    const uint64_t mantissa = (uint64_t)(bucket % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+static void recordErrorCode(ExportCounters& counters, long err) {
+    for (int s = 0; s < STATS_ERROR_CODE_SLOTS; s++) {
+        const long code = counters.errorCodes[s].load(std::memory_order_relaxed);
+        if (code == err) {
+            counters.errorCounts[s].store(counters.errorCounts[s].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            return;
+        }
+        if (code == 0) {
+            // The count is stored with release, so a reader that sees it also sees the code
+            counters.errorCodes[s].store(err, std::memory_order_relaxed);
+            counters.errorCounts[s].store(1, std::memory_order_release);
+            return;
+        }
+    }
+    bumpCounter(counters.otherErrorCodes, 1);
+}
+
+// Size of a value passed across the boundary. Strings count their length, other values a fixed 8 bytes.
+static uint64_t marshalledBytes(const TaggedData& data) {
+    switch (data.type) {
+    case kTypeString:
+    case kTypeScript:
+        return (data.data.string != nullptr) ? strlen(data.data.string) : 0;
+    case kTypeUndefined:
+        return 0;
+    default:
+        return 8;
+    }
+}
+
+int getExportStatsIndex(const char* name) {
+    size_t count = 0;
+    const ExportEntry* table = getExportTable(count);
+    const ExportEntry* entry = findExport(name, strlen(name));
+    return (entry != nullptr) ? (int)(entry - table) : -1;
+}
+
+long callInstrumentedExport(int statsIndex, ExportImplementation implementation, TaggedData* argv, long argc, TaggedData* retval) {
+    if (statsIndex < 0) {
+        return implementation(argv, argc, retval);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const long err = implementation(argv, argc, retval);
+    const auto end = std::chrono::steady_clock::now();
+
+    ExportCounters& counters = getThreadCounters()[statsIndex];
+    const uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    uint64_t bytesIn = 0;
+    for (long i = 0; i < argc; i++) {
+        bytesIn += marshalledBytes(argv[i]);
+    }
+
+    bumpCounter(counters.calls, 1);
+    bumpCounter(counters.totalNs, ns);
+    bumpCounter(counters.bytesIn, bytesIn);
+    bumpCounter(counters.bytesOut, marshalledBytes(*retval));
+    bumpCounter(counters.histogram[histogramBucket(ns)], 1);
+    if (err != kESErrOK) {
+        bumpCounter(counters.errors, 1);
+        recordErrorCode(counters, err);
+    }
+    return err;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Snapshots
+// ------------------------------------------------------------------------------------------------
+
+// Requires registryMutex to be held
+static std::vector<MergedExportStats> mergeThreadCounters() {
+    std::vector<MergedExportStats> merged(getExportCount());
+    for (const auto& block : threadCounters) {
+        for (size_t e = 0; e < merged.size(); e++) {
+            const ExportCounters& counters = block[e];
+            MergedExportStats& total = merged[e];
+            total.calls += counters.calls.load(std::memory_order_relaxed);
+            total.errors += counters.errors.load(std::memory_order_relaxed);
+            total.otherErrorCodes += counters.otherErrorCodes.load(std::memory_order_relaxed);
+            total.bytesIn += counters.bytesIn.load(std::memory_order_relaxed);
+            total.bytesOut += counters.bytesOut.load(std::memory_order_relaxed);
+            total.totalNs += counters.totalNs.load(std::memory_order_relaxed);
+            for (int s = 0; s < STATS_ERROR_CODE_SLOTS; s++) {
+                const uint64_t count = counters.errorCounts[s].load(std::memory_order_acquire);
+                if (count != 0) {
+                    total.errorCodes[counters.errorCodes[s].load(std::memory_order_relaxed)] += count;
+                }
+            }
+            for (int b = 0; b < HISTOGRAM_BUCKET_COUNT; b++) {
+                total.histogram[b] += counters.histogram[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return merged;
+}
+
+// Subtracts the totals from the last reset. Counters only grow, but a thread may be partway through updating one
+// export's counters, so clamp at zero rather than wrapping.
+static uint64_t sinceReset(uint64_t value, uint64_t baseline) {
+    return (value > baseline) ? value - baseline : 0;
+}
+
+static void subtractBaseline(MergedExportStats& stats, const MergedExportStats& baseline) {
+    stats.calls = sinceReset(stats.calls, baseline.calls);
+    stats.errors = sinceReset(stats.errors, baseline.errors);
+    stats.otherErrorCodes = sinceReset(stats.otherErrorCodes, baseline.otherErrorCodes);
+    stats.bytesIn = sinceReset(stats.bytesIn, baseline.bytesIn);
+    stats.bytesOut = sinceReset(stats.bytesOut, baseline.bytesOut);
+    stats.totalNs = sinceReset(stats.totalNs, baseline.totalNs);
+    for (auto& code : stats.errorCodes) {
+        auto base = baseline.errorCodes.find(code.first);
+        if (base != baseline.errorCodes.end()) {
+            code.second = sinceReset(code.second, base->second);
+        }
+    }
+    for (int b = 0; b < HISTOGRAM_BUCKET_COUNT; b++) {
+        stats.histogram[b] = sinceReset(stats.histogram[b], baseline.histogram[b]);
+    }
+}
+
+// Latency at or below which the given fraction of calls completed, as the upper bound of its bucket
+static uint64_t histogramPercentile(const MergedExportStats& stats, uint64_t histogramTotal, double fraction) {
+    if (histogramTotal == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(fraction * (double)histogramTotal + 0.999999);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKET_COUNT; b++) {
+        seen += stats.histogram[b];
+        if (seen >= target) {
+            return histogramBucketUpperBound(b);
+        }
+    }
+    return histogramBucketUpperBound(HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+static void appendJsonField(std::string& out, const char* name, uint64_t value, bool comma = true) {
+    if (comma) out += ",";
+    out += "\"";
+    out += name;
+    out += "\":";
+    out += std::to_string(value);
+}
+
+static void appendExportJson(std::string& out, const ExportEntry& entry, const MergedExportStats& stats) {
+
+    uint64_t histogramTotal = 0;
+    int highestBucket = -1;
+    for (int b = 0; b < HISTOGRAM_BUCKET_COUNT; b++) {
+        histogramTotal += stats.histogram[b];
+        if (stats.histogram[b] != 0) highestBucket = b;
+    }
+
+    out += "\"";
+    out.append(entry.name, entry.nameLength);
+    out += "\":{";
+    appendJsonField(out, "calls", stats.calls, false);
+    appendJsonField(out, "errors", stats.errors);
+    out += ",\"errorCodes\":{";
+    bool first = true;
+    for (const auto& code : stats.errorCodes) {
+        if (code.second == 0) continue;
+        if (!first) out += ",";
+        first = false;
+        out += "\"" + std::to_string(code.first) + "\":" + std::to_string(code.second);
+    }
+    out += "}";
+    appendJsonField(out, "otherErrorCodes", stats.otherErrorCodes);
+    appendJsonField(out, "bytesIn", stats.bytesIn);
+    appendJsonField(out, "bytesOut", stats.bytesOut);
+    appendJsonField(out, "totalNs", stats.totalNs);
+    appendJsonField(out, "meanNs", stats.calls ? stats.totalNs / stats.calls : 0);
+    appendJsonField(out, "p50Ns", histogramPercentile(stats, histogramTotal, 0.50));
+    appendJsonField(out, "p90Ns", histogramPercentile(stats, histogramTotal, 0.90));
+    appendJsonField(out, "p99Ns", histogramPercentile(stats, histogramTotal, 0.99));
+    appendJsonField(out, "maxNs", highestBucket >= 0 ? histogramBucketUpperBound(highestBucket) : 0);
+
+    // Non-empty buckets as [upper bound in ns, count]
+    out += ",\"histogram\":[";
+    first = true;
+    for (int b = 0; b < HISTOGRAM_BUCKET_COUNT; b++) {
+        if (stats.histogram[b] == 0) continue;
+        if (!first) out += ",";
+        first = false;
+        out += "[" + std::to_string(histogramBucketUpperBound(b)) + "," + std::to_string(stats.histogram[b]) + "]";
+    }
+    out += "]}";
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Returns the call counters and latencies recorded since the library was loaded or since resetStats.
+ * @param argv JavaScript arguments. Expects one string, the name of a single export to report (without its
+ *             signature), or an empty string for every export that has been called.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. A JSON string:
+ *               {"sinceResetMs":n, "threads":n, "exports":{"addTicks":{"calls":n, "errors":n, "errorCodes":{"10001":n},
+ *               "otherErrorCodes":n, "bytesIn":n, "bytesOut":n, "totalNs":n, "meanNs":n, "p50Ns":n, "p90Ns":n,
+ *               "p99Ns":n, "maxNs":n, "histogram":[[upperNs, count], ...]}, ...},
+ *               "resultMemory":{"pooledAllocations":n, "heapAllocations":n, "internedReturns":n}}
+ *               Percentiles and maxNs are the upper bounds of histogram buckets, so they can be up to 12.5% high.
+ * @return kESErrOK on success, kESErrCannotResolve if the named export doesn't exist, or an error code.
+ *
+ * JavaScript Usage: var json = externalLibrary.getStats("");
+ */
+THIO_EXPORT(getStats)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+    const char* filter = (argv[0].data.string != nullptr) ? argv[0].data.string : "";
+
+    size_t exportCount = 0;
+    const ExportEntry* table = getExportTable(exportCount);
+    const ExportEntry* only = nullptr;
+    if (filter[0] != '\0') {
+        only = findExport(filter, strlen(filter));
+        if (only == nullptr) return kESErrCannotResolve;
+    }
+
+    std::vector<MergedExportStats> merged;
+    ResultMemoryStats memory = getResultMemoryStats();
+    size_t threadCount = 0;
+    std::chrono::steady_clock::time_point since;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        merged = mergeThreadCounters();
+        if (!resetBaseline.empty()) {
+            for (size_t e = 0; e < merged.size(); e++) {
+                subtractBaseline(merged[e], resetBaseline[e]);
+            }
+        }
+        memory.pooledAllocations = sinceReset(memory.pooledAllocations, resetMemoryBaseline.pooledAllocations);
+        memory.heapAllocations = sinceReset(memory.heapAllocations, resetMemoryBaseline.heapAllocations);
+        memory.internedReturns = sinceReset(memory.internedReturns, resetMemoryBaseline.internedReturns);
+        threadCount = threadCounters.size();
+        since = resetTime;
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - since;
+    std::string json = "{";
+    appendJsonField(json, "sinceResetMs", (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), false);
+    appendJsonField(json, "threads", threadCount);
+    json += ",\"exports\":{";
+    bool first = true;
+    for (size_t e = 0; e < exportCount; e++) {
+        if (only != nullptr ? (&table[e] != only) : (merged[e].calls == 0)) {
+            continue;
+        }
+        if (!first) json += ",";
+        first = false;
+        appendExportJson(json, table[e], merged[e]);
+    }
+    json += "},\"resultMemory\":{";
+    appendJsonField(json, "pooledAllocations", memory.pooledAllocations, false);
+    appendJsonField(json, "heapAllocations", memory.heapAllocations);
+    appendJsonField(json, "internedReturns", memory.internedReturns);
+    json += "}}";
+
+    return setStringResult(retval, json);
+}
+
+/**
+ * @brief Starts the counters reported by getStats over from zero.
+ * @param argv JavaScript arguments. None.
+ * @param argc Argument count. Should be 0.
+ * @param retval Return value (not used here).
+ * @return kESErrOK.
+ *
+ * JavaScript Usage: externalLibrary.resetStats();
+ */
+THIO_EXPORT(resetStats)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    // Threads only ever write their own counters, so rather than clearing them, remember the current totals and
+    // subtract them from later snapshots
+    const ResultMemoryStats memory = getResultMemoryStats();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    resetBaseline = mergeThreadCounters();
+    resetMemoryBaseline = memory;
+    resetTime = std::chrono::steady_clock::now();
+    return kESErrOK;
+}
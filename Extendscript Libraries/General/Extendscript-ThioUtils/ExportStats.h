@@ -0,0 +1,43 @@
+#pragma once
+
+// ExportStats.h
+// Call counters and latency histograms for every export, so we can see how long scripts spend inside the library.
+//
+// Exports are defined with THIO_EXPORT instead of writing out the extern "C" signature. The macro defines the
+// exported symbol as a thin wrapper that times the real function and records, per export:
+//      - Number of calls, and how many times each error code was returned (kESErr* and THIO_ERR_*)
+//      - Bytes marshalled: string arguments and results by length, other values as 8 bytes
+//      - Latency in a log-linear histogram (HDR style, STATS_HISTOGRAM_SUB_BITS bits of precision per power of two)
+//
+// Each thread records into its own block of counters, which only that thread ever writes, so the hot path takes no
+// locks. getStats merges the blocks. Exports called through callBatch / callChunked are counted individually as well
+// as being part of the outer call's time.
+
+#include "ThioUtils.h"
+#include "SoSharedLibDefs.h"
+
+#define STATS_HISTOGRAM_SUB_BITS    3   // 8 buckets per power of two, so a reported latency is within 12.5%
+#define STATS_HISTOGRAM_MAX_BITS    40  // Latencies up to 2^40 ns (about 18 minutes) get their own bucket
+#define STATS_ERROR_CODE_SLOTS      8   // Distinct error codes tracked per export and thread, the rest are counted as "other"
+
+typedef long (*ExportImplementation)(TaggedData* argv, long argc, TaggedData* retval);
+
+/**
+ * @brief Calls an export's implementation and records its counters. Used by THIO_EXPORT, not meant to be called directly.
+ * @param statsIndex The export's index in the export table, or -1 to call it without recording anything.
+ */
+long callInstrumentedExport(int statsIndex, ExportImplementation implementation, TaggedData* argv, long argc, TaggedData* retval);
+
+// Looks up the export's index for callInstrumentedExport. Returns -1 if it isn't in the export table.
+int getExportStatsIndex(const char* name);
+
+// Defines an export. Use it in place of the return type and name:
+//      THIO_EXPORT(myFunction)(TaggedData* argv, long argc, TaggedData* retval) { ... }
+// The body becomes a static function named myFunction_impl, and myFunction itself is the exported wrapper.
+#define THIO_EXPORT(name) \
+    static long name##_impl(TaggedData* argv, long argc, TaggedData* retval); \
+    extern "C" THIOUTILS_API long name(TaggedData* argv, long argc, TaggedData* retval) { \
+        static const int statsIndex = getExportStatsIndex(#name); \
+        return callInstrumentedExport(statsIndex, name##_impl, argv, argc, retval); \
+    } \
+    static long name##_impl
@@ -0,0 +1,186 @@
+#pragma once
+
+// Exports.h
+// Declarations of every function exported to ExtendScript, and the table that registers them.
+// To add a new export:
+//      1. Define it in a .cpp file, either as a typed function bound with THIO_BIND_EXPORT (see ExportBinding.h):
+//              long myFunctionTyped(std::string& result, const char* text) { ... }
+//              THIO_BIND_EXPORT(myFunction, myFunctionTyped)
+//         or, when it needs the raw arguments, as:  THIO_EXPORT(myFunction)(TaggedData* argv, long argc, TaggedData* retval)
+//         Both define the extern "C" export and record its calls for getStats
+//      2. Declare it below, and for a typed export, declare the typed function at the bottom too
+//      3. Add it to exportTable in ThioUtils.cpp, with exportSignature<myFunctionTyped> or a hand-written signature.
+//         ESInitialize and callBatch both read from that table.
+
+#include "ThioUtils.h"
+#include "ExportBinding.h"
+#include "SoSharedLibDefs.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+extern "C" {
+    // ThioUtils.cpp
+    THIOUTILS_API void ESFreeMem(void* p);
+    THIOUTILS_API long systemBeep(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long playSoundAlias(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long copyTextToClipboard(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long getVersion(TaggedData* argv, long argc, TaggedData* retval);
+
+    // ClipboardWriter.cpp
+    THIOUTILS_API long copyTextToClipboardAsync(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long getClipboardStatus(TaggedData* argv, long argc, TaggedData* retval);
+
+    // SoundPlayer.cpp
+    THIOUTILS_API long preloadSound(TaggedData* argv, long argc, TaggedData* retval);
+
+    // EllipseFit.cpp
+    THIOUTILS_API long fitEllipse(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long fitEllipseBatch(TaggedData* argv, long argc, TaggedData* retval);
+
+    // TimeMath.cpp
+    THIOUTILS_API long ticksToFramesBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long framesToTicksBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long roundTicksToFrameBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long ticksToTimecodeBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long ticksToSecondsBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long addTicks(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long subtractTicks(TaggedData* argv, long argc, TaggedData* retval);
+
+    // BatchCall.cpp
+    THIOUTILS_API long callBatch(TaggedData* argv, long argc, TaggedData* retval);
+
+    // ResultMemory.cpp
+    THIOUTILS_API long callChunked(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long readResultChunk(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long releaseResult(TaggedData* argv, long argc, TaggedData* retval);
+
+    // Json.cpp
+    THIOUTILS_API long parseJson(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long parseJsonFile(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long getJsonError(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long recordsToJson(TaggedData* argv, long argc, TaggedData* retval);
+
+    // Sort.cpp
+    THIOUTILS_API long sortOrder(TaggedData* argv, long argc, TaggedData* retval);
+
+    // Keyframes.cpp
+    THIOUTILS_API long evaluateKeyframes(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long resampleKeyframes(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long simplifyKeyframes(TaggedData* argv, long argc, TaggedData* retval);
+
+    // TextSearch.cpp
+    THIOUTILS_API long compilePattern(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long releasePattern(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long patternTestBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long patternMatchBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long patternReplaceBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long patternSplitBatch(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long containsIgnoreCaseBatch(TaggedData* argv, long argc, TaggedData* retval);
+
+    // ResultCache.cpp
+    THIOUTILS_API long cacheOpen(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long cachePut(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long cacheGet(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long cacheInfo(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long cacheCompact(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long cacheClose(TaggedData* argv, long argc, TaggedData* retval);
+
+    // ProjectFile.cpp
+    THIOUTILS_API long readProjectFile(TaggedData* argv, long argc, TaggedData* retval);
+
+    // ProjectMetadata.cpp
+    THIOUTILS_API long extractMetadata(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long clearMetadataMemo(TaggedData* argv, long argc, TaggedData* retval);
+
+    // SessionStore.cpp
+    THIOUTILS_API long sessionSet(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long sessionGet(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long sessionGetBuffer(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long sessionDelete(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long sessionClear(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long sessionSetLimit(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long sessionInfo(TaggedData* argv, long argc, TaggedData* retval);
+
+    // ScriptBundle.cpp
+    THIOUTILS_API long getIncludeBundle(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long clearIncludeCache(TaggedData* argv, long argc, TaggedData* retval);
+
+    // FileBatch.cpp
+    THIOUTILS_API long statPaths(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long listFolder(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long reserveFileName(TaggedData* argv, long argc, TaggedData* retval);
+
+    // JobEngine.cpp
+    THIOUTILS_API long startJob(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long pollJob(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long cancelJob(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long getJobResult(TaggedData* argv, long argc, TaggedData* retval);
+
+    // ExportStats.cpp
+    THIOUTILS_API long getStats(TaggedData* argv, long argc, TaggedData* retval);
+    THIOUTILS_API long resetStats(TaggedData* argv, long argc, TaggedData* retval);
+}
+
+// One registered export: its name, its ExtendScript signature (e.g. "s", or "" for no arguments) and the function
+struct ExportEntry {
+    const char* name;
+    const char* signature;
+    ESFunction function;
+    size_t nameLength;
+
+    constexpr ExportEntry(const char* name, const char* signature, ESFunction function)
+        : name(name), signature(signature), function(function), nameLength(std::char_traits<char>::length(name)) {}
+};
+
+// Typed functions behind the THIO_BIND_EXPORT exports. The export table takes their signatures from these declarations.
+// TimeMath.cpp
+long ticksToFramesBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks, const char* timebase, long rounding);
+long framesToTicksBatchTyped(ScriptResult& result, const NumericSpan<long long>& frames, const char* timebase);
+long roundTicksToFrameBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks, const char* timebase);
+long ticksToTimecodeBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks, const char* timebase, bool dropFrame);
+long ticksToSecondsBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks);
+long addTicksTyped(std::string& result, const char* ticksA, const char* ticksB);
+long subtractTicksTyped(std::string& result, const char* ticksA, const char* ticksB);
+
+// Keyframes.cpp
+long evaluateKeyframesTyped(ScriptResult& result, const char* keys, const NumericSpan<long long>& ticks);
+long resampleKeyframesTyped(ScriptResult& result, const char* keys, const char* timebase);
+long simplifyKeyframesTyped(ScriptResult& result, const char* keys, double tolerance);
+
+// ProjectFile.cpp
+long readProjectFileTyped(ScriptResult& result, const char* path, const char* tables);
+
+// ProjectMetadata.cpp
+long extractMetadataTyped(ScriptResult& result, const char* nodeIds, const char* metadata, const char* fields);
+
+// SessionStore.cpp
+long sessionDeleteTyped(bool& result, const char* key);
+long sessionClearTyped(long& result, const char* prefix);
+long sessionSetLimitTyped(double& result, double bytes);
+long sessionInfoTyped(ScriptResult& result);
+
+// ScriptBundle.cpp
+long clearIncludeCacheTyped(long& result);
+
+// FileBatch.cpp
+long statPathsTyped(ScriptResult& result, const char* paths);
+long listFolderTyped(ScriptResult& result, const char* folder);
+long reserveFileNameTyped(std::string& result, const char* folder, const char* fileName, const char* numberFormat, bool create);
+
+// JobEngine.cpp
+long startJobTyped(long& jobId, const char* kind, const char* payload);
+long pollJobTyped(ScriptResult& result, long jobId);
+long cancelJobTyped(bool& cancelled, long jobId);
+
+/**
+ * @brief Returns the table of all registered exports (defined in ThioUtils.cpp).
+ * @param count Receives the number of entries.
+ */
+const ExportEntry* getExportTable(size_t& count);
+
+/**
+ * @brief Finds a registered export by its plain name, without the signature (e.g. "copyTextToClipboard").
+ * @return The entry, or nullptr if there's no export with that name.
+ */
+const ExportEntry* findExport(const char* name, size_t nameLength);
@@ -0,0 +1,404 @@
+#include "FileBatch.h"
+#include "Exports.h"
+#include "PackedData.h"
+#include "TextEncoding.h"
+#include "TextSearch.h"
+#include "ThioUtils.h"
+#include <new>        // For std::bad_alloc
+
+// Include platform specific headers
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+// ------------------------------------------------------------------------------------------------
+// Platform file access
+// ------------------------------------------------------------------------------------------------
+
+enum CreateResult {
+    kCreated,
+    kAlreadyExists,
+    kCreateFailed,
+};
+
+#ifdef _WIN32
+
+// FILETIME counts 100ns steps from 1601
+static double fileTimeToMilliseconds(const FILETIME& time) {
+    const int64_t ticks = (int64_t)(((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime);
+    return (double)(ticks - 116444736000000000LL) / 10000.0;
+}
+
+static void fillEntry(DWORD attributes, DWORD sizeHigh, DWORD sizeLow, const FILETIME& lastWrite, FileEntry& entry) {
+    entry.exists = true;
+    entry.isFolder = (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    entry.size = entry.isFolder ? 0 : (((uint64_t)sizeHigh << 32) | sizeLow);
+    entry.modified = fileTimeToMilliseconds(lastWrite);
+}
+
+bool statPath(const std::string& path, FileEntry& entry) {
+    entry = FileEntry();
+    std::wstring widePath;
+    if (!utf8ToWide(path.c_str(), path.size(), widePath)) return false;
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(widePath.c_str(), GetFileExInfoStandard, &attributes)) return false;
+    fillEntry(attributes.dwFileAttributes, attributes.nFileSizeHigh, attributes.nFileSizeLow, attributes.ftLastWriteTime, entry);
+    return true;
+}
+
+long listFolderEntries(const std::string& folder, bool details, std::vector<FileEntry>& entries) {
+    (void)details; // Sizes and times come with every entry here anyway
+    entries.clear();
+    std::wstring pattern;
+    if (!utf8ToWide(folder.c_str(), folder.size(), pattern)) return kESErrBadArgumentList;
+    if (!pattern.empty() && pattern.back() != L'\\' && pattern.back() != L'/') pattern += L'\\';
+    pattern += L'*';
+
+    // The basic info level skips the 8.3 names, and large fetches get many entries per request, which is what makes
+    // listing a network folder fast
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE) {
+        const DWORD error = GetLastError();
+        return (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND || error == ERROR_DIRECTORY) ? kESErrNoFile : kESErrIO;
+    }
+
+    try {
+        do {
+            const wchar_t* name = data.cFileName;
+            if (name[0] == L'.' && (name[1] == L'\0' || (name[1] == L'.' && name[2] == L'\0'))) continue;
+            entries.emplace_back();
+            FileEntry& entry = entries.back();
+            appendUtf16AsUtf8(reinterpret_cast<const char16_t*>(name), wcslen(name), entry.name);
+            fillEntry(data.dwFileAttributes, data.nFileSizeHigh, data.nFileSizeLow, data.ftLastWriteTime, entry);
+        } while (FindNextFileW(find, &data));
+    }
+    catch (...) {
+        FindClose(find);
+        throw;
+    }
+    const bool complete = GetLastError() == ERROR_NO_MORE_FILES;
+    FindClose(find);
+    return complete ? kESErrOK : kESErrIO;
+}
+
+static CreateResult createExclusive(const std::string& path) {
+    std::wstring widePath;
+    if (!utf8ToWide(path.c_str(), path.size(), widePath)) return kCreateFailed;
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        const DWORD error = GetLastError();
+        return (error == ERROR_FILE_EXISTS || error == ERROR_ALREADY_EXISTS) ? kAlreadyExists : kCreateFailed;
+    }
+    CloseHandle(file);
+    return kCreated;
+}
+
+#else
+
+static void fillEntry(const struct stat& info, FileEntry& entry) {
+    entry.exists = true;
+    entry.isFolder = S_ISDIR(info.st_mode);
+    entry.size = entry.isFolder ? 0 : (uint64_t)info.st_size;
+#ifdef __APPLE__
+    entry.modified = (double)info.st_mtimespec.tv_sec * 1000.0 + (double)(info.st_mtimespec.tv_nsec / 1000000);
+#else
+    entry.modified = (double)info.st_mtim.tv_sec * 1000.0 + (double)(info.st_mtim.tv_nsec / 1000000);
+#endif
+}
+
+bool statPath(const std::string& path, FileEntry& entry) {
+    entry = FileEntry();
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    fillEntry(info, entry);
+    return true;
+}
+
+long listFolderEntries(const std::string& folder, bool details, std::vector<FileEntry>& entries) {
+    entries.clear();
+    DIR* dir = opendir(folder.c_str());
+    if (dir == nullptr) {
+        return (errno == ENOENT || errno == ENOTDIR) ? kESErrNoFile : kESErrIO;
+    }
+    const int descriptor = dirfd(dir);
+
+    try {
+        while (true) {
+            errno = 0;
+            const struct dirent* found = readdir(dir);
+            if (found == nullptr) break;
+            const char* name = found->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+            entries.emplace_back();
+            FileEntry& entry = entries.back();
+            entry.name = name;
+            entry.exists = true;
+            // The entry's type usually comes with its name. Links and file systems that don't say need a stat.
+            const bool knownType = found->d_type == DT_DIR || found->d_type == DT_REG;
+            if (details || !knownType) {
+                struct stat info;
+                if (fstatat(descriptor, name, &info, 0) == 0) fillEntry(info, entry);
+            }
+            else {
+                entry.isFolder = found->d_type == DT_DIR;
+            }
+        }
+    }
+    catch (...) {
+        closedir(dir);
+        throw;
+    }
+    const bool complete = errno == 0;
+    closedir(dir);
+    return complete ? kESErrOK : kESErrIO;
+}
+
+static CreateResult createExclusive(const std::string& path) {
+    const int descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (descriptor < 0) {
+        return (errno == EEXIST) ? kAlreadyExists : kCreateFailed;
+    }
+    ::close(descriptor);
+    return kCreated;
+}
+
+#endif
+
+// ------------------------------------------------------------------------------------------------
+// Unique names
+// ------------------------------------------------------------------------------------------------
+
+static inline char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+static bool equalIgnoreCase(const char* a, const char* b, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (lowerAscii(a[i]) != lowerAscii(b[i])) return false;
+    }
+    return true;
+}
+
+static std::string joinPath(const std::string& folder, const std::string& name) {
+    std::string path;
+    path.reserve(folder.size() + 1 + name.size());
+    path += folder;
+    if (!path.empty() && path.back() != '/' && path.back() != '\\') path += PATH_SEPARATOR;
+    path += name;
+    return path;
+}
+
+long reserveFileName(const std::string& folder, const std::string& fileName, const std::string& numberFormat, bool create, std::string& path) {
+    const size_t placeholder = numberFormat.find(FILE_NUMBER_PLACEHOLDER);
+    if (fileName.empty() || fileName.find_first_of("/\\") != std::string::npos
+        || placeholder == std::string::npos || numberFormat.find(FILE_NUMBER_PLACEHOLDER, placeholder + 1) != std::string::npos
+        || numberFormat.find_first_of("/\\") != std::string::npos) {
+        return kESErrBadArgumentList;
+    }
+
+    // "clip.final.mp4" numbers as "clip.final (2).mp4". A name starting with its only dot has no extension.
+    size_t dot = fileName.rfind('.');
+    if (dot == 0) dot = std::string::npos;
+    const std::string stem = fileName.substr(0, dot);
+    const std::string extension = (dot == std::string::npos) ? std::string() : fileName.substr(dot);
+    const std::string head = stem + numberFormat.substr(0, placeholder);
+    const std::string tail = numberFormat.substr(placeholder + 1) + extension;
+
+    std::vector<FileEntry> entries;
+    long err = listFolderEntries(folder, false, entries);
+    if (err != kESErrOK) return err;
+
+    // Only numbers up to FIRST_FILE_NUMBER + entries can be taken by the entries, so the first free one is within them
+    bool plainTaken = false;
+    std::vector<bool> taken(entries.size() + 1, false);
+    for (const FileEntry& entry : entries) {
+        const std::string& name = entry.name;
+        if (name.size() == fileName.size() && equalIgnoreCase(name.data(), fileName.data(), name.size())) {
+            plainTaken = true;
+            continue;
+        }
+        if (name.size() <= head.size() + tail.size()
+            || !equalIgnoreCase(name.data(), head.data(), head.size())
+            || !equalIgnoreCase(name.data() + name.size() - tail.size(), tail.data(), tail.size())) {
+            continue;
+        }
+        const char* digits = name.data() + head.size();
+        const size_t digitCount = name.size() - head.size() - tail.size();
+        if (digitCount > 9 || digits[0] == '0') continue;
+        size_t number = 0;
+        bool numeric = true;
+        for (size_t i = 0; i < digitCount && numeric; i++) {
+            numeric = digits[i] >= '0' && digits[i] <= '9';
+            number = number * 10 + (size_t)(digits[i] - '0');
+        }
+        if (numeric && number >= FIRST_FILE_NUMBER && number - FIRST_FILE_NUMBER < taken.size()) {
+            taken[number - FIRST_FILE_NUMBER] = true;
+        }
+    }
+
+    // Candidates in order: the plain name, then each number the scan didn't find
+    bool tryPlain = !plainTaken;
+    size_t nextIndex = 0;
+    for (int attempt = 0; attempt < MAX_RESERVE_ATTEMPTS; attempt++) {
+        std::string name;
+        if (tryPlain) {
+            name = fileName;
+            tryPlain = false;
+        }
+        else {
+            while (nextIndex < taken.size() && taken[nextIndex]) nextIndex++;
+            name = head + std::to_string(FIRST_FILE_NUMBER + nextIndex) + tail;
+            nextIndex++;
+        }
+        path = joinPath(folder, name);
+        if (!create) return kESErrOK;
+
+        switch (createExclusive(path)) {
+        case kCreated:
+            return kESErrOK;
+        case kAlreadyExists:
+            continue; // Created since the scan
+        case kCreateFailed:
+            path.clear();
+            return kESErrIO;
+        }
+    }
+    path.clear();
+    return kESErrIO;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Exports
+// ------------------------------------------------------------------------------------------------
+
+// Appends the isFolder, size and modified columns. Sizes and times of missing paths are null.
+static void appendEntryColumns(std::string& out, const std::vector<FileEntry>& entries) {
+    out += "isFolder:[";
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i > 0) out += ',';
+        out += entries[i].isFolder ? "true" : "false";
+    }
+    out += "],size:[";
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i > 0) out += ',';
+        if (entries[i].exists) appendJsNumber(out, (double)entries[i].size);
+        else out += "null";
+    }
+    out += "],modified:[";
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i > 0) out += ',';
+        if (entries[i].exists) appendJsNumber(out, entries[i].modified);
+        else out += "null";
+    }
+    out += ']';
+}
+
+/**
+ * @brief Stats many paths at once.
+ * @param result Receives parallel arrays in path order: ({exists:[...], isFolder:[...], size:[...], modified:[...]}),
+ *               with size and modified (milliseconds since 1970, for new Date()) null for paths that don't exist.
+ * @param paths A string list (TextSearch.h) of paths.
+ * @return kESErrOK, kESErrConversion if the list has a bad escape, or THIO_ERR_NO_MEMORY.
+ *
+ * JavaScript Usage: var info = externalLibrary.statPaths("/Volumes/Footage/a.mov\n/Volumes/Footage/b.mov");
+ */
+long statPathsTyped(ScriptResult& result, const char* paths) {
+    try {
+        TextList list;
+        if (!parseTextList(paths, list)) return kESErrConversion;
+
+        std::vector<FileEntry> entries(list.size());
+        std::string path;
+        for (size_t i = 0; i < list.size(); i++) {
+            path.assign(list.data(i), list.length(i));
+            statPath(path, entries[i]);
+        }
+
+        std::string& out = result.script;
+        out.reserve(list.size() * 40 + 64);
+        out = "({exists:[";
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i > 0) out += ',';
+            out += entries[i].exists ? "true" : "false";
+        }
+        out += "],";
+        appendEntryColumns(out, entries);
+        out += "})";
+        return kESErrOK;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+THIO_BIND_EXPORT(statPaths, statPathsTyped)
+
+/**
+ * @brief Lists a folder with the size and modification time of each entry, in one call.
+ * @param result Receives parallel arrays: ({names:[...], isFolder:[...], size:[...], modified:[...]}), in the order the
+ *               file system gives them, without "." and "..".
+ * @param folder The folder's path.
+ * @return kESErrOK, kESErrNoFile if the folder doesn't exist, kESErrIO if it can't be read, or THIO_ERR_NO_MEMORY.
+ *
+ * JavaScript Usage: var listing = externalLibrary.listFolder(Folder.desktop.fsName);
+ */
+long listFolderTyped(ScriptResult& result, const char* folder) {
+    try {
+        std::vector<FileEntry> entries;
+        const long err = listFolderEntries(folder, true, entries);
+        if (err != kESErrOK) return err;
+
+        std::string& out = result.script;
+        out.reserve(entries.size() * 64 + 64);
+        out = "({names:[";
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i > 0) out += ',';
+            appendJsString(out, entries[i].name.c_str(), entries[i].name.size());
+        }
+        out += "],";
+        appendEntryColumns(out, entries);
+        out += "})";
+        return kESErrOK;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+THIO_BIND_EXPORT(listFolder, listFolderTyped)
+
+/**
+ * @brief Gets the path of the first free name in a folder, "name.ext", then "name (2).ext", "name (3).ext" and so on,
+ *        from one scan of the folder. With 'create', the file is created empty in the same call, so the name can't be
+ *        taken by anyone else before the script writes it.
+ * @param result Receives the path.
+ * @param folder The folder's path.
+ * @param fileName The name wanted, with its extension.
+ * @param numberFormat What goes before the extension, with # for the number, e.g. "_#". "" for " (#)".
+ * @param create Whether to create the file.
+ * @return kESErrOK, kESErrBadArgumentList for a name or format with a path separator or a format without exactly one #,
+ *         kESErrNoFile if the folder doesn't exist, kESErrIO if it can't be read or the file can't be created.
+ *
+ * JavaScript Usage: var path = externalLibrary.reserveFileName(folder.fsName, "Export.mp4", "", true);
+ */
+long reserveFileNameTyped(std::string& result, const char* folder, const char* fileName, const char* numberFormat, bool create) {
+    try {
+        return reserveFileName(folder, fileName, (*numberFormat != '\0') ? numberFormat : DEFAULT_FILE_NUMBER_FORMAT, create, result);
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+THIO_BIND_EXPORT(reserveFileName, reserveFileNameTyped)
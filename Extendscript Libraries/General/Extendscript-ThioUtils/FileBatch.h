@@ -0,0 +1,67 @@
+#pragma once
+
+// FileBatch.h
+// File system questions about many paths, answered in one call.
+//
+// Scripts find out about files one File object at a time: getFirstAvailableFileNamePath creates a File and checks
+// .exists for each numbered name until one is free, includeFile checks up to five paths, and scripts look for their
+// libraries folder by folder. Each of those is a round trip through ExtendScript and one file system request, which
+// adds up on network-mounted project folders. Here:
+//      statPaths       Stats a list of paths, for existence, folder or file, size and modification time.
+//      listFolder      Lists a folder with each entry's size and modification time. On Windows they come with the
+//                      names from one directory read (FindFirstFileEx with large fetches), with no request per entry.
+//      reserveFileName Finds the first free "name (N).ext" from one scan of the folder, and creates it exclusively, so
+//                      two scripts (or apps) asking at once never get the same name.
+//
+// Names are compared ignoring ASCII case when looking for taken numbers, as they would be on Windows and macOS, and on
+// network shares from them. On a case sensitive file system that can skip a number that was free, never reuse one.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where the number goes in reserveFileName's numberFormat, e.g. " (#)" for "name (2).ext"
+#define FILE_NUMBER_PLACEHOLDER '#'
+#define DEFAULT_FILE_NUMBER_FORMAT " (#)"
+
+// The first number tried once the plain name is taken, as File Explorer and Finder do
+#define FIRST_FILE_NUMBER 2
+
+// How many names reserveFileName tries to create after the scan before giving up. Only names created by someone else
+// since the scan make it try again.
+#define MAX_RESERVE_ATTEMPTS 1000
+
+struct FileEntry {
+    std::string name;           // Only for listings
+    bool exists = false;
+    bool isFolder = false;
+    uint64_t size = 0;          // 0 for folders
+    double modified = 0;        // Milliseconds since 1970 UTC, as Date.getTime() gives
+};
+
+/**
+ * @brief Gets a path's type, size and modification time. Links are followed, as File.exists does.
+ * @param path UTF-8, as ExtendScript passes it.
+ * @return false if nothing is there (or it can't be reached), with entry.exists false.
+ */
+bool statPath(const std::string& path, FileEntry& entry);
+
+/**
+ * @brief Lists the entries of a folder, without "." and "..", in the order the file system gives them.
+ * @param details Whether to get sizes and modification times too. Names and isFolder always come.
+ * @return kESErrOK, kESErrNoFile if the folder doesn't exist, or kESErrIO if it can't be read.
+ */
+long listFolderEntries(const std::string& folder, bool details, std::vector<FileEntry>& entries);
+
+/**
+ * @brief Finds the first name not taken in a folder: 'fileName' itself, then the name with numberFormat inserted before
+ *        the extension, counting up from FIRST_FILE_NUMBER.
+ * @param numberFormat Text with one FILE_NUMBER_PLACEHOLDER in it, like DEFAULT_FILE_NUMBER_FORMAT.
+ * @param create Whether to create the file (empty) to reserve the name. Without it the name is only free at the time
+ *        of the scan.
+ * @param path Receives the folder and name joined.
+ * @return kESErrOK, kESErrBadArgumentList for a bad fileName or numberFormat, kESErrNoFile if the folder doesn't exist,
+ *         or kESErrIO if it can't be read or the file can't be created.
+ */
+long reserveFileName(const std::string& folder, const std::string& fileName, const std::string& numberFormat, bool create, std::string& path);
@@ -0,0 +1,194 @@
+// CacheBench.cpp
+// Checks and benchmarks the result cache (ResultCache.cpp) and its compression (BlockCompression.cpp) on Linux.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/CacheBench.cpp *.cpp -o CacheBench -lpthread
+// Then run:
+//      ./CacheBench [projects, default 200] [working folder, default /tmp/ThioCacheBench]
+//
+// Each synthetic project is an empty .prproj file, with a few made-up results per project like the scripts would
+// store (JSON lists of sequences and packed clip times). The bench fills a cache, then times what a new script run
+// pays to start warm: opening the file and reading every result. It also checks that touching a project invalidates
+// its results, that a record cut short by a crash is dropped on the next open, that compaction keeps exactly the live
+// results, that a second open of the same file is refused, and that damaged compressed blocks are rejected.
+
+#include "ResultCache.h"
+#include "BlockCompression.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string makeSequencesJson(std::mt19937& random, int count) {
+    std::string json = "[";
+    for (int i = 0; i < count; i++) {
+        if (i > 0) json += ",";
+        json += "{\"name\":\"Sequence " + std::to_string(random() % 100) + "\",\"nodeId\":\"000f" + std::to_string(4000 + random() % 9000) +
+            "\",\"width\":1920,\"height\":1080,\"duration\":\"" + std::to_string(8475667200LL * (long long)(random() % 100000)) + "\"}";
+    }
+    return json + "]";
+}
+
+static std::string makeClipTimes(std::mt19937& random, int count) {
+    std::string packed;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) packed += ";";
+        const long long start = 8475667200LL * (long long)(random() % 200000);
+        packed += std::to_string(start) + "," + std::to_string(start + 8475667200LL * (long long)(1 + random() % 300)) + "," + std::to_string(random() % 8);
+    }
+    return packed;
+}
+
+static void touchFile(const std::string& path, int secondsAhead) {
+    // Sets the time explicitly, since a save within the same clock tick might not change it
+    struct timeval times[2];
+    gettimeofday(&times[0], nullptr);
+    times[0].tv_sec += secondsAhead;
+    times[1] = times[0];
+    utimes(path.c_str(), times);
+}
+
+static bool getValue(ResultCache& cache, const std::string& project, const std::string& kind, std::string& value) {
+    uint64_t modified = 0;
+    ResultCache::StoredValue stored;
+    if (!getFileModifiedTime(project.c_str(), modified) || !cache.find(project, modified, kind, stored)) {
+        return false;
+    }
+    value.resize(stored.valueLength);
+    return ResultCache::readValue(stored, &value[0]);
+}
+
+static void checkCompression(std::mt19937& random) {
+    std::vector<std::string> samples = { "", "a", "abcabcabcabcabcabc", std::string(100000, 'x'), makeSequencesJson(random, 300), makeClipTimes(random, 3000) };
+    std::string noise(50000, '\0');
+    for (char& c : noise) c = (char)random();
+    samples.push_back(noise);
+
+    std::string block, restored;
+    for (const std::string& sample : samples) {
+        compressBlock(sample.data(), sample.size(), block);
+        restored.assign(sample.size(), '\0');
+        check(decompressBlock(block.data(), block.size(), &restored[0], restored.size()) && restored == sample, "compressed block round trip");
+    }
+
+    // Damaged blocks must fail cleanly, never read or write out of bounds (build with -fsanitize=address to check)
+    const std::string& json = samples[4];
+    compressBlock(json.data(), json.size(), block);
+    std::vector<char> out(json.size());
+    for (int trial = 0; trial < 2000; trial++) {
+        std::string damaged = block;
+        damaged[random() % damaged.size()] ^= (char)(1 + random() % 255);
+        if (trial % 3 == 0) damaged.resize(random() % damaged.size());
+        decompressBlock(damaged.data(), damaged.size(), out.data(), out.size());
+    }
+    check(!decompressBlock(block.data(), block.size(), out.data(), out.size() - 1), "block with the wrong length is rejected");
+
+    printf("compression: sequences JSON %zu -> %zu bytes, clip times %zu -> %zu bytes\n",
+        json.size(), compressBlock(json.data(), json.size(), block), samples[5].size(), compressBlock(samples[5].data(), samples[5].size(), block));
+}
+
+int main(int argc, char** argv) {
+    const int projectCount = (argc > 1) ? atoi(argv[1]) : 200;
+    const std::string folder = (argc > 2) ? argv[2] : "/tmp/ThioCacheBench";
+    mkdir(folder.c_str(), 0755);
+    const std::string cachePath = folder + "/ResultCache.bin";
+    unlink(cachePath.c_str());
+
+    std::mt19937 random(5);
+    checkCompression(random);
+
+    // Synthetic projects and their results
+    std::vector<std::string> projects;
+    std::vector<std::vector<std::string>> values;
+    const std::vector<std::string> kinds = { "sequences", "clipTimes", "resolution" };
+    for (int p = 0; p < projectCount; p++) {
+        projects.push_back(folder + "/Project " + std::to_string(p) + ".prproj");
+        FILE* file = fopen(projects.back().c_str(), "wb");
+        if (file != nullptr) fclose(file);
+        values.push_back({ makeSequencesJson(random, 20 + random() % 40), makeClipTimes(random, 200 + random() % 800), "1920x1080" });
+    }
+
+    ResultCache cache;
+    check(cache.open(cachePath) == 0, "create cache");
+    auto start = std::chrono::steady_clock::now();
+    size_t valueBytes = 0;
+    for (int p = 0; p < projectCount; p++) {
+        uint64_t modified = 0;
+        getFileModifiedTime(projects[p].c_str(), modified);
+        for (size_t k = 0; k < kinds.size(); k++) {
+            check(cache.put(projects[p], modified, kinds[k], values[p][k].data(), values[p][k].size()) == 0, "put");
+            valueBytes += values[p][k].size();
+        }
+    }
+    const double putMs = millisecondsSince(start);
+    cache.close();
+
+    // What a new script run pays: open, then read everything
+    start = std::chrono::steady_clock::now();
+    check(cache.open(cachePath) == 0, "reopen cache");
+    const double openMs = millisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    std::string value;
+    for (int p = 0; p < projectCount; p++) {
+        for (size_t k = 0; k < kinds.size(); k++) {
+            check(getValue(cache, projects[p], kinds[k], value) && value == values[p][k], "warm read matches");
+        }
+    }
+    const double readMs = millisecondsSince(start);
+    ResultCache::Info info = cache.info();
+    printf("%d projects, %zu results: %.2f MB of values in a %.2f MB file\n", projectCount, info.liveRecords, valueBytes / 1048576.0, info.fileBytes / 1048576.0);
+    printf("put all %.2f ms, open %.3f ms, read all %.2f ms (%.1f us per result)\n", putMs, openMs, readMs, readMs * 1000 / info.liveRecords);
+
+    // A second instance can't open it while this one has it
+    ResultCache second;
+    check(second.open(cachePath) != 0, "second open is refused");
+
+    // Saving a project makes its results stale, and a newer put supersedes the old one
+    touchFile(projects[0], 10);
+    check(!getValue(cache, projects[0], "sequences", value), "touched project misses");
+    check(getValue(cache, projects[1], "sequences", value), "other projects still hit");
+    uint64_t modified = 0;
+    getFileModifiedTime(projects[0].c_str(), modified);
+    check(cache.put(projects[0], modified, "sequences", "[]", 2) == 0 && getValue(cache, projects[0], "sequences", value) && value == "[]", "put after touch");
+
+    // A record cut short by a crash is dropped on the next open, and the rest survive
+    const uint64_t goodBytes = cache.info().fileBytes;
+    check(cache.put(projects[2], 1, "partial", values[2][0].data(), values[2][0].size()) == 0, "put before truncation");
+    cache.close();
+    check(truncate(cachePath.c_str(), (off_t)(goodBytes + 100)) == 0, "cut the last record short");
+    check(cache.open(cachePath) == 0 && cache.info().fileBytes == goodBytes, "partial record dropped on open");
+    check(getValue(cache, projects[3], "clipTimes", value) && value == values[3][1], "records before it survive");
+
+    // Compaction keeps what's live for the current project files
+    const size_t liveBefore = cache.info().liveRecords;
+    uint64_t bytesFreed = 0;
+    check(cache.compact(bytesFreed) == 0, "compact");
+    info = cache.info();
+    // Touching projects[0] made its clipTimes and resolution results stale
+    check(info.liveRecords == liveBefore - 2 && info.records == info.liveRecords, "compaction drops stale and superseded records");
+    check(getValue(cache, projects[0], "sequences", value) && value == "[]", "compacted cache reads back");
+    check(getValue(cache, projects[projectCount - 1], "clipTimes", value) && value == values[projectCount - 1][1], "compacted cache reads back last project");
+    printf("compaction freed %llu bytes, %zu results left\n", (unsigned long long)bytesFreed, info.liveRecords);
+
+    cache.close();
+    return failures ? 1 : 0;
+}
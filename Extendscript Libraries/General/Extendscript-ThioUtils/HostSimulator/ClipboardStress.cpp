@@ -0,0 +1,318 @@
+// ClipboardStress.cpp
+// Test for the queued clipboard writes (ClipboardWriter.cpp) on Linux.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/ClipboardStress.cpp *.cpp -o ClipboardStress -lpthread
+// Then run:
+//      ./ClipboardStress
+// Add -fsanitize=thread (or address) to the build to check the queue for races.
+//
+// The worker writes to a MemoryClipboardBackend behind a gate, so the test can hold a write in progress while it
+// queues more text. It checks that text queued behind a write in progress replaces any text still waiting, that a
+// busy clipboard is retried until it frees up or the retry timeout passes, that the status of each ticket goes from
+// pending to its result, and that shutting down drops waiting text and lets the queue start again afterwards.
+
+#include "ClipboardWriter.h"
+#include "Exports.h"
+#include "ThioUtils.h"
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// MemoryClipboardBackend that can hold writes until it's opened, and records every attempt
+class GatedBackend : public MemoryClipboardBackend {
+public:
+    long setText(const char* utf8, size_t length) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        attempts++;
+        changed.notify_all();
+        changed.wait(lock, [&] { return open; });
+        const long result = MemoryClipboardBackend::setText(utf8, length);
+        if (result == kESErrOK) written.push_back(text);
+        return result;
+    }
+
+    void setOpen(bool isOpen) {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = isOpen;
+        changed.notify_all();
+    }
+
+    void setBusy(int count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        busyCount = count;
+    }
+
+    // Waits until at least 'count' writes have been attempted in total
+    bool waitForAttempts(int count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(5), [&] { return attempts >= count; });
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        attempts = 0;
+        written.clear();
+    }
+
+    int attemptCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return attempts;
+    }
+
+    std::vector<std::string> writtenTexts() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return written;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool open = true;
+    int attempts = 0;
+    std::vector<std::string> written;
+};
+
+static GatedBackend backend;
+
+static unsigned long queue(const std::string& text) {
+    return queueClipboardText(text.data(), text.size());
+}
+
+// Polls a ticket until its status stops being 'from', returning the new status
+static long waitWhile(unsigned long ticket, long from, int timeoutMs = 5000) {
+    const auto start = std::chrono::steady_clock::now();
+    long status;
+    while ((status = getClipboardWriteStatus(ticket)) == from && millisecondsSince(start) < timeoutMs) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return status;
+}
+
+static void checkImmediate() {
+    backend.reset();
+    check(writeClipboardText("now", 3) == kESErrOK, "immediate write succeeds");
+    check(backend.writtenTexts() == std::vector<std::string>{ "now" }, "immediate write reaches the backend");
+
+    backend.setBusy(1);
+    check(writeClipboardText("busy", 4) == THIO_ERR_CLIPBOARD_BUSY, "immediate write reports a busy clipboard without retrying");
+    check(backend.writtenTexts().size() == 1, "busy immediate write leaves the clipboard alone");
+}
+
+static void checkSupersede() {
+    backend.reset();
+    backend.setOpen(false);
+
+    // The first write is picked up by the worker and held inside the backend, so everything after it has to wait
+    const unsigned long first = queue("first");
+    check(first != 0, "queue returns a ticket");
+    check(backend.waitForAttempts(1), "worker starts the first write");
+    check(getClipboardWriteStatus(first) == CLIPBOARD_STATUS_PENDING, "write in progress is pending");
+
+    std::vector<unsigned long> tickets;
+    for (int i = 0; i < 100; i++) {
+        tickets.push_back(queue("text " + std::to_string(i)));
+    }
+    bool increasing = true;
+    for (size_t i = 1; i < tickets.size(); i++) increasing = increasing && tickets[i] > tickets[i - 1];
+    check(increasing && tickets[0] > first, "tickets increase");
+
+    bool superseded = true;
+    for (size_t i = 0; i + 1 < tickets.size(); i++) {
+        superseded = superseded && getClipboardWriteStatus(tickets[i]) == CLIPBOARD_STATUS_SUPERSEDED;
+    }
+    check(superseded, "text waiting behind a write is superseded by newer text");
+    check(getClipboardWriteStatus(tickets.back()) == CLIPBOARD_STATUS_PENDING, "newest queued text is pending");
+
+    backend.setOpen(true);
+    check(waitWhile(first, CLIPBOARD_STATUS_PENDING) == kESErrOK, "write in progress finishes");
+    check(waitWhile(tickets.back(), CLIPBOARD_STATUS_PENDING) == kESErrOK, "newest text is written");
+    check(backend.writtenTexts() == std::vector<std::string>({ "first", "text 99" }), "only the first and newest text are written, in order");
+
+    // An immediate write replaces queued text that hasn't been written yet, and lands after the write in progress
+    backend.reset();
+    backend.setOpen(false);
+    const unsigned long active = queue("active");
+    check(backend.waitForAttempts(1), "worker starts the write");
+    const unsigned long waiting = queue("waiting");
+    long immediateResult = -1;
+    std::thread immediate([&] { immediateResult = writeClipboardText("immediate", 9); });
+    check(waitWhile(waiting, CLIPBOARD_STATUS_PENDING) == CLIPBOARD_STATUS_SUPERSEDED, "immediate write supersedes waiting text");
+    backend.setOpen(true);
+    immediate.join();
+    check(immediateResult == kESErrOK, "immediate write succeeds behind the worker");
+    check(waitWhile(active, CLIPBOARD_STATUS_PENDING) == kESErrOK, "write in progress still finishes");
+    check(backend.writtenTexts() == std::vector<std::string>({ "active", "immediate" }), "immediate text lands last");
+}
+
+static void checkRetry() {
+    // A few busy attempts are retried with backoff, 2 + 4 + 8 ms
+    backend.reset();
+    backend.setBusy(3);
+    auto start = std::chrono::steady_clock::now();
+    const unsigned long retried = queue("retried");
+    check(waitWhile(retried, CLIPBOARD_STATUS_PENDING) == kESErrOK, "busy clipboard is retried until it's free");
+    const double retryMs = millisecondsSince(start);
+    check(backend.attemptCount() == 4, "three busy attempts, then the write");
+    check(retryMs >= 14, "retries back off");
+    check(backend.writtenTexts() == std::vector<std::string>{ "retried" }, "retried text is written");
+
+    // Newer text wakes the worker from its backoff, and the older text is given up
+    backend.reset();
+    backend.setBusy(1000000);
+    const unsigned long stale = queue("stale");
+    check(backend.waitForAttempts(3), "worker keeps retrying");
+    // Queued before the clipboard frees up, so the stale text can't get one last attempt in
+    start = std::chrono::steady_clock::now();
+    const unsigned long fresh = queue("fresh");
+    backend.setBusy(0);
+    check(waitWhile(fresh, CLIPBOARD_STATUS_PENDING) == kESErrOK, "newer text is written after a busy clipboard");
+    const double handoverMs = millisecondsSince(start);
+    check(getClipboardWriteStatus(stale) == CLIPBOARD_STATUS_SUPERSEDED, "text still being retried is superseded by newer text");
+    check(handoverMs < CLIPBOARD_RETRY_MAX_MS * 2, "newer text doesn't wait out the backoff");
+    check(backend.writtenTexts() == std::vector<std::string>{ "fresh" }, "only the newer text is written");
+
+    // A clipboard that stays busy gives up after the retry timeout with the backend's error
+    backend.reset();
+    backend.setBusy(1000000);
+    start = std::chrono::steady_clock::now();
+    const unsigned long stuck = queue("stuck");
+    const long stuckResult = waitWhile(stuck, CLIPBOARD_STATUS_PENDING, CLIPBOARD_RETRY_TIMEOUT_MS * 3);
+    const double stuckMs = millisecondsSince(start);
+    backend.setBusy(0);
+    check(stuckResult == THIO_ERR_CLIPBOARD_BUSY, "busy clipboard is reported after the retry timeout");
+    check(stuckMs >= CLIPBOARD_RETRY_TIMEOUT_MS, "retries last the full timeout");
+    check(backend.writtenTexts().empty(), "busy clipboard isn't written");
+
+    printf("%-34s %10.1f ms\n", "3 busy attempts", retryMs);
+    printf("%-34s %10.1f ms\n", "newer text during backoff", handoverMs);
+    printf("%-34s %10.1f ms\n", "busy until timeout", stuckMs);
+}
+
+static long callStatus(TaggedData ticket, long* status) {
+    TaggedData retval;
+    const long err = getClipboardStatus(&ticket, 1, &retval);
+    *status = (retval.type == kTypeInteger) ? retval.data.intval : 99999;
+    return err;
+}
+
+static void checkStatus() {
+    backend.reset();
+    check(getClipboardWriteStatus(0) == CLIPBOARD_STATUS_UNKNOWN, "ticket 0 is unknown");
+    check(getClipboardWriteStatus(ULONG_MAX) == CLIPBOARD_STATUS_UNKNOWN, "ticket never issued is unknown");
+
+    // The exports as ExtendScript calls them
+    TaggedData text;
+    text.type = kTypeString;
+    text.data.string = const_cast<char*>("from script");
+    TaggedData retval;
+    check(copyTextToClipboardAsync(&text, 1, &retval) == kESErrOK && retval.type == kTypeDouble, "copyTextToClipboardAsync returns a ticket");
+    const double ticket = retval.data.fltval;
+
+    TaggedData arg;
+    arg.type = kTypeDouble;
+    arg.data.fltval = ticket;
+    long status = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (callStatus(arg, &status) == kESErrOK && status == CLIPBOARD_STATUS_PENDING && millisecondsSince(start) < 5000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(status == kESErrOK, "getClipboardStatus reports the copy");
+    check(backend.writtenTexts() == std::vector<std::string>{ "from script" }, "script text is written");
+
+    arg.type = kTypeInteger;
+    arg.data.intval = (long)ticket;
+    check(callStatus(arg, &status) == kESErrOK && status == kESErrOK, "getClipboardStatus accepts an integer ticket");
+    arg.type = kTypeDouble;
+    arg.data.fltval = ticket + 0.5;
+    check(callStatus(arg, &status) == kESErrOK && status == CLIPBOARD_STATUS_UNKNOWN, "fractional ticket is unknown");
+    arg.data.fltval = -1;
+    check(callStatus(arg, &status) == kESErrOK && status == CLIPBOARD_STATUS_UNKNOWN, "negative ticket is unknown");
+    check(callStatus(text, &status) == kESErrTypeMismatch, "string ticket is rejected");
+    check(copyTextToClipboardAsync(&arg, 1, &retval) == kESErrTypeMismatch, "copying a number is rejected");
+
+    // Results are only remembered for the most recent tickets
+    const unsigned long old = queue("old");
+    waitWhile(old, CLIPBOARD_STATUS_PENDING);
+    for (int i = 0; i < 300; i++) {
+        writeClipboardText("x", 1);
+    }
+    check(getClipboardWriteStatus(old) == CLIPBOARD_STATUS_UNKNOWN, "old results are forgotten");
+}
+
+static void checkShutdown() {
+    backend.reset();
+    backend.setOpen(false);
+    const unsigned long active = queue("active");
+    check(backend.waitForAttempts(1), "worker starts the write");
+    const unsigned long waiting = queue("waiting");
+
+    // Shutdown waits for the write in progress, so it runs on its own thread while the gate is still closed
+    std::thread stopper(shutdownClipboardWriter);
+    check(waitWhile(waiting, CLIPBOARD_STATUS_PENDING) == CLIPBOARD_STATUS_SUPERSEDED, "shutdown drops waiting text");
+    backend.setOpen(true);
+    stopper.join();
+    check(getClipboardWriteStatus(active) == kESErrOK, "write in progress finishes before shutdown returns");
+    check(backend.writtenTexts() == std::vector<std::string>{ "active" }, "dropped text is never written");
+
+    // Shutting down resets the backend, and the queue starts again on the next write
+    setClipboardBackend(&backend);
+    backend.reset();
+    const unsigned long again = queue("again");
+    check(again != 0, "queue starts again after shutdown");
+    check(waitWhile(again, CLIPBOARD_STATUS_PENDING) == kESErrOK, "write after restart finishes");
+    check(backend.writtenTexts() == std::vector<std::string>{ "again" }, "write after restart reaches the backend");
+
+    // Shutdown with nothing queued, twice
+    shutdownClipboardWriter();
+    shutdownClipboardWriter();
+    setClipboardBackend(&backend);
+}
+
+static void timeQueue() {
+    // What the script pays per call, with the worker writing and superseding in the background
+    const int count = 100000;
+    const std::string text(200, 'x');
+    unsigned long last = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        last = queue(text);
+    }
+    const double elapsed = millisecondsSince(start);
+    check(waitWhile(last, CLIPBOARD_STATUS_PENDING) == kESErrOK, "last of many queued writes finishes");
+    printf("%-34s %10.3f us\n", "queueClipboardText", elapsed * 1000 / count);
+    printf("%-34s %10d of %d\n", "backend writes", backend.attemptCount(), count);
+}
+
+int main() {
+    setClipboardBackend(&backend);
+
+    checkImmediate();
+    checkSupersede();
+    checkRetry();
+    checkStatus();
+    checkShutdown();
+    timeQueue();
+
+    shutdownClipboardWriter();
+    printf(failures ? "%d failures\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
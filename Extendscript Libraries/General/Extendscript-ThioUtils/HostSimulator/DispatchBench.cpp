@@ -0,0 +1,140 @@
+// DispatchBench.cpp
+// Benchmarks what every export call pays before and after its own work: argument checks and conversion, storing the
+// result, the stats wrapper, and for callBatch, looking up each function by name.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/DispatchBench.cpp *.cpp -o DispatchBench -lpthread
+// Then run:
+//      ./DispatchBench [transition microseconds...]
+//
+// The exports timed here do almost nothing themselves (adding two tick strings, converting one tick value), so their
+// time is mostly dispatch. The callBatch rows run the same calls as one batch per 1000, which adds the parse and the
+// name lookup per call. The lookup row times findExport alone, averaged over every name in the export table.
+//
+// Natively a batched call costs more than a direct one, since it's parsed from text. What batching saves is
+// ExtendScript's own cost of each call into the library: finding the method on the ExternalObject, converting the
+// arguments to TaggedData and the result back to a JS value. That can't be measured outside the app, so the last table
+// models it as a busy wait of each given length per call into the library, default 0, 1, 5, 20 and 50 microseconds,
+// and runs 1000 addTicks calls directly and as one callBatch. It leaves out evaluating the batch's result script in
+// ExtendScript, which the direct calls don't need, and the break-even line is the transition cost above which the
+// batch is faster.
+
+#include "Exports.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+template <typename Function>
+static double bestNanosecondsPerCall(int calls, Function function) {
+    double best = 1e300;
+    for (int r = 0; r < 7; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++) function();
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls);
+    }
+    return best;
+}
+
+static void releaseResult(TaggedData& retval) {
+    if (retval.type == kTypeString || retval.type == kTypeScript) ESFreeMem(retval.data.string);
+}
+
+static double timeExport(ESFunction function, std::vector<TaggedData> args) {
+    return bestNanosecondsPerCall(200000, [&]() {
+        TaggedData retval;
+        if (function(args.data(), (long)args.size(), &retval) == kESErrOK) releaseResult(retval);
+    });
+}
+
+static double timeBatch(const std::string& line) {
+    std::string batch;
+    for (int i = 0; i < 1000; i++) {
+        if (i > 0) batch += "\n";
+        batch += line;
+    }
+    TaggedData arg;
+    arg.type = kTypeString;
+    arg.data.string = &batch[0];
+    return bestNanosecondsPerCall(200, [&]() {
+        TaggedData retval;
+        if (callBatch(&arg, 1, &retval) == kESErrOK) releaseResult(retval);
+    }) / 1000;
+}
+
+// Stands in for ExtendScript's work around one call into the library
+static void hostTransition(double nanoseconds) {
+    if (nanoseconds <= 0) return;
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() < nanoseconds) {}
+}
+
+// 1000 addTicks calls made directly and as one callBatch, with a modeled transition per call into the library
+static void compareWithTransition(const std::vector<double>& transitions, TaggedData a, TaggedData b, double direct, double batched) {
+    const int calls = 1000;
+    std::string batch;
+    for (int i = 0; i < calls; i++) {
+        if (i > 0) batch += "\n";
+        batch += "addTicks\ts914456685312000\ts8475667200";
+    }
+    TaggedData batchArg;
+    batchArg.type = kTypeString;
+    batchArg.data.string = &batch[0];
+
+    printf("\n%-28s %18s %18s %10s\n", "transition us per call", "1000 direct ms", "1 callBatch ms", "speedup");
+    for (double transition : transitions) {
+        const double transitionNs = transition * 1000;
+        const double directMs = bestNanosecondsPerCall(5, [&]() {
+            for (int i = 0; i < calls; i++) {
+                hostTransition(transitionNs);
+                TaggedData args[2] = { a, b }, retval;
+                if (addTicks(args, 2, &retval) == kESErrOK) releaseResult(retval);
+            }
+        }) / 1e6;
+        const double batchMs = bestNanosecondsPerCall(5, [&]() {
+            hostTransition(transitionNs);
+            TaggedData retval;
+            if (callBatch(&batchArg, 1, &retval) == kESErrOK) releaseResult(retval);
+        }) / 1e6;
+        printf("%-28.1f %18.3f %18.3f %9.1fx\n", transition, directMs, batchMs, directMs / batchMs);
+    }
+    printf("break-even transition: %.2f us per call (batched %.1f ns - direct %.1f ns, over %d calls)\n",
+        (batched - direct) * calls / (calls - 1) / 1000, batched, direct, calls);
+}
+
+int main(int argc, char** argv) {
+    std::string tickA = "914456685312000", tickB = "8475667200";
+    TaggedData a, b;
+    a.type = b.type = kTypeString;
+    a.data.string = &tickA[0];
+    b.data.string = &tickB[0];
+
+    printf("%-40s %10s\n", "call", "ns/call");
+    const double direct = timeExport(addTicks, { a, b });
+    printf("%-40s %10.1f\n", "addTicks", direct);
+    printf("%-40s %10.1f\n", "ticksToSecondsBatch (1 value)", timeExport(ticksToSecondsBatch, { a }));
+    printf("%-40s %10.1f\n", "addTicks, bad argument type", timeExport(addTicks, { a, TaggedData() }));
+    const double batched = timeBatch("addTicks\ts914456685312000\ts8475667200");
+    printf("%-40s %10.1f\n", "callBatch addTicks, per call", batched);
+    printf("%-40s %10.1f\n", "callBatch ticksToSecondsBatch, per call", timeBatch("ticksToSecondsBatch\ts914456685312000"));
+
+    size_t count = 0;
+    const ExportEntry* table = getExportTable(count);
+    std::vector<std::string> names;
+    for (size_t e = 0; e < count; e++) {
+        names.push_back(std::string(table[e].name, table[e].nameLength));
+    }
+    size_t found = 0;
+    const double lookup = bestNanosecondsPerCall(2000, [&]() {
+        for (const std::string& name : names) found += findExport(name.c_str(), name.size()) != nullptr;
+    }) / names.size();
+    printf("%-40s %10.1f  (%zu exports, %zu found)\n", "findExport, average over the table", lookup, names.size(), found / (7 * 2000));
+
+    std::vector<double> transitions;
+    for (int i = 1; i < argc; i++) transitions.push_back(atof(argv[i]));
+    if (transitions.empty()) transitions = { 0, 1, 5, 20, 50 };
+    compareWithTransition(transitions, a, b, direct, batched);
+    return 0;
+}
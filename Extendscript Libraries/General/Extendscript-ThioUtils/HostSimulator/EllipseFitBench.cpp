@@ -0,0 +1,207 @@
+// EllipseFitBench.cpp
+// Checks the native ellipse fit (EllipseFit.cpp) against the numeric.js version in Path-Points-To-Ellipse.jsx, and times it.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/EllipseFitBench.cpp *.cpp -o EllipseFitBench -lpthread
+// Then run:
+//      ./EllipseFitBench
+//
+// The expected results were recorded by running fitEllipse() from Scripts/Photoshop/Path-Points-To-Ellipse.jsx, with
+// Scripts/Photoshop/includes/numeric.js (1.2.6), under node on the same points. Each set goes through the fitEllipse
+// export on its own and through fitEllipseBatch all together, and both have to match the script to 1e-8 of the ellipse's
+// size. The script's angle can be a half turn off from the native one, which is the same ellipse, so angles are
+// compared modulo pi. Where the script fails (fewer than six points, or points on a line, where numeric.js throws)
+// the native fit must return null.
+
+#include "Exports.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what.c_str());
+        failures++;
+    }
+}
+
+struct Fit {
+    bool found;
+    double cx, cy, a, b, theta;
+};
+
+struct PointSet {
+    const char* name;
+    const char* points;     // Packed x0,y0,x1,y1,... as the script passes them
+    Fit expected;           // What the numeric.js version returned
+};
+
+static const PointSet pointSets[] = {
+    { "axis aligned",
+        "140,50,128.28,64.14,100,70,71.72,64.14,60,50,71.72,35.86,100,30,128.28,35.86",
+        true, 100.00000000000036, 50.000000000000007, 39.996979885984842, 19.998489942994752, 3.1415926535891563 },
+    { "rotated on a large canvas",
+        "1788.97,1135.25,1761.7,1161.35,1718,1175.11,1660.84,1175.58,1594.11,1162.75,1522.37,1137.48,1450.5,"
+        "1101.49,1383.4,1057.25,1325.64,1007.75,1281.17,956.38,1253,906.64,1243.06,861.91,1252.03,825.25,"
+        "1279.3,799.15,1323,785.39,1380.16,784.92,1446.89,797.75,1518.63,823.02,1590.5,859.01,1657.6,903.25,"
+        "1715.36,952.75,1759.83,1004.12,1788,1053.86,1797.94,1098.59",
+        true, 1520.5000000000466, 980.25000000002797, 310.00127186600071, 140.00023684610264, 0.52359435104906438 },
+    { "noisy",
+        "482.91,214.45,492.43,225.34,498.85,238.33,505.01,250.77,505.94,266.76,505.99,284.91,501.94,299.26,"
+        "494.34,318.07,488.27,331.62,475.52,349.35,463.92,362.77,451.41,375.05,435.96,384.81,418.47,395.56,"
+        "401.78,402.23,385.66,404.46,370.28,406.65,354.64,405.95,339.41,401.27,326.1,394.58,315.3,385.27,"
+        "307.69,375.71,301.4,363.46,295.28,348.52,293.44,333.72,294.02,317.28,300.1,300.93,303.24,282.8,"
+        "313.67,265.81,322.81,250.44,336.2,237.29,350.33,224.12,364.43,214.11,379.39,205.71,396.57,199.7,"
+        "414.04,196.04,430.98,193.01,444.1,193.52,460.08,198,472.06,204.46",
+        true, 399.91601272151621, 300.05820866068706, 120.35186937389712, 89.862596393033613, 2.3496383543859620 },
+    { "140 degree arc",
+        "72.3,186.68,54.46,188.44,33.41,180.65,10.6,164.48,-12.41,140.33,-34.77,109.02,-55.09,72.23,-73.45,"
+        "31.95,-88.12,-9.51,-97.93,-50.92,-103.18,-89.79,-103.3,-124.22",
+        true, -0.25676812946165684, 1.0574064763569639, 199.19474886527263, 79.497332513238248, 1.1980077804216673 },
+    { "six points",
+        "-62.93,102.41,-76.27,79.23,-63.83,52.84,-37.21,48.21,-24.37,70.17,-36.87,97.25",
+        true, -50.364925634663884, 75.116784202489612, 30.005196637711361, 24.804076603672858, 2.0399079849139405 },
+    { "tall",
+        "690.19,359.98,686.32,428.81,675.17,487.28,658.94,526.25,640.13,539.98,620.7,526.27,604.55,487.46,"
+        "593.66,428.74,590.07,360.13,593.77,291.12,604.74,232.65,621,193.82,640.08,179.83,659.29,193.89,"
+        "675.35,232.59,686.33,290.97",
+        true, 640.02750842179807, 360.00330410068784, 179.89529533291358, 50.079785890144755, 1.5716381116614015 },
+    { "many points",
+        "2906.29,759.19,2910.79,790.85,2909.06,824.95,2893.28,860.69,2870.69,897.51,2836.45,938.3,2796.69,"
+        "977.03,2744.51,1018.58,2690.56,1059.9,2626.84,1101.45,2553.27,1140.99,2480.36,1175.88,2396.41,"
+        "1213.64,2313.6,1247.86,2227.67,1280.51,2136.92,1312.34,2047.08,1336.25,1957.27,1361.38,1867.51,"
+        "1379.88,1781.21,1393.45,1693.75,1406.91,1615.05,1411.39,1537.24,1414.31,1466.66,1411.44,1405.02,"
+        "1405.73,1348.75,1399.48,1299.78,1384.3,1256.38,1364.41,1224.69,1344.4,1201.29,1318,1186.3,1288,"
+        "1182.6,1256.69,1188.6,1224.97,1202.57,1190.32,1226.48,1148.96,1260,1109.1,1299.4,1070.82,1351.45,"
+        "1031.05,1405.17,988.95,1470.8,949.39,1540.82,907.76,1617.3,872.34,1698.66,833.11,1780.91,798.46,"
+        "1869.11,767.95,1957.93,738.43,2047.82,710.11,2138.1,687,2229.68,670.67,2316.34,654.94,2402.32,643.72,"
+        "2482.81,635.67,2558.59,632.82,2625.85,633.24,2692.68,640.55,2750.03,651.79,2795.5,665.78,2839.32,"
+        "682.63,2871.22,703.5,2894.53,729.29",
+        true, 2048.1310419486963, 1024.1247122612699, 900.06457057551506, 300.13592605061899, 2.8418900988239937 },
+    { "collinear",
+        "0,0,1,1,2,2,3,3,4,4,5,5,6,6",
+        false, 0, 0, 0, 0, 0 },
+    { "five points",
+        "10,0,3.09,4.76,-8.09,2.94,-8.09,-2.94,3.09,-4.76",
+        false, 0, 0, 0, 0, 0 },
+};
+
+// Reads the results of a fitEllipse or fitEllipseBatch script: {cx:...,cy:...,a:...,b:...,theta:...} or null, in order
+static std::vector<Fit> parseFits(const char* script) {
+    static const char* const keys[] = { "cx:", "cy:", "a:", "b:", "theta:" };
+    std::vector<Fit> fits;
+    for (const char* p = script; *p != '\0';) {
+        if (strncmp(p, "null", 4) == 0) {
+            fits.push_back({ false, 0, 0, 0, 0, 0 });
+            p += 4;
+        }
+        else if (*p == '{') {
+            Fit fit = { true, 0, 0, 0, 0, 0 };
+            double* values[] = { &fit.cx, &fit.cy, &fit.a, &fit.b, &fit.theta };
+            for (int i = 0; i < 5; i++) {
+                const char* key = strstr(p, keys[i]);
+                if (key == nullptr) return fits;
+                char* end;
+                *values[i] = strtod(key + strlen(keys[i]), &end);
+                p = end;
+            }
+            fits.push_back(fit);
+        }
+        else {
+            p++;
+        }
+    }
+    return fits;
+}
+
+static bool sameFit(const Fit& fit, const Fit& expected) {
+    if (fit.found != expected.found) return false;
+    if (!fit.found) return true;
+    const double tolerance = 1e-8 * std::max(1.0, expected.a);
+    double angle = std::fmod(std::fabs(fit.theta - expected.theta), M_PI);
+    angle = std::min(angle, M_PI - angle);
+    return std::fabs(fit.cx - expected.cx) <= tolerance && std::fabs(fit.cy - expected.cy) <= tolerance &&
+        std::fabs(fit.a - expected.a) <= tolerance && std::fabs(fit.b - expected.b) <= tolerance && angle <= 1e-8;
+}
+
+static std::string describe(const Fit& fit) {
+    if (!fit.found) return "null";
+    char text[160];
+    snprintf(text, sizeof(text), "cx %.9g cy %.9g a %.9g b %.9g theta %.9g", fit.cx, fit.cy, fit.a, fit.b, fit.theta);
+    return text;
+}
+
+static long callExport(long (*function)(TaggedData*, long, TaggedData*), const std::string& argument, std::string& script) {
+    TaggedData arg, retval;
+    arg.type = kTypeString;
+    arg.data.string = const_cast<char*>(argument.c_str());
+    const long err = function(&arg, 1, &retval);
+    if (err == kESErrOK && retval.type == kTypeScript) {
+        script = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return err;
+}
+
+// Points around a rotated ellipse, a little off it, like the anchors of a hand drawn path
+static std::string makePoints(int count) {
+    std::string packed;
+    for (int i = 0; i < count; i++) {
+        const double t = 2 * M_PI * i / count;
+        const double x = 300 * std::cos(t), y = 120 * std::sin(t), wobble = std::sin(i * 12.9898) * 0.5;
+        if (i > 0) packed += ',';
+        packed += std::to_string(1000 + x * 0.8 - y * 0.6 + wobble) + ',' + std::to_string(700 + x * 0.6 + y * 0.8 - wobble);
+    }
+    return packed;
+}
+
+int main() {
+    const size_t setCount = sizeof(pointSets) / sizeof(pointSets[0]);
+    std::string batch, script;
+
+    for (const PointSet& set : pointSets) {
+        if (&set != pointSets) batch += ';';
+        batch += set.points;
+
+        check(callExport(fitEllipse, set.points, script) == kESErrOK, std::string("fitEllipse ") + set.name);
+        const std::vector<Fit> fits = parseFits(script.c_str());
+        check(fits.size() == 1, std::string("one result for ") + set.name);
+        if (fits.size() == 1) {
+            check(sameFit(fits[0], set.expected), std::string(set.name) + ": got " + describe(fits[0]) + ", numeric.js gave " + describe(set.expected));
+        }
+    }
+
+    check(callExport(fitEllipseBatch, batch, script) == kESErrOK, "fitEllipseBatch");
+    const std::vector<Fit> fits = parseFits(script.c_str());
+    check(fits.size() == setCount, "one fitEllipseBatch result per set");
+    for (size_t i = 0; i < fits.size() && i < setCount; i++) {
+        check(sameFit(fits[i], pointSets[i].expected), std::string("fitEllipseBatch ") + pointSets[i].name + ": got " + describe(fits[i]));
+    }
+
+    check(callExport(fitEllipse, "1,2,3", script) == kESErrBadArgumentList, "odd number of coordinates rejected");
+
+    printf("%8s %14s\n", "points", "us per fit");
+    for (int count : { 8, 64, 1024, 16384 }) {
+        const std::string points = makePoints(count);
+        const int repeats = std::max(20, 200000 / count);
+        double best = 1e300;
+        for (int round = 0; round < 5; round++) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; r++) callExport(fitEllipse, points, script);
+            best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats);
+        }
+        const std::vector<Fit> timed = parseFits(script.c_str());
+        check(timed.size() == 1 && timed[0].found && std::fabs(timed[0].a - 300) < 1 && std::fabs(timed[0].b - 120) < 1, "fit of the timed points");
+        printf("%8d %14.2f\n", count, best);
+    }
+
+    printf(failures ? "%d failures\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
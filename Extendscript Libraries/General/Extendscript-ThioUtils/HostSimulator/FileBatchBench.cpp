@@ -0,0 +1,289 @@
+// FileBatchBench.cpp
+// Checks and benchmarks the file system batch exports (FileBatch.h) on Linux, with large temporary folders.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/FileBatchBench.cpp *.cpp -o FileBatchBench -lpthread
+// Then run:
+//      ./FileBatchBench [files in the large folder, default 20000] [folder to make it in, default /tmp]
+// Pointing the second argument at a network mount shows what the round trips cost there.
+//
+// The checks cover statPaths on files, folders, missing paths and escaped names, listFolder's sizes and times against
+// stat, and reserveFileName's numbering: gaps, case, leading zeros, other formats, names without extensions, bad
+// arguments, and eight threads reserving the same name at once, which must all get different files.
+//
+// The timing fills a folder with "Export.mp4", "Export (2).mp4" ... and compares finding the next free name the way
+// getFirstAvailableFileNamePath did (one existence check per number until one is free) with reserveFileName's one
+// scan. Then statPaths over every file plus as many missing paths, against a stat per path, and listFolder. The
+// "before" loops run natively here, so they leave out the ExtendScript File object made for every check, which is
+// the larger cost in the apps.
+
+#include "Exports.h"
+#include "FileBatch.h"
+#include "TextEncoding.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void writeFile(const std::string& path, const std::string& contents) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        printf("Can't write %s\n", path.c_str());
+        exit(1);
+    }
+    fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+}
+
+static bool exists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+static bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+static std::string makeTemporaryFolder(const std::string& parent) {
+    std::string name = parent + "/FileBatchBench-XXXXXX";
+    if (mkdtemp(&name[0]) == nullptr) {
+        printf("Can't make a temporary folder in %s\n", parent.c_str());
+        exit(1);
+    }
+    return name;
+}
+
+// Deletes a folder this bench made, with the files in it (one level of subfolders)
+static void removeFolder(const std::string& folder) {
+    std::vector<FileEntry> entries;
+    listFolderEntries(folder, false, entries);
+    for (const FileEntry& entry : entries) {
+        const std::string path = folder + "/" + entry.name;
+        if (entry.isFolder) removeFolder(path);
+        else unlink(path.c_str());
+    }
+    rmdir(folder.c_str());
+}
+
+// Calls a string-argument export and returns its string or script result
+static long callExport(ESFunction function, std::vector<TaggedData> args, std::string& text) {
+    TaggedData retval;
+    const long err = function(args.data(), (long)args.size(), &retval);
+    text.clear();
+    if (err == kESErrOK && (retval.type == kTypeString || retval.type == kTypeScript)) {
+        text = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return err;
+}
+
+static TaggedData stringArg(const std::string& text) {
+    TaggedData arg;
+    arg.type = kTypeString;
+    arg.data.string = const_cast<char*>(text.c_str());
+    return arg;
+}
+
+static TaggedData boolArg(bool value) {
+    TaggedData arg;
+    arg.type = kTypeBool;
+    arg.data.intval = value ? 1 : 0;
+    return arg;
+}
+
+static std::string reserve(const std::string& folder, const std::string& fileName, const std::string& format, bool create, long* err = nullptr) {
+    std::string path;
+    const long result = reserveFileName(folder, fileName, format, create, path);
+    if (err != nullptr) *err = result;
+    return (result == kESErrOK) ? path.substr(folder.size() + 1) : std::string();
+}
+
+static void checkUtf16() {
+    const char16_t text[] = { u'a', 0x00E9, 0x4E2D, 0xD83C, 0xDFAC, 0xD800, u'z' }; // a, é, 中, 🎬, lone surrogate, z
+    std::string utf8;
+    const bool valid = appendUtf16AsUtf8(text, 7, utf8);
+    check(!valid && utf8 == "a\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x8E\xAC\xEF\xBF\xBDz", "UTF-16 to UTF-8");
+}
+
+static void checkStatAndList(const std::string& root) {
+    const std::string folder = root + "/stat";
+    mkdir(folder.c_str(), 0755);
+    mkdir((folder + "/sub").c_str(), 0755);
+    writeFile(folder + "/a.txt", "12345");
+    writeFile(folder + "/back\\slash.txt", "1");
+
+    // Paths go in as a string list, so the backslash is escaped
+    std::string text;
+    const std::string paths = folder + "/a.txt\n" + folder + "/sub\n" + folder + "/missing.txt\n" + folder + "/back\\\\slash.txt";
+    check(callExport(statPaths, { stringArg(paths) }, text) == kESErrOK, "statPaths");
+    check(contains(text, "exists:[true,true,false,true]") && contains(text, "isFolder:[false,true,false,false]"), "statPaths types");
+    check(contains(text, "size:[5,0,null,1]"), "statPaths sizes");
+    struct stat info;
+    stat((folder + "/a.txt").c_str(), &info);
+    const std::string modified = std::to_string((long long)info.st_mtim.tv_sec * 1000 + info.st_mtim.tv_nsec / 1000000);
+    check(contains(text, "modified:[" + modified + ","), "statPaths modification time");
+    check(callExport(statPaths, { stringArg("bad\\q") }, text) == kESErrConversion, "statPaths bad escape");
+
+    check(callExport(listFolder, { stringArg(folder) }, text) == kESErrOK, "listFolder");
+    check(contains(text, "\"a.txt\"") && contains(text, "\"sub\"") && contains(text, "\"back\\\\slash.txt\""), "listFolder names");
+    std::vector<FileEntry> entries;
+    listFolderEntries(folder, true, entries);
+    bool sizesMatch = entries.size() == 3;
+    for (const FileEntry& entry : entries) {
+        FileEntry stated;
+        statPath(folder + "/" + entry.name, stated);
+        sizesMatch = sizesMatch && stated.size == entry.size && stated.modified == entry.modified && stated.isFolder == entry.isFolder;
+    }
+    check(sizesMatch, "listFolder details match stat");
+    check(callExport(listFolder, { stringArg(folder + "/missing") }, text) == kESErrNoFile, "listFolder missing folder");
+}
+
+static void checkReserve(const std::string& root) {
+    const std::string folder = root + "/reserve";
+    mkdir(folder.c_str(), 0755);
+    const char* format = DEFAULT_FILE_NUMBER_FORMAT;
+
+    check(reserve(folder, "clip.mp4", format, false) == "clip.mp4", "free name kept");
+    check(reserve(folder, "clip.mp4", format, true) == "clip.mp4" && exists(folder + "/clip.mp4"), "free name created");
+    check(reserve(folder, "clip.mp4", format, true) == "clip (2).mp4", "first number");
+    writeFile(folder + "/clip (3).mp4", "");
+    writeFile(folder + "/CLIP (4).MP4", "");
+    writeFile(folder + "/clip (06).mp4", "");
+    writeFile(folder + "/clip (7).mp4", "");
+    check(reserve(folder, "clip.mp4", format, false) == "clip (5).mp4", "gaps, case and leading zeros");
+    mkdir((folder + "/clip (5).mp4").c_str(), 0755);
+    check(reserve(folder, "clip.mp4", format, false) == "clip (6).mp4", "folders take names too");
+
+    check(reserve(folder, "clip.final.mp4", format, true) == "clip.final.mp4", "only the last dot starts the extension");
+    check(reserve(folder, "clip.final.mp4", format, true) == "clip.final (2).mp4", "number before the last dot");
+    check(reserve(folder, "notes", format, true) == "notes" && reserve(folder, "notes", format, true) == "notes (2)", "no extension");
+    check(reserve(folder, ".hidden", format, true) == ".hidden" && reserve(folder, ".hidden", format, true) == ".hidden (2)", "leading dot");
+    check(reserve(folder, "clip.mp4", "_#", false) == "clip_2.mp4", "legacy format");
+
+    long err = 0;
+    reserve(folder, "clip.mp4", "no placeholder", false, &err);
+    check(err == kESErrBadArgumentList, "format without #");
+    reserve(folder, "clip.mp4", "(#)(#)", false, &err);
+    check(err == kESErrBadArgumentList, "format with two #");
+    reserve(folder, "sub/clip.mp4", format, false, &err);
+    check(err == kESErrBadArgumentList, "name with a separator");
+    reserve(folder + "/missing", "clip.mp4", format, false, &err);
+    check(err == kESErrNoFile, "missing folder");
+
+    // Through the export: "" for the default format, and the folder joined with one separator
+    std::string text;
+    check(callExport(reserveFileName, { stringArg(folder + "/"), stringArg("take.wav"), stringArg(""), boolArg(false) }, text) == kESErrOK
+        && text == folder + "/take.wav", "reserveFileName export");
+
+    // Eight threads after the same name at once each get their own file
+    const int threadCount = 8, perThread = 50;
+    std::vector<std::vector<std::string>> results(threadCount);
+    std::vector<std::thread> threads;
+    std::atomic<int> errors(0);
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < perThread; i++) {
+                std::string path;
+                if (reserveFileName(folder, "race.mov", format, true, path) != kESErrOK) errors++;
+                else results[t].push_back(path);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    std::set<std::string> distinct;
+    for (const auto& paths : results) distinct.insert(paths.begin(), paths.end());
+    check(errors == 0 && distinct.size() == (size_t)(threadCount * perThread), "concurrent reservations all different");
+    check(distinct.count(folder + "/race.mov") == 1 && distinct.count(folder + "/race (" + std::to_string(threadCount * perThread) + ").mov") == 1,
+          "concurrent reservations fill the numbers in order");
+}
+
+int main(int argc, char** argv) {
+    const int fileCount = (argc > 1) ? atoi(argv[1]) : 20000;
+    const std::string parent = (argc > 2) ? argv[2] : "/tmp";
+    const std::string root = makeTemporaryFolder(parent);
+
+    checkUtf16();
+    checkStatAndList(root);
+    checkReserve(root);
+
+    // Large folder: Export.mp4, Export (2).mp4 ... Export (fileCount).mp4, and as many other files
+    const std::string folder = root + "/large";
+    mkdir(folder.c_str(), 0755);
+    auto start = std::chrono::steady_clock::now();
+    writeFile(folder + "/Export.mp4", "x");
+    for (int i = 2; i <= fileCount; i++) writeFile(folder + "/Export (" + std::to_string(i) + ").mp4", "x");
+    for (int i = 0; i < fileCount; i++) writeFile(folder + "/Other_" + std::to_string(i) + ".wav", "x");
+    printf("Made %d files in %s in %.0f ms\n\n", fileCount * 2, folder.c_str(), millisecondsSince(start));
+
+    // Before: what getFirstAvailableFileNamePath did, one check per name until one is free
+    start = std::chrono::steady_clock::now();
+    std::string before = folder + "/Export.mp4";
+    int checks = 1;
+    for (int counter = 2; exists(before); counter++, checks++) {
+        before = folder + "/Export (" + std::to_string(counter) + ").mp4";
+    }
+    const double beforeMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::string after;
+    reserveFileName(folder, "Export.mp4", DEFAULT_FILE_NUMBER_FORMAT, true, after);
+    const double afterMs = millisecondsSince(start);
+    check(after == before && exists(after), "large folder: same name as checking one by one");
+
+    // statPaths over every file and as many missing ones, against a stat each
+    std::string pathList;
+    std::vector<std::string> paths;
+    for (int i = 0; i < fileCount; i++) {
+        paths.push_back(folder + "/Other_" + std::to_string(i) + ".wav");
+        paths.push_back(folder + "/Missing_" + std::to_string(i) + ".wav");
+    }
+    for (size_t i = 0; i < paths.size(); i++) pathList += (i ? "\n" : "") + paths[i];
+
+    start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (const std::string& path : paths) found += exists(path) ? 1 : 0;
+    const double statLoopMs = millisecondsSince(start);
+
+    std::string text;
+    start = std::chrono::steady_clock::now();
+    callExport(statPaths, { stringArg(pathList) }, text);
+    const double statPathsMs = millisecondsSince(start);
+    check(found == (size_t)fileCount && text.size() > paths.size() * 4, "large statPaths");
+
+    start = std::chrono::steady_clock::now();
+    callExport(listFolder, { stringArg(folder) }, text);
+    const double listMs = millisecondsSince(start);
+    std::vector<FileEntry> entries;
+    listFolderEntries(folder, false, entries);
+    check(entries.size() == (size_t)fileCount * 2 + 1, "large listFolder count");
+
+    printf("%-52s %10s\n", "", "ms");
+    printf("%-52s %10.2f\n", ("next free name, one check per name (" + std::to_string(checks) + " checks)").c_str(), beforeMs);
+    printf("%-52s %10.2f\n", "next free name, reserveFileName (one scan + create)", afterMs);
+    printf("%-52s %10.2f\n", ("stat " + std::to_string(paths.size()) + " paths one at a time").c_str(), statLoopMs);
+    printf("%-52s %10.2f\n", ("statPaths, " + std::to_string(paths.size()) + " paths").c_str(), statPathsMs);
+    printf("%-52s %10.2f\n", ("listFolder, " + std::to_string(entries.size()) + " entries with details").c_str(), listMs);
+
+    removeFolder(root);
+    printf(failures ? "\n%d failures\n" : "\nall checks passed\n", failures);
+    return failures ? 1 : 0;
+}
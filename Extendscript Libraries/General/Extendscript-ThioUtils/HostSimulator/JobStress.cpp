@@ -0,0 +1,245 @@
+// JobStress.cpp
+// Stress test for the background jobs (JobEngine.cpp) on Linux.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/JobStress.cpp *.cpp -o JobStress -lpthread
+// Then run:
+//      ./JobStress [jobs per round, default 5000] [working folder, default /tmp/ThioJobStress]
+// Add -fsanitize=thread (or address) to the build to check the queues and the job table for races.
+//
+// The rounds start thousands of short "call" jobs and check every result against the same command run directly,
+// cancel jobs at random while the workers race to run them, hash a large file and compare with a direct CRC, cancel a
+// hash partway through, and shut down with jobs still queued and running, then start again.
+
+#include "JobEngine.h"
+#include "BatchCall.h"
+#include "Checksum.h"
+#include "Exports.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Calls an export the way ExtendScript would, returning its error and any string or script result
+static long callExport(long (*function)(TaggedData*, long, TaggedData*), std::vector<TaggedData> args, TaggedData& retval, std::string* text = nullptr) {
+    const long err = function(args.data(), (long)args.size(), &retval);
+    if (err == kESErrOK && (retval.type == kTypeString || retval.type == kTypeScript)) {
+        if (text != nullptr) *text = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return err;
+}
+
+static TaggedData stringArg(const std::string& text) {
+    TaggedData arg;
+    arg.type = kTypeString;
+    arg.data.string = const_cast<char*>(text.c_str());
+    return arg;
+}
+
+static TaggedData idArg(long id) {
+    TaggedData arg;
+    arg.type = kTypeInteger;
+    arg.data.intval = id;
+    return arg;
+}
+
+static long start(const std::string& kind, const std::string& payload) {
+    TaggedData retval;
+    if (callExport(startJob, { stringArg(kind), stringArg(payload) }, retval) != kESErrOK) return 0;
+    return retval.data.intval;
+}
+
+static std::string poll(long id) {
+    TaggedData retval;
+    std::string status;
+    callExport(pollJob, { idArg(id) }, retval, &status);
+    return status;
+}
+
+static bool isFinished(const std::string& status) {
+    return status.find("\"queued\"") == std::string::npos && status.find("\"running\"") == std::string::npos;
+}
+
+static void waitFor(long id) {
+    while (!isFinished(poll(id))) std::this_thread::yield();
+}
+
+static std::string makeCommand(std::mt19937_64& random) {
+    return "addTicks\ts" + std::to_string((long long)(random() % 1000000) * 8475667200LL) + "\ts" + std::to_string((long long)(random() % 1000) * 10584000000LL);
+}
+
+static std::string runDirectly(const std::string& command) {
+    TaggedData result;
+    std::string expression;
+    if (runCommand(command.c_str(), result) == kESErrOK) appendBatchResult(expression, result);
+    return expression;
+}
+
+static void callRound(std::mt19937_64& random, int count) {
+    std::vector<long> ids;
+    std::vector<std::string> expected;
+    int matched = 0;
+    size_t fetched = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        const std::string command = makeCommand(random);
+        expected.push_back(runDirectly(command));
+        ids.push_back(start("call", command));
+        check(ids.back() != 0, "start call job");
+
+        // Fetch as it goes, since past MAX_JOBS unfetched results the oldest are dropped
+        if (ids.size() - fetched == 1000 || i == count - 1) {
+            for (; fetched < ids.size(); fetched++) {
+                waitFor(ids[fetched]);
+                TaggedData retval;
+                std::string result;
+                check(callExport(getJobResult, { idArg(ids[fetched]) }, retval, &result) == kESErrOK, "get call result");
+                if (result == expected[fetched]) matched++;
+            }
+        }
+    }
+    check(matched == count, "every call result matches running it directly");
+    printf("%d call jobs on %zu workers: %.1f ms (%.1f us per job, start to result)\n", count, getJobWorkerCount(),
+        millisecondsSince(begin), millisecondsSince(begin) * 1000 / count);
+
+    TaggedData retval;
+    check(callExport(getJobResult, { idArg(ids[0]) }, retval) == kESErrRange, "fetched job is gone");
+    const long nested = start("call", "startJob\tscall\tsaddTicks");
+    waitFor(nested);
+    check(callExport(getJobResult, { idArg(nested) }, retval) == kESErrBadAction, "a call job can't start jobs");
+    check(start("nope", "") == 0, "unknown kind is refused");
+}
+
+static void cancelRound(std::mt19937_64& random, int count) {
+    if (count > 4000) count = 4000; // Every result stays unfetched until the end, so keep under MAX_JOBS
+    std::vector<long> ids;
+    std::vector<std::string> expected;
+    std::vector<bool> cancelled(count, false);
+    for (int i = 0; i < count; i++) {
+        const std::string command = makeCommand(random);
+        expected.push_back(runDirectly(command));
+        ids.push_back(start("call", command));
+        // Cancel some of the earlier jobs while the workers are running them
+        if (i > 0 && random() % 2 == 0) {
+            const int target = (int)(random() % i);
+            if (cancelled[target]) continue;
+            TaggedData retval;
+            callExport(cancelJob, { idArg(ids[target]) }, retval);
+            cancelled[target] = true;
+            if (!retval.data.intval) ids[target] = 0; // It had finished, so the cancel discarded it
+        }
+    }
+
+    int done = 0, dropped = 0;
+    for (int i = 0; i < count; i++) {
+        if (ids[i] == 0) {
+            dropped++;
+            continue;
+        }
+        waitFor(ids[i]);
+        const std::string status = poll(ids[i]);
+        TaggedData retval;
+        std::string result;
+        const long err = callExport(getJobResult, { idArg(ids[i]) }, retval, &result);
+        if (cancelled[i]) {
+            check(status.find("\"cancelled\"") != std::string::npos, "cancelled job ends cancelled");
+            check(err == kESErrOK && retval.type == kTypeUndefined, "cancelled job has no result");
+            dropped++;
+        }
+        else {
+            check(status.find("\"done\"") != std::string::npos && err == kESErrOK && result == expected[i], "other jobs still finish");
+            done++;
+        }
+    }
+    printf("cancel race: %d done, %d cancelled or discarded\n", done, dropped);
+}
+
+static void hashRound(const std::string& folder) {
+    const std::string path = folder + "/media.bin";
+    std::vector<unsigned char> data(96 * 1024 * 1024 + 12345);
+    std::mt19937 random(3);
+    for (unsigned char& c : data) c = (unsigned char)random();
+    FILE* file = fopen(path.c_str(), "wb");
+    check(file != nullptr && fwrite(data.data(), 1, data.size(), file) == data.size(), "write test file");
+    if (file != nullptr) fclose(file);
+
+    char expected[64];
+    snprintf(expected, sizeof(expected), "({crc32:\"%08x\",bytes:%zu})", crc32Update(0, data.data(), data.size()), data.size());
+
+    const auto begin = std::chrono::steady_clock::now();
+    const long id = start("hashFile", path);
+    int polls = 0;
+    while (!isFinished(poll(id))) {
+        polls++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const double ms = millisecondsSince(begin);
+    TaggedData retval;
+    std::string result;
+    check(callExport(getJobResult, { idArg(id) }, retval, &result) == kESErrOK && result == expected, "hash matches a direct CRC");
+    printf("hashFile %.1f MB: %.1f ms (%.0f MB/s), polled %d times meanwhile\n", data.size() / 1048576.0, ms, data.size() / 1048576.0 / (ms / 1000), polls);
+
+    // Cancel partway through, once progress shows it's running
+    const long cancelId = start("hashFile", path);
+    std::string status;
+    while ((status = poll(cancelId)).find("\"running\"") == std::string::npos && !isFinished(status)) std::this_thread::yield();
+    callExport(cancelJob, { idArg(cancelId) }, retval);
+    waitFor(cancelId);
+    check(poll(cancelId).find("\"cancelled\"") != std::string::npos || !retval.data.intval, "running hash stops when cancelled");
+
+    const long missing = start("hashFile", folder + "/missing.bin");
+    waitFor(missing);
+    check(callExport(getJobResult, { idArg(missing) }, retval) == kESErrNoFile, "missing file fails the job");
+    remove(path.c_str());
+}
+
+static void shutdownRound(std::mt19937_64& random, int count) {
+    std::vector<long> ids;
+    for (int i = 0; i < count; i++) ids.push_back(start("call", makeCommand(random)));
+    const auto begin = std::chrono::steady_clock::now();
+    shutdownJobEngine();
+    printf("shutdown with %d jobs in flight: %.2f ms\n", count, millisecondsSince(begin));
+    check(getJobWorkerCount() == 0, "workers stopped");
+    check(poll(ids.back()) == "null", "jobs forgotten after shutdown");
+
+    // A later job starts the workers again
+    const long id = start("call", "addTicks\ts1\ts2");
+    waitFor(id);
+    TaggedData retval;
+    std::string result;
+    check(callExport(getJobResult, { idArg(id) }, retval, &result) == kESErrOK && result == runDirectly("addTicks\ts1\ts2"), "jobs run again after shutdown");
+}
+
+int main(int argc, char** argv) {
+    const int count = (argc > 1) ? atoi(argv[1]) : 5000;
+    const std::string folder = (argc > 2) ? argv[2] : "/tmp/ThioJobStress";
+    mkdir(folder.c_str(), 0755);
+
+    std::mt19937_64 random(11);
+    callRound(random, count);
+    cancelRound(random, count);
+    hashRound(folder);
+    shutdownRound(random, count);
+    shutdownJobEngine();
+
+    printf(failures ? "%d failures\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+// KeyframeBench.cpp
+// Benchmarks the keyframe exports (Keyframes.cpp) on long animations, and checks that simplified curves stay within
+// their tolerance.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/KeyframeBench.cpp *.cpp -o KeyframeBench -lpthread
+// Then run:
+//      ./KeyframeBench [minutes of animation, default 60]
+//
+// The curves are what dense tracks look like after tracking or a per-frame paste: a Position key on every frame of a
+// smooth path with tracking jitter, a Scale key on every frame of ramps and holds, and sparse bezier keys resampled
+// to a sequence's rate. Each row gives the keys in and out, the reduction, the time for the export call including
+// parsing the packed keys and building the result, and the largest error of the result at any input key.
+
+#include "Exports.h"
+#include "Keyframes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static const long long ticksPerFrame60 = 4237833600LL;  // 59.94 fps
+static const long long ticksPerFrame24 = 10594584000LL; // 23.976 fps
+
+static int failures = 0;
+
+static TaggedData stringArg(const std::string& text) {
+    TaggedData arg;
+    arg.type = kTypeString;
+    arg.data.string = const_cast<char*>(text.c_str());
+    return arg;
+}
+
+static TaggedData numberArg(double value) {
+    TaggedData arg;
+    arg.type = kTypeDouble;
+    arg.data.fltval = value;
+    return arg;
+}
+
+// Calls an export and returns its script result, and the best time over a few runs
+static std::string timeExport(ESFunction function, std::vector<TaggedData> args, double& milliseconds) {
+    std::string script;
+    milliseconds = 1e300;
+    for (int run = 0; run < 3; run++) {
+        TaggedData retval;
+        const auto start = std::chrono::steady_clock::now();
+        const long err = function(args.data(), (long)args.size(), &retval);
+        milliseconds = std::min(milliseconds, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        if (err != kESErrOK) {
+            printf("FAIL  export returned error %ld\n", err);
+            failures++;
+            return "";
+        }
+        script = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return script;
+}
+
+static void appendKey(std::string& packed, long long ticks, const double* value, int dimensions, int interpolation) {
+    if (!packed.empty()) packed += ";";
+    packed += std::to_string(ticks);
+    char number[32];
+    for (int d = 0; d < dimensions; d++) {
+        snprintf(number, sizeof(number), ",%.17g", value[d]);
+        packed += number;
+    }
+    packed += "," + std::to_string(interpolation);
+}
+
+// Reads a {ticks, values, interpolation} script back into a curve, for checking it
+static bool readCurveScript(const std::string& script, int dimensions, KeyframeCurve& curve) {
+    curve.keys.clear();
+    curve.dimensions = dimensions;
+    const size_t ticksStart = script.find("ticks:[") + 7, valuesStart = script.find("values:[") + 8, interpolationStart = script.find("interpolation:[") + 15;
+    const char* t = script.c_str() + ticksStart;
+    const char* v = script.c_str() + valuesStart;
+    const char* i = script.c_str() + interpolationStart;
+    while (*t != ']') {
+        Keyframe key = {};
+        key.ticks = strtoll(t + 1, const_cast<char**>(&t), 10);
+        t += (*t == '"') ? 1 : 0;
+        t += (*t == ',') ? 1 : 0;
+        v += (*v == '[') ? 1 : 0;
+        for (int d = 0; d < dimensions; d++) {
+            key.value[d] = strtod(v, const_cast<char**>(&v));
+            v += (*v == ']') ? 1 : 0;
+            v += (*v == ',') ? 1 : 0;
+        }
+        key.interpolation = (int)strtol(i, const_cast<char**>(&i), 10);
+        i += (*i == ',') ? 1 : 0;
+        curve.keys.push_back(key);
+    }
+    return !curve.keys.empty();
+}
+
+// Largest distance between the curve in 'result' and the keys of 'input', at the input's key times
+static double maxError(const KeyframeCurve& input, const KeyframeCurve& result) {
+    double worst = 0.0, value[KEYFRAME_MAX_DIMENSIONS];
+    for (const Keyframe& key : input.keys) {
+        evaluateKeyframeCurve(result, key.ticks, value);
+        double squared = 0.0;
+        for (int d = 0; d < input.dimensions; d++) squared += (key.value[d] - value[d]) * (key.value[d] - value[d]);
+        worst = std::max(worst, std::sqrt(squared));
+    }
+    return worst;
+}
+
+static void simplifyRow(const char* name, const std::string& packed, int dimensions, double tolerance) {
+    KeyframeCurve input, result;
+    parseKeyframeCurve(packed.c_str(), input);
+    double ms = 0;
+    const std::string script = timeExport(simplifyKeyframes, { stringArg(packed), numberArg(tolerance) }, ms);
+    if (!readCurveScript(script, dimensions, result)) return;
+
+    const double error = maxError(input, result);
+    printf("%-34s %9zu %9zu %8.2f%% %10.1f %12.3g\n", name, input.keys.size(), result.keys.size(),
+        100.0 * (1.0 - (double)result.keys.size() / input.keys.size()), ms, error);
+    if (error > tolerance * (1 + 1e-9)) {
+        printf("FAIL  %s: error %g is over the tolerance %g\n", name, error, tolerance);
+        failures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    const double minutes = (argc > 1) ? atof(argv[1]) : 60.0;
+    const long long frames60 = (long long)(minutes * 60 * 59.94);
+    std::mt19937 random(5);
+    std::normal_distribution<double> jitter(0.0, 0.0002);
+
+    // Position on every frame: a slow Lissajous path plus tracking jitter, in Premiere's 0-1 frame units
+    std::string position, scale;
+    for (long long f = 0; f < frames60; f++) {
+        const double seconds = f / 59.94;
+        const double point[2] = { 0.5 + 0.3 * std::sin(seconds * 0.21) + jitter(random), 0.5 + 0.2 * std::sin(seconds * 0.33 + 1) + jitter(random) };
+        appendKey(position, f * ticksPerFrame60, point, 2, KEYFRAME_LINEAR);
+
+        // Scale: 4 second ramps between random levels, then 6 second holds at them
+        const long long cycle = (long long)(seconds / 10);
+        const double phase = std::min(1.0, std::fmod(seconds, 10.0) / 4.0);
+        const double from = 100 + 10 * std::sin(cycle * 1.7), to = 100 + 10 * std::sin((cycle + 1) * 1.7);
+        const double level = from + (to - from) * phase;
+        appendKey(scale, f * ticksPerFrame60, &level, 1, KEYFRAME_LINEAR);
+    }
+
+    // Sparse bezier keys every two seconds, as someone would set by hand
+    std::string sparse;
+    for (long long k = 0; k <= (long long)(minutes * 30); k++) {
+        const double value = 50 + 40 * std::sin(k * 0.9);
+        appendKey(sparse, k * 2 * 254016000000LL, &value, 1, KEYFRAME_BEZIER);
+    }
+
+    printf("%-34s %9s %9s %9s %10s %12s\n", "curve", "keys in", "keys out", "removed", "ms", "max error");
+    simplifyRow("position, every frame, tol 0.001", position, 2, 0.001);
+    simplifyRow("position, every frame, tol 0.0002", position, 2, 0.0002);
+    simplifyRow("scale ramps and holds, tol 0.01", scale, 1, 0.01);
+
+    // Resample the sparse keys to 23.976, then simplify what that gives
+    double ms = 0;
+    const std::string resampledScript = timeExport(resampleKeyframes, { stringArg(sparse), stringArg(std::to_string(ticksPerFrame24)) }, ms);
+    KeyframeCurve sparseCurve, resampled;
+    parseKeyframeCurve(sparse.c_str(), sparseCurve);
+    readCurveScript(resampledScript, 1, resampled);
+    printf("%-34s %9zu %9zu %9s %10.1f %12s\n", "bezier keys resampled to 23.976", sparseCurve.keys.size(), resampled.keys.size(), "", ms, "");
+    std::string resampledPacked;
+    for (const Keyframe& key : resampled.keys) appendKey(resampledPacked, key.ticks, key.value, 1, key.interpolation);
+    simplifyRow("  then simplified, tol 0.05", resampledPacked, 1, 0.05);
+
+    // Evaluate the dense position track at 100000 random times
+    std::string times;
+    std::uniform_int_distribution<long long> anyTime(0, frames60 * ticksPerFrame60);
+    for (int i = 0; i < 100000; i++) times += (i ? "," : "") + std::to_string(anyTime(random));
+    timeExport(evaluateKeyframes, { stringArg(position), stringArg(times) }, ms);
+    printf("%-34s %9zu %9d %9s %10.1f %12s\n", "position evaluated at random times", (size_t)frames60, 100000, "", ms, "");
+
+    printf(failures ? "%d failures\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
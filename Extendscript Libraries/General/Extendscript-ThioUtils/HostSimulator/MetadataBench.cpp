@@ -0,0 +1,254 @@
+// MetadataBench.cpp
+// Benchmarks extractMetadata (ProjectMetadata.cpp) on project metadata like getProjectMetadata() returns, and checks
+// the columns it reads.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/MetadataBench.cpp *.cpp -o MetadataBench -lpthread
+// Then run:
+//      ./MetadataBench [items, default 5000]
+//
+// The rows compare the way getResolutionFromProjectItem read the XMP (find the start tag, then the end tag, then parse,
+// for each column and each item) with one extractMetadata call for all the items: the first time, when every item is
+// scanned, then again with the same XMP, when only hashes are computed, then with node ids only.
+
+#include "Exports.h"
+#include "ProjectMetadata.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void appendColumn(std::string& xmp, const char* name, const std::string& value) {
+    xmp += "\n         <premierePrivateProjectMetaData:";
+    xmp += name;
+    xmp += ">" + value + "</premierePrivateProjectMetaData:";
+    xmp += name;
+    xmp += ">";
+}
+
+// About the size and shape of a clip's project metadata: a few dozen columns, most of them not the ones read here
+static std::string makeXmp(int item) {
+    const std::string number = std::to_string(item);
+    std::string xmp = "<?xpacket begin=\"\xEF\xBB\xBF\" id=\"W5M0MpCehiHzreSzNTczkc9d\"?>\n<x:xmpmeta xmlns:x=\"adobe:ns:meta/\" x:xmptk=\"Adobe XMP Core 9.1-c002\">\n"
+        "   <rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">\n      <rdf:Description rdf:about=\"\"\n"
+        "            xmlns:premierePrivateProjectMetaData=\"http://ns.adobe.com/premierePrivateProjectMetaData/1.0/\">";
+    appendColumn(xmp, "Column.Intrinsic.Name", "A" + number + " &amp; B.mov");
+    appendColumn(xmp, "Column.Intrinsic.MediaType", (item % 10 == 9) ? "Still Image" : "Movie");
+    appendColumn(xmp, "Column.Intrinsic.MediaStart", "00;00;00;00");
+    appendColumn(xmp, "Column.Intrinsic.MediaEnd", "00;01;10;" + std::to_string(10 + item % 20));
+    appendColumn(xmp, "Column.Intrinsic.MediaDuration", "00;01;10;" + std::to_string(11 + item % 20));
+    for (const char* name : { "Column.Intrinsic.VideoInPoint", "Column.Intrinsic.VideoOutPoint", "Column.Intrinsic.VideoDuration",
+        "Column.Intrinsic.AudioInPoint", "Column.Intrinsic.AudioOutPoint", "Column.Intrinsic.AudioDuration" }) {
+        appendColumn(xmp, name, "00;00;12;" + std::to_string(item % 30));
+    }
+    appendColumn(xmp, "Column.Intrinsic.MediaTimebase", (item % 3 == 0) ? "29.97 fps" : "23.976 fps");
+    appendColumn(xmp, "Column.Intrinsic.VideoInfo", (item % 4 == 0) ? "3840 x 2160 (1.0)" : "1920 x 1080 (1.0)");
+    appendColumn(xmp, "Column.Intrinsic.AudioInfo", "48000 Hz - 32 bit - Stereo");
+    appendColumn(xmp, "Column.Intrinsic.VideoUsage", std::to_string(item % 5));
+    appendColumn(xmp, "Column.Intrinsic.AudioUsage", std::to_string(item % 5));
+    appendColumn(xmp, "Column.Intrinsic.TapeName", "");
+    appendColumn(xmp, "Column.Intrinsic.FilePath", "D:\\Footage\\Day " + std::to_string(item % 7) + "\\A" + number + " &amp; B.mov");
+    for (const char* name : { "Column.PropertyText.Description", "Column.PropertyText.Comment", "Column.PropertyText.LogNote",
+        "Column.PropertyText.Scene", "Column.PropertyText.Shot", "Column.PropertyBool.Good", "Column.PropertyText.Label" }) {
+        appendColumn(xmp, name, "");
+    }
+    appendColumn(xmp, "Column.Intrinsic.ProxyPath", "");
+    appendColumn(xmp, "Column.Intrinsic.VideoCodecType", "Apple ProRes 422 HQ");
+    appendColumn(xmp, "Column.Intrinsic.ColorSpace", "Rec. 709");
+    xmp += "\n      </rdf:Description>\n   </rdf:RDF>\n</x:xmpmeta>\n<?xpacket end=\"w\"?>";
+    return xmp;
+}
+
+// What the script did for each column: find the start tag and the end tag, take what's between, then parse it
+static std::string findColumnLikeScript(const std::string& xmp, const char* name) {
+    const std::string startTag = std::string("<premierePrivateProjectMetaData:") + name + ">";
+    const std::string endTag = std::string("</premierePrivateProjectMetaData:") + name + ">";
+    size_t start = xmp.find(startTag);
+    if (start == std::string::npos) return "";
+    start += startTag.size();
+    const size_t end = xmp.find(endTag, start);
+    return (end == std::string::npos) ? "" : xmp.substr(start, end - start);
+}
+
+static long callExtract(const std::string& ids, const std::string& metadata, const char* fields, std::string& script) {
+    ScriptResult result;
+    const long err = extractMetadataTyped(result, ids.c_str(), metadata.c_str(), fields);
+    script = result.script;
+    return err;
+}
+
+// Best time of a few calls. 'scanEveryTime' clears the memo before each, so every call scans.
+static double timeExtract(const std::string& ids, const std::string& metadata, bool scanEveryTime, std::string& script) {
+    double best = 1e300;
+    for (int run = 0; run < 5; run++) {
+        if (scanEveryTime) releaseMetadataMemo();
+        const auto start = std::chrono::steady_clock::now();
+        callExtract(ids, metadata, "videoInfo,frameRate,duration,mediaPath", script);
+        best = std::min(best, millisecondsSince(start));
+    }
+    return best;
+}
+
+// The number after "name:" in the stats of a result
+static long statOf(const std::string& script, const char* name) {
+    const size_t at = script.find(std::string(name) + ":", script.find("stats:"));
+    return (at == std::string::npos) ? -1 : atol(script.c_str() + at + strlen(name) + 1);
+}
+
+static void checkColumns() {
+    MediaMetadata m;
+    const std::string xmp = makeXmp(4);
+    extractMediaMetadata(xmp.data(), xmp.size(), m);
+    check(m.present == METADATA_FIELD_ALL, "every column found");
+    check(m.width == 3840 && m.height == 2160 && m.pixelAspect == 1.0, "video info");
+    check(std::fabs(m.frameRate - 23.976) < 1e-9, "frame rate");
+    check(m.duration == "00;01;10;15", "duration");
+    check(m.mediaPath == "D:\\Footage\\Day 4\\A4 & B.mov", "media path with an entity");
+    check(m.mediaType == "Movie", "media type");
+
+    const std::string attributes = "<rdf:Description xmlns:p=\"x\" p:Column.Intrinsic.VideoInfo=\"720 x 480 (0.9091)\"\n p:Column.Intrinsic.FilePath='C:\\a&apos;b.mov'/>";
+    extractMediaMetadata(attributes.data(), attributes.size(), m);
+    check(m.present == (METADATA_FIELD_VIDEO_INFO | METADATA_FIELD_MEDIA_PATH), "attribute form");
+    check(m.width == 720 && m.height == 480 && std::fabs(m.pixelAspect - 0.9091) < 1e-12, "attribute video info");
+    check(m.mediaPath == "C:\\a'b.mov", "attribute path");
+
+    const std::string audio = "<x><p:Column.Intrinsic.VideoInfo></p:Column.Intrinsic.VideoInfo><p:Column.Intrinsic.MediaTimebase>48000 Hz</p:Column.Intrinsic.MediaTimebase>"
+        "<p:Column.Intrinsic.VideoInfoExtra>1 x 1</p:Column.Intrinsic.VideoInfoExtra><p:Column.Intrinsic.VideoInfo/>Column.Intrinsic.FilePath</x>";
+    extractMediaMetadata(audio.data(), audio.size(), m);
+    check(m.present == METADATA_FIELD_FRAME_RATE && m.frameRate == 48000, "empty, self-closing and longer tags skipped");
+
+    const std::string noAspect = "<p:Column.Intrinsic.VideoInfo>1080 x 1920</p:Column.Intrinsic.VideoInfo>";
+    extractMediaMetadata(noAspect.data(), noAspect.size(), m);
+    check(m.present == METADATA_FIELD_VIDEO_INFO && m.width == 1080 && std::isnan(m.pixelAspect), "video info without aspect");
+
+    // Frame rates are parsed in place without strtod when they're plain decimals, and must come out the same
+    bool sameAsStrtod = true;
+    for (const char* rate : { "29.97 fps", "23.976 fps", "59.94", "0.1", "1234567.00000001", "7.", ".5", " 30 fps", "2.997e1 fps", "0x1E", "&#50;5 fps" }) {
+        const std::string text = std::string("<p:Column.Intrinsic.MediaTimebase>") + rate + "</p:Column.Intrinsic.MediaTimebase>";
+        extractMediaMetadata(text.data(), text.size(), m);
+        std::string decoded = rate;
+        if (decoded.compare(0, 5, "&#50;") == 0) decoded.replace(0, 5, "2");
+        sameAsStrtod = sameAsStrtod && m.present == METADATA_FIELD_FRAME_RATE && m.frameRate == strtod(decoded.c_str(), nullptr);
+    }
+    check(sameAsStrtod, "frame rates parse the same as strtod");
+
+    unsigned fields = 0;
+    check(parseMetadataFields("", fields) && fields == METADATA_FIELD_ALL, "all fields");
+    check(parseMetadataFields("videoInfo,mediaPath", fields) && fields == (METADATA_FIELD_VIDEO_INFO | METADATA_FIELD_MEDIA_PATH), "field list");
+    check(!parseMetadataFields("resolution", fields), "unknown field");
+}
+
+static void checkMemo() {
+    releaseMetadataMemo();
+    const std::string a = makeXmp(1), b = makeXmp(2), aChanged = makeXmp(4);
+    std::string script;
+    check(callExtract("n1\nn2", a + METADATA_ITEM_SEPARATOR + b, "videoInfo", script) == kESErrOK, "first call");
+    check(statOf(script, "parsed") == 2 && statOf(script, "hits") == 0, "first call scans");
+    check(script.find("width:[1920,1920]") != std::string::npos, "first call widths");
+
+    callExtract("n1\nn2\nn3", a + METADATA_ITEM_SEPARATOR + METADATA_ITEM_SEPARATOR, "videoInfo,mediaType", script);
+    check(statOf(script, "parsed") == 0 && statOf(script, "hits") == 2 && statOf(script, "missing") == 1, "repeat answered from memory");
+    check(script.find("found:[true,true,false]") != std::string::npos, "unknown node id not found");
+    check(script.find("mediaType:[\"Movie\",\"Movie\",null]") != std::string::npos, "remembered columns");
+
+    callExtract("n1", aChanged, "videoInfo", script);
+    check(statOf(script, "parsed") == 1 && script.find("width:[3840]") != std::string::npos, "changed metadata scanned again");
+
+    // Only the part the columns were read from is remembered. Past the last column a change is still a hit, but the
+    // text can't get shorter, and when a column is missing the whole text counts.
+    const std::string tail = "\n      </rdf:Description>";
+    std::string changedTail = aChanged;
+    changedTail.replace(changedTail.rfind(tail), tail.size(), "\n      </rdf:Description><!-- edited -->");
+    callExtract("n1", changedTail, "videoInfo", script);
+    check(statOf(script, "hits") == 1, "change after the last column read answered from memory");
+    callExtract("n1", aChanged.substr(0, aChanged.rfind(tail)), "videoInfo", script);
+    check(statOf(script, "hits") == 1, "text cut after the last column read answered from memory");
+    const std::string noType = "<p:Column.Intrinsic.VideoInfo>640 x 360</p:Column.Intrinsic.VideoInfo>";
+    callExtract("n4", noType, "", script);
+    callExtract("n4", noType + "<p:Column.Intrinsic.MediaType>Movie</p:Column.Intrinsic.MediaType>", "mediaType", script);
+    check(statOf(script, "parsed") == 1 && script.find("mediaType:[\"Movie\"]") != std::string::npos, "text added after a partial scan scanned again");
+    std::string changedPath = aChanged;
+    changedPath.replace(changedPath.find("Day 4"), 5, "Day 5");
+    callExtract("n1", changedPath, "mediaPath", script);
+    check(statOf(script, "parsed") == 1 && script.find("Day 5") != std::string::npos, "changed last column scanned again");
+
+    check(callExtract("n1\nn2", a, "", script) == kESErrBadArgumentList, "count mismatch");
+    check(callExtract("n1", a, "bogus", script) == kESErrBadArgumentList, "bad field");
+    releaseMetadataMemo();
+    callExtract("n1", "", "", script);
+    check(statOf(script, "missing") == 1, "cleared memo");
+}
+
+int main(int argc, char** argv) {
+    const int items = (argc > 1) ? atoi(argv[1]) : 5000;
+    checkColumns();
+    checkMemo();
+
+    std::vector<std::string> xmps;
+    std::string ids, metadata, emptyMetadata;
+    size_t xmpBytes = 0;
+    for (int i = 0; i < items; i++) {
+        xmps.push_back(makeXmp(i));
+        xmpBytes += xmps.back().size();
+        ids += (i ? "\n" : "") + std::to_string(0xF4240 + i);
+        if (i > 0) {
+            metadata += METADATA_ITEM_SEPARATOR;
+            emptyMetadata += METADATA_ITEM_SEPARATOR;
+        }
+        metadata += xmps.back();
+    }
+    printf("%d items, %.1f KB of XMP each\n\n", items, xmpBytes / 1024.0 / items);
+    printf("%-46s %10s %12s\n", "", "ms", "us per item");
+
+    // The script's way, for the four columns getResolutionFromProjectItem and friends read. Best of as many runs as
+    // timeExtract takes.
+    double ms = 1e300;
+    long checksum = 0;
+    for (int run = 0; run < 5; run++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::string& xmp : xmps) {
+            std::string info = findColumnLikeScript(xmp, "Column.Intrinsic.VideoInfo");
+            info = info.substr(0, info.find('('));
+            checksum += atol(info.c_str()) + atol(info.c_str() + info.find('x') + 1);
+            checksum += (long)atof(findColumnLikeScript(xmp, "Column.Intrinsic.MediaTimebase").c_str());
+            checksum += (long)findColumnLikeScript(xmp, "Column.Intrinsic.MediaDuration").size();
+            checksum += (long)findColumnLikeScript(xmp, "Column.Intrinsic.FilePath").size();
+        }
+        ms = std::min(ms, millisecondsSince(start));
+    }
+    printf("%-46s %10.2f %12.3f\n", "find start and end tag per column", ms, ms * 1000 / items);
+    check(checksum != 0, "baseline ran");
+
+    std::string script;
+    ms = timeExtract(ids, metadata, true, script);
+    printf("%-46s %10.2f %12.3f\n", "extractMetadata, first call (scans)", ms, ms * 1000 / items);
+    check(statOf(script, "parsed") == items, "first call scanned every item");
+
+    ms = timeExtract(ids, metadata, false, script);
+    printf("%-46s %10.2f %12.3f\n", "extractMetadata, same XMP again (hashes)", ms, ms * 1000 / items);
+    check(statOf(script, "hits") == items, "second call answered from memory");
+
+    ms = timeExtract(ids, emptyMetadata, false, script);
+    printf("%-46s %10.2f %12.3f\n", "extractMetadata, node ids only", ms, ms * 1000 / items);
+    check(statOf(script, "hits") == items, "node id lookups answered from memory");
+
+    printf(failures ? "\n%d failures\n" : "\nall checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,394 @@
+// ProjectFileBench.cpp
+// Checks and benchmarks the .prproj reader (ProjectFile.cpp) and its gzip decompression (Inflate.cpp) on Linux.
+//
+// Built against the library sources, with zlib only for writing the synthetic projects:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/ProjectFileBench.cpp *.cpp -o ProjectFileBench -lpthread -lz
+// Then run:
+//      ./ProjectFileBench [sequences, default 100] [real .prproj files to read as well...]
+//
+// The synthetic project has the object layout of a saved Premiere project: bins holding sequence project items,
+// sequences with video and audio track groups, clip track items with sub clips, clips, media sources and media,
+// transitions (which must not show up as track items), Motion components with animated Position on every tenth clip,
+// sequence markers as DVAMarker JSON, and property blobs as padding so the XML is about as large per clip as a real
+// project's. It's written both gzipped and as plain XML. The bench checks the row counts of every table, that both
+// files give the same tables, that entities in paths and marker comments are decoded, that sequences land in their
+// bins and nested sequences are found, and that a truncated or damaged file is rejected. Then it times the read and
+// shows how much memory it took next to the size of the XML. Before all that it reads projects with more and more clips
+// per track and checks that what the reader keeps for only the bins stays the same as the XML grows.
+//
+// Real project files given on the command line are read and their table sizes and timing printed, with no checks.
+
+#include "Exports.h"
+#include "ProjectFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+#include <zlib.h>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static long peakMemoryKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Writes the project to a gzip file and a plain file at once, so the XML never has to be in memory whole
+class ProjectWriter {
+public:
+    ProjectWriter(const std::string& gzipPath, const std::string& xmlPath) {
+        gzip = gzopen(gzipPath.c_str(), "wb6");
+        plain = fopen(xmlPath.c_str(), "wb");
+    }
+
+    ~ProjectWriter() {
+        flush();
+        gzclose(gzip);
+        fclose(plain);
+    }
+
+    ProjectWriter& operator<<(const std::string& text) {
+        buffer += text;
+        if (buffer.size() > (1 << 20)) flush();
+        return *this;
+    }
+
+    ProjectWriter& operator<<(long long number) { return *this << std::to_string(number); }
+
+private:
+    gzFile gzip;
+    FILE* plain;
+    std::string buffer;
+
+    void flush() {
+        gzwrite(gzip, buffer.data(), (unsigned)buffer.size());
+        fwrite(buffer.data(), 1, buffer.size(), plain);
+        buffer.clear();
+    }
+};
+
+struct Expected {
+    long bins = 0;
+    long sequences = 0;
+    long trackItems = 0;
+    long markers = 0;
+    long keyframes = 0;
+};
+
+static const long long ticksPerFrame = 8475667200LL; // 29.97 fps
+static const int videoTracks = 4, audioTracks = 4, mediaFiles = 500, binCount = 10;
+
+static std::string padding(long long seed) {
+    // Property blobs like the ones real projects have under Node/Properties
+    std::string text = "<Node Version=\"1\"><Properties Version=\"1\">";
+    for (int i = 0; i < 6; i++) {
+        text += "<MZ.Property" + std::to_string(i) + ">" + std::to_string(seed * 7919 + i * 104729) + ",0.5,true</MZ.Property" + std::to_string(i) + ">";
+    }
+    return text + "</Properties></Node>";
+}
+
+static Expected writeProject(const std::string& gzipPath, const std::string& xmlPath, int sequenceCount, int itemsPerTrack) {
+    Expected expected;
+    ProjectWriter out(gzipPath, xmlPath);
+    long long nextId = 1000;
+
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n<PremiereData Version=\"3\">\n";
+    out << "<!-- Synthetic project for ProjectFileBench > not a real one -->\n";
+    out << "<Project ObjectRef=\"1\"/>\n";
+    out << "<Project ObjectID=\"1\" ClassID=\"62ad66dd-0dcd-42da-a660-6d8fbde94876\" Version=\"40\">" << padding(1) << "<RootProjectItem ObjectURef=\"root\"/></Project>\n";
+
+    // Media, shared by the clips
+    for (int m = 0; m < mediaFiles; m++) {
+        out << "<VideoMediaSource ObjectID=\"" << (100000000LL + m) << "\"><MediaSource Version=\"2\"><Media ObjectURef=\"media-" << (long long)m << "\"/></MediaSource></VideoMediaSource>\n";
+        out << "<Media ObjectUID=\"media-" << (long long)m << "\" ClassID=\"7a5c103e-f3ac-4391-b6b4-7cc3d2f9a7ff\" Version=\"30\">" << padding(m)
+            << "<ActualMediaFilePath>D:\\Footage\\Day " << (long long)(m % 7) << "\\A" << (long long)m << " &amp; B&#233;.mov</ActualMediaFilePath>"
+            << "<FilePath>D:\\Old\\A" << (long long)m << ".mov</FilePath><Title>A" << (long long)m << ".mov</Title></Media>\n";
+    }
+
+    // Root and bins. Bin 0 holds the other bins, the sequences go round the bins.
+    out << "<RootProjectItem ObjectUID=\"root\" ClassID=\"1c307a89-9318-47d7-8b9d-a2c4cbd7e9ea\" Version=\"1\"><ProjectItemContainer Version=\"1\"><Items Version=\"1\">"
+        << "<Item Index=\"0\" ObjectURef=\"bin-0\"/></Items></ProjectItemContainer><ProjectItem Version=\"1\"><Name>Root Bin</Name></ProjectItem></RootProjectItem>\n";
+    for (int b = 0; b < binCount; b++) {
+        out << "<BinProjectItem ObjectUID=\"bin-" << (long long)b << "\" ClassID=\"dc63ca1a-4c5e-4a8f-b2f3-d9fb96fdb4c6\" Version=\"3\"><ProjectItemContainer Version=\"1\"><Items Version=\"1\">";
+        if (b == 0) {
+            for (int child = 1; child < binCount; child++) out << "<Item Index=\"" << (long long)child << "\" ObjectURef=\"bin-" << (long long)child << "\"/>";
+        }
+        for (int s = b; s < sequenceCount; s += binCount) out << "<Item ObjectURef=\"seqitem-" << (long long)s << "\"/>";
+        out << "</Items></ProjectItemContainer><ProjectItem Version=\"1\">" << padding(b) << "<Name>Bin " << (long long)b << " &lt;Cuts&gt;</Name></ProjectItem></BinProjectItem>\n";
+        expected.bins++;
+    }
+
+    for (int s = 0; s < sequenceCount; s++) {
+        const std::string sequenceUid = "seq-" + std::to_string(s);
+        const long long masterClipClip = nextId++, sequenceSource = nextId++;
+        out << "<ClipProjectItem ObjectUID=\"seqitem-" << (long long)s << "\"><ProjectItem Version=\"1\"><Name>Sequence " << (long long)s << "</Name></ProjectItem><MasterClip ObjectURef=\"seqmc-" << (long long)s << "\"/></ClipProjectItem>\n";
+        out << "<MasterClip ObjectUID=\"seqmc-" << (long long)s << "\"><Clips Version=\"1\"><Clip Index=\"0\" ObjectRef=\"" << masterClipClip << "\"/></Clips><Name>Sequence " << (long long)s << "</Name></MasterClip>\n";
+        out << "<VideoClip ObjectID=\"" << masterClipClip << "\"><Clip Version=\"18\"><Source ObjectRef=\"" << sequenceSource << "\"/></Clip></VideoClip>\n";
+        out << "<VideoSequenceSource ObjectID=\"" << sequenceSource << "\"><SequenceSource Version=\"4\"><Sequence ObjectURef=\"" << sequenceUid << "\"/></SequenceSource></VideoSequenceSource>\n";
+
+        // Track groups
+        const long long videoGroup = nextId++, audioGroup = nextId++, markerList = nextId++;
+        out << "<Sequence ObjectUID=\"" << sequenceUid << "\" ClassID=\"6a15d903-8739-11d5-af2d-9b7855ad8974\" Version=\"11\">" << padding(s)
+            << "<TrackGroups Version=\"1\"><TrackGroup Version=\"1\" Index=\"0\"><First>228ba1a1-5a5d-4d1f-a6b4-27fc0a6bb236</First><Second ObjectRef=\"" << videoGroup << "\"/></TrackGroup>"
+            << "<TrackGroup Version=\"1\" Index=\"1\"><First>80b8e3d5-6dca-4195-aefb-cb5f407ab009</First><Second ObjectRef=\"" << audioGroup << "\"/></TrackGroup></TrackGroups>"
+            << "<Name>Sequence " << (long long)s << "</Name><MarkerOwner Version=\"1\"><Markers ObjectRef=\"" << markerList << "\"/></MarkerOwner></Sequence>\n";
+        expected.sequences++;
+
+        out << "<Markers ObjectID=\"" << markerList << "\"><Markers Version=\"1\">";
+        for (int k = 0; k < 3; k++) {
+            out << "<DVAMarker>{&quot;DVAMarker&quot;:{&quot;mComment&quot;:&quot;Fix &amp; check \\&quot;this\\&quot;&quot;,&quot;mDuration&quot;:{&quot;ticks&quot;:0},"
+                << "&quot;mName&quot;:&quot;M" << (long long)k << "&quot;,&quot;mStartTime&quot;:{&quot;ticks&quot;:&quot;" << (k + 1) * 254016000000LL << "&quot;},&quot;mMarkerType&quot;:&quot;Comment&quot;}}</DVAMarker>";
+            expected.markers++;
+        }
+        out << "</Markers></Markers>\n";
+
+        for (int group = 0; group < 2; group++) {
+            const bool video = group == 0;
+            const int tracks = video ? videoTracks : audioTracks;
+            std::vector<long long> trackIds;
+            for (int t = 0; t < tracks; t++) trackIds.push_back(nextId++);
+
+            out << (video ? "<VideoTrackGroup" : "<AudioTrackGroup") << " ObjectID=\"" << (video ? videoGroup : audioGroup) << "\"><TrackGroup Version=\"1\"><Tracks Version=\"1\">";
+            for (int t = 0; t < tracks; t++) out << "<Track Index=\"" << (long long)t << "\" ObjectURef=\"track-" << trackIds[t] << "\"/>";
+            out << "</Tracks><FrameRate>" << ticksPerFrame << "</FrameRate></TrackGroup>" << (video ? "</VideoTrackGroup>\n" : "</AudioTrackGroup>\n");
+
+            for (int t = 0; t < tracks; t++) {
+                std::vector<long long> items, transitions;
+                for (int i = 0; i < itemsPerTrack; i++) items.push_back(nextId++);
+                transitions.push_back(nextId++);
+
+                out << (video ? "<VideoClipTrack" : "<AudioClipTrack") << " ObjectUID=\"track-" << trackIds[t] << "\"><ClipTrack Version=\"1\"><ClipItems Version=\"3\"><TrackItems Version=\"1\">";
+                for (int i = 0; i < itemsPerTrack; i++) out << "<TrackItem Index=\"" << (long long)i << "\" ObjectRef=\"" << items[i] << "\"/>";
+                out << "</TrackItems></ClipItems><TransitionItems Version=\"1\"><TrackItems Version=\"1\"><TrackItem Index=\"0\" ObjectRef=\"" << transitions[0] << "\"/></TrackItems></TransitionItems>"
+                    << "<Track Version=\"1\"><ID>" << (long long)(t + 1) << "</ID></Track></ClipTrack>" << (video ? "</VideoClipTrack>\n" : "</AudioClipTrack>\n");
+
+                out << "<VideoTransitionTrackItem ObjectID=\"" << transitions[0] << "\"><TransitionTrackItem Version=\"6\"><TrackItem Version=\"4\"><Start>0</Start><End>"
+                    << 30 * ticksPerFrame << "</End></TrackItem></TransitionTrackItem></VideoTransitionTrackItem>\n";
+
+                for (int i = 0; i < itemsPerTrack; i++) {
+                    const long long subClip = nextId++, clip = nextId++, chain = nextId++, motion = nextId++, position = nextId++, scale = nextId++;
+                    const long long start = (long long)i * 150 * ticksPerFrame;
+                    const bool nested = video && t == videoTracks - 1 && i == 0 && s > 0;
+                    const bool animated = video && i % 10 == 0;
+                    const int media = (s * 31 + t * 7 + i) % mediaFiles;
+                    long long source = 100000000LL + media;
+                    if (nested) {
+                        // A nested copy of the previous sequence
+                        source = nextId++;
+                        out << "<VideoSequenceSource ObjectID=\"" << source << "\"><SequenceSource Version=\"4\"><Sequence ObjectURef=\"seq-" << (long long)(s - 1) << "\"/></SequenceSource></VideoSequenceSource>\n";
+                    }
+
+                    out << (video ? "<VideoClipTrackItem" : "<AudioClipTrackItem") << " ObjectID=\"" << items[i] << "\" ClassID=\"368b0406-29f1-4a1a-8b2c-6a4b6d8f5b3f\" Version=\"8\"><ClipTrackItem Version=\"8\">"
+                        << "<ComponentOwner Version=\"1\"><Components ObjectRef=\"" << chain << "\"/></ComponentOwner>"
+                        << "<TrackItem Version=\"4\"><Start>" << start << "</Start><End>" << start + 120 * ticksPerFrame << "</End></TrackItem>"
+                        << "<SubClip ObjectRef=\"" << subClip << "\"/></ClipTrackItem>" << (video ? "</VideoClipTrackItem>\n" : "</AudioClipTrackItem>\n");
+                    out << "<SubClip ObjectID=\"" << subClip << "\"><Clip ObjectRef=\"" << clip << "\"/><Name>A" << (long long)media << ".mov</Name></SubClip>\n";
+                    out << (video ? "<VideoClip" : "<AudioClip") << " ObjectID=\"" << clip << "\"><Clip Version=\"18\">" << padding(clip) << "<Source ObjectRef=\"" << source << "\"/><InPoint>"
+                        << (long long)(i % 5) * ticksPerFrame << "</InPoint></Clip>" << (video ? "</VideoClip>\n" : "</AudioClip>\n");
+
+                    out << "<VideoComponentChain ObjectID=\"" << chain << "\"><ComponentChain Version=\"3\"><Components Version=\"1\"><Component Index=\"0\" ObjectRef=\"" << motion << "\"/></Components></ComponentChain></VideoComponentChain>\n";
+                    out << "<VideoFilterComponent ObjectID=\"" << motion << "\"><Component Version=\"7\"><Params Version=\"1\"><Param Index=\"0\" ObjectRef=\"" << position << "\"/><Param Index=\"1\" ObjectRef=\"" << scale << "\"/></Params></Component><MatchName>AE.ADBE Motion</MatchName></VideoFilterComponent>\n";
+                    out << "<VideoComponentParam ObjectID=\"" << position << "\"><StartKeyframe>-91445760000000000,0.5:0.5,0,0,0,0,0,0</StartKeyframe><Name>Position</Name>";
+                    if (animated) {
+                        out << "<Keyframes>";
+                        for (int k = 0; k < 60; k++) out << start + k * 2 * ticksPerFrame << "," << std::to_string(0.5 + k * 0.001) << ":0.5,0,0,0,0,0,0;";
+                        out << "</Keyframes><IsTimeVarying>true</IsTimeVarying>";
+                        expected.keyframes++;
+                    }
+                    out << "</VideoComponentParam>\n";
+                    out << "<VideoComponentParam ObjectID=\"" << scale << "\"><StartKeyframe>-91445760000000000,100.,0,0,0,0,0,0</StartKeyframe><Name>Scale</Name></VideoComponentParam>\n";
+                    expected.trackItems++;
+                }
+            }
+        }
+    }
+    out << "</PremiereData>\n";
+    return expected;
+}
+
+// Number of elements in the array that follows 'column' in the result, e.g. "trackItems:{sequence:["
+static long countColumn(const std::string& script, const char* column) {
+    const size_t start = script.find(column);
+    if (start == std::string::npos) return -1;
+    const size_t open = start + strlen(column);
+    const size_t close = script.find(']', open);
+    if (close == open) return 0;
+    long count = 1;
+    for (size_t i = open; i < close; i++) count += script[i] == ',';
+    return count;
+}
+
+// Number of elements in a numeric column that aren't -1
+static long countLinked(const std::string& script, const char* column) {
+    const size_t start = script.find(column);
+    if (start == std::string::npos) return -1;
+    long count = 0;
+    for (const char* p = script.c_str() + start + strlen(column); *p != ']';) {
+        char* end;
+        count += strtol(p, &end, 10) != -1;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+// A number from the stats, e.g. "keptBytes:"
+static long long statValue(const std::string& script, const char* name) {
+    const size_t start = script.find(name, script.find("stats:{"));
+    return (start == std::string::npos) ? -1 : atoll(script.c_str() + start + strlen(name));
+}
+
+// Everything but the stats, which include the file size
+static std::string withoutStats(const std::string& script) {
+    return script.substr(0, script.find("stats:{"));
+}
+
+static long readProject(const std::string& path, std::string& script, double& milliseconds, const char* tables = "") {
+    TaggedData args[2], retval;
+    args[0].type = kTypeString;
+    args[0].data.string = const_cast<char*>(path.c_str());
+    args[1].type = kTypeString;
+    args[1].data.string = const_cast<char*>(tables);
+    const auto start = std::chrono::steady_clock::now();
+    const long err = readProjectFile(args, 2, &retval);
+    milliseconds = millisecondsSince(start);
+    if (err == kESErrOK) {
+        script = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return err;
+}
+
+static void printTables(const char* name, const std::string& script, double milliseconds) {
+    printf("%-28s bins %6ld  sequences %5ld  track items %7ld  markers %6ld  keyframes %6ld  %9.1f ms\n", name,
+        countColumn(script, "bins:{name:["), countColumn(script, "sequences:{id:["), countColumn(script, "trackItems:{sequence:["),
+        countColumn(script, "markers:{sequence:["), countColumn(script, "keyframes:{trackItem:["), milliseconds);
+}
+
+static long long fileSize(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    fseeko(file, 0, SEEK_END);
+    const long long size = ftello(file);
+    fclose(file);
+    return size;
+}
+
+// Reads the same bins and sequences with more and more clips per track, so only the XML grows. What the reader keeps
+// for "bins" must not grow with it, and for "sequences" (a reference per clip) must stay small next to it. This runs first, before the larger
+// reads below raise the peak memory.
+static void checkMemory(int sequenceCount) {
+    const std::string gzipPath = "/tmp/ProjectFileBench-memory.prproj", xmlPath = "/tmp/ProjectFileBench-memory.xml";
+    printf("%-12s %9s %18s %18s %18s %16s\n", "clips/track", "XML MB", "bins kept KB", "sequences kept KB", "all kept KB", "bins peak +MB");
+
+    long long firstBinsBytes = -1, binsBytes = 0, sequencesBytes = 0, plainBytes = 0;
+    long binsPeakGrowth = 0;
+    for (int itemsPerTrack : { 5, 20, 80 }) {
+        writeProject(gzipPath, xmlPath, sequenceCount, itemsPerTrack);
+        plainBytes = fileSize(xmlPath);
+        std::string bins, sequences, all;
+        double ms;
+        const long memoryBefore = peakMemoryKb();
+        check(readProject(gzipPath, bins, ms, "bins") == kESErrOK, "reading only the bins");
+        const long binsPeak = peakMemoryKb() - memoryBefore;
+        binsPeakGrowth = std::max(binsPeakGrowth, binsPeak);
+        check(readProject(gzipPath, sequences, ms, "sequences") == kESErrOK, "reading only the sequences");
+        check(readProject(gzipPath, all, ms) == kESErrOK, "reading every table");
+        check(countColumn(bins, "bins:{name:[") == binCount && countColumn(sequences, "sequences:{id:[") == sequenceCount, "tables read alone");
+        check(sequences.find("videoTracks:[4,4,4") != std::string::npos, "tracks counted without track items");
+
+        binsBytes = statValue(bins, "keptBytes:");
+        sequencesBytes = statValue(sequences, "keptBytes:");
+        if (firstBinsBytes < 0) firstBinsBytes = binsBytes;
+        printf("%-12d %9.1f %18.1f %18.1f %18.1f %16.1f\n", itemsPerTrack, plainBytes / 1e6, binsBytes / 1e3, sequencesBytes / 1e3,
+            statValue(all, "keptBytes:") / 1e3, binsPeak / 1024.0);
+    }
+    check(binsBytes == firstBinsBytes, "memory kept for the bins doesn't grow with the XML");
+    check(sequencesBytes < plainBytes / 20, "memory kept for the sequences is under 5% of the XML");
+    check(binsPeakGrowth < 8 * 1024, "peak memory reading the bins grows less than 8 MB");
+    remove(gzipPath.c_str());
+    remove(xmlPath.c_str());
+}
+
+int main(int argc, char** argv) {
+    const int sequenceCount = (argc > 1) ? atoi(argv[1]) : 100;
+    const std::string gzipPath = "/tmp/ProjectFileBench.prproj", xmlPath = "/tmp/ProjectFileBench.xml";
+
+    checkMemory(20);
+    const Expected expected = writeProject(gzipPath, xmlPath, sequenceCount, 25);
+    const long long gzipBytes = fileSize(gzipPath), plainBytes = fileSize(xmlPath);
+    printf("synthetic project: %d sequences, %.1f MB gzipped, %.1f MB of XML\n", sequenceCount, gzipBytes / 1e6, plainBytes / 1e6);
+
+    const long memoryBefore = peakMemoryKb();
+    std::string gzipScript, plainScript;
+    double gzipMs = 1e300, plainMs = 1e300, ms;
+    for (int run = 0; run < 3; run++) {
+        check(readProject(gzipPath, gzipScript, ms) == kESErrOK, "reading the gzipped project");
+        gzipMs = std::min(gzipMs, ms);
+    }
+    const long memoryAfter = peakMemoryKb();
+    check(readProject(xmlPath, plainScript, ms) == kESErrOK, "reading the plain XML project");
+    plainMs = ms;
+
+    printTables("gzipped", gzipScript, gzipMs);
+    printTables("plain XML", plainScript, plainMs);
+    printf("%.0f MB/s of XML from gzip, %.0f MB/s plain. Peak memory grew %.1f MB while reading, the result is %.1f MB\n",
+        plainBytes / 1e3 / gzipMs, plainBytes / 1e3 / plainMs, (memoryAfter - memoryBefore) / 1024.0, gzipScript.size() / 1e6);
+
+    check(countColumn(gzipScript, "bins:{name:[") == expected.bins, "bin count");
+    check(countColumn(gzipScript, "sequences:{id:[") == expected.sequences, "sequence count");
+    check(countColumn(gzipScript, "trackItems:{sequence:[") == expected.trackItems, "track item count, without transitions");
+    check(countColumn(gzipScript, "markers:{sequence:[") == expected.markers, "marker count");
+    check(countColumn(gzipScript, "keyframes:{trackItem:[") == expected.keyframes, "animated parameter count");
+    check(withoutStats(gzipScript) == withoutStats(plainScript), "gzipped and plain XML give the same tables");
+    check(gzipScript.find("\"D:\\\\Footage\\\\Day 0\\\\A0 & B\xC3\xA9.mov\"") != std::string::npos, "media path entities decoded");
+    check(gzipScript.find("\"Bin 1 <Cuts>\"") != std::string::npos, "bin name entities decoded");
+    check(gzipScript.find("\"Fix & check \\\"this\\\"\"") != std::string::npos, "marker comment decoded from JSON in XML");
+    check(gzipScript.find("bin:[0,1,2,3") != std::string::npos, "sequences in their bins");
+    check(gzipScript.find("parent:[-1,0,0,0") != std::string::npos, "bins nested in bin 0");
+    check(countLinked(gzipScript, "nestedSequence:[") == expected.sequences - 1, "nested sequences found");
+    check(gzipScript.find("\"AE.ADBE Motion\"") != std::string::npos && gzipScript.find("\"0,0.5,0.5,0;") != std::string::npos, "keyframes converted");
+
+    // Truncated and damaged copies
+    std::vector<char> bytes(gzipBytes);
+    FILE* file = fopen(gzipPath.c_str(), "rb");
+    check(fread(bytes.data(), 1, bytes.size(), file) == bytes.size(), "reading the project back");
+    fclose(file);
+    const std::string damagedPath = "/tmp/ProjectFileBench-damaged.prproj";
+    for (int damage = 0; damage < 2; damage++) {
+        std::vector<char> copy = bytes;
+        if (damage == 0) copy.resize(copy.size() / 2);
+        else copy[copy.size() / 3] ^= 0x55;
+        file = fopen(damagedPath.c_str(), "wb");
+        fwrite(copy.data(), 1, copy.size(), file);
+        fclose(file);
+        std::string script;
+        check(readProject(damagedPath, script, ms) == kESErrConversion, damage == 0 ? "truncated project rejected" : "damaged project rejected");
+    }
+    std::string script;
+    check(readProject("/tmp/ProjectFileBench-missing.prproj", script, ms) == kESErrNoFile, "missing project");
+    remove(damagedPath.c_str());
+    remove(xmlPath.c_str());
+
+    for (int i = 2; i < argc; i++) {
+        if (readProject(argv[i], script, ms) == kESErrOK) printTables(argv[i], script, ms);
+        else printf("%s: not readable\n", argv[i]);
+    }
+
+    printf(failures ? "%d failures\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+// ScriptBundleBench.cpp
+// Checks the include bundle (ScriptBundle.cpp) and compares script startup with and without it, on Linux.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/ScriptBundleBench.cpp *.cpp -o ScriptBundleBench -lpthread
+// Then run from this folder, or pass the repo's Scripts folder:
+//      ./ScriptBundleBench [Scripts folder, default ../../../Scripts] [runs, default 2000]
+//
+// The checks build a small tree of include files in a temporary folder: the search order of INCLUDE_SEARCH_FOLDERS,
+// nested #include and //@include lines, a file that includes itself, a byte order mark, a missing file, a changed
+// file being read again while unchanged ones come from the cache, and the folder a name was found in being kept.
+//
+// The timing loads ThioUtilsLib.jsx and es5-shim.js for a script in "Premiere Pro", which is where ThioUtils.jsx lives.
+// "Before" does what includeFile and the #include it evals did in every run: check the folders in order until the file
+// exists, then read all of it. "After" is the getIncludeBundle call that replaces that, first with nothing cached and
+// then as in later runs, when it only checks the modification times, and for another list of the same names, when the
+// files and the folders they were found in are kept. The first call costs more than "before": on top of the same stats
+// and reads it looks for include lines, joins the files into the bundle it keeps, and copies that for ExtendScript.
+// This host can't run ExtendScript, so neither
+// side includes the time ExtendScript spends on File.exists calls or evaluating the source, which the bundle also cuts
+// down to one native call and one eval.
+
+#include "Exports.h"
+#include "ResultCache.h"
+#include "ScriptBundle.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double microsecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void writeFile(const std::string& path, const std::string& contents) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        printf("Can't write %s\n", path.c_str());
+        exit(1);
+    }
+    fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+}
+
+// Gives a file a modification time 'seconds' from now, so a change shows even on file systems with coarse times
+static void touchFile(const std::string& path, int seconds) {
+    struct timeval times[2];
+    gettimeofday(&times[0], nullptr);
+    times[0].tv_sec += seconds;
+    times[1] = times[0];
+    utimes(path.c_str(), times);
+}
+
+static bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+// Calls the export the way ExtendScript would, and returns the string it gave back
+static long callGetIncludeBundle(const std::string& folder, const std::string& names, std::string& bundle) {
+    TaggedData args[2];
+    args[0].type = kTypeString;
+    args[0].data.string = const_cast<char*>(folder.c_str());
+    args[1].type = kTypeString;
+    args[1].data.string = const_cast<char*>(names.c_str());
+    TaggedData retval;
+    const long err = getIncludeBundle(args, 2, &retval);
+    bundle.clear();
+    if (err == kESErrOK && retval.type == kTypeString) {
+        bundle = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return err;
+}
+
+static void checkBundles() {
+    char folderTemplate[] = "/tmp/ScriptBundleBench-XXXXXX";
+    if (mkdtemp(folderTemplate) == nullptr) {
+        printf("Can't make a temporary folder\n");
+        exit(1);
+    }
+    const std::string root = folderTemplate;
+    mkdir((root + "/scripts").c_str(), 0755);
+    mkdir((root + "/scripts/includes").c_str(), 0755);
+    mkdir((root + "/includes").c_str(), 0755);
+    mkdir((root + "/includes/sub").c_str(), 0755);
+    const std::string folder = root + "/scripts";
+
+    // lib.jsx is in both scripts/includes and ../includes, and the earlier folder wins
+    writeFile(folder + "/includes/lib.jsx", "var lib = 'near';\n#include \"../../includes/sub/nested.jsx\"\nvar afterNested = 1;\n");
+    writeFile(root + "/includes/lib.jsx", "var lib = 'far';\n");
+    writeFile(root + "/includes/sub/nested.jsx", "\xEF\xBB\xBFvar nested = 1;\n  //@include 'more.jsx'\n#includepath \"x\"");
+    writeFile(root + "/includes/sub/more.jsx", "var more = 1;\n#include \"nested.jsx\"\n");
+    writeFile(root + "/includes/shim.js", "var shim = 1;");
+
+    std::string bundle;
+    long err = callGetIncludeBundle(folder, "lib.jsx\nshim.js", bundle);
+    check(err == kESErrOK, "bundle built");
+    check(contains(bundle, "'near'") && !contains(bundle, "'far'"), "folders searched in includeFile's order");
+    check(contains(bundle, "var nested = 1;") && contains(bundle, "var more = 1;") && contains(bundle, "var afterNested = 1;"), "nested includes inlined");
+    check(bundle.find("var nested = 1;") < bundle.find("var more = 1;") && bundle.find("var more = 1;") < bundle.find("var afterNested = 1;"), "nested includes in place");
+    check(!contains(bundle, "#include \"") && !contains(bundle, "//@include"), "include lines replaced");
+    check(contains(bundle, "#includepath \"x\""), "other directives kept");
+    check(bundle.find("var nested = 1;") == bundle.rfind("var nested = 1;"), "a file including itself is left out the second time");
+    check(!contains(bundle, "\xEF\xBB\xBF"), "byte order mark removed");
+    check(contains(bundle, "var shim = 1;\n$.global.thioIncludePath = undefined;\n"), "files end with a line break");
+    check(contains(bundle, "$.global.thioIncludePath = \"" + folder + "/includes/../../includes/sub/nested.jsx\";\nvar nested"), "include path set before each file");
+
+    // Unchanged files come from the cache, a changed one is read again
+    std::string again;
+    callGetIncludeBundle(folder, "lib.jsx\nshim.js", again);
+    check(again == bundle, "cached bundle returned");
+    writeFile(root + "/includes/shim.js", "var shim = 2;");
+    touchFile(root + "/includes/shim.js", 10);
+    callGetIncludeBundle(folder, "lib.jsx\nshim.js", again);
+    check(contains(again, "var shim = 2;") && contains(again, "var afterNested = 1;"), "changed file read again");
+
+    // Where a name was found is kept for other lists of names too, until the cache is cleared or the file goes away
+    writeFile(folder + "/shim.js", "var shim = 'near';");
+    callGetIncludeBundle(folder, "shim.js", again);
+    check(contains(again, "var shim = 2;"), "folder a name was found in is kept for another list");
+
+    check(callGetIncludeBundle(folder, "lib.jsx\nmissing.jsx", again) == kESErrNoFile, "missing file");
+    writeFile(root + "/includes/broken.jsx", "#include \"nowhere.jsx\"\n");
+    check(callGetIncludeBundle(folder, "broken.jsx", again) == kESErrNoFile, "missing nested file");
+    check(releaseIncludeCache() == 5, "cache kept each file once");
+    callGetIncludeBundle(folder, "shim.js", again);
+    check(contains(again, "'near'"), "folders searched again after the cache is cleared");
+    remove((folder + "/shim.js").c_str());
+    callGetIncludeBundle(folder, "shim.js", again);
+    check(contains(again, "var shim = 2;"), "folders searched again when the file found is gone");
+    releaseIncludeCache();
+
+    const char* files[] = { "/scripts/includes/lib.jsx", "/includes/lib.jsx", "/includes/sub/nested.jsx", "/includes/sub/more.jsx",
+                            "/includes/shim.js", "/includes/broken.jsx", "/includes/sub", "/includes", "/scripts/includes", "/scripts" };
+    for (const char* file : files) remove((root + file).c_str());
+    remove(root.c_str());
+}
+
+// What includeFile and the eval of its #include did for one file: probe the folders in order, then read the file
+static bool includeFileTheOldWay(const std::string& folder, const char* name, std::string& source) {
+    static const char* const searchFolders[] = INCLUDE_SEARCH_FOLDERS;
+    for (const char* searchFolder : searchFolders) {
+        const std::string path = folder + "/" + searchFolder + name;
+        uint64_t modified;
+        if (!getFileModifiedTime(path.c_str(), modified)) continue;
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr) return false;
+        char buffer[65536];
+        size_t bytesRead;
+        source.clear();
+        while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0) source.append(buffer, bytesRead);
+        fclose(file);
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    const std::string scripts = (argc > 1) ? argv[1] : "../../../Scripts";
+    const int runs = (argc > 2) ? atoi(argv[2]) : 2000;
+    checkBundles();
+
+    const std::string folder = scripts + "/Premiere Pro";
+    const std::string names = "ThioUtilsLib.jsx\nes5-shim.js";
+    std::string lib, shim, bundle;
+    if (!includeFileTheOldWay(folder, "ThioUtilsLib.jsx", lib) || !includeFileTheOldWay(folder, "es5-shim.js", shim)) {
+        printf("ThioUtilsLib.jsx and es5-shim.js not found around %s\n", folder.c_str());
+        return 1;
+    }
+    check(callGetIncludeBundle(folder, names, bundle) == kESErrOK && contains(bundle, lib) && contains(bundle, shim), "bundle of the real includes");
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        includeFileTheOldWay(folder, "ThioUtilsLib.jsx", lib);
+        includeFileTheOldWay(folder, "es5-shim.js", shim);
+    }
+    const double before = microsecondsSince(start) / runs;
+
+    double first = 0;
+    for (int i = 0; i < 20; i++) {
+        releaseIncludeCache();
+        start = std::chrono::steady_clock::now();
+        callGetIncludeBundle(folder, names, bundle);
+        first += microsecondsSince(start) / 20;
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) callGetIncludeBundle(folder, names, bundle);
+    const double cached = microsecondsSince(start) / runs;
+
+    // Another script asking for the same files. Empty names are skipped, so adding line breaks makes a new list each time.
+    double otherList = 0;
+    std::string moreNames = names;
+    for (int i = 0; i < 20; i++) {
+        moreNames += '\n';
+        start = std::chrono::steady_clock::now();
+        callGetIncludeBundle(folder, moreNames, bundle);
+        otherList += microsecondsSince(start) / 20;
+    }
+
+    printf("ThioUtilsLib.jsx and es5-shim.js, %.0f KB, from %s\n\n", (lib.size() + shim.size()) / 1024.0, folder.c_str());
+    printf("%-44s %12s %16s\n", "", "us per run", "file operations");
+    printf("%-44s %12.1f %16s\n", "before: search folders, read each file", before, "10 stats, 2 reads");
+    printf("%-44s %12.1f %16s\n", "after: getIncludeBundle, first call", first, "10 stats, 2 reads");
+    printf("%-44s %12.1f %16s\n", "after: getIncludeBundle, later calls", cached, "2 stats");
+    printf("%-44s %12.1f %16s\n", "after: getIncludeBundle, another list", otherList, "2 stats");
+
+    printf(failures ? "\n%d failures\n" : "\nall checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,265 @@
+// SessionStoreBench.cpp
+// Checks the session store (SessionStore.h) and its exports, then benchmarks it from one and several threads.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/SessionStoreBench.cpp *.cpp -o SessionStoreBench -lpthread
+// Then run:
+//      ./SessionStoreBench [operations per thread, default 1000000]
+// Also worth building with -fsanitize=thread, which checks the threaded part for races.
+//
+// The checks cover the value types through the exports, expiry, least recently used eviction under the limit, the
+// byte accounting, prefix clears and the counters. The benchmark times sets and gets (hits and misses) of 200 byte
+// strings over 100k keys, then mixed gets and sets from several threads at once with a limit that keeps evicting.
+
+#include "Exports.h"
+#include "SessionStore.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef SessionStore::Clock Clock;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static SessionStore::Value stringValue(const std::string& text) {
+    SessionStore::Value value;
+    value.type = SessionStore::kSessionString;
+    value.text = text;
+    return value;
+}
+
+static TaggedData stringArg(const char* text) {
+    TaggedData arg;
+    arg.type = kTypeString;
+    arg.data.string = const_cast<char*>(text);
+    return arg;
+}
+
+static TaggedData numberArg(double number) {
+    TaggedData arg;
+    arg.type = kTypeDouble;
+    arg.data.fltval = number;
+    return arg;
+}
+
+static TaggedData boolArg(bool value) {
+    TaggedData arg;
+    arg.type = kTypeBool;
+    arg.data.intval = value ? 1 : 0;
+    return arg;
+}
+
+// Calls an export and returns its result. String and script results are copied into 'text' and freed.
+static TaggedData callExport(ESFunction function, std::vector<TaggedData> args, std::string& text, long& err) {
+    TaggedData retval;
+    err = function(args.data(), (long)args.size(), &retval);
+    text.clear();
+    if (err == kESErrOK && (retval.type == kTypeString || retval.type == kTypeScript)) {
+        text = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return retval;
+}
+
+static void checkExports() {
+    std::string text;
+    long err = 0;
+    releaseSessionStore();
+
+    TaggedData result = callExport(sessionSet, { stringArg("names"), stringArg("Sequence 01\nSequence \"02\""), numberArg(0) }, text, err);
+    check(err == kESErrOK && result.type == kTypeBool && result.data.intval == 1, "set a string");
+    callExport(sessionSet, { stringArg("frameRate"), numberArg(23.976), numberArg(60) }, text, err);
+    callExport(sessionSet, { stringArg("dirty"), boolArg(true), numberArg(0) }, text, err);
+
+    result = callExport(sessionGet, { stringArg("names") }, text, err);
+    check(result.type == kTypeString && text == "Sequence 01\nSequence \"02\"", "get a string");
+    result = callExport(sessionGet, { stringArg("frameRate") }, text, err);
+    check(result.type == kTypeDouble && result.data.fltval == 23.976, "get a number");
+    result = callExport(sessionGet, { stringArg("dirty") }, text, err);
+    check(result.type == kTypeBool && result.data.intval == 1, "get a boolean");
+    result = callExport(sessionGet, { stringArg("missing") }, text, err);
+    check(err == kESErrOK && result.type == kTypeUndefined, "missing key is undefined");
+
+    TaggedData undefinedArg;
+    undefinedArg.type = kTypeUndefined;
+    callExport(sessionSet, { stringArg("bad"), undefinedArg, numberArg(0) }, text, err);
+    check(err == kESErrTypeMismatch, "undefined value rejected");
+
+    result = callExport(sessionClear, { stringArg("frame") }, text, err);
+    check(result.type == kTypeInteger && result.data.intval == 1, "clear by prefix");
+    result = callExport(sessionDelete, { stringArg("dirty") }, text, err);
+    check(result.data.intval == 1, "delete");
+    callExport(sessionInfo, {}, text, err);
+    check(text.find("entries:1,") != std::string::npos && text.find("hits:3,misses:1,") != std::string::npos, "info counts");
+
+    callExport(sessionSetLimit, { numberArg(1e30) }, text, err);
+    check(err == kESErrOK, "limit past SIZE_MAX accepted");
+    result = callExport(sessionSetLimit, { numberArg(SESSION_STORE_DEFAULT_LIMIT) }, text, err);
+    check(result.type == kTypeDouble && result.data.fltval == (double)SIZE_MAX, "limit past SIZE_MAX clamped");
+    callExport(sessionSetLimit, { numberArg(-1) }, text, err);
+    check(err == kESErrRange, "negative limit rejected");
+    releaseSessionStore();
+}
+
+static void checkStore() {
+    SessionStore store;
+    const Clock::time_point t0 = Clock::now();
+    SessionStore::ValuePointer value;
+
+    // Expiry
+    store.set("short", stringValue("a"), 10, t0);
+    store.set("forever", stringValue("b"), 0, t0);
+    check((value = store.get("short", t0 + std::chrono::seconds(5))) && value->text == "a", "before expiry");
+    check(store.get("short", t0 + std::chrono::seconds(11)) == nullptr, "after expiry");
+    check(store.get("forever", t0 + std::chrono::hours(24 * 365)) != nullptr, "no expiry");
+    store.set("short", stringValue("a"), 10, t0);
+    SessionStore::Info info = store.info(t0 + std::chrono::seconds(20));
+    check(info.entries == 1 && info.expired == 2 && info.hits == 2 && info.misses == 1, "expired keys dropped by info");
+
+    // Byte accounting: overwriting a key replaces its bytes
+    store.clear("");
+    store.set("key", stringValue(std::string(1000, 'x')), 0, t0);
+    const size_t oneEntry = store.info(t0).bytes;
+    store.set("key", stringValue(std::string(1000, 'y')), 0, t0);
+    check(store.info(t0).bytes == oneEntry && oneEntry >= 1000, "overwrite keeps the byte count");
+    store.clear("");
+    check(store.info(t0).bytes == 0, "clear empties the byte count");
+
+    // Least recently used eviction: room for 10 entries, read the oldest, then add one more
+    store.setLimit(oneEntry * 10);
+    for (int i = 0; i < 10; i++) store.set("k" + std::to_string(i), stringValue(std::string(1000, 'a' + i)), 0, t0);
+    check(store.info(t0).entries == 10, "ten entries fit");
+    check(store.get("k0", t0) != nullptr, "read the oldest");
+    store.set("k10", stringValue(std::string(1000, 'z')), 0, t0);
+    check((value = store.get("k0", t0)) && value->text[0] == 'a', "recently read entry kept");
+    check(store.get("k1", t0) == nullptr, "least recently used entry evicted");
+    info = store.info(t0);
+    check(info.entries == 10 && info.evicted == 1 && info.bytes <= info.limit, "evicted to the limit");
+
+    // A value over the limit isn't stored, and removes the key it would have replaced
+    check(!store.set("k2", stringValue(std::string(oneEntry * 20, 'x')), 0, t0), "oversized value rejected");
+    check(store.get("k2", t0) == nullptr, "oversized value removed the old one");
+
+    // Lowering the limit evicts at once
+    check(store.setLimit(oneEntry * 3) == oneEntry * 10, "setLimit returns the previous limit");
+    check(store.info(t0).entries == 3, "lower limit evicts");
+
+    // Buffers are copies
+    NativeBuffer buffer(NativeBuffer::kInt64);
+    buffer.load("914456685312000,8475667200,-1");
+    SessionStore::Value bufferValue;
+    bufferValue.type = SessionStore::kSessionBuffer;
+    bufferValue.buffer = std::make_shared<const NativeBuffer>(buffer);
+    store.set("ticks", bufferValue, 0, t0);
+    buffer.resize(0);
+    check((value = store.get("ticks", t0)) && value->type == SessionStore::kSessionBuffer && value->buffer->size() == 3
+        && value->buffer->int64s()[0] == 914456685312000LL, "buffer round trip");
+    check(store.info(t0).bytes >= 24, "buffer bytes counted");
+}
+
+// Several threads setting and getting random keys, with a limit that keeps evicting. Returns operations per second.
+static double runThreads(int threadCount, long operations, bool verify) {
+    SessionStore store;
+    store.setLimit(4 * 1024 * 1024);
+    const std::string payload(200, 'p');
+    std::atomic<uint64_t> gets(0), wrongValues(0);
+
+    const Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 random(t + 1);
+            std::uniform_int_distribution<int> keyOf(0, 49999), action(0, 9);
+            SessionStore::ValuePointer value;
+            uint64_t localGets = 0;
+            for (long i = 0; i < operations; i++) {
+                const int key = keyOf(random);
+                const std::string name = "seq/" + std::to_string(key);
+                if (action(random) < 8) {
+                    localGets++;
+                    if ((value = store.get(name)) && value->text.compare(0, name.size(), name) != 0) wrongValues++;
+                }
+                else {
+                    store.set(name, stringValue(name + payload), 0);
+                }
+            }
+            gets += localGets;
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    const double seconds = millisecondsSince(start) / 1000;
+
+    if (verify) {
+        const SessionStore::Info info = store.info();
+        check(wrongValues == 0, "threaded gets see the value set for the key");
+        check(info.hits + info.misses == gets, "threaded counters add up");
+        check(info.bytes <= info.limit, "threaded store within its limit");
+        check(info.evicted > 0, "threaded store evicted");
+    }
+    return threadCount * operations / seconds;
+}
+
+int main(int argc, char** argv) {
+    const long operations = (argc > 1) ? atol(argv[1]) : 1000000;
+    checkExports();
+    checkStore();
+
+    // Single thread: 100k keys of 200 byte values, well under the default limit
+    SessionStore store;
+    const int keys = 100000;
+    std::vector<std::string> names(keys);
+    for (int i = 0; i < keys; i++) names[i] = "project/resolution/" + std::to_string(1000000 + i * 7);
+    const std::string payload(200, 'v');
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < keys; i++) store.set(names[i], stringValue(payload), 600);
+    const double setMs = millisecondsSince(start);
+
+    std::mt19937 random(7);
+    std::vector<int> order(keys);
+    for (int i = 0; i < keys; i++) order[i] = i;
+    std::shuffle(order.begin(), order.end(), random);
+    start = Clock::now();
+    size_t found = 0;
+    for (int i : order) found += store.get(names[i]) ? 1 : 0;
+    const double hitMs = millisecondsSince(start);
+    check(found == (size_t)keys, "every key found");
+
+    start = Clock::now();
+    for (int i = 0; i < keys; i++) found += store.get(names[i] + "x") ? 1 : 0;
+    const double missMs = millisecondsSince(start);
+
+    const SessionStore::Info info = store.info();
+    printf("%d keys, %.1f MB counted against the limit\n\n", keys, info.bytes / 1048576.0);
+    printf("%-32s %12s\n", "", "ns per op");
+    printf("%-32s %12.0f\n", "set", setMs * 1e6 / keys);
+    printf("%-32s %12.0f\n", "get, hit", hitMs * 1e6 / keys);
+    printf("%-32s %12.0f\n", "get, miss", missMs * 1e6 / keys);
+
+    printf("\n%-32s %12s\n", "80% gets, 20% sets, evicting", "M ops/s");
+    for (int threadCount : { 1, 2, 4, 8 }) {
+        const double rate = runThreads(threadCount, operations / threadCount, threadCount == 8);
+        printf("%-32s %12.2f\n", (std::to_string(threadCount) + (threadCount == 1 ? " thread" : " threads")).c_str(), rate / 1e6);
+    }
+
+    printf(failures ? "\n%d failures\n" : "\nall checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+// SortBench.cpp
+// Checks and benchmarks the native sort (Sort.cpp) against the comparator sorts the scripts use.
+//
+// Built against the library sources, so sortOrder can be timed both as a whole export and as just the sort:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/SortBench.cpp *.cpp -o SortBench -lpthread
+// Then run:
+//      ./SortBench
+//
+// The comparator path is what getSortedClipsArray does: a comparison sort whose comparator turns both tick strings into
+// numbers on every call (Number(a.start.ticks) - Number(b.start.ticks)). Here that's std::stable_sort with strtod, so
+// it leaves out the cost of calling a JS function per comparison, and the real script path is slower than shown.
+// The native path is the sortOrder export from the packed string to the result script, which is what a script pays.
+
+#include "Sort.h"
+#include "Exports.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+struct ClipKeys {
+    std::string startTicks;
+    long long track;
+};
+
+// Clips on a timeline of a few hours, at frame boundaries of 29.97 fps, on a handful of tracks. Plenty of equal start
+// times, like clips stacked on several tracks.
+static std::vector<ClipKeys> makeClips(size_t count) {
+    std::mt19937_64 random(7);
+    std::vector<ClipKeys> clips(count);
+    for (ClipKeys& clip : clips) {
+        clip.startTicks = std::to_string(8475667200LL * (long long)(random() % (count * 2)));
+        clip.track = (long long)(random() % 8);
+    }
+    return clips;
+}
+
+template <typename Function>
+static double bestMilliseconds(int repeats, Function function) {
+    double best = 1e300;
+    for (int r = 0; r < repeats; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main() {
+    const size_t sizes[] = { 100, 10000, 100000 };
+    int failures = 0;
+
+    printf("%8s %16s %16s %16s %8s\n", "keys", "comparator ms", "sortOrder ms", "sort only ms", "speedup");
+    for (size_t size : sizes) {
+        const std::vector<ClipKeys> clips = makeClips(size);
+
+        std::string packed;
+        std::vector<long long> keys;
+        for (const ClipKeys& clip : clips) {
+            if (!packed.empty()) packed += ";";
+            packed += clip.startTicks + "," + std::to_string(clip.track);
+            keys.push_back(std::stoll(clip.startTicks));
+            keys.push_back(clip.track);
+        }
+
+        // Comparator path, by start and then by track
+        std::vector<uint32_t> expected;
+        const double comparator = bestMilliseconds(5, [&] {
+            expected.resize(size);
+            for (size_t i = 0; i < size; i++) expected[i] = (uint32_t)i;
+            std::stable_sort(expected.begin(), expected.end(), [&clips](uint32_t a, uint32_t b) {
+                const double difference = strtod(clips[a].startTicks.c_str(), nullptr) - strtod(clips[b].startTicks.c_str(), nullptr);
+                return (difference != 0) ? (difference < 0) : (clips[a].track < clips[b].track);
+            });
+        });
+
+        // Whole export
+        TaggedData argv[2];
+        argv[0].type = kTypeString;
+        argv[0].data.string = &packed[0];
+        argv[1].type = kTypeInteger;
+        argv[1].data.intval = 1;
+        long err = kESErrOK;
+        const double exported = bestMilliseconds(5, [&] {
+            TaggedData retval;
+            err = sortOrder(argv, 2, &retval);
+            if (retval.type == kTypeScript) ESFreeMem(retval.data.string);
+        });
+
+        // Just the sort, which should give the same order as the comparator
+        std::vector<uint32_t> order;
+        const double sortOnly = bestMilliseconds(5, [&] {
+            sortRecordOrder(keys.data(), size, 2, order);
+        });
+
+        if (err != kESErrOK || order != expected) {
+            printf("FAIL  %zu keys: sortOrder returned %ld, order %s\n", size, err, order == expected ? "matches" : "differs");
+            failures++;
+        }
+        printf("%8zu %16.3f %16.3f %16.3f %7.1fx\n", size, comparator, exported, sortOnly, comparator / exported);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,302 @@
+// SoundStress.cpp
+// Test for the sound queue (SoundPlayer.cpp) on Linux.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/SoundStress.cpp *.cpp -o SoundStress -lpthread
+// Then run:
+//      ./SoundStress
+// Add -fsanitize=thread (or address) to the build to check the queue and shutdown for races.
+//
+// Sounds go to a NullAudioBackend that records what was played and when, and can hold the playback thread inside a
+// play so the queue fills up behind it. It checks that the same sound isn't repeated within SOUND_REPEAT_WINDOW_MS,
+// that no two sounds play closer than SOUND_MIN_INTERVAL_MS, that requests are dropped once the queue is full, and
+// that shutting down (including while other threads are still queueing) stops the thread and lets it start again.
+
+#include "SoundPlayer.h"
+#include "Exports.h"
+#include "ThioUtils.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what);
+        failures++;
+    }
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsBetween(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+struct Played {
+    std::string name;       // Sound name, or "beep <type>"
+    Clock::time_point time;
+};
+
+// NullAudioBackend that records every sound, and can hold the playback thread inside play until it's opened
+class RecordingBackend : public NullAudioBackend {
+public:
+    void play(const SoundAsset& sound) override {
+        NullAudioBackend::play(sound);
+        record(sound.name);
+    }
+
+    void beep(unsigned int type) override {
+        NullAudioBackend::beep(type);
+        record("beep " + std::to_string(type));
+    }
+
+    void stop() override {
+        stopCount++;
+    }
+
+    void setOpen(bool isOpen) {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = isOpen;
+        changed.notify_all();
+    }
+
+    // Waits until at least 'count' sounds have been played in total
+    bool waitForPlays(size_t count, int timeoutMs = 5000) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return played.size() >= count; });
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        played.clear();
+    }
+
+    std::vector<Played> log() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return played;
+    }
+
+    std::vector<std::string> names() {
+        std::vector<std::string> result;
+        for (const Played& entry : log()) result.push_back(entry.name);
+        return result;
+    }
+
+    std::atomic<int> stopCount{ 0 };
+
+private:
+    void record(const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex);
+        played.push_back(Played{ name, Clock::now() });
+        changed.notify_all();
+        changed.wait(lock, [&] { return open; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool open = true;
+    std::vector<Played> played;
+};
+
+static RecordingBackend backend;
+
+// Gives the playback thread time to finish with everything queued, then clears the log
+static void settle() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_REPEAT_WINDOW_MS + 50));
+    backend.reset();
+}
+
+// Checks the spacing rules on everything played so far
+static void checkSpacing(const std::vector<Played>& played, const char* what) {
+    // Allows for the time between the player reading the clock and the backend recording the play
+    const double slackMs = 5;
+    bool spaced = true;
+    bool notRepeated = true;
+    for (size_t i = 1; i < played.size(); i++) {
+        const double gap = millisecondsBetween(played[i - 1].time, played[i].time);
+        spaced = spaced && gap >= SOUND_MIN_INTERVAL_MS - slackMs;
+        if (played[i].name == played[i - 1].name) {
+            notRepeated = notRepeated && gap >= SOUND_REPEAT_WINDOW_MS - slackMs;
+        }
+    }
+    check(spaced, (std::string(what) + ": sounds are at least SOUND_MIN_INTERVAL_MS apart").c_str());
+    check(notRepeated, (std::string(what) + ": the same sound isn't repeated within SOUND_REPEAT_WINDOW_MS").c_str());
+}
+
+static void checkRepeats() {
+    settle();
+
+    // A loop asking for the same sound plays it once
+    for (int i = 0; i < 20; i++) {
+        check(queueSound("notify.wav") == kESErrOK, "queueSound succeeds");
+    }
+    check(backend.waitForPlays(1), "sound is played");
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS * 3));
+    check(backend.names() == std::vector<std::string>{ "notify.wav" }, "repeats in a burst play once");
+
+    // Still within the repeat window, past the minimum interval
+    check(queueSound("notify.wav") == kESErrOK, "queueSound succeeds");
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS * 2));
+    check(backend.names().size() == 1, "repeat within SOUND_REPEAT_WINDOW_MS is skipped");
+
+    // Past the repeat window it plays again
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_REPEAT_WINDOW_MS));
+    check(queueSound("notify.wav") == kESErrOK, "queueSound succeeds");
+    check(backend.waitForPlays(2), "repeat after SOUND_REPEAT_WINDOW_MS is played");
+
+    // A different sound isn't held back by the repeat window, only by the minimum interval
+    check(queueSound("SystemAsterisk") == kESErrOK, "queueSound succeeds");
+    check(backend.waitForPlays(3), "different sound is played");
+    std::vector<Played> played = backend.log();
+    check(played.size() == 3 && millisecondsBetween(played[1].time, played[2].time) < SOUND_REPEAT_WINDOW_MS,
+        "different sound plays within the repeat window");
+    checkSpacing(played, "repeats");
+
+    // Beeps are the same sound only if they're the same type
+    settle();
+    queueBeep(0x40);
+    queueBeep(0x40);
+    check(backend.waitForPlays(1), "beep is played");
+    queueBeep(0x10);
+    check(backend.waitForPlays(2), "beep of another type is played");
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS * 2));
+    check(backend.names() == std::vector<std::string>({ "beep 64", "beep 16" }), "beeps repeat by type");
+}
+
+static void checkInterval() {
+    settle();
+
+    // Different sounds every few milliseconds, faster than they can be played
+    const char* names[] = { "a.wav", "b.wav", "c.wav" };
+    const auto start = Clock::now();
+    int requested = 0;
+    while (millisecondsBetween(start, Clock::now()) < 500) {
+        queueSound(names[requested++ % 3]);
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    }
+    const double elapsed = millisecondsBetween(start, Clock::now());
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS * 2));
+
+    std::vector<Played> played = backend.log();
+    check(played.size() >= 2, "a stream of sounds keeps playing");
+    check(played.size() <= elapsed / SOUND_MIN_INTERVAL_MS + 2, "a stream of sounds is limited by SOUND_MIN_INTERVAL_MS");
+    checkSpacing(played, "stream");
+    printf("%-34s %6d requested %6d played in %.0f ms\n", "stream of sounds", requested, (int)played.size(), elapsed);
+}
+
+static void checkFullQueue() {
+    settle();
+
+    // The playback thread is held inside the first play, so everything after it waits in the queue
+    backend.setOpen(false);
+    check(queueSound("first.wav") == kESErrOK, "queueSound succeeds");
+    check(backend.waitForPlays(1), "first sound starts playing");
+
+    std::vector<std::string> names;
+    bool accepted = true;
+    for (int i = 0; i < SOUND_QUEUE_CAPACITY * 4; i++) {
+        names.push_back("queued" + std::to_string(i) + ".wav");
+        accepted = accepted && queueSound(names.back().c_str()) == kESErrOK;
+    }
+    check(accepted, "requests past the queue capacity are dropped without an error");
+    backend.setOpen(true);
+
+    // Of the ones that fit, only the newest is played
+    check(backend.waitForPlays(2), "queued sound is played");
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS * 2));
+    check(backend.names() == std::vector<std::string>({ "first.wav", names[SOUND_QUEUE_CAPACITY - 1] }),
+        "newest request that fit in the queue is played, later ones were dropped");
+}
+
+static void checkShutdown() {
+    settle();
+
+    // Shutdown waits for the thread, which is held inside a play
+    backend.setOpen(false);
+    queueSound("playing.wav");
+    check(backend.waitForPlays(1), "sound starts playing");
+    const int stopsBefore = backend.stopCount.load();
+    std::thread stopper(shutdownSoundPlayer);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    check(queueSound("late.wav") == kESErrOK, "sound queued during shutdown is accepted");
+    backend.setOpen(true);
+    stopper.join();
+    check(backend.stopCount.load() == stopsBefore + 1, "shutdown stops playback");
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS * 2));
+    check(backend.names() == std::vector<std::string>{ "playing.wav" }, "sound queued during shutdown is never played");
+
+    // The thread starts again on the next sound
+    backend.reset();
+    check(queueSound("again.wav") == kESErrOK, "queueSound after shutdown succeeds");
+    check(backend.waitForPlays(1), "sound after shutdown is played");
+
+    // Other threads keep queueing while the player is shut down and restarted
+    std::atomic<bool> done{ false };
+    std::vector<std::thread> queuers;
+    for (int t = 0; t < 3; t++) {
+        queuers.emplace_back([&done, t] {
+            const std::string name = "thread" + std::to_string(t) + ".wav";
+            while (!done.load()) {
+                queueSound(name.c_str());
+                queueBeep((unsigned int)t);
+            }
+        });
+    }
+    const auto start = Clock::now();
+    const int rounds = 200;
+    for (int i = 0; i < rounds; i++) {
+        shutdownSoundPlayer();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    const double elapsed = millisecondsBetween(start, Clock::now());
+    done.store(true);
+    for (std::thread& queuer : queuers) queuer.join();
+    check(backend.log().size() > 1, "sounds play between shutdowns");
+    printf("%-34s %10.3f ms\n", "shutdown with queueing threads", elapsed / rounds);
+
+    shutdownSoundPlayer();
+    backend.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS * 2));
+    check(backend.log().empty(), "nothing plays after the last shutdown");
+}
+
+static void checkNames() {
+    check(queueSound("") == kESErrBadArgumentList, "empty name is rejected");
+    check(queueSound("Media/notify.wav") == kESErrBadArgumentList, "path is rejected");
+    check(queueSound("..\\notify.wav") == kESErrBadArgumentList, "Windows path is rejected");
+    check(preloadSoundData("SystemAsterisk") == kESErrBadArgumentList, "preloading an alias is rejected");
+    check(preloadSoundData("notify.wav") == kESErrOK, "preloading a file succeeds");
+}
+
+static void timeQueue() {
+    settle();
+    const int count = 200000;
+    const auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        queueSound("notify.wav");
+    }
+    const double elapsed = millisecondsBetween(start, Clock::now());
+    printf("%-34s %10.3f us\n", "queueSound, cached", elapsed * 1000 / count);
+}
+
+int main() {
+    setAudioBackend(&backend);
+
+    checkNames();
+    checkRepeats();
+    checkInterval();
+    checkFullQueue();
+    timeQueue();
+    checkShutdown();
+
+    setAudioBackend(nullptr);
+    printf(failures ? "%d failures\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
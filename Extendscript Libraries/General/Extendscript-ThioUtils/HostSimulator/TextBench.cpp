@@ -0,0 +1,233 @@
+// TextBench.cpp
+// Checks and benchmarks the case-insensitive search and the pattern exports (TextSearch.cpp) outside the Adobe apps.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/TextBench.cpp *.cpp -o TextBench -lpthread
+// Then run:
+//      ./TextBench [strings per corpus, default 20000]
+//
+// The corpora are made-up marker names and clip names. The search is compared with what the scripts and the old
+// findSubstringIgnoreCase did: lowercase a copy and search it, and std::search with a toupper comparison. The pattern
+// exports are compared with compiling the same pattern for every string, which is what a script's RegExp literal in a
+// loop costs at most. To compare with ExtendScript's own RegExp on a real project, run ThioUtilsLib.benchmarkPatterns
+// from a script instead (see ThioUtilsLib.jsx).
+//
+// It also checks that the pattern exports refuse strings too long to match without overflowing the stack, and that the
+// longest string they accept matches on a thread with a 1 MB stack, which is what a Windows thread gets by default.
+
+#include "TextSearch.h"
+#include "Exports.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <pthread.h>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> makeCorpus(const std::vector<std::string>& words, size_t count, bool numbered) {
+    std::mt19937 random(99);
+    std::vector<std::string> corpus(count);
+    for (size_t i = 0; i < count; i++) {
+        const size_t wordCount = 1 + random() % 4;
+        for (size_t w = 0; w < wordCount; w++) {
+            if (w > 0) corpus[i] += ' ';
+            corpus[i] += words[random() % words.size()];
+        }
+        if (numbered) corpus[i] += "~~" + std::to_string(i) + "~~";
+    }
+    return corpus;
+}
+
+template <typename Function>
+static double bestMilliseconds(Function function) {
+    double best = 1e300;
+    for (int r = 0; r < 5; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static std::string toTextList(const std::vector<std::string>& items) {
+    std::string list;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) list += '\n';
+        list += items[i]; // The corpora have no backslashes or newlines to escape
+    }
+    return list;
+}
+
+static long callPattern(long (*function)(TaggedData*, long, TaggedData*), long handle, const std::string& list, const char* replacement) {
+    TaggedData argv[3];
+    argv[0].type = kTypeInteger;
+    argv[0].data.intval = handle;
+    argv[1].type = kTypeString;
+    argv[1].data.string = const_cast<char*>(list.c_str());
+    argv[2].type = kTypeString;
+    argv[2].data.string = const_cast<char*>(replacement);
+    TaggedData retval;
+    const long err = function(argv, replacement ? 3 : 2, &retval);
+    if (err == kESErrOK && retval.type == kTypeScript) ESFreeMem(retval.data.string);
+    return err;
+}
+
+static long compile(const char* pattern, const char* flags) {
+    TaggedData argv[2];
+    argv[0].type = kTypeString;
+    argv[0].data.string = const_cast<char*>(pattern);
+    argv[1].type = kTypeString;
+    argv[1].data.string = const_cast<char*>(flags);
+    TaggedData retval;
+    return (compilePattern(argv, 2, &retval) == kESErrOK) ? retval.data.intval : -1;
+}
+
+// Runs 'function' on a thread with a 1 MB stack. A stack overflow in it crashes the program.
+static void runWithSmallStack(std::function<void()> function) {
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, 1024 * 1024);
+    pthread_t thread;
+    pthread_create(&thread, &attributes, [](void* argument) -> void* {
+        (*static_cast<std::function<void()>*>(argument))();
+        return nullptr;
+    }, &function);
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attributes);
+}
+
+// std::regex recurses per character matched, so a long string used to crash the host instead of returning an error
+static int checkLongSubjects() {
+    int failures = 0;
+    struct LongSubject { const char* pattern; const char* prefix; char fill; };
+    for (const LongSubject& subject : {
+            LongSubject{ "(a|b)*c", "", 'a' },
+            LongSubject{ "a*c", "", 'a' },
+            LongSubject{ "((a|b)|(c|d))*x", "", 'a' },
+            LongSubject{ "(?:a|b|c|d|e|f)*x", "", 'a' },
+            LongSubject{ "~~\\d+~~$", "~~", '1' } }) {
+        const long handle = compile(subject.pattern, "");
+        const long globalHandle = compile(subject.pattern, "g");
+        auto makeSubject = [&](size_t length) { return subject.prefix + std::string(length, subject.fill); };
+
+        const std::string tooLong = "short\n" + makeSubject(20000);
+        long err[5] = {
+            callPattern(patternTestBatch, handle, tooLong, nullptr),
+            callPattern(patternMatchBatch, handle, tooLong, nullptr),
+            callPattern(patternMatchBatch, globalHandle, tooLong, nullptr),
+            callPattern(patternReplaceBatch, globalHandle, tooLong, ""),
+            callPattern(patternSplitBatch, handle, tooLong, nullptr) };
+        for (long e : err) {
+            if (e != kESErrRange) {
+                printf("FAIL  pattern %s on a 20000 character string returned %ld, not kESErrRange\n", subject.pattern, e);
+                failures++;
+                break;
+            }
+        }
+
+        // Longest string the exports accept for this pattern
+        size_t accepted = 0, refused = 20000;
+        while (refused - accepted > 1) {
+            const size_t length = (accepted + refused) / 2;
+            long result = kESErrOK;
+            runWithSmallStack([&] { result = callPattern(patternTestBatch, handle, makeSubject(length), nullptr); });
+            (result == kESErrOK ? accepted : refused) = length;
+        }
+        const std::string longest = makeSubject(accepted);
+        runWithSmallStack([&] {
+            err[0] = callPattern(patternMatchBatch, handle, longest, nullptr);
+            err[1] = callPattern(patternMatchBatch, globalHandle, longest, nullptr);
+            err[2] = callPattern(patternReplaceBatch, globalHandle, longest, "");
+            err[3] = callPattern(patternSplitBatch, handle, longest, nullptr);
+        });
+        for (int i = 0; i < 4; i++) {
+            if (err[i] != kESErrOK) {
+                printf("FAIL  pattern %s on the longest accepted string returned %ld\n", subject.pattern, err[i]);
+                failures++;
+                break;
+            }
+        }
+        if (accepted < 200) {
+            printf("FAIL  pattern %s only accepts strings up to %zu characters\n", subject.pattern, accepted);
+            failures++;
+        }
+        printf("%-22s longest string accepted %6zu\n", subject.pattern, accepted);
+    }
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const size_t count = (argc > 1) ? (size_t)atoi(argv[1]) : 20000;
+    const std::vector<std::string> markers = makeCorpus({ "Intro", "Chapter", "B-Roll", "TODO", "Fix audio", "Sponsor", "Outro", "\xE2\x80\x9CQuote\xE2\x80\x9D", "Caf\xC3\xA9" }, count, true);
+    const std::vector<std::string> clips = makeCorpus({ "A001_C002_0412XY.mov", "Interview_CamB.MP4", "music_bed.wav", "VO_take3.WAV", "Title", "Adjustment Layer", "Nested Sequence 02" }, count, false);
+
+    int failures = checkLongSubjects();
+    printf("\n%-8s %-22s %12s %12s %12s\n", "corpus", "search", "lower+find", "toupper", "native");
+    struct Search { const char* corpus; const std::vector<std::string>* items; const char* needle; };
+    for (const Search& search : { Search{ "markers", &markers, "fix AUDIO" }, Search{ "clips", &clips, ".wav" }, Search{ "clips", &clips, "nested sequence" } }) {
+        const std::string needle = search.needle;
+        size_t expected = 0, upper = 0, native = 0;
+        const double lowerMs = bestMilliseconds([&] {
+            expected = 0;
+            std::string lowerNeedle = needle;
+            for (char& c : lowerNeedle) c = (char)tolower((unsigned char)c);
+            for (const std::string& item : *search.items) {
+                std::string lower = item;
+                for (char& c : lower) c = (char)tolower((unsigned char)c);
+                expected += lower.find(lowerNeedle) != std::string::npos;
+            }
+        });
+        const double upperMs = bestMilliseconds([&] {
+            upper = 0;
+            for (const std::string& item : *search.items) {
+                upper += std::search(item.begin(), item.end(), needle.begin(), needle.end(),
+                    [](char a, char b) { return toupper((unsigned char)a) == toupper((unsigned char)b); }) != item.end();
+            }
+        });
+        const double nativeMs = bestMilliseconds([&] {
+            native = 0;
+            for (const std::string& item : *search.items) {
+                native += findIgnoreCase(item.data(), item.size(), needle.data(), needle.size()) != TEXT_NOT_FOUND;
+            }
+        });
+        if (expected != upper || expected != native) {
+            printf("FAIL  '%s' found %zu / %zu / %zu times\n", search.needle, expected, upper, native);
+            failures++;
+        }
+        printf("%-8s %-22s %12.3f %12.3f %12.3f\n", search.corpus, search.needle, lowerMs, upperMs, nativeMs);
+    }
+
+    printf("\n%-8s %-22s %12s %12s %8s\n", "corpus", "pattern", "per string", "compiled", "speedup");
+    struct Replace { const char* corpus; const std::vector<std::string>* items; const char* pattern; const char* flags; const char* replacement; };
+    for (const Replace& replace : {
+            Replace{ "markers", &markers, "~~\\d+~~$", "", "" },
+            Replace{ "markers", &markers, "\xE2\x80\x9C|\xE2\x80\x9D", "g", "\"" },
+            Replace{ "clips", &clips, "_C(\\d+)_", "i", "-$1-" } }) {
+        const std::string list = toTextList(*replace.items);
+        const auto flags = std::regex::ECMAScript | ((strchr(replace.flags, 'i') != nullptr) ? std::regex::icase : std::regex::ECMAScript);
+        const double perStringMs = bestMilliseconds([&] {
+            for (const std::string& item : *replace.items) {
+                const std::regex regex(replace.pattern, flags);
+                std::string replaced = std::regex_replace(item, regex, replace.replacement);
+            }
+        });
+
+        const long handle = compile(replace.pattern, replace.flags);
+        long err = (handle > 0) ? kESErrOK : kESErrSyntax;
+        const double compiledMs = bestMilliseconds([&] {
+            if (handle > 0) err = callPattern(patternReplaceBatch, handle, list, replace.replacement);
+        });
+        if (err != kESErrOK) {
+            printf("FAIL  pattern %s returned %ld\n", replace.pattern, err);
+            failures++;
+        }
+        printf("%-8s %-22s %12.3f %12.3f %7.1fx\n", replace.corpus, replace.pattern, perStringMs, compiledMs, perStringMs / compiledMs);
+    }
+    return failures ? 1 : 0;
+}
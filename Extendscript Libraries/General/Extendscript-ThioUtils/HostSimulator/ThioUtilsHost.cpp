@@ -0,0 +1,628 @@
+// ThioUtilsHost.cpp
+// Stand-in for the ExtendScript host, for benchmarking the library outside the Adobe apps.
+//
+// It loads the library the same way ExtendScript does: calls ESInitialize and ESClientInterface, reads the
+// "name_signature" list ESInitialize returns, then calls each export with TaggedData arguments built from the signature
+// and frees results with ESFreeMem.
+// Every export is timed over many calls, and the latency percentiles and heap allocations per call are printed, so
+// changes to the native code can be compared by number.
+//
+// This is not part of the Visual Studio project. Build the library and the host on Linux with:
+//      g++ -std=c++17 -O2 -shared -fPIC -fvisibility=hidden -I. -IInclude *.cpp -o libThioUtils.so -lpthread
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/ThioUtilsHost.cpp -o ThioUtilsHost -ldl
+// Then run:
+//      ./ThioUtilsHost ./libThioUtils.so [iterations] [name filter]
+// Or run make in the library folder, which builds both (and the other HostSimulator programs) into build/.
+//
+// The platform exports (clipboard, sounds, beep) use stub backends on Linux, so their numbers only cover argument handling.
+// Exports that take a handle or a LiveObject get one from a setup step first (see SampleArguments). An export that
+// can't be called is listed at the end and the host exits with 1, so a missing sample shows up instead of a missing row.
+
+#include "SoSharedLibDefs.h"
+#include "SoCClient.h"
+#include <dlfcn.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+// Allocation counting
+// Interposes malloc and friends, which also catches operator new and everything the library allocates. glibc only.
+// ------------------------------------------------------------------------------------------------
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+
+static unsigned long long allocationCount = 0;
+
+extern "C" void* malloc(size_t size) {
+    allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+    allocationCount++;
+    return __libc_realloc(p, size);
+}
+#define ALLOCATION_COUNT_AVAILABLE 1
+#else
+static unsigned long long allocationCount = 0;
+#define ALLOCATION_COUNT_AVAILABLE 0
+#endif
+
+// ------------------------------------------------------------------------------------------------
+// LiveObjects
+// Just enough of ExtendScript's SoServerInterface for the library's classes to register and for the host to create
+// objects to pass to exports. Methods and properties aren't called, so adding them does nothing.
+// ------------------------------------------------------------------------------------------------
+
+typedef ESerror_t (*ESClientInterfaceFunction)(SoCClient_e reason, SoServerInterface* server, SoHServer hServer);
+
+struct HostObject {
+    std::string className;
+    SoObjectInterface* objectInterface;
+    void* clientData;
+};
+
+static std::map<std::string, SoObjectInterface*> hostClasses;
+static std::vector<HostObject*> hostObjects;
+
+static HostObject* toHostObject(SoHObject hObject) {
+    return reinterpret_cast<HostObject*>(hObject);
+}
+
+static ESerror_t hostAddClass(SoHServer, char* name, SoObjectInterface_p objectInterface) {
+    hostClasses[name] = objectInterface;
+    return kESErrOK;
+}
+
+static ESerror_t hostAddNames(SoHObject, SoCClientName_p) {
+    return kESErrOK;
+}
+
+static ESerror_t hostGetClass(SoHObject hObject, char* name, int nameLength) {
+    const std::string& className = toHostObject(hObject)->className;
+    if ((int)className.size() >= nameLength) return kESErrRange;
+    memcpy(name, className.c_str(), className.size() + 1);
+    return kESErrOK;
+}
+
+static ESerror_t hostSetClientData(SoHObject hObject, void* data) {
+    toHostObject(hObject)->clientData = data;
+    return kESErrOK;
+}
+
+static ESerror_t hostGetClientData(SoHObject hObject, void** data) {
+    *data = toHostObject(hObject)->clientData;
+    return kESErrOK;
+}
+
+static SoServerInterface makeHostServer() {
+    SoServerInterface server = {};
+    server.addClass = hostAddClass;
+    server.addMethods = hostAddNames;
+    server.addProperties = hostAddNames;
+    server.getClass = hostGetClass;
+    server.setClientData = hostSetClientData;
+    server.getClientData = hostGetClientData;
+    return server;
+}
+
+// Same as 'new className(args...)' in a script. Returns nullptr if the class isn't registered or its constructor failed.
+static SoHObject createHostObject(const char* className, std::vector<TaggedData> args) {
+    auto found = hostClasses.find(className);
+    if (found == hostClasses.end()) return nullptr;
+
+    HostObject* object = new HostObject{ className, found->second, nullptr };
+    SoHObject hObject = reinterpret_cast<SoHObject>(object);
+    if (object->objectInterface->initialize(hObject, (int)args.size(), args.data()) != kESErrOK) {
+        delete object;
+        return nullptr;
+    }
+    hostObjects.push_back(object);
+    return hObject;
+}
+
+static void releaseHostObjects() {
+    for (HostObject* object : hostObjects) {
+        if (object->objectInterface->finalize != nullptr) object->objectInterface->finalize(reinterpret_cast<SoHObject>(object));
+        delete object;
+    }
+    hostObjects.clear();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Sample arguments
+// ------------------------------------------------------------------------------------------------
+
+typedef char* (*ESInitializeFunction)(const TaggedData** argv, long argc);
+typedef void (*ESTerminateFunction)();
+typedef void (*ESFreeMemFunction)(void* p);
+
+// Arguments for exports where the generic values from the signature wouldn't exercise the real work.
+// Strings go in 'strings' in order, numbers and booleans in 'numbers'. Add an entry when adding an export.
+struct SampleArguments {
+    const char* name;
+    std::vector<std::string> strings;
+    std::vector<double> numbers;
+    // For exports that take a handle or an object another export makes: puts a new one in the arguments before every
+    // call, outside the timing, since some of these exports use it up. Returns false if it couldn't make one.
+    std::function<bool(std::vector<TaggedData>& args)> setup;
+};
+
+static void* library = nullptr;
+static ESFreeMemFunction freeMem = nullptr;
+
+static TaggedData stringArg(const char* text) {
+    TaggedData arg = {};
+    arg.type = kTypeString;
+    arg.data.string = const_cast<char*>(text);
+    return arg;
+}
+
+static TaggedData integerArg(long value) {
+    TaggedData arg = {};
+    arg.type = kTypeInteger;
+    arg.data.intval = value;
+    return arg;
+}
+
+// Calls another export for a setup and returns its result as text, e.g. "7" or "({handle:3,...})"
+static bool callForSetup(const char* name, std::vector<TaggedData> args, std::string& text) {
+    ESFunction function = (ESFunction)dlsym(library, name);
+    if (function == nullptr) return false;
+
+    TaggedData result = {};
+    const long error = function(args.data(), (long)args.size(), &result);
+    if (error != kESErrOK) return false;
+    switch (result.type) {
+    case kTypeString:
+    case kTypeScript:
+        text = (result.data.string != nullptr) ? result.data.string : "";
+        freeMem(result.data.string);
+        break;
+    case kTypeInteger:
+        text = std::to_string(result.data.intval);
+        break;
+    case kTypeDouble:
+        text = std::to_string((long long)result.data.fltval);
+        break;
+    case kTypeBool:
+        text = result.data.intval ? "true" : "false";
+        break;
+    default:
+        text.clear();
+    }
+    return true;
+}
+
+// Reads the number after 'key' in a setup result, e.g. "handle:"
+static long numberAfter(const std::string& text, const char* key) {
+    const size_t position = text.find(key);
+    return (position == std::string::npos) ? 0 : atol(text.c_str() + position + strlen(key));
+}
+
+static std::string makeEllipsePoints(int count, double cx, double cy) {
+    std::string points;
+    for (int i = 0; i < count; i++) {
+        const double angle = 6.283185307179586 * i / count;
+        if (!points.empty()) points += ",";
+        points += std::to_string(cx + 40.0 * std::cos(angle)) + "," + std::to_string(cy + 25.0 * std::sin(angle));
+    }
+    return points;
+}
+
+static std::string makeTickList(int count) {
+    std::string ticks;
+    for (int i = 0; i < count; i++) {
+        if (!ticks.empty()) ticks += ",";
+        ticks += std::to_string(8475667200LL * i + 1234567LL);
+    }
+    return ticks;
+}
+
+// A JSON dump shaped like what scripts export from a project: a few thousand clips with names, times and properties.
+// About 2 MB for 4000 clips.
+static std::string makeProjectJson(int clipCount) {
+    std::string json = "{\n  \"name\": \"Sample Project\",\n  \"clips\": [";
+    for (int i = 0; i < clipCount; i++) {
+        json += (i ? ",\n" : "\n");
+        json += "    {\"name\": \"Clip " + std::to_string(i) + " \\\"take\\\" \u00e9\", \"track\": " + std::to_string(i % 8);
+        json += ", \"start\": \"" + std::to_string(8475667200LL * i) + "\", \"end\": \"" + std::to_string(8475667200LL * (i + 30)) + "\"";
+        json += ", \"enabled\": " + std::string(i % 5 ? "true" : "false") + ", \"speed\": 1.25, \"effects\": [";
+        for (int e = 0; e < 4; e++) {
+            json += (e ? ", " : "") + std::string("{\"name\": \"Lumetri Color\", \"params\": [0.5, -12.75, 100, null]}");
+        }
+        json += "], \"comment\": \"Imported from C:\\\\Footage\\\\Day 1\\\\A001.mov\\nsecond line\"}";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+// A small uncompressed project: one sequence with one video track of 'items' clips, all from the same media
+static std::string makeProjectXml(int items) {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n<PremiereData Version=\"3\">\n";
+    xml += "<RootProjectItem ObjectUID=\"root\"><ProjectItemContainer><Items><Item ObjectURef=\"seqitem\"/></Items></ProjectItemContainer><ProjectItem><Name>Root</Name></ProjectItem></RootProjectItem>\n";
+    xml += "<ClipProjectItem ObjectUID=\"seqitem\"><ProjectItem><Name>Sequence 01</Name></ProjectItem><MasterClip ObjectURef=\"seqmc\"/></ClipProjectItem>\n";
+    xml += "<MasterClip ObjectUID=\"seqmc\"><Clips><Clip ObjectRef=\"2\"/></Clips></MasterClip>\n";
+    xml += "<VideoClip ObjectID=\"2\"><Clip><Source ObjectRef=\"3\"/></Clip></VideoClip>\n";
+    xml += "<VideoSequenceSource ObjectID=\"3\"><SequenceSource><Sequence ObjectURef=\"seq\"/></SequenceSource></VideoSequenceSource>\n";
+    xml += "<Sequence ObjectUID=\"seq\"><TrackGroups><TrackGroup><Second ObjectRef=\"4\"/></TrackGroup></TrackGroups><Name>Sequence 01</Name></Sequence>\n";
+    xml += "<VideoTrackGroup ObjectID=\"4\"><TrackGroup><Tracks><Track ObjectURef=\"track\"/></Tracks><FrameRate>8475667200</FrameRate></TrackGroup></VideoTrackGroup>\n";
+    xml += "<VideoMediaSource ObjectID=\"5\"><MediaSource><Media ObjectURef=\"media\"/></MediaSource></VideoMediaSource>\n";
+    xml += "<Media ObjectUID=\"media\"><ActualMediaFilePath>D:\\Footage\\A001 &amp; B.mov</ActualMediaFilePath></Media>\n";
+    xml += "<VideoClipTrack ObjectUID=\"track\"><ClipTrack><ClipItems><TrackItems>";
+    for (int i = 0; i < items; i++) xml += "<TrackItem ObjectRef=\"" + std::to_string(100 + 3 * i) + "\"/>";
+    xml += "</TrackItems></ClipItems></ClipTrack></VideoClipTrack>\n";
+    for (int i = 0; i < items; i++) {
+        const std::string item = std::to_string(100 + 3 * i), subClip = std::to_string(101 + 3 * i), clip = std::to_string(102 + 3 * i);
+        xml += "<VideoClipTrackItem ObjectID=\"" + item + "\"><ClipTrackItem><TrackItem><Start>" + std::to_string(8475667200LL * 150 * i) + "</Start><End>"
+            + std::to_string(8475667200LL * (150 * i + 120)) + "</End></TrackItem><SubClip ObjectRef=\"" + subClip + "\"/></ClipTrackItem></VideoClipTrackItem>\n";
+        xml += "<SubClip ObjectID=\"" + subClip + "\"><Clip ObjectRef=\"" + clip + "\"/><Name>A001 " + std::to_string(i) + "</Name></SubClip>\n";
+        xml += "<VideoClip ObjectID=\"" + clip + "\"><Clip><Source ObjectRef=\"5\"/><InPoint>0</InPoint></Clip></VideoClip>\n";
+    }
+    return xml + "</PremiereData>\n";
+}
+
+static std::vector<SampleArguments> buildSampleArguments() {
+    const std::string ticks = makeTickList(1000);
+    const std::string frames = [] {
+        std::string list;
+        for (int i = 0; i < 1000; i++) list += (i ? "," : "") + std::to_string(i * 7);
+        return list;
+    }();
+    const std::string projectJson = makeProjectJson(4000);
+    const char* projectJsonPath = "/tmp/ThioUtilsHost-project.json";
+    if (FILE* file = fopen(projectJsonPath, "wb")) {
+        fwrite(projectJson.data(), 1, projectJson.size(), file);
+        fclose(file);
+    }
+    const char* projectXmlPath = "/tmp/ThioUtilsHost-project.prproj";
+    if (FILE* file = fopen(projectXmlPath, "wb")) {
+        const std::string projectXml = makeProjectXml(500);
+        fwrite(projectXml.data(), 1, projectXml.size(), file);
+        fclose(file);
+    }
+    std::string nodeIds, itemMetadata;
+    for (int i = 0; i < 200; i++) {
+        nodeIds += (i ? "\n" : "") + std::to_string(0xF4240 + i);
+        itemMetadata += (i ? "\x01" : "") + std::string("<x:xmpmeta><rdf:Description>")
+            + "<premierePrivateProjectMetaData:Column.Intrinsic.MediaType>Movie</premierePrivateProjectMetaData:Column.Intrinsic.MediaType>"
+            + "<premierePrivateProjectMetaData:Column.Intrinsic.MediaTimebase>23.976 fps</premierePrivateProjectMetaData:Column.Intrinsic.MediaTimebase>"
+            + "<premierePrivateProjectMetaData:Column.Intrinsic.VideoInfo>1920 x 1080 (1.0)</premierePrivateProjectMetaData:Column.Intrinsic.VideoInfo>"
+            + "<premierePrivateProjectMetaData:Column.Intrinsic.FilePath>D:\\Footage\\A" + std::to_string(i) + ".mov</premierePrivateProjectMetaData:Column.Intrinsic.FilePath>"
+            + "</rdf:Description></x:xmpmeta>";
+    }
+    std::string records;
+    for (int i = 0; i < 2000; i++) {
+        records += "sClip " + std::to_string(i) + " \\\\ \"take\"\tn" + std::to_string(i * 1.5) + "\tb1\tu\n";
+    }
+    std::string sortKeys;
+    for (int i = 0; i < 1000; i++) {
+        sortKeys += (i ? ";" : "") + std::to_string(8475667200LL * ((i * 7919) % 1000)) + "," + std::to_string(i % 4);
+    }
+    std::string clipNames;
+    for (int i = 0; i < 1000; i++) {
+        clipNames += (i ? "\n" : "") + std::string((i % 3) ? "Interview_CamB_" : "VO_take_") + std::to_string(i) + ((i % 3) ? ".mp4" : ".WAV");
+    }
+    std::string ellipses;
+    for (int i = 0; i < 20; i++) ellipses += (i ? ";" : "") + makeEllipsePoints(32, i * 10.0, 5.0);
+    std::string markerNames;
+    for (int i = 0; i < 1000; i++) {
+        markerNames += (i ? "\n" : "") + std::string((i % 4) ? "Chapter " : "Sponsor read ") + std::to_string(i) + "~~" + std::to_string(i) + "~~";
+    }
+
+    // Setups. Reading the only chunk of a result releases it, and getJobResult forgets the job, so each call gets a new one.
+    const std::string chunkedCommand = "ticksToTimecodeBatch\ts" + ticks + "\ts8475667200\tb0";
+    auto chunkedResult = [chunkedCommand](std::vector<TaggedData>& args) {
+        std::string info;
+        if (!callForSetup("callChunked", { stringArg(chunkedCommand.c_str()) }, info)) return false;
+        args[0].data.intval = numberAfter(info, "handle:");
+        args[1].data.intval = 0;
+        return args[0].data.intval > 0 && numberAfter(info, "chunkCount:") == 1;
+    };
+    auto compiledPattern = [](std::vector<TaggedData>& args) {
+        std::string handle;
+        if (!callForSetup("compilePattern", { stringArg("~~\\d+~~$"), stringArg("") }, handle)) return false;
+        args[0].data.intval = atol(handle.c_str());
+        return true;
+    };
+    auto finishedJob = [](std::vector<TaggedData>& args) {
+        std::string id, status;
+        if (!callForSetup("startJob", { stringArg("call"), stringArg("addTicks\ts914456685312000\ts8475667200") }, id)) return false;
+        const auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (std::chrono::steady_clock::now() < giveUp) {
+            if (!callForSetup("pollJob", { integerArg(atol(id.c_str())) }, status)) return false;
+            if (status.find("state:\"done\"") != std::string::npos) {
+                args[0].data.intval = atol(id.c_str());
+                return true;
+            }
+            if (status.find("state:\"running\"") == std::string::npos && status.find("state:\"queued\"") == std::string::npos) return false;
+            std::this_thread::yield();
+        }
+        return false;
+    };
+    auto storedBuffer = [ticks](std::vector<TaggedData>& args) {
+        // One buffer to store and one to fill, kept for the whole run
+        static SoHObject source = createHostObject("NativeBuffer", { stringArg("i64"), stringArg(ticks.c_str()) });
+        static SoHObject target = createHostObject("NativeBuffer", { stringArg("i64") });
+        if (source == nullptr || target == nullptr) return false;
+
+        TaggedData sourceArg = {};
+        sourceArg.type = kTypeLiveObject;
+        sourceArg.data.hObject = source;
+        TaggedData ttlArg = {};
+        ttlArg.type = kTypeDouble;
+        ttlArg.data.fltval = 600;
+        std::string stored;
+        if (!callForSetup("sessionSet", { stringArg("clips/starts"), sourceArg, ttlArg }, stored) || stored != "true") return false;
+        args[1].type = kTypeLiveObject;
+        args[1].data.hObject = target;
+        return true;
+    };
+    std::string keyframes;
+    for (int i = 0; i < 1000; i++) {
+        keyframes += (i ? ";" : "") + std::to_string(8475667200LL * i) + "," + std::to_string(0.5 + 0.3 * std::sin(i * 0.01)) + "," + std::to_string(0.5 + 0.001 * (i % 3)) + ",0";
+    }
+
+    return {
+        { "systemBeep",             {},                                         { 0 } },
+        { "playSoundAlias",         { "SystemAsterisk" },                       {} },
+        { "preloadSound",           { "notify.wav" },                           {} },
+        { "copyTextToClipboard",    { "Text to copy" },                         {} },
+        { "copyTextToClipboardAsync", { "Text to copy" },                       {} },
+        { "getClipboardStatus",     {},                                         { 1 } },
+        { "fitEllipse",             { makeEllipsePoints(64, 100.0, 50.0) },     {} },
+        { "fitEllipseBatch",        { ellipses },                               {} },
+        { "ticksToFramesBatch",     { ticks, "8475667200" },                    { 1 } },
+        { "framesToTicksBatch",     { frames, "30000/1001" },                   {} },
+        { "roundTicksToFrameBatch", { ticks, "8475667200" },                    {} },
+        { "ticksToTimecodeBatch",   { ticks, "8475667200" },                    { 1 } },
+        { "ticksToSecondsBatch",    { ticks },                                  {} },
+        { "addTicks",               { "914456685312000", "8475667200" },        {} },
+        { "subtractTicks",          { "914456685312000", "8475667200" },        {} },
+        { "callBatch",              { "addTicks\ts100\ts200\nticksToSecondsBatch\ts254016000000,508032000000\nfitEllipse\ts" + makeEllipsePoints(16, 0, 0) }, {} },
+        { "callChunked",            { chunkedCommand },                         {} },
+        { "readResultChunk",        {},                                         {}, chunkedResult },
+        { "parseJson",              { projectJson, "" },                        {} },
+        { "parseJsonFile",          { projectJsonPath, "/clips/3999" },         {} },
+        { "readProjectFile",        { projectXmlPath, "" },                     {} },
+        { "extractMetadata",        { nodeIds, itemMetadata, "" },              {} },
+        { "sessionSet",             { "sequences/names", clipNames },           { 600 } },
+        { "sessionGet",             { "sequences/names" },                      {} },
+        { "sessionGetBuffer",       { "clips/starts" },                         {}, storedBuffer },
+        { "sessionClear",           { "sequences/" },                           {} },
+        { "getIncludeBundle",       { "../../../Scripts/Premiere Pro", "ThioUtilsLib.jsx\nes5-shim.js" }, {} },
+        { "statPaths",              { "/tmp\n/tmp/ThioUtilsHost-project.json\n/tmp/missing.json" }, {} },
+        { "listFolder",             { "/tmp" },                                 {} },
+        { "reserveFileName",        { "/tmp", "ThioUtilsHost-project.json", "" }, { 0 } },
+        { "recordsToJson",          { "name,start,enabled,comment", records },  {} },
+        { "sortOrder",              { sortKeys },                               { 1 } },
+        { "evaluateKeyframes",      { keyframes, ticks },                       {} },
+        { "resampleKeyframes",      { keyframes, "10594584000" },               {} },
+        { "simplifyKeyframes",      { keyframes },                              { 0.001 } },
+        { "compilePattern",         { "~~\\d+~~$", "" },                        {} },
+        { "patternTestBatch",       { markerNames },                            {}, compiledPattern },
+        { "patternMatchBatch",      { markerNames },                            {}, compiledPattern },
+        { "patternReplaceBatch",    { markerNames, "" },                        {}, compiledPattern },
+        { "patternSplitBatch",      { markerNames },                            {}, compiledPattern },
+        { "containsIgnoreCaseBatch", { clipNames, ".wav" },                     {} },
+        { "cacheOpen",              { "/tmp/ThioUtilsHost-cache.bin" },         {} },
+        { "cachePut",               { projectJsonPath, "project", projectJson }, {} },
+        { "cacheGet",               { projectJsonPath, "project" },             {} },
+        { "startJob",               { "call", "addTicks\ts914456685312000\ts8475667200" }, {} },
+        { "pollJob",                {},                                         { 1 } },
+        { "getJobResult",           {},                                         {}, finishedJob },
+        { "getStats",               { "" },                                     {} },
+    };
+}
+
+// Fills argument storage for one export from its signature. Returns false for signature characters this host can't build.
+static bool buildArguments(const std::string& signature, const SampleArguments* sample, std::vector<std::string>& stringStorage, std::vector<TaggedData>& args) {
+    size_t nextString = 0, nextNumber = 0;
+    stringStorage.clear();
+    stringStorage.reserve(signature.size());
+    args.assign(signature.size(), TaggedData());
+
+    for (size_t i = 0; i < signature.size(); i++) {
+        TaggedData& arg = args[i];
+        const bool haveNumber = sample != nullptr && nextNumber < sample->numbers.size();
+        const double number = haveNumber ? sample->numbers[nextNumber] : 1.0;
+
+        switch (signature[i]) {
+        case 's':
+        case 'a':
+            stringStorage.push_back((sample != nullptr && nextString < sample->strings.size()) ? sample->strings[nextString] : "1,2,3");
+            nextString++;
+            arg.type = kTypeString;
+            arg.data.string = &stringStorage.back()[0];
+            break;
+        case 'd':
+            arg.type = kTypeInteger;
+            arg.data.intval = (long)number;
+            nextNumber++;
+            break;
+        case 'u':
+            arg.type = kTypeUInteger;
+            arg.data.intval = (long)number;
+            nextNumber++;
+            break;
+        case 'f':
+            arg.type = kTypeDouble;
+            arg.data.fltval = number;
+            nextNumber++;
+            break;
+        case 'b':
+            arg.type = kTypeBool;
+            arg.data.intval = number != 0 ? 1 : 0;
+            nextNumber++;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+static void freeResult(TaggedData& result, ESFreeMemFunction freeMem) {
+    if ((result.type == kTypeString || result.type == kTypeScript) && result.data.string != nullptr) {
+        freeMem(result.data.string);
+    }
+    result.type = kTypeUndefined;
+    result.data.string = nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Benchmark
+// ------------------------------------------------------------------------------------------------
+
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    const size_t index = std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <path to library .so> [iterations] [name filter]\n", argv[0]);
+        return 1;
+    }
+    const int iterations = (argc >= 3) ? std::max(1, atoi(argv[2])) : 2000;
+    const char* filter = (argc >= 4) ? argv[3] : nullptr;
+
+    library = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+    if (library == nullptr) {
+        fprintf(stderr, "Failed to load library: %s\n", dlerror());
+        return 1;
+    }
+
+    ESInitializeFunction initialize = (ESInitializeFunction)dlsym(library, "ESInitialize");
+    ESTerminateFunction terminate = (ESTerminateFunction)dlsym(library, "ESTerminate");
+    ESClientInterfaceFunction clientInterface = (ESClientInterfaceFunction)dlsym(library, "ESClientInterface");
+    freeMem = (ESFreeMemFunction)dlsym(library, "ESFreeMem");
+    if (initialize == nullptr || freeMem == nullptr) {
+        fprintf(stderr, "Library is missing ESInitialize or ESFreeMem\n");
+        return 1;
+    }
+
+    const char* nameList = initialize(nullptr, 0);
+    if (nameList == nullptr) {
+        fprintf(stderr, "ESInitialize returned no functions\n");
+        return 1;
+    }
+    SoServerInterface server = makeHostServer();
+    if (clientInterface != nullptr && clientInterface(kSoCClient_init, &server, nullptr) != kESErrOK) {
+        fprintf(stderr, "ESClientInterface failed\n");
+        return 1;
+    }
+
+    const std::vector<SampleArguments> samples = buildSampleArguments();
+
+    printf("%-26s %-6s %10s %10s %10s %10s %12s\n", "export", "sig", "p50 us", "p90 us", "p99 us", "max us", "allocs/call");
+
+    std::vector<std::string> skipped;
+    std::string names(nameList);
+    size_t position = 0;
+    while (position <= names.size()) {
+        size_t comma = names.find(',', position);
+        if (comma == std::string::npos) comma = names.size();
+        const std::string entry = names.substr(position, comma - position);
+        position = comma + 1;
+        if (entry.empty()) continue;
+
+        const size_t underscore = entry.find('_');
+        const std::string name = entry.substr(0, underscore);
+        const std::string signature = (underscore == std::string::npos) ? "" : entry.substr(underscore + 1);
+        if (filter != nullptr && name.find(filter) == std::string::npos) continue;
+
+        ESFunction function = (ESFunction)dlsym(library, name.c_str());
+        if (function == nullptr) {
+            printf("%-26s %-6s  not exported\n", name.c_str(), signature.c_str());
+            skipped.push_back(name);
+            continue;
+        }
+
+        const SampleArguments* sample = nullptr;
+        for (const SampleArguments& candidate : samples) {
+            if (name == candidate.name) sample = &candidate;
+        }
+
+        std::vector<std::string> stringStorage;
+        std::vector<TaggedData> args;
+        if (!buildArguments(signature, sample, stringStorage, args)) {
+            printf("%-26s %-6s  unsupported signature\n", name.c_str(), signature.c_str());
+            skipped.push_back(name);
+            continue;
+        }
+        auto setup = [&] { return sample == nullptr || !sample->setup || sample->setup(args); };
+
+        // Warm up, and check the call works at all
+        if (!setup()) {
+            printf("%-26s %-6s  setup failed\n", name.c_str(), signature.c_str());
+            skipped.push_back(name);
+            continue;
+        }
+        TaggedData result = {};
+        long error = function(args.data(), (long)args.size(), &result);
+        freeResult(result, freeMem);
+        if (error != kESErrOK) {
+            printf("%-26s %-6s  error %ld\n", name.c_str(), signature.c_str(), error);
+            skipped.push_back(name);
+            continue;
+        }
+
+        std::vector<double> micros;
+        micros.reserve(iterations);
+        unsigned long long allocations = 0;
+        for (int i = 0; i < iterations && setup(); i++) {
+            const unsigned long long allocationsBefore = allocationCount;
+            const auto start = std::chrono::steady_clock::now();
+            function(args.data(), (long)args.size(), &result);
+            const auto end = std::chrono::steady_clock::now();
+            allocations += allocationCount - allocationsBefore;
+            freeResult(result, freeMem);
+            micros.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        if (micros.size() < (size_t)iterations) {
+            printf("%-26s %-6s  setup failed after %zu calls\n", name.c_str(), signature.c_str(), micros.size());
+            skipped.push_back(name);
+            continue;
+        }
+        std::sort(micros.begin(), micros.end());
+
+        char allocationText[32] = "n/a";
+        if (ALLOCATION_COUNT_AVAILABLE) {
+            snprintf(allocationText, sizeof(allocationText), "%.2f", (double)allocations / iterations);
+        }
+        printf("%-26s %-6s %10.2f %10.2f %10.2f %10.2f %12s\n", name.c_str(), signature.c_str(),
+            percentile(micros, 0.50), percentile(micros, 0.90), percentile(micros, 0.99), micros.back(), allocationText);
+    }
+
+    releaseHostObjects();
+    if (clientInterface != nullptr) clientInterface(kSoCClient_term, &server, nullptr);
+    if (terminate != nullptr) terminate();
+    dlclose(library);
+
+    if (!skipped.empty()) {
+        std::string list;
+        for (const std::string& name : skipped) list += (list.empty() ? "" : ", ") + name;
+        printf("FAIL  %zu exports weren't benchmarked: %s\n", skipped.size(), list.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,447 @@
+// TimeMathBench.cpp
+// Checks the tick math exports (TimeMath.cpp) against the script fallbacks they replace, and times them.
+//
+// Built against the library sources:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/TimeMathBench.cpp *.cpp -o TimeMathBench -lpthread
+// Then run:
+//      ./TimeMathBench
+//
+// The fallbacks in ThioUtils.jsx work on Numbers: convertTimeObjectToNearestFrame rounds with '%', addTime and
+// subtractTime add and subtract Number(ticks), and framesToTicks multiplies. Here they're written out in doubles, which
+// is what ExtendScript computes, and the exports have to give the same results wherever those are exact, which is
+// for non-negative times below 2^53 ticks (about 9.8 hours). Past 2^53 and for negative times the exports are checked
+// against exact 128 bit results instead, and the table shows how often the script version was off.
+//
+// Timecode has no script fallback (the scripts ask Premiere through Time.getFormatted), so ticksToTimecodeBatch is
+// checked against fixed SMPTE values, drop frame and not, and every drop frame label of the first two hours at 29.97
+// and 59.94 is read back to its frame number.
+
+#include "Exports.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        printf("FAIL  %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static const long long TICKS_PER_SECOND = 254016000000LL;
+static const long long TWO_POW_53 = 1LL << 53;
+
+// Ticks per frame of the rates Premiere uses
+static const struct { const char* name; long long timebase; } rates[] = {
+    { "23.976", 10594584000LL },
+    { "24", 10584000000LL },
+    { "25", 10160640000LL },
+    { "29.97", 8475667200LL },
+    { "30", 8467200000LL },
+    { "50", 5080320000LL },
+    { "59.94", 4237833600LL },
+    { "60", 4233600000LL },
+};
+
+// ------------------------------------------------------------------------------------------------
+// The script fallbacks, in doubles
+// ------------------------------------------------------------------------------------------------
+
+// Number(ticks) of a tick string
+static double jsNumber(long long value) { return strtod(std::to_string(value).c_str(), nullptr); }
+
+// convertTimeObjectToNearestFrame
+static double jsNearestFrame(long long ticks, long long timebase) {
+    const double frameRateTicks = jsNumber(timebase);
+    double currentTicks = jsNumber(ticks);
+    const double remainder = std::fmod(currentTicks, frameRateTicks);
+    const double halfFrameduration = frameRateTicks / 2;
+    if (remainder < halfFrameduration) currentTicks -= remainder;
+    else currentTicks += (frameRateTicks - remainder);
+    return currentTicks;
+}
+
+// addTime, subtractTime, framesToTicks
+static double jsAdd(long long a, long long b) { return jsNumber(a) + jsNumber(b); }
+static double jsSubtract(long long a, long long b) { return jsNumber(a) - jsNumber(b); }
+static double jsFramesToTicks(long long frames, long long timebase) { return jsNumber(frames) * jsNumber(timebase); }
+
+// Whether a script result is exactly the integer the export gave
+static bool sameAsScript(double script, long long exact) {
+    return std::fabs(script) < 9.3e18 && script == (double)exact && (long long)script == exact;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Exact references
+// ------------------------------------------------------------------------------------------------
+
+static __int128 floorDivide(__int128 value, __int128 divisor) {
+    __int128 quotient = value / divisor;
+    if (value % divisor != 0 && (value < 0) != (divisor < 0)) quotient--;
+    return quotient;
+}
+
+// Frame index for rounding 0 (down), 1 (nearest, halfway up) or 2 (up)
+static long long exactFrame(long long ticks, long long timebase, int rounding) {
+    const __int128 frame = floorDivide(ticks, timebase);
+    const __int128 remainder = (__int128)ticks - frame * timebase;
+    if (remainder == 0 || rounding == 0) return (long long)frame;
+    if (rounding == 2) return (long long)(frame + 1);
+    return (long long)(remainder * 2 < timebase ? frame : frame + 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Calling the exports
+// ------------------------------------------------------------------------------------------------
+
+static TaggedData stringArg(const std::string& text) {
+    TaggedData arg;
+    arg.type = kTypeString;
+    arg.data.string = const_cast<char*>(text.c_str());
+    return arg;
+}
+
+static TaggedData integerArg(long value) {
+    TaggedData arg;
+    arg.type = kTypeInteger;
+    arg.data.intval = value;
+    return arg;
+}
+
+static TaggedData boolArg(bool value) {
+    TaggedData arg;
+    arg.type = kTypeBool;
+    arg.data.intval = value ? 1 : 0;
+    return arg;
+}
+
+// Calls an export and returns its result as text: the script for a script result, the string for a string result
+static long callExport(long (*function)(TaggedData*, long, TaggedData*), std::vector<TaggedData> args, std::string& out) {
+    TaggedData retval;
+    retval.type = kTypeUndefined;
+    const long err = function(args.data(), (long)args.size(), &retval);
+    out.clear();
+    if (err == kESErrOK && (retval.type == kTypeScript || retval.type == kTypeString)) {
+        out = retval.data.string;
+        ESFreeMem(retval.data.string);
+    }
+    return err;
+}
+
+// The values of a result array like [1,2] or ["1","2"], without the quotes
+static std::vector<std::string> arrayValues(const std::string& script) {
+    std::vector<std::string> values;
+    const size_t open = script.find('['), close = script.rfind(']');
+    if (open == std::string::npos || close == std::string::npos || close == open + 1) return values;
+    size_t start = open + 1;
+    while (start <= close) {
+        size_t end = script.find(',', start);
+        if (end == std::string::npos || end > close) end = close;
+        std::string value = script.substr(start, end - start);
+        if (value.size() >= 2 && value.front() == '"') value = value.substr(1, value.size() - 2);
+        values.push_back(value);
+        start = end + 1;
+    }
+    return values;
+}
+
+static std::string pack(const std::vector<long long>& values) {
+    std::string packed;
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) packed += ',';
+        packed += std::to_string(values[i]);
+    }
+    return packed;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Checks
+// ------------------------------------------------------------------------------------------------
+
+struct Counts {
+    long checked = 0;
+    long scriptOff = 0;     // Where the script fallback didn't give the exact result
+};
+
+static void printCounts(const char* what, const Counts& counts) {
+    printf("%-44s %10ld values  script off for %ld\n", what, counts.checked, counts.scriptOff);
+}
+
+// Ticks around 2^53 and up to near the 64 bit limit, both signs
+static std::vector<long long> largeTicks(std::mt19937_64& random) {
+    std::vector<long long> ticks;
+    for (long long offset = -3; offset <= 3; offset++) {
+        ticks.push_back(TWO_POW_53 + offset);
+        ticks.push_back(-TWO_POW_53 + offset);
+    }
+    for (int shift = 54; shift <= 61; shift++) {
+        for (int i = 0; i < 20; i++) {
+            const long long value = (long long)(random() >> (64 - shift));
+            ticks.push_back(value);
+            ticks.push_back(-value);
+        }
+    }
+    return ticks;
+}
+
+static void checkRounding(std::mt19937_64& random) {
+    Counts belowLimit, large, negative;
+    std::string script;
+
+    for (const auto& rate : rates) {
+        const long long timebase = rate.timebase;
+        const std::string timebaseText = std::to_string(timebase);
+
+        // Non-negative times below 2^53: frame boundaries, halfway points and either side of them, and random times
+        std::vector<long long> ticks;
+        for (long long frame : { 0LL, 1LL, 1799LL, 1800LL, 107892LL, 500000LL, (TWO_POW_53 / timebase) - 2 }) {
+            for (long long offset : { 0LL, 1LL, timebase / 2 - 1, timebase / 2, timebase / 2 + 1, timebase - 1 }) {
+                ticks.push_back(frame * timebase + offset);
+            }
+        }
+        for (int i = 0; i < 2000; i++) ticks.push_back((long long)(random() % (uint64_t)(TWO_POW_53 - timebase)));
+
+        check(callExport(roundTicksToFrameBatch, { stringArg(pack(ticks)), stringArg(timebaseText) }, script) == kESErrOK, "roundTicksToFrameBatch");
+        std::vector<std::string> rounded = arrayValues(script);
+        check(rounded.size() == ticks.size(), std::string("roundTicksToFrameBatch count at ") + rate.name);
+        for (size_t i = 0; i < rounded.size() && i < ticks.size(); i++) {
+            const long long value = atoll(rounded[i].c_str());
+            belowLimit.checked++;
+            check(sameAsScript(jsNearestFrame(ticks[i], timebase), value),
+                std::string("round ") + std::to_string(ticks[i]) + " at " + rate.name + ": got " + rounded[i]);
+            check(value == exactFrame(ticks[i], timebase, 1) * timebase, std::string("round ") + std::to_string(ticks[i]) + " to nearest");
+        }
+
+        // Past 2^53 and negative, against the exact result. The script rounds negative times toward zero, since '%'
+        // keeps the sign of the time.
+        ticks = largeTicks(random);
+        for (long long frame : { 1LL, 2LL, 1800LL, 107892LL }) {
+            for (long long offset : { 0LL, 1LL, timebase / 2 - 1, timebase / 2, timebase / 2 + 1, timebase - 1 }) {
+                ticks.push_back(-(frame * timebase) + offset);
+            }
+        }
+        check(callExport(roundTicksToFrameBatch, { stringArg(pack(ticks)), stringArg(timebaseText) }, script) == kESErrOK,
+            "roundTicksToFrameBatch past 2^53");
+        rounded = arrayValues(script);
+        check(rounded.size() == ticks.size(), std::string("roundTicksToFrameBatch count past 2^53 at ") + rate.name);
+        for (size_t i = 0; i < rounded.size() && i < ticks.size(); i++) {
+            const long long exact = exactFrame(ticks[i], timebase, 1) * timebase;
+            Counts& counts = (ticks[i] < 0 && ticks[i] > -TWO_POW_53) ? negative : large;
+            counts.checked++;
+            counts.scriptOff += !sameAsScript(jsNearestFrame(ticks[i], timebase), exact);
+            check(atoll(rounded[i].c_str()) == exact, std::string("round ") + std::to_string(ticks[i]) + " at " + rate.name + ": got " + rounded[i]);
+        }
+
+        // Frame indexes in each rounding mode
+        for (int rounding = 0; rounding <= 2; rounding++) {
+            check(callExport(ticksToFramesBatch, { stringArg(pack(ticks)), stringArg(timebaseText), integerArg(rounding) }, script) == kESErrOK,
+                "ticksToFramesBatch");
+            const std::vector<std::string> frames = arrayValues(script);
+            bool same = frames.size() == ticks.size();
+            for (size_t i = 0; same && i < frames.size(); i++) same = atoll(frames[i].c_str()) == exactFrame(ticks[i], timebase, rounding);
+            check(same, std::string("ticksToFramesBatch rounding ") + std::to_string(rounding) + " at " + rate.name);
+        }
+    }
+
+    check(callExport(roundTicksToFrameBatch, { stringArg("0"), stringArg("0") }, script) == kESErrBadArgumentList, "zero timebase rejected");
+    check(callExport(roundTicksToFrameBatch, { stringArg(std::to_string(LLONG_MAX)), stringArg("8475667200") }, script) == kESErrRange,
+        "rounding past the 64 bit limit rejected");
+    check(callExport(ticksToFramesBatch, { stringArg("0"), stringArg("30000/1001"), integerArg(3) }, script) == kESErrRange, "unknown rounding rejected");
+
+    printCounts("nearest frame, 0 to 2^53", belowLimit);
+    printCounts("nearest frame, negative", negative);
+    printCounts("nearest frame, past 2^53", large);
+}
+
+static void checkArithmetic(std::mt19937_64& random) {
+    Counts belowLimit, large;
+    std::string result;
+
+    // Sums and differences that stay below 2^53 either way, where the script is exact
+    std::vector<std::pair<long long, long long>> pairs = { { 0, 0 }, { 1, -1 }, { -254016000000LL, 8475667200LL },
+        { TWO_POW_53 / 2, TWO_POW_53 / 2 - 1 }, { -(TWO_POW_53 / 2), -(TWO_POW_53 / 2) + 1 } };
+    for (int i = 0; i < 2000; i++) {
+        pairs.push_back({ (long long)(random() % (uint64_t)TWO_POW_53) - TWO_POW_53 / 2, (long long)(random() % (uint64_t)TWO_POW_53) - TWO_POW_53 / 2 });
+    }
+    for (const auto& pair : pairs) {
+        const std::string a = std::to_string(pair.first), b = std::to_string(pair.second);
+        check(callExport(addTicks, { stringArg(a), stringArg(b) }, result) == kESErrOK, "addTicks");
+        check(sameAsScript(jsAdd(pair.first, pair.second), atoll(result.c_str())), "addTicks " + a + " + " + b + ": got " + result);
+        check(callExport(subtractTicks, { stringArg(a), stringArg(b) }, result) == kESErrOK, "subtractTicks");
+        check(sameAsScript(jsSubtract(pair.first, pair.second), atoll(result.c_str())), "subtractTicks " + a + " - " + b + ": got " + result);
+        belowLimit.checked += 2;
+    }
+
+    // Around and past 2^53, against 128 bit sums
+    const std::vector<long long> ticks = largeTicks(random);
+    for (size_t i = 0; i + 1 < ticks.size(); i++) {
+        const long long a = ticks[i], b = ticks[i + 1] / 2;
+        const __int128 sum = (__int128)a + b, difference = (__int128)a - b;
+        check(callExport(addTicks, { stringArg(std::to_string(a)), stringArg(std::to_string(b)) }, result) == kESErrOK, "addTicks past 2^53");
+        check(result == std::to_string((long long)sum), "addTicks " + std::to_string(a) + " + " + std::to_string(b) + ": got " + result);
+        check(callExport(subtractTicks, { stringArg(std::to_string(a)), stringArg(std::to_string(b)) }, result) == kESErrOK, "subtractTicks past 2^53");
+        check(result == std::to_string((long long)difference), "subtractTicks " + std::to_string(a) + " - " + std::to_string(b) + ": got " + result);
+        large.checked += 2;
+        large.scriptOff += !sameAsScript(jsAdd(a, b), (long long)sum) + !sameAsScript(jsSubtract(a, b), (long long)difference);
+    }
+
+    // 2^53 + 1 is the first tick count a Number can't hold
+    check(callExport(addTicks, { stringArg("9007199254740992"), stringArg("1") }, result) == kESErrOK && result == "9007199254740993", "2^53 + 1");
+    check(!sameAsScript(jsAdd(TWO_POW_53, 1), TWO_POW_53 + 1), "the script can't hold 2^53 + 1");
+    check(callExport(addTicks, { stringArg(std::to_string(LLONG_MAX)), stringArg("1") }, result) == kESErrRange, "addTicks overflow rejected");
+    check(callExport(subtractTicks, { stringArg(std::to_string(LLONG_MIN)), stringArg("1") }, result) == kESErrRange, "subtractTicks overflow rejected");
+    check(callExport(addTicks, { stringArg("12x"), stringArg("1") }, result) == kESErrConversion, "addTicks of text rejected");
+
+    // Frames to ticks
+    for (const auto& rate : rates) {
+        std::vector<long long> frames = { 0, 1, -1, 1800, -1800, TWO_POW_53 / rate.timebase, LLONG_MAX / rate.timebase, -(LLONG_MAX / rate.timebase) };
+        for (int i = 0; i < 200; i++) frames.push_back((long long)(random() % (uint64_t)(TWO_POW_53 / rate.timebase)));
+        check(callExport(framesToTicksBatch, { stringArg(pack(frames)), stringArg(std::to_string(rate.timebase)) }, result) == kESErrOK, "framesToTicksBatch");
+        const std::vector<std::string> values = arrayValues(result);
+        check(values.size() == frames.size(), std::string("framesToTicksBatch count at ") + rate.name);
+        for (size_t i = 0; i < values.size() && i < frames.size(); i++) {
+            const long long exact = frames[i] * rate.timebase;
+            check(atoll(values[i].c_str()) == exact, std::string("frames to ticks ") + std::to_string(frames[i]) + " at " + rate.name);
+            Counts& counts = (std::llabs(exact) < TWO_POW_53) ? belowLimit : large;
+            counts.checked++;
+            if (&counts == &belowLimit) check(sameAsScript(jsFramesToTicks(frames[i], rate.timebase), exact), "framesToTicks below 2^53");
+            else counts.scriptOff += !sameAsScript(jsFramesToTicks(frames[i], rate.timebase), exact);
+        }
+        check(callExport(framesToTicksBatch, { stringArg(std::to_string(LLONG_MAX / rate.timebase + 1)), stringArg(std::to_string(rate.timebase)) },
+            result) == kESErrRange, "framesToTicksBatch overflow rejected");
+    }
+
+    // Seconds: within one unit in the last place of the script's division below 2^53, and closer to the exact value past it
+    std::vector<long long> secondsTicks = ticks;
+    for (int i = 0; i < 500; i++) secondsTicks.push_back((long long)(random() % (uint64_t)TWO_POW_53) - TWO_POW_53 / 2);
+    check(callExport(ticksToSecondsBatch, { stringArg(pack(secondsTicks)) }, result) == kESErrOK, "ticksToSecondsBatch");
+    const std::vector<std::string> seconds = arrayValues(result);
+    check(seconds.size() == secondsTicks.size(), "ticksToSecondsBatch count");
+    for (size_t i = 0; i < seconds.size() && i < secondsTicks.size(); i++) {
+        const double value = strtod(seconds[i].c_str(), nullptr);
+        const long double exact = (long double)secondsTicks[i] / TICKS_PER_SECOND;
+        const double script = jsNumber(secondsTicks[i]) / (double)TICKS_PER_SECOND;
+        if (std::llabs(secondsTicks[i]) < TWO_POW_53) {
+            check(std::fabs(value - script) <= std::fabs(script) * 2.3e-16, "seconds of " + std::to_string(secondsTicks[i]));
+        }
+        else {
+            check(std::fabs((long double)value - exact) <= std::fabs((long double)script - exact), "seconds of " + std::to_string(secondsTicks[i]) + " past 2^53");
+        }
+    }
+
+    printCounts("add, subtract, frames to ticks, below 2^53", belowLimit);
+    printCounts("add, subtract, frames to ticks, past 2^53", large);
+}
+
+static void checkTimecode() {
+    const long long ntsc = 8475667200LL, ntsc60 = 4237833600LL;
+    static const struct { long long ticks; long long timebase; bool dropFrame; const char* expected; } cases[] = {
+        { 0, ntsc, true, "00;00;00;00" },
+        { 1799 * ntsc, ntsc, true, "00;00;59;29" },
+        { 1800 * ntsc, ntsc, true, "00;01;00;02" },             // ;00 and ;01 are dropped at the start of each minute
+        { 1800 * ntsc + ntsc - 1, ntsc, true, "00;01;00;02" },  // Times inside a frame show that frame
+        { 3598 * ntsc, ntsc, true, "00;02;00;02" },
+        { 17981 * ntsc, ntsc, true, "00;09;59;29" },
+        { 17982 * ntsc, ntsc, true, "00;10;00;00" },            // except every tenth minute
+        { 19782 * ntsc, ntsc, true, "00;11;00;02" },
+        { 107892 * ntsc, ntsc, true, "01;00;00;00" },
+        { 2589407 * ntsc, ntsc, true, "23;59;59;29" },
+        { 17982 * ntsc, ntsc, false, "00:09:59:12" },
+        { 107892 * ntsc, ntsc, false, "00:59:56:12" },
+        { 3599 * ntsc60, ntsc60, true, "00;00;59;59" },
+        { 3600 * ntsc60, ntsc60, true, "00;01;00;04" },
+        { 35964 * ntsc60, ntsc60, true, "00;10;00;00" },
+        { 215784 * ntsc60, ntsc60, true, "01;00;00;00" },
+        { 2159999 * 10160640000LL, 10160640000LL, true, "23:59:59:24" },   // Drop frame only applies to 29.97 and 59.94
+        { 1440 * 10594584000LL, 10594584000LL, true, "00:01:00:00" },
+        { 3600 * 4233600000LL, 4233600000LL, true, "00:01:00:00" },
+        { -1, ntsc, false, "-00:00:00:01" },
+        { -1800 * ntsc, ntsc, false, "-00:01:00:00" },
+        { -1800 * ntsc, ntsc, true, "-00;01;00;02" },
+        { TWO_POW_53 + 1, ntsc, false, "09:50:23:22" },
+        { TWO_POW_53 + 1, ntsc, true, "09;50;59;04" },
+        { LLONG_MAX, ntsc, true, "10086;10;37;10" },
+        { LLONG_MIN, ntsc, false, "-10076:05:27:05" },
+    };
+
+    std::string script;
+    for (const auto& c : cases) {
+        check(callExport(ticksToTimecodeBatch, { stringArg(std::to_string(c.ticks)), stringArg(std::to_string(c.timebase)), boolArg(c.dropFrame) }, script) == kESErrOK,
+            "ticksToTimecodeBatch");
+        const std::vector<std::string> values = arrayValues(script);
+        check(values.size() == 1 && values[0] == c.expected, "timecode of " + std::to_string(c.ticks) + " at " + std::to_string(c.timebase) +
+            (c.dropFrame ? " DF" : " NDF") + ": got " + (values.empty() ? script : values[0]) + ", expected " + c.expected);
+    }
+
+    // Every label of the first two hours of drop frame, read back to its frame number
+    for (long long timebase : { ntsc, ntsc60 }) {
+        const long long fps = (TICKS_PER_SECOND + timebase / 2) / timebase, dropped = fps / 15;
+        const long long frameCount = 2 * 3600 * TICKS_PER_SECOND / timebase;
+        long long wrong = 0;
+        for (long long first = 0; first < frameCount; first += 10000) {
+            std::vector<long long> ticks;
+            for (long long frame = first; frame < std::min(first + 10000, frameCount); frame++) ticks.push_back(frame * timebase);
+            check(callExport(ticksToTimecodeBatch, { stringArg(pack(ticks)), stringArg(std::to_string(timebase)), boolArg(true) }, script) == kESErrOK,
+                "ticksToTimecodeBatch drop frame");
+            const std::vector<std::string> labels = arrayValues(script);
+            for (size_t i = 0; i < labels.size() && i < ticks.size(); i++) {
+                int h = 0, m = 0, s = 0, f = 0;
+                const bool parsed = sscanf(labels[i].c_str(), "%d;%d;%d;%d", &h, &m, &s, &f) == 4;
+                const long long minutes = h * 60LL + m;
+                const long long frame = (h * 3600LL + m * 60LL + s) * fps + f - dropped * (minutes - minutes / 10);
+                const bool droppedLabel = s == 0 && f < dropped && m % 10 != 0;
+                wrong += !parsed || droppedLabel || frame != first + (long long)i;
+            }
+        }
+        check(wrong == 0, std::to_string(wrong) + " drop frame labels at " + std::to_string(timebase) + " don't read back to their frame");
+        printf("%-44s %10lld labels read back\n", timebase == ntsc ? "drop frame 29.97, two hours" : "drop frame 59.94, two hours", frameCount);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Timing
+// ------------------------------------------------------------------------------------------------
+
+static void timeExports(std::mt19937_64& random) {
+    std::vector<long long> ticks;
+    for (int i = 0; i < 100000; i++) ticks.push_back((long long)(random() % (uint64_t)(4 * TWO_POW_53)));
+    const std::string packed = pack(ticks), timebase = "8475667200";
+    std::string script;
+
+    printf("\n%-24s %16s\n", "100000 ticks", "ns per value");
+    const struct { const char* name; std::vector<TaggedData> args; long (*function)(TaggedData*, long, TaggedData*); } exports[] = {
+        { "roundTicksToFrameBatch", { stringArg(packed), stringArg(timebase) }, roundTicksToFrameBatch },
+        { "ticksToFramesBatch", { stringArg(packed), stringArg(timebase), integerArg(0) }, ticksToFramesBatch },
+        { "ticksToTimecodeBatch", { stringArg(packed), stringArg(timebase), boolArg(true) }, ticksToTimecodeBatch },
+        { "ticksToSecondsBatch", { stringArg(packed) }, ticksToSecondsBatch },
+    };
+    for (const auto& e : exports) {
+        double best = 1e300;
+        for (int round = 0; round < 5; round++) {
+            const auto start = std::chrono::steady_clock::now();
+            callExport(e.function, e.args, script);
+            best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+        printf("%-24s %16.1f\n", e.name, best / ticks.size());
+    }
+}
+
+int main() {
+    std::mt19937_64 random(53);
+    checkRounding(random);
+    checkArithmetic(random);
+    checkTimecode();
+    timeExports(random);
+
+    printf(failures ? "%d failures\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
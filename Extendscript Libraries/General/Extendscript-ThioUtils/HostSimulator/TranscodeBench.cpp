@@ -0,0 +1,182 @@
+// TranscodeBench.cpp
+// Checks and benchmarks the UTF-8 to UTF-16 transcoder (TextEncoding.cpp) outside the Adobe apps.
+//
+// The transcoder isn't exported, so rather than going through the library this is built directly against its source:
+//      g++ -std=c++17 -O2 -I. -IInclude HostSimulator/TranscodeBench.cpp TextEncoding.cpp -o TranscodeBench
+// Then run:
+//      ./TranscodeBench [megabytes per corpus, default 8]
+//
+// It first checks a set of known conversions, including every kind of malformed input, then checks utf8ToUtf16
+// against utf8ToUtf16Reference on random bytes. Then it times both on ASCII, Latin, CJK and mixed text at clipboard
+// sizes from a short string up to a multi-megabyte payload.
+
+#include "TextEncoding.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+// Correctness
+// ------------------------------------------------------------------------------------------------
+
+struct KnownConversion {
+    const char* description;
+    std::string utf8;
+    std::u16string utf16;
+    size_t invalidSequences;
+};
+
+static std::vector<KnownConversion> knownConversions() {
+    return {
+        { "empty",                      "",                         u"",                            0 },
+        { "ASCII",                      "Sequence 01",              u"Sequence 01",                 0 },
+        { "2-byte",                     "caf\xC3\xA9",              u"café",                   0 },
+        { "3-byte",                     "\xE2\x82\xAC 5",           u"€ 5",                    0 },
+        { "CJK",                        "\xE6\x97\xA5\xE6\x9C\xAC", u"日本",                0 },
+        { "4-byte (surrogate pair)",    "\xF0\x9F\x98\x80",         u"\U0001F600",                  0 },
+        { "highest code point",         "\xF4\x8F\xBF\xBF",         u"\U0010FFFF",                  0 },
+        { "stray continuation",         "a\x80" "b",                u"a�b",                    1 },
+        { "invalid lead bytes",         "\xC0\xC1\xF5\xFF",         u"����",    4 },
+        { "overlong 3-byte",            "\xE0\x80\x80",             u"���",          3 },
+        { "encoded surrogate",          "\xED\xA0\x80",             u"���",          3 },
+        { "past U+10FFFF",              "\xF4\x90\x80\x80",         u"����",    4 },
+        { "truncated at end",           "ab\xE6\x97",               u"ab�",                    1 },
+        { "truncated before ASCII",     "\xF0\x9F\x98" "x",         u"�x",                     1 },
+        { "ASCII block then invalid",   "0123456789abcdefgh\xFFij", u"0123456789abcdefgh�ij",  1 },
+    };
+}
+
+static bool convertBoth(const std::string& utf8, std::u16string& fast, std::u16string& reference, Utf16Conversion& fastResult, Utf16Conversion& referenceResult) {
+    fast.assign(utf8.size(), u'\0');
+    reference.assign(utf8.size(), u'\0');
+    fastResult = utf8ToUtf16(utf8.data(), utf8.size(), &fast[0]);
+    referenceResult = utf8ToUtf16Reference(utf8.data(), utf8.size(), &reference[0]);
+    fast.resize(fastResult.length);
+    reference.resize(referenceResult.length);
+    return fast == reference && fastResult.invalidSequences == referenceResult.invalidSequences;
+}
+
+static int checkConversions() {
+    int failures = 0;
+    std::u16string fast, reference;
+    Utf16Conversion fastResult, referenceResult;
+
+    for (const KnownConversion& known : knownConversions()) {
+        const bool same = convertBoth(known.utf8, fast, reference, fastResult, referenceResult);
+        if (!same || reference != known.utf16 || referenceResult.invalidSequences != known.invalidSequences) {
+            printf("FAIL  %s\n", known.description);
+            failures++;
+        }
+    }
+
+    // Random bytes, weighted towards the byte values that matter, at lengths around the 16 byte block size
+    static const unsigned char interesting[] = { 'a', 0x7F, 0x80, 0xBF, 0xC2, 0xDF, 0xE0, 0xED, 0xEF, 0xF0, 0xF4, 0xF5, 0xFF, 0xA0, 0x9F, 0x8F, 0x90 };
+    std::mt19937 random(12345);
+    std::string utf8;
+    for (int iteration = 0; iteration < 200000; iteration++) {
+        utf8.resize(random() % 48);
+        for (char& c : utf8) {
+            c = (random() % 3 == 0) ? (char)(random() % 256) : (char)interesting[random() % sizeof(interesting)];
+        }
+        if (!convertBoth(utf8, fast, reference, fastResult, referenceResult)) {
+            printf("FAIL  random input #%d differs from the reference\n", iteration);
+            failures++;
+            break;
+        }
+    }
+
+    // Mostly valid text, ASCII runs between characters of every length, so blocks switch between the ASCII and
+    // character-at-a-time paths and characters straddle block ends. Sometimes a byte is cut or replaced.
+    static const char* pieces[] = { "a", "clip ", "00:01:02:03 ", "\xC3\xA9", "\xD0\x96", "\xE6\x97\xA5", "\xEF\xBF\xBD",
+        "\xE0\xA0\x80", "\xED\x9F\xBF", "\xF0\x9F\x8E\xAC", "\xF4\x8F\xBF\xBF" };
+    for (int iteration = 0; iteration < 200000; iteration++) {
+        const size_t target = random() % 80;
+        utf8.clear();
+        while (utf8.size() < target) {
+            utf8 += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        if (!utf8.empty() && random() % 4 == 0) {
+            utf8[random() % utf8.size()] = (char)(random() % 256);
+        }
+        if (!convertBoth(utf8, fast, reference, fastResult, referenceResult)) {
+            printf("FAIL  random text #%d differs from the reference\n", iteration);
+            failures++;
+            break;
+        }
+    }
+
+    printf("%s: %zu known conversions, 200000 random inputs and 200000 random texts\n\n", failures ? "FAILED" : "OK", knownConversions().size());
+    return failures;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Benchmark
+// ------------------------------------------------------------------------------------------------
+
+// Repeats sample words until the corpus is 'bytes' long, cutting at a character boundary
+static std::string makeCorpus(const std::vector<std::string>& words, size_t bytes) {
+    std::string corpus;
+    std::mt19937 random(42);
+    while (corpus.size() < bytes) {
+        corpus += words[random() % words.size()];
+    }
+    while (corpus.size() > bytes) {
+        corpus.pop_back();
+        while (!corpus.empty() && ((unsigned char)corpus.back() & 0xC0) == 0x80) corpus.pop_back();
+        if (!corpus.empty() && (unsigned char)corpus.back() >= 0xC0) corpus.pop_back();
+    }
+    return corpus;
+}
+
+typedef Utf16Conversion (*Transcoder)(const char*, size_t, char16_t*);
+
+// Returns MB/s of input converted
+static double measure(Transcoder transcoder, const std::string& input, std::u16string& output) {
+    output.resize(input.size());
+    const size_t targetBytes = 256u << 20;
+    const size_t repeats = input.empty() ? 1 : (targetBytes / input.size() + 1);
+    const auto start = std::chrono::steady_clock::now();
+    size_t units = 0;
+    for (size_t r = 0; r < repeats; r++) {
+        units += transcoder(input.data(), input.size(), &output[0]).length;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (units == 0 && !input.empty()) printf(" ");  // Keeps the calls from being optimized out
+    return (double)input.size() * repeats / (1 << 20) / seconds;
+}
+
+int main(int argc, char** argv) {
+    const double megabytes = (argc > 1) ? atof(argv[1]) : 8.0;
+
+    if (checkConversions() != 0) {
+        return 1;
+    }
+
+    struct Corpus {
+        const char* name;
+        std::vector<std::string> words;
+    };
+    const std::vector<Corpus> corpora = {
+        { "ASCII",  { "Sequence ", "01 ", "Clip_0042.mov ", "V1 ", "00:01:02:03 ", "Marker ", "Lumetri Color ", "\n" } },
+        { "Latin",  { "S\xC3\xA9quence ", "d\xC3\xA9j\xC3\xA0 ", "Gr\xC3\xB6\xC3\x9F" "e ", "clip ", "\xC3\xA9t\xC3\xA9 ", "mont\xC3\xA9" "e ", "\n" } },
+        { "CJK",    { "\xE3\x82\xB7\xE3\x83\xBC\xE3\x82\xB1\xE3\x83\xB3\xE3\x82\xB9", "\xE6\x97\xA5\xE6\x9C\xAC", "\xE7\xB7\xA8\xE9\x9B\x86", "\xED\x81\xB4\xEB\xA6\xBD", "\xE4\xB8\xAD\xE6\x96\x87" } },
+        { "Mixed",  { "Clip ", "\xE6\x97\xA5\xE6\x9C\xAC ", "caf\xC3\xA9 ", "\xF0\x9F\x8E\xAC ", "00:01:02:03 ", "\xE2\x80\x94 " } },
+    };
+    const size_t sizes[] = { 64, 4096, (size_t)(megabytes * (1 << 20)) };
+
+    printf("%-8s %12s %16s %16s %8s\n", "corpus", "bytes", "reference MB/s", "fast MB/s", "speedup");
+    std::u16string output;
+    for (const Corpus& corpus : corpora) {
+        for (size_t size : sizes) {
+            const std::string input = makeCorpus(corpus.words, size);
+            const double reference = measure(utf8ToUtf16Reference, input, output);
+            const double fast = measure(utf8ToUtf16, input, output);
+            printf("%-8s %12zu %16.0f %16.0f %7.2fx\n", corpus.name, input.size(), reference, fast, fast / reference);
+        }
+    }
+    return 0;
+}
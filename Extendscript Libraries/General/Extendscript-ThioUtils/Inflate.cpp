@@ -0,0 +1,426 @@
+#include "Inflate.h"
+#include "Checksum.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#define INPUT_BUFFER_BYTES (256 * 1024)
+#define OUTPUT_CHUNK_BYTES (256 * 1024)
+#define WINDOW_BYTES 32768
+#define MAX_MATCH_BYTES 258
+#define MAX_CODE_BITS 15
+
+// Flag bits in the gzip header
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+#define GZIP_RESERVED 0xE0
+
+namespace {
+
+// Base values and extra bits for length codes 257..285 and distance codes 0..29 (RFC 1951, 3.2.5)
+const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Order the code length code lengths are stored in (RFC 1951, 3.2.7)
+const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// Buffered input, read least significant bit first as DEFLATE stores it
+class BitReader {
+public:
+    BitReader(FILE* file, std::atomic<uint64_t>* progress) : file(file), progress(progress), buffer(INPUT_BUFFER_BYTES) {}
+
+    // Makes at least 'count' (up to 56) bits available. Past the end of the file the missing bits read as zero, and
+    // overrun() reports it once any of them are consumed.
+    void need(unsigned count) {
+        while (available < count) {
+            while (available <= 56 && position < end) {
+                bits |= (uint64_t)buffer[position++] << available;
+                available += 8;
+            }
+            if (available < count && position == end && !refill()) {
+                padding += 8;
+                available += 8;
+            }
+        }
+    }
+
+    uint32_t peek(unsigned count) const { return (uint32_t)(bits & ((1ULL << count) - 1)); }
+
+    void consume(unsigned count) {
+        bits >>= count;
+        available -= count;
+    }
+
+    uint32_t read(unsigned count) {
+        if (count == 0) return 0;
+        need(count);
+        const uint32_t value = peek(count);
+        consume(count);
+        return value;
+    }
+
+    void alignToByte() { consume(available % 8); }
+
+    // Reads a whole byte, after alignToByte. Returns false at the end of the file.
+    bool readByte(uint8_t& byte) {
+        const uint64_t realBits = (available > padding) ? available - padding : 0;
+        if (realBits >= 8) {
+            byte = (uint8_t)bits;
+            consume(8);
+            return true;
+        }
+        if (available > 0) return false; // Only padding left
+        if (position == end && !refill()) return false;
+        byte = buffer[position++];
+        return true;
+    }
+
+    // Consumed bits past the end of the file
+    bool overrun() const { return available < padding; }
+    bool ioError() const { return failed; }
+
+private:
+    FILE* file;
+    std::atomic<uint64_t>* progress;
+    std::vector<uint8_t> buffer;
+    size_t position = 0;
+    size_t end = 0;
+    uint64_t bits = 0;
+    unsigned available = 0;
+    uint64_t padding = 0;
+    uint64_t totalRead = 0;
+    bool failed = false;
+
+    bool refill() {
+        if (failed) return false;
+        end = fread(buffer.data(), 1, buffer.size(), file);
+        position = 0;
+        if (end == 0) {
+            failed = ferror(file) != 0;
+            return false;
+        }
+        totalRead += end;
+        if (progress != nullptr) progress->store(totalRead, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+// Canonical Huffman code, decoded with a single lookup on the next 'bits' input bits
+struct HuffmanTable {
+    uint16_t entries[1 << MAX_CODE_BITS]; // Symbol << 4 | code length, or 0 where no code matches
+    unsigned bits = 0;
+
+    // Returns false if the lengths describe more codes than fit (an over-subscribed code). Incomplete codes are
+    // allowed, and reading one of their missing codes fails in decode.
+    bool build(const uint8_t* lengths, unsigned count) {
+        unsigned lengthCount[MAX_CODE_BITS + 1] = {};
+        for (unsigned i = 0; i < count; i++) lengthCount[lengths[i]]++;
+        lengthCount[0] = 0;
+
+        int left = 1;
+        bits = 0;
+        for (unsigned length = 1; length <= MAX_CODE_BITS; length++) {
+            left = (left << 1) - (int)lengthCount[length];
+            if (left < 0) return false;
+            if (lengthCount[length] != 0) bits = length;
+        }
+        if (bits == 0) bits = 1; // No codes at all, e.g. a distance code in a block of only literals
+        memset(entries, 0, sizeof(uint16_t) << bits);
+
+        unsigned nextCode[MAX_CODE_BITS + 1];
+        unsigned code = 0;
+        for (unsigned length = 1; length <= MAX_CODE_BITS; length++) {
+            code = (code + lengthCount[length - 1]) << 1;
+            nextCode[length] = code;
+        }
+        for (unsigned symbol = 0; symbol < count; symbol++) {
+            const unsigned length = lengths[symbol];
+            if (length == 0) continue;
+            // Codes are stored most significant bit first, so the table index is the code reversed
+            unsigned reversed = 0;
+            for (unsigned c = nextCode[length]++, i = 0; i < length; i++, c >>= 1) reversed = (reversed << 1) | (c & 1);
+            for (unsigned index = reversed; index < (1U << bits); index += 1U << length) {
+                entries[index] = (uint16_t)(symbol << 4 | length);
+            }
+        }
+        return true;
+    }
+
+    // Returns the next symbol, or -1 for a code that isn't in the table
+    int decode(BitReader& in) const {
+        in.need(bits);
+        const uint16_t entry = entries[in.peek(bits)];
+        if (entry == 0) return -1;
+        in.consume(entry & 15);
+        return entry >> 4;
+    }
+};
+
+// Decompressed data: the last WINDOW_BYTES for matches to copy from, then new output that goes to the sink a chunk at a time
+class Output {
+public:
+    explicit Output(InflateSink& sink) : sink(sink), data(WINDOW_BYTES + OUTPUT_CHUNK_BYTES + MAX_MATCH_BYTES + 8) {}
+
+    bool full() const { return position >= WINDOW_BYTES + OUTPUT_CHUNK_BYTES; }
+    size_t history() const { return position; }
+
+    void put(uint8_t byte) { data[position++] = byte; }
+
+    // Copies 'length' bytes from 'distance' back, which may overlap what it writes
+    void copy(size_t distance, size_t length) {
+        uint8_t* dest = data.data() + position;
+        const uint8_t* source = dest - distance;
+        position += length;
+        if (distance >= 8) {
+            // Can write up to 7 bytes past the match, into the spare room at the end of the buffer
+            for (size_t i = 0; i < length; i += 8) memcpy(dest + i, source + i, 8);
+        }
+        else {
+            for (size_t i = 0; i < length; i++) dest[i] = source[i];
+        }
+    }
+
+    // Sends the new output to the sink and keeps the window. Returns false if the sink asks to stop.
+    bool flush() {
+        const size_t length = position - flushed;
+        if (length > 0) {
+            crc = crc32Update(crc, data.data() + flushed, length);
+            total += length;
+            if (!sink.write(reinterpret_cast<const char*>(data.data() + flushed), length)) return false;
+        }
+        const size_t keep = (position < WINDOW_BYTES) ? position : WINDOW_BYTES;
+        memmove(data.data(), data.data() + position - keep, keep);
+        position = keep;
+        flushed = keep;
+        return true;
+    }
+
+    // Starts a new gzip member, which can't refer back into the previous one
+    void reset() {
+        position = 0;
+        flushed = 0;
+        crc = 0;
+        total = 0;
+    }
+
+    uint32_t crc = 0;
+    uint64_t total = 0;
+
+private:
+    InflateSink& sink;
+    std::vector<uint8_t> data;
+    size_t position = 0;
+    size_t flushed = 0;
+};
+
+struct Decoder {
+    HuffmanTable literals;
+    HuffmanTable distances;
+    HuffmanTable fixedLiterals;
+    HuffmanTable fixedDistances;
+    bool fixedBuilt = false;
+
+    void buildFixedTables() {
+        if (fixedBuilt) return;
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        fixedLiterals.build(lengths, 288);
+        memset(lengths, 5, 30);
+        fixedDistances.build(lengths, 30);
+        fixedBuilt = true;
+    }
+
+    // Reads the code lengths of a dynamic block and builds its tables (RFC 1951, 3.2.7)
+    bool readDynamicTables(BitReader& in) {
+        const unsigned literalCount = in.read(5) + 257;
+        const unsigned distanceCount = in.read(5) + 1;
+        const unsigned codeLengthCount = in.read(4) + 4;
+        if (literalCount > 286 || distanceCount > 30) return false;
+
+        uint8_t codeLengthLengths[19] = {};
+        for (unsigned i = 0; i < codeLengthCount; i++) codeLengthLengths[codeLengthOrder[i]] = (uint8_t)in.read(3);
+        if (!literals.build(codeLengthLengths, 19)) return false; // The literal table holds the code length code for now
+
+        uint8_t lengths[286 + 30];
+        const unsigned total = literalCount + distanceCount;
+        unsigned count = 0;
+        while (count < total) {
+            const int symbol = literals.decode(in);
+            if (symbol < 0) return false;
+            if (symbol < 16) {
+                lengths[count++] = (uint8_t)symbol;
+                continue;
+            }
+            uint8_t repeated = 0;
+            unsigned repeat;
+            if (symbol == 16) {
+                if (count == 0) return false;
+                repeated = lengths[count - 1];
+                repeat = 3 + in.read(2);
+            }
+            else if (symbol == 17) {
+                repeat = 3 + in.read(3);
+            }
+            else {
+                repeat = 11 + in.read(7);
+            }
+            if (count + repeat > total) return false;
+            memset(lengths + count, repeated, repeat);
+            count += repeat;
+        }
+        if (lengths[256] == 0) return false; // A block always ends with the end of block code
+        return literals.build(lengths, literalCount) && distances.build(lengths + literalCount, distanceCount) && !in.overrun();
+    }
+};
+
+InflateResult corruptOrIOError(const BitReader& in) {
+    return in.ioError() ? kInflateIOError : kInflateCorrupt;
+}
+
+// Decodes the compressed blocks of one member
+InflateResult inflateBlocks(BitReader& in, Decoder& decoder, Output& out) {
+    bool finalBlock;
+    do {
+        finalBlock = in.read(1) != 0;
+        const uint32_t type = in.read(2);
+
+        if (type == 0) {
+            // Stored
+            in.alignToByte();
+            uint8_t header[4];
+            for (uint8_t& byte : header) {
+                if (!in.readByte(byte)) return corruptOrIOError(in);
+            }
+            const unsigned length = header[0] | header[1] << 8;
+            if ((length ^ (header[2] | header[3] << 8)) != 0xFFFF) return kInflateCorrupt;
+            for (unsigned i = 0; i < length; i++) {
+                uint8_t byte;
+                if (!in.readByte(byte)) return corruptOrIOError(in);
+                out.put(byte);
+                if (out.full() && !out.flush()) return kInflateStopped;
+            }
+            continue;
+        }
+
+        const HuffmanTable* literals;
+        const HuffmanTable* distances;
+        if (type == 1) {
+            decoder.buildFixedTables();
+            literals = &decoder.fixedLiterals;
+            distances = &decoder.fixedDistances;
+        }
+        else if (type == 2) {
+            if (!decoder.readDynamicTables(in)) return corruptOrIOError(in);
+            literals = &decoder.literals;
+            distances = &decoder.distances;
+        }
+        else {
+            return kInflateCorrupt;
+        }
+
+        for (;;) {
+            int symbol = literals->decode(in);
+            if (symbol < 256) {
+                if (symbol < 0) return kInflateCorrupt;
+                out.put((uint8_t)symbol);
+            }
+            else if (symbol == 256) {
+                break;
+            }
+            else {
+                symbol -= 257;
+                if (symbol >= 29) return kInflateCorrupt;
+                const size_t length = lengthBase[symbol] + in.read(lengthExtra[symbol]);
+                const int distanceSymbol = distances->decode(in);
+                if (distanceSymbol < 0 || distanceSymbol >= 30) return kInflateCorrupt;
+                const size_t distance = distanceBase[distanceSymbol] + in.read(distanceExtra[distanceSymbol]);
+                if (distance > out.history()) return kInflateCorrupt;
+                out.copy(distance, length);
+            }
+            if (out.full()) {
+                // Garbage past the end of a truncated file decodes as zero bits, so check for that before each chunk goes out
+                if (in.overrun()) return corruptOrIOError(in);
+                if (!out.flush()) return kInflateStopped;
+            }
+        }
+        if (in.overrun()) return corruptOrIOError(in);
+    } while (!finalBlock);
+    return kInflateOK;
+}
+
+bool readLittleEndian32(BitReader& in, uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        uint8_t byte;
+        if (!in.readByte(byte)) return false;
+        value |= (uint32_t)byte << (8 * i);
+    }
+    return true;
+}
+
+// Skips the rest of a gzip header after its magic bytes
+bool skipGzipHeader(BitReader& in) {
+    uint8_t header[8]; // Method, flags, modification time, extra flags, OS
+    for (uint8_t& byte : header) {
+        if (!in.readByte(byte)) return false;
+    }
+    const uint8_t flags = header[1];
+    if (header[0] != 8 || (flags & GZIP_RESERVED) != 0) return false;
+
+    uint8_t byte, high;
+    if (flags & GZIP_FEXTRA) {
+        if (!in.readByte(byte) || !in.readByte(high)) return false;
+        for (unsigned length = byte | high << 8; length > 0; length--) {
+            if (!in.readByte(byte)) return false;
+        }
+    }
+    for (uint8_t stringFlag : { (uint8_t)GZIP_FNAME, (uint8_t)GZIP_FCOMMENT }) {
+        if (flags & stringFlag) {
+            do {
+                if (!in.readByte(byte)) return false;
+            } while (byte != 0);
+        }
+    }
+    if (flags & GZIP_FHCRC) {
+        if (!in.readByte(byte) || !in.readByte(byte)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+InflateResult gunzipFile(FILE* file, InflateSink& sink, std::atomic<uint64_t>* bytesRead) {
+    BitReader in(file, bytesRead);
+    std::unique_ptr<Decoder> decoder(new Decoder()); // The tables are too big for the stack
+    Output out(sink);
+
+    uint8_t magic[2];
+    if (!in.readByte(magic[0]) || !in.readByte(magic[1]) || magic[0] != 0x1F || magic[1] != 0x8B) {
+        return in.ioError() ? kInflateIOError : kInflateNotGzip;
+    }
+
+    for (;;) {
+        if (!skipGzipHeader(in)) return corruptOrIOError(in);
+        out.reset();
+        const InflateResult result = inflateBlocks(in, *decoder, out);
+        if (result != kInflateOK) return result;
+        if (!out.flush()) return kInflateStopped;
+
+        uint32_t crc, length;
+        in.alignToByte();
+        if (!readLittleEndian32(in, crc) || !readLittleEndian32(in, length)) return corruptOrIOError(in);
+        if (crc != out.crc || length != (uint32_t)out.total) return kInflateCorrupt;
+
+        // Another member, or the end. Anything else after a member is ignored, as gzip itself does.
+        if (!in.readByte(magic[0]) || magic[0] != 0x1F || !in.readByte(magic[1]) || magic[1] != 0x8B) {
+            return in.ioError() ? kInflateIOError : kInflateOK;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Inflate.h
+// Streaming gzip decompression (DEFLATE, RFC 1951, inside gzip members, RFC 1952), for reading Premiere's .prproj
+// files, which are gzipped XML.
+//
+// The decompressed data is handed to a sink in pieces as it's produced, so a project that expands to gigabytes of XML
+// is read with a fixed amount of memory: the input buffer, the 32 KB window DEFLATE refers back into, and one chunk
+// of output. Every member's CRC-32 and length are checked against its trailer.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Receives the decompressed data. write returns false to stop decompressing, e.g. when the job was cancelled.
+class InflateSink {
+public:
+    virtual ~InflateSink() = default;
+    virtual bool write(const char* data, size_t length) = 0;
+};
+
+enum InflateResult {
+    kInflateOK,
+    kInflateStopped,    // The sink returned false
+    kInflateNotGzip,    // The file doesn't start with a gzip header. Nothing was read past the first two bytes.
+    kInflateCorrupt,    // Bad compressed data, a CRC or length mismatch, or the file ends early
+    kInflateIOError,
+};
+
+/**
+ * @brief Decompresses a gzip file from its current position to the end, passing the data to 'sink'. Concatenated
+ * members (as from 'cat a.gz b.gz') are read one after another.
+ * @param bytesRead If not null, updated with the compressed bytes read so far, for progress.
+ */
+InflateResult gunzipFile(FILE* file, InflateSink& sink, std::atomic<uint64_t>* bytesRead);
@@ -0,0 +1,450 @@
+#include "JobEngine.h"
+#include "BatchCall.h"
+#include "Checksum.h"
+#include "Exports.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "PackedData.h"
+#include "ProjectFile.h"
+#include "TextEncoding.h"
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Include platform specific headers
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Jobs stay in the table until their result is fetched. Past this many, starting a job drops the oldest finished one.
+#define MAX_JOBS 4096
+#define MAX_JOB_WORKERS 8
+#define HASH_CHUNK_BYTES (1024 * 1024)
+
+//--------------------------------------------------------------------------------------
+//-------------------------------------- Job Kinds -------------------------------------
+//--------------------------------------------------------------------------------------
+
+// Runs one job. Returns kESErrOK with job.result set, or an error code. If the job was cancelled partway through,
+// the return value and result are ignored.
+typedef long (*JobFunction)(Job& job);
+
+// Exports a "call" job can't run: the job exports themselves, so a job can't queue more jobs or wait on one
+static const char* const jobExportNames[] = { "startJob", "pollJob", "cancelJob", "getJobResult" };
+
+static long runCallJob(Job& job) {
+    const size_t nameLength = job.payload.find('\t');
+    const std::string name = job.payload.substr(0, nameLength);
+    for (const char* refused : jobExportNames) {
+        if (name == refused) return kESErrBadAction;
+    }
+
+    job.progressTotal = 1;
+    TaggedData result;
+    const long err = runCommand(job.payload.c_str(), result);
+    if (err == kESErrOK) {
+        appendBatchResult(job.result, result);
+    }
+    else {
+        std::string discarded;
+        appendBatchResult(discarded, result); // Releases anything the export returned before failing
+    }
+    job.progressDone = 1;
+    return err;
+}
+
+static long runHashFileJob(Job& job) {
+    uint64_t size = 0;
+    FILE* file = nullptr;
+    const long err = openUtf8File(job.payload, "rb", file, &size);
+    if (err != kESErrOK) return err;
+    job.progressTotal = size;
+
+    std::vector<char> buffer(HASH_CHUNK_BYTES);
+    uint32_t crc = 0;
+    uint64_t bytes = 0;
+    size_t read;
+    while ((read = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+        if (job.shouldStop()) break;
+        crc = crc32Update(crc, buffer.data(), read);
+        bytes += read;
+        job.progressDone = bytes;
+    }
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed) return kESErrIO;
+
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08x", crc);
+    job.result = "({crc32:\"" + std::string(hex) + "\",bytes:" + std::to_string(bytes) + "})";
+    return kESErrOK;
+}
+
+// Payload is the project path, optionally followed by a tab and the tables to read
+static long runReadProjectJob(Job& job) {
+    const size_t tab = job.payload.find('\t');
+    const std::string path = job.payload.substr(0, tab);
+    unsigned tables = PROJECT_TABLE_ALL;
+    if (tab != std::string::npos && !parseProjectTables(job.payload.c_str() + tab + 1, tables)) return kESErrBadArgumentList;
+
+    // Progress is in bytes of the compressed file
+    uint64_t size = 0;
+    FILE* file = nullptr;
+    const long err = openUtf8File(path, "rb", file, &size);
+    if (err != kESErrOK) return err;
+    fclose(file);
+    job.progressTotal = size;
+
+    ProjectReadStats stats;
+    return scanProjectFile(path, tables, job.result, stats, &job.cancelRequested, &job.progressDone);
+}
+
+struct JobKind {
+    const char* name;
+    JobFunction run;
+};
+
+static const JobKind jobKinds[] = {
+    { "call",       runCallJob },
+    { "hashFile",   runHashFileJob },
+    { "readProject", runReadProjectJob },
+};
+
+static JobFunction findJobKind(const char* name) {
+    for (const JobKind& kind : jobKinds) {
+        if (strcmp(kind.name, name) == 0) return kind.run;
+    }
+    return nullptr;
+}
+
+// Runs a job the worker just took, unless it was cancelled while it sat in the queue
+static void runJob(Job& job) {
+    int expected = kJobQueued;
+    if (!job.state.compare_exchange_strong(expected, kJobRunning)) return;
+
+    JobFunction run = findJobKind(job.kind.c_str());
+    long err;
+    try {
+        err = run(job);
+    }
+    catch (const std::bad_alloc&) {
+        err = THIO_ERR_NO_MEMORY;
+    }
+    catch (...) {
+        err = THIO_ERR_INTERNAL;
+    }
+
+    // The result and error are written before the state, so whoever sees the final state can read them
+    if (job.shouldStop()) {
+        job.result.clear();
+        job.state.store(kJobCancelled, std::memory_order_release);
+    }
+    else if (err == kESErrOK) {
+        job.state.store(kJobDone, std::memory_order_release);
+    }
+    else {
+        job.result.clear();
+        job.error = err;
+        job.state.store(kJobFailed, std::memory_order_release);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------------- Worker Pool ------------------------------------
+//--------------------------------------------------------------------------------------
+
+namespace {
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Job>> queue;
+        std::thread thread;
+    };
+
+    class JobPool {
+    public:
+        ~JobPool() {
+            // If ESTerminate never ran, joining here could deadlock while the library unloads, so wake the workers to
+            // exit on their own and let them go
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::unique_ptr<Worker>& worker : workers) {
+                if (worker->thread.joinable()) worker->thread.detach();
+            }
+        }
+
+        bool isRunning() const { return !workers.empty(); }
+        size_t size() const { return workers.size(); }
+
+        void start() {
+            const unsigned int cores = std::thread::hardware_concurrency();
+            size_t count = (cores > 1) ? cores - 1 : 1; // Leave a core for the app
+            if (count > MAX_JOB_WORKERS) count = MAX_JOB_WORKERS;
+
+            stopping = false;
+            queued = 0;
+            for (size_t i = 0; i < count; i++) {
+                workers.push_back(std::unique_ptr<Worker>(new Worker()));
+            }
+            for (size_t i = 0; i < count; i++) {
+                workers[i]->thread = std::thread(&JobPool::run, this, i);
+            }
+        }
+
+        void submit(const std::shared_ptr<Job>& job) {
+            Worker& worker = *workers[nextWorker++ % workers.size()];
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.queue.push_back(job);
+            }
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                queued++;
+            }
+            wake.notify_one();
+        }
+
+        // Jobs still in the queues are dropped, so cancel them first
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::unique_ptr<Worker>& worker : workers) {
+                if (worker->thread.joinable()) worker->thread.join();
+            }
+            workers.clear();
+        }
+
+    private:
+        std::vector<std::unique_ptr<Worker>> workers;
+        size_t nextWorker = 0;  // Only used by startJob, on ExtendScript's thread
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        size_t queued = 0;      // Jobs in the queues that no worker has claimed yet. Guarded by sleepMutex.
+        bool stopping = false;  // Guarded by sleepMutex
+
+        // Own queue from the front, otherwise steal from the back of another's. Only called after claiming one of
+        // the queued count, and jobs are pushed before the count goes up, so there's always one to find.
+        std::shared_ptr<Job> take(size_t self) {
+            for (size_t offset = 0; offset < workers.size(); offset++) {
+                Worker& worker = *workers[(self + offset) % workers.size()];
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                if (worker.queue.empty()) continue;
+                std::shared_ptr<Job> job;
+                if (offset == 0) {
+                    job = std::move(worker.queue.front());
+                    worker.queue.pop_front();
+                }
+                else {
+                    job = std::move(worker.queue.back());
+                    worker.queue.pop_back();
+                }
+                return job;
+            }
+            return nullptr;
+        }
+
+        void run(size_t self) {
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(sleepMutex);
+                    wake.wait(lock, [this] { return queued > 0 || stopping; });
+                    if (stopping) return;
+                    queued--;
+                }
+                std::shared_ptr<Job> job = take(self);
+                if (job) runJob(*job);
+            }
+        }
+    };
+
+    // The table is only used from ExtendScript's thread, but the mutex keeps it safe if a host ever calls from another
+    std::mutex jobsMutex;
+    std::map<long, std::shared_ptr<Job>> jobs;
+    long lastJobId = 0;
+    JobPool pool;
+}
+
+// Makes room for one more job by dropping the oldest finished one. Returns false if every job is still queued or running.
+static bool makeRoomForJob() {
+    if (jobs.size() < MAX_JOBS) return true;
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        if (it->second->state.load(std::memory_order_acquire) >= kJobDone) {
+            jobs.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+static long getJobArg(const TaggedData& arg, std::shared_ptr<Job>& job, std::map<long, std::shared_ptr<Job>>::iterator& it) {
+    if (arg.type != kTypeInteger) return kESErrTypeMismatch;
+    it = jobs.find(arg.data.intval);
+    if (it == jobs.end()) return kESErrRange;
+    job = it->second;
+    return kESErrOK;
+}
+
+static const char* jobStateName(int state) {
+    switch (state) {
+        case kJobQueued: return "queued";
+        case kJobRunning: return "running";
+        case kJobDone: return "done";
+        case kJobFailed: return "failed";
+        default: return "cancelled";
+    }
+}
+
+void shutdownJobEngine() {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    for (auto& entry : jobs) {
+        Job& job = *entry.second;
+        job.cancelRequested = true;
+        int expected = kJobQueued;
+        job.state.compare_exchange_strong(expected, kJobCancelled);
+    }
+    // Waits for the running jobs to stop. Fine under the lock, since workers never take it.
+    pool.stop();
+    jobs.clear();
+}
+
+size_t getJobWorkerCount() {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    return pool.size();
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Queues a job to run on a worker thread and returns right away. See JobEngine.h for the job kinds.
+ * @param jobId Receives the job id, for pollJob, cancelJob and getJobResult.
+ * @param kind The job kind.
+ * @param payload What the job works on.
+ * @return kESErrOK on success, kESErrCannotResolve for an unknown kind, or kESErrRange if too many jobs are unfinished.
+ *
+ * JavaScript Usage: var jobId = externalLibrary.startJob("hashFile", item.getMediaPath());
+ */
+long startJobTyped(long& jobId, const char* kind, const char* payload) {
+    if (findJobKind(kind) == nullptr) return kESErrCannotResolve;
+
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    if (!makeRoomForJob()) return kESErrRange;
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->id = ++lastJobId;
+    job->kind = kind;
+    job->payload = payload;
+
+    try {
+        if (!pool.isRunning()) pool.start();
+    }
+    catch (const std::system_error&) {
+        return THIO_ERR_INTERNAL; // Couldn't start the worker threads
+    }
+    jobs[job->id] = job;
+    pool.submit(job);
+    jobId = job->id;
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(startJob, startJobTyped)
+
+/**
+ * @brief Gets a job's state and progress.
+ * @param result Receives a script that evaluates to {state: "queued" / "running" / "done" / "failed" / "cancelled",
+ *               done: n, total: n}, or null if there's no job with this id. What done and total count depends on the kind.
+ * @param jobId The job id.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var status = externalLibrary.pollJob(jobId); // status.done / status.total for a progress bar
+ */
+long pollJobTyped(ScriptResult& result, long jobId) {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    auto it = jobs.find(jobId);
+    if (it == jobs.end()) {
+        result.script = "null";
+        return kESErrOK;
+    }
+
+    const Job& job = *it->second;
+    const int state = job.state.load(std::memory_order_acquire);
+    result.script = std::string("({state:\"") + jobStateName(state) + "\",done:" + std::to_string(job.progressDone.load()) +
+        ",total:" + std::to_string(job.progressTotal.load()) + "})";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(pollJob, pollJobTyped)
+
+/**
+ * @brief Cancels a job. A queued job is cancelled at once, a running one is asked to stop. For a job that already
+ *        finished, this just discards it and its result.
+ * @param cancelled Receives true if the job hadn't finished yet, false if it had or there's no job with this id.
+ * @param jobId The job id.
+ * @return kESErrOK.
+ *
+ * JavaScript Usage: externalLibrary.cancelJob(jobId);
+ */
+long cancelJobTyped(bool& cancelled, long jobId) {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    auto it = jobs.find(jobId);
+    if (it == jobs.end()) return kESErrOK;
+
+    Job& job = *it->second;
+    job.cancelRequested = true;
+    int state = kJobQueued;
+    if (job.state.compare_exchange_strong(state, kJobCancelled) || state == kJobRunning) {
+        cancelled = true;
+    }
+    else {
+        jobs.erase(it);
+    }
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(cancelJob, cancelJobTyped)
+
+/**
+ * @brief Gets a finished job's result and forgets the job.
+ * @param argv JavaScript arguments. Expects the job id.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. Whatever the job returned, or undefined for a cancelled job.
+ * @return kESErrOK on success, the job's own error if it failed, kESErrBadAction if it hasn't finished yet
+ *         (check with pollJob first), or kESErrRange if there's no job with this id.
+ *
+ * JavaScript Usage: if (externalLibrary.pollJob(jobId).state == "done") { var hash = externalLibrary.getJobResult(jobId).crc32; }
+ */
+THIO_EXPORT(getJobResult)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+
+    std::shared_ptr<Job> job;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        std::map<long, std::shared_ptr<Job>>::iterator it;
+        const long err = getJobArg(argv[0], job, it);
+        if (err != kESErrOK) return err;
+
+        const int state = job->state.load(std::memory_order_acquire);
+        if (state < kJobDone) return kESErrBadAction;
+        jobs.erase(it);
+    }
+
+    // Finished, so no worker touches it anymore
+    switch (job->state.load(std::memory_order_acquire)) {
+        case kJobDone: return setScriptResult(retval, job->result);
+        case kJobFailed: return job->error;
+        default: return kESErrOK;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// JobEngine.h
+// Background jobs, so long native work doesn't freeze Premiere while ExtendScript waits for it.
+//
+// Every other export runs on ExtendScript's thread, which is also the app's UI thread. startJob instead copies its
+// payload into the library, queues it on a pool of worker threads and returns an id right away. The script then checks
+// on it with pollJob (which can show a progress bar from the job's counters), fetches the result with getJobResult
+// once it's done, or gives up with cancelJob.
+//
+// The pool has one queue per worker. startJob spreads jobs across the queues, each worker takes from the front of its
+// own, and a worker whose queue is empty steals from the back of another's, so one slow job doesn't hold up the jobs
+// queued behind it while other workers sit idle.
+//
+// Job kinds (the table in JobEngine.cpp):
+//      call        Payload is one callBatch command line, e.g. "fitEllipseBatch\ts...". Runs any export except the
+//                  wrappers and the job exports. The result is what the export returns.
+//      hashFile    Payload is a file path. The result is {crc32:"1a2b3c4d", bytes:n}, with progress in bytes.
+//      readProject Payload is a .prproj path, optionally followed by a tab and table names. The result is what
+//                  readProjectFile returns (ProjectFile.h), with progress in bytes of the compressed file.
+//
+// Cancelling a queued job removes it at once. A running job is asked to stop: hashFile and readProject stop at their
+// next chunk, and a call finishes but its result is dropped. ESTerminate cancels everything and waits for the running jobs to stop.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+enum JobState {
+    kJobQueued,
+    kJobRunning,
+    kJobDone,
+    kJobFailed,
+    kJobCancelled,
+};
+
+// A job as its kind's run function sees it. Everything but the counters and the cancel flag is only touched by the
+// worker running the job until it finishes.
+struct Job {
+    long id = 0;
+    std::string kind;
+    std::string payload;
+    std::string result;         // An ExtendScript expression, returned by getJobResult
+    long error = 0;             // For failed jobs, thrown by getJobResult
+    std::atomic<int> state{ kJobQueued };
+    std::atomic<bool> cancelRequested{ false };
+    std::atomic<uint64_t> progressDone{ 0 };
+    std::atomic<uint64_t> progressTotal{ 0 };
+
+    bool shouldStop() const { return cancelRequested.load(std::memory_order_relaxed); }
+};
+
+// Cancels all jobs, waits for running ones to stop, and stops the worker threads. Called from ESTerminate.
+void shutdownJobEngine();
+
+// Number of worker threads, or 0 before the first job starts them
+size_t getJobWorkerCount();
@@ -0,0 +1,665 @@
+#include "Json.h"
+#include "BatchCall.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "PackedData.h"
+#include "TextEncoding.h"
+#include "SoSharedLibDefs.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>        // For std::bad_alloc
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+// Parser
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+    class JsonParser {
+    public:
+        JsonParser(const char* text, size_t length, std::vector<JsonNode>& nodes)
+            : text(text), length(length), nodes(nodes) {}
+
+        bool parse() {
+            // Most nodes take at least a few characters of text, so this avoids most regrowth without overshooting much
+            nodes.reserve(length / 8 + 1);
+            if (length >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+                pos = 3;
+            }
+            skipWhitespace();
+            if (!parseValue(0)) {
+                return false;
+            }
+            skipWhitespace();
+            if (pos != length) {
+                return fail("Unexpected text after the end of the document");
+            }
+            return true;
+        }
+
+        size_t errorPosition = 0;
+        const char* errorMessage = nullptr;
+
+    private:
+        const char* text;
+        size_t length;
+        size_t pos = 0;
+        std::vector<JsonNode>& nodes;
+
+        bool fail(const char* message) {
+            errorPosition = pos;
+            errorMessage = message;
+            return false;
+        }
+
+        void skipWhitespace() {
+            while (pos < length && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t')) {
+                pos++;
+            }
+        }
+
+        size_t addNode(JsonType type, size_t start, size_t valueLength, uint8_t flags = 0) {
+            nodes.push_back(JsonNode{ type, flags, (uint32_t)start, (uint32_t)valueLength, (uint32_t)(nodes.size() + 1) });
+            return nodes.size() - 1;
+        }
+
+        bool parseValue(int depth) {
+            if (pos >= length) {
+                return fail("Unexpected end of the document");
+            }
+            switch (text[pos]) {
+            case '{': return parseObject(depth);
+            case '[': return parseArray(depth);
+            case '"': return parseString();
+            case 't': return parseLiteral("true", JSON_TRUE);
+            case 'f': return parseLiteral("false", JSON_FALSE);
+            case 'n': return parseLiteral("null", JSON_NULL);
+            default:
+                if (text[pos] == '-' || (text[pos] >= '0' && text[pos] <= '9')) {
+                    return parseNumber();
+                }
+                return fail("Unexpected character");
+            }
+        }
+
+        bool parseLiteral(const char* word, JsonType type) {
+            const size_t wordLength = strlen(word);
+            if (length - pos < wordLength || memcmp(text + pos, word, wordLength) != 0) {
+                return fail("Invalid literal");
+            }
+            addNode(type, pos, wordLength);
+            pos += wordLength;
+            return true;
+        }
+
+        bool isDigit(size_t at) const {
+            return at < length && text[at] >= '0' && text[at] <= '9';
+        }
+
+        // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?  The text is kept as-is, since it's also a valid JavaScript number.
+        bool parseNumber() {
+            const size_t start = pos;
+            if (text[pos] == '-') pos++;
+            if (!isDigit(pos)) return fail("Invalid number");
+            if (text[pos] == '0') {
+                pos++;
+            }
+            else {
+                while (isDigit(pos)) pos++;
+            }
+            if (pos < length && text[pos] == '.') {
+                pos++;
+                if (!isDigit(pos)) return fail("Invalid number");
+                while (isDigit(pos)) pos++;
+            }
+            if (pos < length && (text[pos] == 'e' || text[pos] == 'E')) {
+                pos++;
+                if (pos < length && (text[pos] == '+' || text[pos] == '-')) pos++;
+                if (!isDigit(pos)) return fail("Invalid number");
+                while (isDigit(pos)) pos++;
+            }
+            addNode(JSON_NUMBER, start, pos - start);
+            return true;
+        }
+
+        static bool isHexDigit(char c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        }
+
+        bool parseString() {
+            const size_t start = ++pos; // Past the opening quote
+            uint8_t flags = 0;
+            for (;;) {
+                // Skips plain text 16 bytes at a time. Stops at the same bytes appendJsString cares about.
+                pos += findJsEscapeByte(text + pos, length - pos);
+                if (pos >= length) {
+                    return fail("Unterminated string");
+                }
+                const unsigned char c = (unsigned char)text[pos];
+                if (c == '"') {
+                    break;
+                }
+                if (c == '\\') {
+                    flags |= JSON_FLAG_ESCAPES;
+                    if (pos + 1 >= length) return fail("Unterminated string");
+                    const char escaped = text[pos + 1];
+                    if (escaped == 'u') {
+                        if (length - pos < 6 || !isHexDigit(text[pos + 2]) || !isHexDigit(text[pos + 3]) || !isHexDigit(text[pos + 4]) || !isHexDigit(text[pos + 5])) {
+                            return fail("Invalid \\u escape");
+                        }
+                        pos += 6;
+                    }
+                    else if (strchr("\"\\/bfnrt", escaped) != nullptr && escaped != '\0') {
+                        pos += 2;
+                    }
+                    else {
+                        return fail("Invalid escape");
+                    }
+                }
+                else if (c < 0x20) {
+                    return fail("Control character in string");
+                }
+                else {
+                    // 0xE2. Only U+2028 / U+2029 matter.
+                    if (pos + 2 < length && (unsigned char)text[pos + 1] == 0x80 && ((unsigned char)text[pos + 2] & 0xFE) == 0xA8) {
+                        flags |= JSON_FLAG_LINE_SEPARATOR;
+                    }
+                    pos++;
+                }
+            }
+            addNode(JSON_STRING, start, pos - start, flags);
+            pos++; // Past the closing quote
+            return true;
+        }
+
+        bool parseArray(int depth) {
+            if (depth >= JSON_MAX_DEPTH) return fail("Nested too deeply");
+            const size_t index = addNode(JSON_ARRAY, pos, 0);
+            pos++;
+            skipWhitespace();
+            uint32_t count = 0;
+            if (pos < length && text[pos] == ']') {
+                pos++;
+            }
+            else {
+                for (;;) {
+                    if (!parseValue(depth + 1)) return false;
+                    count++;
+                    skipWhitespace();
+                    if (pos >= length) return fail("Unterminated array");
+                    if (text[pos] == ']') { pos++; break; }
+                    if (text[pos] != ',') return fail("Expected ',' or ']'");
+                    pos++;
+                    skipWhitespace();
+                }
+            }
+            nodes[index].length = count;
+            nodes[index].end = (uint32_t)nodes.size();
+            return true;
+        }
+
+        bool parseObject(int depth) {
+            if (depth >= JSON_MAX_DEPTH) return fail("Nested too deeply");
+            const size_t index = addNode(JSON_OBJECT, pos, 0);
+            pos++;
+            skipWhitespace();
+            uint32_t count = 0;
+            if (pos < length && text[pos] == '}') {
+                pos++;
+            }
+            else {
+                for (;;) {
+                    if (pos >= length || text[pos] != '"') return fail("Expected a property name");
+                    if (!parseString()) return false;
+                    skipWhitespace();
+                    if (pos >= length || text[pos] != ':') return fail("Expected ':'");
+                    pos++;
+                    skipWhitespace();
+                    if (!parseValue(depth + 1)) return false;
+                    count++;
+                    skipWhitespace();
+                    if (pos >= length) return fail("Unterminated object");
+                    if (text[pos] == '}') { pos++; break; }
+                    if (text[pos] != ',') return fail("Expected ',' or '}'");
+                    pos++;
+                    skipWhitespace();
+                }
+            }
+            nodes[index].length = count;
+            nodes[index].end = (uint32_t)nodes.size();
+            return true;
+        }
+    };
+}
+
+bool parseJsonDocument(const char* text, size_t length, JsonDocument& doc, std::string& error) {
+    doc.text = text;
+    doc.nodes.clear();
+    error.clear();
+    if (length >= UINT32_MAX) {
+        error = "Document is too large";
+        return false;
+    }
+
+    JsonParser parser(text, length, doc.nodes);
+    if (parser.parse()) {
+        return true;
+    }
+
+    // Line and column (1-based, in bytes) of where parsing stopped
+    size_t line = 1, lineStart = 0;
+    for (size_t i = 0; i < parser.errorPosition && i < length; i++) {
+        if (text[i] == '\n') {
+            line++;
+            lineStart = i + 1;
+        }
+    }
+    error = std::string(parser.errorMessage) + " at line " + std::to_string(line) + ", column " + std::to_string(parser.errorPosition - lineStart + 1);
+    doc.nodes.clear();
+    return false;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Reading the DOM
+// ------------------------------------------------------------------------------------------------
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+static unsigned int readHex4(const char* p) {
+    return (unsigned int)(hexValue(p[0]) << 12 | hexValue(p[1]) << 8 | hexValue(p[2]) << 4 | hexValue(p[3]));
+}
+
+static void appendUtf8(std::string& out, unsigned int codePoint) {
+    if (codePoint < 0x80) {
+        out += (char)codePoint;
+    }
+    else if (codePoint < 0x800) {
+        out += (char)(0xC0 | (codePoint >> 6));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        out += (char)(0xE0 | (codePoint >> 12));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        out += (char)(0xF0 | (codePoint >> 18));
+        out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+void decodeJsonString(const JsonDocument& doc, const JsonNode& node, std::string& out) {
+    out.clear();
+    const char* p = doc.text + node.start;
+    const char* end = p + node.length;
+    if (!(node.flags & JSON_FLAG_ESCAPES)) {
+        out.assign(p, end);
+        return;
+    }
+    out.reserve(node.length);
+    while (p < end) {
+        if (*p != '\\') {
+            out += *p++;
+            continue;
+        }
+        // The parser already checked every escape is complete and valid
+        const char escaped = p[1];
+        p += 2;
+        switch (escaped) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            unsigned int codePoint = readHex4(p);
+            p += 4;
+            // Combine a surrogate pair. An unpaired surrogate becomes U+FFFD.
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                const unsigned int low = readHex4(p + 2);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            if (codePoint >= 0xD800 && codePoint <= 0xDFFF) {
+                codePoint = 0xFFFD;
+            }
+            appendUtf8(out, codePoint);
+            break;
+        }
+        default: out += escaped; break; // " \ /
+        }
+    }
+}
+
+// Reads one reference token of a JSON Pointer, undoing ~1 (/) and ~0 (~). Advances 'pointer' past it.
+static void readPointerToken(const char*& pointer, std::string& token) {
+    token.clear();
+    while (*pointer != '\0' && *pointer != '/') {
+        if (pointer[0] == '~' && (pointer[1] == '0' || pointer[1] == '1')) {
+            token += (pointer[1] == '0') ? '~' : '/';
+            pointer += 2;
+        }
+        else {
+            token += *pointer++;
+        }
+    }
+}
+
+long findJsonNode(const JsonDocument& doc, const char* pointer) {
+    if (doc.nodes.empty()) {
+        return -1;
+    }
+    size_t index = 0;
+    std::string token, key;
+    while (*pointer != '\0') {
+        if (*pointer++ != '/') {
+            return -1;
+        }
+        readPointerToken(pointer, token);
+        const JsonNode& node = doc.nodes[index];
+
+        if (node.type == JSON_ARRAY) {
+            // Array indexes are plain decimal, no sign or leading zeros
+            if (token.empty() || token.size() > 9 || (token.size() > 1 && token[0] == '0') || token.find_first_not_of("0123456789") != std::string::npos) {
+                return -1;
+            }
+            const uint32_t wanted = (uint32_t)std::stoul(token);
+            if (wanted >= node.length) {
+                return -1;
+            }
+            size_t child = index + 1;
+            for (uint32_t i = 0; i < wanted; i++) {
+                child = doc.nodes[child].end;
+            }
+            index = child;
+        }
+        else if (node.type == JSON_OBJECT) {
+            size_t child = index + 1;
+            bool found = false;
+            for (uint32_t i = 0; i < node.length && !found; i++) {
+                const JsonNode& keyNode = doc.nodes[child];
+                const size_t valueIndex = child + 1;
+                if (keyNode.flags & JSON_FLAG_ESCAPES) {
+                    decodeJsonString(doc, keyNode, key);
+                    found = (key == token);
+                }
+                else {
+                    found = (keyNode.length == token.size() && memcmp(doc.text + keyNode.start, token.data(), token.size()) == 0);
+                }
+                if (found) {
+                    index = valueIndex;
+                }
+                child = doc.nodes[valueIndex].end;
+            }
+            if (!found) {
+                return -1;
+            }
+        }
+        else {
+            return -1;
+        }
+    }
+    return (long)index;
+}
+
+static void appendStringNodeScript(const JsonDocument& doc, const JsonNode& node, std::string& out) {
+    const char* p = doc.text + node.start;
+    out += '"';
+    if (!(node.flags & JSON_FLAG_LINE_SEPARATOR)) {
+        out.append(p, node.length);
+    }
+    else {
+        for (uint32_t i = 0; i < node.length; i++) {
+            if ((unsigned char)p[i] == 0xE2 && i + 2 < node.length && (unsigned char)p[i + 1] == 0x80 && ((unsigned char)p[i + 2] & 0xFE) == 0xA8) {
+                out += ((unsigned char)p[i + 2] == 0xA8) ? "\\u2028" : "\\u2029";
+                i += 2;
+            }
+            else {
+                out += p[i];
+            }
+        }
+    }
+    out += '"';
+}
+
+// Appends the node at 'index' and returns the index of the node after its subtree
+static size_t appendNodeScript(const JsonDocument& doc, size_t index, std::string& out) {
+    const JsonNode& node = doc.nodes[index];
+    switch (node.type) {
+    case JSON_STRING:
+        appendStringNodeScript(doc, node, out);
+        return index + 1;
+    case JSON_ARRAY: {
+        out += '[';
+        size_t child = index + 1;
+        for (uint32_t i = 0; i < node.length; i++) {
+            if (i > 0) out += ',';
+            child = appendNodeScript(doc, child, out);
+        }
+        out += ']';
+        return node.end;
+    }
+    case JSON_OBJECT: {
+        out += '{';
+        size_t child = index + 1;
+        for (uint32_t i = 0; i < node.length; i++) {
+            if (i > 0) out += ',';
+            appendStringNodeScript(doc, doc.nodes[child], out); // Quoted property names are valid in ES3 object literals
+            out += ':';
+            child = appendNodeScript(doc, child + 1, out);
+        }
+        out += '}';
+        return node.end;
+    }
+    default:
+        // null, true, false and numbers are written the same way in JavaScript
+        out.append(doc.text + node.start, node.length);
+        return index + 1;
+    }
+}
+
+void appendJsonNodeScript(const JsonDocument& doc, size_t index, std::string& out) {
+    appendNodeScript(doc, index, out);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Export helpers
+// ------------------------------------------------------------------------------------------------
+
+// Message from the last failed parse on this thread, for getJsonError
+static thread_local std::string lastJsonError;
+
+// Parses, selects the node at 'pointer', and returns it as a script
+static long returnJsonScript(const char* text, size_t length, const char* pointer, TaggedData* retval) {
+    JsonDocument doc;
+    if (!parseJsonDocument(text, length, doc, lastJsonError)) {
+        return kESErrSyntax;
+    }
+    lastJsonError.clear();
+
+    const long index = findJsonNode(doc, pointer);
+    if (index < 0) {
+        lastJsonError = std::string("No value at ") + pointer;
+        return kESErrRange;
+    }
+
+    std::string script;
+    script.reserve(length + 2);
+    script += '(';
+    appendJsonNodeScript(doc, (size_t)index, script);
+    script += ')';
+    return setScriptResult(retval, script);
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Parses a JSON string and returns it as an ExtendScript value.
+ * @param argv JavaScript arguments. Expects the JSON text, and a JSON Pointer to return only part of the document
+ *             (e.g. "/clips/0"), or an empty string for all of it.
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. A script that evaluates to the value.
+ * @return kESErrOK on success, kESErrSyntax if the text isn't valid JSON, kESErrRange if the pointer doesn't resolve.
+ *         Use getJsonError for the details.
+ *
+ * JavaScript Usage: var settings = externalLibrary.parseJson(text, "");
+ */
+THIO_EXPORT(parseJson)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString || argv[1].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr) return kESErrBadArgumentList;
+
+    const char* pointer = argv[1].data.string ? argv[1].data.string : "";
+    return returnJsonScript(argv[0].data.string, strlen(argv[0].data.string), pointer, retval);
+}
+
+/**
+ * @brief Reads and parses a JSON file and returns it as an ExtendScript value, without the file contents passing through ExtendScript.
+ * @param argv JavaScript arguments. Expects the file path (File.fsName), and a JSON Pointer or an empty string.
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. A script that evaluates to the value.
+ * @return kESErrOK on success, kESErrNoFile / kESErrIO if the file couldn't be read, or the same errors as parseJson.
+ *
+ * JavaScript Usage: var project = externalLibrary.parseJsonFile(file.fsName, "/sequences");
+ */
+THIO_EXPORT(parseJsonFile)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString || argv[1].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr) return kESErrBadArgumentList;
+
+    std::string contents;
+    const long err = readUtf8File(argv[0].data.string, contents);
+    if (err != kESErrOK) {
+        lastJsonError = std::string("Could not read ") + argv[0].data.string;
+        return err;
+    }
+
+    const char* pointer = argv[1].data.string ? argv[1].data.string : "";
+    return returnJsonScript(contents.data(), contents.size(), pointer, retval);
+}
+
+/**
+ * @brief Returns why the last parseJson or parseJsonFile call failed, e.g. "Expected ':' at line 3, column 12".
+ * @param argv JavaScript arguments. None.
+ * @param argc Argument count. Should be 0.
+ * @param retval Return value. The message, or an empty string if the last call succeeded.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var message = externalLibrary.getJsonError();
+ */
+THIO_EXPORT(getJsonError)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    return setStringResult(retval, lastJsonError);
+}
+
+/**
+ * @brief Builds a JSON array of objects from packed records, e.g. to save settings or data from a script.
+ * @param argv JavaScript arguments. Expects:
+ *             1. The field names, comma separated, e.g. "name,start,enabled"
+ *             2. The records, one per line. Fields are separated by tabs and use callBatch's argument encoding
+ *                (s<text>, n<number>, b1 / b0, u for null), see BatchCall.cpp. Each record must have one value per name.
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. The JSON text, e.g. [{"name":"Clip 1","start":0,"enabled":true}]
+ * @return kESErrOK on success, kESErrBadArgumentList if a record is malformed or has the wrong number of fields.
+ *
+ * JavaScript Usage: var json = externalLibrary.recordsToJson("name,start", "sClip 1\tn0\nsClip 2\tn5.5");
+ */
+THIO_EXPORT(recordsToJson)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString || argv[1].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr || argv[1].data.string == nullptr) return kESErrBadArgumentList;
+
+    // Field names, already quoted for output
+    std::vector<std::string> names;
+    const char* p = argv[0].data.string;
+    for (;;) {
+        const char* comma = strchr(p, ',');
+        const size_t nameLength = comma ? (size_t)(comma - p) : strlen(p);
+        names.emplace_back();
+        appendJsString(names.back(), p, nameLength);
+        if (comma == nullptr) break;
+        p = comma + 1;
+    }
+
+    const char* records = argv[1].data.string;
+    std::string json;
+    json.reserve(strlen(records) + strlen(records) / 4 + 2);
+    json += '[';
+
+    BatchArg value;
+    bool firstRecord = true;
+    p = records;
+    while (*p != '\0') {
+        const char* lineEnd = strchr(p, '\n');
+        if (lineEnd == nullptr) {
+            lineEnd = p + strlen(p);
+        }
+        if (lineEnd > p) { // Skip blank lines
+            if (!firstRecord) json += ',';
+            firstRecord = false;
+            json += '{';
+
+            const char* field = p;
+            size_t fieldIndex = 0;
+            while (field <= lineEnd) {
+                const char* fieldEnd = static_cast<const char*>(memchr(field, '\t', lineEnd - field));
+                if (fieldEnd == nullptr) {
+                    fieldEnd = lineEnd;
+                }
+                if (fieldIndex >= names.size() || !parseBatchArg(field, fieldEnd, value)) {
+                    return kESErrBadArgumentList;
+                }
+                if (fieldIndex > 0) json += ',';
+                json += names[fieldIndex];
+                json += ':';
+                switch (value.type) {
+                case 's':
+                    appendJsString(json, value.text.data(), value.text.size());
+                    break;
+                case 'n':
+                    if (!std::isfinite(value.number)) {
+                        json += "null"; // NaN and infinities, as JSON.stringify does
+                    }
+                    else {
+                        appendJsNumber(json, value.number);
+                    }
+                    break;
+                case 'b':
+                    json += (value.number != 0) ? "true" : "false";
+                    break;
+                default:
+                    json += "null";
+                    break;
+                }
+                fieldIndex++;
+                field = fieldEnd + 1;
+            }
+            if (fieldIndex != names.size()) {
+                return kESErrBadArgumentList;
+            }
+            json += '}';
+        }
+        p = (*lineEnd == '\0') ? lineEnd : lineEnd + 1;
+    }
+    json += ']';
+
+    return setStringResult(retval, json);
+}
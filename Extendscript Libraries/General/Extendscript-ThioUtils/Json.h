@@ -0,0 +1,68 @@
+#pragma once
+
+// Json.h
+// JSON parsing into a compact DOM, and conversion to an ExtendScript object literal.
+//
+// ExtendScript has no native JSON, and eval'ing a JSON string is slow and unsafe for large files. parseJson validates
+// the document natively and returns it as a kTypeScript literal, so ExtendScript only ever evaluates a plain
+// object/array literal (with no whitespace and nothing that isn't data).
+//
+// The DOM is a flat array of nodes in document order. Scalars point back into the source text instead of copying it,
+// and strings are kept in their escaped JSON form, since JSON string escapes are also valid JavaScript escapes.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define JSON_MAX_DEPTH  512 // Deeper nesting is rejected rather than risking the stack
+
+enum JsonType : uint8_t {
+    JSON_NULL,
+    JSON_FALSE,
+    JSON_TRUE,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+};
+
+// String flags
+#define JSON_FLAG_ESCAPES           0x01 // Contains backslash escapes
+#define JSON_FLAG_LINE_SEPARATOR    0x02 // Contains a raw U+2028 / U+2029, which JavaScript string literals can't
+
+struct JsonNode {
+    JsonType type;
+    uint8_t flags;
+    uint32_t start;     // Scalars: offset of the value in the text. For strings this is just inside the opening quote.
+    uint32_t length;    // Scalars: length of the value text. Arrays: element count. Objects: member count.
+    uint32_t end;       // Index of the first node after this one's subtree. Objects store each member as a key node then the value.
+};
+
+struct JsonDocument {
+    const char* text = nullptr; // Not owned. Must outlive the document.
+    std::vector<JsonNode> nodes;
+};
+
+/**
+ * @brief Parses a JSON document. A leading UTF-8 byte order mark is skipped.
+ * @param error Receives a message with the line and column if parsing fails.
+ * @return false if the text isn't valid JSON, is nested deeper than JSON_MAX_DEPTH, or is 4 GB or more.
+ */
+bool parseJsonDocument(const char* text, size_t length, JsonDocument& doc, std::string& error);
+
+/**
+ * @brief Finds a node by JSON Pointer (RFC 6901), e.g. "/clips/3/name". An empty pointer is the whole document.
+ * @return The node's index, or -1 if the pointer doesn't resolve.
+ */
+long findJsonNode(const JsonDocument& doc, const char* pointer);
+
+/**
+ * @brief Appends a node and its children as a JavaScript expression (strings escaped for evaluation, no whitespace).
+ */
+void appendJsonNodeScript(const JsonDocument& doc, size_t index, std::string& out);
+
+/**
+ * @brief Decodes a string node's escapes into UTF-8.
+ */
+void decodeJsonString(const JsonDocument& doc, const JsonNode& node, std::string& out);
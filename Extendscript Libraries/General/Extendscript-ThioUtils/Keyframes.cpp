@@ -0,0 +1,330 @@
+#include "Keyframes.h"
+#include "Exports.h"
+#include "NativeBuffer.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include "TimeMath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+// Resampling more than this many frames is refused, about 38 hours at 60 fps
+#define MAX_RESAMPLED_KEYS 8000000
+
+// ------------------------------------------------------------------------------------------------
+// Curves
+// ------------------------------------------------------------------------------------------------
+
+bool parseKeyframeCurve(const char* packed, KeyframeCurve& curve) {
+    curve.keys.clear();
+    curve.dimensions = 1;
+    if (packed == nullptr) {
+        return false;
+    }
+
+    std::vector<long long> ticks;
+    std::vector<double> numbers;
+    const char* p = packed;
+    while (*p != '\0') {
+        const char* recordEnd = p + strcspn(p, ";\n");
+        if (recordEnd > p) {
+            // Ticks first, then the values and the interpolation
+            const char* comma = static_cast<const char*>(memchr(p, ',', recordEnd - p));
+            ticks.clear();
+            numbers.clear();
+            if (comma == nullptr || !parsePackedInt64s(p, comma, ticks) || ticks.size() != 1 || !parsePackedDoubles(comma + 1, recordEnd, numbers)) {
+                return false;
+            }
+
+            const int dimensions = (int)numbers.size() - 1;
+            if (dimensions < 1 || dimensions > KEYFRAME_MAX_DIMENSIONS) return false;
+            if (curve.keys.empty()) curve.dimensions = dimensions;
+            else if (dimensions != curve.dimensions || ticks[0] <= curve.keys.back().ticks) return false;
+
+            const double interpolation = numbers[dimensions];
+            if (std::floor(interpolation) != interpolation || interpolation < 0 || interpolation > 255) return false;
+
+            Keyframe key = {};
+            key.ticks = ticks[0];
+            for (int d = 0; d < dimensions; d++) key.value[d] = numbers[d];
+            key.interpolation = (int)interpolation;
+            curve.keys.push_back(key);
+        }
+        p = (*recordEnd == '\0') ? recordEnd : recordEnd + 1;
+    }
+    return true;
+}
+
+// Catmull-Rom tangent at key i in value per tick, flat at the ends
+static double keyTangent(const KeyframeCurve& curve, size_t i, int d) {
+    if (i == 0 || i + 1 >= curve.keys.size()) {
+        return 0.0;
+    }
+    const Keyframe& before = curve.keys[i - 1];
+    const Keyframe& after = curve.keys[i + 1];
+    return (after.value[d] - before.value[d]) / (double)(after.ticks - before.ticks);
+}
+
+// Value at a time inside segment i, which runs from key i to key i + 1
+static void evaluateSegment(const KeyframeCurve& curve, size_t i, long long ticks, double* value) {
+    const Keyframe& start = curve.keys[i];
+    const Keyframe& end = curve.keys[i + 1];
+    const double span = (double)(end.ticks - start.ticks);
+    const double u = (double)(ticks - start.ticks) / span;
+
+    for (int d = 0; d < curve.dimensions; d++) {
+        if (start.interpolation == KEYFRAME_HOLD) {
+            value[d] = start.value[d];
+        }
+        else if (start.interpolation == KEYFRAME_LINEAR) {
+            value[d] = start.value[d] + (end.value[d] - start.value[d]) * u;
+        }
+        else {
+            // Cubic Hermite basis
+            const double u2 = u * u, u3 = u2 * u;
+            value[d] = (2 * u3 - 3 * u2 + 1) * start.value[d] + (u3 - 2 * u2 + u) * span * keyTangent(curve, i, d)
+                     + (-2 * u3 + 3 * u2) * end.value[d] + (u3 - u2) * span * keyTangent(curve, i + 1, d);
+        }
+    }
+}
+
+// Index of the segment containing a time, or of the first or last key when it's outside the curve
+static size_t findSegment(const KeyframeCurve& curve, long long ticks) {
+    auto after = std::upper_bound(curve.keys.begin(), curve.keys.end(), ticks, [](long long t, const Keyframe& key) {
+        return t < key.ticks;
+    });
+    return (after == curve.keys.begin()) ? 0 : (size_t)(after - curve.keys.begin()) - 1;
+}
+
+void evaluateKeyframeCurve(const KeyframeCurve& curve, long long ticks, double* value) {
+    const size_t i = findSegment(curve, ticks);
+    if (ticks <= curve.keys[i].ticks || i + 1 >= curve.keys.size()) {
+        memcpy(value, curve.keys[i].value, sizeof(double) * curve.dimensions);
+        return;
+    }
+    evaluateSegment(curve, i, ticks, value);
+}
+
+bool resampleKeyframeCurve(const KeyframeCurve& curve, long long ticksPerFrame, size_t maxKeys, KeyframeCurve& resampled) {
+    resampled.keys.clear();
+    resampled.dimensions = curve.dimensions;
+    if (curve.keys.empty()) {
+        return true;
+    }
+
+    const long long firstFrame = ticksToFrameIndex(curve.keys.front().ticks, ticksPerFrame, FRAME_ROUND_NEAREST);
+    const long long lastFrame = ticksToFrameIndex(curve.keys.back().ticks, ticksPerFrame, FRAME_ROUND_NEAREST);
+    const unsigned long long count = (unsigned long long)lastFrame - (unsigned long long)firstFrame + 1;
+    if (count > maxKeys) {
+        return false;
+    }
+    resampled.keys.resize((size_t)count);
+
+    // Frames are in order, so walk the segments alongside them instead of searching for each one
+    size_t segment = 0;
+    for (size_t f = 0; f < resampled.keys.size(); f++) {
+        Keyframe& key = resampled.keys[f];
+        if (!framesToTicksChecked(firstFrame + (long long)f, ticksPerFrame, key.ticks)) {
+            resampled.keys.clear();
+            return false;
+        }
+        while (segment + 1 < curve.keys.size() && curve.keys[segment + 1].ticks <= key.ticks) {
+            segment++;
+        }
+
+        if (key.ticks <= curve.keys[segment].ticks || segment + 1 >= curve.keys.size()) {
+            memcpy(key.value, curve.keys[segment].value, sizeof(key.value));
+        }
+        else {
+            evaluateSegment(curve, segment, key.ticks, key.value);
+        }
+        const bool inHold = curve.keys[segment].interpolation == KEYFRAME_HOLD && key.ticks >= curve.keys[segment].ticks;
+        key.interpolation = inHold ? KEYFRAME_HOLD : KEYFRAME_LINEAR;
+    }
+    return true;
+}
+
+// Distance from key i to the line between keys first and last, at key i's time
+static double simplifyError(const KeyframeCurve& curve, size_t first, size_t last, size_t i) {
+    const Keyframe& a = curve.keys[first];
+    const Keyframe& b = curve.keys[last];
+    const Keyframe& key = curve.keys[i];
+    const double u = (double)(key.ticks - a.ticks) / (double)(b.ticks - a.ticks);
+
+    double squared = 0.0;
+    for (int d = 0; d < curve.dimensions; d++) {
+        const double difference = key.value[d] - (a.value[d] + (b.value[d] - a.value[d]) * u);
+        squared += difference * difference;
+    }
+    return std::sqrt(squared);
+}
+
+void simplifyKeyframeCurve(const KeyframeCurve& curve, double tolerance, KeyframeCurve& simplified) {
+    simplified.keys.clear();
+    simplified.dimensions = curve.dimensions;
+    const size_t count = curve.keys.size();
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<char> keep(count, 0);
+    keep[0] = keep[count - 1] = 1;
+    for (size_t i = 0; i + 1 < count; i++) {
+        if (curve.keys[i].interpolation == KEYFRAME_HOLD) {
+            keep[i] = keep[i + 1] = 1;
+        }
+    }
+
+    // Each run between kept keys is simplified on its own. A stack instead of recursion, since dense tracks can have
+    // hundreds of thousands of keys.
+    std::vector<std::pair<size_t, size_t>> pending;
+    size_t runStart = 0;
+    for (size_t i = 1; i < count; i++) {
+        if (keep[i]) {
+            pending.emplace_back(runStart, i);
+            runStart = i;
+        }
+    }
+    while (!pending.empty()) {
+        const size_t first = pending.back().first;
+        const size_t last = pending.back().second;
+        pending.pop_back();
+        if (last - first < 2 || curve.keys[first].interpolation == KEYFRAME_HOLD) {
+            continue;
+        }
+
+        size_t worst = first;
+        double worstError = -1.0;
+        for (size_t i = first + 1; i < last; i++) {
+            const double error = simplifyError(curve, first, last, i);
+            if (error > worstError) {
+                worst = i;
+                worstError = error;
+            }
+        }
+        // NaN values never compare as within tolerance, so they're kept
+        if (!(worstError <= tolerance)) {
+            keep[worst] = 1;
+            pending.emplace_back(first, worst);
+            pending.emplace_back(worst, last);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!keep[i]) continue;
+        Keyframe key = curve.keys[i];
+        key.interpolation = (key.interpolation == KEYFRAME_HOLD) ? KEYFRAME_HOLD : KEYFRAME_LINEAR;
+        simplified.keys.push_back(key);
+    }
+}
+
+static void appendKeyframeValue(std::string& out, int dimensions, const double* value) {
+    if (dimensions == 1) {
+        appendJsNumber(out, value[0]);
+        return;
+    }
+    out += "[";
+    for (int d = 0; d < dimensions; d++) {
+        if (d > 0) out += ",";
+        appendJsNumber(out, value[d]);
+    }
+    out += "]";
+}
+
+void appendKeyframeCurveScript(std::string& out, const KeyframeCurve& curve) {
+    out.reserve(out.size() + curve.keys.size() * (curve.dimensions * 20 + 24) + 48);
+    out += "({ticks:[";
+    for (size_t i = 0; i < curve.keys.size(); i++) {
+        if (i > 0) out += ",";
+        appendJsInt64String(out, curve.keys[i].ticks);
+    }
+    out += "],values:[";
+    for (size_t i = 0; i < curve.keys.size(); i++) {
+        if (i > 0) out += ",";
+        appendKeyframeValue(out, curve.dimensions, curve.keys[i].value);
+    }
+    out += "],interpolation:[";
+    for (size_t i = 0; i < curve.keys.size(); i++) {
+        if (i > 0) out += ",";
+        out += std::to_string(curve.keys[i].interpolation);
+    }
+    out += "]})";
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Evaluates a keyframe curve at many times.
+ * @param result Receives a script that evaluates to an array with the value at each time. For two values per key
+ *               each value is an [x, y] array.
+ * @param keys Packed keys, see Keyframes.h.
+ * @param ticks Packed times in ticks, or an i64 NativeBuffer. They don't need to be in order.
+ * @return kESErrOK on success, kESErrConversion if the keys are malformed, kESErrBadArgumentList if there are no keys,
+ *         or another error code.
+ *
+ * JavaScript Usage: var values = externalLibrary.evaluateKeyframes("0,100,0;254016000000,50,2", "127008000000");   // [75]
+ */
+long evaluateKeyframesTyped(ScriptResult& result, const char* keys, const NumericSpan<long long>& ticks) {
+    KeyframeCurve curve;
+    if (!parseKeyframeCurve(keys, curve)) return kESErrConversion;
+    if (curve.keys.empty()) return kESErrBadArgumentList;
+
+    std::string& script = result.script;
+    script.reserve(ticks.size() * (curve.dimensions * 20 + 4) + 2);
+    script = "[";
+    double value[KEYFRAME_MAX_DIMENSIONS];
+    for (size_t i = 0; i < ticks.size(); i++) {
+        if (i > 0) script += ",";
+        evaluateKeyframeCurve(curve, ticks[i], value);
+        appendKeyframeValue(script, curve.dimensions, value);
+    }
+    script += "]";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(evaluateKeyframes, evaluateKeyframesTyped)
+
+/**
+ * @brief Resamples a keyframe curve to one key per frame, e.g. to move animation to a sequence with another frame rate.
+ * @param result Receives a script that evaluates to {ticks, values, interpolation}, see appendKeyframeCurveScript.
+ * @param keys Packed keys, see Keyframes.h.
+ * @param timebase Ticks per frame, or a rational rate such as "30000/1001".
+ * @return kESErrOK on success, kESErrConversion if the keys are malformed, kESErrRange if there would be too many
+ *         frames, or another error code.
+ *
+ * JavaScript Usage: var curve = externalLibrary.resampleKeyframes(packedKeys, sequence.timebase);
+ */
+long resampleKeyframesTyped(ScriptResult& result, const char* keys, const char* timebase) {
+    long long ticksPerFrame = 0;
+    if (!parseTicksPerFrame(timebase, ticksPerFrame)) return kESErrBadArgumentList;
+
+    KeyframeCurve curve, resampled;
+    if (!parseKeyframeCurve(keys, curve)) return kESErrConversion;
+    if (!resampleKeyframeCurve(curve, ticksPerFrame, MAX_RESAMPLED_KEYS, resampled)) return kESErrRange;
+    appendKeyframeCurveScript(result.script, resampled);
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(resampleKeyframes, resampleKeyframesTyped)
+
+/**
+ * @brief Removes keys that a line between their neighbors already covers to within a tolerance.
+ * @param result Receives a script that evaluates to {ticks, values, interpolation} for the keys to keep.
+ * @param keys Packed keys, see Keyframes.h.
+ * @param tolerance Largest allowed change at any input key, in the property's units. Position values are fractions of
+ *                  the frame size, so 0.001 is about 2 pixels across 1920.
+ * @return kESErrOK on success, kESErrConversion if the keys are malformed, kESErrRange for a negative tolerance.
+ *
+ * JavaScript Usage: var curve = externalLibrary.simplifyKeyframes(packedKeys, 0.001);
+ */
+long simplifyKeyframesTyped(ScriptResult& result, const char* keys, double tolerance) {
+    if (!(tolerance >= 0)) return kESErrRange;
+
+    KeyframeCurve curve, simplified;
+    if (!parseKeyframeCurve(keys, curve)) return kESErrConversion;
+    simplifyKeyframeCurve(curve, tolerance, simplified);
+    appendKeyframeCurveScript(result.script, simplified);
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(simplifyKeyframes, simplifyKeyframesTyped)
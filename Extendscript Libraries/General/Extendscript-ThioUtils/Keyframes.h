@@ -0,0 +1,72 @@
+#pragma once
+
+// Keyframes.h
+// Native keyframe curves: evaluating, resampling to a frame rate, and simplifying the animation of one effect property.
+//
+// Scripts read and write keyframes one DOM call at a time (getKeys, getValueAtKey, addKey, setValueAtKey), which is
+// slow for dense motion tracks. With these, a script reads the keys once, does the math natively, and writes back only
+// the keys that are needed.
+//
+// A curve is passed as a packed string of keys, separated by ';' or newlines. Each key is "ticks,value,interpolation"
+// for a single value such as Scale, or "ticks,x,y,interpolation" for a point such as Position. Every key of a curve has
+// the same number of values, and the keys are in order of time with no two at the same time. The interpolation is
+// Premiere's type for the segment that starts at the key: 0 linear, 1 hold, and anything else (2 bezier, 3 time, ...)
+// is treated as smooth.
+//
+// Scripts can't read bezier handles, so smooth segments are evaluated as a cubic Hermite curve with Catmull-Rom
+// tangents (flat at the first and last key), which is close to what Premiere shows for auto bezier keys. Linear and
+// hold segments are exact.
+
+#include <string>
+#include <vector>
+
+#define KEYFRAME_MAX_DIMENSIONS 2
+
+// Interpolation types, as used by ComponentParam.setInterpolationTypeAtKey
+#define KEYFRAME_LINEAR 0
+#define KEYFRAME_HOLD   1
+#define KEYFRAME_BEZIER 2
+
+struct Keyframe {
+    long long ticks;
+    double value[KEYFRAME_MAX_DIMENSIONS];
+    int interpolation;
+};
+
+struct KeyframeCurve {
+    std::vector<Keyframe> keys;
+    int dimensions = 1;
+};
+
+/**
+ * @brief Parses a packed curve (see above).
+ * @return false if a key is malformed, the keys don't all have the same number of values, or they aren't in order.
+ */
+bool parseKeyframeCurve(const char* packed, KeyframeCurve& curve);
+
+/**
+ * @brief The curve's value at a time, written to value[0 .. dimensions). Before the first key it's the first key's
+ * value, and after the last key the last key's. The curve must have at least one key.
+ */
+void evaluateKeyframeCurve(const KeyframeCurve& curve, long long ticks, double* value);
+
+/**
+ * @brief Samples the curve once per frame, from the frame nearest its first key to the frame nearest its last.
+ * Samples in hold segments keep the hold, the rest are linear.
+ * @return false if that would be more than maxKeys keys.
+ */
+bool resampleKeyframeCurve(const KeyframeCurve& curve, long long ticksPerFrame, size_t maxKeys, KeyframeCurve& resampled);
+
+/**
+ * @brief Removes keys while keeping the curve within 'tolerance' of every input key (Ramer-Douglas-Peucker, measured
+ * at each key's own time, so timing is preserved as well as shape). For two values the error is the distance between
+ * the points. The first and last keys, hold keys and the keys right after holds are always kept.
+ * The result is linear between kept keys. To follow smooth segments between sparse keys, simplify a resampled curve.
+ */
+void simplifyKeyframeCurve(const KeyframeCurve& curve, double tolerance, KeyframeCurve& simplified);
+
+/**
+ * @brief Appends a curve as ({ticks:[...],values:[...],interpolation:[...]}). Ticks are strings like Time.ticks, and for
+ * two values each value is an [x, y] array, as ComponentParam.setValueAtKey takes for Position.
+ */
+void appendKeyframeCurveScript(std::string& out, const KeyframeCurve& curve);
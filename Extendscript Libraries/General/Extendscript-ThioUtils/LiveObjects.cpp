@@ -0,0 +1,134 @@
+#include "LiveObjects.h"
+#include "ThioUtils.h"
+#include "PackedData.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static SoServerInterface* liveObjectServer = nullptr;
+
+SoServerInterface* getLiveObjectServer() {
+    return liveObjectServer;
+}
+
+bool setLiveObjectData(SoHObject hObject, void* data) {
+    if (liveObjectServer == nullptr) {
+        return false;
+    }
+    return liveObjectServer->setClientData(hObject, data) == kESErrOK;
+}
+
+void* getLiveObjectData(SoHObject hObject) {
+    void* data = nullptr;
+    if (liveObjectServer == nullptr || liveObjectServer->getClientData(hObject, &data) != kESErrOK) {
+        return nullptr;
+    }
+    return data;
+}
+
+bool getIntegerArg(const TaggedData& arg, long long& value) {
+    switch (arg.type) {
+    case kTypeInteger:
+        value = arg.data.intval;
+        return true;
+    case kTypeUInteger:
+        value = (unsigned long)arg.data.intval;
+        return true;
+    case kTypeDouble:
+        // Only accept whole numbers that a double represents exactly
+        if (!std::isfinite(arg.data.fltval) || std::floor(arg.data.fltval) != arg.data.fltval || std::fabs(arg.data.fltval) > 9007199254740992.0) {
+            return false;
+        }
+        value = (long long)arg.data.fltval;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool getTicksArg(const TaggedData& arg, long long& value) {
+    if (arg.type == kTypeString) {
+        return parseInt64String(arg.data.string, value);
+    }
+    return getIntegerArg(arg, value);
+}
+
+bool getStringArg(const TaggedData& arg, const char*& value) {
+    if (arg.type != kTypeString || arg.data.string == nullptr) {
+        return false;
+    }
+    value = arg.data.string;
+    return true;
+}
+
+bool getBoolArg(const TaggedData& arg, bool& value) {
+    if (arg.type == kTypeBool) {
+        value = arg.data.intval != 0;
+        return true;
+    }
+    long long number = 0;
+    if (getIntegerArg(arg, number)) {
+        value = number != 0;
+        return true;
+    }
+    return false;
+}
+
+void setIntegerResult(TaggedData* result, long long value) {
+    // Return as a double, since ExtendScript integers are only 32 bits
+    result->type = kTypeDouble;
+    result->data.fltval = (double)value;
+}
+
+void setBoolResult(TaggedData* result, bool value) {
+    result->type = kTypeBool;
+    result->data.intval = value ? 1 : 0;
+}
+
+static long setMallocStringResult(TaggedData* result, const std::string& str, long type) {
+    char* copy = static_cast<char*>(malloc(str.size() + 1));
+    if (copy == nullptr) {
+        result->type = kTypeUndefined;
+        return THIO_ERR_NO_MEMORY;
+    }
+    memcpy(copy, str.c_str(), str.size() + 1);
+    result->type = type;
+    result->data.string = copy;
+    return kESErrOK;
+}
+
+long setLiveObjectStringResult(TaggedData* result, const std::string& str) {
+    return setMallocStringResult(result, str, kTypeString);
+}
+
+long setLiveObjectScriptResult(TaggedData* result, const std::string& script) {
+    return setMallocStringResult(result, script, kTypeScript);
+}
+
+//--------------------------------------------------------------------------------------
+//-------------------------- Required SoCClient entry point ----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Called by ExtendScript when the library is loaded (kSoCClient_init) and unloaded (kSoCClient_term).
+ * Registers all the LiveObject classes on init.
+ */
+extern "C" THIOUTILS_API ESerror_t ESClientInterface(SoCClient_e kReason, SoServerInterface* pServer, SoHServer hServer) {
+    if (kReason == kSoCClient_init) {
+        liveObjectServer = pServer;
+
+        ESerror_t err = registerTimelineIndexClass(pServer, hServer);
+        if (err != kESErrOK) return err;
+        err = registerMarkerIndexClass(pServer, hServer);
+        if (err != kESErrOK) return err;
+        err = registerProjectIndexClass(pServer, hServer);
+        if (err != kESErrOK) return err;
+        err = registerNativeBufferClass(pServer, hServer);
+        if (err != kESErrOK) return err;
+    }
+    else if (kReason == kSoCClient_term) {
+        // Objects are released through their finalize callbacks, so there's nothing else to free here
+        liveObjectServer = nullptr;
+    }
+    return kESErrOK;
+}
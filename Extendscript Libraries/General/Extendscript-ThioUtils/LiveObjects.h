@@ -0,0 +1,54 @@
+#pragma once
+
+// LiveObjects.h
+// Support for classes that scripts can create with 'new', e.g. "var index = new TimelineIndex();"
+//
+// These use the SoCClient.h interface. ExtendScript calls ESClientInterface when the library is loaded, and each
+// class registers itself there. Objects keep their native state between calls, so scripts can load data once and
+// then query it many times without passing it back in.
+//
+// Unlike the plain exports, method arguments aren't converted by a signature, so numbers can arrive as any numeric
+// type. Use the helpers below to read them.
+
+#include "SoCClient.h"
+#include "SoSharedLibDefs.h"
+#include <string>
+
+/**
+ * @brief The server interface passed to ESClientInterface. Needed to add methods and attach native data to objects.
+ * @return nullptr if ESClientInterface hasn't been called yet.
+ */
+SoServerInterface* getLiveObjectServer();
+
+/**
+ * @brief Attaches a native object to a LiveObject, and retrieves it. Wrappers around the server's client data functions.
+ */
+bool setLiveObjectData(SoHObject hObject, void* data);
+void* getLiveObjectData(SoHObject hObject);
+
+// Reads an integer argument. Accepts any numeric type as long as it's a whole number.
+bool getIntegerArg(const TaggedData& arg, long long& value);
+
+// Reads a tick value argument. Accepts a tick string (like Time.ticks) or a whole number.
+bool getTicksArg(const TaggedData& arg, long long& value);
+
+// Reads a string argument
+bool getStringArg(const TaggedData& arg, const char*& value);
+
+// Reads a boolean argument. Accepts booleans and numbers.
+bool getBoolArg(const TaggedData& arg, bool& value);
+
+// Sets simple results
+void setIntegerResult(TaggedData* result, long long value);
+void setBoolResult(TaggedData* result, bool value);
+
+// Sets string and script results. These use plain malloc rather than result memory (ResultMemory.h), since LiveObject
+// results aren't guaranteed to be released through ESFreeMem. Return kESErrOK or THIO_ERR_NO_MEMORY.
+long setLiveObjectStringResult(TaggedData* result, const std::string& str);
+long setLiveObjectScriptResult(TaggedData* result, const std::string& script);
+
+// --- Class registration, called from ESClientInterface. Each is defined in the class's own file. ---
+ESerror_t registerTimelineIndexClass(SoServerInterface* server, SoHServer hServer);
+ESerror_t registerMarkerIndexClass(SoServerInterface* server, SoHServer hServer);
+ESerror_t registerProjectIndexClass(SoServerInterface* server, SoHServer hServer);
+ESerror_t registerNativeBufferClass(SoServerInterface* server, SoHServer hServer);
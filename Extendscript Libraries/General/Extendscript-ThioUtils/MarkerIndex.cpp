@@ -0,0 +1,352 @@
+#include "MarkerIndex.h"
+#include "LiveObjects.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+
+// ------------------------------------------------------------------------------------------------
+// MarkerIndex
+// ------------------------------------------------------------------------------------------------
+
+void MarkerIndex::clear() {
+    markers.clear();
+    subtreeEnd.clear();
+}
+
+bool MarkerIndex::load(const char* packed) {
+    clear();
+    if (packed == nullptr) {
+        return false;
+    }
+
+    const char* p = packed;
+    while (*p != '\0') {
+        // Find the end of this record
+        const char* recordEnd = p;
+        while (*recordEnd != '\0' && *recordEnd != ';' && *recordEnd != '\n') {
+            ++recordEnd;
+        }
+
+        if (recordEnd > p) {
+            // The first three fields are numbers, the rest of the record is the id
+            std::vector<long long> numbers;
+            const char* field = p;
+            for (int i = 0; i < 3; i++) {
+                const char* comma = static_cast<const char*>(memchr(field, ',', recordEnd - field));
+                if (comma == nullptr || !parsePackedInt64s(field, comma, numbers) || numbers.size() != (size_t)i + 1) {
+                    clear();
+                    return false;
+                }
+                field = comma + 1;
+            }
+
+            if (numbers[1] < numbers[0] || numbers[2] < INT_MIN || numbers[2] > INT_MAX) {
+                clear();
+                return false;
+            }
+            markers.push_back(Marker{ numbers[0], numbers[1], (int)numbers[2], markers.size(), std::string(field, recordEnd) });
+        }
+
+        p = (*recordEnd == '\0') ? recordEnd : recordEnd + 1;
+    }
+
+    std::sort(markers.begin(), markers.end(), [](const Marker& a, const Marker& b) {
+        return (a.start != b.start) ? (a.start < b.start) : (a.order < b.order);
+    });
+    subtreeEnd.resize(markers.size());
+    buildSubtreeEnds(0, markers.size());
+    return true;
+}
+
+long long MarkerIndex::buildSubtreeEnds(size_t low, size_t high) {
+    if (low >= high) {
+        return LLONG_MIN;
+    }
+    const size_t middle = low + (high - low) / 2;
+    long long end = markers[middle].end;
+    end = std::max(end, buildSubtreeEnds(low, middle));
+    end = std::max(end, buildSubtreeEnds(middle + 1, high));
+    subtreeEnd[middle] = end;
+    return end;
+}
+
+void MarkerIndex::collect(size_t low, size_t high, long long first, long long last, std::vector<const Marker*>& results) const {
+    if (low >= high) {
+        return;
+    }
+    const size_t middle = low + (high - low) / 2;
+    if (subtreeEnd[middle] < first) {
+        return; // Everything in this subtree ends before the range
+    }
+
+    collect(low, middle, first, last, results);
+    if (markers[middle].start > last) {
+        return; // This marker and everything after it start after the range
+    }
+    if (markers[middle].end >= first) {
+        results.push_back(&markers[middle]);
+    }
+    collect(middle + 1, high, first, last, results);
+}
+
+void MarkerIndex::markersAt(long long ticks, std::vector<const Marker*>& results) const {
+    // start <= ticks <= end covers both kinds: a point marker only matches its own time
+    collect(0, markers.size(), ticks, ticks, results);
+}
+
+void MarkerIndex::markersInRange(long long start, long long end, std::vector<const Marker*>& results) const {
+    if (start == end) {
+        markersAt(start, results);
+        return;
+    }
+    if (end < start) {
+        return;
+    }
+
+    // The candidates also touch the range at its edges, which only counts for point markers at the start
+    const size_t firstResult = results.size();
+    collect(0, markers.size(), start, end, results);
+    auto kept = std::remove_if(results.begin() + firstResult, results.end(), [start, end](const Marker* marker) {
+        if (marker->end == marker->start) {
+            return marker->start == end;
+        }
+        return marker->end == start || marker->start == end;
+    });
+    results.erase(kept, results.end());
+}
+
+const MarkerIndex::Marker* MarkerIndex::predominant(long long start, long long end) const {
+    if (end <= start) {
+        return nullptr;
+    }
+
+    std::vector<const Marker*> found;
+    collect(0, markers.size(), start, end, found);
+
+    const Marker* best = nullptr;
+    long long bestOverlap = 0;
+    for (const Marker* marker : found) {
+        const long long overlap = std::min(marker->end, end) - std::max(marker->start, start);
+        if (overlap <= 0) {
+            continue; // Point markers, and markers that only touch the range
+        }
+        if (best == nullptr || overlap > bestOverlap || (overlap == bestOverlap && marker->order < best->order)) {
+            best = marker;
+            bestOverlap = overlap;
+        }
+    }
+    return best;
+}
+
+void MarkerIndex::coverage(long long start, long long end, std::vector<ColorCoverage>& results) const {
+    if (end <= start) {
+        return;
+    }
+
+    std::vector<const Marker*> found;
+    collect(0, markers.size(), start, end, found);
+
+    // The markers come sorted by start, so each color's covered time can be merged as a running union
+    std::vector<long long> coveredUntil;
+    for (const Marker* marker : found) {
+        const long long overlapStart = std::max(marker->start, start);
+        const long long overlapEnd = std::min(marker->end, end);
+        if (overlapEnd <= overlapStart) {
+            continue;
+        }
+
+        size_t slot = 0;
+        while (slot < results.size() && results[slot].color != marker->color) {
+            slot++;
+        }
+        if (slot == results.size()) {
+            results.push_back(ColorCoverage{ marker->color, 0 });
+            coveredUntil.push_back(LLONG_MIN);
+        }
+        if (overlapEnd > coveredUntil[slot]) {
+            results[slot].ticks += overlapEnd - std::max(overlapStart, coveredUntil[slot]);
+            coveredUntil[slot] = overlapEnd;
+        }
+    }
+
+    std::sort(results.begin(), results.end(), [](const ColorCoverage& a, const ColorCoverage& b) {
+        return a.color < b.color;
+    });
+}
+
+// ------------------------------------------------------------------------------------------------
+// LiveObject class: MarkerIndex
+//
+// JavaScript Usage:
+//      var index = new MarkerIndex();
+//      index.load("0,254016000000,0,0;127008000000,127008000000,3,1");    // start,end,color,id records
+//      index.at("127008000000");                                           // ["0","1"]
+//      index.inRange("0", "254016000000");                                 // ["0","1"]
+//      index.predominant("0", "508032000000");                             // "0"
+//      index.coverage("0", "508032000000");                                // {0:"254016000000"}
+//      index.count;
+// ------------------------------------------------------------------------------------------------
+
+enum MarkerIndexMember {
+    kMarkerIndex_load = 1,
+    kMarkerIndex_clear,
+    kMarkerIndex_at,
+    kMarkerIndex_inRange,
+    kMarkerIndex_predominant,
+    kMarkerIndex_coverage,
+    kMarkerIndex_count,
+};
+
+static SoCClientName markerIndexMethods[] = {
+    { "load",           kMarkerIndex_load,          nullptr },
+    { "clear",          kMarkerIndex_clear,         nullptr },
+    { "at",             kMarkerIndex_at,            nullptr },
+    { "inRange",        kMarkerIndex_inRange,       nullptr },
+    { "predominant",    kMarkerIndex_predominant,   nullptr },
+    { "coverage",       kMarkerIndex_coverage,      nullptr },
+    { nullptr, 0, nullptr }
+};
+
+static SoCClientName markerIndexProperties[] = {
+    { "count",  kMarkerIndex_count, nullptr },
+    { nullptr, 0, nullptr }
+};
+
+static ESerror_t markerIndexInitialize(SoHObject hObject, int argc, TaggedData* argv) {
+    SoServerInterface* server = getLiveObjectServer();
+    if (server == nullptr) return kESErrInternal;
+
+    MarkerIndex* index = new (std::nothrow) MarkerIndex();
+    if (index == nullptr) return THIO_ERR_NO_MEMORY;
+    if (!setLiveObjectData(hObject, index)) {
+        delete index;
+        return THIO_ERR_INTERNAL;
+    }
+
+    server->addMethods(hObject, markerIndexMethods);
+    server->addProperties(hObject, markerIndexProperties);
+
+    // Optionally load right away: new MarkerIndex(packedString)
+    if (argc >= 1 && argv[0].type == kTypeString) {
+        if (!index->load(argv[0].data.string)) return kESErrBadArgumentList;
+    }
+    return kESErrOK;
+}
+
+static ESerror_t markerIndexGet(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    MarkerIndex* index = static_cast<MarkerIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+
+    switch (name->id) {
+    case kMarkerIndex_count:
+        setIntegerResult(pValue, (long long)index->size());
+        return kESErrOK;
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t markerIndexPut(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    return kESErrNoLvalue; // All properties are read-only
+}
+
+static long setMarkerIdsResult(TaggedData* pResult, const std::vector<const MarkerIndex::Marker*>& found) {
+    std::string script = "[";
+    for (size_t i = 0; i < found.size(); i++) {
+        if (i > 0) script += ",";
+        appendJsString(script, found[i]->id.c_str(), found[i]->id.size());
+    }
+    script += "]";
+    return setLiveObjectScriptResult(pResult, script);
+}
+
+static ESerror_t markerIndexCall(SoHObject hObject, SoCClientName* name, int argc, TaggedData* argv, TaggedData* pResult) {
+    MarkerIndex* index = static_cast<MarkerIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+
+    long long start = 0, end = 0;
+
+    switch (name->id) {
+    case kMarkerIndex_load: {
+        const char* packed = nullptr;
+        if (argc != 1 || !getStringArg(argv[0], packed)) return kESErrBadArgumentList;
+        if (!index->load(packed)) return kESErrConversion;
+        setIntegerResult(pResult, (long long)index->size());
+        return kESErrOK;
+    }
+    case kMarkerIndex_clear:
+        index->clear();
+        return kESErrOK;
+
+    case kMarkerIndex_at: {
+        if (argc != 1 || !getTicksArg(argv[0], start)) return kESErrBadArgumentList;
+        std::vector<const MarkerIndex::Marker*> found;
+        index->markersAt(start, found);
+        return setMarkerIdsResult(pResult, found);
+    }
+    case kMarkerIndex_inRange: {
+        if (argc != 2 || !getTicksArg(argv[0], start) || !getTicksArg(argv[1], end)) return kESErrBadArgumentList;
+        std::vector<const MarkerIndex::Marker*> found;
+        index->markersInRange(start, end, found);
+        return setMarkerIdsResult(pResult, found);
+    }
+    case kMarkerIndex_predominant: {
+        if (argc != 2 || !getTicksArg(argv[0], start) || !getTicksArg(argv[1], end)) return kESErrBadArgumentList;
+        const MarkerIndex::Marker* marker = index->predominant(start, end);
+        if (marker == nullptr) {
+            return setLiveObjectScriptResult(pResult, "null");
+        }
+        return setLiveObjectStringResult(pResult, marker->id);
+    }
+    case kMarkerIndex_coverage: {
+        if (argc != 2 || !getTicksArg(argv[0], start) || !getTicksArg(argv[1], end)) return kESErrBadArgumentList;
+        std::vector<MarkerIndex::ColorCoverage> colors;
+        index->coverage(start, end, colors);
+        // Object keyed by color, with tick strings like Time.ticks
+        std::string script = "({";
+        for (size_t i = 0; i < colors.size(); i++) {
+            if (i > 0) script += ",";
+            script += std::to_string(colors[i].color);
+            script += ":";
+            appendJsInt64String(script, colors[i].ticks);
+        }
+        script += "})";
+        return setLiveObjectScriptResult(pResult, script);
+    }
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t markerIndexValueOf(SoHObject hObject, TaggedData* pResult) {
+    return kESErrOK; // Leaves the result undefined, there's no meaningful primitive value
+}
+
+static ESerror_t markerIndexToString(SoHObject hObject, TaggedData* pResult) {
+    MarkerIndex* index = static_cast<MarkerIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+    return setLiveObjectStringResult(pResult, "[MarkerIndex " + std::to_string(index->size()) + " markers]");
+}
+
+static ESerror_t markerIndexFinalize(SoHObject hObject) {
+    delete static_cast<MarkerIndex*>(getLiveObjectData(hObject));
+    setLiveObjectData(hObject, nullptr);
+    return kESErrOK;
+}
+
+static SoObjectInterface markerIndexInterface = {
+    markerIndexInitialize,
+    markerIndexPut,
+    markerIndexGet,
+    markerIndexCall,
+    markerIndexValueOf,
+    markerIndexToString,
+    markerIndexFinalize
+};
+
+ESerror_t registerMarkerIndexClass(SoServerInterface* server, SoHServer hServer) {
+    return server->addClass(hServer, (char*)"MarkerIndex", &markerIndexInterface);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// MarkerIndex.h
+// Native index of a sequence's markers, for range and point queries by time.
+//
+// Scripts load it once with the (start, end, color, id) of every marker, then query it instead of looping over
+// sequence.markers for every question. Unlike clips, markers can overlap each other freely, so the markers are kept
+// sorted by start in an implicit interval tree: the array itself is a balanced binary tree (each range's middle
+// element is its root), and each element also stores the largest end in its subtree. A query skips every subtree
+// that ends before it, so it costs O(log n + k) for k results.
+//
+// Times are in ticks. The queries follow the marker functions in ThioUtils.jsx: a point marker (end == start) is
+// at a time only if it's exactly that time, and a marker with a duration includes both its start and its end.
+// The index is rebuilt with load() rather than edited, since scripts get markers from one pass over the DOM.
+
+#include <string>
+#include <vector>
+
+class MarkerIndex {
+public:
+    struct Marker {
+        long long start;
+        long long end;
+        int color;
+        size_t order;   // Position in the loaded string, so ties resolve the same way as looping in JS
+        std::string id;
+    };
+
+    // Total ticks of a range covered by markers of one color
+    struct ColorCoverage {
+        int color;
+        long long ticks;
+    };
+
+    // Removes everything
+    void clear();
+
+    /**
+     * @brief Replaces the contents with the markers in a packed string. Records are separated by ';' or newlines,
+     * and each is "startTicks,endTicks,color,id". The id can be any text without separators, e.g. the marker's index.
+     * @return false if the string is malformed or a marker ends before it starts. The index is left empty in that case.
+     */
+    bool load(const char* packed);
+
+    // Markers at a time: point markers exactly at it, and markers with a duration that include it. Sorted by start.
+    void markersAt(long long ticks, std::vector<const Marker*>& results) const;
+
+    // Markers overlapping [start, end), including point markers inside it. Sorted by start.
+    // If start == end, it's a point query like markersAt.
+    void markersInRange(long long start, long long end, std::vector<const Marker*>& results) const;
+
+    /**
+     * @brief The marker with a duration that covers the most of [start, end), like getPredominantMarker_ForTimeRange.
+     * Ties go to the marker loaded first. Point markers are never counted.
+     * @return nullptr if no marker with a duration overlaps the range.
+     */
+    const Marker* predominant(long long start, long long end) const;
+
+    /**
+     * @brief How much of [start, end) is covered by each marker color. Overlapping markers of the same color are only
+     * counted once, so no color can cover more than the range. Colors that don't appear are left out.
+     * @param results Sorted by color.
+     */
+    void coverage(long long start, long long end, std::vector<ColorCoverage>& results) const;
+
+    size_t size() const { return markers.size(); }
+
+private:
+    std::vector<Marker> markers;        // Sorted by start, then by order
+    std::vector<long long> subtreeEnd;  // Largest end in the implicit subtree rooted at each element
+
+    long long buildSubtreeEnds(size_t low, size_t high);
+
+    // Appends, in order of start, every marker with start <= last and end >= first
+    void collect(size_t low, size_t high, long long first, long long last, std::vector<const Marker*>& results) const;
+};
@@ -0,0 +1,684 @@
+#include "NativeBuffer.h"
+#include "LiveObjects.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <new>
+
+// ------------------------------------------------------------------------------------------------
+// NativeBuffer
+// ------------------------------------------------------------------------------------------------
+
+static NativeBuffer::Number integerNumber(long long value) {
+    return NativeBuffer::Number{ true, value, 0.0 };
+}
+
+static NativeBuffer::Number realNumber(double value) {
+    return NativeBuffer::Number{ false, 0, value };
+}
+
+static double toDouble(const NativeBuffer::Number& value) {
+    return value.isInteger ? (double)value.integer : value.real;
+}
+
+// Converts a number for an integer buffer. Fractions, NaN and anything outside [low, high] don't fit.
+static bool toInteger(const NativeBuffer::Number& value, long long low, long long high, long long& result) {
+    if (value.isInteger) {
+        result = value.integer;
+    }
+    else {
+        // -2^63 is the smallest long long, and 2^63 is already past the largest
+        if (!std::isfinite(value.real) || std::floor(value.real) != value.real || value.real < -9223372036854775808.0 || value.real >= 9223372036854775808.0) {
+            return false;
+        }
+        result = (long long)value.real;
+    }
+    return result >= low && result <= high;
+}
+
+NativeBuffer::NativeBuffer(const NativeBuffer& source, size_t begin, size_t end) : elementType(source.elementType) {
+    end = std::min(end, source.size());
+    begin = std::min(begin, end);
+    switch (elementType) {
+    case kFloat64:
+        f64.assign(source.f64.begin() + begin, source.f64.begin() + end);
+        break;
+    case kInt64:
+        i64.assign(source.i64.begin() + begin, source.i64.begin() + end);
+        break;
+    case kInt32:
+        i32.assign(source.i32.begin() + begin, source.i32.begin() + end);
+        break;
+    }
+}
+
+bool NativeBuffer::parseElementType(const char* name, ElementType& type) {
+    if (name == nullptr) return false;
+    if (strcmp(name, "f64") == 0) type = kFloat64;
+    else if (strcmp(name, "i64") == 0) type = kInt64;
+    else if (strcmp(name, "i32") == 0) type = kInt32;
+    else return false;
+    return true;
+}
+
+const char* NativeBuffer::elementTypeName(ElementType type) {
+    switch (type) {
+    case kFloat64: return "f64";
+    case kInt64: return "i64";
+    case kInt32: return "i32";
+    }
+    return "";
+}
+
+size_t NativeBuffer::size() const {
+    switch (elementType) {
+    case kFloat64: return f64.size();
+    case kInt64: return i64.size();
+    case kInt32: return i32.size();
+    }
+    return 0;
+}
+
+void NativeBuffer::resize(size_t count) {
+    switch (elementType) {
+    case kFloat64:
+        f64.resize(count, 0.0);
+        break;
+    case kInt64:
+        i64.resize(count, 0);
+        break;
+    case kInt32:
+        i32.resize(count, 0);
+        break;
+    }
+}
+
+bool NativeBuffer::load(const char* packed) {
+    if (packed == nullptr) {
+        return false;
+    }
+    const char* end = packed + strlen(packed);
+
+    if (elementType == kFloat64) {
+        std::vector<double> values;
+        if (!parsePackedDoubles(packed, end, values)) return false;
+        f64.swap(values);
+        return true;
+    }
+
+    std::vector<long long> values;
+    if (!parsePackedInt64s(packed, end, values)) return false;
+    if (elementType == kInt64) {
+        i64.swap(values);
+        return true;
+    }
+
+    std::vector<int32_t> narrowed(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        if (values[i] < INT32_MIN || values[i] > INT32_MAX) return false;
+        narrowed[i] = (int32_t)values[i];
+    }
+    i32.swap(narrowed);
+    return true;
+}
+
+NativeBuffer::Number NativeBuffer::get(size_t index) const {
+    switch (elementType) {
+    case kFloat64: return realNumber(f64[index]);
+    case kInt64: return integerNumber(i64[index]);
+    case kInt32: return integerNumber(i32[index]);
+    }
+    return integerNumber(0);
+}
+
+bool NativeBuffer::set(size_t index, const Number& value) {
+    return index < size() && fill(index, index + 1, value);
+}
+
+bool NativeBuffer::fill(size_t begin, size_t end, const Number& value) {
+    end = std::min(end, size());
+    begin = std::min(begin, end);
+
+    long long integer = 0;
+    switch (elementType) {
+    case kFloat64:
+        std::fill(f64.begin() + begin, f64.begin() + end, toDouble(value));
+        return true;
+    case kInt64:
+        if (!toInteger(value, LLONG_MIN, LLONG_MAX, integer)) return false;
+        std::fill(i64.begin() + begin, i64.begin() + end, integer);
+        return true;
+    case kInt32:
+        if (!toInteger(value, INT32_MIN, INT32_MAX, integer)) return false;
+        std::fill(i32.begin() + begin, i32.begin() + end, (int32_t)integer);
+        return true;
+    }
+    return false;
+}
+
+// Smallest or largest of a non-empty run of values
+template <typename T>
+static T findExtreme(const T* values, size_t count, bool largest) {
+    T best = values[0];
+    if (largest) {
+        for (size_t i = 1; i < count; i++) best = (values[i] > best) ? values[i] : best;
+    }
+    else {
+        for (size_t i = 1; i < count; i++) best = (values[i] < best) ? values[i] : best;
+    }
+    return best;
+}
+
+// Shared body of minimum and maximum
+static bool reduceExtreme(const NativeBuffer& buffer, size_t begin, size_t end, bool largest, NativeBuffer::Number& result) {
+    end = std::min(end, buffer.size());
+    if (begin >= end) {
+        return false;
+    }
+
+    switch (buffer.type()) {
+    case NativeBuffer::kFloat64: {
+        const double* values = buffer.doubles() + begin;
+        // The comparisons skip NaN, so look for it separately to propagate it like Math.min
+        for (size_t i = 0; i < end - begin; i++) {
+            if (std::isnan(values[i])) {
+                result = realNumber(values[i]);
+                return true;
+            }
+        }
+        result = realNumber(findExtreme(values, end - begin, largest));
+        return true;
+    }
+    case NativeBuffer::kInt64:
+        result = integerNumber(findExtreme(buffer.int64s() + begin, end - begin, largest));
+        return true;
+    case NativeBuffer::kInt32:
+        result = integerNumber(findExtreme(buffer.int32s() + begin, end - begin, largest));
+        return true;
+    }
+    return false;
+}
+
+bool NativeBuffer::minimum(size_t begin, size_t end, Number& result) const {
+    return reduceExtreme(*this, begin, end, false, result);
+}
+
+bool NativeBuffer::maximum(size_t begin, size_t end, Number& result) const {
+    return reduceExtreme(*this, begin, end, true, result);
+}
+
+bool NativeBuffer::sum(size_t begin, size_t end, Number& result) const {
+    end = std::min(end, size());
+    begin = std::min(begin, end);
+
+    switch (elementType) {
+    case kFloat64: {
+        // Neumaier's compensated sum, so small values aren't lost against a large running total
+        double total = 0.0, compensation = 0.0;
+        for (size_t i = begin; i < end; i++) {
+            const double value = f64[i];
+            const double next = total + value;
+            compensation += (std::fabs(total) >= std::fabs(value)) ? (total - next) + value : (value - next) + total;
+            total = next;
+        }
+        // Once the total is infinite or NaN the compensation is meaningless, and may be NaN itself
+        result = realNumber(std::isfinite(total) ? total + compensation : total);
+        return true;
+    }
+    case kInt64: {
+        long long total = 0;
+        for (size_t i = begin; i < end; i++) {
+            const long long value = i64[i];
+            if ((value > 0 && total > LLONG_MAX - value) || (value < 0 && total < LLONG_MIN - value)) {
+                return false;
+            }
+            total += value;
+        }
+        result = integerNumber(total);
+        return true;
+    }
+    case kInt32: {
+        // 2^32 elements would be needed to overflow, far more than a buffer can hold
+        long long total = 0;
+        for (size_t i = begin; i < end; i++) total += i32[i];
+        result = integerNumber(total);
+        return true;
+    }
+    }
+    return false;
+}
+
+void NativeBuffer::appendElement(std::string& out, size_t index, bool quoteInt64) const {
+    switch (elementType) {
+    case kFloat64:
+        appendJsNumber(out, f64[index]);
+        break;
+    case kInt64:
+        if (quoteInt64) appendJsInt64String(out, i64[index]);
+        else out += std::to_string(i64[index]);
+        break;
+    case kInt32:
+        out += std::to_string(i32[index]);
+        break;
+    }
+}
+
+void NativeBuffer::appendPacked(std::string& out, size_t begin, size_t end, const char* separator) const {
+    end = std::min(end, size());
+    out.reserve(out.size() + (end > begin ? end - begin : 0) * 12);
+    for (size_t i = begin; i < end; i++) {
+        if (i > begin) out += separator;
+        appendElement(out, i, false);
+    }
+}
+
+void NativeBuffer::appendScriptArray(std::string& out, size_t begin, size_t end) const {
+    end = std::min(end, size());
+    out += "[";
+    for (size_t i = begin; i < end; i++) {
+        if (i > begin) out += ",";
+        appendElement(out, i, true);
+    }
+    out += "]";
+}
+
+// ------------------------------------------------------------------------------------------------
+// Buffers as export arguments
+// ------------------------------------------------------------------------------------------------
+
+NativeBuffer* getNativeBufferArg(const TaggedData& arg) {
+    if ((arg.type != kTypeLiveObject && arg.type != kTypeLiveObjectRelease) || arg.data.hObject == nullptr) {
+        return nullptr;
+    }
+    SoServerInterface* server = getLiveObjectServer();
+    if (server == nullptr) {
+        return nullptr;
+    }
+
+    // Other classes have their own native data, so check the class before trusting it
+    char className[32] = {};
+    if (server->getClass(arg.data.hObject, className, (int)sizeof(className)) != kESErrOK || strcmp(className, "NativeBuffer") != 0) {
+        return nullptr;
+    }
+    return static_cast<NativeBuffer*>(getLiveObjectData(arg.data.hObject));
+}
+
+long getNumericArg(const TaggedData& arg, NumericSpan<double>& values) {
+    values.converted.clear();
+
+    if (arg.type == kTypeLiveObject || arg.type == kTypeLiveObjectRelease) {
+        const NativeBuffer* buffer = getNativeBufferArg(arg);
+        if (buffer == nullptr) return kESErrTypeMismatch;
+        if (buffer->type() == NativeBuffer::kFloat64) {
+            values.values = buffer->doubles();
+            values.count = buffer->size();
+            return kESErrOK;
+        }
+        values.converted.resize(buffer->size());
+        for (size_t i = 0; i < buffer->size(); i++) values.converted[i] = toDouble(buffer->get(i));
+    }
+    else if (arg.type == kTypeString) {
+        if (arg.data.string == nullptr) return kESErrBadArgumentList;
+        if (!parsePackedDoubles(arg.data.string, arg.data.string + strlen(arg.data.string), values.converted)) return kESErrConversion;
+    }
+    else if (arg.type == kTypeDouble) {
+        values.converted.push_back(arg.data.fltval);
+    }
+    else if (arg.type == kTypeInteger) {
+        values.converted.push_back((double)arg.data.intval);
+    }
+    else if (arg.type == kTypeUInteger) {
+        values.converted.push_back((double)(unsigned long)arg.data.intval);
+    }
+    else {
+        return kESErrTypeMismatch;
+    }
+
+    values.values = values.converted.data();
+    values.count = values.converted.size();
+    return kESErrOK;
+}
+
+long getNumericArg(const TaggedData& arg, NumericSpan<long long>& values) {
+    values.converted.clear();
+
+    if (arg.type == kTypeLiveObject || arg.type == kTypeLiveObjectRelease) {
+        const NativeBuffer* buffer = getNativeBufferArg(arg);
+        if (buffer == nullptr) return kESErrTypeMismatch;
+        if (buffer->type() == NativeBuffer::kInt64) {
+            values.values = buffer->int64s();
+            values.count = buffer->size();
+            return kESErrOK;
+        }
+        values.converted.resize(buffer->size());
+        for (size_t i = 0; i < buffer->size(); i++) {
+            if (!toInteger(buffer->get(i), LLONG_MIN, LLONG_MAX, values.converted[i])) return kESErrConversion;
+        }
+    }
+    else if (arg.type == kTypeString) {
+        if (arg.data.string == nullptr) return kESErrBadArgumentList;
+        if (!parsePackedInt64s(arg.data.string, arg.data.string + strlen(arg.data.string), values.converted)) return kESErrConversion;
+    }
+    else if (arg.type == kTypeDouble || arg.type == kTypeInteger || arg.type == kTypeUInteger) {
+        long long value = 0;
+        if (!getIntegerArg(arg, value)) return kESErrConversion;
+        values.converted.push_back(value);
+    }
+    else {
+        return kESErrTypeMismatch;
+    }
+
+    values.values = values.converted.data();
+    values.count = values.converted.size();
+    return kESErrOK;
+}
+
+// ------------------------------------------------------------------------------------------------
+// LiveObject class: NativeBuffer
+//
+// JavaScript Usage:
+//      var buffer = new NativeBuffer("f64", "1.5,2.5,-4");     // Or new NativeBuffer("i64", 1000) for 1000 zeros
+//      buffer.get(0);                                          // 1.5
+//      buffer.set(2, 8);
+//      buffer.sum();                                           // 12.5
+//      buffer.max(0, 2);                                       // 2.5, over elements [0, 2)
+//      buffer.slice(-2);                                       // [2.5,8]
+//      buffer.join();                                          // "1.5,2.5,8"
+//      var part = new NativeBuffer(buffer, 1, 3);              // A new buffer holding a copy of elements [1, 3)
+//      externalLibrary.fitEllipse(buffer);                     // Exports taking packed numbers read it in place
+//      buffer.length; buffer.type;
+// ------------------------------------------------------------------------------------------------
+
+enum NativeBufferMember {
+    kNativeBuffer_get = 1,
+    kNativeBuffer_set,
+    kNativeBuffer_fill,
+    kNativeBuffer_load,
+    kNativeBuffer_resize,
+    kNativeBuffer_slice,
+    kNativeBuffer_join,
+    kNativeBuffer_min,
+    kNativeBuffer_max,
+    kNativeBuffer_sum,
+    kNativeBuffer_length,
+    kNativeBuffer_type,
+};
+
+static SoCClientName nativeBufferMethods[] = {
+    { "get",        kNativeBuffer_get,      nullptr },
+    { "set",        kNativeBuffer_set,      nullptr },
+    { "fill",       kNativeBuffer_fill,     nullptr },
+    { "load",       kNativeBuffer_load,     nullptr },
+    { "resize",     kNativeBuffer_resize,   nullptr },
+    { "slice",      kNativeBuffer_slice,    nullptr },
+    { "join",       kNativeBuffer_join,     nullptr },
+    { "min",        kNativeBuffer_min,      nullptr },
+    { "max",        kNativeBuffer_max,      nullptr },
+    { "sum",        kNativeBuffer_sum,      nullptr },
+    { nullptr, 0, nullptr }
+};
+
+static SoCClientName nativeBufferProperties[] = {
+    { "length", kNativeBuffer_length,   nullptr },
+    { "type",   kNativeBuffer_type,     nullptr },
+    { nullptr, 0, nullptr }
+};
+
+// Reads an element value: any number, or a string holding one, such as a tick value
+static bool getNumberArg(const TaggedData& arg, NativeBuffer::Number& value) {
+    long long integer = 0;
+    switch (arg.type) {
+    case kTypeInteger:
+    case kTypeUInteger:
+        getIntegerArg(arg, integer);
+        value = integerNumber(integer);
+        return true;
+    case kTypeDouble:
+        value = realNumber(arg.data.fltval);
+        return true;
+    case kTypeString: {
+        if (arg.data.string == nullptr) return false;
+        if (parseInt64String(arg.data.string, integer)) {
+            value = integerNumber(integer);
+            return true;
+        }
+        std::vector<double> parsed;
+        if (!parsePackedDoubles(arg.data.string, arg.data.string + strlen(arg.data.string), parsed) || parsed.size() != 1) return false;
+        value = realNumber(parsed[0]);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Reads an element index, which must be inside the buffer. Returns kESErrOK, kESErrBadArgumentList or kESErrRange.
+static long getIndexArg(const TaggedData& arg, const NativeBuffer& buffer, size_t& index) {
+    long long value = 0;
+    if (!getIntegerArg(arg, value)) return kESErrBadArgumentList;
+    if (value < 0 || (unsigned long long)value >= buffer.size()) return kESErrRange;
+    index = (size_t)value;
+    return kESErrOK;
+}
+
+// Reads optional begin and end arguments from argv[first] on, like Array.slice: negative values count back from the
+// end, both are clamped to the buffer, and missing or undefined ones mean the start and the end.
+static bool getRangeArgs(int argc, TaggedData* argv, int first, size_t size, size_t& begin, size_t& end) {
+    if (argc > first + 2) {
+        return false;
+    }
+    long long bounds[2] = { 0, (long long)size };
+    for (int i = 0; i < 2; i++) {
+        if (first + i >= argc || argv[first + i].type == kTypeUndefined) continue;
+        long long value = 0;
+        if (!getIntegerArg(argv[first + i], value)) return false;
+        if (value < 0) value += (long long)size;
+        bounds[i] = std::max(0LL, std::min(value, (long long)size));
+    }
+    begin = (size_t)bounds[0];
+    end = (size_t)std::max(bounds[0], bounds[1]);
+    return true;
+}
+
+// Returns an element or reduction result. i64 values are strings, like Time.ticks.
+static long setNumberResult(TaggedData* pResult, NativeBuffer::ElementType type, const NativeBuffer::Number& value) {
+    if (type == NativeBuffer::kInt64) {
+        return setLiveObjectStringResult(pResult, std::to_string(value.integer));
+    }
+    if (value.isInteger) {
+        setIntegerResult(pResult, value.integer);
+    }
+    else {
+        pResult->type = kTypeDouble;
+        pResult->data.fltval = value.real;
+    }
+    return kESErrOK;
+}
+
+// Creates the buffer for new NativeBuffer(...), which takes (), (type), (type, length), (type, packed),
+// or (source, begin, end) to copy part of another buffer
+static ESerror_t createNativeBuffer(int argc, TaggedData* argv, NativeBuffer*& buffer) {
+    const NativeBuffer* source = (argc >= 1) ? getNativeBufferArg(argv[0]) : nullptr;
+    if (source != nullptr) {
+        size_t begin = 0, end = 0;
+        if (!getRangeArgs(argc, argv, 1, source->size(), begin, end)) return kESErrBadArgumentList;
+        buffer = new NativeBuffer(*source, begin, end);
+        return kESErrOK;
+    }
+
+    NativeBuffer::ElementType type = NativeBuffer::kFloat64;
+    const char* typeName = nullptr;
+    if (argc > 2) return kESErrBadArgumentList;
+    if (argc >= 1 && (!getStringArg(argv[0], typeName) || !NativeBuffer::parseElementType(typeName, type))) return kESErrBadArgumentList;
+
+    std::unique_ptr<NativeBuffer> created(new NativeBuffer(type));
+    if (argc == 2) {
+        long long length = 0;
+        const char* packed = nullptr;
+        if (getStringArg(argv[1], packed)) {
+            if (!created->load(packed)) return kESErrConversion;
+        }
+        else if (getIntegerArg(argv[1], length)) {
+            if (length < 0) return kESErrRange;
+            created->resize((size_t)length);
+        }
+        else {
+            return kESErrBadArgumentList;
+        }
+    }
+    buffer = created.release();
+    return kESErrOK;
+}
+
+static ESerror_t nativeBufferInitialize(SoHObject hObject, int argc, TaggedData* argv) {
+    SoServerInterface* server = getLiveObjectServer();
+    if (server == nullptr) return kESErrInternal;
+
+    NativeBuffer* buffer = nullptr;
+    try {
+        const ESerror_t err = createNativeBuffer(argc, argv, buffer);
+        if (err != kESErrOK) return err;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+    if (!setLiveObjectData(hObject, buffer)) {
+        delete buffer;
+        return THIO_ERR_INTERNAL;
+    }
+
+    server->addMethods(hObject, nativeBufferMethods);
+    server->addProperties(hObject, nativeBufferProperties);
+    return kESErrOK;
+}
+
+static ESerror_t nativeBufferGet(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    NativeBuffer* buffer = static_cast<NativeBuffer*>(getLiveObjectData(hObject));
+    if (buffer == nullptr) return kESErrInvalidObject;
+
+    switch (name->id) {
+    case kNativeBuffer_length:
+        setIntegerResult(pValue, (long long)buffer->size());
+        return kESErrOK;
+    case kNativeBuffer_type:
+        return setLiveObjectStringResult(pValue, NativeBuffer::elementTypeName(buffer->type()));
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t nativeBufferPut(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    return kESErrNoLvalue; // All properties are read-only, use resize() to change the length
+}
+
+static ESerror_t nativeBufferCallMember(NativeBuffer& buffer, int memberId, int argc, TaggedData* argv, TaggedData* pResult) {
+    size_t index = 0, begin = 0, end = 0;
+    NativeBuffer::Number value{};
+    long err = kESErrOK;
+
+    switch (memberId) {
+    case kNativeBuffer_get:
+        if (argc != 1) return kESErrBadArgumentList;
+        if ((err = getIndexArg(argv[0], buffer, index)) != kESErrOK) return err;
+        return setNumberResult(pResult, buffer.type(), buffer.get(index));
+
+    case kNativeBuffer_set:
+        if (argc != 2 || !getNumberArg(argv[1], value)) return kESErrBadArgumentList;
+        if ((err = getIndexArg(argv[0], buffer, index)) != kESErrOK) return err;
+        return buffer.set(index, value) ? kESErrOK : kESErrConversion;
+
+    case kNativeBuffer_fill:
+        if (argc < 1 || !getNumberArg(argv[0], value) || !getRangeArgs(argc, argv, 1, buffer.size(), begin, end)) return kESErrBadArgumentList;
+        return buffer.fill(begin, end, value) ? kESErrOK : kESErrConversion;
+
+    case kNativeBuffer_load: {
+        const char* packed = nullptr;
+        if (argc != 1 || !getStringArg(argv[0], packed)) return kESErrBadArgumentList;
+        if (!buffer.load(packed)) return kESErrConversion;
+        setIntegerResult(pResult, (long long)buffer.size());
+        return kESErrOK;
+    }
+    case kNativeBuffer_resize: {
+        long long length = 0;
+        if (argc != 1 || !getIntegerArg(argv[0], length)) return kESErrBadArgumentList;
+        if (length < 0) return kESErrRange;
+        buffer.resize((size_t)length);
+        return kESErrOK;
+    }
+    case kNativeBuffer_slice: {
+        if (!getRangeArgs(argc, argv, 0, buffer.size(), begin, end)) return kESErrBadArgumentList;
+        std::string script;
+        buffer.appendScriptArray(script, begin, end);
+        return setLiveObjectScriptResult(pResult, script);
+    }
+    case kNativeBuffer_join: {
+        const char* separator = ",";
+        if (argc > 1 || (argc == 1 && argv[0].type != kTypeUndefined && !getStringArg(argv[0], separator))) return kESErrBadArgumentList;
+        std::string packed;
+        buffer.appendPacked(packed, 0, buffer.size(), separator);
+        return setLiveObjectStringResult(pResult, packed);
+    }
+    case kNativeBuffer_min:
+    case kNativeBuffer_max: {
+        if (!getRangeArgs(argc, argv, 0, buffer.size(), begin, end)) return kESErrBadArgumentList;
+        const bool found = (memberId == kNativeBuffer_min) ? buffer.minimum(begin, end, value) : buffer.maximum(begin, end, value);
+        if (!found) {
+            return setLiveObjectScriptResult(pResult, "null");
+        }
+        return setNumberResult(pResult, buffer.type(), value);
+    }
+    case kNativeBuffer_sum:
+        if (!getRangeArgs(argc, argv, 0, buffer.size(), begin, end)) return kESErrBadArgumentList;
+        if (!buffer.sum(begin, end, value)) return kESErrRange;
+        return setNumberResult(pResult, buffer.type(), value);
+
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t nativeBufferCall(SoHObject hObject, SoCClientName* name, int argc, TaggedData* argv, TaggedData* pResult) {
+    NativeBuffer* buffer = static_cast<NativeBuffer*>(getLiveObjectData(hObject));
+    if (buffer == nullptr) return kESErrInvalidObject;
+
+    try {
+        return nativeBufferCallMember(*buffer, name->id, argc, argv, pResult);
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY; // A resize or a result too large to build
+    }
+}
+
+static ESerror_t nativeBufferValueOf(SoHObject hObject, TaggedData* pResult) {
+    return kESErrOK; // Leaves the result undefined, there's no meaningful primitive value
+}
+
+static ESerror_t nativeBufferToString(SoHObject hObject, TaggedData* pResult) {
+    NativeBuffer* buffer = static_cast<NativeBuffer*>(getLiveObjectData(hObject));
+    if (buffer == nullptr) return kESErrInvalidObject;
+    return setLiveObjectStringResult(pResult, std::string("[NativeBuffer ") + NativeBuffer::elementTypeName(buffer->type()) + " " + std::to_string(buffer->size()) + " values]");
+}
+
+static ESerror_t nativeBufferFinalize(SoHObject hObject) {
+    delete static_cast<NativeBuffer*>(getLiveObjectData(hObject));
+    setLiveObjectData(hObject, nullptr);
+    return kESErrOK;
+}
+
+static SoObjectInterface nativeBufferInterface = {
+    nativeBufferInitialize,
+    nativeBufferPut,
+    nativeBufferGet,
+    nativeBufferCall,
+    nativeBufferValueOf,
+    nativeBufferToString,
+    nativeBufferFinalize
+};
+
+ESerror_t registerNativeBufferClass(SoServerInterface* server, SoHServer hServer) {
+    return server->addClass(hServer, (char*)"NativeBuffer", &nativeBufferInterface);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+// NativeBuffer.h
+// Typed numeric array that scripts create with 'new NativeBuffer(...)', since ES3 has nothing like Float64Array and
+// bulk numbers otherwise live in arrays of boxed values or packed strings.
+//
+// A buffer holds one element type: "f64" (doubles), "i64" (64-bit integers such as ticks) or "i32". Scripts fill it
+// from a packed string once, then read, change and reduce it in place. Exports that take a NumericSpan argument
+// (the TimeMath batch functions, fitEllipse) accept a buffer wherever they take packed numbers, and read its storage
+// directly instead of parsing a string.
+//
+// i64 values go back to scripts as strings, like Time.ticks, since ExtendScript numbers lose precision past 2^53.
+
+#include "SoSharedLibDefs.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class NativeBuffer {
+public:
+    enum ElementType {
+        kFloat64,
+        kInt64,
+        kInt32,
+    };
+
+    // One element or reduction result. Integer buffers give integers, f64 buffers give doubles.
+    struct Number {
+        bool isInteger;
+        long long integer;
+        double real;
+    };
+
+    explicit NativeBuffer(ElementType type) : elementType(type) {}
+
+    // Copies elements [begin, end) of another buffer, with the same element type
+    NativeBuffer(const NativeBuffer& source, size_t begin, size_t end);
+
+    // "f64", "i64" or "i32". Returns false for anything else.
+    static bool parseElementType(const char* name, ElementType& type);
+    static const char* elementTypeName(ElementType type);
+
+    ElementType type() const { return elementType; }
+    size_t size() const;
+
+    // Changes the length. New elements are zero.
+    void resize(size_t count);
+
+    /**
+     * @brief Replaces the contents with the numbers in a packed string (see PackedData.h).
+     * @return false if a number doesn't parse or doesn't fit the element type. The buffer is unchanged in that case.
+     */
+    bool load(const char* packed);
+
+    Number get(size_t index) const;
+
+    // Sets one element, or every element in [begin, end). They return false if the value doesn't fit the element type,
+    // e.g. a fraction or NaN in an integer buffer.
+    bool set(size_t index, const Number& value);
+    bool fill(size_t begin, size_t end, const Number& value);
+
+    // Reductions over [begin, end). minimum and maximum return false for an empty range, and give NaN for an f64 range
+    // containing NaN, like Math.min. sum returns false if an i64 sum overflows, and uses a compensated sum for f64.
+    bool minimum(size_t begin, size_t end, Number& result) const;
+    bool maximum(size_t begin, size_t end, Number& result) const;
+    bool sum(size_t begin, size_t end, Number& result) const;
+
+    // Appends elements [begin, end) as a packed string, e.g. "1,2,3", which any export taking packed numbers reads
+    void appendPacked(std::string& out, size_t begin, size_t end, const char* separator) const;
+
+    // Appends elements [begin, end) as a JavaScript array literal. i64 elements are strings.
+    void appendScriptArray(std::string& out, size_t begin, size_t end) const;
+
+    // The storage for the buffer's element type, or nullptr if the buffer holds another type
+    const double* doubles() const { return (elementType == kFloat64) ? f64.data() : nullptr; }
+    const long long* int64s() const { return (elementType == kInt64) ? i64.data() : nullptr; }
+    const int32_t* int32s() const { return (elementType == kInt32) ? i32.data() : nullptr; }
+
+private:
+    ElementType elementType;
+
+    // Only the vector for elementType is used
+    std::vector<double> f64;
+    std::vector<long long> i64;
+    std::vector<int32_t> i32;
+
+    void appendElement(std::string& out, size_t index, bool quoteInt64) const;
+};
+
+/**
+ * @brief The NativeBuffer behind an argument, if it's a NativeBuffer LiveObject.
+ * @return nullptr for any other argument, including other LiveObject classes.
+ */
+NativeBuffer* getNativeBufferArg(const TaggedData& arg);
+
+// Numbers from an export argument that can be a packed string or a NativeBuffer. A buffer holding T is read in place.
+// Anything else (a string, a single number, or a buffer of another type) is converted into 'converted', which 'values'
+// then points to. Not copyable, since 'values' can point into itself.
+template <typename T>
+struct NumericSpan {
+    const T* values = nullptr;
+    size_t count = 0;
+    std::vector<T> converted;
+
+    NumericSpan() = default;
+    NumericSpan(const NumericSpan&) = delete;
+    NumericSpan& operator=(const NumericSpan&) = delete;
+
+    size_t size() const { return count; }
+    const T* data() const { return values; }
+    const T& operator[](size_t index) const { return values[index]; }
+    const T* begin() const { return values; }
+    const T* end() const { return values + count; }
+};
+
+/**
+ * @brief Reads a numeric argument: a packed string, a single number, or a NativeBuffer.
+ * @return kESErrOK, kESErrTypeMismatch for other argument types, kESErrConversion if the string doesn't parse or an f64
+ *         value isn't a whole number for the integer version, or kESErrBadArgumentList for a null string.
+ */
+long getNumericArg(const TaggedData& arg, NumericSpan<double>& values);
+long getNumericArg(const TaggedData& arg, NumericSpan<long long>& values);
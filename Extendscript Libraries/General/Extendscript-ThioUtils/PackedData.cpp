@@ -0,0 +1,284 @@
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include "ResultMemory.h"
+#include <charconv>   // For std::from_chars / std::to_chars (locale independent, no allocations)
+#include <cmath>      // For std::isnan, std::isinf
+#include <cstring>    // For memcpy
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PACKED_DATA_SSE2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Characters that separate numbers within a single record
+static inline bool isValueSeparator(char c) {
+    return c == ',' || c == ' ' || c == '\t' || c == '\r';
+}
+
+// Characters that separate records
+static inline bool isRecordSeparator(char c) {
+    return c == ';' || c == '\n';
+}
+
+bool parsePackedDoubles(const char* begin, const char* end, std::vector<double>& out) {
+    const char* p = begin;
+    while (p < end) {
+        // Skip separators
+        while (p < end && isValueSeparator(*p)) {
+            ++p;
+        }
+        if (p >= end) {
+            break;
+        }
+
+        // from_chars doesn't accept a leading '+', but JavaScript's Number.toString never produces one anyway, so just skip it
+        if (*p == '+') {
+            ++p;
+        }
+
+        double value = 0.0;
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        out.push_back(value);
+        p = result.ptr;
+
+        // The number must be followed by a separator or the end, otherwise something like "12abc" would be silently accepted
+        if (p < end && !isValueSeparator(*p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parsePackedDoubleRecords(const char* packed, std::vector<std::vector<double>>& records) {
+    if (packed == nullptr) {
+        return false;
+    }
+    if (*packed == '\0') {
+        return true; // No records at all
+    }
+
+    const char* recordStart = packed;
+    const char* p = packed;
+    for (;;) {
+        if (*p == '\0' || isRecordSeparator(*p)) {
+            records.emplace_back();
+            if (!parsePackedDoubles(recordStart, p, records.back())) {
+                return false;
+            }
+            if (*p == '\0') {
+                break;
+            }
+            recordStart = p + 1;
+        }
+        ++p;
+    }
+
+    // A trailing separator (e.g. "1,2;3,4;") shouldn't produce an extra empty record
+    if (records.size() > 1 && records.back().empty() && p > packed && isRecordSeparator(p[-1])) {
+        records.pop_back();
+    }
+    return true;
+}
+
+// Parses one integer token starting at p. Also accepts a fractional part of only zeros (e.g. from toFixed()) since
+// it's still an exact integer. Returns the position after the token, or nullptr on failure.
+static const char* parseInt64Token(const char* p, const char* end, long long& value) {
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        return nullptr;
+    }
+    p = result.ptr;
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && *p == '0') {
+            ++p;
+        }
+    }
+    return p;
+}
+
+bool parsePackedInt64s(const char* begin, const char* end, std::vector<long long>& out) {
+    const char* p = begin;
+    while (p < end) {
+        while (p < end && isValueSeparator(*p)) {
+            ++p;
+        }
+        if (p >= end) {
+            break;
+        }
+
+        long long value = 0;
+        p = parseInt64Token(p, end, value);
+        if (p == nullptr || (p < end && !isValueSeparator(*p))) {
+            return false;
+        }
+        out.push_back(value);
+    }
+    return true;
+}
+
+bool parseInt64String(const char* str, long long& value) {
+    if (str == nullptr) {
+        return false;
+    }
+    const char* end = str + strlen(str);
+    const char* p = str;
+    while (p < end && isValueSeparator(*p)) {
+        ++p;
+    }
+    p = parseInt64Token(p, end, value);
+    if (p == nullptr) {
+        return false;
+    }
+    while (p < end && isValueSeparator(*p)) {
+        ++p;
+    }
+    return p == end;
+}
+
+void appendJsInt64String(std::string& out, long long value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out += '"';
+    out.append(buffer, result.ptr);
+    out += '"';
+}
+
+static inline bool isJsEscapeByte(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\' || c == 0xE2;
+}
+
+#if PACKED_DATA_SSE2
+static inline int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+size_t findJsEscapeByte(const char* str, size_t length) {
+    size_t i = 0;
+#if PACKED_DATA_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lineSeparatorLead = _mm_set1_epi8((char)0xE2);
+    const __m128i controlMax = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, lineSeparatorLead));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_min_epu8(bytes, controlMax), bytes)); // Unsigned byte <= 0x1F
+        const unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return i + lowestBit(mask);
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        if (isJsEscapeByte((unsigned char)str[i])) {
+            return i;
+        }
+    }
+    return length;
+}
+
+void appendJsString(std::string& out, const char* str, size_t length) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out.reserve(out.size() + length + 2);
+    out += '"';
+    size_t i = 0;
+    while (i < length) {
+        // Copy everything up to the next byte that needs attention in one go
+        const size_t run = findJsEscapeByte(str + i, length - i);
+        out.append(str + i, run);
+        i += run;
+        if (i >= length) {
+            break;
+        }
+
+        const unsigned char c = (unsigned char)str[i];
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                out += "\\u00";
+                out += hexDigits[c >> 4];
+                out += hexDigits[c & 0xF];
+            }
+            else if (i + 2 < length && (unsigned char)str[i + 1] == 0x80 && ((unsigned char)str[i + 2] & 0xFE) == 0xA8) {
+                // U+2028 / U+2029 are line terminators in JavaScript and would break the string literal when evaluated
+                out += ((unsigned char)str[i + 2] == 0xA8) ? "\\u2028" : "\\u2029";
+                i += 2;
+            }
+            else {
+                out += (char)c; // Any other character starting with 0xE2. UTF-8 passes through as-is, ExtendScript decodes returned strings as UTF-8
+            }
+            break;
+        }
+        i++;
+    }
+    out += '"';
+}
+
+void appendJsNumber(std::string& out, double value) {
+    if (std::isnan(value)) {
+        out += "NaN";
+        return;
+    }
+    if (std::isinf(value)) {
+        out += (value > 0) ? "Infinity" : "-Infinity";
+        return;
+    }
+
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// Copies a std::string into result memory, which ESFreeMem recycles (see ResultMemory.h)
+static char* copyForReturn(const std::string& str) {
+    char* copy = allocateResultMemory(str.size() + 1);
+    if (copy != nullptr) {
+        memcpy(copy, str.c_str(), str.size() + 1);
+    }
+    return copy;
+}
+
+long setScriptResult(TaggedData* retval, const std::string& script) {
+    char* copy = copyForReturn(script);
+    if (copy == nullptr) {
+        retval->type = kTypeUndefined;
+        return THIO_ERR_NO_MEMORY;
+    }
+    retval->type = kTypeScript;
+    retval->data.string = copy;
+    return kESErrOK;
+}
+
+long setStringResult(TaggedData* retval, const std::string& str) {
+    char* copy = copyForReturn(str);
+    if (copy == nullptr) {
+        retval->type = kTypeUndefined;
+        return THIO_ERR_NO_MEMORY;
+    }
+    retval->type = kTypeString;
+    retval->data.string = copy;
+    return kESErrOK;
+}
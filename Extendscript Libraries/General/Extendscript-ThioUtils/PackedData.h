@@ -0,0 +1,80 @@
+#pragma once
+
+// PackedData.h
+// Helpers for reading "packed" argument strings sent from ExtendScript and for building results to send back.
+//
+// ExtendScript can only hand us strings, numbers, booleans and LiveObjects, so bulk data is passed as a
+// single delimited string. The convention used by all exports in this library is:
+//      - Numbers within a record are separated by commas (or any whitespace)
+//      - Records (e.g. separate paths, separate clips) are separated by semicolons or newlines
+//
+// Results that are more than a single value are returned as kTypeScript, which ExtendScript evaluates.
+// So the result string must be a valid ES3 expression, typically wrapped in parentheses like "({a:1})" or "[1,2]".
+
+#include "SoSharedLibDefs.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Parses all numbers in a packed string into 'out' (appending). Stops at the end of the string.
+ * @return false if any token could not be parsed as a number.
+ */
+bool parsePackedDoubles(const char* begin, const char* end, std::vector<double>& out);
+
+/**
+ * @brief Splits a packed string into records on ';' or newlines, then parses the numbers in each record.
+ * Empty records are kept (as empty vectors) so that result indexes line up with the input.
+ * @return false if any token could not be parsed as a number.
+ */
+bool parsePackedDoubleRecords(const char* packed, std::vector<std::vector<double>>& records);
+
+/**
+ * @brief Parses all integers in a packed string into 'out' (appending). Used for tick values, which don't fit in a double.
+ * A fractional part of zero (e.g. "100.0") is accepted since JS may produce it, anything else after the digits is rejected.
+ * @return false if any token is not an integer or is out of the int64 range.
+ */
+bool parsePackedInt64s(const char* begin, const char* end, std::vector<long long>& out);
+
+/**
+ * @brief Parses a single integer string such as a Time object's .ticks value.
+ * @return false if the string is not exactly one integer in the int64 range.
+ */
+bool parseInt64String(const char* str, long long& value);
+
+/**
+ * @brief Appends an int64 as a quoted JavaScript string literal, e.g. "123". Ticks are returned as strings because
+ * ExtendScript numbers are doubles and lose precision past 2^53, and Time.ticks expects a string anyway.
+ */
+void appendJsInt64String(std::string& out, long long value);
+
+/**
+ * @brief Appends a string as a double-quoted JavaScript string literal, escaping as needed.
+ * The result is also valid JSON.
+ */
+void appendJsString(std::string& out, const char* str, size_t length);
+
+/**
+ * @brief Returns the index of the first byte that appendJsString can't copy as-is: a quote, backslash, control character,
+ * or 0xE2 (the lead byte of U+2028 / U+2029). Returns length if there is none. Checks 16 bytes at a time with SSE2.
+ */
+size_t findJsEscapeByte(const char* str, size_t length);
+
+/**
+ * @brief Appends a number formatted as a JavaScript literal. Uses the shortest form that round trips.
+ * NaN and infinities are written as NaN / Infinity / -Infinity so the result still evaluates.
+ */
+void appendJsNumber(std::string& out, double value);
+
+/**
+ * @brief Copies 'script' into retval as a kTypeScript result, using result memory (see ResultMemory.h).
+ * ExtendScript releases it via ESFreeMem.
+ * @return kESErrOK, or THIO_ERR_NO_MEMORY if the copy could not be allocated.
+ */
+long setScriptResult(TaggedData* retval, const std::string& script);
+
+/**
+ * @brief Copies 'str' into retval as a kTypeString result, using result memory (see ResultMemory.h).
+ * ExtendScript releases it via ESFreeMem.
+ * @return kESErrOK, or THIO_ERR_NO_MEMORY if the copy could not be allocated.
+ */
+long setStringResult(TaggedData* retval, const std::string& str);
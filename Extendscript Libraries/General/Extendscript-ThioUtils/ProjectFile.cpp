@@ -0,0 +1,1098 @@
+#include "ProjectFile.h"
+#include "Exports.h"
+#include "Inflate.h"
+#include "Json.h"
+#include "PackedData.h"
+#include "TextEncoding.h"
+#include "ThioUtils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#define READ_CHUNK_BYTES (256 * 1024)
+#define MAX_MARKUP_BYTES (1024 * 1024)          // A longer tag, comment or CDATA section means this isn't project XML
+#define MAX_FIELD_BYTES (64 * 1024 * 1024)      // Keyframes of very long tracks are the largest fields
+#define MAX_XML_DEPTH 256
+#define MAX_BIN_DEPTH 256
+
+// ------------------------------------------------------------------------------------------------
+// Element names
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+
+// The element names the reader acts on. Everything else is kNameOther.
+enum ElementName : uint8_t {
+    kNameOther,
+
+    // Fields: text the reader keeps
+    kNameName,
+    kNameStart,
+    kNameEnd,
+    kNameInPoint,
+    kNameActualMediaFilePath,
+    kNameFilePath,
+    kNameFrameRate,
+    kNameKeyframes,
+    kNameMatchName,
+    kNameDVAMarker,
+
+    // References: elements with an ObjectRef or ObjectURef the reader follows
+    kNameItem,
+    kNameMasterClip,
+    kNameClip,
+    kNameSource,
+    kNameMedia,
+    kNameSequence,
+    kNameSecond,
+    kNameTrack,
+    kNameTrackItem,
+    kNameSubClip,
+    kNameComponents,
+    kNameComponent,
+    kNameParam,
+    kNameMarkers,
+
+    // Containers and object classes
+    kNameTrackItems,
+    kNameRootProjectItem,
+    kNameBinProjectItem,
+    kNameClipProjectItem,
+    kNameVideoTrackGroup,
+    kNameAudioTrackGroup,
+    kNameVideoClipTrackItem,
+    kNameAudioClipTrackItem,
+
+    kNameCount
+};
+
+const char* const elementNames[kNameCount] = {
+    "",
+    "Name", "Start", "End", "InPoint", "ActualMediaFilePath", "FilePath", "FrameRate", "Keyframes", "MatchName", "DVAMarker",
+    "Item", "MasterClip", "Clip", "Source", "Media", "Sequence", "Second", "Track", "TrackItem", "SubClip", "Components",
+    "Component", "Param", "Markers",
+    "TrackItems", "RootProjectItem", "BinProjectItem", "ClipProjectItem", "VideoTrackGroup", "AudioTrackGroup",
+    "VideoClipTrackItem", "AudioClipTrackItem",
+};
+
+inline bool isFieldName(uint8_t name) { return name >= kNameName && name <= kNameDVAMarker; }
+inline bool isReferenceName(uint8_t name) { return name >= kNameItem && name <= kNameMarkers; }
+
+// Open addressing table from element name to ElementName, since every element's name is looked up
+class ElementNameTable {
+public:
+    ElementNameTable() {
+        memset(slots, 0, sizeof(slots));
+        for (uint8_t name = 1; name < kNameCount; name++) {
+            size_t slot = hash(elementNames[name], strlen(elementNames[name]));
+            while (slots[slot] != 0) slot = (slot + 1) % TABLE_SLOTS;
+            slots[slot] = name;
+        }
+    }
+
+    uint8_t find(const char* text, size_t length) const {
+        for (size_t slot = hash(text, length); slots[slot] != 0; slot = (slot + 1) % TABLE_SLOTS) {
+            const char* candidate = elementNames[slots[slot]];
+            if (strncmp(candidate, text, length) == 0 && candidate[length] == '\0') return slots[slot];
+        }
+        return kNameOther;
+    }
+
+private:
+    static const size_t TABLE_SLOTS = 128;
+    uint8_t slots[TABLE_SLOTS];
+
+    static size_t hash(const char* text, size_t length) {
+        uint32_t value = 2166136261U;
+        for (size_t i = 0; i < length; i++) value = (value ^ (unsigned char)text[i]) * 16777619U;
+        return (value ^ (value >> 15)) % TABLE_SLOTS;
+    }
+};
+
+const ElementNameTable& elementNameTable() {
+    static const ElementNameTable table;
+    return table;
+}
+
+} // namespace
+
+// ------------------------------------------------------------------------------------------------
+// XML text
+// ------------------------------------------------------------------------------------------------
+
+static inline bool isXmlSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void appendUtf8(std::string& out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += (char)codePoint;
+    }
+    else if (codePoint < 0x800) {
+        out += (char)(0xC0 | (codePoint >> 6));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        out += (char)(0xE0 | (codePoint >> 12));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        out += (char)(0xF0 | (codePoint >> 18));
+        out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+void decodeXmlText(const char* text, size_t length, std::string& out) {
+    out.clear();
+    out.reserve(length);
+    const char* end = text + length;
+    while (text < end) {
+        const char* amp = static_cast<const char*>(memchr(text, '&', end - text));
+        if (amp == nullptr) {
+            out.append(text, end);
+            break;
+        }
+        out.append(text, amp);
+        const char* semicolon = static_cast<const char*>(memchr(amp, ';', (end - amp < 12) ? end - amp : 12));
+        if (semicolon == nullptr) {
+            out += '&';
+            text = amp + 1;
+            continue;
+        }
+        const std::string entity(amp + 1, semicolon);
+        uint32_t codePoint = 0;
+        if (entity == "amp") out += '&';
+        else if (entity == "lt") out += '<';
+        else if (entity == "gt") out += '>';
+        else if (entity == "quot") out += '"';
+        else if (entity == "apos") out += '\'';
+        else if (entity.size() > 1 && entity[0] == '#') {
+            char* digitsEnd = nullptr;
+            const bool hex = entity[1] == 'x' || entity[1] == 'X';
+            codePoint = (uint32_t)strtoul(entity.c_str() + (hex ? 2 : 1), &digitsEnd, hex ? 16 : 10);
+            if (*digitsEnd != '\0' || codePoint == 0 || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+                out.append(amp, semicolon + 1);
+            }
+            else {
+                appendUtf8(out, codePoint);
+            }
+        }
+        else {
+            out.append(amp, semicolon + 1);
+        }
+        text = semicolon + 1;
+    }
+}
+
+namespace {
+
+// ------------------------------------------------------------------------------------------------
+// Streaming reader
+// ------------------------------------------------------------------------------------------------
+
+struct Field {
+    size_t offset;          // Of the decoded text in fieldText
+    uint32_t length;
+    uint8_t name;
+    uint8_t parent;         // The enclosing element, to tell apart fields with the same name
+};
+
+struct Reference {
+    uint64_t target;        // See objectKey
+    uint8_t name;
+    uint8_t parent;
+    bool unique;            // ObjectURef, to an ObjectUID. Otherwise ObjectRef, to an ObjectID.
+};
+
+struct ProjectObject {
+    uint8_t type;           // The element name, if it's one of the classes the reader knows
+    uint32_t firstField, fieldEnd;
+    uint32_t firstReference, referenceEnd;
+};
+
+// Which fields and references the requested tables use, by the type of the object they're in, and which object types
+// are kept even when nothing in them is. Everything else is dropped as it's read, so reading only the bins of a project
+// keeps the bins and their items and nothing from its sequences.
+class ProjectFilter {
+public:
+    explicit ProjectFilter(unsigned tables);
+
+    bool keeps(uint8_t objectType, uint8_t name) const { return (kept[name] >> objectType) & 1; }
+    bool keepsObject(uint8_t objectType) const { return (keptTypes >> objectType) & 1; }
+
+private:
+    static const uint64_t ANY_TYPE = ~0ULL;
+    uint64_t kept[kNameCount] = {};
+    uint64_t keptTypes = 0;
+
+    static uint64_t type(uint8_t name) { return 1ULL << name; }
+    void keep(uint8_t name, uint64_t types) { kept[name] |= types; }
+};
+
+ProjectFilter::ProjectFilter(unsigned tables) {
+    // Track items and keyframes are found through the sequences, and markers refer to sequences by row
+    const bool trackItems = (tables & (PROJECT_TABLE_TRACK_ITEMS | PROJECT_TABLE_KEYFRAMES)) != 0;
+    const bool sequences = (tables & PROJECT_TABLE_SEQUENCES) || trackItems || (tables & PROJECT_TABLE_MARKERS);
+
+    if (tables & PROJECT_TABLE_BINS) {
+        keptTypes |= type(kNameRootProjectItem) | type(kNameBinProjectItem);
+        keep(kNameItem, type(kNameRootProjectItem) | type(kNameBinProjectItem));
+        keep(kNameName, type(kNameBinProjectItem));
+    }
+    if (sequences) {
+        keptTypes |= type(kNameSequence) | type(kNameVideoTrackGroup) | type(kNameAudioTrackGroup);
+        keep(kNameName, type(kNameSequence));
+        keep(kNameSecond, type(kNameSequence));
+        keep(kNameTrack, type(kNameVideoTrackGroup) | type(kNameAudioTrackGroup));
+        keep(kNameFrameRate, type(kNameVideoTrackGroup));
+    }
+    if (tables & PROJECT_TABLE_SEQUENCES) {
+        // The bin of each sequence: bins -> ClipProjectItem -> MasterClip -> Clip -> Source -> Sequence
+        keptTypes |= type(kNameRootProjectItem) | type(kNameBinProjectItem);
+        keep(kNameItem, type(kNameRootProjectItem) | type(kNameBinProjectItem));
+        keep(kNameMasterClip, type(kNameClipProjectItem));
+        keep(kNameClip, type(kNameMasterClip));
+        keep(kNameSource, ANY_TYPE);
+        keep(kNameSequence, ANY_TYPE);
+    }
+    if (trackItems) {
+        keptTypes |= type(kNameVideoClipTrackItem) | type(kNameAudioClipTrackItem);
+        keep(kNameTrackItem, ANY_TYPE);
+        keep(kNameStart, type(kNameVideoClipTrackItem) | type(kNameAudioClipTrackItem));
+        keep(kNameEnd, type(kNameVideoClipTrackItem) | type(kNameAudioClipTrackItem));
+        keep(kNameSubClip, type(kNameVideoClipTrackItem) | type(kNameAudioClipTrackItem));
+        keep(kNameClip, ANY_TYPE);
+        keep(kNameSource, ANY_TYPE);
+        keep(kNameMedia, ANY_TYPE);
+        keep(kNameSequence, ANY_TYPE);
+        keep(kNameName, ANY_TYPE);
+        keep(kNameInPoint, ANY_TYPE);
+        keep(kNameActualMediaFilePath, ANY_TYPE);
+        keep(kNameFilePath, ANY_TYPE);
+    }
+    if (tables & PROJECT_TABLE_KEYFRAMES) {
+        keep(kNameComponents, type(kNameVideoClipTrackItem) | type(kNameAudioClipTrackItem));
+        keep(kNameComponent, ANY_TYPE);
+        keep(kNameParam, ANY_TYPE);
+        keep(kNameMatchName, ANY_TYPE);
+        keep(kNameKeyframes, ANY_TYPE);
+    }
+    if (tables & PROJECT_TABLE_MARKERS) {
+        keep(kNameMarkers, type(kNameSequence) | type(kNameMasterClip));
+        keep(kNameDVAMarker, ANY_TYPE);
+        keep(kNameName, type(kNameMasterClip));
+    }
+}
+
+// ObjectIDs are integers and are kept as they are. ObjectUIDs are UUIDs, kept as a 64 bit hash, which saves a string
+// per reference and can't realistically collide among the objects of one project.
+uint64_t objectKey(const char* id, size_t length, bool unique) {
+    uint64_t key = 0;
+    if (!unique && length > 0 && length < 20) {
+        size_t i = 0;
+        while (i < length && id[i] >= '0' && id[i] <= '9') key = key * 10 + (uint64_t)(id[i++] - '0');
+        if (i == length) return key;
+    }
+    key = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < length; i++) key = (key ^ (unsigned char)id[i]) * 0x100000001B3ULL;
+    key ^= key >> 31;
+    key *= 0x7FB5D329728EA185ULL;
+    return key ^ (key >> 27);
+}
+
+typedef std::vector<std::pair<uint64_t, uint32_t>> ObjectKeyIndex; // Sorted by key, to the index in objects
+
+// Scans the XML as it arrives and keeps the fields and references of each top level object that the tables use
+class ProjectReader : public InflateSink {
+public:
+    ProjectReader(unsigned tables, const std::atomic<bool>* cancel, ProjectReadStats& stats) : cancel(cancel), stats(stats),
+        names(elementNameTable()), filter(tables) {}
+
+    bool write(const char* data, size_t length) override;
+
+    // After the last write, sorts the object indexes for lookups. Returns false if the XML was malformed or ended early.
+    bool finish() {
+        std::sort(objectIds.begin(), objectIds.end());
+        std::sort(objectUids.begin(), objectUids.end());
+        stats.keptBytes = objects.capacity() * sizeof(ProjectObject) + fields.capacity() * sizeof(Field) + fieldText.capacity() +
+            references.capacity() * sizeof(Reference) + (objectIds.capacity() + objectUids.capacity()) * sizeof(ObjectKeyIndex::value_type);
+        for (const auto& id : sequenceUids) stats.keptBytes += sizeof(id) + id.second.capacity();
+        return !failed && sawRoot && nameStack.empty() && !inMarkup;
+    }
+
+    bool wasCancelled() const { return cancelled; }
+
+    std::vector<ProjectObject> objects;
+    std::vector<Field> fields;
+    std::string fieldText;  // Every field's text, one after another
+    std::vector<Reference> references;
+    ObjectKeyIndex objectIds;
+    ObjectKeyIndex objectUids;
+    std::vector<std::pair<uint32_t, std::string>> sequenceUids; // Index in objects, and the ObjectUID for sequences
+
+private:
+    const std::atomic<bool>* cancel;
+    ProjectReadStats& stats;
+    const ElementNameTable& names;
+    const ProjectFilter filter;
+    bool failed = false;
+    bool cancelled = false;
+    bool sawRoot = false;
+
+    // Markup ("<...>") that began in an earlier piece of data
+    bool inMarkup = false;
+    char quote = 0;
+    std::string markup;
+
+    // Names of the open elements, one after another in openNames
+    std::string openNames;
+    std::vector<uint32_t> openNameStarts;
+    std::vector<uint8_t> nameStack;
+
+    // The top level object being read
+    bool inObject = false;
+    bool objectIsUnique = false;
+    uint64_t objectId = 0;
+    std::string objectUid;
+    ProjectObject object = {};
+
+    // Text of the field being read
+    bool capturing = false;
+    size_t captureDepth = 0;
+    uint8_t captureName = 0, captureParent = 0;
+    std::string capture;
+    std::string decoded;
+
+    bool fail() {
+        failed = true;
+        return false;
+    }
+
+    bool handleMarkup(const char* text, size_t length);
+    bool startElement(const char* text, size_t length, bool selfClosing);
+    bool endElement(const char* name, size_t length);
+    bool appendText(const char* text, size_t length);
+    bool bangMarkupEnds() const;
+};
+
+bool ProjectReader::appendText(const char* text, size_t length) {
+    if (capture.size() + length > MAX_FIELD_BYTES) return fail();
+    capture.append(text, length);
+    return true;
+}
+
+// Whether a '>' ends a "<!...>" section: comments end with "-->" and CDATA with "]]>", anything else at the first '>'
+bool ProjectReader::bangMarkupEnds() const {
+    const size_t size = markup.size();
+    if (markup.compare(0, 8, "![CDATA[") == 0) return size >= 10 && markup.compare(size - 2, 2, "]]") == 0;
+    if (markup.compare(0, 3, "!--") == 0) return size >= 5 && markup.compare(size - 2, 2, "--") == 0;
+    return true;
+}
+
+bool ProjectReader::write(const char* data, size_t length) {
+    stats.xmlBytes += length;
+    if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) {
+        cancelled = true;
+        return false;
+    }
+    if (failed) return false;
+
+    const char* p = data;
+    const char* end = data + length;
+    while (p < end) {
+        if (!inMarkup) {
+            const char* open = static_cast<const char*>(memchr(p, '<', end - p));
+            const char* textEnd = (open != nullptr) ? open : end;
+            if (capturing && !appendText(p, textEnd - p)) return false;
+            if (open == nullptr) break;
+            p = open + 1;
+            inMarkup = true;
+            quote = 0;
+            markup.clear();
+            continue;
+        }
+
+        const char first = markup.empty() ? *p : markup[0];
+        if (first == '!') {
+            // Comments, CDATA and declarations, which can contain '>' and are rare, a byte at a time
+            bool complete = false;
+            while (p < end && !complete) {
+                const char c = *p++;
+                if (c == '>' && bangMarkupEnds()) {
+                    complete = true;
+                }
+                else {
+                    markup += c;
+                }
+            }
+            if (markup.size() > MAX_MARKUP_BYTES) return fail();
+            if (complete) {
+                inMarkup = false;
+                if (!handleMarkup(markup.data(), markup.size())) return fail();
+            }
+            continue;
+        }
+
+        // A tag: up to the first '>' outside a quoted attribute value
+        const char* q = p;
+        for (; q < end; q++) {
+            const char c = *q;
+            if (quote != 0) {
+                if (c == quote) quote = 0;
+            }
+            else if (c == '>') {
+                break;
+            }
+            else if (c == '"' || c == '\'') {
+                quote = c;
+            }
+        }
+        if (q == end) {
+            markup.append(p, q);
+            if (markup.size() > MAX_MARKUP_BYTES) return fail();
+            break;
+        }
+        inMarkup = false;
+        bool handled;
+        if (markup.empty()) {
+            handled = handleMarkup(p, q - p);
+        }
+        else {
+            markup.append(p, q);
+            handled = handleMarkup(markup.data(), markup.size());
+        }
+        if (!handled) return fail();
+        p = q + 1;
+    }
+    return true;
+}
+
+bool ProjectReader::handleMarkup(const char* text, size_t length) {
+    if (length == 0) return false;
+    switch (text[0]) {
+        case '/': {
+            size_t nameLength = length - 1;
+            while (nameLength > 0 && isXmlSpace(text[nameLength])) nameLength--;
+            return endElement(text + 1, nameLength);
+        }
+        case '?':
+            return true;
+        case '!':
+            if (length >= 10 && memcmp(text, "![CDATA[", 8) == 0 && capturing) {
+                return appendText(text + 8, length - 10);
+            }
+            return true;
+        default: {
+            const bool selfClosing = text[length - 1] == '/';
+            return startElement(text, selfClosing ? length - 1 : length, selfClosing);
+        }
+    }
+}
+
+bool ProjectReader::startElement(const char* text, size_t length, bool selfClosing) {
+    size_t nameLength = 0;
+    while (nameLength < length && !isXmlSpace(text[nameLength])) nameLength++;
+    if (nameLength == 0 || nameStack.size() >= MAX_XML_DEPTH) return false;
+    if (nameStack.empty() && sawRoot) return false; // A second root element
+    stats.elements++;
+
+    // The attributes this reader uses
+    const char* objectIdValue = nullptr;
+    const char* objectUidValue = nullptr;
+    const char* refValue = nullptr;
+    const char* urefValue = nullptr;
+    size_t objectIdLength = 0, objectUidLength = 0, refLength = 0, urefLength = 0;
+    for (size_t i = nameLength; i < length;) {
+        while (i < length && isXmlSpace(text[i])) i++;
+        if (i == length) break;
+        const size_t attributeStart = i;
+        while (i < length && text[i] != '=' && !isXmlSpace(text[i])) i++;
+        const size_t attributeLength = i - attributeStart;
+        while (i < length && isXmlSpace(text[i])) i++;
+        if (i == length || text[i] != '=') return false;
+        i++;
+        while (i < length && isXmlSpace(text[i])) i++;
+        if (i == length || (text[i] != '"' && text[i] != '\'')) return false;
+        const char valueQuote = text[i++];
+        const size_t valueStart = i;
+        while (i < length && text[i] != valueQuote) i++;
+        if (i == length) return false;
+        const size_t valueLength = i - valueStart;
+        i++;
+
+        const char* attribute = text + attributeStart;
+        if (attributeLength == 8 && memcmp(attribute, "ObjectID", 8) == 0) {
+            objectIdValue = text + valueStart;
+            objectIdLength = valueLength;
+        }
+        else if (attributeLength == 9 && memcmp(attribute, "ObjectUID", 9) == 0) {
+            objectUidValue = text + valueStart;
+            objectUidLength = valueLength;
+        }
+        else if (attributeLength == 9 && memcmp(attribute, "ObjectRef", 9) == 0) {
+            refValue = text + valueStart;
+            refLength = valueLength;
+        }
+        else if (attributeLength == 10 && memcmp(attribute, "ObjectURef", 10) == 0) {
+            urefValue = text + valueStart;
+            urefLength = valueLength;
+        }
+    }
+
+    const uint8_t name = names.find(text, nameLength);
+    const size_t depth = nameStack.size();
+    if (depth == 0) {
+        sawRoot = true;
+    }
+    else if (depth == 1) {
+        // A top level object
+        inObject = objectIdValue != nullptr || objectUidValue != nullptr;
+        if (inObject) {
+            stats.objects++;
+            objectIsUnique = objectIdValue == nullptr;
+            objectId = objectIsUnique ? objectKey(objectUidValue, objectUidLength, true) : objectKey(objectIdValue, objectIdLength, false);
+            if (objectIsUnique && name == kNameSequence) objectUid.assign(objectUidValue, objectUidLength);
+            object.type = name;
+            object.firstField = object.fieldEnd = (uint32_t)fields.size();
+            object.firstReference = object.referenceEnd = (uint32_t)references.size();
+        }
+    }
+    else if (inObject) {
+        const uint8_t parent = nameStack.back();
+        if ((refValue != nullptr || urefValue != nullptr) && isReferenceName(name)) {
+            if (filter.keeps(object.type, name)) {
+                Reference reference;
+                reference.name = name;
+                reference.parent = parent;
+                reference.unique = refValue == nullptr;
+                reference.target = reference.unique ? objectKey(urefValue, urefLength, true) : objectKey(refValue, refLength, false);
+                references.push_back(std::move(reference));
+            }
+        }
+        else if (isFieldName(name) && !capturing && filter.keeps(object.type, name)) {
+            capturing = true;
+            captureDepth = depth;
+            captureName = name;
+            captureParent = parent;
+            capture.clear();
+        }
+    }
+
+    openNameStarts.push_back((uint32_t)openNames.size());
+    openNames.append(text, nameLength);
+    nameStack.push_back(name);
+    return selfClosing ? endElement(text, nameLength) : true;
+}
+
+bool ProjectReader::endElement(const char* name, size_t length) {
+    if (nameStack.empty()) return false;
+    const size_t openStart = openNameStarts.back();
+    if (openNames.size() - openStart != length || memcmp(openNames.data() + openStart, name, length) != 0) return false;
+    const size_t depth = nameStack.size() - 1;
+
+    if (capturing && depth == captureDepth) {
+        capturing = false;
+        decodeXmlText(capture.data(), capture.size(), decoded);
+        Field field;
+        field.offset = fieldText.size();
+        field.length = (uint32_t)decoded.size();
+        field.name = captureName;
+        field.parent = captureParent;
+        fieldText += decoded;
+        fields.push_back(field);
+    }
+
+    if (depth == 1 && inObject) {
+        inObject = false;
+        object.fieldEnd = (uint32_t)fields.size();
+        object.referenceEnd = (uint32_t)references.size();
+        const bool hasContents = object.fieldEnd > object.firstField || object.referenceEnd > object.firstReference;
+        if (hasContents || filter.keepsObject(object.type)) {
+            const uint32_t index = (uint32_t)objects.size();
+            objects.push_back(object);
+            (objectIsUnique ? objectUids : objectIds).emplace_back(objectId, index);
+            if (object.type == kNameSequence && objectIsUnique) sequenceUids.emplace_back(index, objectUid);
+            stats.keptObjects++;
+        }
+    }
+
+    openNames.resize(openStart);
+    openNameStarts.pop_back();
+    nameStack.pop_back();
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Linking objects into tables
+// ------------------------------------------------------------------------------------------------
+
+#define NO_OBJECT (-1)
+
+struct BinRow { std::string name; long parent; };
+struct SequenceRow { std::string id, name, timebase; long bin = -1; long videoTracks = 0, audioTracks = 0; };
+struct TrackItemRow { long sequence; bool video; long track; std::string start, end, inPoint, name, mediaPath; long nestedSequence; };
+struct MarkerRow { long sequence; std::string clip, start, duration, name, comment, type; };
+struct KeyframeRow { long trackItem; std::string component, param, keys; };
+
+struct ProjectTables {
+    std::vector<BinRow> bins;
+    std::vector<SequenceRow> sequences;
+    std::vector<TrackItemRow> trackItems;
+    std::vector<MarkerRow> markers;
+    std::vector<KeyframeRow> keyframes;
+};
+
+// Follows the references between the objects a reader kept, filling the tables
+class ProjectLinker {
+public:
+    ProjectLinker(const ProjectReader& reader, ProjectTables& tables) : reader(reader), bins(tables.bins), sequences(tables.sequences),
+        trackItems(tables.trackItems), markers(tables.markers), keyframes(tables.keyframes), sequenceIndex(reader.objects.size(), -1) {}
+
+    void link(unsigned tables);
+
+private:
+    const ProjectReader& reader;
+    std::vector<BinRow>& bins;
+    std::vector<SequenceRow>& sequences;
+    std::vector<TrackItemRow>& trackItems;
+    std::vector<MarkerRow>& markers;
+    std::vector<KeyframeRow>& keyframes;
+    std::vector<long> sequenceIndex;    // By object, its row in sequences, or -1
+
+    // First field of an object with a name (and parent, unless kNameOther), or an empty string
+    std::string field(long object, uint8_t name, uint8_t parent = kNameOther) const {
+        if (object == NO_OBJECT) return std::string();
+        const ProjectObject& o = reader.objects[object];
+        for (uint32_t i = o.firstField; i < o.fieldEnd; i++) {
+            const Field& f = reader.fields[i];
+            if (f.name == name && (parent == kNameOther || f.parent == parent)) return reader.fieldText.substr(f.offset, f.length);
+        }
+        return std::string();
+    }
+
+    long resolve(const Reference& reference) const {
+        const ObjectKeyIndex& ids = reference.unique ? reader.objectUids : reader.objectIds;
+        const auto found = std::lower_bound(ids.begin(), ids.end(), std::make_pair(reference.target, (uint32_t)0));
+        return (found != ids.end() && found->first == reference.target) ? (long)found->second : NO_OBJECT;
+    }
+
+    // The object the first reference with a name points to
+    long follow(long object, uint8_t name) const {
+        if (object == NO_OBJECT) return NO_OBJECT;
+        const ProjectObject& o = reader.objects[object];
+        for (uint32_t i = o.firstReference; i < o.referenceEnd; i++) {
+            if (reader.references[i].name == name) return resolve(reader.references[i]);
+        }
+        return NO_OBJECT;
+    }
+
+    // Calls visit(target) for each reference of an object with a name (and parent, unless kNameOther), in order
+    template <typename Visit>
+    void forEachReference(long object, uint8_t name, uint8_t parent, Visit visit) const {
+        if (object == NO_OBJECT) return;
+        const ProjectObject& o = reader.objects[object];
+        for (uint32_t i = o.firstReference; i < o.referenceEnd; i++) {
+            const Reference& reference = reader.references[i];
+            if (reference.name == name && (parent == kNameOther || reference.parent == parent)) {
+                const long target = resolve(reference);
+                if (target != NO_OBJECT) visit(target);
+            }
+        }
+    }
+
+    uint8_t type(long object) const { return reader.objects[object].type; }
+
+    void linkBins(long container, long bin, int depth, std::vector<bool>& visited);
+    void linkSequence(long object, unsigned tables);
+    void linkTrackItem(long object, long sequence, bool video, long track, unsigned tables);
+    void linkMarkers(long owner, long sequence, const std::string& clip);
+};
+
+void ProjectLinker::link(unsigned tables) {
+    // Sequences first, so everything else can refer to them by row
+    for (size_t i = 0; i < reader.objects.size(); i++) {
+        if (reader.objects[i].type == kNameSequence) {
+            sequenceIndex[i] = (long)sequences.size();
+            sequences.emplace_back();
+        }
+    }
+
+    // A sequence's ObjectUID is its sequenceID in the DOM
+    for (const auto& id : reader.sequenceUids) {
+        sequences[sequenceIndex[id.first]].id = id.second;
+    }
+
+    // Bins, and which bin each sequence is in
+    std::vector<bool> visited(reader.objects.size(), false);
+    for (size_t i = 0; i < reader.objects.size(); i++) {
+        if (reader.objects[i].type == kNameRootProjectItem) {
+            linkBins((long)i, -1, 0, visited);
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < reader.objects.size(); i++) {
+        if (sequenceIndex[i] >= 0) linkSequence((long)i, tables);
+        else if (reader.objects[i].type == kNameMasterClip && (tables & PROJECT_TABLE_MARKERS)) {
+            linkMarkers((long)i, -1, field((long)i, kNameName));
+        }
+    }
+}
+
+void ProjectLinker::linkBins(long container, long bin, int depth, std::vector<bool>& visited) {
+    if (depth > MAX_BIN_DEPTH || visited[container]) return;
+    visited[container] = true;
+
+    forEachReference(container, kNameItem, kNameOther, [&](long item) {
+        if (type(item) == kNameBinProjectItem) {
+            if (visited[item]) return;
+            const long row = (long)bins.size();
+            bins.push_back({ field(item, kNameName), bin });
+            linkBins(item, row, depth + 1, visited);
+        }
+        else if (type(item) == kNameClipProjectItem) {
+            // A sequence's project item: ClipProjectItem -> MasterClip -> Clip -> Source (a sequence source) -> Sequence
+            forEachReference(follow(item, kNameMasterClip), kNameClip, kNameOther, [&](long clip) {
+                const long sequence = follow(follow(clip, kNameSource), kNameSequence);
+                if (sequence != NO_OBJECT && sequenceIndex[sequence] >= 0) {
+                    sequences[sequenceIndex[sequence]].bin = bin;
+                }
+            });
+        }
+    });
+}
+
+void ProjectLinker::linkSequence(long object, unsigned tables) {
+    const long row = sequenceIndex[object];
+    sequences[row].name = field(object, kNameName);
+
+    forEachReference(object, kNameSecond, kNameOther, [&](long group) {
+        const bool video = type(group) == kNameVideoTrackGroup;
+        if (!video && type(group) != kNameAudioTrackGroup) return;
+        if (video && sequences[row].timebase.empty()) sequences[row].timebase = field(group, kNameFrameRate);
+
+        // Tracks are counted by their references, since without track items the reader doesn't keep the tracks
+        const ProjectObject& o = reader.objects[group];
+        for (uint32_t i = o.firstReference; i < o.referenceEnd; i++) {
+            if (reader.references[i].name != kNameTrack) continue;
+            long& trackCount = video ? sequences[row].videoTracks : sequences[row].audioTracks;
+            const long trackNumber = trackCount++;
+            if (!(tables & (PROJECT_TABLE_TRACK_ITEMS | PROJECT_TABLE_KEYFRAMES))) continue;
+            forEachReference(resolve(reader.references[i]), kNameTrackItem, kNameTrackItems, [&](long item) {
+                // Transitions are track items too, under TransitionItems
+                if (type(item) == kNameVideoClipTrackItem || type(item) == kNameAudioClipTrackItem) {
+                    linkTrackItem(item, row, video, trackNumber, tables);
+                }
+            });
+        }
+    });
+
+    if (tables & PROJECT_TABLE_MARKERS) linkMarkers(object, row, std::string());
+}
+
+// Converts Premiere's stored keys, "ticks,value,type,...;" with "x:y" for points, to the Keyframes.h packed format.
+// Returns false for values that aren't numbers or points, like colors and text.
+bool convertKeyframes(const std::string& stored, std::string& packed) {
+    packed.clear();
+    std::vector<long long> ticks;
+    std::vector<double> numbers;
+    const char* p = stored.c_str();
+    while (*p != '\0') {
+        const char* keyEnd = p + strcspn(p, ";");
+        const char* timeEnd = static_cast<const char*>(memchr(p, ',', keyEnd - p));
+        if (timeEnd != nullptr) {
+            const char* valueEnd = static_cast<const char*>(memchr(timeEnd + 1, ',', keyEnd - timeEnd - 1));
+            if (valueEnd == nullptr) valueEnd = keyEnd;
+
+            ticks.clear();
+            if (!parsePackedInt64s(p, timeEnd, ticks) || ticks.size() != 1) return false;
+            std::string value(timeEnd + 1, valueEnd);
+            for (char& c : value) {
+                if (c == ':') c = ',';
+            }
+            numbers.clear();
+            if (!parsePackedDoubles(value.data(), value.data() + value.size(), numbers) || numbers.empty() || numbers.size() > 2) return false;
+
+            long interpolation = 0;
+            if (valueEnd < keyEnd) interpolation = strtol(valueEnd + 1, nullptr, 10);
+
+            if (!packed.empty()) packed += ';';
+            packed += std::to_string(ticks[0]);
+            for (double number : numbers) {
+                packed += ',';
+                appendJsNumber(packed, number);
+            }
+            packed += ',' + std::to_string(interpolation);
+        }
+        else if (keyEnd > p) {
+            return false;
+        }
+        p = (*keyEnd == ';') ? keyEnd + 1 : keyEnd;
+    }
+    return true;
+}
+
+void ProjectLinker::linkTrackItem(long object, long sequence, bool video, long track, unsigned tables) {
+    const long row = (long)trackItems.size();
+    TrackItemRow item;
+    item.sequence = sequence;
+    item.video = video;
+    item.track = track;
+    item.start = field(object, kNameStart, kNameTrackItem);
+    item.end = field(object, kNameEnd, kNameTrackItem);
+
+    // TrackItem -> SubClip -> Clip -> Source -> Media, or -> Sequence for a nested sequence
+    const long subClip = follow(object, kNameSubClip);
+    const long clip = follow(subClip, kNameClip);
+    const long source = follow(clip, kNameSource);
+    const long media = follow(source, kNameMedia);
+    const long nested = follow(source, kNameSequence);
+    item.name = field(subClip, kNameName);
+    item.inPoint = field(clip, kNameInPoint);
+    item.mediaPath = field(media, kNameActualMediaFilePath);
+    if (item.mediaPath.empty()) item.mediaPath = field(media, kNameFilePath);
+    item.nestedSequence = (nested != NO_OBJECT) ? sequenceIndex[nested] : -1;
+    trackItems.push_back(std::move(item));
+
+    if (!(tables & PROJECT_TABLE_KEYFRAMES)) return;
+    std::string packed;
+    forEachReference(follow(object, kNameComponents), kNameComponent, kNameOther, [&](long component) {
+        const std::string& matchName = field(component, kNameMatchName);
+        forEachReference(component, kNameParam, kNameOther, [&](long param) {
+            const std::string& stored = field(param, kNameKeyframes);
+            if (stored.empty() || !convertKeyframes(stored, packed) || packed.empty()) return;
+            keyframes.push_back({ row, matchName, field(param, kNameName), packed });
+        });
+    });
+}
+
+// A marker field from DVAMarker JSON as text: strings decoded, numbers as written, {ticks: ...} objects as their ticks
+std::string markerValue(const JsonDocument& doc, const char* pointer) {
+    long index = findJsonNode(doc, pointer);
+    if (index >= 0 && doc.nodes[index].type == JSON_OBJECT) {
+        index = findJsonNode(doc, (std::string(pointer) + "/ticks").c_str());
+    }
+    if (index < 0) return std::string();
+    const JsonNode& node = doc.nodes[index];
+    std::string value;
+    if (node.type == JSON_STRING) decodeJsonString(doc, node, value);
+    else if (node.type == JSON_NUMBER) value.assign(doc.text + node.start, node.length);
+    return value;
+}
+
+void ProjectLinker::linkMarkers(long owner, long sequence, const std::string& clip) {
+    forEachReference(owner, kNameMarkers, kNameOther, [&](long list) {
+        const ProjectObject& o = reader.objects[list];
+        for (uint32_t i = o.firstField; i < o.fieldEnd; i++) {
+            const Field& f = reader.fields[i];
+            if (f.name != kNameDVAMarker) continue;
+            JsonDocument doc;
+            std::string error;
+            if (!parseJsonDocument(reader.fieldText.data() + f.offset, f.length, doc, error)) continue;
+            const std::string prefix = (findJsonNode(doc, "/DVAMarker") >= 0) ? "/DVAMarker" : "";
+
+            MarkerRow marker;
+            marker.sequence = sequence;
+            marker.clip = clip;
+            marker.start = markerValue(doc, (prefix + "/mStartTime").c_str());
+            marker.duration = markerValue(doc, (prefix + "/mDuration").c_str());
+            marker.name = markerValue(doc, (prefix + "/mName").c_str());
+            marker.comment = markerValue(doc, (prefix + "/mComment").c_str());
+            marker.type = markerValue(doc, (prefix + "/mMarkerType").c_str());
+            if (marker.start.empty()) marker.start = "0";
+            if (marker.duration.empty()) marker.duration = "0";
+            markers.push_back(std::move(marker));
+        }
+    });
+}
+
+// ------------------------------------------------------------------------------------------------
+// Script output
+// ------------------------------------------------------------------------------------------------
+
+// Appends name:[...] with one value per row
+template <typename Row, typename Append>
+void appendColumn(std::string& out, const char* name, const std::vector<Row>& rows, Append append) {
+    out += name;
+    out += ":[";
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (i > 0) out += ',';
+        append(rows[i]);
+    }
+    out += ']';
+}
+
+void appendString(std::string& out, const std::string& value) {
+    appendJsString(out, value.data(), value.size());
+}
+
+// Ticks as a string like Time.ticks, or "0" if the project didn't have a valid number
+void appendTicks(std::string& out, const std::string& value) {
+    long long ticks = 0;
+    appendJsInt64String(out, parseInt64String(value.c_str(), ticks) ? ticks : 0);
+}
+
+void appendProjectScript(std::string& out, const ProjectTables& project, unsigned tables, const ProjectReadStats& stats) {
+    const std::vector<BinRow>& bins = project.bins;
+    const std::vector<SequenceRow>& sequences = project.sequences;
+    const std::vector<TrackItemRow>& trackItems = project.trackItems;
+    const std::vector<MarkerRow>& markers = project.markers;
+    const std::vector<KeyframeRow>& keyframes = project.keyframes;
+
+    out += "({";
+    if (tables & PROJECT_TABLE_BINS) {
+        out += "bins:{";
+        appendColumn(out, "name", bins, [&](const BinRow& r) { appendString(out, r.name); });
+        appendColumn(out, ",parent", bins, [&](const BinRow& r) { out += std::to_string(r.parent); });
+        out += "},";
+    }
+    if (tables & PROJECT_TABLE_SEQUENCES) {
+        out += "sequences:{";
+        appendColumn(out, "id", sequences, [&](const SequenceRow& r) { appendString(out, r.id); });
+        appendColumn(out, ",name", sequences, [&](const SequenceRow& r) { appendString(out, r.name); });
+        appendColumn(out, ",bin", sequences, [&](const SequenceRow& r) { out += std::to_string(r.bin); });
+        appendColumn(out, ",timebase", sequences, [&](const SequenceRow& r) { appendTicks(out, r.timebase); });
+        appendColumn(out, ",videoTracks", sequences, [&](const SequenceRow& r) { out += std::to_string(r.videoTracks); });
+        appendColumn(out, ",audioTracks", sequences, [&](const SequenceRow& r) { out += std::to_string(r.audioTracks); });
+        out += "},";
+    }
+    if (tables & PROJECT_TABLE_TRACK_ITEMS) {
+        out += "trackItems:{";
+        appendColumn(out, "sequence", trackItems, [&](const TrackItemRow& r) { out += std::to_string(r.sequence); });
+        appendColumn(out, ",type", trackItems, [&](const TrackItemRow& r) { out += r.video ? "\"video\"" : "\"audio\""; });
+        appendColumn(out, ",track", trackItems, [&](const TrackItemRow& r) { out += std::to_string(r.track); });
+        appendColumn(out, ",start", trackItems, [&](const TrackItemRow& r) { appendTicks(out, r.start); });
+        appendColumn(out, ",end", trackItems, [&](const TrackItemRow& r) { appendTicks(out, r.end); });
+        appendColumn(out, ",inPoint", trackItems, [&](const TrackItemRow& r) { appendTicks(out, r.inPoint); });
+        appendColumn(out, ",name", trackItems, [&](const TrackItemRow& r) { appendString(out, r.name); });
+        appendColumn(out, ",mediaPath", trackItems, [&](const TrackItemRow& r) { appendString(out, r.mediaPath); });
+        appendColumn(out, ",nestedSequence", trackItems, [&](const TrackItemRow& r) { out += std::to_string(r.nestedSequence); });
+        out += "},";
+    }
+    if (tables & PROJECT_TABLE_MARKERS) {
+        out += "markers:{";
+        appendColumn(out, "sequence", markers, [&](const MarkerRow& r) { out += std::to_string(r.sequence); });
+        appendColumn(out, ",clip", markers, [&](const MarkerRow& r) { appendString(out, r.clip); });
+        appendColumn(out, ",start", markers, [&](const MarkerRow& r) { appendTicks(out, r.start); });
+        appendColumn(out, ",duration", markers, [&](const MarkerRow& r) { appendTicks(out, r.duration); });
+        appendColumn(out, ",name", markers, [&](const MarkerRow& r) { appendString(out, r.name); });
+        appendColumn(out, ",comment", markers, [&](const MarkerRow& r) { appendString(out, r.comment); });
+        appendColumn(out, ",type", markers, [&](const MarkerRow& r) { appendString(out, r.type); });
+        out += "},";
+    }
+    if (tables & PROJECT_TABLE_KEYFRAMES) {
+        out += "keyframes:{";
+        appendColumn(out, "trackItem", keyframes, [&](const KeyframeRow& r) { out += std::to_string(r.trackItem); });
+        appendColumn(out, ",component", keyframes, [&](const KeyframeRow& r) { appendString(out, r.component); });
+        appendColumn(out, ",param", keyframes, [&](const KeyframeRow& r) { appendString(out, r.param); });
+        appendColumn(out, ",keys", keyframes, [&](const KeyframeRow& r) { appendString(out, r.keys); });
+        out += "},";
+    }
+    out += "stats:{fileBytes:" + std::to_string(stats.fileBytes);
+    out += ",xmlBytes:" + std::to_string(stats.xmlBytes);
+    out += ",elements:" + std::to_string(stats.elements);
+    out += ",objects:" + std::to_string(stats.objects);
+    out += ",keptObjects:" + std::to_string(stats.keptObjects);
+    out += ",keptBytes:" + std::to_string(stats.keptBytes);
+    out += "}})";
+}
+
+} // namespace
+
+bool parseProjectTables(const char* names, unsigned& tables) {
+    static const struct { const char* name; unsigned bit; } tableNames[] = {
+        { "bins",       PROJECT_TABLE_BINS },
+        { "sequences",  PROJECT_TABLE_SEQUENCES },
+        { "trackItems", PROJECT_TABLE_TRACK_ITEMS },
+        { "markers",    PROJECT_TABLE_MARKERS },
+        { "keyframes",  PROJECT_TABLE_KEYFRAMES },
+    };
+
+    tables = 0;
+    const char* p = names;
+    while (*p != '\0') {
+        const size_t length = strcspn(p, ",");
+        bool found = false;
+        for (const auto& table : tableNames) {
+            if (strncmp(table.name, p, length) == 0 && table.name[length] == '\0') {
+                tables |= table.bit;
+                found = true;
+            }
+        }
+        if (!found) return false;
+        p += length;
+        if (*p == ',') p++;
+    }
+    if (tables == 0) tables = PROJECT_TABLE_ALL;
+    return true;
+}
+
+long scanProjectFile(const std::string& path, unsigned tables, std::string& script, ProjectReadStats& stats,
+    const std::atomic<bool>* cancel, std::atomic<uint64_t>* bytesRead) {
+    stats = ProjectReadStats();
+    FILE* file = nullptr;
+    const long err = openUtf8File(path, "rb", file, &stats.fileBytes);
+    if (err != kESErrOK) return err;
+
+    std::unique_ptr<ProjectReader> reader(new ProjectReader(tables, cancel, stats));
+    InflateResult result = gunzipFile(file, *reader, bytesRead);
+    if (result == kInflateNotGzip) {
+        // Plain XML
+        result = kInflateOK;
+        rewind(file);
+        std::vector<char> buffer(READ_CHUNK_BYTES);
+        uint64_t total = 0;
+        size_t read;
+        while ((read = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+            total += read;
+            if (bytesRead != nullptr) bytesRead->store(total, std::memory_order_relaxed);
+            if (!reader->write(buffer.data(), read)) {
+                result = kInflateStopped;
+                break;
+            }
+        }
+        if (ferror(file)) result = kInflateIOError;
+    }
+    fclose(file);
+
+    if (reader->wasCancelled()) return kESErrBadAction;
+    if (result == kInflateIOError) return kESErrIO;
+    if (result != kInflateOK || !reader->finish()) return kESErrConversion;
+
+    // The reader's objects aren't needed once the tables are filled, so they're freed before the script is built
+    ProjectTables project;
+    ProjectLinker(*reader, project).link(tables);
+    reader.reset();
+    appendProjectScript(script, project, tables, stats);
+    return kESErrOK;
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Reads a saved project file and returns tables of its bins, sequences, track items, markers and keyframes.
+ * See ProjectFile.h for the tables. For a large project, run it as a "readProject" job instead (JobEngine.h).
+ * @param result Receives a script that evaluates to an object with the requested tables and a 'stats' member.
+ * @param path The .prproj file, e.g. app.project.path. Only what was last saved is read.
+ * @param tables Comma separated table names, or "" for all of them.
+ * @return kESErrOK on success, kESErrBadArgumentList for an unknown table name, kESErrNoFile if the file can't be opened,
+ *         kESErrIO if reading failed, or kESErrConversion if it isn't a project file.
+ *
+ * JavaScript Usage: var project = externalLibrary.readProjectFile(app.project.path, "sequences,trackItems");
+ */
+long readProjectFileTyped(ScriptResult& result, const char* path, const char* tables) {
+    unsigned tableBits = 0;
+    if (!parseProjectTables(tables, tableBits)) return kESErrBadArgumentList;
+    ProjectReadStats stats;
+    return scanProjectFile(path, tableBits, result.script, stats, nullptr, nullptr);
+}
+THIO_BIND_EXPORT(readProjectFile, readProjectFileTyped)
@@ -0,0 +1,71 @@
+#pragma once
+
+// ProjectFile.h
+// Reads a saved .prproj file directly, without going through Premiere's DOM or the QE DOM.
+//
+// Walking every sequence, track, clip and marker through the DOM is thousands of slow calls on a big project. A .prproj
+// is gzipped XML, so this decompresses it (Inflate.h) and scans the XML in one streaming pass, keeping only the
+// elements listed below that the requested tables use, then links them up and returns compact tables. Memory use
+// depends on what's kept, not on the size of the XML, which for a large project is several hundred MB: reading only
+// "bins" keeps the bins and their items, and reading "sequences" adds a reference per clip to find their bins.
+//
+// The file holds the project as it was last saved, so unsaved changes aren't in it. Pair the result with the result
+// cache (ResultCache.h), whose keys include the file's modification time, to read each saved version only once.
+//
+// Project XML is a flat list of objects under the root element, each with an ObjectID (referred to by ObjectRef) or
+// an ObjectUID (referred to by ObjectURef). The reader keeps, per object, a few named fields and the references
+// between objects, then follows:
+//      bins            RootProjectItem / BinProjectItem -> Items -> Item
+//      sequences       Sequence -> TrackGroups -> Second (Video/AudioTrackGroup) -> Tracks -> Track
+//      track items     Video/AudioClipTrack -> TrackItems -> TrackItem (Start, End) -> SubClip -> Clip -> Source -> Media
+//      keyframes       TrackItem -> Components -> Component (MatchName) -> Param (Name, Keyframes)
+//      markers         Sequence or MasterClip -> Markers -> DVAMarker (JSON with the start, duration, name, comment)
+// Elements it doesn't recognize are skipped, so projects from other versions still read, with fewer details.
+//
+// Tables (each one object of parallel arrays, ticks as strings like Time.ticks):
+//      bins            name, parent (index into bins, -1 for the root)
+//      sequences       id (Sequence.sequenceID), name, bin, timebase (ticks per frame), videoTracks, audioTracks
+//      trackItems      sequence, type ("video" / "audio"), track, start, end, inPoint, name, mediaPath, nestedSequence
+//      markers         sequence (-1 for clip markers), clip (master clip name), start, duration, name, comment, type
+//      keyframes       trackItem, component (match name), param, keys (packed for the Keyframes.h exports)
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Tables, as bits, for the 'tables' argument
+#define PROJECT_TABLE_BINS          0x01
+#define PROJECT_TABLE_SEQUENCES     0x02
+#define PROJECT_TABLE_TRACK_ITEMS   0x04
+#define PROJECT_TABLE_MARKERS       0x08
+#define PROJECT_TABLE_KEYFRAMES     0x10
+#define PROJECT_TABLE_ALL           0x1F
+
+struct ProjectReadStats {
+    uint64_t fileBytes = 0;     // Size of the .prproj
+    uint64_t xmlBytes = 0;      // After decompressing
+    uint64_t elements = 0;
+    uint64_t objects = 0;       // Objects in the file
+    uint64_t keptObjects = 0;   // Objects with something the tables use
+    uint64_t keptBytes = 0;     // Memory the reader held for them before linking
+};
+
+/**
+ * @brief Parses a comma separated list of table names, e.g. "sequences,trackItems". "" is every table.
+ * @return false for an unknown name.
+ */
+bool parseProjectTables(const char* names, unsigned& tables);
+
+// Replaces XML character references (&amp; &#233; ...) in element text with the characters. Unknown ones are left as they are.
+void decodeXmlText(const char* text, size_t length, std::string& out);
+
+/**
+ * @brief Reads a project file and appends the requested tables to 'script' as an object literal, with a 'stats' member
+ * (see ProjectReadStats). Also reads plain uncompressed XML, which makes test projects easy to write by hand.
+ * @param cancel If not null, checked as the file is read, and the read stops when it becomes true.
+ * @param bytesRead If not null, updated with the bytes of the file read so far, for progress.
+ * @return kESErrOK, kESErrNoFile, kESErrIO, kESErrConversion if the file is corrupt or isn't XML, or kESErrBadAction
+ *         if cancelled.
+ */
+long scanProjectFile(const std::string& path, unsigned tables, std::string& script, ProjectReadStats& stats,
+    const std::atomic<bool>* cancel, std::atomic<uint64_t>* bytesRead);
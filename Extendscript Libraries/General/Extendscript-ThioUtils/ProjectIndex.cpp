@@ -0,0 +1,661 @@
+#include "ProjectIndex.h"
+#include "BatchCall.h"
+#include "LiveObjects.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <unordered_set>
+
+// ------------------------------------------------------------------------------------------------
+// ProjectIndex
+// ------------------------------------------------------------------------------------------------
+
+void ProjectIndex::clear() {
+    items.clear();
+    freeSlots.clear();
+    rootChildren.clear();
+    byId.clear();
+    byParentAndName.clear();
+    byFoldedName.clear();
+}
+
+std::string ProjectIndex::foldName(const std::string& name) {
+    std::string folded = name;
+    for (char& c : folded) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    }
+    return folded;
+}
+
+bool ProjectIndex::parseRecords(const char* records, std::vector<ParsedRecord>& parsed) {
+    if (records == nullptr) {
+        return false;
+    }
+
+    const char* p = records;
+    while (*p != '\0') {
+        const char* lineEnd = strchr(p, '\n');
+        if (lineEnd == nullptr) {
+            lineEnd = p + strlen(p);
+        }
+
+        if (lineEnd > p) {
+            // Three tabs, then the name is the rest of the line
+            const char* fields[4] = { p, nullptr, nullptr, nullptr };
+            for (int i = 1; i < 4; i++) {
+                const char* tab = static_cast<const char*>(memchr(fields[i - 1], '\t', lineEnd - fields[i - 1]));
+                if (tab == nullptr) {
+                    return false;
+                }
+                fields[i] = tab + 1;
+            }
+
+            ParsedRecord record;
+            if (!unescapeBatchString(fields[0], fields[1] - 1, record.id) || record.id.empty() ||
+                !unescapeBatchString(fields[1], fields[2] - 1, record.parentId) ||
+                !unescapeBatchString(fields[2], fields[3] - 1, record.type) ||
+                !unescapeBatchString(fields[3], lineEnd, record.name)) {
+                return false;
+            }
+            parsed.push_back(std::move(record));
+        }
+
+        p = (*lineEnd == '\0') ? lineEnd : lineEnd + 1;
+    }
+    return true;
+}
+
+bool ProjectIndex::validateRecords(int top, const std::vector<ParsedRecord>& parsed, const std::unordered_set<std::string>& replacedIds) const {
+    const std::string topId = (top < 0) ? std::string() : items[top].id;
+    std::unordered_set<std::string> seen;
+    seen.reserve(parsed.size());
+
+    for (const ParsedRecord& record : parsed) {
+        // Ids may only repeat ones that are being replaced, and each only once
+        if (record.id == topId || !seen.insert(record.id).second) {
+            return false;
+        }
+        if (byId.count(record.id) != 0 && replacedIds.count(record.id) == 0) {
+            return false;
+        }
+        // The parent is the top item or an item already listed
+        if (record.parentId != topId && seen.count(record.parentId) == 0) {
+            return false;
+        }
+        if (record.parentId == record.id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ProjectIndex::addItem(const ParsedRecord& record, int parent, uint64_t generation) {
+    int index;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        index = (int)items.size();
+        items.emplace_back();
+    }
+
+    Item& item = items[index];
+    item.id = record.id;
+    item.name = record.name;
+    item.type = record.type;
+    item.parent = parent;
+    item.generation = generation;
+    item.subtreeGeneration = generation;
+    item.children.clear();
+    item.alive = true;
+
+    byId[item.id] = index;
+    byParentAndName[ChildKey{ parent, item.name }].push_back(index);
+    byFoldedName[foldName(item.name)].push_back(index);
+    childrenOf(parent).push_back(index);
+    return index;
+}
+
+static void eraseIndex(std::vector<int>& list, int index) {
+    auto found = std::find(list.begin(), list.end(), index);
+    if (found != list.end()) {
+        list.erase(found);
+    }
+}
+
+void ProjectIndex::removeSubtree(int top, bool includeTop) {
+    std::vector<int> subtree;
+    collectSubtree(top, subtree);
+
+    for (int index : subtree) {
+        if (index == top && !includeTop) {
+            continue;
+        }
+        Item& item = items[index];
+
+        byId.erase(item.id);
+        auto byName = byParentAndName.find(ChildKey{ item.parent, item.name });
+        if (byName != byParentAndName.end()) {
+            eraseIndex(byName->second, index);
+            if (byName->second.empty()) byParentAndName.erase(byName);
+        }
+        auto byFolded = byFoldedName.find(foldName(item.name));
+        if (byFolded != byFoldedName.end()) {
+            eraseIndex(byFolded->second, index);
+            if (byFolded->second.empty()) byFoldedName.erase(byFolded);
+        }
+
+        // Only the top item's parent outlives this, the other parents are removed along with their children
+        if (index == top) {
+            eraseIndex(childrenOf(item.parent), index);
+        }
+
+        item.alive = false;
+        item.children.clear();
+        item.id.clear();
+        item.name.clear();
+        item.type.clear();
+        freeSlots.push_back(index);
+    }
+
+    if (!includeTop) {
+        childrenOf(top).clear();
+    }
+}
+
+void ProjectIndex::collectSubtree(int top, std::vector<int>& subtree) const {
+    // Parents come before their children
+    if (top >= 0) {
+        subtree.push_back(top);
+    } else {
+        subtree.insert(subtree.end(), rootChildren.begin(), rootChildren.end());
+    }
+    for (size_t i = 0; i < subtree.size(); i++) {
+        const std::vector<int>& children = items[subtree[i]].children;
+        subtree.insert(subtree.end(), children.begin(), children.end());
+    }
+}
+
+void ProjectIndex::refreshSubtreeGenerations(const std::vector<int>& subtree) {
+    // Children come after their parents, so going backwards finishes every child before its parent
+    for (size_t i = subtree.size(); i-- > 0;) {
+        Item& item = items[subtree[i]];
+        item.subtreeGeneration = item.generation;
+        for (int child : item.children) {
+            item.subtreeGeneration = std::max(item.subtreeGeneration, items[child].subtreeGeneration);
+        }
+    }
+}
+
+void ProjectIndex::propagateGeneration(int from, uint64_t generation) {
+    // Generations only grow, so the ancestors just take the larger value
+    for (int index = from; index >= 0; index = items[index].parent) {
+        items[index].subtreeGeneration = std::max(items[index].subtreeGeneration, generation);
+    }
+    rootSubtreeGeneration = std::max(rootSubtreeGeneration, generation);
+}
+
+bool ProjectIndex::load(const char* records) {
+    std::vector<ParsedRecord> parsed;
+    clear();
+    if (!parseRecords(records, parsed) || !validateRecords(-1, parsed, {})) {
+        return false;
+    }
+
+    const uint64_t generation = ++currentGeneration;
+    for (const ParsedRecord& record : parsed) {
+        addItem(record, record.parentId.empty() ? -1 : byId[record.parentId], generation);
+    }
+    rootSubtreeGeneration = generation;
+    return true;
+}
+
+bool ProjectIndex::update(const std::string& binId, const char* records) {
+    const int top = find(binId);
+    if (top < 0 && !binId.empty()) {
+        return false;
+    }
+
+    std::vector<ParsedRecord> parsed;
+    std::vector<int> oldSubtree;
+    collectSubtree(top, oldSubtree);
+    std::unordered_set<std::string> oldIds;
+    oldIds.reserve(oldSubtree.size());
+    for (int index : oldSubtree) {
+        if (index != top) oldIds.insert(items[index].id);
+    }
+    if (!parseRecords(records, parsed) || !validateRecords(top, parsed, oldIds)) {
+        return false;
+    }
+
+    // Remember what each item looked like, to keep the generation of the ones that didn't change
+    struct OldItem {
+        std::string parentId;
+        std::string type;
+        std::string name;
+        uint64_t generation;
+        std::vector<std::string> childIds;
+    };
+    auto childIdsOf = [this](int parent) {
+        std::vector<std::string> ids;
+        for (int child : childrenOf(parent)) ids.push_back(items[child].id);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    std::unordered_map<std::string, OldItem> oldItems;
+    oldItems.reserve(oldSubtree.size());
+    for (int index : oldSubtree) {
+        if (index == top) continue;
+        const Item& item = items[index];
+        const std::string parentId = (item.parent == top) ? binId : items[item.parent].id;
+        oldItems.emplace(item.id, OldItem{ parentId, item.type, item.name, item.generation, childIdsOf(index) });
+    }
+    const std::vector<std::string> oldTopChildren = childIdsOf(top);
+
+    removeSubtree(top, false);
+
+    const uint64_t generation = currentGeneration + 1;
+    bool changed = oldItems.size() != parsed.size();
+    std::vector<int> newSubtree;
+    if (top >= 0) newSubtree.push_back(top);
+    for (const ParsedRecord& record : parsed) {
+        auto old = oldItems.find(record.id);
+        const bool same = old != oldItems.end() && old->second.parentId == record.parentId &&
+            old->second.type == record.type && old->second.name == record.name;
+        changed |= !same;
+        const int parent = (record.parentId == binId) ? top : byId[record.parentId];
+        newSubtree.push_back(addItem(record, parent, same ? old->second.generation : generation));
+    }
+
+    // Items whose children were added, removed or swapped changed too
+    for (int index : newSubtree) {
+        Item& item = items[index];
+        const std::vector<std::string>* oldChildren = nullptr;
+        if (index == top) {
+            oldChildren = &oldTopChildren;
+        } else {
+            auto old = oldItems.find(item.id);
+            if (old != oldItems.end()) oldChildren = &old->second.childIds;
+        }
+        if (oldChildren != nullptr && item.generation != generation && *oldChildren != childIdsOf(index)) {
+            item.generation = generation;
+            changed = true;
+        }
+    }
+    if (top < 0 && oldTopChildren != childIdsOf(-1)) {
+        changed = true;
+    }
+
+    if (changed) {
+        currentGeneration = generation;
+    }
+    refreshSubtreeGenerations(newSubtree);
+    if (top < 0) {
+        if (changed) rootSubtreeGeneration = generation;
+    } else {
+        propagateGeneration(items[top].parent, items[top].subtreeGeneration);
+    }
+    return true;
+}
+
+bool ProjectIndex::remove(const std::string& id) {
+    const int index = find(id);
+    if (index < 0) {
+        return false;
+    }
+
+    const int parent = items[index].parent;
+    removeSubtree(index, true);
+
+    // The parent's children changed
+    const uint64_t generation = ++currentGeneration;
+    if (parent >= 0) {
+        items[parent].generation = generation;
+    }
+    propagateGeneration(parent, generation);
+    return true;
+}
+
+int ProjectIndex::find(const std::string& id) const {
+    auto found = byId.find(id);
+    return (found != byId.end()) ? found->second : -1;
+}
+
+void ProjectIndex::childrenNamed(int bin, const std::string& name, std::vector<int>& results) const {
+    auto found = byParentAndName.find(ChildKey{ bin, name });
+    if (found != byParentAndName.end()) {
+        results.insert(results.end(), found->second.begin(), found->second.end());
+    }
+}
+
+void ProjectIndex::findPath(const std::string& path, int start, bool binsOnly, std::vector<int>& results) const {
+    // Split into names, skipping empty ones so leading, trailing and doubled slashes don't matter
+    std::vector<std::string> names;
+    size_t begin = 0;
+    while (begin <= path.size()) {
+        size_t end = path.find('/', begin);
+        if (end == std::string::npos) end = path.size();
+        if (end > begin) names.push_back(path.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    if (names.empty()) {
+        return;
+    }
+
+    // Each bin along the way is the first bin with that name, like getBinByName
+    int bin = start;
+    std::vector<int> found;
+    for (size_t level = 0; level + 1 < names.size(); level++) {
+        found.clear();
+        childrenNamed(bin, names[level], found);
+        auto next = std::find_if(found.begin(), found.end(), [this](int index) { return items[index].type == "bin"; });
+        if (next == found.end()) {
+            return;
+        }
+        bin = *next;
+    }
+
+    found.clear();
+    childrenNamed(bin, names.back(), found);
+    for (int index : found) {
+        if (!binsOnly || items[index].type == "bin") {
+            results.push_back(index);
+        }
+    }
+}
+
+void ProjectIndex::findName(const std::string& name, const std::string& type, std::vector<int>& results) const {
+    auto found = byFoldedName.find(foldName(name));
+    if (found == byFoldedName.end()) {
+        return;
+    }
+    for (int index : found->second) {
+        if (type.empty() || items[index].type == type) {
+            results.push_back(index);
+        }
+    }
+}
+
+void ProjectIndex::itemsOfType(const std::string& type, std::vector<int>& results) const {
+    std::vector<int> subtree;
+    collectSubtree(-1, subtree);
+    for (int index : subtree) {
+        if (items[index].type == type) {
+            results.push_back(index);
+        }
+    }
+}
+
+std::string ProjectIndex::pathOf(int item) const {
+    std::vector<int> chain;
+    for (int index = item; index >= 0; index = items[index].parent) {
+        chain.push_back(index);
+    }
+    std::string path;
+    for (size_t i = chain.size(); i-- > 0;) {
+        path += items[chain[i]].name;
+        if (i > 0) path += '/';
+    }
+    return path;
+}
+
+// ------------------------------------------------------------------------------------------------
+// LiveObject class: ProjectIndex
+//
+// JavaScript Usage:
+//      var index = new ProjectIndex();
+//      index.load("000f4241\t\tbin\tFootage\n000f4242\t000f4241\tclip\tA001.mov\n000f4243\t\tsequence\tMain");
+//      index.byPath("Footage/A001.mov");        // ["000f4242"]
+//      index.binByPath("Footage");              // "000f4241", or null
+//      index.childrenNamed("", "Main");         // ["000f4243"], "" is the root
+//      index.byName("a001.MOV");                // ["000f4242"], ignoring case. Optional second argument is a type
+//      index.sequences();                       // ["000f4243"]
+//      index.pathOf("000f4242");                // "Footage/A001.mov"
+//      index.update("000f4241", records);       // Replaces everything in Footage, returns the new generation
+//      index.generationOf("000f4241");          // Newest generation in Footage
+//      index.remove("000f4243");
+//      index.count; index.generation;
+// ------------------------------------------------------------------------------------------------
+
+enum ProjectIndexMember {
+    kProjectIndex_load = 1,
+    kProjectIndex_clear,
+    kProjectIndex_update,
+    kProjectIndex_remove,
+    kProjectIndex_byPath,
+    kProjectIndex_binByPath,
+    kProjectIndex_childrenNamed,
+    kProjectIndex_byName,
+    kProjectIndex_ofType,
+    kProjectIndex_sequences,
+    kProjectIndex_pathOf,
+    kProjectIndex_generationOf,
+    kProjectIndex_count,
+    kProjectIndex_generation,
+};
+
+static SoCClientName projectIndexMethods[] = {
+    { "load",           kProjectIndex_load,             nullptr },
+    { "clear",          kProjectIndex_clear,            nullptr },
+    { "update",         kProjectIndex_update,           nullptr },
+    { "remove",         kProjectIndex_remove,           nullptr },
+    { "byPath",         kProjectIndex_byPath,           nullptr },
+    { "binByPath",      kProjectIndex_binByPath,        nullptr },
+    { "childrenNamed",  kProjectIndex_childrenNamed,    nullptr },
+    { "byName",         kProjectIndex_byName,           nullptr },
+    { "ofType",         kProjectIndex_ofType,           nullptr },
+    { "sequences",      kProjectIndex_sequences,        nullptr },
+    { "pathOf",         kProjectIndex_pathOf,           nullptr },
+    { "generationOf",   kProjectIndex_generationOf,     nullptr },
+    { nullptr, 0, nullptr }
+};
+
+static SoCClientName projectIndexProperties[] = {
+    { "count",      kProjectIndex_count,        nullptr },
+    { "generation", kProjectIndex_generation,   nullptr },
+    { nullptr, 0, nullptr }
+};
+
+static ESerror_t projectIndexInitialize(SoHObject hObject, int argc, TaggedData* argv) {
+    SoServerInterface* server = getLiveObjectServer();
+    if (server == nullptr) return kESErrInternal;
+
+    ProjectIndex* index = new (std::nothrow) ProjectIndex();
+    if (index == nullptr) return THIO_ERR_NO_MEMORY;
+    if (!setLiveObjectData(hObject, index)) {
+        delete index;
+        return THIO_ERR_INTERNAL;
+    }
+
+    server->addMethods(hObject, projectIndexMethods);
+    server->addProperties(hObject, projectIndexProperties);
+
+    // Optionally load right away: new ProjectIndex(records)
+    if (argc >= 1 && argv[0].type == kTypeString) {
+        try {
+            if (!index->load(argv[0].data.string)) return kESErrBadArgumentList;
+        } catch (const std::bad_alloc&) {
+            index->clear();
+            return THIO_ERR_NO_MEMORY;
+        }
+    }
+    return kESErrOK;
+}
+
+static ESerror_t projectIndexGet(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    ProjectIndex* index = static_cast<ProjectIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+
+    switch (name->id) {
+    case kProjectIndex_count:
+        setIntegerResult(pValue, (long long)index->size());
+        return kESErrOK;
+    case kProjectIndex_generation:
+        setIntegerResult(pValue, (long long)index->generation());
+        return kESErrOK;
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t projectIndexPut(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    return kESErrNoLvalue; // All properties are read-only
+}
+
+static long setItemIdsResult(TaggedData* pResult, const ProjectIndex& index, const std::vector<int>& found) {
+    std::string script = "[";
+    for (size_t i = 0; i < found.size(); i++) {
+        if (i > 0) script += ",";
+        const std::string& id = index.item(found[i]).id;
+        appendJsString(script, id.c_str(), id.size());
+    }
+    script += "]";
+    return setLiveObjectScriptResult(pResult, script);
+}
+
+// Reads a bin id argument, where "" is the root. Returns false if it isn't a string or the bin isn't in the index.
+static bool getBinArg(const ProjectIndex& index, const TaggedData& arg, int& bin) {
+    const char* id = nullptr;
+    if (!getStringArg(arg, id)) return false;
+    bin = index.find(id);
+    return bin >= 0 || *id == '\0';
+}
+
+static ESerror_t projectIndexCallMember(ProjectIndex* index, SoCClientName* name, int argc, TaggedData* argv, TaggedData* pResult) {
+    const char* text = nullptr;
+    const char* type = "";
+    int bin = -1;
+    std::vector<int> found;
+
+    switch (name->id) {
+    case kProjectIndex_load:
+        if (argc != 1 || !getStringArg(argv[0], text)) return kESErrBadArgumentList;
+        if (!index->load(text)) return kESErrConversion;
+        setIntegerResult(pResult, (long long)index->size());
+        return kESErrOK;
+
+    case kProjectIndex_clear:
+        index->clear();
+        return kESErrOK;
+
+    case kProjectIndex_update: {
+        const char* binId = nullptr;
+        if (argc != 2 || !getStringArg(argv[0], binId) || !getStringArg(argv[1], text)) return kESErrBadArgumentList;
+        if (index->find(binId) < 0 && *binId != '\0') return kESErrRange;
+        if (!index->update(binId, text)) return kESErrConversion;
+        setIntegerResult(pResult, (long long)index->generation());
+        return kESErrOK;
+    }
+    case kProjectIndex_remove:
+        if (argc != 1 || !getStringArg(argv[0], text)) return kESErrBadArgumentList;
+        setBoolResult(pResult, index->remove(text));
+        return kESErrOK;
+
+    case kProjectIndex_byPath:
+    case kProjectIndex_binByPath: {
+        // Optional start bin, the root by default
+        if (argc < 1 || argc > 2 || !getStringArg(argv[0], text)) return kESErrBadArgumentList;
+        if (argc == 2 && !getBinArg(*index, argv[1], bin)) {
+            return setLiveObjectScriptResult(pResult, "null");
+        }
+        const bool binsOnly = name->id == kProjectIndex_binByPath;
+        index->findPath(text, bin, binsOnly, found);
+        if (!binsOnly) {
+            return setItemIdsResult(pResult, *index, found);
+        }
+        if (found.empty()) {
+            return setLiveObjectScriptResult(pResult, "null");
+        }
+        return setLiveObjectStringResult(pResult, index->item(found[0]).id);
+    }
+    case kProjectIndex_childrenNamed:
+        if (argc != 2 || !getStringArg(argv[1], text)) return kESErrBadArgumentList;
+        if (!getBinArg(*index, argv[0], bin)) {
+            return setLiveObjectScriptResult(pResult, "null");
+        }
+        index->childrenNamed(bin, text, found);
+        return setItemIdsResult(pResult, *index, found);
+
+    case kProjectIndex_byName:
+        if (argc < 1 || argc > 2 || !getStringArg(argv[0], text)) return kESErrBadArgumentList;
+        if (argc == 2 && !getStringArg(argv[1], type)) return kESErrBadArgumentList;
+        index->findName(text, type, found);
+        return setItemIdsResult(pResult, *index, found);
+
+    case kProjectIndex_ofType:
+    case kProjectIndex_sequences:
+        if (name->id == kProjectIndex_sequences) {
+            if (argc != 0) return kESErrBadArgumentList;
+            type = "sequence";
+        } else if (argc != 1 || !getStringArg(argv[0], type)) {
+            return kESErrBadArgumentList;
+        }
+        index->itemsOfType(type, found);
+        return setItemIdsResult(pResult, *index, found);
+
+    case kProjectIndex_pathOf: {
+        if (argc != 1 || !getStringArg(argv[0], text)) return kESErrBadArgumentList;
+        const int item = index->find(text);
+        if (item < 0) {
+            return setLiveObjectScriptResult(pResult, "null");
+        }
+        return setLiveObjectStringResult(pResult, index->pathOf(item));
+    }
+    case kProjectIndex_generationOf:
+        if (argc != 1) return kESErrBadArgumentList;
+        if (!getBinArg(*index, argv[0], bin)) {
+            setIntegerResult(pResult, -1);
+        } else {
+            setIntegerResult(pResult, (long long)((bin >= 0) ? index->item(bin).subtreeGeneration : index->rootGeneration()));
+        }
+        return kESErrOK;
+
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t projectIndexCall(SoHObject hObject, SoCClientName* name, int argc, TaggedData* argv, TaggedData* pResult) {
+    ProjectIndex* index = static_cast<ProjectIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+
+    try {
+        return projectIndexCallMember(index, name, argc, argv, pResult);
+    } catch (const std::bad_alloc&) {
+        // A load or update that ran out of memory part way can't be trusted
+        index->clear();
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+static ESerror_t projectIndexValueOf(SoHObject hObject, TaggedData* pResult) {
+    return kESErrOK; // Leaves the result undefined, there's no meaningful primitive value
+}
+
+static ESerror_t projectIndexToString(SoHObject hObject, TaggedData* pResult) {
+    ProjectIndex* index = static_cast<ProjectIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+    return setLiveObjectStringResult(pResult, "[ProjectIndex " + std::to_string(index->size()) + " items]");
+}
+
+static ESerror_t projectIndexFinalize(SoHObject hObject) {
+    delete static_cast<ProjectIndex*>(getLiveObjectData(hObject));
+    setLiveObjectData(hObject, nullptr);
+    return kESErrOK;
+}
+
+static SoObjectInterface projectIndexInterface = {
+    projectIndexInitialize,
+    projectIndexPut,
+    projectIndexGet,
+    projectIndexCall,
+    projectIndexValueOf,
+    projectIndexToString,
+    projectIndexFinalize
+};
+
+ESerror_t registerProjectIndexClass(SoServerInterface* server, SoHServer hServer) {
+    return server->addClass(hServer, (char*)"ProjectIndex", &projectIndexInterface);
+}
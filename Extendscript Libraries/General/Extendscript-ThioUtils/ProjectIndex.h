@@ -0,0 +1,129 @@
+#pragma once
+
+// ProjectIndex.h
+// Native index of the items in a project panel, for lookups by path and name without walking the DOM.
+//
+// Scripts load it with one pass over app.project.rootItem, sending the (nodeId, parent nodeId, type, name) of every
+// item. After that, a path like "Footage/Day 1/A001.mov" is one hash lookup per level instead of a loop over
+// children at every level, and names can be found anywhere in the project regardless of case.
+//
+// When a script changes part of the project, it re-sends just that bin's contents with update(). The index compares
+// them with what it had, and every item that was added, renamed, moved or had its children change gets the next
+// generation number. Each item also knows the newest generation anywhere under it, so scripts that cached something
+// about a bin can tell whether that bin changed by comparing one number, and re-read only the bins that did.
+//
+// Records are one per line, with tab separated fields "nodeId<TAB>parentNodeId<TAB>type<TAB>name". Backslashes, tabs
+// and newlines in a field are escaped as \\, \t and \n, like callBatch. Items in the root have an empty parent.
+// The type is any short text, ThioUtilsLib.jsx uses "bin", "sequence", "clip" and "file".
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ProjectIndex {
+public:
+    struct Item {
+        std::string id;
+        std::string name;
+        std::string type;
+        int parent = -1;                // Index of the parent item, -1 for items in the root
+        uint64_t generation = 0;        // When this item itself last changed
+        uint64_t subtreeGeneration = 0; // Newest generation of this item or anything under it
+        std::vector<int> children;
+        bool alive = false;
+    };
+
+    // Removes everything. The generation keeps counting, so numbers scripts hold never come back with other contents.
+    void clear();
+
+    /**
+     * @brief Replaces the contents with the items in 'records' (format above). Every item gets a new generation.
+     * @return false if a record is malformed, an id repeats, or a parent isn't in the records. The index is left empty.
+     */
+    bool load(const char* records);
+
+    /**
+     * @brief Replaces everything under one bin with 'records', which must hold all of the bin's items at every depth.
+     * Unchanged items keep their generation.
+     * @param binId The bin's nodeId, or "" for the whole project.
+     * @return false if the bin isn't in the index or the records are malformed. Nothing is changed in that case.
+     */
+    bool update(const std::string& binId, const char* records);
+
+    // Removes an item and everything under it. Returns false if there's no such item.
+    bool remove(const std::string& id);
+
+    // Index of the item with the given nodeId, or -1. "" is the root, which returns -1 as well.
+    int find(const std::string& id) const;
+
+    /**
+     * @brief Finds items by a path of names separated by '/'. Every level before the last must be a bin, like
+     * getItemByPath in ThioUtils.jsx.
+     * @param start Item to start from, or -1 for the root.
+     * @param binsOnly Only return bins at the last level too (getBinByPath).
+     */
+    void findPath(const std::string& path, int start, bool binsOnly, std::vector<int>& results) const;
+
+    // Items directly in a bin (-1 for the root) with exactly the given name
+    void childrenNamed(int bin, const std::string& name, std::vector<int>& results) const;
+
+    // Items anywhere with the given name ignoring ASCII case, optionally only of one type ("" for any)
+    void findName(const std::string& name, const std::string& type, std::vector<int>& results) const;
+
+    // Every item of a type, bins before their contents
+    void itemsOfType(const std::string& type, std::vector<int>& results) const;
+
+    // The item's path from the root, e.g. "Footage/Day 1/A001.mov"
+    std::string pathOf(int item) const;
+
+    const Item& item(int index) const { return items[index]; }
+    size_t size() const { return byId.size(); }
+    uint64_t generation() const { return currentGeneration; }
+    // Newest generation under the root
+    uint64_t rootGeneration() const { return rootSubtreeGeneration; }
+
+private:
+    struct ParsedRecord {
+        std::string id;
+        std::string parentId;
+        std::string type;
+        std::string name;
+    };
+
+    struct ChildKey {
+        int parent;
+        std::string name;
+        bool operator==(const ChildKey& other) const { return parent == other.parent && name == other.name; }
+    };
+    struct ChildKeyHash {
+        size_t operator()(const ChildKey& key) const { return std::hash<std::string>()(key.name) ^ ((size_t)(key.parent + 1) * 0x9E3779B97F4A7C15ULL); }
+    };
+
+    std::vector<Item> items;
+    std::vector<int> freeSlots;
+    std::vector<int> rootChildren;
+    std::unordered_map<std::string, int> byId;
+    std::unordered_map<ChildKey, std::vector<int>, ChildKeyHash> byParentAndName;
+    std::unordered_map<std::string, std::vector<int>> byFoldedName;
+    uint64_t currentGeneration = 0;
+    uint64_t rootSubtreeGeneration = 0;
+
+    static bool parseRecords(const char* records, std::vector<ParsedRecord>& parsed);
+    static std::string foldName(const std::string& name);
+
+    std::vector<int>& childrenOf(int parent) { return (parent < 0) ? rootChildren : items[parent].children; }
+    const std::vector<int>& childrenOf(int parent) const { return (parent < 0) ? rootChildren : items[parent].children; }
+
+    // Checks that every record's parent is 'top' (-1 for the root) or an earlier record, and that no id is already
+    // in the index unless it's in 'replacedIds'
+    bool validateRecords(int top, const std::vector<ParsedRecord>& parsed, const std::unordered_set<std::string>& replacedIds) const;
+    int addItem(const ParsedRecord& record, int parent, uint64_t generation);
+    // Removes everything under 'top' (-1 for the root), and 'top' itself if includeTop is set
+    void removeSubtree(int top, bool includeTop);
+    // Appends 'top' and everything under it, parents before their children
+    void collectSubtree(int top, std::vector<int>& subtree) const;
+    void refreshSubtreeGenerations(const std::vector<int>& subtree);
+    void propagateGeneration(int from, uint64_t generation);
+};
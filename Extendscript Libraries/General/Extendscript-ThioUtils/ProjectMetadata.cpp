@@ -0,0 +1,451 @@
+#include "ProjectMetadata.h"
+#include "Exports.h"
+#include "PackedData.h"
+#include "ProjectFile.h"
+#include "TextSearch.h"
+#include "ThioUtils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROJECT_METADATA_SSE2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#define MAX_METADATA_MEMO_ITEMS 100000
+
+// ------------------------------------------------------------------------------------------------
+// Scanning
+// ------------------------------------------------------------------------------------------------
+
+// Every column's tag starts with this, after the namespace prefix
+static const char columnPrefix[] = "Column.Intrinsic.";
+static const size_t columnPrefixLength = sizeof(columnPrefix) - 1;
+
+static const struct {
+    const char* name;       // For the 'fields' argument
+    const char* tag;        // After columnPrefix
+    unsigned bit;
+} metadataColumns[] = {
+    { "videoInfo", "VideoInfo",     METADATA_FIELD_VIDEO_INFO },
+    { "frameRate", "MediaTimebase", METADATA_FIELD_FRAME_RATE },
+    { "duration",  "MediaDuration", METADATA_FIELD_DURATION },
+    { "mediaPath", "FilePath",      METADATA_FIELD_MEDIA_PATH },
+    { "mediaType", "MediaType",     METADATA_FIELD_MEDIA_TYPE },
+};
+
+static inline bool isXmlNameEnd(char c) {
+    return c == '>' || c == '/' || c == '=' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+#if PROJECT_METADATA_SSE2
+static inline unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Finds the next "Column.Intrinsic." at or after 'from'. Like findIgnoreCase, it checks the first and last byte of the
+// prefix 16 positions at a time, and compares the rest only where both match.
+static size_t findColumnPrefix(const char* xmp, size_t length, size_t from) {
+    size_t i = from;
+#if PROJECT_METADATA_SSE2
+    const __m128i first = _mm_set1_epi8(columnPrefix[0]);
+    const __m128i last = _mm_set1_epi8(columnPrefix[columnPrefixLength - 1]);
+    for (; i + columnPrefixLength - 1 + 16 <= length; i += 16) {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xmp + i));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xmp + i + columnPrefixLength - 1));
+        unsigned int candidates = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+        while (candidates != 0) {
+            const size_t position = i + lowestBit(candidates);
+            if (memcmp(xmp + position + 1, columnPrefix + 1, columnPrefixLength - 2) == 0) {
+                return position;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+#endif
+    for (; i + columnPrefixLength <= length; i++) {
+        if (memcmp(xmp + i, columnPrefix, columnPrefixLength) == 0) {
+            return i;
+        }
+    }
+    return TEXT_NOT_FOUND;
+}
+
+// Powers of ten that are exact as doubles
+static const double exactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+};
+
+// strtod for the plain decimals the columns hold, e.g. "29.97". With at most 15 digits both the digits and the power of
+// ten are exact doubles, so a single division rounds the way strtod does. Anything else is left to strtod.
+static double parseDecimal(const char* p, char** end) {
+    uint64_t digits = 0;
+    int count = 0, fraction = 0;
+    const char* q = p;
+    for (; *q >= '0' && *q <= '9'; q++, count++) digits = digits * 10 + (uint64_t)(*q - '0');
+    if (*q == '.') {
+        for (q++; *q >= '0' && *q <= '9'; q++, count++, fraction++) digits = digits * 10 + (uint64_t)(*q - '0');
+    }
+    if (count == 0 || count > 15 || *q == 'e' || *q == 'E' || *q == 'x' || *q == 'X') return strtod(p, end);
+    *end = const_cast<char*>(q);
+    return (double)digits / exactPowersOfTen[fraction];
+}
+
+// "1920 x 1080 (1.0)". The pixel aspect ratio is optional.
+static bool parseVideoInfo(const char* p, MediaMetadata& metadata) {
+    char* end = nullptr;
+    const long width = strtol(p, &end, 10);
+    if (end == p) return false;
+    p = end;
+    while (*p == ' ') p++;
+    if (*p != 'x' && *p != 'X') return false;
+    p++;
+    const long height = strtol(p, &end, 10);
+    if (end == p || width <= 0 || height <= 0) return false;
+    p = end;
+    while (*p == ' ') p++;
+    metadata.width = width;
+    metadata.height = height;
+    metadata.pixelAspect = NAN;
+    if (*p == '(') {
+        const double aspect = parseDecimal(p + 1, &end);
+        if (end != p + 1 && *end == ')') metadata.pixelAspect = aspect;
+    }
+    return true;
+}
+
+// Stores one column's value, still XML encoded. Returns the column's bit, or 0 if the text isn't usable.
+static unsigned storeColumn(unsigned bit, const char* value, size_t length, MediaMetadata& metadata, std::string& text) {
+    switch (bit) {
+    case METADATA_FIELD_DURATION:
+        decodeXmlText(value, length, metadata.duration);
+        return bit;
+    case METADATA_FIELD_MEDIA_PATH:
+        decodeXmlText(value, length, metadata.mediaPath);
+        return bit;
+    case METADATA_FIELD_MEDIA_TYPE:
+        decodeXmlText(value, length, metadata.mediaType);
+        return bit;
+    }
+
+    // Numbers are parsed where they are unless they're encoded. Parsing stops at the '<' or quote that ends the value.
+    const char* number = value;
+    if (memchr(value, '&', length) != nullptr) {
+        decodeXmlText(value, length, text);
+        number = text.c_str();
+    }
+    if (bit == METADATA_FIELD_VIDEO_INFO) {
+        return parseVideoInfo(number, metadata) ? bit : 0;
+    }
+    char* end = nullptr;
+    const double rate = parseDecimal(number, &end);
+    if (end == number || !(rate > 0)) return 0;
+    metadata.frameRate = rate;
+    return bit;
+}
+
+size_t extractMediaMetadata(const char* xmp, size_t length, MediaMetadata& metadata) {
+    metadata = MediaMetadata();
+    std::string text;
+    // One past the last byte looked at so far
+    size_t readEnd = 0;
+    // Every tag in a blob normally has the same namespace prefix, so once one is known the next ones are checked with a
+    // single compare instead of walking back over them
+    const char* knownPrefix = nullptr;
+    size_t knownPrefixLength = 0;
+    size_t position = 0;
+    while (metadata.present != METADATA_FIELD_ALL) {
+        const size_t found = findColumnPrefix(xmp, length, position);
+        if (found == TEXT_NOT_FOUND) return length;
+        const size_t nameStart = found + columnPrefixLength;
+        size_t nameEnd = nameStart;
+        while (nameEnd < length && !isXmlNameEnd(xmp[nameEnd])) nameEnd++;
+        readEnd = std::max(readEnd, std::min(nameEnd + 2, length));
+        position = nameEnd;
+        if (found == 0 || xmp[found - 1] != ':') continue;
+
+        // What comes before the prefix says whether it's an element ("<ns:Column...>text<") or an attribute
+        // ("ns:Column...="text""). Anything else, e.g. the name inside some text, is skipped.
+        size_t prefixStart;
+        if (knownPrefix != nullptr && found > knownPrefixLength && memcmp(xmp + found - knownPrefixLength, knownPrefix, knownPrefixLength) == 0
+            && (isXmlNameEnd(xmp[found - knownPrefixLength - 1]) || xmp[found - knownPrefixLength - 1] == '<')) {
+            prefixStart = found - knownPrefixLength;
+        }
+        else {
+            prefixStart = found - 1;
+            while (prefixStart > 0 && !isXmlNameEnd(xmp[prefixStart - 1]) && xmp[prefixStart - 1] != '<' && xmp[prefixStart - 1] != '"') prefixStart--;
+            if (prefixStart == 0) continue;
+            knownPrefix = xmp + prefixStart;
+            knownPrefixLength = found - prefixStart;
+        }
+        const char before = xmp[prefixStart - 1];
+        const char* valueStart = nullptr;
+        const char* valueEnd = nullptr;
+        if (before == '<') {
+            if (nameEnd >= length || xmp[nameEnd] != '>') continue; // Self-closing or has attributes: no plain text
+            valueStart = xmp + nameEnd + 1;
+            valueEnd = static_cast<const char*>(memchr(valueStart, '<', xmp + length - valueStart));
+            if (valueEnd == nullptr) return length;
+            // Skips the closing tag, which would otherwise be the next match
+            const char* closeEnd = static_cast<const char*>(memchr(valueEnd, '>', xmp + length - valueEnd));
+            position = (closeEnd != nullptr && valueEnd + 1 < xmp + length && valueEnd[1] == '/') ? (size_t)(closeEnd + 1 - xmp) : (size_t)(valueEnd - xmp);
+            readEnd = std::max(readEnd, (closeEnd != nullptr) ? (size_t)(closeEnd + 1 - xmp) : length);
+        }
+        else if (before == ' ' || before == '\t' || before == '\r' || before == '\n') {
+            if (nameEnd + 1 >= length || xmp[nameEnd] != '=' || (xmp[nameEnd + 1] != '"' && xmp[nameEnd + 1] != '\'')) continue;
+            valueStart = xmp + nameEnd + 2;
+            valueEnd = static_cast<const char*>(memchr(valueStart, xmp[nameEnd + 1], xmp + length - valueStart));
+            if (valueEnd == nullptr) return length;
+            position = valueEnd - xmp;
+            readEnd = std::max(readEnd, position + 1);
+        }
+        else {
+            continue;
+        }
+
+        for (const auto& column : metadataColumns) {
+            if ((metadata.present & column.bit) == 0 && column.tag[0] == xmp[nameStart] && strlen(column.tag) == nameEnd - nameStart
+                && memcmp(column.tag, xmp + nameStart, nameEnd - nameStart) == 0) {
+                metadata.present |= storeColumn(column.bit, valueStart, valueEnd - valueStart, metadata, text);
+                break;
+            }
+        }
+    }
+    return readEnd;
+}
+
+bool parseMetadataFields(const char* names, unsigned& fields) {
+    fields = 0;
+    const char* p = names;
+    while (*p != '\0') {
+        const size_t length = strcspn(p, ",");
+        bool found = false;
+        for (const auto& column : metadataColumns) {
+            if (strncmp(column.name, p, length) == 0 && column.name[length] == '\0') {
+                fields |= column.bit;
+                found = true;
+            }
+        }
+        if (!found) return false;
+        p += length;
+        if (*p == ',') p++;
+    }
+    if (fields == 0) fields = METADATA_FIELD_ALL;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Memo
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+    struct MemoEntry {
+        uint64_t hash;      // Of the first 'scanned' bytes of the XMP
+        size_t scanned;     // What extractMediaMetadata returned
+        size_t length;
+        // Shared with the results being built, so an answer from memory copies no strings
+        std::shared_ptr<const MediaMetadata> metadata;
+    };
+
+    std::mutex memoMutex;
+    std::unordered_map<std::string, MemoEntry> metadataMemo;
+}
+
+void releaseMetadataMemo() {
+    std::lock_guard<std::mutex> lock(memoMutex);
+    metadataMemo.clear();
+}
+
+// Identifies an item's XMP. Four independent lanes of eight bytes, so the multiplies overlap and hashing costs a
+// fraction of scanning the text.
+static uint64_t hashMetadata(const char* data, size_t length) {
+    // The lanes are separate variables rather than an array, which compilers kept in memory, chaining every multiply
+    // through a store and a load
+    uint64_t lane0 = 0xCBF29CE484222325ULL ^ length, lane1 = 0x84222325CBF29CE4ULL, lane2 = 0x9E3779B97F4A7C15ULL, lane3 = 0xC2B2AE3D27D4EB4FULL;
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        uint64_t words[4];
+        memcpy(words, data + i, sizeof(words));
+        lane0 = (lane0 ^ words[0]) * 0x9E3779B97F4A7C15ULL;
+        lane1 = (lane1 ^ words[1]) * 0x9E3779B97F4A7C15ULL;
+        lane2 = (lane2 ^ words[2]) * 0x9E3779B97F4A7C15ULL;
+        lane3 = (lane3 ^ words[3]) * 0x9E3779B97F4A7C15ULL;
+        lane0 ^= lane0 >> 29;
+        lane1 ^= lane1 >> 29;
+        lane2 ^= lane2 >> 29;
+        lane3 ^= lane3 >> 29;
+    }
+    uint64_t hash = lane0 ^ (lane1 * 0x100000001B3ULL) ^ (lane2 * 0xC2B2AE3D27D4EB4FULL) ^ (lane3 * 0x165667B19E3779F9ULL);
+    for (; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001B3ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+enum MemoOutcome {
+    kMemoHit,       // Answered without scanning
+    kMemoParsed,    // Scanned, and remembered
+    kMemoMissing,   // No metadata sent and nothing remembered
+};
+
+// Whether the columns remembered in 'entry' are still those of 'xmp'. Only the part they were read from needs to be the
+// same, and the text no shorter, unless the whole text was read.
+static bool memoMatches(const MemoEntry& entry, const char* xmp, size_t length) {
+    if ((entry.scanned < entry.length) ? length < entry.scanned : length != entry.length) return false;
+    return hashMetadata(xmp, entry.scanned) == entry.hash;
+}
+
+// Looks one item up, scanning its XMP only if it's new or changed
+static MemoOutcome lookUpMetadata(const char* nodeId, size_t nodeIdLength, const char* xmp, size_t length, std::shared_ptr<const MediaMetadata>& metadata) {
+    const std::string key(nodeId, nodeIdLength);
+    if (!key.empty()) {
+        MemoEntry remembered{};
+        {
+            std::lock_guard<std::mutex> lock(memoMutex);
+            auto it = metadataMemo.find(key);
+            if (it != metadataMemo.end()) remembered = it->second;
+        }
+        // Hashed outside the lock, so other threads' lookups don't wait for it
+        if (remembered.metadata != nullptr && (length == 0 || memoMatches(remembered, xmp, length))) {
+            metadata = remembered.metadata;
+            return kMemoHit;
+        }
+    }
+    if (length == 0) {
+        metadata.reset();
+        return kMemoMissing;
+    }
+
+    std::shared_ptr<MediaMetadata> scanned = std::make_shared<MediaMetadata>();
+    const size_t scannedLength = extractMediaMetadata(xmp, length, *scanned);
+    metadata = scanned;
+    if (!key.empty()) {
+        const uint64_t hash = hashMetadata(xmp, scannedLength);
+        std::lock_guard<std::mutex> lock(memoMutex);
+        if (metadataMemo.size() >= MAX_METADATA_MEMO_ITEMS && metadataMemo.find(key) == metadataMemo.end()) {
+            metadataMemo.erase(metadataMemo.begin());
+        }
+        metadataMemo[key] = MemoEntry{ hash, scannedLength, length, metadata };
+    }
+    return kMemoParsed;
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+typedef std::vector<std::shared_ptr<const MediaMetadata>> MetadataList;
+
+template <typename AppendValue>
+static void appendMetadataColumn(std::string& out, const char* name, const MetadataList& items, unsigned bit, AppendValue appendValue) {
+    out += name;
+    out += ":[";
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) out += ',';
+        if (items[i] != nullptr && (items[i]->present & bit) != 0) appendValue(*items[i]);
+        else out += "null";
+    }
+    out += "],";
+}
+
+static void appendMetadataString(std::string& out, const std::string& value) {
+    appendJsString(out, value.data(), value.size());
+}
+
+/**
+ * @brief Reads resolution, frame rate, duration, media path and media type from many items' project metadata at once.
+ * See ProjectMetadata.h for the columns and how items are remembered.
+ * @param result Receives a script that evaluates to an object of parallel arrays: width, height and pixelAspect for
+ *        videoInfo, then frameRate, duration, mediaPath and mediaType as requested, 'found' (false for an item sent
+ *        without metadata that isn't remembered, so the caller should send it with its metadata), and a 'stats' member
+ *        with the number of items that were scanned, answered from memory, and missing.
+ * @param nodeIds The items' node ids as a string list (TextSearch.h), one per item. An empty id isn't remembered.
+ * @param metadata Each item's getProjectMetadata() text, separated by "\u0001". Empty for an item to answer from memory.
+ * @param fields Comma separated column names, or "" for all of them.
+ * @return kESErrOK on success, kESErrBadArgumentList if the item counts differ or a column name is unknown,
+ *         or kESErrConversion if the node id list is malformed.
+ *
+ * JavaScript Usage: var info = externalLibrary.extractMetadata(ids, xmps.join("\u0001"), "videoInfo"); // info.width[0]
+ */
+long extractMetadataTyped(ScriptResult& result, const char* nodeIds, const char* metadata, const char* fields) {
+    unsigned fieldBits = 0;
+    if (!parseMetadataFields(fields, fieldBits)) return kESErrBadArgumentList;
+    TextList ids;
+    if (!parseTextList(nodeIds, ids)) return kESErrConversion;
+
+    MetadataList items(ids.size());
+    size_t parsed = 0, hits = 0, missing = 0;
+    const char* p = metadata;
+    for (size_t i = 0; i < ids.size(); i++) {
+        const char* separator = strchr(p, METADATA_ITEM_SEPARATOR);
+        if ((separator == nullptr) != (i + 1 == ids.size())) return kESErrBadArgumentList;
+        const size_t length = (separator != nullptr) ? (size_t)(separator - p) : strlen(p);
+
+        switch (lookUpMetadata(ids.data(i), ids.length(i), p, length, items[i])) {
+        case kMemoHit: hits++; break;
+        case kMemoParsed: parsed++; break;
+        case kMemoMissing: missing++; break;
+        }
+        if (separator != nullptr) p = separator + 1;
+    }
+
+    std::string& out = result.script;
+    out = "({";
+    if (fieldBits & METADATA_FIELD_VIDEO_INFO) {
+        appendMetadataColumn(out, "width", items, METADATA_FIELD_VIDEO_INFO, [&](const MediaMetadata& m) { out += std::to_string(m.width); });
+        appendMetadataColumn(out, "height", items, METADATA_FIELD_VIDEO_INFO, [&](const MediaMetadata& m) { out += std::to_string(m.height); });
+        appendMetadataColumn(out, "pixelAspect", items, METADATA_FIELD_VIDEO_INFO, [&](const MediaMetadata& m) {
+            if (std::isnan(m.pixelAspect)) out += "null";
+            else appendJsNumber(out, m.pixelAspect);
+        });
+    }
+    if (fieldBits & METADATA_FIELD_FRAME_RATE) {
+        appendMetadataColumn(out, "frameRate", items, METADATA_FIELD_FRAME_RATE, [&](const MediaMetadata& m) { appendJsNumber(out, m.frameRate); });
+    }
+    if (fieldBits & METADATA_FIELD_DURATION) {
+        appendMetadataColumn(out, "duration", items, METADATA_FIELD_DURATION, [&](const MediaMetadata& m) { appendMetadataString(out, m.duration); });
+    }
+    if (fieldBits & METADATA_FIELD_MEDIA_PATH) {
+        appendMetadataColumn(out, "mediaPath", items, METADATA_FIELD_MEDIA_PATH, [&](const MediaMetadata& m) { appendMetadataString(out, m.mediaPath); });
+    }
+    if (fieldBits & METADATA_FIELD_MEDIA_TYPE) {
+        appendMetadataColumn(out, "mediaType", items, METADATA_FIELD_MEDIA_TYPE, [&](const MediaMetadata& m) { appendMetadataString(out, m.mediaType); });
+    }
+    out += "found:[";
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) out += ',';
+        out += (items[i] != nullptr) ? "true" : "false";
+    }
+    out += "],stats:{parsed:" + std::to_string(parsed);
+    out += ",hits:" + std::to_string(hits);
+    out += ",missing:" + std::to_string(missing);
+    out += "}})";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(extractMetadata, extractMetadataTyped)
+
+/**
+ * @brief Forgets every item extractMetadata remembered, e.g. after relinking media when items are looked up without metadata.
+ *
+ * JavaScript Usage: externalLibrary.clearMetadataMemo();
+ */
+THIO_EXPORT(clearMetadataMemo)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    releaseMetadataMemo();
+    return kESErrOK;
+}
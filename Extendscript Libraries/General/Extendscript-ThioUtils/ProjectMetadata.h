@@ -0,0 +1,62 @@
+#pragma once
+
+// ProjectMetadata.h
+// Reads the intrinsic columns (resolution, frame rate, duration, media path, media type) out of the XMP that
+// ProjectItem.getProjectMetadata() returns, for many items per call.
+//
+// The scripts used to search each item's XMP with indexOf and substring, once per column, and parse it again every time
+// they asked about the same clip. Here every requested column comes out of one pass over the XMP, which looks for tags
+// 16 bytes at a time with SSE2. The columns are remembered per item by node id, with a hash of the XMP up to the last
+// column read, so asking again about an item whose metadata hasn't changed only hashes that part of it. An item sent
+// with empty metadata is answered from what was remembered for its node id without the XMP at all, which saves the
+// getProjectMetadata call too, but won't notice changes such as relinked media.
+//
+// The columns, by the names the 'fields' argument uses, and the premierePrivateProjectMetaData tag each comes from:
+//      videoInfo       Column.Intrinsic.VideoInfo, e.g. "1920 x 1080 (1.0)": width, height and pixelAspect
+//      frameRate       Column.Intrinsic.MediaTimebase, e.g. "29.97 fps", as a number
+//      duration        Column.Intrinsic.MediaDuration, as the text Premiere shows, e.g. "00;00;10;00"
+//      mediaPath       Column.Intrinsic.FilePath
+//      mediaType       Column.Intrinsic.MediaType, e.g. "Movie" or "Still Image"
+// A column the item doesn't have (no VideoInfo for audio, say) is null.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define METADATA_FIELD_VIDEO_INFO   0x01
+#define METADATA_FIELD_FRAME_RATE   0x02
+#define METADATA_FIELD_DURATION     0x04
+#define METADATA_FIELD_MEDIA_PATH   0x08
+#define METADATA_FIELD_MEDIA_TYPE   0x10
+#define METADATA_FIELD_ALL          0x1F
+
+// Separates items in the metadata argument. XML can't contain it, so the XMP needs no escaping.
+#define METADATA_ITEM_SEPARATOR '\x01'
+
+struct MediaMetadata {
+    unsigned present = 0;       // METADATA_FIELD_ bits of the columns found
+    long width = 0;
+    long height = 0;
+    double pixelAspect = NAN;   // NaN if the VideoInfo has no "(1.0)" part
+    double frameRate = NAN;
+    std::string duration;
+    std::string mediaPath;
+    std::string mediaType;
+};
+
+/**
+ * @brief Parses a comma separated list of column names, e.g. "videoInfo,frameRate". "" is every column.
+ * @return false for an unknown name.
+ */
+bool parseMetadataFields(const char* names, unsigned& fields);
+
+/**
+ * @brief Reads every column from one item's XMP in a single pass, which stops once all of them are found.
+ * @return The number of bytes at the start of the XMP the columns depend on: any text that starts with the same bytes
+ *         and is no shorter has the same columns. 'length' if the whole XMP was read.
+ */
+size_t extractMediaMetadata(const char* xmp, size_t length, MediaMetadata& metadata);
+
+// Forgets every remembered item. Called from ESTerminate.
+void releaseMetadataMemo();
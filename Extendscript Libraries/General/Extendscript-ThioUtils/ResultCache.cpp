@@ -0,0 +1,785 @@
+#include "ResultCache.h"
+#include "BlockCompression.h"
+#include "Exports.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "PackedData.h"
+#include "ResultMemory.h"
+#include "TextEncoding.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Include platform specific headers
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define FILE_MAGIC "THIORC\r\n"
+#define FILE_FORMAT_VERSION 1
+#define RECORD_MAGIC 0x31435254U // "TRC1"
+#define RECORD_VERSION 1
+#define RECORD_COMPRESSED 0x0001
+
+// Keys longer than this aren't paths or kinds, so a record claiming one is damaged
+#define MAX_KEY_PART_BYTES 32768
+
+// Puts compact the file once it's over this size and less than a quarter of it is live
+#define AUTO_COMPACT_MIN_BYTES (4 * 1024 * 1024)
+
+// The structs are written as-is, which is fine for the little-endian platforms the Adobe apps run on
+struct FileHeader {
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint64_t projectModified;
+    uint32_t pathLength;
+    uint32_t kindLength;
+    uint32_t storedLength;
+    uint32_t valueLength;
+    uint32_t checksum;      // Of everything after the header, without the padding
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader is part of the file format");
+static_assert(sizeof(RecordHeader) == 40, "RecordHeader is part of the file format");
+
+static inline uint64_t alignRecord(uint64_t bytes) {
+    return (bytes + 7) & ~(uint64_t)7;
+}
+
+// Detects damaged records. Eight bytes per step, so checking a large value costs little next to using it.
+static uint32_t recordChecksum(const char* data, size_t length) {
+    uint64_t hash = 0x84222325CBF29CE4ULL ^ length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+    for (; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001B3ULL;
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static std::string makeKey(const std::string& projectPath, const std::string& kind) {
+    std::string key;
+    key.reserve(projectPath.size() + 1 + kind.size());
+    key += projectPath;
+    key += '\0';
+    key += kind;
+    return key;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Platform file access
+// ------------------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+bool getFileModifiedTime(const char* path, uint64_t& modified) {
+    std::wstring widePath;
+    if (!utf8ToWide(path, strlen(path), widePath)) return false;
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(widePath.c_str(), GetFileExInfoStandard, &attributes) || (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    modified = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+bool ResultCache::openFile(const std::string& path) {
+    std::wstring widePath;
+    if (!utf8ToWide(path.c_str(), path.size(), widePath)) return false;
+    // Others may read but not write, which keeps a second instance from appending at the same time
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    fileHandle = file;
+    return true;
+}
+
+void ResultCache::closeFile() {
+    unmapFile();
+    if (fileHandle != nullptr) {
+        CloseHandle((HANDLE)fileHandle);
+        fileHandle = nullptr;
+    }
+}
+
+bool ResultCache::mapFile() {
+    unmapFile();
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx((HANDLE)fileHandle, &size)) return false;
+    if (size.QuadPart == 0) return true; // Empty files can't be mapped, and there's nothing to read
+    if ((uint64_t)size.QuadPart > (uint64_t)SIZE_MAX) return false;
+
+    HANDLE mappingObject = CreateFileMappingW((HANDLE)fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingObject == nullptr) return false;
+    const void* view = MapViewOfFile(mappingObject, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mappingObject);
+        return false;
+    }
+    mappingHandle = mappingObject;
+    mapping = static_cast<const char*>(view);
+    mappedBytes = (uint64_t)size.QuadPart;
+    return true;
+}
+
+void ResultCache::unmapFile() {
+    if (mapping != nullptr) {
+        UnmapViewOfFile(mapping);
+        mapping = nullptr;
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle((HANDLE)mappingHandle);
+        mappingHandle = nullptr;
+    }
+    mappedBytes = 0;
+}
+
+bool ResultCache::writeAt(uint64_t offset, const void* data, size_t length) {
+    const char* p = static_cast<const char*>(data);
+    while (length > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        const DWORD chunk = (DWORD)std::min<size_t>(length, 1 << 30);
+        DWORD written = 0;
+        if (!WriteFile((HANDLE)fileHandle, p, chunk, &written, &overlapped) || written == 0) return false;
+        p += written;
+        offset += written;
+        length -= written;
+    }
+    return true;
+}
+
+bool ResultCache::truncateTo(uint64_t length) {
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG)length;
+    return SetFilePointerEx((HANDLE)fileHandle, position, nullptr, FILE_BEGIN) && SetEndOfFile((HANDLE)fileHandle);
+}
+
+bool ResultCache::isOpen() const {
+    return fileHandle != nullptr;
+}
+
+static bool replaceFile(const std::string& from, const std::string& to) {
+    std::wstring wideFrom, wideTo;
+    if (!utf8ToWide(from.c_str(), from.size(), wideFrom) || !utf8ToWide(to.c_str(), to.size(), wideTo)) return false;
+    return MoveFileExW(wideFrom.c_str(), wideTo.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+static void deleteFile(const std::string& path) {
+    std::wstring widePath;
+    if (utf8ToWide(path.c_str(), path.size(), widePath)) DeleteFileW(widePath.c_str());
+}
+
+#else
+
+bool getFileModifiedTime(const char* path, uint64_t& modified) {
+    struct stat info;
+    if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+#ifdef __APPLE__
+    modified = (uint64_t)info.st_mtimespec.tv_sec * 1000000000ULL + (uint64_t)info.st_mtimespec.tv_nsec;
+#else
+    modified = (uint64_t)info.st_mtim.tv_sec * 1000000000ULL + (uint64_t)info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool ResultCache::openFile(const std::string& path) {
+    const int descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (descriptor < 0) return false;
+    // Keeps a second instance from appending at the same time
+    if (flock(descriptor, LOCK_EX | LOCK_NB) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+    fileDescriptor = descriptor;
+    return true;
+}
+
+void ResultCache::closeFile() {
+    unmapFile();
+    if (fileDescriptor >= 0) {
+        ::close(fileDescriptor); // Also releases the lock
+        fileDescriptor = -1;
+    }
+}
+
+bool ResultCache::mapFile() {
+    unmapFile();
+    struct stat info;
+    if (fstat(fileDescriptor, &info) != 0) return false;
+    if (info.st_size == 0) return true;
+    if ((uint64_t)info.st_size > (uint64_t)SIZE_MAX) return false;
+
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (view == MAP_FAILED) return false;
+    mapping = static_cast<const char*>(view);
+    mappedBytes = (uint64_t)info.st_size;
+    return true;
+}
+
+void ResultCache::unmapFile() {
+    if (mapping != nullptr) {
+        munmap(const_cast<char*>(mapping), (size_t)mappedBytes);
+        mapping = nullptr;
+    }
+    mappedBytes = 0;
+}
+
+bool ResultCache::writeAt(uint64_t offset, const void* data, size_t length) {
+    const char* p = static_cast<const char*>(data);
+    while (length > 0) {
+        const ssize_t written = pwrite(fileDescriptor, p, length, (off_t)offset);
+        if (written <= 0) return false;
+        p += written;
+        offset += (uint64_t)written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+bool ResultCache::truncateTo(uint64_t length) {
+    return ftruncate(fileDescriptor, (off_t)length) == 0;
+}
+
+bool ResultCache::isOpen() const {
+    return fileDescriptor >= 0;
+}
+
+static bool replaceFile(const std::string& from, const std::string& to) {
+    return rename(from.c_str(), to.c_str()) == 0;
+}
+
+static void deleteFile(const std::string& path) {
+    unlink(path.c_str());
+}
+
+#endif
+
+// ------------------------------------------------------------------------------------------------
+// ResultCache
+// ------------------------------------------------------------------------------------------------
+
+ResultCache::~ResultCache() {
+    close();
+}
+
+void ResultCache::close() {
+    closeFile();
+    filePath.clear();
+    entries.clear();
+    endOffset = 0;
+    recordCount = 0;
+    liveBytes = 0;
+}
+
+long ResultCache::writeFileHeader() {
+    FileHeader header = {};
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.formatVersion = FILE_FORMAT_VERSION;
+    return writeAt(0, &header, sizeof(header)) ? kESErrOK : kESErrIO;
+}
+
+long ResultCache::open(const std::string& path) {
+    close();
+    if (!openFile(path)) {
+        return kESErrIO;
+    }
+    filePath = path;
+
+    if (!mapFile()) {
+        close();
+        return kESErrIO;
+    }
+    if (mappedBytes == 0) {
+        const long err = writeFileHeader();
+        if (err != kESErrOK) {
+            close();
+            return err;
+        }
+        endOffset = sizeof(FileHeader);
+        return kESErrOK;
+    }
+
+    FileHeader header;
+    if (mappedBytes < sizeof(header)) {
+        close();
+        return kESErrConversion;
+    }
+    memcpy(&header, mapping, sizeof(header));
+    if (memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.formatVersion > FILE_FORMAT_VERSION) {
+        close();
+        return kESErrConversion;
+    }
+
+    scanRecords(sizeof(FileHeader));
+
+    // Cut off a record a crash left half written, so the next put doesn't leave a gap
+    if (endOffset < mappedBytes) {
+        unmapFile();
+        if (!truncateTo(endOffset) || !mapFile()) {
+            close();
+            return kESErrIO;
+        }
+    }
+    return kESErrOK;
+}
+
+void ResultCache::scanRecords(uint64_t offset) {
+    while (offset + sizeof(RecordHeader) <= mappedBytes) {
+        RecordHeader header;
+        memcpy(&header, mapping + offset, sizeof(header));
+        if (header.magic != RECORD_MAGIC || header.pathLength > MAX_KEY_PART_BYTES || header.kindLength > MAX_KEY_PART_BYTES ||
+            header.storedLength > RESULT_CACHE_MAX_VALUE_BYTES + RESULT_CACHE_MAX_VALUE_BYTES / 16) {
+            break;
+        }
+        const uint64_t contentBytes = (uint64_t)header.pathLength + header.kindLength + header.storedLength;
+        const uint64_t recordBytes = alignRecord(sizeof(RecordHeader) + contentBytes);
+        if (offset + recordBytes > mappedBytes) {
+            break;
+        }
+
+        // Checksums of the other records are checked when they're first read, so opening a big cache stays quick.
+        // The last one is checked now since it's the one a crash would have cut short.
+        const char* content = mapping + offset + sizeof(RecordHeader);
+        const bool last = offset + recordBytes == mappedBytes;
+        if (last && recordChecksum(content, (size_t)contentBytes) != header.checksum) {
+            break;
+        }
+
+        recordCount++;
+        if (header.version <= RECORD_VERSION) {
+            const std::string key = makeKey(std::string(content, header.pathLength), std::string(content + header.pathLength, header.kindLength));
+            auto existing = entries.find(key);
+            if (existing != entries.end()) {
+                liveBytes -= existing->second.recordBytes;
+            }
+            entries[key] = Entry{ offset, header.projectModified, recordBytes, last };
+            liveBytes += recordBytes;
+        }
+        offset += recordBytes;
+    }
+    endOffset = offset;
+}
+
+bool ResultCache::find(const std::string& projectPath, uint64_t projectModified, const std::string& kind, StoredValue& value) {
+    auto found = entries.find(makeKey(projectPath, kind));
+    if (found == entries.end() || found->second.projectModified != projectModified) {
+        misses++;
+        return false;
+    }
+
+    Entry& entry = found->second;
+    if (entry.offset + entry.recordBytes > mappedBytes && !mapFile()) {
+        misses++;
+        return false; // Records put since the file was mapped need a new mapping
+    }
+
+    RecordHeader header;
+    memcpy(&header, mapping + entry.offset, sizeof(header));
+    const char* content = mapping + entry.offset + sizeof(RecordHeader);
+    if (!entry.verified) {
+        if (recordChecksum(content, (size_t)header.pathLength + header.kindLength + header.storedLength) != header.checksum) {
+            liveBytes -= entry.recordBytes;
+            entries.erase(found);
+            misses++;
+            return false;
+        }
+        entry.verified = true;
+    }
+
+    value.data = content + header.pathLength + header.kindLength;
+    value.storedLength = header.storedLength;
+    value.valueLength = header.valueLength;
+    value.compressed = (header.flags & RECORD_COMPRESSED) != 0;
+    hits++;
+    return true;
+}
+
+bool ResultCache::readValue(const StoredValue& value, char* dest) {
+    if (!value.compressed) {
+        memcpy(dest, value.data, value.valueLength);
+        return true;
+    }
+    return decompressBlock(value.data, value.storedLength, dest, value.valueLength);
+}
+
+long ResultCache::put(const std::string& projectPath, uint64_t projectModified, const std::string& kind, const char* value, size_t length) {
+    if (!isOpen()) {
+        return kESErrIO;
+    }
+    if (length > RESULT_CACHE_MAX_VALUE_BYTES || projectPath.size() > MAX_KEY_PART_BYTES || kind.size() > MAX_KEY_PART_BYTES) {
+        return kESErrRange;
+    }
+
+    // Only keep the compressed form when it saves at least an eighth
+    std::string compressed;
+    const char* stored = value;
+    size_t storedLength = length;
+    uint16_t flags = 0;
+    if (length >= COMPRESS_MIN_BYTES && compressBlock(value, length, compressed) < length - length / 8) {
+        stored = compressed.data();
+        storedLength = compressed.size();
+        flags |= RECORD_COMPRESSED;
+    }
+
+    const size_t contentBytes = projectPath.size() + kind.size() + storedLength;
+    const uint64_t recordBytes = alignRecord(sizeof(RecordHeader) + contentBytes);
+    std::string record((size_t)recordBytes, '\0');
+    char* content = &record[sizeof(RecordHeader)];
+    memcpy(content, projectPath.data(), projectPath.size());
+    memcpy(content + projectPath.size(), kind.data(), kind.size());
+    memcpy(content + projectPath.size() + kind.size(), stored, storedLength);
+
+    RecordHeader header = {};
+    header.magic = RECORD_MAGIC;
+    header.version = RECORD_VERSION;
+    header.flags = flags;
+    header.projectModified = projectModified;
+    header.pathLength = (uint32_t)projectPath.size();
+    header.kindLength = (uint32_t)kind.size();
+    header.storedLength = (uint32_t)storedLength;
+    header.valueLength = (uint32_t)length;
+    header.checksum = recordChecksum(content, contentBytes);
+    memcpy(&record[0], &header, sizeof(header));
+
+    // A failed write can leave part of the record past endOffset, which the next put overwrites
+    if (!writeAt(endOffset, record.data(), record.size())) {
+        return kESErrIO;
+    }
+
+    const std::string key = makeKey(projectPath, kind);
+    auto existing = entries.find(key);
+    if (existing != entries.end()) {
+        liveBytes -= existing->second.recordBytes;
+    }
+    entries[key] = Entry{ endOffset, projectModified, recordBytes, true };
+    liveBytes += recordBytes;
+    recordCount++;
+    endOffset += recordBytes;
+
+    if (endOffset > AUTO_COMPACT_MIN_BYTES && liveBytes < endOffset / 4) {
+        uint64_t bytesFreed;
+        compact(bytesFreed); // The new record is already written, so a failed compaction doesn't matter here
+    }
+    return kESErrOK;
+}
+
+long ResultCache::compact(uint64_t& bytesFreed) {
+    bytesFreed = 0;
+    if (!isOpen()) {
+        return kESErrIO;
+    }
+    if (endOffset > mappedBytes && !mapFile()) {
+        return kESErrIO;
+    }
+
+    // Keep records whose project file still has the same modification time, in their original order
+    std::unordered_map<std::string, uint64_t> projectTimes;
+    std::vector<const Entry*> kept;
+    for (auto& pair : entries) {
+        const std::string projectPath = pair.first.substr(0, pair.first.find('\0'));
+        auto time = projectTimes.find(projectPath);
+        if (time == projectTimes.end()) {
+            uint64_t modified = 0;
+            if (!getFileModifiedTime(projectPath.c_str(), modified)) modified = 0;
+            time = projectTimes.emplace(projectPath, modified).first;
+        }
+        if (time->second != 0 && time->second == pair.second.projectModified) {
+            kept.push_back(&pair.second);
+        }
+    }
+    std::sort(kept.begin(), kept.end(), [](const Entry* a, const Entry* b) { return a->offset < b->offset; });
+
+    // Records don't refer to their offsets, so they're copied across unchanged
+    const std::string compactPath = filePath + ".compact";
+    FILE* out = nullptr;
+    if (openUtf8File(compactPath, "wb", out) != kESErrOK) {
+        return kESErrIO;
+    }
+    FileHeader header = {};
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.formatVersion = FILE_FORMAT_VERSION;
+    bool failed = fwrite(&header, sizeof(header), 1, out) != 1;
+    uint64_t newBytes = sizeof(header);
+    for (size_t i = 0; i < kept.size() && !failed; i++) {
+        RecordHeader record;
+        memcpy(&record, mapping + kept[i]->offset, sizeof(record));
+        const char* content = mapping + kept[i]->offset + sizeof(RecordHeader);
+        if (!kept[i]->verified && recordChecksum(content, (size_t)record.pathLength + record.kindLength + record.storedLength) != record.checksum) {
+            continue; // Damaged, leave it behind
+        }
+        failed = fwrite(mapping + kept[i]->offset, 1, (size_t)kept[i]->recordBytes, out) != kept[i]->recordBytes;
+        newBytes += kept[i]->recordBytes;
+    }
+    failed |= fflush(out) != 0;
+    failed |= fclose(out) != 0;
+    if (failed) {
+        deleteFile(compactPath);
+        return kESErrIO;
+    }
+
+    // The file has to be closed to be replaced on Windows. Reopening reads the new one.
+    const std::string path = filePath;
+    const uint64_t oldBytes = endOffset;
+    const uint64_t keptHits = hits, keptMisses = misses;
+    close();
+    const bool replaced = replaceFile(compactPath, path);
+    if (!replaced) {
+        deleteFile(compactPath);
+    }
+    const long err = open(path);
+    hits = keptHits;
+    misses = keptMisses;
+    if (!replaced || err != kESErrOK) {
+        return kESErrIO;
+    }
+    bytesFreed = (oldBytes > newBytes) ? oldBytes - newBytes : 0;
+    return kESErrOK;
+}
+
+ResultCache::Info ResultCache::info() const {
+    Info result;
+    result.records = recordCount;
+    result.liveRecords = entries.size();
+    result.fileBytes = endOffset;
+    result.liveBytes = liveBytes;
+    result.hits = hits;
+    result.misses = misses;
+    return result;
+}
+
+// ------------------------------------------------------------------------------------------------
+// The cache scripts use, opened with cacheOpen
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+    std::mutex cacheMutex;
+    ResultCache cache;
+}
+
+void releaseResultCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.close();
+}
+
+// Reads the project path argument and the project file's modification time
+static long getProjectArg(const TaggedData& arg, std::string& projectPath, uint64_t& modified, bool& exists) {
+    if (arg.type != kTypeString) return kESErrTypeMismatch;
+    projectPath = arg.data.string;
+    exists = getFileModifiedTime(arg.data.string, modified);
+    return kESErrOK;
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Opens or creates the result cache file. Only one can be open, so this closes any other.
+ * @param argv JavaScript arguments. Expects the cache file's path.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. The number of results in the cache.
+ * @return kESErrOK on success, kESErrIO if the file can't be opened or another process has it open,
+ * or kESErrConversion if it isn't a cache file.
+ *
+ * JavaScript Usage: externalLibrary.cacheOpen(Folder.userData.fsName + "/ThioUtils/ResultCache.bin");
+ */
+THIO_EXPORT(cacheOpen)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    try {
+        const long err = cache.open(argv[0].data.string);
+        if (err != kESErrOK) return err;
+    }
+    catch (const std::bad_alloc&) {
+        cache.close();
+        return THIO_ERR_NO_MEMORY;
+    }
+    retval->type = kTypeInteger;
+    retval->data.intval = (long)cache.info().liveRecords;
+    return kESErrOK;
+}
+
+/**
+ * @brief Closes the result cache file.
+ * @param argv JavaScript arguments. None.
+ * @param argc Argument count. Should be 0.
+ * @param retval Return value. Undefined.
+ * @return kESErrOK.
+ *
+ * JavaScript Usage: externalLibrary.cacheClose();
+ */
+THIO_EXPORT(cacheClose)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.close();
+    return kESErrOK;
+}
+
+/**
+ * @brief Gets the result stored for a project and kind, if the project file hasn't been modified since it was stored.
+ * @param argv JavaScript arguments. Expects the project file's path and the kind.
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. The stored string, or null on a miss or if no cache is open.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var json = externalLibrary.cacheGet(app.project.path, "sequences");
+ */
+THIO_EXPORT(cacheGet)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[1].type != kTypeString) return kESErrTypeMismatch;
+
+    std::string projectPath;
+    uint64_t modified = 0;
+    bool exists = false;
+    long err = getProjectArg(argv[0], projectPath, modified, exists);
+    if (err != kESErrOK) return err;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    ResultCache::StoredValue value;
+    try {
+        if (!exists || !cache.isOpen() || !cache.find(projectPath, modified, argv[1].data.string, value)) {
+            return setScriptResult(retval, "null");
+        }
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+
+    // Straight from the mapping into the returned string
+    char* result = allocateResultMemory(value.valueLength + 1);
+    if (result == nullptr) return THIO_ERR_NO_MEMORY;
+    if (!ResultCache::readValue(value, result)) {
+        releaseResultMemory(result);
+        return setScriptResult(retval, "null");
+    }
+    result[value.valueLength] = '\0';
+    retval->type = kTypeString;
+    retval->data.string = result;
+    return kESErrOK;
+}
+
+/**
+ * @brief Stores a result for a project and kind, for the project file as it is now.
+ * @param argv JavaScript arguments. Expects the project file's path, the kind, and the string to store.
+ * @param argc Argument count. Should be 3.
+ * @param retval Return value. True if stored, false if no cache is open or the project file doesn't exist (e.g. it was never saved).
+ * @return kESErrOK on success, kESErrRange if the string is over 64 MB, or kESErrIO if writing failed.
+ *
+ * JavaScript Usage: externalLibrary.cachePut(app.project.path, "sequences", JSON.stringify(sequenceInfo));
+ */
+THIO_EXPORT(cachePut)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 3) return kESErrBadArgumentList;
+    if (argv[1].type != kTypeString || argv[2].type != kTypeString) return kESErrTypeMismatch;
+
+    std::string projectPath;
+    uint64_t modified = 0;
+    bool exists = false;
+    long err = getProjectArg(argv[0], projectPath, modified, exists);
+    if (err != kESErrOK) return err;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    bool stored = false;
+    if (exists && cache.isOpen()) {
+        try {
+            err = cache.put(projectPath, modified, argv[1].data.string, argv[2].data.string, strlen(argv[2].data.string));
+        }
+        catch (const std::bad_alloc&) {
+            return THIO_ERR_NO_MEMORY;
+        }
+        if (err != kESErrOK) return err;
+        stored = true;
+    }
+    retval->type = kTypeBool;
+    retval->data.intval = stored ? 1 : 0;
+    return kESErrOK;
+}
+
+/**
+ * @brief Rewrites the cache file without superseded results and results for projects that have changed since.
+ * Puts also do this on their own once most of the file is unused.
+ * @param argv JavaScript arguments. None.
+ * @param argc Argument count. Should be 0.
+ * @param retval Return value. The number of bytes freed.
+ * @return kESErrOK on success, or kESErrIO if no cache is open or the file couldn't be rewritten.
+ *
+ * JavaScript Usage: var bytesFreed = externalLibrary.cacheCompact();
+ */
+THIO_EXPORT(cacheCompact)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    uint64_t bytesFreed = 0;
+    try {
+        const long err = cache.compact(bytesFreed);
+        if (err != kESErrOK) return err;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+    retval->type = kTypeDouble;
+    retval->data.fltval = (double)bytesFreed;
+    return kESErrOK;
+}
+
+/**
+ * @brief Describes the open result cache.
+ * @param argv JavaScript arguments. None.
+ * @param argc Argument count. Should be 0.
+ * @param retval Return value. An object with path, records, liveRecords, fileBytes, liveBytes, hits and misses, or null if no cache is open.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var info = externalLibrary.cacheInfo();
+ */
+THIO_EXPORT(cacheInfo)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!cache.isOpen()) {
+        return setScriptResult(retval, "null");
+    }
+
+    const ResultCache::Info info = cache.info();
+    try {
+        std::string script = "({path:";
+        appendJsString(script, cache.path().c_str(), cache.path().size());
+        script += ",records:" + std::to_string(info.records);
+        script += ",liveRecords:" + std::to_string(info.liveRecords);
+        script += ",fileBytes:" + std::to_string(info.fileBytes);
+        script += ",liveBytes:" + std::to_string(info.liveBytes);
+        script += ",hits:" + std::to_string(info.hits);
+        script += ",misses:" + std::to_string(info.misses);
+        script += "})";
+        return setScriptResult(retval, script);
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+// ResultCache.h
+// Results that scripts computed from a project, kept in a file between runs so the next run can start warm.
+//
+// Each result is stored under (project file path, the project file's modification time, kind), where kind is any
+// name the script picks, like "sequences" or "resolutions". Saving the project changes its modification time, so
+// results from before the save are never returned for it again. The time is read from the file by the library,
+// scripts only pass the path.
+//
+// The file is append-only: a put writes one record at the end and never changes what's already there, so a crash can
+// at most leave a partial record at the end, which the next open cuts off. Reads come straight out of a read-only
+// memory mapping of the file. Records over COMPRESS_MIN_BYTES are compressed (BlockCompression.h) when that saves
+// space, and expand directly into the string returned to ExtendScript.
+//
+// Newer records for the same project and kind supersede older ones. compact() rewrites the file without superseded
+// records or ones for project versions that no longer exist, and puts do it on their own once most of the file is dead.
+//
+// File layout, little-endian:
+//      FileHeader                          magic "THIORC\r\n", format version
+//      Records, each 8 byte aligned:       RecordHeader, project path, kind, stored value
+// Every record has its own version and a checksum of everything after its header. Records from a newer version are
+// skipped rather than treated as corrupt, so an older library can still use the rest of the file.
+//
+// Only one process can have the file open at a time. Another Premiere or After Effects instance gets kESErrIO from
+// cacheOpen and should just run uncached.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#define RESULT_CACHE_MAX_VALUE_BYTES (64 * 1024 * 1024)
+#define COMPRESS_MIN_BYTES 256
+
+/**
+ * @brief Gets a file's last modification time, in the platform's units (100ns on Windows, ns elsewhere).
+ * @param path UTF-8, as ExtendScript passes it.
+ * @return false if the file doesn't exist or can't be read.
+ */
+bool getFileModifiedTime(const char* path, uint64_t& modified);
+
+class ResultCache {
+public:
+    struct Info {
+        size_t records = 0;         // Records in the file, including superseded ones
+        size_t liveRecords = 0;     // Latest record for each project and kind
+        uint64_t fileBytes = 0;
+        uint64_t liveBytes = 0;     // Bytes the live records take up
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    // A stored value inside the mapping. Only valid until the next put, compact or close.
+    struct StoredValue {
+        const char* data = nullptr;
+        size_t storedLength = 0;
+        size_t valueLength = 0;
+        bool compressed = false;
+    };
+
+    ResultCache() = default;
+    ~ResultCache();
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /**
+     * @brief Opens or creates a cache file, closing any that was open.
+     * @return kESErrOK, kESErrIO if it can't be opened (or another process has it), or kESErrConversion if it isn't a cache file.
+     */
+    long open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    /**
+     * @brief Finds the value stored for a project version and kind.
+     * @return false on a miss, including when the latest record is for a different modification time.
+     */
+    bool find(const std::string& projectPath, uint64_t projectModified, const std::string& kind, StoredValue& value);
+
+    /**
+     * @brief Expands a stored value into 'dest', which must have room for value.valueLength bytes.
+     * @return false if a compressed value is corrupt.
+     */
+    static bool readValue(const StoredValue& value, char* dest);
+
+    /**
+     * @brief Appends a value for a project version and kind, superseding any earlier one.
+     * @return kESErrOK, kESErrRange if the value is over RESULT_CACHE_MAX_VALUE_BYTES, or kESErrIO.
+     */
+    long put(const std::string& projectPath, uint64_t projectModified, const std::string& kind, const char* value, size_t length);
+
+    /**
+     * @brief Rewrites the file with only the live records whose project file still has the same modification time.
+     * @param bytesFreed How much smaller the file got.
+     * @return kESErrOK or kESErrIO. If the rewrite fails, the old file is kept.
+     */
+    long compact(uint64_t& bytesFreed);
+
+    Info info() const;
+    const std::string& path() const { return filePath; }
+
+private:
+    struct Entry {
+        uint64_t offset;            // Of the record header
+        uint64_t projectModified;
+        uint64_t recordBytes;       // Header, key and value, with padding
+        bool verified;              // Checksum already checked
+    };
+
+    std::string filePath;
+    std::unordered_map<std::string, Entry> entries; // By project path + '\0' + kind
+    uint64_t endOffset = 0;         // End of the last valid record, where the next one goes
+    size_t recordCount = 0;
+    uint64_t liveBytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // Platform file and mapping
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+    const char* mapping = nullptr;
+    uint64_t mappedBytes = 0;
+
+    bool openFile(const std::string& path);
+    void closeFile();
+    bool mapFile();
+    void unmapFile();
+    bool writeAt(uint64_t offset, const void* data, size_t length);
+    bool truncateTo(uint64_t length);
+
+    // Reads the records from 'offset' to the end of the mapping into 'entries', and stops at the first damaged one
+    void scanRecords(uint64_t offset);
+    long writeFileHeader();
+};
+
+// Closes the cache opened with cacheOpen. Called from ESTerminate.
+void releaseResultCache();
@@ -0,0 +1,351 @@
+#include "ResultMemory.h"
+#include "BatchCall.h"
+#include "Exports.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+// Size classes. Each has one static slab of blockCount blocks. The slabs are in the library's zero-initialized
+// data, so pages that are never used are never committed.
+// ------------------------------------------------------------------------------------------------
+
+struct SizeClass {
+    size_t blockSize;
+    size_t blockCount;
+};
+
+static const SizeClass sizeClasses[] = {
+    { 64,       128 },
+    { 256,      64 },
+    { 1024,     32 },
+    { 4096,     16 },
+    { 16384,    8 },
+    { 65536,    4 },
+};
+
+#define SIZE_CLASS_COUNT        (sizeof(sizeClasses) / sizeof(sizeClasses[0]))
+#define SLAB_TOTAL_BYTES        (64 * 128 + 256 * 64 + 1024 * 32 + 4096 * 16 + 16384 * 8 + 65536 * 4)
+#define MAX_BLOCKS_PER_CLASS    128
+#define INTERN_AREA_BYTES       4096
+
+namespace {
+    struct ResultPool {
+        std::mutex mutex;
+        bool initialized = false;
+        char* classBase[SIZE_CLASS_COUNT] = {};
+        uint16_t freeBlocks[SIZE_CLASS_COUNT][MAX_BLOCKS_PER_CLASS] = {}; // Stack of free block indexes per class
+        size_t freeCount[SIZE_CLASS_COUNT] = {};
+        size_t internUsed = 0;
+        ResultMemoryStats stats = {};
+    };
+
+    alignas(16) char slabMemory[SLAB_TOTAL_BYTES];
+    char internArea[INTERN_AREA_BYTES];
+    ResultPool pool;
+}
+
+// Requires the pool mutex to be held
+static void initializePool() {
+    char* base = slabMemory;
+    for (size_t c = 0; c < SIZE_CLASS_COUNT; c++) {
+        pool.classBase[c] = base;
+        // Pushed in reverse so blocks are handed out from the start of the slab first
+        for (size_t i = 0; i < sizeClasses[c].blockCount; i++) {
+            pool.freeBlocks[c][i] = (uint16_t)(sizeClasses[c].blockCount - 1 - i);
+        }
+        pool.freeCount[c] = sizeClasses[c].blockCount;
+        base += sizeClasses[c].blockSize * sizeClasses[c].blockCount;
+    }
+    pool.initialized = true;
+}
+
+char* allocateResultMemory(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.initialized) {
+            initializePool();
+        }
+        for (size_t c = 0; c < SIZE_CLASS_COUNT; c++) {
+            if (bytes <= sizeClasses[c].blockSize) {
+                if (pool.freeCount[c] == 0) {
+                    break; // Slab is full, use the heap rather than a bigger class
+                }
+                const uint16_t index = pool.freeBlocks[c][--pool.freeCount[c]];
+                pool.stats.pooledAllocations++;
+                return pool.classBase[c] + (size_t)index * sizeClasses[c].blockSize;
+            }
+        }
+        pool.stats.heapAllocations++;
+    }
+    return static_cast<char*>(malloc(bytes));
+}
+
+void releaseResultMemory(void* p) {
+    if (p == nullptr) {
+        return;
+    }
+
+    // Compared as integers, since comparing pointers into different objects isn't defined
+    const uintptr_t value = reinterpret_cast<uintptr_t>(p);
+    const uintptr_t internStart = reinterpret_cast<uintptr_t>(internArea);
+    if (value >= internStart && value < internStart + INTERN_AREA_BYTES) {
+        return; // Interned, never freed
+    }
+
+    const uintptr_t slabStart = reinterpret_cast<uintptr_t>(slabMemory);
+    if (value >= slabStart && value < slabStart + SLAB_TOTAL_BYTES) {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        for (size_t c = 0; c < SIZE_CLASS_COUNT; c++) {
+            const uintptr_t classStart = reinterpret_cast<uintptr_t>(pool.classBase[c]);
+            const size_t classBytes = sizeClasses[c].blockSize * sizeClasses[c].blockCount;
+            if (value >= classStart && value < classStart + classBytes) {
+                pool.freeBlocks[c][pool.freeCount[c]++] = (uint16_t)((value - classStart) / sizeClasses[c].blockSize);
+                return;
+            }
+        }
+        return;
+    }
+
+    free(p);
+}
+
+const char* internResultString(const char* str) {
+    const size_t length = strlen(str);
+    std::lock_guard<std::mutex> lock(pool.mutex);
+
+    // Already interned?
+    for (size_t offset = 0; offset < pool.internUsed; offset += strlen(internArea + offset) + 1) {
+        if (strcmp(internArea + offset, str) == 0) {
+            return internArea + offset;
+        }
+    }
+
+    if (pool.internUsed + length + 1 > INTERN_AREA_BYTES) {
+        return nullptr;
+    }
+    char* copy = internArea + pool.internUsed;
+    memcpy(copy, str, length + 1);
+    pool.internUsed += length + 1;
+    return copy;
+}
+
+long setInternedStringResult(TaggedData* retval, const char* str) {
+    const char* interned = internResultString(str);
+    if (interned != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            pool.stats.internedReturns++;
+        }
+        retval->type = kTypeString;
+        retval->data.string = const_cast<char*>(interned); // ExtendScript only reads it, then passes it to ESFreeMem which ignores it
+        return kESErrOK;
+    }
+
+    char* copy = allocateResultMemory(strlen(str) + 1);
+    if (copy == nullptr) {
+        retval->type = kTypeUndefined;
+        return THIO_ERR_NO_MEMORY;
+    }
+    memcpy(copy, str, strlen(str) + 1);
+    retval->type = kTypeString;
+    retval->data.string = copy;
+    return kESErrOK;
+}
+
+ResultMemoryStats getResultMemoryStats() {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.stats;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Chunked results
+// ------------------------------------------------------------------------------------------------
+
+// Largest chunk handed back in one readResultChunk call. Fits the biggest pooled size class with its terminator.
+#define RESULT_CHUNK_BYTES      65535
+// Results held at once. Starting another one past this releases the oldest.
+#define MAX_CHUNKED_RESULTS     8
+
+namespace {
+    struct ChunkedResult {
+        char* data = nullptr;           // The function's own result buffer, released through ESFreeMem
+        size_t length = 0;
+        bool isScript = false;
+        std::vector<size_t> chunkStarts;// Offset of each chunk. Chunks never split a UTF-8 character.
+    };
+
+    std::mutex chunkedMutex;
+    std::map<long, ChunkedResult> chunkedResults;
+    long lastChunkedHandle = 0;
+}
+
+// Requires chunkedMutex to be held
+static void releaseChunkedResult(std::map<long, ChunkedResult>::iterator it) {
+    ESFreeMem(it->second.data);
+    chunkedResults.erase(it);
+}
+
+void releaseChunkedResults() {
+    std::lock_guard<std::mutex> lock(chunkedMutex);
+    while (!chunkedResults.empty()) {
+        releaseChunkedResult(chunkedResults.begin());
+    }
+}
+
+// Splits a result into chunk offsets, moving each boundary back to the start of a UTF-8 character if needed
+static void splitIntoChunks(const char* data, size_t length, std::vector<size_t>& chunkStarts) {
+    size_t start = 0;
+    while (start < length) {
+        chunkStarts.push_back(start);
+        size_t end = start + RESULT_CHUNK_BYTES;
+        if (end >= length) {
+            break;
+        }
+        while (end > start + 1 && (static_cast<unsigned char>(data[end]) & 0xC0) == 0x80) {
+            end--; // Continuation byte, back up to the lead byte
+        }
+        start = end;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Functions ------------------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Calls another export and keeps its string result in native memory, to be read in pieces with readResultChunk.
+ * Use this for functions that can return many megabytes, so the script can process or write out the result as it goes.
+ * @param argv JavaScript arguments. Expects one string, a single command in the callBatch format (see BatchCall.cpp).
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. A script that evaluates to {handle, length, chunkCount, isScript}. If the function
+ *               didn't return a string, handle and chunkCount are 0 and the value is returned directly as 'value'.
+ * @return The called function's error code, or an error code if it couldn't be called.
+ *
+ * JavaScript Usage: var info = externalLibrary.callChunked("ticksToTimecodeBatch\ts0,254016000000\ts8475667200\tb0");
+ */
+THIO_EXPORT(callChunked)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+
+    TaggedData result;
+    const long err = runCommand(argv[0].data.string, result);
+    const bool isString = (result.type == kTypeString || result.type == kTypeScript) && result.data.string != nullptr;
+    if (err != kESErrOK) {
+        if (isString) ESFreeMem(result.data.string);
+        return err;
+    }
+
+    if (!isString) {
+        std::string script = "({handle:0,length:0,chunkCount:0,isScript:false,value:";
+        appendBatchResult(script, result);
+        script += "})";
+        return setScriptResult(retval, script);
+    }
+
+    std::string script;
+    try {
+        ChunkedResult chunked;
+        chunked.data = result.data.string;
+        chunked.length = strlen(result.data.string);
+        chunked.isScript = (result.type == kTypeScript);
+        splitIntoChunks(chunked.data, chunked.length, chunked.chunkStarts);
+
+        std::lock_guard<std::mutex> lock(chunkedMutex);
+        if (chunkedResults.size() >= MAX_CHUNKED_RESULTS) {
+            releaseChunkedResult(chunkedResults.begin());
+        }
+        const long handle = ++lastChunkedHandle;
+
+        script = "({handle:";
+        appendJsNumber(script, (double)handle);
+        script += ",length:";
+        appendJsNumber(script, (double)chunked.length);
+        script += ",chunkCount:";
+        appendJsNumber(script, (double)chunked.chunkStarts.size());
+        script += chunked.isScript ? ",isScript:true})" : ",isScript:false})";
+
+        chunkedResults[handle] = std::move(chunked);
+    }
+    catch (const std::bad_alloc&) {
+        ESFreeMem(result.data.string);
+        return THIO_ERR_NO_MEMORY;
+    }
+    return setScriptResult(retval, script);
+}
+
+/**
+ * @brief Returns one chunk of a result held by callChunked. Reading the last chunk releases the result.
+ * @param argv JavaScript arguments. Expects the handle and the chunk index (starting at 0).
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. The chunk as a string.
+ * @return kESErrOK on success, kESErrRange for an unknown handle or an index out of range.
+ *
+ * JavaScript Usage: var text = ""; for (var i = 0; i < info.chunkCount; i++) { text += externalLibrary.readResultChunk(info.handle, i); }
+ */
+THIO_EXPORT(readResultChunk)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeInteger || argv[1].type != kTypeInteger) return kESErrTypeMismatch;
+
+    std::lock_guard<std::mutex> lock(chunkedMutex);
+    auto it = chunkedResults.find(argv[0].data.intval);
+    const long index = argv[1].data.intval;
+    if (it == chunkedResults.end() || index < 0 || (size_t)index >= it->second.chunkStarts.size()) {
+        return kESErrRange;
+    }
+
+    const ChunkedResult& chunked = it->second;
+    const size_t start = chunked.chunkStarts[index];
+    const size_t end = ((size_t)index + 1 < chunked.chunkStarts.size()) ? chunked.chunkStarts[index + 1] : chunked.length;
+
+    char* chunk = allocateResultMemory(end - start + 1);
+    if (chunk == nullptr) return THIO_ERR_NO_MEMORY;
+    memcpy(chunk, chunked.data + start, end - start);
+    chunk[end - start] = '\0';
+
+    if ((size_t)index + 1 == chunked.chunkStarts.size()) {
+        releaseChunkedResult(it);
+    }
+
+    retval->type = kTypeString;
+    retval->data.string = chunk;
+    return kESErrOK;
+}
+
+/**
+ * @brief Releases a result held by callChunked without reading the rest of it.
+ * @param argv JavaScript arguments. Expects the handle.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. True if the handle was still held.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: externalLibrary.releaseResult(info.handle);
+ */
+THIO_EXPORT(releaseResult)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeInteger) return kESErrTypeMismatch;
+
+    std::lock_guard<std::mutex> lock(chunkedMutex);
+    auto it = chunkedResults.find(argv[0].data.intval);
+    const bool found = (it != chunkedResults.end());
+    if (found) {
+        releaseChunkedResult(it);
+    }
+
+    retval->type = kTypeBool;
+    retval->data.intval = found ? 1 : 0;
+    return kESErrOK;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// ResultMemory.h
+// Memory for strings returned to ExtendScript.
+//
+// ExtendScript hands every returned string back to ESFreeMem once it has copied it, so a plain malloc/free per
+// call adds up in loops. Instead:
+//      - Small and medium results come from one fixed (static) slab per size class, and ESFreeMem puts them back on
+//        that class's free list. A pointer is recognized as pooled by its address alone, so anything else that reaches
+//        ESFreeMem (e.g. malloc'd memory) is still just freed.
+//      - Constant strings can be interned once and returned without copying. ESFreeMem ignores them.
+//      - Results too big for the largest class fall back to malloc, as do pooled classes once their slab is full.
+//      - Multi-megabyte results can be fetched in pieces with callChunked / readResultChunk, so ExtendScript never
+//        has to take the whole thing as one string. The result buffer is kept as-is and each chunk is copied out
+//        into pooled memory.
+//
+// LiveObject results don't use this, see LiveObjects.h.
+
+#include "SoSharedLibDefs.h"
+#include <cstddef>
+
+struct ResultMemoryStats {
+    unsigned long long pooledAllocations;   // Served from a slab
+    unsigned long long heapAllocations;     // Too big, or the slab was full
+    unsigned long long internedReturns;     // Constant strings returned without a copy
+};
+
+/**
+ * @brief Allocates a buffer for a string that will be returned to ExtendScript and released through ESFreeMem.
+ * @return nullptr if out of memory.
+ */
+char* allocateResultMemory(size_t bytes);
+
+/**
+ * @brief Releases a buffer from allocateResultMemory. Interned strings are ignored, and unknown pointers are passed to free().
+ * This is what ESFreeMem calls.
+ */
+void releaseResultMemory(void* p);
+
+/**
+ * @brief Returns a permanent copy of a constant string that can be returned on every call without allocating.
+ * Meant for a handful of fixed strings like the version, not for arbitrary text.
+ * @return nullptr if the intern area is full, in which case copy the string normally.
+ */
+const char* internResultString(const char* str);
+
+// Sets retval to an interned string, or a normal copy if it couldn't be interned. Returns kESErrOK or THIO_ERR_NO_MEMORY.
+long setInternedStringResult(TaggedData* retval, const char* str);
+
+ResultMemoryStats getResultMemoryStats();
+
+// Frees results still held for chunked reading. Called from ESTerminate.
+void releaseChunkedResults();
@@ -0,0 +1,301 @@
+#include "ScriptBundle.h"
+#include "Exports.h"
+#include "PackedData.h"
+#include "ResultCache.h"    // For getFileModifiedTime
+#include "ResultMemory.h"
+#include "TextEncoding.h"
+#include "ThioUtils.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>              // For std::bad_alloc
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct SourceFile {
+    uint64_t modified = 0;
+    std::shared_ptr<const std::string> text;    // Without a byte order mark, which would be a syntax error mid-bundle
+};
+
+// A file in a bundle, and the modification time it had when the bundle was made
+struct BundleFile {
+    std::string path;
+    uint64_t modified;
+};
+
+struct Bundle {
+    std::vector<BundleFile> files;      // Nested includes too
+    std::shared_ptr<const IncludeBundle> source;
+};
+
+std::mutex cacheMutex;
+std::unordered_map<std::string, SourceFile> sourceFiles;    // By path
+std::unordered_map<std::string, Bundle> bundles;            // By folder and names
+std::unordered_map<std::string, std::string> foundPaths;    // Where each name was found, by folder and name
+
+// Gets a file's source from the cache, or reads it if it's new or its modification time changed
+long loadSourceFile(const std::string& path, uint64_t modified, std::shared_ptr<const std::string>& text) {
+    auto found = sourceFiles.find(path);
+    if (found != sourceFiles.end() && found->second.modified == modified) {
+        text = found->second.text;
+        return kESErrOK;
+    }
+
+    std::string contents;
+    const long err = readUtf8File(path, contents);
+    if (err != kESErrOK) return err;
+    if (contents.compare(0, 3, "\xEF\xBB\xBF") == 0) contents.erase(0, 3);
+    text = std::make_shared<const std::string>(std::move(contents));
+    sourceFiles[path] = SourceFile{ modified, text };
+    return kESErrOK;
+}
+
+bool isAbsolutePath(const std::string& path) {
+    if (!path.empty() && (path[0] == '/' || path[0] == '\\' || path[0] == '~')) return true;
+    return path.size() >= 2 && path[1] == ':'; // Drive letter
+}
+
+std::string folderOf(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return (slash == std::string::npos) ? std::string(".") : path.substr(0, slash);
+}
+
+// Checks whether a line is an #include or //@include directive, and gets the name it includes.
+// Other directives (#target, #includepath, ...) are left in the source for eval to handle as usual.
+bool parseIncludeLine(const char* line, const char* end, std::string& name) {
+    const char* p = line;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (end - p >= 8 && memcmp(p, "#include", 8) == 0) p += 8;
+    else if (end - p >= 10 && memcmp(p, "//@include", 10) == 0) p += 10;
+    else return false;
+
+    if (p >= end || (*p != ' ' && *p != '\t')) return false; // #includepath
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p >= end || (*p != '"' && *p != '\'')) return false;
+    const char quote = *p++;
+    const char* nameEnd = static_cast<const char*>(memchr(p, quote, end - p));
+    if (nameEnd == nullptr || nameEnd == p) return false;
+    name.assign(p, nameEnd);
+    return true;
+}
+
+// Where the line starts if the '#' or '@' at 'mark' can begin an include directive: "#" or "//@" with nothing but
+// indentation before it. nullptr otherwise.
+const char* directiveLineStart(const char* begin, const char* mark) {
+    const char* line = mark;
+    if (*mark == '@') {
+        if (mark - begin < 2 || mark[-1] != '/' || mark[-2] != '/') return nullptr;
+        line = mark - 2;
+    }
+    while (line > begin && (line[-1] == ' ' || line[-1] == '\t')) line--;
+    return (line == begin || line[-1] == '\n') ? line : nullptr;
+}
+
+void appendRun(IncludeBundle& out, const std::shared_ptr<const std::string>& text, size_t offset, size_t length) {
+    if (length == 0) return;
+    out.runs.push_back(IncludeBundle::Run{ text, offset, length });
+    out.length += length;
+}
+
+void appendLine(IncludeBundle& out, const std::shared_ptr<const std::string>& line) {
+    appendRun(out, line, 0, line->size());
+}
+
+void appendPathLine(IncludeBundle& out, const std::string& path) {
+    std::string line = "$.global.thioIncludePath = ";
+    appendJsString(line, path.c_str(), path.size());
+    line += ";\n";
+    appendLine(out, std::make_shared<const std::string>(std::move(line)));
+}
+
+// Appends a file with its includes inlined. 'including' holds the files being appended further up, so a file that
+// includes itself, directly or not, is left out the second time instead of recursing forever.
+long appendFile(const std::string& path, uint64_t modified, Bundle& bundle, IncludeBundle& out, std::vector<std::string>& including) {
+    for (const std::string& open : including) {
+        if (open == path) return kESErrOK;
+    }
+    if (including.size() >= MAX_INCLUDE_DEPTH) return kESErrRange;
+
+    std::shared_ptr<const std::string> text;
+    long err = loadSourceFile(path, modified, text);
+    if (err != kESErrOK) return err;
+    bundle.files.push_back(BundleFile{ path, modified });
+    including.push_back(path);
+    appendPathLine(out, path);
+
+    // Takes the source in runs, stopping only at lines that start with an include directive. Rather than going through
+    // the source line by line, it jumps between the '#' and '@' characters that start one, which memchr finds quickly and
+    // which are rare in scripts.
+    const char* const begin = text->data();
+    const char* const end = begin + text->size();
+    const char* copied = begin;
+    std::string name;
+    const char* nextHash = static_cast<const char*>(memchr(begin, '#', end - begin));
+    const char* nextAt = static_cast<const char*>(memchr(begin, '@', end - begin));
+    while (nextHash != nullptr || nextAt != nullptr) {
+        const char* const mark = (nextAt == nullptr || (nextHash != nullptr && nextHash < nextAt)) ? nextHash : nextAt;
+        const char* from = mark + 1;
+        const char* const line = directiveLineStart(begin, mark);
+        const char* lineEnd = (line != nullptr) ? static_cast<const char*>(memchr(mark, '\n', end - mark)) : nullptr;
+        if (line != nullptr && lineEnd == nullptr) lineEnd = end;
+
+        if (line != nullptr && parseIncludeLine(line, lineEnd, name)) {
+            appendRun(out, text, copied - begin, line - copied);
+            const std::string nestedPath = isAbsolutePath(name) ? name : folderOf(path) + "/" + name;
+            uint64_t nestedModified = 0;
+            if (!getFileModifiedTime(nestedPath.c_str(), nestedModified)) return kESErrNoFile;
+            err = appendFile(nestedPath, nestedModified, bundle, out, including);
+            if (err != kESErrOK) return err;
+            appendPathLine(out, path); // Back in this file
+            copied = (lineEnd < end) ? lineEnd + 1 : end;
+            from = copied;
+        }
+        if (nextHash != nullptr && nextHash < from) nextHash = static_cast<const char*>(memchr(from, '#', end - from));
+        if (nextAt != nullptr && nextAt < from) nextAt = static_cast<const char*>(memchr(from, '@', end - from));
+    }
+    appendRun(out, text, copied - begin, end - copied);
+    const IncludeBundle::Run& last = out.runs.back();
+    if ((*last.text)[last.offset + last.length - 1] != '\n') {
+        static const std::shared_ptr<const std::string> lineBreak = std::make_shared<const std::string>("\n");
+        appendLine(out, lineBreak);
+    }
+    including.pop_back();
+    return kESErrOK;
+}
+
+// True if every file in the bundle still has the modification time it was made with
+bool isBundleCurrent(const Bundle& bundle) {
+    for (const BundleFile& file : bundle.files) {
+        uint64_t modified = 0;
+        if (!getFileModifiedTime(file.path.c_str(), modified) || modified != file.modified) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+long buildIncludeBundle(const std::string& folder, const std::string& names, std::shared_ptr<const IncludeBundle>& bundle) {
+    std::string key;
+    key.reserve(folder.size() + 1 + names.size());
+    key += folder;
+    key += '\0';
+    key += names;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto found = bundles.find(key);
+    if (found != bundles.end() && isBundleCurrent(found->second)) {
+        bundle = found->second.source;
+        return kESErrOK;
+    }
+
+    static const char* const searchFolders[] = INCLUDE_SEARCH_FOLDERS;
+    Bundle made;
+    std::shared_ptr<IncludeBundle> out = std::make_shared<IncludeBundle>();
+    std::vector<std::string> including;
+    size_t start = 0;
+    while (start < names.size()) {
+        size_t nameEnd = names.find('\n', start);
+        if (nameEnd == std::string::npos) nameEnd = names.size();
+        const std::string name = names.substr(start, nameEnd - start);
+        start = nameEnd + 1;
+        if (name.empty()) continue;
+
+        // A name found before, e.g. for another list of names, takes one stat instead of one per folder it isn't in
+        std::string path;
+        uint64_t modified = 0;
+        bool exists = false;
+        const std::string nameKey = folder + '\0' + name;
+        auto known = foundPaths.find(nameKey);
+        if (known != foundPaths.end() && getFileModifiedTime(known->second.c_str(), modified)) {
+            path = known->second;
+            exists = true;
+        }
+        for (size_t i = 0; !exists && i < sizeof(searchFolders) / sizeof(searchFolders[0]); i++) {
+            path = folder + "/" + searchFolders[i] + name;
+            exists = getFileModifiedTime(path.c_str(), modified);
+        }
+        if (!exists) return kESErrNoFile;
+        foundPaths[nameKey] = path;
+
+        const long err = appendFile(path, modified, made, *out, including);
+        if (err != kESErrOK) return err;
+    }
+    static const std::shared_ptr<const std::string> endLine = std::make_shared<const std::string>("$.global.thioIncludePath = undefined;\n");
+    appendLine(*out, endLine);
+
+    made.source = out;
+    bundle = made.source;
+    bundles[key] = std::move(made);
+    return kESErrOK;
+}
+
+void IncludeBundle::copyTo(char* out) const {
+    for (const Run& run : runs) {
+        memcpy(out, run.text->data() + run.offset, run.length);
+        out += run.length;
+    }
+}
+
+size_t releaseIncludeCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    const size_t files = sourceFiles.size();
+    sourceFiles.clear();
+    bundles.clear();
+    foundPaths.clear();
+    return files;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Exports
+// ------------------------------------------------------------------------------------------------
+
+/**
+ * @brief Gets the scripts a script includes as one source to eval, searching for each one like includeFile in
+ *        ThioUtils.jsx does, and reading only files that changed since the last call. See ScriptBundle.h.
+ * @param argv[0] (String) The calling script's folder, as File.fsName gives it.
+ * @param argv[1] (String) File names separated by "\n".
+ * @return kESErrOK with the source in retval (String; eval it in the global scope), kESErrNoFile if a file wasn't found,
+ *         kESErrIO if one couldn't be read, or THIO_ERR_NO_MEMORY.
+ *
+ * JavaScript Usage: eval(externalLibrary.getIncludeBundle(File($.fileName).parent.fsName, "ThioUtilsLib.jsx\nes5-shim.js"));
+ */
+THIO_EXPORT(getIncludeBundle)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc < 2 || argv[0].type != kTypeString || argv[1].type != kTypeString) {
+        return kESErrBadArgumentList;
+    }
+
+    try {
+        // Kept text is shared, so the only copy made is the one ExtendScript gets, straight from the files' text
+        std::shared_ptr<const IncludeBundle> bundle;
+        const long err = buildIncludeBundle(argv[0].data.string, argv[1].data.string, bundle);
+        if (err != kESErrOK) return err;
+        char* source = allocateResultMemory(bundle->length + 1);
+        if (source == nullptr) return THIO_ERR_NO_MEMORY;
+        bundle->copyTo(source);
+        source[bundle->length] = '\0';
+        retval->type = kTypeString;
+        retval->data.string = source;
+        return kESErrOK;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+/**
+ * @brief Forgets the files and bundles getIncludeBundle kept, so the next call searches for and reads everything again.
+ * @param result Receives the number of files that were kept.
+ * @return kESErrOK.
+ *
+ * JavaScript Usage: externalLibrary.clearIncludeCache();
+ */
+long clearIncludeCacheTyped(long& result) {
+    result = (long)releaseIncludeCache();
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(clearIncludeCache, clearIncludeCacheTyped)
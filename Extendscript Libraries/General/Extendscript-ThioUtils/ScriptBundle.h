@@ -0,0 +1,56 @@
+#pragma once
+
+// ScriptBundle.h
+// Script files that the library reads once per session, so a script can get all of its includes in one call.
+//
+// ThioUtils.jsx finds each file it includes by checking up to five folders with File.exists, then evals an #include of
+// it, so every run has ExtendScript search for, read and preprocess the same files again. getIncludeBundle does the
+// search natively (the folders in INCLUDE_SEARCH_FOLDERS, in includeFile's order), inlines the #include and //@include
+// lines of the files it finds, and returns all of them as one source for a single eval.
+//
+// File contents are kept by path together with the file's modification time, and each finished bundle together with
+// the modification times of every file in it. A repeated call only compares those times, and rereads just the files
+// that changed. A bundle doesn't keep a joined copy of its source, only runs of the kept files' text and the lines it
+// adds between them, which are copied straight into the string returned to ExtendScript. The folder a file was found
+// in is kept too, also for other lists of names, so a copy that later appears in a folder searched earlier isn't used
+// until the cache is cleared (clearIncludeCache) or the library is reloaded.
+//
+// Before each file's source the bundle sets $.global.thioIncludePath to that file's path, which is what $.fileName
+// would have been had the file been included on its own. ThioUtilsLib.jsx uses it to find ThioUtils.dll next to it.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Where a name is looked for, relative to the calling script's folder, in order. Same as includeFile in ThioUtils.jsx.
+#define INCLUDE_SEARCH_FOLDERS { "", "includes/", "include/", "../", "../includes/" }
+
+// Nested includes deeper than this are taken to be a loop that the path check didn't catch, e.g. through links
+#define MAX_INCLUDE_DEPTH 32
+
+// A bundle's source, as the runs of text it's made of
+struct IncludeBundle {
+    struct Run {
+        std::shared_ptr<const std::string> text;    // A kept file's source, or a line the bundle adds
+        size_t offset;
+        size_t length;
+    };
+    std::vector<Run> runs;
+    size_t length = 0;      // Of all the runs together
+
+    // Copies the source to 'out', which must have room for 'length' bytes
+    void copyTo(char* out) const;
+};
+
+/**
+ * @brief Finds, reads and joins script files, from the cache where the files haven't changed.
+ * @param folder The calling script's folder (File.fsName), UTF-8.
+ * @param names File names separated by "\n", each searched for in INCLUDE_SEARCH_FOLDERS.
+ * @param bundle Receives the source, shared with the cache.
+ * @return kESErrOK, kESErrNoFile if a file or one it includes wasn't found, kESErrIO if one couldn't be read, or
+ *         kESErrRange if includes nest deeper than MAX_INCLUDE_DEPTH.
+ */
+long buildIncludeBundle(const std::string& folder, const std::string& names, std::shared_ptr<const IncludeBundle>& bundle);
+
+// Forgets every kept file and bundle, and returns how many files there were. Also called from ESTerminate.
+size_t releaseIncludeCache();
@@ -0,0 +1,356 @@
+#include "SessionStore.h"
+#include "Exports.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include <cmath>
+#include <cstdint>
+#include <iterator>   // For std::prev, std::next
+#include <new>        // For std::bad_alloc
+
+// Estimated bytes an entry costs besides its key and value: the list node, the index node and the allocator's share
+#define SESSION_ENTRY_OVERHEAD 160
+
+// ------------------------------------------------------------------------------------------------
+// Store
+// ------------------------------------------------------------------------------------------------
+
+static size_t valueBytes(const SessionStore::Value& value) {
+    if (value.type != SessionStore::kSessionBuffer || value.buffer == nullptr) return value.text.size();
+    const size_t elementBytes = (value.buffer->type() == NativeBuffer::kInt32) ? 4 : 8;
+    return value.buffer->size() * elementBytes;
+}
+
+void SessionStore::erase(EntryList::iterator it) {
+    totalBytes -= it->bytes;
+    index.erase(it->key);
+    entries.erase(it);
+}
+
+void SessionStore::evictToLimit(Clock::time_point now) {
+    while (totalBytes > limit && !entries.empty()) {
+        auto last = std::prev(entries.end());
+        if (last->expires <= now) expired++;
+        else evicted++;
+        erase(last);
+    }
+}
+
+bool SessionStore::set(const std::string& key, Value value, double ttlSeconds, Clock::time_point now) {
+    const size_t bytes = 2 * key.size() + valueBytes(value) + SESSION_ENTRY_OVERHEAD; // The index keeps its own copy of the key
+    Clock::time_point expires = Clock::time_point::max();
+    if (ttlSeconds > 0) {
+        const double maxSeconds = std::chrono::duration<double>(Clock::time_point::max() - now).count();
+        if (ttlSeconds < maxSeconds) {
+            expires = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(ttlSeconds));
+        }
+    }
+    ValuePointer stored = std::make_shared<const Value>(std::move(value));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found != index.end()) erase(found->second);
+    if (bytes > limit) return false;
+
+    entries.push_front(Entry{ key, std::move(stored), bytes, expires });
+    try {
+        index.emplace(key, entries.begin());
+    }
+    catch (...) {
+        entries.pop_front();
+        throw;
+    }
+    totalBytes += bytes;
+    evictToLimit(now);
+    return true;
+}
+
+SessionStore::ValuePointer SessionStore::get(const std::string& key, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        misses++;
+        return nullptr;
+    }
+    if (found->second->expires <= now) {
+        erase(found->second);
+        expired++;
+        misses++;
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, found->second);
+    hits++;
+    return found->second->value;
+}
+
+bool SessionStore::remove(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) return false;
+    erase(found->second);
+    return true;
+}
+
+size_t SessionStore::clear(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (prefix.empty()) {
+        const size_t count = entries.size();
+        entries.clear();
+        index.clear();
+        totalBytes = 0;
+        return count;
+    }
+    size_t count = 0;
+    for (auto it = entries.begin(); it != entries.end();) {
+        auto next = std::next(it);
+        if (it->key.compare(0, prefix.size(), prefix) == 0) {
+            erase(it);
+            count++;
+        }
+        it = next;
+    }
+    return count;
+}
+
+size_t SessionStore::setLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t previous = limit;
+    limit = bytes;
+    evictToLimit(Clock::now());
+    return previous;
+}
+
+SessionStore::Info SessionStore::info(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end();) {
+        auto next = std::next(it);
+        if (it->expires <= now) {
+            erase(it);
+            expired++;
+        }
+        it = next;
+    }
+
+    Info result;
+    result.entries = entries.size();
+    result.bytes = totalBytes;
+    result.limit = limit;
+    result.hits = hits;
+    result.misses = misses;
+    result.expired = expired;
+    result.evicted = evicted;
+    return result;
+}
+
+void SessionStore::resetCounters() {
+    std::lock_guard<std::mutex> lock(mutex);
+    hits = misses = expired = evicted = 0;
+}
+
+SessionStore& getSessionStore() {
+    static SessionStore store;
+    return store;
+}
+
+void releaseSessionStore() {
+    getSessionStore().clear("");
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Stores a value in the session store, where later script runs can get it until the app quits. See SessionStore.h.
+ * @param argv[0] (String) The key. Any text, e.g. "resolutions/" + projectPath, so related keys can be cleared by prefix.
+ * @param argv[1] (Any) A string, number, boolean or NativeBuffer. A buffer's elements are copied.
+ * @param argv[2] (Number) Seconds until the key expires, or 0 to keep it until it's evicted.
+ * @param retval (Output) Boolean: false if the value alone is over the store's memory limit, and wasn't stored.
+ * @return kESErrOK on success, kESErrBadArgumentList for the wrong number of arguments, or kESErrTypeMismatch for a value
+ *         of another type.
+ *
+ * JavaScript Usage: externalLibrary.sessionSet("sequenceNames", names.join("\n"), 600);
+ */
+THIO_EXPORT(sessionSet)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 3) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString || argv[0].data.string == nullptr) return kESErrTypeMismatch;
+
+    double ttlSeconds = 0;
+    if (argv[2].type == kTypeDouble) ttlSeconds = argv[2].data.fltval;
+    else if (argv[2].type == kTypeInteger || argv[2].type == kTypeUInteger) ttlSeconds = (double)argv[2].data.intval;
+    else return kESErrTypeMismatch;
+
+    try {
+        SessionStore::Value value;
+        const TaggedData& arg = argv[1];
+        if (arg.type == kTypeString) {
+            if (arg.data.string == nullptr) return kESErrBadArgumentList;
+            value.type = SessionStore::kSessionString;
+            value.text = arg.data.string;
+        }
+        else if (arg.type == kTypeDouble || arg.type == kTypeInteger || arg.type == kTypeUInteger) {
+            value.type = SessionStore::kSessionNumber;
+            value.number = (arg.type == kTypeDouble) ? arg.data.fltval
+                : (arg.type == kTypeInteger) ? (double)arg.data.intval : (double)(unsigned long)arg.data.intval;
+        }
+        else if (arg.type == kTypeBool) {
+            value.type = SessionStore::kSessionBool;
+            value.boolean = arg.data.intval != 0;
+        }
+        else if (const NativeBuffer* buffer = getNativeBufferArg(arg)) {
+            value.type = SessionStore::kSessionBuffer;
+            value.buffer = std::make_shared<const NativeBuffer>(*buffer);
+        }
+        else {
+            return kESErrTypeMismatch;
+        }
+
+        const bool stored = getSessionStore().set(argv[0].data.string, std::move(value), ttlSeconds);
+        retval->type = kTypeBool;
+        retval->data.intval = stored ? 1 : 0;
+        return kESErrOK;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+/**
+ * @brief Gets a value from the session store, as the type it was stored as.
+ * @param argv[0] (String) The key.
+ * @param retval (Output) The string, number or boolean. A NativeBuffer's elements come back as an array (i64 elements
+ *        as strings), or use sessionGetBuffer to fill a buffer instead. Undefined if the key is missing or expired.
+ * @return kESErrOK on success, kESErrBadArgumentList for the wrong number of arguments, or kESErrTypeMismatch for a
+ *         key that isn't a string.
+ *
+ * JavaScript Usage: var names = externalLibrary.sessionGet("sequenceNames"); if (names === undefined) { ... }
+ */
+THIO_EXPORT(sessionGet)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString || argv[0].data.string == nullptr) return kESErrTypeMismatch;
+
+    try {
+        const SessionStore::ValuePointer value = getSessionStore().get(argv[0].data.string);
+        if (value == nullptr) {
+            return kESErrOK;
+        }
+        switch (value->type) {
+        case SessionStore::kSessionString:
+            return setStringResult(retval, value->text);
+        case SessionStore::kSessionNumber:
+            retval->type = kTypeDouble;
+            retval->data.fltval = value->number;
+            return kESErrOK;
+        case SessionStore::kSessionBool:
+            retval->type = kTypeBool;
+            retval->data.intval = value->boolean ? 1 : 0;
+            return kESErrOK;
+        case SessionStore::kSessionBuffer: {
+            std::string script;
+            value->buffer->appendScriptArray(script, 0, value->buffer->size());
+            return setScriptResult(retval, script);
+        }
+        }
+        return kESErrOK;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+/**
+ * @brief Copies a NativeBuffer stored in the session store into a buffer, which takes on its element type and length.
+ * @param argv[0] (String) The key.
+ * @param argv[1] (NativeBuffer) The buffer to fill.
+ * @param retval (Output) Boolean: false if the key is missing or expired, and the buffer is unchanged.
+ * @return kESErrOK on success, kESErrBadArgumentList for the wrong number of arguments, or kESErrTypeMismatch if the
+ *         second argument isn't a NativeBuffer or the key holds another type of value.
+ *
+ * JavaScript Usage: var ticks = new NativeBuffer("i64"); if (externalLibrary.sessionGetBuffer("clipStarts", ticks)) { ... }
+ */
+THIO_EXPORT(sessionGetBuffer)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString || argv[0].data.string == nullptr) return kESErrTypeMismatch;
+    NativeBuffer* target = getNativeBufferArg(argv[1]);
+    if (target == nullptr) return kESErrTypeMismatch;
+
+    try {
+        const SessionStore::ValuePointer value = getSessionStore().get(argv[0].data.string);
+        if (value != nullptr && value->type != SessionStore::kSessionBuffer) return kESErrTypeMismatch;
+        if (value != nullptr) *target = *value->buffer;
+        retval->type = kTypeBool;
+        retval->data.intval = (value != nullptr) ? 1 : 0;
+        return kESErrOK;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+/**
+ * @brief Removes a key from the session store.
+ * @param result Receives false if the key wasn't there.
+ * @param key The key.
+ * @return kESErrOK.
+ *
+ * JavaScript Usage: externalLibrary.sessionDelete("sequenceNames");
+ */
+long sessionDeleteTyped(bool& result, const char* key) {
+    result = getSessionStore().remove(key);
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(sessionDelete, sessionDeleteTyped)
+
+/**
+ * @brief Removes every key that starts with a prefix from the session store, e.g. everything for one project.
+ * @param result Receives the number of keys removed.
+ * @param prefix The start of the keys to remove, or "" for every key.
+ * @return kESErrOK.
+ *
+ * JavaScript Usage: externalLibrary.sessionClear("resolutions/");
+ */
+long sessionClearTyped(long& result, const char* prefix) {
+    result = (long)getSessionStore().clear(prefix);
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(sessionClear, sessionClearTyped)
+
+/**
+ * @brief Sets the session store's memory limit. The least recently used keys are dropped to stay under it.
+ * @param result Receives the previous limit, in bytes.
+ * @param bytes The new limit, in bytes. Anything past SIZE_MAX is treated as SIZE_MAX, i.e. no limit.
+ * @return kESErrOK on success, or kESErrRange for a negative or non-finite limit.
+ *
+ * JavaScript Usage: externalLibrary.sessionSetLimit(256 * 1024 * 1024);
+ */
+long sessionSetLimitTyped(double& result, double bytes) {
+    if (!std::isfinite(bytes) || bytes < 0) return kESErrRange;
+    // (double)SIZE_MAX rounds up past SIZE_MAX, so anything below it converts without overflowing
+    const size_t limit = (bytes >= (double)SIZE_MAX) ? SIZE_MAX : (size_t)bytes;
+    result = (double)getSessionStore().setLimit(limit);
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(sessionSetLimit, sessionSetLimitTyped)
+
+/**
+ * @brief Describes the session store.
+ * @param result Receives a script that evaluates to {entries, bytes, limit, hits, misses, expired, evicted}.
+ * @return kESErrOK.
+ *
+ * JavaScript Usage: var info = externalLibrary.sessionInfo(); $.writeln(info.hits + " hits, " + info.misses + " misses");
+ */
+long sessionInfoTyped(ScriptResult& result) {
+    const SessionStore::Info info = getSessionStore().info();
+    result.script = "({entries:" + std::to_string(info.entries);
+    result.script += ",bytes:" + std::to_string(info.bytes);
+    result.script += ",limit:" + std::to_string(info.limit);
+    result.script += ",hits:" + std::to_string(info.hits);
+    result.script += ",misses:" + std::to_string(info.misses);
+    result.script += ",expired:" + std::to_string(info.expired);
+    result.script += ",evicted:" + std::to_string(info.evicted);
+    result.script += "})";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(sessionInfo, sessionInfoTyped)
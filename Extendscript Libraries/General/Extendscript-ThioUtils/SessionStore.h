@@ -0,0 +1,117 @@
+#pragma once
+
+// SessionStore.h
+// Values that scripts keep in the library between runs, for as long as the app has it loaded.
+//
+// Every script run starts with empty ExtendScript state, so sequence lists, resolutions and bin lookups get worked out
+// through the DOM again each time, although the library itself stays loaded for the whole editing session. The session
+// store lets a script keep such results under a key and pick them up in its next run. Unlike the result cache
+// (ResultCache.h) nothing goes to disk and nothing is tied to the saved project, so it also suits results that depend
+// on unsaved edits, as long as the script picks keys, or expiry times, that end up invalidating them.
+//
+// Values keep their type: a string, a number, a boolean, or a copy of a NativeBuffer's elements. Each key can have a
+// time to live, after which it reads as missing. The store has a memory limit (SESSION_STORE_DEFAULT_LIMIT unless a
+// script sets one) and drops the least recently used keys to stay under it. Expired keys are dropped when they're
+// read, when the least recently used end reaches them, or when info() is asked for.
+//
+// All members are safe to call from several threads, since the "call" job kind (JobEngine.h) can run the exports on
+// the worker threads too.
+
+#include "NativeBuffer.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define SESSION_STORE_DEFAULT_LIMIT (64 * 1024 * 1024)
+
+class SessionStore {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum ValueType {
+        kSessionString,
+        kSessionNumber,
+        kSessionBool,
+        kSessionBuffer,
+    };
+
+    struct Value {
+        ValueType type = kSessionString;
+        std::string text;
+        double number = 0;
+        bool boolean = false;
+        std::shared_ptr<const NativeBuffer> buffer;
+    };
+    // Values are immutable once stored, and shared with the callers that get them, so a get copies nothing while it
+    // holds the lock
+    typedef std::shared_ptr<const Value> ValuePointer;
+
+    struct Info {
+        size_t entries = 0;
+        size_t bytes = 0;           // Estimated memory use of the entries, counted against the limit
+        size_t limit = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;        // Including reads of expired keys
+        uint64_t expired = 0;       // Keys dropped because their time ran out
+        uint64_t evicted = 0;       // Keys dropped to stay under the limit
+    };
+
+    SessionStore() = default;
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    /**
+     * @brief Stores a value under a key, replacing what was there. A value that's over the limit on its own isn't stored,
+     * and the key is removed instead.
+     * @param ttlSeconds Time until the key expires. 0 or less keeps it until it's evicted, deleted or cleared.
+     * @return false if the value is over the limit.
+     */
+    bool set(const std::string& key, Value value, double ttlSeconds, Clock::time_point now = Clock::now());
+
+    // Gets a key's value and makes it the most recently used. Returns nullptr for a missing or expired key.
+    ValuePointer get(const std::string& key, Clock::time_point now = Clock::now());
+
+    // Removes one key. Returns false if it wasn't there.
+    bool remove(const std::string& key);
+
+    // Removes every key starting with 'prefix' ("" for all of them), and returns how many there were
+    size_t clear(const std::string& prefix);
+
+    // Changes the memory limit, evicting keys if the store is now over it. Returns the previous limit.
+    size_t setLimit(size_t bytes);
+
+    // Drops expired keys, then describes the store
+    Info info(Clock::time_point now = Clock::now());
+
+    void resetCounters();
+
+private:
+    struct Entry {
+        std::string key;
+        ValuePointer value;
+        size_t bytes;
+        Clock::time_point expires;     // Clock::time_point::max() for none
+    };
+    typedef std::list<Entry> EntryList;
+
+    std::mutex mutex;
+    EntryList entries;      // Most recently used first
+    std::unordered_map<std::string, EntryList::iterator> index;
+    size_t totalBytes = 0;
+    size_t limit = SESSION_STORE_DEFAULT_LIMIT;
+    uint64_t hits = 0, misses = 0, expired = 0, evicted = 0;
+
+    void erase(EntryList::iterator it);
+    void evictToLimit(Clock::time_point now);
+};
+
+// The store the exports use
+SessionStore& getSessionStore();
+
+// Empties it. Called from ESTerminate.
+void releaseSessionStore();
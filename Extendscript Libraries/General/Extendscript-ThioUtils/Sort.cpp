@@ -0,0 +1,159 @@
+#include "Sort.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "PackedData.h"
+#include "SoSharedLibDefs.h"
+#include <algorithm>
+#include <cstring>
+
+// Below this many records a comparison sort beats the radix passes, which each touch 256 counters per byte
+#define RADIX_SORT_MIN_COUNT 256
+
+struct RadixItem {
+    uint64_t key;
+    uint32_t index;
+};
+
+// Flipping the sign bit makes signed keys sort correctly as unsigned
+static inline uint64_t radixKey(long long key) {
+    return (uint64_t)key ^ 0x8000000000000000ULL;
+}
+
+// Stable LSD radix sort on the full 64-bit key, one byte per pass
+static void radixSortItems(std::vector<RadixItem>& items, std::vector<RadixItem>& scratch) {
+    const size_t count = items.size();
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (const RadixItem& item : items) {
+        for (int byte = 0; byte < 8; byte++) {
+            counts[byte][(item.key >> (byte * 8)) & 0xFF]++;
+        }
+    }
+
+    scratch.resize(count);
+    for (int byte = 0; byte < 8; byte++) {
+        const int shift = byte * 8;
+        if (counts[byte][(items[0].key >> shift) & 0xFF] == count) {
+            continue; // Every key has the same byte here, so this pass wouldn't move anything
+        }
+
+        size_t offsets[256];
+        size_t total = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            offsets[digit] = total;
+            total += counts[byte][digit];
+        }
+        for (const RadixItem& item : items) {
+            scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
+
+void sortRecordOrder(const long long* keys, size_t count, size_t keyCount, std::vector<uint32_t>& order) {
+    order.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        order[i] = (uint32_t)i;
+    }
+    if (count < 2 || keyCount == 0) {
+        return;
+    }
+
+    if (count < RADIX_SORT_MIN_COUNT) {
+        std::stable_sort(order.begin(), order.end(), [keys, keyCount](uint32_t a, uint32_t b) {
+            const long long* keysA = keys + (size_t)a * keyCount;
+            const long long* keysB = keys + (size_t)b * keyCount;
+            return std::lexicographical_compare(keysA, keysA + keyCount, keysB, keysB + keyCount);
+        });
+        return;
+    }
+
+    // One stable sort per key, least significant first. Each sort keeps the order the previous ones set up for
+    // records that tie on this key.
+    std::vector<RadixItem> items(count), scratch;
+    for (size_t key = keyCount; key-- > 0;) {
+        for (size_t i = 0; i < count; i++) {
+            items[i].key = radixKey(keys[(size_t)order[i] * keyCount + key]);
+            items[i].index = order[i];
+        }
+        radixSortItems(items, scratch);
+        for (size_t i = 0; i < count; i++) {
+            order[i] = items[i].index;
+        }
+    }
+}
+
+void findGroupStarts(const long long* keys, size_t keyCount, const std::vector<uint32_t>& order, size_t groupKeys, std::vector<uint32_t>& groupStarts) {
+    groupStarts.clear();
+    const size_t compared = std::min(groupKeys, keyCount) * sizeof(long long);
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i == 0 || memcmp(keys + (size_t)order[i] * keyCount, keys + (size_t)order[i - 1] * keyCount, compared) != 0) {
+            groupStarts.push_back((uint32_t)i);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Sorts records of integer keys and returns the sorted order, for rearranging the items they came from.
+ * @param argv JavaScript arguments. Expects (packed keys string, group key count integer)
+ *             Records are separated by ';' or newlines and each has the same number of comma separated keys, most
+ *             significant first (e.g. "startTicks,trackIndex"). The sort is stable.
+ *             Group key count: how many leading keys define a group for 'groups'. 0 gives a single group.
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. A script that evaluates to {order:[...], groups:[...]}. 'order' holds record indexes in
+ *               sorted order. 'groups' holds the position in 'order' where each group of equal leading keys starts.
+ * @return kESErrOK on success, kESErrBadArgumentList if the records don't all have the same number of keys,
+ *         kESErrRange if the group key count is more than the number of keys, or another error code.
+ *
+ * JavaScript Usage: var sorted = externalLibrary.sortOrder("254016000000,1;0,2;0,1", 1);   // ({order:[2,1,0],groups:[0,2]})
+ */
+THIO_EXPORT(sortOrder)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr) return kESErrBadArgumentList;
+    if (argv[1].type != kTypeInteger && argv[1].type != kTypeUInteger) return kESErrTypeMismatch;
+    const long long groupKeys = argv[1].data.intval;
+
+    // Keys of all records, one after the other
+    std::vector<long long> keys;
+    size_t count = 0, keyCount = 0;
+    const char* p = argv[0].data.string;
+    while (*p != '\0') {
+        const char* recordEnd = p + strcspn(p, ";\n");
+        const size_t before = keys.size();
+        if (!parsePackedInt64s(p, recordEnd, keys)) return kESErrConversion;
+        const size_t recordKeys = keys.size() - before;
+        if (count == 0) {
+            keyCount = recordKeys;
+        }
+        if (recordKeys == 0 || recordKeys != keyCount) return kESErrBadArgumentList;
+        count++;
+        p = (*recordEnd == '\0') ? recordEnd : recordEnd + 1;
+    }
+    if (count > UINT32_MAX) return kESErrRange;
+    if (groupKeys < 0 || (count > 0 && (size_t)groupKeys > keyCount)) return kESErrRange;
+
+    std::vector<uint32_t> order, groupStarts;
+    sortRecordOrder(keys.data(), count, keyCount, order);
+    findGroupStarts(keys.data(), keyCount, order, (size_t)groupKeys, groupStarts);
+
+    std::string script;
+    script.reserve(count * 8 + groupStarts.size() * 8 + 32);
+    script += "({order:[";
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i > 0) script += ",";
+        script += std::to_string(order[i]);
+    }
+    script += "],groups:[";
+    for (size_t i = 0; i < groupStarts.size(); i++) {
+        if (i > 0) script += ",";
+        script += std::to_string(groupStarts[i]);
+    }
+    script += "]})";
+    return setScriptResult(retval, script);
+}
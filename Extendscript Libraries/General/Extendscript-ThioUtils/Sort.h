@@ -0,0 +1,32 @@
+#pragma once
+
+// Sort.h
+// Native sorting for arrays of clips, markers and timestamps, returning the sorted order rather than the values.
+//
+// Sorting in ExtendScript calls back into a JS comparator for every comparison, and the comparators in the scripts
+// parse tick strings each time (Number(a.start.ticks) - Number(b.start.ticks)). Scripts instead send the keys of every
+// item once, get back the order to put them in, and rearrange their DOM objects in one pass.
+//
+// Keys are 64-bit integers (ticks, track indexes, ...). They're sorted with an LSD radix sort, one byte per pass,
+// and passes where every key has the same byte are skipped. Ticks on one timeline share their high bytes, so most
+// sorts take 4-5 passes. Small inputs use a comparison sort instead, which is faster below a few hundred items.
+// Both are stable, so items with equal keys keep their original order, same as the scripts expect.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Finds the stable sorted order of 'count' records, each with 'keyCount' keys. The first key is the most
+ * significant, so (ticks, track) sorts by ticks and then by track.
+ * @param keys The keys of all records, one record after the other: keys[record * keyCount + key]
+ * @param order Receives the record indexes in sorted order.
+ */
+void sortRecordOrder(const long long* keys, size_t count, size_t keyCount, std::vector<uint32_t>& order);
+
+/**
+ * @brief Finds where groups of records with equal leading keys start, after sorting.
+ * @param groupKeys How many leading keys define a group. 0 puts everything in one group.
+ * @param groupStarts Receives the position in 'order' of the first record of each group.
+ */
+void findGroupStarts(const long long* keys, size_t keyCount, const std::vector<uint32_t>& order, size_t groupKeys, std::vector<uint32_t>& groupStarts);
@@ -0,0 +1,477 @@
+#include "SoundPlayer.h"
+#include "Exports.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "TextEncoding.h"
+#include "TextSearch.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Include platform specific headers
+// ---------------- Windows ----------------
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h> // For PlaySound
+#include <pathcch.h> // For PathCchAppend. Using this instead of PathAppendW for safety and modernity.
+#include <cstdio>
+#pragma comment(lib, "Winmm.lib")
+#pragma comment(lib, "Pathcch.lib") // Needed for PathCchAppend
+// ---------------- Apple ----------------
+#elif defined(__APPLE__)
+#include <AudioToolbox/AudioToolbox.h>
+#endif
+
+// Largest file preloadSound will keep in memory
+#define SOUND_PRELOAD_MAX_BYTES (16 * 1024 * 1024)
+
+// ------------------------------------------------------------------------------------------------
+// Backends
+// ------------------------------------------------------------------------------------------------
+
+long NullAudioBackend::resolve(SoundAsset& sound) {
+    sound.platformName.assign(sound.name.begin(), sound.name.end());
+    return kESErrOK;
+}
+
+long NullAudioBackend::load(SoundAsset& sound) {
+    sound.data.assign(sound.name.begin(), sound.name.end()); // Stand-in for the file contents
+    return kESErrOK;
+}
+
+void NullAudioBackend::play(const SoundAsset& sound) {
+    playCount++;
+}
+
+void NullAudioBackend::beep(unsigned int type) {
+    beepCount++;
+}
+
+void NullAudioBackend::stop() {
+}
+
+#ifdef _WIN32
+class WindowsAudioBackend : public AudioBackend {
+public:
+    long resolve(SoundAsset& sound) override {
+        if (!sound.isFile) {
+            // --- Handle as Alias ---
+            return utf8ToWide(sound.name.data(), sound.name.size(), sound.platformName) ? kESErrOK : kESErrConversion;
+        }
+
+        // --- Handle as Filename, relative to C:\Windows\Media ---
+        wchar_t mediaPath[MAX_PATH];
+        if (GetWindowsDirectoryW(mediaPath, MAX_PATH) == 0) return kESErrConversion;
+        if (FAILED(PathCchAppend(mediaPath, MAX_PATH, L"Media"))) return kESErrConversion;
+
+        std::wstring wideFilename;
+        if (!utf8ToWide(sound.name.data(), sound.name.size(), wideFilename)) return kESErrConversion;
+        if (FAILED(PathCchAppend(mediaPath, MAX_PATH, wideFilename.c_str()))) return kESErrConversion;
+
+        sound.platformName.assign(mediaPath);
+        return kESErrOK;
+    }
+
+    long load(SoundAsset& sound) override {
+        FILE* file = nullptr;
+        if (_wfopen_s(&file, sound.platformName.c_str(), L"rb") != 0 || file == nullptr) {
+            return kESErrCannotResolve;
+        }
+
+        long result = kESErrOK;
+        if (fseek(file, 0, SEEK_END) != 0) {
+            result = kESErrConversion;
+        } else {
+            const long size = ftell(file);
+            if (size <= 0 || size > SOUND_PRELOAD_MAX_BYTES) {
+                result = kESErrRange;
+            } else {
+                try {
+                    sound.data.resize((size_t)size);
+                    rewind(file);
+                    if (fread(sound.data.data(), 1, sound.data.size(), file) != sound.data.size()) {
+                        result = kESErrConversion;
+                    }
+                }
+                catch (const std::bad_alloc&) {
+                    result = THIO_ERR_NO_MEMORY;
+                }
+            }
+        }
+        fclose(file);
+
+        if (result != kESErrOK) {
+            sound.data.clear();
+        }
+        return result;
+    }
+
+    void play(const SoundAsset& sound) override {
+        if (!sound.data.empty()) {
+            // Played straight from memory. The data stays alive until stop() is called, see shutdownSoundPlayer.
+            PlaySoundW(reinterpret_cast<LPCWSTR>(sound.data.data()), NULL, SND_MEMORY | SND_ASYNC | SND_NODEFAULT | SND_SYSTEM);
+        } else {
+            const DWORD dwFlags = (sound.isFile ? SND_FILENAME : SND_ALIAS) | SND_ASYNC | SND_NODEFAULT | SND_SYSTEM;
+            PlaySoundW(sound.platformName.c_str(), NULL, dwFlags);
+        }
+    }
+
+    void beep(unsigned int type) override {
+        MessageBeep(type);
+    }
+
+    void stop() override {
+        PlaySoundW(NULL, NULL, 0);
+    }
+};
+#elif defined(__APPLE__)
+class MacAudioBackend : public AudioBackend {
+public:
+    long resolve(SoundAsset& sound) override { return kESErrOK; }
+    long load(SoundAsset& sound) override { return THIO_ERR_NOT_IMPLEMENTED; }
+    void play(const SoundAsset& sound) override {} // No implementation for Mac
+    void beep(unsigned int type) override {
+        // Keep the original Mac behavior
+        AudioServicesPlaySystemSound(kSystemSoundID_UserPreferredAlert);
+    }
+    void stop() override {}
+};
+#endif
+
+static AudioBackend& platformBackend() {
+#ifdef _WIN32
+    static WindowsAudioBackend backend;
+#elif defined(__APPLE__)
+    static MacAudioBackend backend;
+#else
+    // Stub backend for other platforms (the Linux profiling build)
+    static NullAudioBackend backend;
+#endif
+    return backend;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Request queue
+// Bounded lock-free queue (Dmitry Vyukov's MPMC design). The script thread never waits on the playback thread,
+// it either gets a slot or the request is dropped.
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+    struct SoundRequest {
+        const SoundAsset* sound;    // nullptr for a beep
+        unsigned int beepType;
+
+        bool sameAs(const SoundRequest& other) const {
+            return sound == other.sound && (sound != nullptr || beepType == other.beepType);
+        }
+    };
+
+    class SoundQueue {
+    public:
+        SoundQueue() {
+            clear();
+        }
+
+        // Only safe when nothing else is using the queue
+        void clear() {
+            for (size_t i = 0; i < SOUND_QUEUE_CAPACITY; i++) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            enqueuePosition.store(0, std::memory_order_relaxed);
+            dequeuePosition.store(0, std::memory_order_relaxed);
+        }
+
+        bool push(const SoundRequest& request) {
+            size_t position = enqueuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = cells[position & (SOUND_QUEUE_CAPACITY - 1)];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+                if (difference == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.request = request;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; // Full
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(SoundRequest& request) {
+            size_t position = dequeuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = cells[position & (SOUND_QUEUE_CAPACITY - 1)];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+                if (difference == 0) {
+                    if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        request = cell.request;
+                        cell.sequence.store(position + SOUND_QUEUE_CAPACITY, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; // Empty
+                } else {
+                    position = dequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        static_assert((SOUND_QUEUE_CAPACITY & (SOUND_QUEUE_CAPACITY - 1)) == 0, "SOUND_QUEUE_CAPACITY must be a power of two");
+
+        struct Cell {
+            std::atomic<size_t> sequence;
+            SoundRequest request;
+        };
+
+        Cell cells[SOUND_QUEUE_CAPACITY];
+        std::atomic<size_t> enqueuePosition;
+        std::atomic<size_t> dequeuePosition;
+    };
+
+    struct SoundPlayer {
+        // Cache of resolved sounds by name. Assets are owned by 'assets' and only freed on shutdown, since the
+        // playback thread may still hold a pointer to one that's been replaced in the map by a preloaded version.
+        std::mutex cacheMutex;
+        std::unordered_map<std::string, const SoundAsset*> cache;
+        std::vector<std::unique_ptr<SoundAsset>> assets;
+        AudioBackend* backend = nullptr;
+
+        SoundQueue queue;
+
+        // Guards starting and stopping the playback thread, and pushing to the queue, so shutdown can't clear the
+        // queue under a push. The playback thread only takes it to sleep when the queue is empty, so the script
+        // thread never waits for a sound to play.
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        bool sleeping = false;
+        bool started = false;
+        bool stopping = false;
+        std::thread thread;
+
+        ~SoundPlayer() {
+            // If ESTerminate never ran, joining here could deadlock while the library unloads, so just let it go
+            if (thread.joinable()) {
+                thread.detach();
+            }
+        }
+
+        AudioBackend& currentBackend() {
+            return backend != nullptr ? *backend : platformBackend();
+        }
+
+        void run();
+        long enqueue(const SoundRequest& request);
+    };
+
+    SoundPlayer soundPlayer;
+}
+
+void SoundPlayer::run() {
+    AudioBackend& audio = currentBackend();
+    SoundRequest last = { nullptr, 0 };
+    bool playedAny = false;
+    std::chrono::steady_clock::time_point lastTime;
+
+    while (true) {
+        SoundRequest request = { nullptr, 0 };
+        if (!queue.pop(request)) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            sleeping = true;
+            wake.wait(lock, [&] { return stopping || queue.pop(request); });
+            sleeping = false;
+            if (stopping) return;
+        }
+
+        // Leave a gap after the previous sound, then play only the newest request that arrived meanwhile
+        const auto sinceLast = std::chrono::steady_clock::now() - lastTime;
+        if (playedAny && sinceLast < std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_MIN_INTERVAL_MS) - sinceLast);
+        }
+        SoundRequest newer = { nullptr, 0 };
+        while (queue.pop(newer)) {
+            request = newer;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (playedAny && request.sameAs(last) && now - lastTime < std::chrono::milliseconds(SOUND_REPEAT_WINDOW_MS)) {
+            continue; // Same sound again right away, most likely a loop
+        }
+
+        if (request.sound != nullptr) {
+            audio.play(*request.sound);
+        } else {
+            audio.beep(request.beepType);
+        }
+        last = request;
+        lastTime = now;
+        playedAny = true;
+    }
+}
+
+long SoundPlayer::enqueue(const SoundRequest& request) {
+    // Checked under the same lock shutdownSoundPlayer sets 'stopping' with, so a sound can't start a thread that
+    // shutdown has already joined, or land in the queue while it's being cleared
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    if (stopping) {
+        return kESErrOK; // Shutting down, nothing would play it
+    }
+    if (!started) {
+        try {
+            thread = std::thread([this] { run(); });
+        }
+        catch (...) {
+            return THIO_ERR_INTERNAL;
+        }
+        started = true;
+    }
+
+    if (!queue.push(request)) {
+        return kESErrOK; // Full, so it's a burst of sounds and this one wouldn't be heard anyway
+    }
+    if (sleeping) {
+        wake.notify_one();
+    }
+    return kESErrOK;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Public functions
+// ------------------------------------------------------------------------------------------------
+
+// Checks a sound name from a script. Only plain aliases or file names are allowed, not paths.
+static long validateSoundName(const char* name) {
+    if (name == nullptr || name[0] == '\0') return kESErrBadArgumentList;
+    if (strchr(name, '\\') != nullptr || strchr(name, '/') != nullptr) return kESErrBadArgumentList;
+    return kESErrOK;
+}
+
+// Finds or resolves a sound. Requires cacheMutex to be held.
+static long lookupSound(const std::string& name, const SoundAsset*& asset) {
+    auto found = soundPlayer.cache.find(name);
+    if (found != soundPlayer.cache.end()) {
+        asset = found->second;
+        return kESErrOK;
+    }
+
+    std::unique_ptr<SoundAsset> created(new SoundAsset());
+    created->name = name;
+    created->isFile = findIgnoreCase(name.data(), name.size(), ".wav", 4) != TEXT_NOT_FOUND;
+    const long result = soundPlayer.currentBackend().resolve(*created);
+    if (result != kESErrOK) return result;
+
+    asset = created.get();
+    soundPlayer.assets.push_back(std::move(created));
+    soundPlayer.cache[name] = asset;
+    return kESErrOK;
+}
+
+void setAudioBackend(AudioBackend* backend) {
+    shutdownSoundPlayer();
+    std::lock_guard<std::mutex> lock(soundPlayer.cacheMutex);
+    soundPlayer.backend = backend;
+}
+
+long queueSound(const char* name) {
+    const long valid = validateSoundName(name);
+    if (valid != kESErrOK) return valid;
+
+    try {
+        // Queued before the cache lock is released, so shutdownSoundPlayer can't free the asset in between
+        std::lock_guard<std::mutex> lock(soundPlayer.cacheMutex);
+        const SoundAsset* asset = nullptr;
+        const long result = lookupSound(name, asset);
+        if (result != kESErrOK) return result;
+        return soundPlayer.enqueue(SoundRequest{ asset, 0 });
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+long queueBeep(unsigned int type) {
+    return soundPlayer.enqueue(SoundRequest{ nullptr, type });
+}
+
+long preloadSoundData(const char* name) {
+    const long valid = validateSoundName(name);
+    if (valid != kESErrOK) return valid;
+
+    try {
+        std::lock_guard<std::mutex> lock(soundPlayer.cacheMutex);
+        const SoundAsset* asset = nullptr;
+        long result = lookupSound(name, asset);
+        if (result != kESErrOK) return result;
+        if (!asset->isFile) return kESErrBadArgumentList; // Aliases are looked up by the system, there's no file to load
+        if (!asset->data.empty()) return kESErrOK;
+
+        // Cached assets don't change, so the preloaded one replaces it in the cache
+        std::unique_ptr<SoundAsset> loaded(new SoundAsset(*asset));
+        result = soundPlayer.currentBackend().load(*loaded);
+        if (result != kESErrOK) return result;
+
+        soundPlayer.cache[name] = loaded.get();
+        soundPlayer.assets.push_back(std::move(loaded));
+        return kESErrOK;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+void shutdownSoundPlayer() {
+    {
+        std::lock_guard<std::mutex> lock(soundPlayer.wakeMutex);
+        soundPlayer.stopping = true;
+        soundPlayer.wake.notify_one();
+    }
+    if (soundPlayer.thread.joinable()) {
+        soundPlayer.thread.join();
+    }
+
+    // Nothing is playing from the cached data after this, so it can be freed
+    soundPlayer.currentBackend().stop();
+    soundPlayer.queue.clear();
+
+    std::lock_guard<std::mutex> lock(soundPlayer.cacheMutex);
+    soundPlayer.cache.clear();
+    soundPlayer.assets.clear();
+
+    // Allow the library to be used again if ExtendScript initializes it again without unloading
+    std::lock_guard<std::mutex> wakeLock(soundPlayer.wakeMutex);
+    soundPlayer.stopping = false;
+    soundPlayer.started = false;
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Functions ------------------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Loads a .wav file from C:\Windows\Media into memory, so later playSoundAlias calls for it don't read the disk.
+ * @param argv JavaScript arguments. Expects one string, a simple filename like "notify.wav".
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value (not used here).
+ * @return kESErrOK on success, or an error code (e.g., kESErrBadArgumentList for aliases or paths).
+ *
+ * JavaScript Usage: externalLibrary.preloadSound("Windows Information Bar.wav");
+ */
+THIO_EXPORT(preloadSound)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString) return kESErrTypeMismatch;
+
+    return preloadSoundData(argv[0].data.string);
+}
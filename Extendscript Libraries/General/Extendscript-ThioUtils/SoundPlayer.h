@@ -0,0 +1,85 @@
+#pragma once
+
+// SoundPlayer.h
+// Sound playback for playSoundAlias and systemBeep, on a dedicated thread.
+//
+// Sound names are resolved once (alias vs. file in the Windows Media folder, UTF-16 conversion) and cached, and
+// preloadSound can keep a file's WAV data in memory so later plays don't touch the disk. The script thread only
+// resolves and queues, and the playback thread does the platform calls.
+//
+// Scripts often beep once per item in a loop, so the player doesn't try to play everything it's asked to:
+//      - The queue is small, and requests that don't fit are dropped
+//      - When several requests are waiting, only the newest is played
+//      - The same sound isn't repeated within SOUND_REPEAT_WINDOW_MS
+//
+// The platform calls are behind AudioBackend, so everything else runs on Linux against NullAudioBackend.
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#define SOUND_QUEUE_CAPACITY        16  // Must be a power of two
+#define SOUND_REPEAT_WINDOW_MS      250 // Same sound requested again within this time is skipped
+#define SOUND_MIN_INTERVAL_MS       40  // Minimum time between any two sounds
+
+// A resolved sound. Never changes once it's in the cache, so the playback thread can use it without locking.
+struct SoundAsset {
+    std::string name;               // As given by the script, e.g. "SystemAsterisk" or "notify.wav"
+    bool isFile = false;            // A .wav file in the media folder, otherwise a sound alias
+    std::wstring platformName;      // Alias or full path in the form the platform API takes
+    std::vector<char> data;         // WAV file contents when preloaded, otherwise empty
+};
+
+class AudioBackend {
+public:
+    virtual ~AudioBackend() {}
+
+    // Fills in sound.platformName from sound.name and sound.isFile. Returns kESErrOK or an error code.
+    virtual long resolve(SoundAsset& sound) = 0;
+
+    // Reads a file sound into sound.data. Returns kESErrOK or an error code.
+    virtual long load(SoundAsset& sound) = 0;
+
+    // These are only called from the playback thread
+    virtual void play(const SoundAsset& sound) = 0;
+    virtual void beep(unsigned int type) = 0;
+    virtual void stop() = 0;
+};
+
+// Plays nothing and counts what it was asked to play. Used on platforms without a backend, and for exercising the queue.
+class NullAudioBackend : public AudioBackend {
+public:
+    long resolve(SoundAsset& sound) override;
+    long load(SoundAsset& sound) override;
+    void play(const SoundAsset& sound) override;
+    void beep(unsigned int type) override;
+    void stop() override;
+
+    std::atomic<int> playCount{ 0 };
+    std::atomic<int> beepCount{ 0 };
+};
+
+/**
+ * @brief Replaces the backend. Pass nullptr to go back to the platform's own. Stops the playback thread and clears the
+ * cache first, since cached sounds were resolved by the old backend. The caller keeps ownership of the backend.
+ */
+void setAudioBackend(AudioBackend* backend);
+
+/**
+ * @brief Resolves a sound name (using the cache) and queues it to be played.
+ * @param name An alias like "SystemAsterisk", or a file name in the media folder like "notify.wav". Paths are rejected.
+ * @return kESErrOK if it was queued or deliberately skipped, otherwise an error code.
+ */
+long queueSound(const char* name);
+
+// Queues a system beep of the given MessageBeep type
+long queueBeep(unsigned int type);
+
+/**
+ * @brief Resolves a file sound and keeps its data in memory for later plays.
+ * @return kESErrOK, kESErrBadArgumentList if it isn't a file sound, or the backend's error code.
+ */
+long preloadSoundData(const char* name);
+
+// Stops the playback thread and any playing sound, and clears the cache. Called from ESTerminate.
+void shutdownSoundPlayer();
@@ -0,0 +1,287 @@
+#include "TextEncoding.h"
+#include "ThioUtils.h"
+#include "SoSharedLibDefs.h"
+#include <cstdint>
+#include <cstring>
+#include <new>        // For std::bad_alloc
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXT_ENCODING_SSE2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+#if TEXT_ENCODING_SSE2
+static inline unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Decodes one sequence starting with a non-ASCII byte and writes it as one or two code units.
+// Returns the number of bytes consumed, which is at least 1.
+static inline size_t decodeMultiByte(const unsigned char* p, const unsigned char* end, char16_t*& out, size_t& invalid) {
+    const unsigned char lead = p[0];
+    const size_t available = (size_t)(end - p);
+
+    // Number of continuation bytes, and the allowed range of the first one (which rules out overlong forms,
+    // surrogates and values past U+10FFFF)
+    size_t continuationCount;
+    unsigned char firstMin = 0x80, firstMax = 0xBF;
+    uint32_t codePoint;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        continuationCount = 1;
+        codePoint = lead & 0x1F;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF) {
+        continuationCount = 2;
+        codePoint = lead & 0x0F;
+        if (lead == 0xE0) firstMin = 0xA0;
+        else if (lead == 0xED) firstMax = 0x9F;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4) {
+        continuationCount = 3;
+        codePoint = lead & 0x07;
+        if (lead == 0xF0) firstMin = 0x90;
+        else if (lead == 0xF4) firstMax = 0x8F;
+    }
+    else {
+        // Stray continuation byte, or a lead byte that's never valid
+        *out++ = REPLACEMENT_CHARACTER;
+        invalid++;
+        return 1;
+    }
+
+    // On a bad byte, everything valid so far is one invalid subpart and the bad byte starts the next sequence
+    for (size_t i = 1; i <= continuationCount; i++) {
+        const unsigned char min = (i == 1) ? firstMin : 0x80;
+        const unsigned char max = (i == 1) ? firstMax : 0xBF;
+        if (i >= available || p[i] < min || p[i] > max) {
+            *out++ = REPLACEMENT_CHARACTER;
+            invalid++;
+            return i;
+        }
+        codePoint = (codePoint << 6) | (p[i] & 0x3F);
+    }
+
+    if (codePoint >= 0x10000) {
+        codePoint -= 0x10000;
+        *out++ = (char16_t)(0xD800 + (codePoint >> 10));
+        *out++ = (char16_t)(0xDC00 + (codePoint & 0x3FF));
+    }
+    else {
+        *out++ = (char16_t)codePoint;
+    }
+    return continuationCount + 1;
+}
+
+Utf16Conversion utf8ToUtf16Reference(const char* utf8, size_t length, char16_t* dest) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(utf8);
+    const unsigned char* end = p + length;
+    char16_t* out = dest;
+    size_t invalid = 0;
+    while (p < end) {
+        if (*p < 0x80) {
+            *out++ = *p++;
+        }
+        else {
+            p += decodeMultiByte(p, end, out, invalid);
+        }
+    }
+    return { (size_t)(out - dest), invalid };
+}
+
+// decodeMultiByte with the valid two and three byte forms (Latin, Cyrillic, CJK...) decoded inline
+static inline size_t decodeNonAscii(const unsigned char* p, const unsigned char* end, char16_t*& out, size_t& invalid) {
+    const unsigned char lead = p[0];
+    if (lead >= 0xC2 && lead <= 0xDF && end - p >= 2 && (p[1] & 0xC0) == 0x80) {
+        *out++ = (char16_t)(((lead & 0x1F) << 6) | (p[1] & 0x3F));
+        return 2;
+    }
+    if ((lead & 0xF0) == 0xE0 && end - p >= 3 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+        const unsigned int codePoint = ((lead & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        if (codePoint >= 0x800 && (codePoint < 0xD800 || codePoint > 0xDFFF)) {
+            *out++ = (char16_t)codePoint;
+            return 3;
+        }
+    }
+    return decodeMultiByte(p, end, out, invalid);
+}
+
+Utf16Conversion utf8ToUtf16(const char* utf8, size_t length, char16_t* dest) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(utf8);
+    const unsigned char* end = p + length;
+    char16_t* out = dest;
+    size_t invalid = 0;
+
+    // Whole blocks. An all-ASCII block is widened and stored in one go. Otherwise it's still stored whole, only the
+    // ASCII prefix is kept, and the rest of the block is decoded one character at a time before checking the next
+    // block, so text with a non-ASCII character every few bytes doesn't pay for a block check per character. The
+    // extra units stored are overwritten later, and they always fit, since 'out' is never further into dest than 'p'
+    // is into the input. A character can run past the end of its block, the next block starts after it.
+#if TEXT_ENCODING_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(bytes, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(bytes, zero));
+        const unsigned int nonAscii = (unsigned int)_mm_movemask_epi8(bytes);
+        if (nonAscii == 0) {
+            p += 16;
+            out += 16;
+            continue;
+        }
+
+        const unsigned char* blockEnd = p + 16;
+        const unsigned int prefix = lowestBit(nonAscii);
+        p += prefix;
+        out += prefix;
+        while (p < blockEnd) {
+            if (*p < 0x80) {
+                *out++ = *p++;
+            } else {
+                p += decodeNonAscii(p, end, out, invalid);
+            }
+        }
+    }
+#else
+    while (end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        if ((word & 0x8080808080808080ULL) == 0) {
+            for (int i = 0; i < 8; i++) {
+                out[i] = p[i];
+            }
+            p += 8;
+            out += 8;
+            continue;
+        }
+
+        const unsigned char* blockEnd = p + 8;
+        while (p < blockEnd) {
+            if (*p < 0x80) {
+                *out++ = *p++;
+            } else {
+                p += decodeNonAscii(p, end, out, invalid);
+            }
+        }
+    }
+#endif
+
+    // The last partial block
+    while (p < end) {
+        if (*p < 0x80) {
+            *out++ = *p++;
+        } else {
+            p += decodeNonAscii(p, end, out, invalid);
+        }
+    }
+    return { (size_t)(out - dest), invalid };
+}
+
+bool appendUtf16AsUtf8(const char16_t* utf16, size_t length, std::string& out) {
+    bool valid = true;
+    for (size_t i = 0; i < length; i++) {
+        uint32_t c = utf16[i];
+        if (c < 0x80) {
+            out += (char)c;
+            continue;
+        }
+        if (c >= 0xD800 && c <= 0xDFFF) {
+            if (c <= 0xDBFF && i + 1 < length && utf16[i + 1] >= 0xDC00 && utf16[i + 1] <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (utf16[i + 1] - 0xDC00);
+                i++;
+            }
+            else {
+                c = REPLACEMENT_CHARACTER;
+                valid = false;
+            }
+        }
+        if (c < 0x800) {
+            out += (char)(0xC0 | (c >> 6));
+        }
+        else if (c < 0x10000) {
+            out += (char)(0xE0 | (c >> 12));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+        }
+        else {
+            out += (char)(0xF0 | (c >> 18));
+            out += (char)(0x80 | ((c >> 12) & 0x3F));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+        }
+        out += (char)(0x80 | (c & 0x3F));
+    }
+    return valid;
+}
+
+#ifdef _WIN32
+bool utf8ToWide(const char* utf8, size_t length, std::wstring& wide) {
+    static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t is expected to be UTF-16 on Windows");
+    wide.resize(length);
+    const Utf16Conversion result = utf8ToUtf16(utf8, length, reinterpret_cast<char16_t*>(&wide[0]));
+    wide.resize(result.length);
+    return result.invalidSequences == 0;
+}
+#endif
+
+long openUtf8File(const std::string& path, const char* mode, FILE*& file, uint64_t* size) {
+#ifdef _WIN32
+    std::wstring widePath, wideMode;
+    if (!utf8ToWide(path.c_str(), path.size(), widePath)) return kESErrBadArgumentList;
+    for (const char* m = mode; *m != '\0'; ++m) wideMode += (wchar_t)*m;
+    file = _wfopen(widePath.c_str(), wideMode.c_str());
+#else
+    file = fopen(path.c_str(), mode);
+#endif
+    if (file == nullptr) return kESErrNoFile;
+
+    if (size != nullptr) {
+#ifdef _WIN32
+        if (_fseeki64(file, 0, SEEK_END) == 0 && _ftelli64(file) >= 0) *size = (uint64_t)_ftelli64(file);
+        _fseeki64(file, 0, SEEK_SET);
+#else
+        if (fseeko(file, 0, SEEK_END) == 0 && ftello(file) >= 0) *size = (uint64_t)ftello(file);
+        fseeko(file, 0, SEEK_SET);
+#endif
+    }
+    return kESErrOK;
+}
+
+long readUtf8File(const std::string& path, std::string& contents) {
+    FILE* file = nullptr;
+    uint64_t size = 0;
+    const long err = openUtf8File(path, "rb", file, &size);
+    if (err != kESErrOK) return err;
+
+    // Sized up front and read straight into the string. The loop after it picks up anything the file grew by, or all
+    // of it if the size wasn't known.
+    contents.clear();
+    char buffer[65536];
+    size_t bytesRead;
+    try {
+        if (size > contents.max_size()) throw std::bad_alloc();
+        if (size > 0) {
+            contents.resize((size_t)size);
+            contents.resize(fread(&contents[0], 1, (size_t)size, file));
+        }
+        while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            contents.append(buffer, bytesRead);
+        }
+    }
+    catch (const std::bad_alloc&) {
+        fclose(file);
+        return THIO_ERR_NO_MEMORY;
+    }
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    return failed ? kESErrIO : kESErrOK;
+}
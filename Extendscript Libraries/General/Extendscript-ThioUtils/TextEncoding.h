@@ -0,0 +1,66 @@
+#pragma once
+
+// TextEncoding.h
+// UTF-8 to UTF-16 conversion for strings going from ExtendScript to platform APIs (clipboard, sound names, file paths),
+// and back for the few strings that come from them (file names in folder listings).
+//
+// ExtendScript passes strings as UTF-8, and the Windows APIs want UTF-16. MultiByteToWideChar has to be called twice
+// (once to measure, once to convert) and the result usually gets copied again. Instead, utf8ToUtf16 validates and
+// converts in one pass, straight into the caller's buffer. A UTF-16 string never has more code units than the UTF-8
+// string has bytes, so a buffer of 'length' units is always big enough and no measuring pass is needed.
+//
+// Blocks of ASCII are converted 16 bytes at a time with SSE2 (8 at a time elsewhere). A block with other characters
+// in it is finished one character at a time, with the valid two and three byte forms decoded inline, before the next
+// block is checked. utf8ToUtf16Reference is the plain one-character-at-a-time version. It gives identical
+// results and is kept to check the fast path against (see HostSimulator/TranscodeBench.cpp).
+//
+// openUtf8File and readUtf8File are the one place files are opened by a path from a script.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+struct Utf16Conversion {
+    size_t length;              // UTF-16 code units written
+    size_t invalidSequences;    // Malformed UTF-8 sequences, each written as U+FFFD
+};
+
+/**
+ * @brief Converts UTF-8 to UTF-16. Malformed sequences (overlong forms, surrogates, values past U+10FFFF, truncated or
+ * stray bytes) are replaced with U+FFFD, one per maximal invalid subpart, as Windows and browsers do.
+ * @param dest Must have room for at least 'length' code units. No terminator is written.
+ */
+Utf16Conversion utf8ToUtf16(const char* utf8, size_t length, char16_t* dest);
+
+// Same result as utf8ToUtf16, without the ASCII fast path
+Utf16Conversion utf8ToUtf16Reference(const char* utf8, size_t length, char16_t* dest);
+
+/**
+ * @brief Appends UTF-16 as UTF-8. Unpaired surrogates, which Windows allows in file names, become U+FFFD.
+ * @return false if there were unpaired surrogates.
+ */
+bool appendUtf16AsUtf8(const char16_t* utf16, size_t length, std::string& out);
+
+#ifdef _WIN32
+/**
+ * @brief Converts UTF-8 to a std::wstring (wchar_t is UTF-16 on Windows).
+ * @return false if the text isn't valid UTF-8, in which case 'wide' holds the text with U+FFFD replacements.
+ */
+bool utf8ToWide(const char* utf8, size_t length, std::wstring& wide);
+#endif
+
+/**
+ * @brief Opens a file by its UTF-8 path, as ExtendScript passes paths. On Windows the path goes to _wfopen, so names
+ * outside the ANSI code page work.
+ * @param mode An fopen mode, e.g. "rb".
+ * @param size If not null, receives the file's length in bytes.
+ * @return kESErrOK, kESErrNoFile if it couldn't be opened, or kESErrBadArgumentList if the path isn't valid UTF-8.
+ */
+long openUtf8File(const std::string& path, const char* mode, FILE*& file, uint64_t* size = nullptr);
+
+/**
+ * @brief Reads a whole file by its UTF-8 path.
+ * @return kESErrOK, the errors from openUtf8File, kESErrIO if reading failed, or THIO_ERR_NO_MEMORY.
+ */
+long readUtf8File(const std::string& path, std::string& contents);
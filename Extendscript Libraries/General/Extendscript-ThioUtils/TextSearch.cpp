@@ -0,0 +1,507 @@
+#include "TextSearch.h"
+#include "BatchCall.h"
+#include "ThioUtils.h"
+#include "ExportStats.h"
+#include "PackedData.h"
+#include "SoSharedLibDefs.h"
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>        // For std::bad_alloc
+#include <regex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXT_SEARCH_SSE2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Patterns held at once. Compiling another one past this releases the oldest.
+#define MAX_COMPILED_PATTERNS 64
+
+// std::regex in libstdc++ and libc++ recurses for every character it matches, so a long enough string overflows the
+// stack and takes the host down with it. With libstdc++ a character costs up to about 110 bytes of stack per byte of
+// the pattern, so strings are limited to what fits in PATTERN_STACK_BUDGET at PATTERN_STACK_PER_CHARACTER bytes per
+// pattern byte. The budget is half of the 1 MB stack a Windows thread gets by default.
+#define PATTERN_STACK_BUDGET (512 * 1024)
+#define PATTERN_STACK_PER_CHARACTER 128
+
+// ------------------------------------------------------------------------------------------------
+// Case-insensitive search
+// ------------------------------------------------------------------------------------------------
+
+static inline unsigned char foldAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+static inline bool equalIgnoreCase(const char* a, const char* b, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (foldAscii((unsigned char)a[i]) != foldAscii((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t findIgnoreCaseReference(const char* text, size_t textLength, const char* needle, size_t needleLength) {
+    if (needleLength > textLength) {
+        return TEXT_NOT_FOUND;
+    }
+    for (size_t i = 0; i + needleLength <= textLength; i++) {
+        if (equalIgnoreCase(text + i, needle, needleLength)) {
+            return i;
+        }
+    }
+    return TEXT_NOT_FOUND;
+}
+
+#if TEXT_SEARCH_SSE2
+static inline unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+// Lowercases the ASCII letters in 16 bytes. Moving 'A' to -128 lets one signed compare find 'A'..'Z'.
+static inline __m128i foldAscii16(__m128i bytes) {
+    const __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8((char)(0x80 - 'A')));
+    const __m128i isUpper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    return _mm_or_si128(bytes, _mm_and_si128(isUpper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+size_t findIgnoreCase(const char* text, size_t textLength, const char* needle, size_t needleLength) {
+    if (needleLength == 0) {
+        return 0;
+    }
+    if (needleLength > textLength) {
+        return TEXT_NOT_FOUND;
+    }
+
+    size_t i = 0;
+#if TEXT_SEARCH_SSE2
+    // Finds the positions where both the first and the last byte of the needle match, 16 at a time, and only compares
+    // the rest of the needle at those. Two bytes rule out nearly every position in real text.
+    const __m128i first = _mm_set1_epi8((char)foldAscii((unsigned char)needle[0]));
+    const __m128i last = _mm_set1_epi8((char)foldAscii((unsigned char)needle[needleLength - 1]));
+    for (; i + needleLength - 1 + 16 <= textLength; i += 16) {
+        const __m128i blockFirst = foldAscii16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)));
+        const __m128i blockLast = foldAscii16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + needleLength - 1)));
+        unsigned int candidates = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+        while (candidates != 0) {
+            const size_t position = i + lowestBit(candidates);
+            if (needleLength <= 2 || equalIgnoreCase(text + position + 1, needle + 1, needleLength - 2)) {
+                return position;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+#endif
+    for (; i + needleLength <= textLength; i++) {
+        if (equalIgnoreCase(text + i, needle, needleLength)) {
+            return i;
+        }
+    }
+    return TEXT_NOT_FOUND;
+}
+
+// ------------------------------------------------------------------------------------------------
+// String lists
+// ------------------------------------------------------------------------------------------------
+
+bool parseTextList(const char* packed, TextList& list) {
+    list.text.clear();
+    list.text.reserve(strlen(packed));
+    list.spans.clear();
+    std::string item;
+    const char* p = packed;
+    while (true) {
+        const char* lineEnd = p + strcspn(p, "\n");
+        const size_t offset = list.text.size();
+        if (memchr(p, '\\', lineEnd - p) == nullptr) {
+            list.text.append(p, lineEnd);
+        }
+        else {
+            if (!unescapeBatchString(p, lineEnd, item)) {
+                return false;
+            }
+            list.text += item;
+        }
+        list.spans.push_back(TextList::Span{ offset, list.text.size() - offset });
+        if (*lineEnd == '\0') {
+            return true;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// Reads a string list argument
+static long parseTextListArg(const TaggedData& arg, TextList& list) {
+    if (arg.type != kTypeString) return kESErrTypeMismatch;
+    if (arg.data.string == nullptr) return kESErrBadArgumentList;
+    if (!parseTextList(arg.data.string, list)) return kESErrConversion;
+    return kESErrOK;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Compiled patterns
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+    struct CompiledPattern {
+        std::regex regex;
+        bool global = false;
+        size_t maxSubjectLength = 0;   // Longest string matched against it, see PATTERN_STACK_BUDGET
+    };
+
+    std::mutex patternMutex;
+    // Shared so a pattern released while another thread is using it stays alive until that call finishes
+    std::map<long, std::shared_ptr<const CompiledPattern>> compiledPatterns;
+    long lastPatternHandle = 0;
+}
+
+void releaseCompiledPatterns() {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    compiledPatterns.clear();
+}
+
+static std::shared_ptr<const CompiledPattern> findPattern(long handle) {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    auto it = compiledPatterns.find(handle);
+    return (it != compiledPatterns.end()) ? it->second : nullptr;
+}
+
+// Reads the handle argument and looks it up
+static long getPatternArg(const TaggedData& arg, std::shared_ptr<const CompiledPattern>& pattern) {
+    if (arg.type != kTypeInteger) return kESErrTypeMismatch;
+    pattern = findPattern(arg.data.intval);
+    return pattern ? kESErrOK : kESErrRange;
+}
+
+// True if the pattern has a non-ASCII byte inside a character class, where matching by byte would give wrong results
+static bool hasNonAsciiInClass(const char* pattern) {
+    bool inClass = false;
+    for (const char* p = pattern; *p != '\0'; ++p) {
+        if (*p == '\\') {
+            if (p[1] == '\0') break;
+            if (inClass && (unsigned char)p[1] >= 0x80) return true;
+            ++p;
+        }
+        else if (*p == '[') {
+            inClass = true;
+        }
+        else if (*p == ']') {
+            inClass = false;
+        }
+        else if (inClass && (unsigned char)*p >= 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends a sub-match as a string, or undefined if the group didn't take part in the match
+static void appendSubMatch(std::string& script, const std::csub_match& match) {
+    if (!match.matched) {
+        script += "undefined";
+        return;
+    }
+    appendJsString(script, match.first, (size_t)(match.second - match.first));
+}
+
+// Same result as String.match: the match and its groups, or with the 'g' flag every match. null if nothing matched.
+static void appendMatch(std::string& script, const CompiledPattern& pattern, const char* begin, const char* end) {
+    if (!pattern.global) {
+        std::cmatch match;
+        if (!std::regex_search(begin, end, match, pattern.regex)) {
+            script += "null";
+            return;
+        }
+        script += "[";
+        for (size_t group = 0; group < match.size(); group++) {
+            if (group > 0) script += ",";
+            appendSubMatch(script, match[group]);
+        }
+        script += "]";
+        return;
+    }
+
+    const size_t start = script.size();
+    script += "[";
+    bool any = false;
+    for (std::cregex_iterator it(begin, end, pattern.regex), done; it != done; ++it) {
+        if (any) script += ",";
+        appendSubMatch(script, (*it)[0]);
+        any = true;
+    }
+    if (!any) {
+        script.resize(start);
+        script += "null";
+        return;
+    }
+    script += "]";
+}
+
+// Same result as String.split with a RegExp: the pieces between matches, with any captured groups in between them
+static void appendSplit(std::string& script, const CompiledPattern& pattern, const char* begin, const char* end) {
+    std::cmatch match;
+
+    script += "[";
+    if (begin == end) {
+        // An empty string splits to nothing only if the pattern matches it
+        if (!std::regex_match(begin, end, match, pattern.regex)) {
+            script += "\"\"";
+        }
+        script += "]";
+        return;
+    }
+
+    bool any = false;
+    const char* pieceStart = begin;   // Start of the piece not yet added
+    const char* searchFrom = begin;
+    while (searchFrom < end) {
+        const auto flags = (searchFrom > begin) ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+        if (!std::regex_search(searchFrom, end, match, pattern.regex, flags)) {
+            break;
+        }
+        const char* matchStart = match[0].first;
+        const char* matchEnd = match[0].second;
+        if (matchStart >= end) {
+            break;
+        }
+        if (matchEnd == pieceStart) {
+            searchFrom = matchStart + 1; // Empty match right where the last one ended doesn't split
+            continue;
+        }
+
+        if (any) script += ",";
+        appendJsString(script, pieceStart, (size_t)(matchStart - pieceStart));
+        for (size_t group = 1; group < match.size(); group++) {
+            script += ",";
+            appendSubMatch(script, match[group]);
+        }
+        any = true;
+        pieceStart = matchEnd;
+        searchFrom = (matchEnd > matchStart) ? matchEnd : matchEnd + 1;
+    }
+    if (any) script += ",";
+    appendJsString(script, pieceStart, (size_t)(end - pieceStart));
+    script += "]";
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Compiles a regular expression to reuse with the pattern*Batch exports.
+ * @param argv JavaScript arguments. Expects (pattern string, flags string). The pattern uses RegExp syntax without the
+ *             slashes. Flags: "g" for every match (match, replace), "i" to ignore ASCII case.
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. The pattern's handle, a positive integer.
+ * @return kESErrOK on success, kESErrSyntax if the pattern isn't valid or has a non-ASCII character inside [...],
+ *         kESErrBadArgumentList for unknown flags, or another error code.
+ *
+ * JavaScript Usage: var handle = externalLibrary.compilePattern("~~\\d+~~$", "");
+ */
+THIO_EXPORT(compilePattern)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 2) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeString || argv[1].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[0].data.string == nullptr || argv[1].data.string == nullptr) return kESErrBadArgumentList;
+
+    auto syntax = std::regex::ECMAScript | std::regex::optimize;
+    bool global = false;
+    for (const char* flag = argv[1].data.string; *flag != '\0'; ++flag) {
+        if (*flag == 'g') global = true;
+        else if (*flag == 'i') syntax |= std::regex::icase;
+        else return kESErrBadArgumentList;
+    }
+    if (hasNonAsciiInClass(argv[0].data.string)) return kESErrSyntax;
+
+    std::shared_ptr<CompiledPattern> pattern;
+    try {
+        pattern = std::make_shared<CompiledPattern>();
+        pattern->regex.assign(argv[0].data.string, syntax);
+        pattern->global = global;
+        pattern->maxSubjectLength = PATTERN_STACK_BUDGET / (PATTERN_STACK_PER_CHARACTER * (strlen(argv[0].data.string) + 3));
+    }
+    catch (const std::regex_error&) {
+        return kESErrSyntax;
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+
+    std::lock_guard<std::mutex> lock(patternMutex);
+    if (compiledPatterns.size() >= MAX_COMPILED_PATTERNS) {
+        compiledPatterns.erase(compiledPatterns.begin());
+    }
+    const long handle = ++lastPatternHandle;
+    compiledPatterns[handle] = pattern;
+
+    retval->type = kTypeInteger;
+    retval->data.intval = handle;
+    return kESErrOK;
+}
+
+/**
+ * @brief Releases a pattern from compilePattern.
+ * @param argv JavaScript arguments. Expects the handle.
+ * @param argc Argument count. Should be 1.
+ * @param retval Return value. True if the handle was still held.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: externalLibrary.releasePattern(handle);
+ */
+THIO_EXPORT(releasePattern)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 1) return kESErrBadArgumentList;
+    if (argv[0].type != kTypeInteger) return kESErrTypeMismatch;
+
+    std::lock_guard<std::mutex> lock(patternMutex);
+    const bool found = compiledPatterns.erase(argv[0].data.intval) > 0;
+    retval->type = kTypeBool;
+    retval->data.intval = found ? 1 : 0;
+    return kESErrOK;
+}
+
+// The batch exports below share their setup and error handling. 'append' adds one string's result to the script.
+template <typename AppendResult>
+static long runPatternBatch(TaggedData* argv, long argc, long expectedArgc, TaggedData* retval, AppendResult append) {
+    retval->type = kTypeUndefined;
+    if (argc != expectedArgc) return kESErrBadArgumentList;
+
+    std::shared_ptr<const CompiledPattern> pattern;
+    long err = getPatternArg(argv[0], pattern);
+    if (err != kESErrOK) return err;
+    TextList items;
+    err = parseTextListArg(argv[1], items);
+    if (err != kESErrOK) return err;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (items.length(i) > pattern->maxSubjectLength) return kESErrRange;
+    }
+
+    try {
+        std::string script = "[";
+        for (size_t i = 0; i < items.size(); i++) {
+            if (i > 0) script += ",";
+            append(script, *pattern, items.data(i), items.data(i) + items.length(i));
+        }
+        script += "]";
+        return setScriptResult(retval, script);
+    }
+    catch (const std::regex_error&) {
+        return kESErrRange; // Too complex to match against this input (error_complexity / error_stack)
+    }
+    catch (const std::bad_alloc&) {
+        return THIO_ERR_NO_MEMORY;
+    }
+}
+
+/**
+ * @brief Tests a compiled pattern against many strings, like RegExp.test.
+ * @param argv JavaScript arguments. Expects (pattern handle, string list). See TextSearch.h for the list format.
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. A script that evaluates to an array of booleans, one per string.
+ * @return kESErrOK on success, kESErrRange for an unknown handle or a string too long for the pattern (see TextSearch.h),
+ *         or another error code.
+ *
+ * JavaScript Usage: var hasNumber = externalLibrary.patternTestBatch(handle, "Marker 1\nIntro");   // [true,false]
+ */
+THIO_EXPORT(patternTestBatch)(TaggedData* argv, long argc, TaggedData* retval) {
+    return runPatternBatch(argv, argc, 2, retval, [](std::string& script, const CompiledPattern& pattern, const char* begin, const char* end) {
+        script += std::regex_search(begin, end, pattern.regex) ? "true" : "false";
+    });
+}
+
+/**
+ * @brief Matches a compiled pattern against many strings, like String.match.
+ * @param argv JavaScript arguments. Expects (pattern handle, string list).
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. A script that evaluates to an array with one entry per string: null if there was no
+ *               match, otherwise the match and its groups, or every match for a pattern with the 'g' flag.
+ * @return kESErrOK on success, kESErrRange for an unknown handle or a string too long for the pattern (see TextSearch.h),
+ *         or another error code.
+ *
+ * JavaScript Usage: var matches = externalLibrary.patternMatchBatch(handle, "00:01:02\n00;01;02");
+ */
+THIO_EXPORT(patternMatchBatch)(TaggedData* argv, long argc, TaggedData* retval) {
+    return runPatternBatch(argv, argc, 2, retval, appendMatch);
+}
+
+/**
+ * @brief Replaces matches of a compiled pattern in many strings, like String.replace. Only the first match is replaced
+ * unless the pattern has the 'g' flag.
+ * @param argv JavaScript arguments. Expects (pattern handle, string list, replacement string). The replacement
+ *             understands $&, $1..$99, $`, $' and $$ like in String.replace.
+ * @param argc Argument count. Should be 3.
+ * @param retval Return value. A script that evaluates to an array of the new strings.
+ * @return kESErrOK on success, kESErrRange for an unknown handle or a string too long for the pattern (see TextSearch.h),
+ *         or another error code.
+ *
+ * JavaScript Usage: var cleaned = externalLibrary.patternReplaceBatch(handle, "Intro~~1~~\nOutro~~2~~", "");
+ */
+THIO_EXPORT(patternReplaceBatch)(TaggedData* argv, long argc, TaggedData* retval) {
+    if (argc == 3 && (argv[2].type != kTypeString || argv[2].data.string == nullptr)) return kESErrTypeMismatch;
+    const char* replacement = (argc == 3) ? argv[2].data.string : "";
+    return runPatternBatch(argv, argc, 3, retval, [replacement](std::string& script, const CompiledPattern& pattern, const char* begin, const char* end) {
+        std::string replaced;
+        const auto flags = pattern.global ? std::regex_constants::format_default : std::regex_constants::format_first_only;
+        std::regex_replace(std::back_inserter(replaced), begin, end, pattern.regex, replacement, flags);
+        appendJsString(script, replaced.data(), replaced.size());
+    });
+}
+
+/**
+ * @brief Splits many strings on a compiled pattern, like String.split. Groups captured by the pattern are included
+ * between the pieces.
+ * @param argv JavaScript arguments. Expects (pattern handle, string list).
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. A script that evaluates to an array of arrays of strings.
+ * @return kESErrOK on success, kESErrRange for an unknown handle or a string too long for the pattern (see TextSearch.h),
+ *         or another error code.
+ *
+ * JavaScript Usage: var parts = externalLibrary.patternSplitBatch(handle, "00:01:02:03\n00;01;02;03");   // pattern "[:;]"
+ */
+THIO_EXPORT(patternSplitBatch)(TaggedData* argv, long argc, TaggedData* retval) {
+    return runPatternBatch(argv, argc, 2, retval, appendSplit);
+}
+
+/**
+ * @brief Checks which of many strings contain a substring, ignoring ASCII case.
+ * @param argv JavaScript arguments. Expects (string list, substring).
+ * @param argc Argument count. Should be 2.
+ * @param retval Return value. A script that evaluates to an array of booleans, one per string.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var found = externalLibrary.containsIgnoreCaseBatch("Intro.WAV\nclip.mov", ".wav");   // [true,false]
+ */
+THIO_EXPORT(containsIgnoreCaseBatch)(TaggedData* argv, long argc, TaggedData* retval) {
+    retval->type = kTypeUndefined;
+    if (argc != 2) return kESErrBadArgumentList;
+    TextList items;
+    long err = parseTextListArg(argv[0], items);
+    if (err != kESErrOK) return err;
+    if (argv[1].type != kTypeString) return kESErrTypeMismatch;
+    if (argv[1].data.string == nullptr) return kESErrBadArgumentList;
+
+    const char* needle = argv[1].data.string;
+    const size_t needleLength = strlen(needle);
+    std::string script = "[";
+    script.reserve(items.size() * 6 + 2);
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) script += ",";
+        script += (findIgnoreCase(items.data(i), items.length(i), needle, needleLength) != TEXT_NOT_FOUND) ? "true" : "false";
+    }
+    script += "]";
+    return setScriptResult(retval, script);
+}
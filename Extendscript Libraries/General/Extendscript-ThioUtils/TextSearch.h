@@ -0,0 +1,59 @@
+#pragma once
+
+// TextSearch.h
+// Case-insensitive substring search, and compiled regular expressions that scripts can reuse across calls.
+//
+// Scripts that clean up marker names, clip names and timestamps run the same few RegExps over every string, one
+// call at a time. The pattern exports compile a pattern once and return a handle to it, then match, test, replace or
+// split a whole list of strings per call. Patterns use std::regex with the ECMAScript grammar, so the syntax and the
+// replacement strings ($1, $&, ...) are the same as in ExtendScript.
+//
+// Matching works on the UTF-8 bytes. Non-ASCII text in a pattern matches literally, but '.', character classes and
+// the 'i' flag only understand ASCII, so a non-ASCII character can't go inside [...]. compilePattern rejects those.
+//
+// std::regex recurses for every character it matches, so each string in a batch is limited to a length that leaves
+// the stack safe: about 400 bytes for a short pattern like "(a|b)*c", fewer for longer patterns. A longer string fails
+// the whole batch with kESErrRange, so ThioUtilsLib.jsx's pattern functions return null and the script falls back to
+// its own RegExp.
+//
+// String lists are sent as one string with a line per item, where backslashes and newlines inside an item are
+// escaped as \\ and \n (the same escapes callBatch uses). ThioUtilsLib.jsx builds these.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define TEXT_NOT_FOUND ((size_t)-1)
+
+/**
+ * @brief Finds 'needle' in 'text', treating ASCII letters as equal regardless of case. Other bytes must match exactly.
+ * Checks 16 positions at a time with SSE2.
+ * @return The byte offset of the first match, or TEXT_NOT_FOUND. An empty needle is found at 0.
+ */
+size_t findIgnoreCase(const char* text, size_t textLength, const char* needle, size_t needleLength);
+
+// Same result as findIgnoreCase, one position at a time
+size_t findIgnoreCaseReference(const char* text, size_t textLength, const char* needle, size_t needleLength);
+
+// A parsed string list. The unescaped items are stored one after another in 'text', at the offsets in 'spans'.
+struct TextList {
+    struct Span {
+        size_t offset;
+        size_t length;
+    };
+    std::string text;
+    std::vector<Span> spans;
+
+    size_t size() const { return spans.size(); }
+    const char* data(size_t i) const { return text.data() + spans[i].offset; }
+    size_t length(size_t i) const { return spans[i].length; }
+};
+
+/**
+ * @brief Splits a string list (one escaped item per line, see above) into its items. An empty string is one empty item.
+ * @return false if an item has an unknown escape.
+ */
+bool parseTextList(const char* packed, TextList& list);
+
+// Frees all compiled patterns. Called from ESTerminate.
+void releaseCompiledPatterns();
@@ -1,51 +1,178 @@
 #include "ThioUtils.h"
+#include "Exports.h"
+#include "ExportStats.h"
+#include "ClipboardWriter.h"
+#include "JobEngine.h"
+#include "SoundPlayer.h"
+#include "PackedData.h"
+#include "ProjectMetadata.h"
+#include "ResultMemory.h"
+#include "ResultCache.h"
+#include "ScriptBundle.h"
+#include "SessionStore.h"
+#include "TextSearch.h"
 #include "VERSION.h"
 #include "SoSharedLibDefs.h"
 #include <vector>
 #include <string>     // For std::wstring, std::string manipulations
 #include <algorithm>  // For std::transform
 #include <stdexcept>  // For std::bad_alloc
+#include <cstring>    // For strlen, strncmp
 
-// Include platform specific headers
-// ---------------- Windows ----------------
-#ifdef _WIN32
-#include <windows.h>
-#include <mmsystem.h> // For PlaySound
-#include <Shlwapi.h>
-#include <pathcch.h> // For PathCchAppend. Using this instead of PathAppendW for safety and modernity.
-#pragma comment(lib, "Winmm.lib")
-#pragma comment(lib, "Pathcch.lib") // Needed for PathCchAppend
-// ---------------- Apple ----------------
-#elif defined(__APPLE__)
-#include <AudioToolbox/AudioToolbox.h>
-#endif
+//--------------------------------------------------------------------------------------
+//---------------------------------- Export Registry -----------------------------------
+//--------------------------------------------------------------------------------------
 
-// Helper function for case-insensitive substring search (needed for ".wav")
-// Returns true if 'sub' is found in 'str', ignoring case.
-static bool findSubstringIgnoreCase(const std::string& str, const std::string& sub) {
-    if (sub.length() > str.length()) {
-        return false;
+// Every function exposed to ExtendScript, with its signature. ESInitialize's name list is built from this at compile
+// time, and callBatch uses it to look up functions by name. getStats reports its counters in this order.
+// Typed exports (ExportBinding.h) take their signature from the typed function. Keep related functions grouped together.
+static constexpr ExportEntry exportTable[] = {
+    { "systemBeep",               "u",                                           systemBeep },
+    { "playSoundAlias",           "s",                                           playSoundAlias },
+    { "preloadSound",             "s",                                           preloadSound },
+    { "copyTextToClipboard",      "s",                                           copyTextToClipboard },
+    { "copyTextToClipboardAsync", "s",                                           copyTextToClipboardAsync },
+    { "getClipboardStatus",       "f",                                           getClipboardStatus },
+    { "getVersion",               "s",                                           getVersion },
+
+    { "fitEllipse",               "a",                                           fitEllipse },
+    { "fitEllipseBatch",          "s",                                           fitEllipseBatch },
+
+    { "ticksToFramesBatch",       exportSignature<ticksToFramesBatchTyped>,      ticksToFramesBatch },
+    { "framesToTicksBatch",       exportSignature<framesToTicksBatchTyped>,      framesToTicksBatch },
+    { "roundTicksToFrameBatch",   exportSignature<roundTicksToFrameBatchTyped>,  roundTicksToFrameBatch },
+    { "ticksToTimecodeBatch",     exportSignature<ticksToTimecodeBatchTyped>,    ticksToTimecodeBatch },
+    { "ticksToSecondsBatch",      exportSignature<ticksToSecondsBatchTyped>,     ticksToSecondsBatch },
+    { "addTicks",                 exportSignature<addTicksTyped>,                addTicks },
+    { "subtractTicks",            exportSignature<subtractTicksTyped>,           subtractTicks },
+
+    { "callBatch",                "s",                                           callBatch },
+    { "callChunked",              "s",                                           callChunked },
+    { "readResultChunk",          "dd",                                          readResultChunk },
+    { "releaseResult",            "d",                                           releaseResult },
+
+    { "parseJson",                "ss",                                          parseJson },
+    { "parseJsonFile",            "ss",                                          parseJsonFile },
+    { "getJsonError",             "",                                            getJsonError },
+    { "recordsToJson",            "ss",                                          recordsToJson },
+
+    { "sortOrder",                "sd",                                          sortOrder },
+
+    { "evaluateKeyframes",        exportSignature<evaluateKeyframesTyped>,       evaluateKeyframes },
+    { "resampleKeyframes",        exportSignature<resampleKeyframesTyped>,       resampleKeyframes },
+    { "simplifyKeyframes",        exportSignature<simplifyKeyframesTyped>,       simplifyKeyframes },
+
+    { "compilePattern",           "ss",                                          compilePattern },
+    { "releasePattern",           "d",                                           releasePattern },
+    { "patternTestBatch",         "ds",                                          patternTestBatch },
+    { "patternMatchBatch",        "ds",                                          patternMatchBatch },
+    { "patternReplaceBatch",      "dss",                                         patternReplaceBatch },
+    { "patternSplitBatch",        "ds",                                          patternSplitBatch },
+    { "containsIgnoreCaseBatch",  "ss",                                          containsIgnoreCaseBatch },
+
+    { "cacheOpen",                "s",                                           cacheOpen },
+    { "cachePut",                 "sss",                                         cachePut },
+    { "cacheGet",                 "ss",                                          cacheGet },
+    { "cacheInfo",                "",                                            cacheInfo },
+    { "cacheCompact",             "",                                            cacheCompact },
+    { "cacheClose",               "",                                            cacheClose },
+
+    { "readProjectFile",          exportSignature<readProjectFileTyped>,         readProjectFile },
+    { "extractMetadata",          exportSignature<extractMetadataTyped>,         extractMetadata },
+    { "clearMetadataMemo",        "",                                            clearMetadataMemo },
+
+    { "sessionSet",               "saf",                                         sessionSet },
+    { "sessionGet",               "s",                                           sessionGet },
+    { "sessionGetBuffer",         "sa",                                          sessionGetBuffer },
+    { "sessionDelete",            exportSignature<sessionDeleteTyped>,           sessionDelete },
+    { "sessionClear",             exportSignature<sessionClearTyped>,            sessionClear },
+    { "sessionSetLimit",          exportSignature<sessionSetLimitTyped>,         sessionSetLimit },
+    { "sessionInfo",              exportSignature<sessionInfoTyped>,             sessionInfo },
+
+    { "getIncludeBundle",         "ss",                                          getIncludeBundle },
+    { "clearIncludeCache",        exportSignature<clearIncludeCacheTyped>,       clearIncludeCache },
+
+    { "statPaths",                exportSignature<statPathsTyped>,               statPaths },
+    { "listFolder",               exportSignature<listFolderTyped>,              listFolder },
+    { "reserveFileName",          exportSignature<reserveFileNameTyped>,         reserveFileName },
+
+    { "startJob",                 exportSignature<startJobTyped>,                startJob },
+    { "pollJob",                  exportSignature<pollJobTyped>,                 pollJob },
+    { "cancelJob",                exportSignature<cancelJobTyped>,               cancelJob },
+    { "getJobResult",             "d",                                           getJobResult },
+
+    { "getStats",                 "s",                                           getStats },
+    { "resetStats",               "",                                            resetStats },
+};
+
+const ExportEntry* getExportTable(size_t& count) {
+    count = sizeof(exportTable) / sizeof(exportTable[0]);
+    return exportTable;
+}
+
+const ExportEntry* findExport(const char* name, size_t nameLength) {
+    for (const ExportEntry& entry : exportTable) {
+        // The lengths were worked out at compile time, so most entries are skipped without looking at the text
+        if (entry.nameLength == nameLength && memcmp(entry.name, name, nameLength) == 0) {
+            return &entry;
+        }
     }
-    auto it = std::search(
-        str.begin(), str.end(),
-        sub.begin(), sub.end(),
-        [](char ch1, char ch2) { return std::toupper(ch1) == std::toupper(ch2); }
-    );
-    return (it != str.end());
+    return nullptr;
 }
 
+// ESInitialize's list of every export as name_signature (or just the name for no arguments), separated by commas,
+// e.g. "systemBeep_u,playSoundAlias_s,...". Built at compile time from exportTable.
+static constexpr size_t exportNameListLength() {
+    size_t length = 0;
+    for (const ExportEntry& entry : exportTable) {
+        const size_t signatureLength = std::char_traits<char>::length(entry.signature);
+        length += entry.nameLength + (signatureLength > 0 ? signatureLength + 1 : 0) + 1; // Plus the comma, or the final '\0'
+    }
+    return length;
+}
+
+struct ExportNameList {
+    char text[exportNameListLength()];
+};
+
+static constexpr ExportNameList buildExportNameList() {
+    ExportNameList list = {};
+    size_t position = 0;
+    for (const ExportEntry& entry : exportTable) {
+        if (position > 0) list.text[position++] = ',';
+        for (size_t i = 0; i < entry.nameLength; i++) list.text[position++] = entry.name[i];
+        if (entry.signature[0] != '\0') {
+            list.text[position++] = '_';
+            for (const char* c = entry.signature; *c != '\0'; c++) list.text[position++] = *c;
+        }
+    }
+    list.text[position] = '\0';
+    return list;
+}
+
+static constexpr ExportNameList exportNameList = buildExportNameList();
+
 //--------------------------------------------------------------------------------------
 //-------------------------- Required Extendscript functions ---------------------------
 //--------------------------------------------------------------------------------------
 
 extern "C" THIOUTILS_API char* ESInitialize(const TaggedData** argv, long argc)
 {
-    static char funcNames[] = "systemBeep_u,playSoundAlias_s,copyTextToClipboard_s,getVersion_s";
-    return funcNames;
+    // ExtendScript only reads this and doesn't free it, so it can be the constant built from exportTable
+    return const_cast<char*>(exportNameList.text);
 }
 
 extern "C" THIOUTILS_API void ESTerminate() {
-	// Free any resources if we had allocated any.
+	// Free any resources if we had allocated any. Jobs go first, since running ones may still use the rest.
+	shutdownJobEngine();
+	shutdownClipboardWriter();
+	shutdownSoundPlayer();
+	releaseChunkedResults();
+	releaseCompiledPatterns();
+	releaseResultCache();
+	releaseMetadataMemo();
+	releaseSessionStore();
+	releaseIncludeCache();
 }
 
 extern "C" THIOUTILS_API long ESGetVersion() {
@@ -54,9 +181,9 @@ extern "C" THIOUTILS_API long ESGetVersion() {
 }
 
 extern "C" THIOUTILS_API void ESFreeMem(void* p) {
-    // Use free() as it matches memory allocated by malloc/strdup, which is commonly used for returning strings in these scenarios.
+    // Returned strings come from ResultMemory.cpp, which recycles pooled buffers, ignores interned strings, and uses free() for the rest
     if (p != nullptr) { // Add a null check for safety
-        free(p);
+        releaseResultMemory(p);
     }
 }
 
@@ -72,7 +199,7 @@ extern "C" THIOUTILS_API void ESFreeMem(void* p) {
 
 /**
  * @brief Play system beep sound based on the provided type.
- * @param argv JavaScript arguments. Expects one unsigned integer (uint).
+ * @param argv JavaScript arguments. Expects one unsigned integer (uint) on Windows. Ignored on Mac.
  * @param argc Argument count. Should be 1.
  * @param retval Return value (not used here).
  * @return kESErrOK on success, or an error code.
@@ -86,44 +213,37 @@ extern "C" THIOUTILS_API void ESFreeMem(void* p) {
  * 0x00000030 : MB_ICONWARNING / MB_ICONEXCLAMATION
  * 0x00000040 : MB_ICONINFORMATION / MB_ICONASTERISK
  */
-extern "C" THIOUTILS_API long systemBeep(TaggedData* argv, long argc, TaggedData* retval) {
+THIO_EXPORT(systemBeep)(TaggedData* argv, long argc, TaggedData* retval) {
     // Set retval to undefined by default
     retval->type = kTypeUndefined;
 
+    unsigned int uType = 0; // Variable to hold the sound type
+
 #ifdef _WIN32
     // Check if exactly one argument was passed
     if (argc != 1) {
         return kESErrBadArgumentList; // Error: Incorrect number of arguments
     }
 
-    UINT uType = 0; // Variable to hold the sound type
-
     if (argv[0].type == kTypeUInteger || argv[0].type == kTypeInteger) {
-        // Extract the integer value and cast it to UINT.
+        // Extract the integer value and cast it to unsigned.
         // For positive kTypeInteger, this works directly.
         // For negative kTypeInteger, it will wrap around (standard C++ unsigned cast behavior).
-        uType = (UINT)argv[0].data.intval;
+        uType = (unsigned int)argv[0].data.intval;
     }
     else {
         // Reject other types like double, string, bool, etc.
         return kESErrTypeMismatch; // Error: Incorrect argument type
     }
-
-    // Call MessageBeep with the extracted type
-    MessageBeep(uType);
-
-#elif defined(__APPLE__)
-    // Keep the original Mac behavior
-    AudioServicesPlaySystemSound(kSystemSoundID_UserPreferredAlert);
 #endif
+    // Elsewhere the type is ignored and the argument isn't checked, as before: the Mac always plays the user's alert
 
-    return kESErrOK; // Success
+    // Played by the sound thread (MessageBeep on Windows), see SoundPlayer.cpp
+    return queueBeep(uType);
 }
 
-extern "C" THIOUTILS_API long getVersion(TaggedData* argv, long argc, TaggedData* retval) {
-    retval->type = kTypeString;
-    retval->data.string = _strdup(MYPROJECT_VERSION_STRING); // Allocate memory for the string
-    return kESErrOK;  // Return success code
+THIO_EXPORT(getVersion)(TaggedData* argv, long argc, TaggedData* retval) {
+    return setInternedStringResult(retval, MYPROJECT_VERSION_STRING); // Constant, so it's returned without copying
 }
 
 /**
@@ -143,70 +263,15 @@ extern "C" THIOUTILS_API long getVersion(TaggedData* argv, long argc, TaggedData
  * externalLibrary.playSoundAlias("notify.wav");     // Plays C:\Windows\Media\notify.wav
  * externalLibrary.playSoundAlias("C:\\Windows\\Media\\notify.wav"); // Throws Error (BadArgumentList)
  */
-extern "C" THIOUTILS_API long playSoundAlias(TaggedData* argv, long argc, TaggedData* retval) {
+THIO_EXPORT(playSoundAlias)(TaggedData* argv, long argc, TaggedData* retval) {
     retval->type = kTypeUndefined;
 
-#ifdef _WIN32
     if (argc != 1) return kESErrBadArgumentList;
     if (argv[0].type != kTypeString) return kESErrTypeMismatch;
 
-    const char* inputUtf8 = argv[0].data.string;
-    if (inputUtf8 == nullptr || inputUtf8[0] == '\0') return kESErrBadArgumentList;
-
-    std::string inputStr(inputUtf8);
-    DWORD dwFlags = 0;
-    std::vector<wchar_t> widePathOrAlias;
-
-    // Explicitly reject strings containing path separators. We will only allow filenames
-    if (inputStr.find('\\') != std::string::npos || inputStr.find('/') != std::string::npos) {
-        return kESErrBadArgumentList; // Error: Input string contains path separators
-    }
-
-    // Now determine if the path-separator-free input is likely a filename or an alias
-    bool isLikelyFilename = findSubstringIgnoreCase(inputStr, ".wav");
-    // (Removed path separator check here as it's done above)
-
-    if (isLikelyFilename) {
-        // --- Handle as Filename ---
-        dwFlags = SND_FILENAME | SND_ASYNC | SND_NODEFAULT | SND_SYSTEM;
-
-        wchar_t winDir[MAX_PATH];
-        if (GetWindowsDirectoryW(winDir, MAX_PATH) == 0) return kESErrConversion;
-
-        wchar_t mediaPath[MAX_PATH];
-        if (FAILED(PathCchAppend(winDir, MAX_PATH, L"Media"))) return kESErrConversion;
-
-        int fnWideCharCount = MultiByteToWideChar(CP_UTF8, 0, inputUtf8, -1, NULL, 0);
-        if (fnWideCharCount == 0) return kESErrConversion;
-        std::vector<wchar_t> wideFilename(fnWideCharCount);
-        if (MultiByteToWideChar(CP_UTF8, 0, inputUtf8, -1, wideFilename.data(), fnWideCharCount) == 0) return kESErrConversion;
-
-        wcscpy_s(mediaPath, MAX_PATH, winDir);
-        if (FAILED(PathCchAppend(mediaPath, MAX_PATH, wideFilename.data()))) return kESErrConversion;
-
-        size_t finalLen = wcslen(mediaPath) + 1;
-        widePathOrAlias.resize(finalLen);
-        wcscpy_s(widePathOrAlias.data(), finalLen, mediaPath);
-
-    }
-    else {
-        // --- Handle as Alias ---
-        dwFlags = SND_ALIAS | SND_ASYNC | SND_NODEFAULT | SND_SYSTEM;
-
-        int wideCharCount = MultiByteToWideChar(CP_UTF8, 0, inputUtf8, -1, NULL, 0);
-        if (wideCharCount == 0) return kESErrConversion;
-
-        widePathOrAlias.resize(wideCharCount);
-        if (MultiByteToWideChar(CP_UTF8, 0, inputUtf8, -1, widePathOrAlias.data(), wideCharCount) == 0) return kESErrConversion;
-    }
-
-    PlaySoundW(widePathOrAlias.data(), NULL, dwFlags);
-
-#elif defined(__APPLE__)
-    // No implementation for Mac
-#endif
-
-    return kESErrOK;
+    // Resolving the name (cached after the first time) happens here so bad names still throw, then the sound thread plays it.
+    // Repeats of the same sound in quick succession are skipped, see SoundPlayer.h
+    return queueSound(argv[0].data.string);
 }
 
 
@@ -219,7 +284,7 @@ extern "C" THIOUTILS_API long playSoundAlias(TaggedData* argv, long argc, Tagged
  *
  * JavaScript Usage: externalLibrary.copyTextToClipboard("Text to copy");
  */
-extern "C" THIOUTILS_API long copyTextToClipboard(TaggedData* argv, long argc, TaggedData* retval) {
+THIO_EXPORT(copyTextToClipboard)(TaggedData* argv, long argc, TaggedData* retval) {
     retval->type = kTypeInteger; // Set the type once for all integer status code returns via retval
 
     if (argc != 1) {
@@ -264,73 +329,12 @@ extern "C" THIOUTILS_API long copyTextToClipboard(TaggedData* argv, long argc, T
         }
     #endif
 
-#ifdef _WIN32
-    // Convert UTF-8 string from ExtendScript to UTF-16 (WCHAR) for Windows API
-    int wideCharCount = MultiByteToWideChar(CP_UTF8, 0, textToCopyUtf8, -1, NULL, 0);
-    if (wideCharCount == 0) {
-        retval->data.intval = kESErrConversion; // kESErrConversion is positive, no change needed unless you want to map it too
-        return kESErrConversion;
-    }
-
-    std::vector<wchar_t> wideText;
-    try {
-        wideText.resize(wideCharCount); // Allocate memory for the vector
+    // The platform clipboard calls are in ClipboardWriter.cpp. Mac returns THIO_ERR_NOT_IMPLEMENTED from there.
+    const long result = writeClipboardText(textToCopyUtf8, strlen(textToCopyUtf8));
+    if (result != kESErrOK) {
+        retval->data.intval = result;
+        return result;
     }
-    catch (const std::bad_alloc&) {
-        retval->data.intval = THIO_ERR_NO_MEMORY;
-        return THIO_ERR_NO_MEMORY;
-    }
-
-    if (MultiByteToWideChar(CP_UTF8, 0, textToCopyUtf8, -1, wideText.data(), wideCharCount) == 0) {
-        retval->data.intval = kESErrConversion; // kESErrConversion is positive
-        return kESErrConversion;
-    }
-
-    // Open the clipboard
-    if (!OpenClipboard(NULL)) {
-        retval->data.intval = THIO_ERR_CLIPBOARD_BUSY;
-        return THIO_ERR_CLIPBOARD_BUSY;
-    }
-
-    // Empty the clipboard
-    EmptyClipboard();
-
-    // Allocate global memory for the string
-    HGLOBAL hGlobal = GlobalAlloc(GMEM_MOVEABLE, wideText.size() * sizeof(wchar_t));
-    if (hGlobal == NULL) {
-        CloseClipboard();
-        retval->data.intval = THIO_ERR_NO_MEMORY;
-        return THIO_ERR_NO_MEMORY;
-    }
-
-    // Lock the memory and copy the string
-    LPVOID pGlobal = GlobalLock(hGlobal);
-    if (pGlobal == NULL) {
-        GlobalFree(hGlobal);
-        CloseClipboard();
-        retval->data.intval = THIO_ERR_CLIPBOARD_LOCK_FAILED;
-        return THIO_ERR_CLIPBOARD_LOCK_FAILED;
-    }
-    memcpy(pGlobal, wideText.data(), wideText.size() * sizeof(wchar_t));
-    GlobalUnlock(hGlobal);
-
-    // Set the clipboard data
-    if (SetClipboardData(CF_UNICODETEXT, hGlobal) == NULL) {
-        GlobalFree(hGlobal); // Free if SetClipboardData fails and system does not take ownership
-        CloseClipboard();
-        retval->data.intval = THIO_ERR_CLIPBOARD_SET_FAILED;
-        return THIO_ERR_CLIPBOARD_SET_FAILED;
-    }
-
-    // Note: Do not call GlobalFree(hGlobal) after a successful SetClipboardData, as the system now owns that memory.
-    // It will be freed when EmptyClipboard is called again or the clipboard is closed by another app.
-    CloseClipboard();
-    // If all Windows operations succeeded, we fall through to the final success return
-
-#elif defined(__APPLE__)
-    retval->data.intval = THIO_ERR_NOT_IMPLEMENTED; // Use your custom positive error code
-    return THIO_ERR_NOT_IMPLEMENTED;
-#endif
 
     // Success case
     retval->data.intval = kESErrOK;
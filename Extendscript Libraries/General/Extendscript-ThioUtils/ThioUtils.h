@@ -1,8 +1,13 @@
 
-#if defined THIOUTILS_EXPORTS
-	#define THIOUTILS_API __declspec(dllexport)
-#elif defined (__APPLE__) __attribute__((visibility("default")))
-	#define THIOUTILS_API
+#if defined(_WIN32)
+	#if defined THIOUTILS_EXPORTS
+		#define THIOUTILS_API __declspec(dllexport)
+	#else
+		#define THIOUTILS_API
+	#endif
+#else
+	// Mac, and the Linux build used for profiling outside the Adobe apps (see HostSimulator/ThioUtilsHost.cpp)
+	#define THIOUTILS_API __attribute__((visibility("default")))
 #endif
 
 // General Errors Custom Versions - Still throw exceptions but they can be caught unlike the built in Extendscript fatal errors
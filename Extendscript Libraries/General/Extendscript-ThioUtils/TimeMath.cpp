@@ -0,0 +1,338 @@
+#include "TimeMath.h"
+#include "ThioUtils.h"
+#include "Exports.h"
+#include "PackedData.h"
+#include "SoSharedLibDefs.h"
+#include <climits>
+#include <cstring>
+#include <vector>
+
+bool parseTicksPerFrame(const char* str, long long& ticksPerFrame) {
+    if (str == nullptr) {
+        return false;
+    }
+
+    const char* slash = strchr(str, '/');
+    if (slash == nullptr) {
+        // Plain timebase, already in ticks per frame
+        return parseInt64String(str, ticksPerFrame) && ticksPerFrame > 0;
+    }
+
+    // Rational frames per second, numerator/denominator. Ticks per frame = TICKS_PER_SECOND * den / num
+    std::string numeratorStr(str, slash);
+    long long numerator = 0;
+    long long denominator = 0;
+    if (!parseInt64String(numeratorStr.c_str(), numerator) || !parseInt64String(slash + 1, denominator)) {
+        return false;
+    }
+    if (numerator <= 0 || denominator <= 0 || denominator > LLONG_MAX / TICKS_PER_SECOND) {
+        return false;
+    }
+    const long long scaled = TICKS_PER_SECOND * denominator;
+    if (scaled % numerator != 0) {
+        return false; // Not a whole number of ticks per frame, so it's not a rate Premiere could be using
+    }
+    ticksPerFrame = scaled / numerator;
+    return ticksPerFrame > 0;
+}
+
+bool addTicksChecked(long long a, long long b, long long& result) {
+    if ((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b)) {
+        return false;
+    }
+    result = a + b;
+    return true;
+}
+
+bool subtractTicksChecked(long long a, long long b, long long& result) {
+    if ((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b)) {
+        return false;
+    }
+    result = a - b;
+    return true;
+}
+
+bool framesToTicksChecked(long long frames, long long ticksPerFrame, long long& ticks) {
+    if (ticksPerFrame <= 0) {
+        return false;
+    }
+    if (frames > LLONG_MAX / ticksPerFrame || frames < LLONG_MIN / ticksPerFrame) {
+        return false;
+    }
+    ticks = frames * ticksPerFrame;
+    return true;
+}
+
+// Division that rounds toward negative infinity, unlike C++'s '/' which truncates toward zero
+static long long floorDivide(long long value, long long divisor) {
+    long long quotient = value / divisor;
+    if ((value % divisor != 0) && ((value < 0) != (divisor < 0))) {
+        quotient--;
+    }
+    return quotient;
+}
+
+long long ticksToFrameIndex(long long ticks, long long ticksPerFrame, int rounding) {
+    const long long frame = floorDivide(ticks, ticksPerFrame);
+    const long long remainder = ticks - frame * ticksPerFrame; // Always 0 <= remainder < ticksPerFrame
+
+    if (remainder == 0) {
+        return frame;
+    }
+    switch (rounding) {
+    case FRAME_ROUND_UP:
+        return frame + 1;
+    case FRAME_ROUND_NEAREST:
+        // Same as "remainder < ticksPerFrame / 2" in the JS, without the fraction for odd timebases
+        return (remainder < ticksPerFrame - remainder) ? frame : frame + 1;
+    default:
+        return frame;
+    }
+}
+
+double ticksToSecondsExact(long long ticks) {
+    const long long wholeSeconds = floorDivide(ticks, TICKS_PER_SECOND);
+    const long long remainder = ticks - wholeSeconds * TICKS_PER_SECOND;
+    return (double)wholeSeconds + (double)remainder / (double)TICKS_PER_SECOND;
+}
+
+// Appends a non-negative integer padded with zeros to at least 'width' digits
+static void appendPadded(std::string& out, long long value, int width) {
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value > 0);
+    for (int i = count; i < width; i++) {
+        out += '0';
+    }
+    while (count > 0) {
+        out += digits[--count];
+    }
+}
+
+void appendTimecode(std::string& out, long long ticks, long long ticksPerFrame, bool dropFrame) {
+    // Nominal (integer) frame rate used for counting, e.g. 30 for 29.97
+    const long long nominalFps = (TICKS_PER_SECOND + ticksPerFrame / 2) / ticksPerFrame;
+    const bool isFractionalRate = (TICKS_PER_SECOND % ticksPerFrame) != 0;
+    const bool useDropFrame = dropFrame && isFractionalRate && nominalFps > 0 && nominalFps % 30 == 0;
+
+    long long frames = floorDivide(ticks, ticksPerFrame);
+    if (frames < 0) {
+        out += '-';
+        frames = -frames;
+    }
+
+    if (useDropFrame) {
+        // Drop frame skips frame numbers 0 and 1 (or 0-3 at 59.94) at the start of each minute, except every tenth minute
+        const long long dropPerMinute = nominalFps / 15;
+        const long long framesPerMinute = nominalFps * 60 - dropPerMinute;
+        const long long framesPer10Minutes = nominalFps * 600 - dropPerMinute * 9;
+
+        const long long tenMinuteBlocks = frames / framesPer10Minutes;
+        const long long remainder = frames % framesPer10Minutes;
+        frames += dropPerMinute * 9 * tenMinuteBlocks;
+        if (remainder > dropPerMinute) {
+            frames += dropPerMinute * ((remainder - dropPerMinute) / framesPerMinute);
+        }
+    }
+
+    const long long fps = nominalFps > 0 ? nominalFps : 1;
+    const long long frameNumber = frames % fps;
+    const long long totalSeconds = frames / fps;
+
+    int frameDigits = 2;
+    for (long long maxFrame = fps - 1; maxFrame >= 100; maxFrame /= 10) {
+        frameDigits++;
+    }
+
+    const char separator = useDropFrame ? ';' : ':';
+    appendPadded(out, totalSeconds / 3600, 2);
+    out += separator;
+    appendPadded(out, (totalSeconds / 60) % 60, 2);
+    out += separator;
+    appendPadded(out, totalSeconds % 60, 2);
+    out += separator;
+    appendPadded(out, frameNumber, frameDigits);
+}
+
+// Reads the timebase argument shared by the batch exports below
+static long parseTimebaseArg(const char* timebase, long long& ticksPerFrame) {
+    return parseTicksPerFrame(timebase, ticksPerFrame) ? kESErrOK : kESErrBadArgumentList;
+}
+
+//--------------------------------------------------------------------------------------
+//------------------------------ Exported Custom Functions -----------------------------
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Converts many tick values to frame indexes in one call.
+ * @param result Receives a script that evaluates to an array of frame numbers.
+ * @param ticks Packed tick values, or an i64 NativeBuffer.
+ * @param timebase Ticks per frame, or a rational rate such as "30000/1001".
+ * @param rounding 0 = down (frame containing the time), 1 = nearest, 2 = up
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var frames = externalLibrary.ticksToFramesBatch("0,8475667200", sequence.timebase, 0);
+ */
+long ticksToFramesBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks, const char* timebase, long rounding) {
+    long long ticksPerFrame = 0;
+    const long err = parseTimebaseArg(timebase, ticksPerFrame);
+    if (err != kESErrOK) return err;
+    if (rounding < FRAME_ROUND_DOWN || rounding > FRAME_ROUND_UP) return kESErrRange;
+
+    std::string& script = result.script;
+    script = "[";
+    for (size_t i = 0; i < ticks.size(); i++) {
+        if (i > 0) script += ",";
+        // Frame counts are far below 2^53 for any real timebase, so they're safe to return as numbers
+        appendJsNumber(script, (double)ticksToFrameIndex(ticks[i], ticksPerFrame, (int)rounding));
+    }
+    script += "]";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(ticksToFramesBatch, ticksToFramesBatchTyped)
+
+/**
+ * @brief Converts many frame counts to ticks in one call.
+ * @param result Receives a script that evaluates to an array of tick strings.
+ * @param frames Packed frame counts, or an i64 NativeBuffer.
+ * @param timebase Ticks per frame, or a rational rate.
+ * @return kESErrOK on success, kESErrRange if a result doesn't fit in 64 bits, or another error code.
+ *
+ * JavaScript Usage: var ticks = externalLibrary.framesToTicksBatch("0,1,2", sequence.timebase);
+ */
+long framesToTicksBatchTyped(ScriptResult& result, const NumericSpan<long long>& frames, const char* timebase) {
+    long long ticksPerFrame = 0;
+    const long err = parseTimebaseArg(timebase, ticksPerFrame);
+    if (err != kESErrOK) return err;
+
+    std::string& script = result.script;
+    script = "[";
+    for (size_t i = 0; i < frames.size(); i++) {
+        long long ticks = 0;
+        if (!framesToTicksChecked(frames[i], ticksPerFrame, ticks)) return kESErrRange;
+        if (i > 0) script += ",";
+        appendJsInt64String(script, ticks);
+    }
+    script += "]";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(framesToTicksBatch, framesToTicksBatchTyped)
+
+/**
+ * @brief Rounds many tick values to the nearest frame boundary in one call. Same rounding as convertTimeObjectToNearestFrame in ThioUtils.jsx.
+ * @param result Receives a script that evaluates to an array of tick strings.
+ * @param ticks Packed tick values, or an i64 NativeBuffer.
+ * @param timebase Ticks per frame, or a rational rate.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var rounded = externalLibrary.roundTicksToFrameBatch(clip.start.ticks + "," + clip.end.ticks, sequence.timebase);
+ */
+long roundTicksToFrameBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks, const char* timebase) {
+    long long ticksPerFrame = 0;
+    const long err = parseTimebaseArg(timebase, ticksPerFrame);
+    if (err != kESErrOK) return err;
+
+    std::string& script = result.script;
+    script = "[";
+    for (size_t i = 0; i < ticks.size(); i++) {
+        long long rounded = 0;
+        if (!framesToTicksChecked(ticksToFrameIndex(ticks[i], ticksPerFrame, FRAME_ROUND_NEAREST), ticksPerFrame, rounded)) return kESErrRange;
+        if (i > 0) script += ",";
+        appendJsInt64String(script, rounded);
+    }
+    script += "]";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(roundTicksToFrameBatch, roundTicksToFrameBatchTyped)
+
+/**
+ * @brief Formats many tick values as timecode strings in one call.
+ * @param result Receives a script that evaluates to an array of timecode strings such as "00:01:02:03".
+ * @param ticks Packed tick values, or an i64 NativeBuffer.
+ * @param timebase Ticks per frame, or a rational rate.
+ * @param dropFrame Whether to use drop frame timecode for rates that have it.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var timecodes = externalLibrary.ticksToTimecodeBatch("0,254016000000", sequence.timebase, false);
+ */
+long ticksToTimecodeBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks, const char* timebase, bool dropFrame) {
+    long long ticksPerFrame = 0;
+    const long err = parseTimebaseArg(timebase, ticksPerFrame);
+    if (err != kESErrOK) return err;
+
+    std::string& script = result.script;
+    script = "[";
+    script.reserve(ticks.size() * 16 + 2);
+    for (size_t i = 0; i < ticks.size(); i++) {
+        if (i > 0) script += ",";
+        script += '"';
+        appendTimecode(script, ticks[i], ticksPerFrame, dropFrame);
+        script += '"';
+    }
+    script += "]";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(ticksToTimecodeBatch, ticksToTimecodeBatchTyped)
+
+/**
+ * @brief Converts many tick values to seconds in one call.
+ * @param result Receives a script that evaluates to an array of numbers.
+ * @param ticks Packed tick values, or an i64 NativeBuffer.
+ * @return kESErrOK on success, or an error code.
+ *
+ * JavaScript Usage: var seconds = externalLibrary.ticksToSecondsBatch("254016000000,508032000000");
+ */
+long ticksToSecondsBatchTyped(ScriptResult& result, const NumericSpan<long long>& ticks) {
+    std::string& script = result.script;
+    script = "[";
+    for (size_t i = 0; i < ticks.size(); i++) {
+        if (i > 0) script += ",";
+        appendJsNumber(script, ticksToSecondsExact(ticks[i]));
+    }
+    script += "]";
+    return kESErrOK;
+}
+THIO_BIND_EXPORT(ticksToSecondsBatch, ticksToSecondsBatchTyped)
+
+// Shared body of addTicks and subtractTicks, which only differ in the operation
+static long tickArithmetic(std::string& result, const char* ticksA, const char* ticksB, bool subtract) {
+    long long a = 0;
+    long long b = 0;
+    if (!parseInt64String(ticksA, a) || !parseInt64String(ticksB, b)) return kESErrConversion;
+
+    long long sum = 0;
+    const bool ok = subtract ? subtractTicksChecked(a, b, sum) : addTicksChecked(a, b, sum);
+    if (!ok) return kESErrRange;
+
+    result = std::to_string(sum);
+    return kESErrOK;
+}
+
+/**
+ * @brief Adds two tick strings exactly.
+ * @param result Receives the sum as a tick string.
+ * @param ticksA, ticksB Tick strings, such as Time.ticks values.
+ * @return kESErrOK on success, kESErrRange on overflow, or another error code.
+ *
+ * JavaScript Usage: var ticks = externalLibrary.addTicks(time1.ticks, time2.ticks);
+ */
+long addTicksTyped(std::string& result, const char* ticksA, const char* ticksB) {
+    return tickArithmetic(result, ticksA, ticksB, false);
+}
+THIO_BIND_EXPORT(addTicks, addTicksTyped)
+
+/**
+ * @brief Subtracts the second tick string from the first exactly.
+ * @param result Receives the difference as a tick string.
+ * @param ticksA, ticksB Tick strings, such as Time.ticks values.
+ * @return kESErrOK on success, kESErrRange on overflow, or another error code.
+ *
+ * JavaScript Usage: var ticks = externalLibrary.subtractTicks(time1.ticks, time2.ticks);
+ */
+long subtractTicksTyped(std::string& result, const char* ticksA, const char* ticksB) {
+    return tickArithmetic(result, ticksA, ticksB, true);
+}
+THIO_BIND_EXPORT(subtractTicks, subtractTicksTyped)
@@ -0,0 +1,48 @@
+#pragma once
+
+// TimeMath.h
+// Exact tick / frame / timecode math using 64-bit integer ticks.
+//
+// Premiere measures time in ticks, 254016000000 per second, and a sequence's timebase is the number of ticks per frame.
+// Tick counts pass the 2^53 limit of JavaScript numbers at around 9.8 hours, and any ticks * frames style math in JS
+// loses precision well before that. Everything here stays in integers, so results are exact.
+
+#include <string>
+
+#define TICKS_PER_SECOND 254016000000LL
+
+// Rounding used when converting ticks to a frame index
+#define FRAME_ROUND_DOWN    0   // Frame that contains the time (floor)
+#define FRAME_ROUND_NEAREST 1   // Nearest frame boundary, halfway rounds up. Same as convertTimeObjectToNearestFrame in ThioUtils.jsx
+#define FRAME_ROUND_UP      2   // Next frame boundary at or after the time (ceiling)
+
+/**
+ * @brief Parses a frame rate argument into ticks per frame.
+ * @param str Either a timebase in ticks per frame (as given by Sequence.timebase, e.g. "8475667200"),
+ *            or a rational frames-per-second value with a slash (e.g. "30000/1001"). The rational form must
+ *            correspond to a whole number of ticks per frame, which is true of all the rates Premiere supports.
+ * @return false if the string isn't valid or doesn't give a positive whole number of ticks per frame.
+ */
+bool parseTicksPerFrame(const char* str, long long& ticksPerFrame);
+
+// Overflow checked arithmetic. These return false instead of wrapping around.
+bool addTicksChecked(long long a, long long b, long long& result);
+bool subtractTicksChecked(long long a, long long b, long long& result);
+bool framesToTicksChecked(long long frames, long long ticksPerFrame, long long& ticks);
+
+/**
+ * @brief Converts ticks to a frame index using the given FRAME_ROUND_* mode. Negative times round the same way (e.g. down is toward negative infinity).
+ */
+long long ticksToFrameIndex(long long ticks, long long ticksPerFrame, int rounding);
+
+/**
+ * @brief Converts ticks to seconds. Splits into whole seconds and remainder first so the result is as accurate as a double allows.
+ */
+double ticksToSecondsExact(long long ticks);
+
+/**
+ * @brief Appends a timecode string for the frame containing 'ticks'.
+ * Uses HH:MM:SS:FF, or HH;MM;SS;FF when dropFrame is true and the rate is an NTSC rate (29.97, 59.94) where drop frame applies.
+ * For other rates dropFrame is ignored.
+ */
+void appendTimecode(std::string& out, long long ticks, long long ticksPerFrame, bool dropFrame);
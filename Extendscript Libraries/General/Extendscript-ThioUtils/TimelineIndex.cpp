@@ -0,0 +1,373 @@
+#include "TimelineIndex.h"
+#include "LiveObjects.h"
+#include "PackedData.h"
+#include "ThioUtils.h"
+#include <climits>
+#include <cstring>
+#include <iterator>
+#include <new>
+
+// ------------------------------------------------------------------------------------------------
+// TimelineIndex
+// ------------------------------------------------------------------------------------------------
+
+void TimelineIndex::clear() {
+    tracks.clear();
+    clipLocations.clear();
+}
+
+bool TimelineIndex::load(const char* packed) {
+    clear();
+    if (packed == nullptr) {
+        return false;
+    }
+
+    const char* p = packed;
+    while (*p != '\0') {
+        // Find the end of this record
+        const char* recordEnd = p;
+        while (*recordEnd != '\0' && *recordEnd != ';' && *recordEnd != '\n') {
+            ++recordEnd;
+        }
+
+        if (recordEnd > p) {
+            // The first three fields are numbers, the rest of the record is the id
+            std::vector<long long> numbers;
+            const char* field = p;
+            for (int i = 0; i < 3; i++) {
+                const char* comma = static_cast<const char*>(memchr(field, ',', recordEnd - field));
+                if (comma == nullptr || !parsePackedInt64s(field, comma, numbers) || numbers.size() != (size_t)i + 1) {
+                    clear();
+                    return false;
+                }
+                field = comma + 1;
+            }
+
+            if (numbers[0] > INT_MAX || !insert((int)numbers[0], numbers[1], numbers[2], std::string(field, recordEnd))) {
+                clear();
+                return false;
+            }
+        }
+
+        p = (*recordEnd == '\0') ? recordEnd : recordEnd + 1;
+    }
+    return true;
+}
+
+bool TimelineIndex::insert(int track, long long start, long long end, const std::string& id) {
+    if (track < 0 || end < start) {
+        return false;
+    }
+
+    remove(id); // Inserting an existing id moves it
+
+    if ((size_t)track >= tracks.size()) {
+        tracks.resize((size_t)track + 1);
+    }
+    tracks[track].clipsByStart.emplace(start, Clip{ start, end, id });
+    clipLocations[id] = Location{ track, start };
+    return true;
+}
+
+bool TimelineIndex::remove(const std::string& id) {
+    auto location = clipLocations.find(id);
+    if (location == clipLocations.end()) {
+        return false;
+    }
+
+    auto& clips = tracks[location->second.track].clipsByStart;
+    auto range = clips.equal_range(location->second.start);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.id == id) {
+            clips.erase(it);
+            break;
+        }
+    }
+    clipLocations.erase(location);
+    return true;
+}
+
+std::multimap<long long, TimelineIndex::Clip>::const_iterator TimelineIndex::firstCandidate(const Track& track, long long start) {
+    // First clip starting after 'start', then step back one since that clip may extend into the range
+    auto it = track.clipsByStart.upper_bound(start);
+    if (it != track.clipsByStart.begin()) {
+        auto previous = std::prev(it);
+        if (previous->second.end > start) {
+            return previous;
+        }
+    }
+    return it;
+}
+
+const TimelineIndex::Clip* TimelineIndex::clipAt(int track, long long ticks) const {
+    if (track < 0 || (size_t)track >= tracks.size()) {
+        return nullptr;
+    }
+    auto it = firstCandidate(tracks[track], ticks);
+    if (it != tracks[track].clipsByStart.end() && it->second.start <= ticks && it->second.end > ticks) {
+        return &it->second;
+    }
+    return nullptr;
+}
+
+const TimelineIndex::Clip* TimelineIndex::clipStartingAt(int track, long long ticks) const {
+    if (track < 0 || (size_t)track >= tracks.size()) {
+        return nullptr;
+    }
+    auto it = tracks[track].clipsByStart.find(ticks);
+    return (it != tracks[track].clipsByStart.end()) ? &it->second : nullptr;
+}
+
+void TimelineIndex::overlaps(int track, long long start, long long end, std::vector<const Clip*>& results) const {
+    if (track < 0 || (size_t)track >= tracks.size()) {
+        return;
+    }
+    if (start == end) {
+        // Point in time, same as checkIfAnyClipsInTimeRangeOnTrack
+        const Clip* clip = clipAt(track, start);
+        if (clip != nullptr) {
+            results.push_back(clip);
+        }
+        return;
+    }
+
+    const auto& clips = tracks[track].clipsByStart;
+    for (auto it = firstCandidate(tracks[track], start); it != clips.end() && it->second.start < end; ++it) {
+        if (it->second.end > start) {
+            results.push_back(&it->second);
+        }
+    }
+}
+
+int TimelineIndex::firstFreeTrack(long long start, long long end, int minTrack, int trackCount) const {
+    std::vector<const Clip*> found;
+    for (int track = (minTrack > 0 ? minTrack : 0); track < trackCount; track++) {
+        if ((size_t)track < tracks.size()) {
+            if (tracks[track].locked) {
+                continue;
+            }
+            found.clear();
+            overlaps(track, start, end, found);
+            if (!found.empty()) {
+                continue;
+            }
+        }
+        return track;
+    }
+    return -1;
+}
+
+void TimelineIndex::setTrackLocked(int track, bool locked) {
+    if (track < 0) {
+        return;
+    }
+    if ((size_t)track >= tracks.size()) {
+        tracks.resize((size_t)track + 1);
+    }
+    tracks[track].locked = locked;
+}
+
+// ------------------------------------------------------------------------------------------------
+// LiveObject class: TimelineIndex
+//
+// JavaScript Usage:
+//      var index = new TimelineIndex();
+//      index.load("0,0,254016000000,clipA;1,0,508032000000,clipB");   // track,start,end,id records
+//      index.clipAt(0, "127008000000");                                // "clipA"
+//      index.overlaps(1, "0", "254016000000");                         // ["clipB"]
+//      index.firstFreeTrack("0", "254016000000", 0, seq.videoTracks.numTracks);
+//      index.insert(2, "0", "100", "clipC");  index.remove("clipA");
+//      index.count;
+// ------------------------------------------------------------------------------------------------
+
+enum TimelineIndexMember {
+    kTimelineIndex_load = 1,
+    kTimelineIndex_clear,
+    kTimelineIndex_insert,
+    kTimelineIndex_remove,
+    kTimelineIndex_clipAt,
+    kTimelineIndex_clipStartingAt,
+    kTimelineIndex_overlaps,
+    kTimelineIndex_isRangeFree,
+    kTimelineIndex_firstFreeTrack,
+    kTimelineIndex_setTrackLocked,
+    kTimelineIndex_count,
+    kTimelineIndex_trackCount,
+};
+
+static SoCClientName timelineIndexMethods[] = {
+    { "load",           kTimelineIndex_load,            nullptr },
+    { "clear",          kTimelineIndex_clear,           nullptr },
+    { "insert",         kTimelineIndex_insert,          nullptr },
+    { "remove",         kTimelineIndex_remove,          nullptr },
+    { "clipAt",         kTimelineIndex_clipAt,          nullptr },
+    { "clipStartingAt", kTimelineIndex_clipStartingAt,  nullptr },
+    { "overlaps",       kTimelineIndex_overlaps,        nullptr },
+    { "isRangeFree",    kTimelineIndex_isRangeFree,     nullptr },
+    { "firstFreeTrack", kTimelineIndex_firstFreeTrack,  nullptr },
+    { "setTrackLocked", kTimelineIndex_setTrackLocked,  nullptr },
+    { nullptr, 0, nullptr }
+};
+
+static SoCClientName timelineIndexProperties[] = {
+    { "count",      kTimelineIndex_count,       nullptr },
+    { "trackCount", kTimelineIndex_trackCount,  nullptr },
+    { nullptr, 0, nullptr }
+};
+
+static ESerror_t timelineIndexInitialize(SoHObject hObject, int argc, TaggedData* argv) {
+    SoServerInterface* server = getLiveObjectServer();
+    if (server == nullptr) return kESErrInternal;
+
+    TimelineIndex* index = new (std::nothrow) TimelineIndex();
+    if (index == nullptr) return THIO_ERR_NO_MEMORY;
+    if (!setLiveObjectData(hObject, index)) {
+        delete index;
+        return THIO_ERR_INTERNAL;
+    }
+
+    server->addMethods(hObject, timelineIndexMethods);
+    server->addProperties(hObject, timelineIndexProperties);
+
+    // Optionally load right away: new TimelineIndex(packedString)
+    if (argc >= 1 && argv[0].type == kTypeString) {
+        if (!index->load(argv[0].data.string)) return kESErrBadArgumentList;
+    }
+    return kESErrOK;
+}
+
+static ESerror_t timelineIndexGet(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    TimelineIndex* index = static_cast<TimelineIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+
+    switch (name->id) {
+    case kTimelineIndex_count:
+        setIntegerResult(pValue, (long long)index->size());
+        return kESErrOK;
+    case kTimelineIndex_trackCount:
+        setIntegerResult(pValue, index->trackCount());
+        return kESErrOK;
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t timelineIndexPut(SoHObject hObject, SoCClientName* name, TaggedData* pValue) {
+    return kESErrNoLvalue; // All properties are read-only
+}
+
+// Reads the (track, startTicks, endTicks) arguments shared by several methods, starting at argv[first]
+static bool getTrackRangeArgs(int argc, TaggedData* argv, int first, long long& track, long long& start, long long& end) {
+    if (argc < first + 3) return false;
+    return getIntegerArg(argv[first], track) && getTicksArg(argv[first + 1], start) && getTicksArg(argv[first + 2], end)
+        && track >= 0 && track <= INT_MAX;
+}
+
+static ESerror_t timelineIndexCall(SoHObject hObject, SoCClientName* name, int argc, TaggedData* argv, TaggedData* pResult) {
+    TimelineIndex* index = static_cast<TimelineIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+
+    long long track = 0, start = 0, end = 0;
+
+    switch (name->id) {
+    case kTimelineIndex_load: {
+        const char* packed = nullptr;
+        if (argc != 1 || !getStringArg(argv[0], packed)) return kESErrBadArgumentList;
+        if (!index->load(packed)) return kESErrConversion;
+        setIntegerResult(pResult, (long long)index->size());
+        return kESErrOK;
+    }
+    case kTimelineIndex_clear:
+        index->clear();
+        return kESErrOK;
+
+    case kTimelineIndex_insert: {
+        const char* id = nullptr;
+        if (argc != 4 || !getTrackRangeArgs(argc, argv, 0, track, start, end) || !getStringArg(argv[3], id)) return kESErrBadArgumentList;
+        if (!index->insert((int)track, start, end, id)) return kESErrRange;
+        return kESErrOK;
+    }
+    case kTimelineIndex_remove: {
+        const char* id = nullptr;
+        if (argc != 1 || !getStringArg(argv[0], id)) return kESErrBadArgumentList;
+        setBoolResult(pResult, index->remove(id));
+        return kESErrOK;
+    }
+    case kTimelineIndex_clipAt:
+    case kTimelineIndex_clipStartingAt: {
+        if (argc != 2 || !getIntegerArg(argv[0], track) || !getTicksArg(argv[1], start) || track < 0 || track > INT_MAX) return kESErrBadArgumentList;
+        const TimelineIndex::Clip* clip = (name->id == kTimelineIndex_clipAt)
+            ? index->clipAt((int)track, start)
+            : index->clipStartingAt((int)track, start);
+        if (clip == nullptr) {
+            return setLiveObjectScriptResult(pResult, "null"); // null rather than undefined, same as the JS lookups
+        }
+        return setLiveObjectStringResult(pResult, clip->id);
+    }
+    case kTimelineIndex_overlaps:
+    case kTimelineIndex_isRangeFree: {
+        if (argc != 3 || !getTrackRangeArgs(argc, argv, 0, track, start, end)) return kESErrBadArgumentList;
+        std::vector<const TimelineIndex::Clip*> found;
+        index->overlaps((int)track, start, end, found);
+        if (name->id == kTimelineIndex_isRangeFree) {
+            setBoolResult(pResult, found.empty());
+            return kESErrOK;
+        }
+        std::string script = "[";
+        for (size_t i = 0; i < found.size(); i++) {
+            if (i > 0) script += ",";
+            appendJsString(script, found[i]->id.c_str(), found[i]->id.size());
+        }
+        script += "]";
+        return setLiveObjectScriptResult(pResult, script);
+    }
+    case kTimelineIndex_firstFreeTrack: {
+        long long minTrack = 0, trackCount = 0;
+        if (argc != 4 || !getTicksArg(argv[0], start) || !getTicksArg(argv[1], end)
+            || !getIntegerArg(argv[2], minTrack) || !getIntegerArg(argv[3], trackCount)
+            || minTrack > INT_MAX || trackCount > INT_MAX) {
+            return kESErrBadArgumentList;
+        }
+        setIntegerResult(pResult, index->firstFreeTrack(start, end, (int)minTrack, (int)trackCount));
+        return kESErrOK;
+    }
+    case kTimelineIndex_setTrackLocked: {
+        bool locked = false;
+        if (argc != 2 || !getIntegerArg(argv[0], track) || !getBoolArg(argv[1], locked) || track < 0 || track > INT_MAX) return kESErrBadArgumentList;
+        index->setTrackLocked((int)track, locked);
+        return kESErrOK;
+    }
+    default:
+        return kESErrCannotResolve;
+    }
+}
+
+static ESerror_t timelineIndexValueOf(SoHObject hObject, TaggedData* pResult) {
+    return kESErrOK; // Leaves the result undefined, there's no meaningful primitive value
+}
+
+static ESerror_t timelineIndexToString(SoHObject hObject, TaggedData* pResult) {
+    TimelineIndex* index = static_cast<TimelineIndex*>(getLiveObjectData(hObject));
+    if (index == nullptr) return kESErrInvalidObject;
+    return setLiveObjectStringResult(pResult, "[TimelineIndex " + std::to_string(index->size()) + " clips]");
+}
+
+static ESerror_t timelineIndexFinalize(SoHObject hObject) {
+    delete static_cast<TimelineIndex*>(getLiveObjectData(hObject));
+    setLiveObjectData(hObject, nullptr);
+    return kESErrOK;
+}
+
+static SoObjectInterface timelineIndexInterface = {
+    timelineIndexInitialize,
+    timelineIndexPut,
+    timelineIndexGet,
+    timelineIndexCall,
+    timelineIndexValueOf,
+    timelineIndexToString,
+    timelineIndexFinalize
+};
+
+ESerror_t registerTimelineIndexClass(SoServerInterface* server, SoHServer hServer) {
+    return server->addClass(hServer, (char*)"TimelineIndex", &timelineIndexInterface);
+}
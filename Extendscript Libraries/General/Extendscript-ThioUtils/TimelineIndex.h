@@ -0,0 +1,84 @@
+#pragma once
+
+// TimelineIndex.h
+// Native index of the clips on a sequence's tracks, for fast lookups by time.
+//
+// Scripts load it once with the (track, start, end, id) of every clip, then use it instead of looping over
+// track.clips for every question. Lookups are O(log n) per track. Clips can be inserted and removed as the script
+// edits the timeline, so the index doesn't need to be rebuilt.
+//
+// Times are in ticks. Like the rest of ThioUtils.jsx, ranges include their start and exclude their end.
+// Clips on the same track never overlap in Premiere, and the lookups rely on that: only the clip just before a
+// time can reach into it.
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TimelineIndex {
+public:
+    struct Clip {
+        long long start;
+        long long end;
+        std::string id;
+    };
+
+    // Removes everything
+    void clear();
+
+    /**
+     * @brief Replaces the contents with the clips in a packed string. Records are separated by ';' or newlines,
+     * and each is "track,startTicks,endTicks,id". The id can be any text without separators, e.g. a nodeId.
+     * @return false if the string is malformed. The index is left empty in that case.
+     */
+    bool load(const char* packed);
+
+    /**
+     * @brief Adds a clip. If a clip with the same id already exists, it's moved instead.
+     * @return false if the track is negative or end is before start.
+     */
+    bool insert(int track, long long start, long long end, const std::string& id);
+
+    // Removes the clip with the given id. Returns false if there's no such clip.
+    bool remove(const std::string& id);
+
+    // The clip on the track that contains the time, or nullptr
+    const Clip* clipAt(int track, long long ticks) const;
+
+    // The clip on the track that starts exactly at the time, or nullptr
+    const Clip* clipStartingAt(int track, long long ticks) const;
+
+    // All clips on the track that overlap [start, end), sorted by start. If start == end, it's a point check like clipAt.
+    void overlaps(int track, long long start, long long end, std::vector<const Clip*>& results) const;
+
+    /**
+     * @brief Finds the first track at or above minTrack where [start, end) is free of clips.
+     * @param trackCount Number of tracks in the sequence. Tracks without any clips count as free.
+     * @return The track index, or -1 if every track in range is occupied (or locked).
+     */
+    int firstFreeTrack(long long start, long long end, int minTrack, int trackCount) const;
+
+    // Locked tracks are never returned by firstFreeTrack
+    void setTrackLocked(int track, bool locked);
+
+    size_t size() const { return clipLocations.size(); }
+    int trackCount() const { return (int)tracks.size(); }
+
+private:
+    struct Track {
+        std::multimap<long long, Clip> clipsByStart;
+        bool locked = false;
+    };
+
+    struct Location {
+        int track;
+        long long start;
+    };
+
+    std::vector<Track> tracks;
+    std::unordered_map<std::string, Location> clipLocations;
+
+    // Iterator to the first clip that could overlap a range starting at 'start'
+    static std::multimap<long long, Clip>::const_iterator firstCandidate(const Track& track, long long start);
+};
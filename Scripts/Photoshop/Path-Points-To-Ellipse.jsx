@@ -5,59 +5,102 @@
 //     Use either the version linked above from GitHub, or you can use the minified version then unminify it and save it as numeric.js
 
 // --------------------------------------------------------------------
-// Version 1.0.0
+// Version 1.1.0
 // Author: ThioJoe (https://github.com/ThioJoe)
 // From Repo: https://github.com/ThioJoe/Adobe-Apps-Scripts-And-Tools
 // --------------------------------------------------------------------
 
-// This block will try to import the required library file.
-// If it's not found in the current directory or "includes" folder, it will ask the user if they want to try and download it automatically
+// Optional: If ThioUtilsLib.jsx and ThioUtils.dll are available (in the current directory or "includes" folder), the ellipse
+// fitting is done natively, which is much faster on paths with lots of points. numeric.js is then not needed at all.
+var useNativeFit = false;
+var thioUtilsLibCandidates = ["ThioUtilsLib.jsx", "includes/ThioUtilsLib.jsx", "../includes/ThioUtilsLib.jsx"];
+
+// After the first run in a Photoshop session the DLL is already loaded (ThioUtilsLib.jsx leaves its path in an environment
+// variable), so every candidate and its DLL are checked in one call instead of two File checks per folder.
+var thioUtilsLibFound = null;
 try {
-    // First, try to include from the current directory
-    eval("#include 'numeric.js'")
+    if ($.getenv("THIOUTILS_DLL_PATH")) {
+        var candidatePaths = [];
+        for (var pathIndex = 0; pathIndex < thioUtilsLibCandidates.length; pathIndex++) {
+            var candidateFile = new File(File($.fileName).parent.fullName + "/" + thioUtilsLibCandidates[pathIndex]);
+            candidatePaths.push(candidateFile.fsName, candidateFile.parent.fsName + "/ThioUtils.dll");
+        }
+        var candidateStats = new ExternalObject("lib:" + $.getenv("THIOUTILS_DLL_PATH")).statPaths(candidatePaths.join("\n").replace(/\\/g, "\\\\"));
+        thioUtilsLibFound = [];
+        for (var statIndex = 0; statIndex < thioUtilsLibCandidates.length; statIndex++) {
+            thioUtilsLibFound.push(candidateStats.exists[statIndex * 2] === true && candidateStats.exists[statIndex * 2 + 1] === true);
+        }
+    }
 } catch (e) {
+    thioUtilsLibFound = null; // Check with File objects below
+}
+
+for (var libIndex = 0; libIndex < thioUtilsLibCandidates.length; libIndex++) {
+    var thioUtilsLibFile = new File(File($.fileName).parent.fullName + "/" + thioUtilsLibCandidates[libIndex]);
+    var libAndDllExist = (thioUtilsLibFound !== null)
+        ? thioUtilsLibFound[libIndex]
+        : (thioUtilsLibFile.exists && new File(thioUtilsLibFile.parent.fullName + "/ThioUtils.dll").exists);
+    if (libAndDllExist) {
+        try {
+            eval("#include '" + thioUtilsLibFile.fullName + "'");
+            useNativeFit = (typeof ThioUtils !== 'undefined' && ThioUtils.isLoaded() && typeof ThioUtils.fitEllipse === 'function');
+        } catch (e) {
+            $.writeln("Failed to load ThioUtilsLib.jsx, falling back to numeric.js: " + e);
+        }
+        break;
+    }
+}
+
+// Otherwise this block will try to import the required library file.
+// If it's not found in the current directory or "includes" folder, it will ask the user if they want to try and download it automatically
+if (!useNativeFit) {
     try {
-        // If not in current directory, try the "includes" folder
-        eval("#include './includes/numeric.js'")
+        // First, try to include from the current directory
+        eval("#include 'numeric.js'")
     } catch (e) {
-        var userChoice = confirm("numeric.js was not found and is required. Do you want to try to automatically download it now?\n\n(Note: This only needs to be done once)");
-        if (userChoice) {
-            try {
-                var imageUrl = "https://raw.githubusercontent.com/sloisel/numeric/refs/tags/v1.2.6/src/numeric.js";
-                var scriptFile = new File($.fileName);
-                var scriptFolder = scriptFile.parent;
-                var includesFolder = new Folder(scriptFolder + "/includes");
-                
-                // Create includes folder if it doesn't exist
-                if (!includesFolder.exists) {
-                    includesFolder.create();
-                }
-                
-                var localImgPath = includesFolder.fsName + "/numeric.js";
-                
-                if (Folder.fs.indexOf("Win") > -1) {
-                    var command = "powershell -Command \"& { Invoke-WebRequest -Uri '" + imageUrl + "' -OutFile '" + localImgPath.replace(/\\/g, "\\\\") + "' }\"";
-                    app.system(command);
-                } else {
-                    app.system("curl -o \"" + localImgPath + "\" \"" + imageUrl + "\"");
-                }
-                
-                // Check if file was successfully downloaded
-                var downloadedFile = new File(localImgPath);
-                if (downloadedFile.exists) {
-                    alert("Success! numeric.js was successfully downloaded.\n\n" +
-                        "It was placed into a folder called \"includes\" at:\n" + 
-                        localImgPath + "\n\n" + 
-                        "Click OK to proceed with running the script");
-                    eval("#include './includes/numeric.js'");
-                } else {
-                    throw new Error("File download failed.");
+        try {
+            // If not in current directory, try the "includes" folder
+            eval("#include './includes/numeric.js'")
+        } catch (e) {
+            var userChoice = confirm("numeric.js was not found and is required. Do you want to try to automatically download it now?\n\n(Note: This only needs to be done once)");
+            if (userChoice) {
+                try {
+                    var imageUrl = "https://raw.githubusercontent.com/sloisel/numeric/refs/tags/v1.2.6/src/numeric.js";
+                    var scriptFile = new File($.fileName);
+                    var scriptFolder = scriptFile.parent;
+                    var includesFolder = new Folder(scriptFolder + "/includes");
+                    
+                    // Create includes folder if it doesn't exist
+                    if (!includesFolder.exists) {
+                        includesFolder.create();
+                    }
+                    
+                    var localImgPath = includesFolder.fsName + "/numeric.js";
+                    
+                    if (Folder.fs.indexOf("Win") > -1) {
+                        var command = "powershell -Command \"& { Invoke-WebRequest -Uri '" + imageUrl + "' -OutFile '" + localImgPath.replace(/\\/g, "\\\\") + "' }\"";
+                        app.system(command);
+                    } else {
+                        app.system("curl -o \"" + localImgPath + "\" \"" + imageUrl + "\"");
+                    }
+                    
+                    // Check if file was successfully downloaded
+                    var downloadedFile = new File(localImgPath);
+                    if (downloadedFile.exists) {
+                        alert("Success! numeric.js was successfully downloaded.\n\n" +
+                            "It was placed into a folder called \"includes\" at:\n" + 
+                            localImgPath + "\n\n" + 
+                            "Click OK to proceed with running the script");
+                        eval("#include './includes/numeric.js'");
+                    } else {
+                        throw new Error("File download failed.");
+                    }
+                } catch (e) {
+                    alert("Error downloading or including numeric.js: " + e.message);
                 }
-            } catch (e) {
-                alert("Error downloading or including numeric.js: " + e.message);
+            } else {
+                displayNotFoundAlert("Required library 'numeric.js' not found.");
             }
-        } else {
-            displayNotFoundAlert("Required library 'numeric.js' not found.");
         }
     }
 }
@@ -153,6 +196,11 @@ function fitEllipse(points) {
         return null;
     }
 
+    // Use the native version from ThioUtils.dll if it was loaded. It returns the same {cx, cy, a, b, theta} object, or null.
+    if (useNativeFit) {
+        return ThioUtils.fitEllipse(points);
+    }
+
     // Construct the design matrix D
     var D = [];
     for (var i = 0; i < n; i++) {
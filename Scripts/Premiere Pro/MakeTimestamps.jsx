@@ -69,6 +69,18 @@ function GetSortedArrayFromDictionary(dict) {
         items.push([key, dict[key]]);
     }
 
+    // Sort natively if available. The values are seconds, so they're converted to whole ticks for the integer sort.
+    if (ThioUtils.isThioUtilsLibLoaded()) {
+        var keys = [];
+        for (var i = 0; i < items.length; i++) {
+            keys.push(Math.round(items[i][1] * 254016000000));
+        }
+        var nativeSorted = ThioUtilsLib.sortItemsByKeys(items, keys);
+        if (nativeSorted !== null) {
+            return nativeSorted;
+        }
+    }
+
     // Sort the array based on the second element
     items.sort(function(first, second) {
         return first[1] - second[1];
@@ -78,6 +90,17 @@ function GetSortedArrayFromDictionary(dict) {
 }
 
 function sortTimeObjectNestedArray(timeObjArray) {
+    if (ThioUtils.isThioUtilsLibLoaded()) {
+        var keys = [];
+        for (var i = 0; i < timeObjArray.length; i++) {
+            keys.push(timeObjArray[i][1].ticks);
+        }
+        var nativeSorted = ThioUtilsLib.sortItemsByKeys(timeObjArray, keys);
+        if (nativeSorted !== null) {
+            return nativeSorted;
+        }
+    }
+
     // Sort the array based on the second element
     timeObjArray.sort(function(first, second) {
         return first[1].seconds - second[1].seconds;
@@ -86,12 +109,36 @@ function sortTimeObjectNestedArray(timeObjArray) {
     return timeObjArray
 }
 
+// Removes the unique index (~~1~~) from the end of each key. Does the whole list in one native call if ThioUtilsLib is loaded.
+function removeUniqueSuffixes(nestedArray) {
+    var keys = [];
+    for (var i = 0; i < nestedArray.length; i++) {
+        keys.push(nestedArray[i][0]);
+    }
+
+    if (ThioUtils.isThioUtilsLibLoaded()) {
+        var handle = ThioUtilsLib.compilePattern(/~~\d+~~$/);
+        if (handle !== null) {
+            var cleanedKeys = ThioUtilsLib.patternReplace(handle, keys, "");
+            ThioUtilsLib.releasePattern(handle);
+            if (cleanedKeys !== null) {
+                return cleanedKeys;
+            }
+        }
+    }
+
+    for (var i = 0; i < keys.length; i++) {
+        keys[i] = keys[i].replace(/~~\d+~~$/, "");
+    }
+    return keys;
+}
+
 function MakeTimeCodeMMSS(timestampsArray, noLabels) {
     var finalString = ""
+    var cleanedKeys = noLabels ? [] : removeUniqueSuffixes(timestampsArray)
 
     for (var i = 0; i < timestampsArray.length; i++) {
 
-        var key = timestampsArray[i][0]
         var timeSeconds = timestampsArray[i][1]
 
         // Try to round down unless the number is very close to the next whole number
@@ -139,7 +186,7 @@ function MakeTimeCodeMMSS(timestampsArray, noLabels) {
         if (noLabels) {
             cleanedKey = ""
         } else {
-            cleanedKey = key.replace(/~~\d+~~$/, "")
+            cleanedKey = cleanedKeys[i]
             if (cleanedKey !== "") {
                 separator = " - "
             }
@@ -179,9 +226,9 @@ function getMaxOfPart(timeObjArray, partIndex) {
 
 function makeTimeCodeAsIs(timeObjArray, noLabels) {
     var finalString = ""
+    var cleanedKeys = noLabels ? [] : removeUniqueSuffixes(timeObjArray)
 
     for (var i = 0; i < timeObjArray.length; i++) {
-        var key = timeObjArray[i][0]
         var timeObj = timeObjArray[i][1]
         var timecode = ThioUtils.getTimecodeString_FromTimeObject(timeObj)
 
@@ -189,7 +236,7 @@ function makeTimeCodeAsIs(timeObjArray, noLabels) {
         if (noLabels) {
             cleanedKey = ""
         } else {
-            cleanedKey = key.replace(/~~\d+~~$/, "")
+            cleanedKey = cleanedKeys[i]
         }
 
         // Determine if it's ; or : based on the timecode format, split on the correct character
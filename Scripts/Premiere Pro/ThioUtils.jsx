@@ -83,9 +83,24 @@ function includeFile(fileName, required, notAvailableFunctionalityString) {
         relativeToFullPath("../includes/" + fileName)
     ]
 
+    // Once ThioUtils.dll is loaded, check all of them in one call instead of one File at a time
+    var library = getThioLibraryFromEnv();
+    var found = null;
+    if (library !== null) {
+        try {
+            var nativePaths = [];
+            for (var p = 0; p < pathsToSearch.length; p++) {
+                nativePaths.push(File(pathsToSearch[p]).fsName.replace(/\\/g, "\\\\")); // Escaped for the DLL's string list
+            }
+            found = library.statPaths(nativePaths.join("\n")).exists;
+        } catch (e) {
+            found = null; // The DLL is from before statPaths
+        }
+    }
+
     // Look through each path and return if found
     for (var i = 0; i < pathsToSearch.length; i++) {
-        if ( File(pathsToSearch[i]).exists === true ) {
+        if ( (found !== null) ? (found[i] === true) : (File(pathsToSearch[i]).exists === true) ) {
             return getEvalString(pathsToSearch[i]);
         }
     }
@@ -102,28 +117,79 @@ function includeFile(fileName, required, notAvailableFunctionalityString) {
     return null;
 }
 
-// ------- Other included scripts. We apparently need to run eval in the global scope. -------
-// Not required but recommended - ThioUtilsLib.jsx and ThioUtils.dll
-var incThioUtilsLib = includeFile("ThioUtilsLib.jsx", false, "ThioUtils.dll")
-if (incThioUtilsLib !== null) {
+/**
+ * Gets ThioUtils.dll before ThioUtilsLib.jsx is included. Only works once ThioUtilsLib.jsx has loaded the DLL in this
+ * app session, which leaves its path in an environment variable.
+ * @returns {ExternalObject|null} The library, or null if it hasn't been loaded yet.
+ */
+function getThioLibraryFromEnv() {
+    var dllPath = $.getenv("THIOUTILS_DLL_PATH");
+    if (!dllPath) { return null; }
+
     try {
-        eval(incThioUtilsLib);
+        return new ExternalObject("lib:" + dllPath); // Already loaded, so this doesn't load it again
     } catch (e) {
-        $.writeln("Error including ThioUtilsLib.jsx. " + e.toString());
-        alert("Error -- Found ThioUtilsLib.jsx but failed to load it. Some functionality will not be available. \n\nError Message:\n" + e.toString());
+        return null;
+    }
+}
+
+/**
+ * Gets several files to include as one source from ThioUtils.dll, which keeps them in memory between runs. Only works
+ * once the DLL has been loaded in this app session (see getThioLibraryFromEnv).
+ * The files are searched for in the same folders as includeFile.
+ * @param {string[]} fileNames
+ * @returns {string|null} The source to eval in the global scope, or null to include the files one by one instead.
+ */
+function getThioIncludeBundle(fileNames) {
+    var library = getThioLibraryFromEnv();
+    if (library === null) { return null; }
+
+    try {
+        return library.getIncludeBundle(getCurrentScriptDirectory().fsName, fileNames.join("\n"));
+    } catch (e) {
+        return null; // A file isn't where it was, or the DLL is from before getIncludeBundle
     }
 }
-// Required - es5-shim.js
-var incEs5Shim = includeFile("es5-shim.js", true, "You can find this file in the Scripts/include folder of my repo (https://github.com/ThioJoe/Adobe-Apps-Scripts-And-Tools). Put the file next to the ThioUtils.jsx script or in a folder called 'includes' or 'include'.")
-if (incEs5Shim !== null) {
+
+// ------- Other included scripts. We apparently need to run eval in the global scope. -------
+// After the first run in an app session both come from the DLL, in one call and one eval.
+var incThioBundle = getThioIncludeBundle(["ThioUtilsLib.jsx", "es5-shim.js"]);
+if (incThioBundle !== null) {
     try {
-        eval(incEs5Shim);
+        eval(incThioBundle);
     } catch (e) {
-        $.writeln("Error including es5-shim.js. " + e.toString());
-        alert("Error -- Found ThioUtilsLib.jsx but failed to load it. Some functionality will not be available. \n\nError Message:\n" + e.toString());
+        $.writeln("Error including the ThioUtils include bundle, including the files one by one instead. " + e.toString());
+        incThioBundle = null;
+    }
+    $.global.thioIncludePath = undefined;
+}
+if (incThioBundle === null) {
+    // Not required but recommended - ThioUtilsLib.jsx and ThioUtils.dll
+    var incThioUtilsLib = includeFile("ThioUtilsLib.jsx", false, "ThioUtils.dll")
+    if (incThioUtilsLib !== null) {
+        try {
+            eval(incThioUtilsLib);
+        } catch (e) {
+            $.writeln("Error including ThioUtilsLib.jsx. " + e.toString());
+            alert("Error -- Found ThioUtilsLib.jsx but failed to load it. Some functionality will not be available. \n\nError Message:\n" + e.toString());
+        }
+    }
+    // Required - es5-shim.js
+    var incEs5Shim = includeFile("es5-shim.js", true, "You can find this file in the Scripts/include folder of my repo (https://github.com/ThioJoe/Adobe-Apps-Scripts-And-Tools). Put the file next to the ThioUtils.jsx script or in a folder called 'includes' or 'include'.")
+    if (incEs5Shim !== null) {
+        try {
+            eval(incEs5Shim);
+        } catch (e) {
+            $.writeln("Error including es5-shim.js. " + e.toString());
+            alert("Error -- Found ThioUtilsLib.jsx but failed to load it. Some functionality will not be available. \n\nError Message:\n" + e.toString());
+        }
     }
 }
 
+// ThioUtilsLib.jsx defines its wrapper as ThioUtils, which this file replaces below, so keep it as ThioUtilsLib.
+// Null if it wasn't found or its DLL didn't load, which is what isThioUtilsLibLoaded checks.
+var ThioUtilsLib = (typeof ThioUtils !== 'undefined' && ThioUtils !== null && typeof ThioUtils.isLoaded === 'function' && ThioUtils.isLoaded()) ? ThioUtils : null;
+
 // -------------------------------------------------------
 
 app.enableQE();
@@ -204,6 +270,91 @@ var ThioUtils = (function () {
         }
     };
     
+    // Native clip indexes from getTimelineIndex, kept for the rest of the script run. Keyed by sequenceID and media type.
+    var cachedTimelineIndexes = {};
+
+    // Number of clips on each track, to tell whether a kept index is out of date
+    function readClipCounts(tracks) {
+        var counts = [];
+        for (var t = 0; t < tracks.numTracks; t++) {
+            counts.push(tracks[t].clips.numItems);
+        }
+        return counts;
+    }
+
+    // Returns the kept index for the sequence's video or audio tracks, building it again if the track count or the clip
+    // count of any track changed
+    function getCheckedTimelineIndex(sequence, mediaType) {
+        if (!pub.isThioUtilsLibLoaded()) { return null; }
+        var tracks = (mediaType === "audio") ? sequence.audioTracks : sequence.videoTracks;
+        var key = sequence.sequenceID + ":" + mediaType;
+
+        var cached = cachedTimelineIndexes[key];
+        if (cached) {
+            var upToDate = (cached.clipCounts.length === tracks.numTracks);
+            for (var t = 0; upToDate && t < tracks.numTracks; t++) {
+                upToDate = (cached.clipCounts[t] === tracks[t].clips.numItems);
+            }
+            if (upToDate) { return cached; }
+        }
+
+        var clipsById = {};
+        var index = ThioUtilsLib.createTimelineIndex(tracks, clipsById);
+        if (index === null) {
+            delete cachedTimelineIndexes[key];
+            return null;
+        }
+        cached = { index: index, clips: clipsById, clipCounts: readClipCounts(tracks) };
+        cachedTimelineIndexes[key] = cached;
+        return cached;
+    }
+
+    /**
+     * Gets a native index of the clips on a sequence's video or audio tracks, for lookups by time without looping over every clip.
+     * It's read from the timeline on first use and kept for the rest of the script run. Added and removed clips are noticed by
+     * their count and the index is read again, but moved and trimmed clips aren't, so call updateTimelineIndex after adding, moving
+     * or trimming a clip, and removeFromTimelineIndex before removing one. Other ThioUtils functions such as
+     * getFirstAvailableTrackIndex and checkIfAnyClipsInTimeRangeOnTrack don't use it, and always read the timeline.
+     * Requires the ThioUtils library.
+     * @param {"video"|"audio"=} mediaType Default "video"
+     * @param {Sequence=} sequence Optional: The sequence to use. If not provided, will use the active sequence.
+     * @returns {{index: TimelineIndex, clips: Object}|null} The index (clip ids are nodeIds) and the TrackItems by id, or null without the library.
+     */
+    pub.getTimelineIndex = function(mediaType, sequence) {
+        var seq = this.checkOrGetActiveSequence(sequence);
+        return getCheckedTimelineIndex(seq, (mediaType === "audio") ? "audio" : "video");
+    };
+
+    /**
+     * Puts a clip that was just added or moved into the kept timeline index, if there is one, instead of reading the tracks again.
+     * @param {TrackItem} clip
+     * @param {Sequence=} sequence Optional: The clip's sequence. If not provided, will use the active sequence.
+     */
+    pub.updateTimelineIndex = function(clip, sequence) {
+        var seq = this.checkOrGetActiveSequence(sequence);
+        var mediaType = (clip.mediaType === "Audio") ? "audio" : "video";
+        var cached = cachedTimelineIndexes[seq.sequenceID + ":" + mediaType];
+        if (!cached) { return; }
+
+        cached.index.insert(clip.parentTrackIndex, clip.start.ticks, clip.end.ticks, clip.nodeId); // Moves it if it was already there
+        cached.clips[clip.nodeId] = clip;
+        cached.clipCounts = readClipCounts((mediaType === "audio") ? seq.audioTracks : seq.videoTracks);
+    };
+
+    /**
+     * Takes a clip out of the kept timeline index, if there is one. Call it before removing the clip from the timeline.
+     * @param {TrackItem} clip
+     * @param {Sequence=} sequence Optional: The clip's sequence. If not provided, will use the active sequence.
+     */
+    pub.removeFromTimelineIndex = function(clip, sequence) {
+        var seq = this.checkOrGetActiveSequence(sequence);
+        var cached = cachedTimelineIndexes[seq.sequenceID + ":" + ((clip.mediaType === "Audio") ? "audio" : "video")];
+        if (!cached || !cached.index.remove(clip.nodeId)) { return; }
+
+        delete cached.clips[clip.nodeId];
+        cached.clipCounts[clip.parentTrackIndex]--;
+    };
+
     /**
      * Gets the first available track with no clips at the desired position. If provided start and end time objects, it will ensure the entire range on the returned track is available, otherwise will just use the point in time at the playhead.
      * @param {Time=} startTime Optional: The clip to check the entire range of. If not provided, will just check the playhead position. If provided but not endTime, this will be used as the point in time.
@@ -302,6 +453,11 @@ var ThioUtils = (function () {
         var xRes = -1;
         var yRes = -1;
 
+        // The library parses the metadata natively and remembers it per item, so asking again about the same clip is cheap
+        if (this.isThioUtilsLibLoaded()) {
+            return this.getResolutionsFromProjectItems([projectItem])[0];
+        }
+
         try {
             var metadata = projectItem.getProjectMetadata(); //
 
@@ -360,6 +516,36 @@ var ThioUtils = (function () {
         }
     };
 
+    /**
+     * Gets the video resolutions of many clips at once. With ThioUtilsLib loaded, all of their metadata is parsed in one native call.
+     * @param {Array<TrackItem|ProjectItem>} targetItems The clips or project items to inspect.
+     * @returns {Array<{x: number, y: number} | null>} The resolution of each item in order, or null where it cannot be determined.
+     */
+    pub.getResolutionsFromProjectItems = function (targetItems) {
+        var resolutions = [];
+        if (!this.isThioUtilsLibLoaded()) {
+            for (var i = 0; i < targetItems.length; i++) {
+                resolutions.push(this.getResolutionFromProjectItem(targetItems[i]));
+            }
+            return resolutions;
+        }
+
+        var projectItems = [];
+        for (var j = 0; j < targetItems.length; j++) {
+            projectItems.push((targetItems[j] instanceof TrackItem) ? targetItems[j].projectItem : targetItems[j]);
+        }
+        var info = ThioUtilsLib.extractMetadata(projectItems, "videoInfo");
+        for (var k = 0; k < projectItems.length; k++) {
+            if (info === null || info.width[k] === null) {
+                $.writeln("VideoInfo tag not found in metadata for item: " + projectItems[k].name);
+                resolutions.push(null);
+            } else {
+                resolutions.push({ x: info.width[k], y: info.height[k] });
+            }
+        }
+        return resolutions;
+    };
+
 
     /**
      * Returns an array of clip/track objects that have video clips intersecting the current playhead position.
@@ -482,29 +668,27 @@ var ThioUtils = (function () {
         }
 
         // Get the items in the bin, and if any of them are also bins, recursively get the rest
+        // Appends every bin in the project to binArray, nested bins right after their parent.
+        // Pushes into the one array instead of concatenating per level, which copied the whole list at every bin.
         /**
          * @param {Number} numBins 
-         * @returns {QEProjectItemContainer[]}
+         * @param {QEProjectItemContainer[]} binArray
          */
-        function getBins(numBins) {
-            var binArray = [];
+        function getBins(numBins, binArray) {
             for (var i = 0; i < numBins; i++) {
                 var currBin = qe.project.getBinAt(i);
                 binArray.push(currBin);
 
                 // Recursively get bins within this bin
-                var nestedBins = getBinsInBin(currBin);
-                binArray = binArray.concat(nestedBins);
+                getBinsInBin(currBin, binArray);
             }
-            return binArray;
         }
 
         /**
          * @param {QEProjectItemContainer} binObj 
-         * @returns {QEProjectItemContainer[]} Array of bins found within the given bin
+         * @param {QEProjectItemContainer[]} binArray Array to add the bins found within the given bin to
          */
-        function getBinsInBin(binObj) {
-            var binArray = [];
+        function getBinsInBin(binObj, binArray) {
             binObj.flushCache();
             var numBins = binObj.numBins;
 
@@ -513,19 +697,15 @@ var ThioUtils = (function () {
                 binArray.push(nestedBin);
 
                 // Recursively get bins within this nested bin
-                var deeperBins = getBinsInBin(nestedBin);
-                binArray = binArray.concat(deeperBins);
+                getBinsInBin(nestedBin, binArray);
             }
-
-            return binArray;
         }
 
         /**
          * @param {QEProjectItemContainer} binObj
-         * @returns {QESequence[]}
+         * @param {QESequence[]} seqArray Array to add the bin's sequences to
          */
-        function getSequencesInBin(binObj) {
-            var seqArray = [];
+        function getSequencesInBin(binObj, seqArray) {
             var numSeq = binObj.numSequences;
             for (var i = 0; i < numSeq; i++) {
                 try {
@@ -535,7 +715,6 @@ var ThioUtils = (function () {
                     $.writeln("Error getting sequence #" + i)
                 }
             }
-            return seqArray;
         }
 
         // -------------------------------------------------
@@ -560,12 +739,10 @@ var ThioUtils = (function () {
         
         // That won't find any sequences within bins because of a bug in QE API, so need to go through bins too
         var binArray = [];
-        binArray = getBins(numBins)
+        getBins(numBins, binArray)
 
         for (var i = 0; i < binArray.length; i++) {
-            var currBin = binArray[i];
-            var seqsInBin = getSequencesInBin(currBin);
-            QESequenceArray = QESequenceArray.concat(seqsInBin);
+            getSequencesInBin(binArray[i], QESequenceArray);
         }
 
         return QESequenceArray;
@@ -1235,7 +1412,8 @@ var ThioUtils = (function () {
         var errorStringArray = [];
         var warningStringArray = [];
 
-        // Process the clips
+        // Process the clips. The resolutions are read in one go, rather than parsing each clip's metadata in the loop
+        var resolutions = ThioUtils.getResolutionsFromProjectItems(clipsArray);
         for (var i = 0; i < clipsArray.length; i++) {
             var motionComponent = ThioUtils.GetEffectComponent(clipsArray[i], "Motion");
             var scaleProp = motionComponent.properties.getParamForDisplayName("Scale");
@@ -1246,13 +1424,13 @@ var ThioUtils = (function () {
             var anchorValue = anchorProp.getValue();
 
             // Scale as needed to fill the frame
-            var res = ThioUtils.getResolutionFromProjectItem(clipsArray[i]);
+            var res = resolutions[i];
             // Get current sequence resolution
             var seq = parentSequence;
             var width = seq.frameSizeHorizontal;
             var height = seq.frameSizeVertical;
 
-            if (res.x === -1 || res.y === -1) {
+            if (res === null || res.x === -1 || res.y === -1) {
                 errorStringArray.push("Could not get resolution for clip: " + clipsArray[i].name);
                 continue;
             }
@@ -1594,6 +1772,14 @@ var ThioUtils = (function () {
      * @returns {Time} Updated time object rounded to the nearest frame.
      */
     pub.convertTimeObjectToNearestFrame = function (sequence, timeObj) {
+        // Use the exact integer version from ThioUtils.dll if available, JS numbers lose precision on long timelines
+        if (this.isThioUtilsLibLoaded()) {
+            var exactTicks = ThioUtilsLib.roundTicksToFrameBatch([timeObj.ticks], sequence.timebase);
+            if (exactTicks !== null) {
+                return this.ticksToTimeObject(exactTicks[0]);
+            }
+        }
+
         // The timebase is ticks per frame
         var frameRateTicks = Number(sequence.timebase);
         var currentTicks = Number(timeObj.ticks);
@@ -1625,6 +1811,18 @@ var ThioUtils = (function () {
             sortedClips = clips.slice(); // Make a copy of the array to avoid modifying the original
         }
 
+        // Sort natively if available, which reads each clip's start once instead of on every comparison
+        if (this.isThioUtilsLibLoaded()) {
+            var startTicks = [];
+            for (var i = 0; i < sortedClips.length; i++) {
+                startTicks.push(sortedClips[i].start.ticks);
+            }
+            var nativeSorted = ThioUtilsLib.sortItemsByKeys(sortedClips, startTicks);
+            if (nativeSorted !== null) {
+                return nativeSorted;
+            }
+        }
+
         // Sort the clips based on their start ticks
         sortedClips.sort(function (a, b) {
             return Number(a.start.ticks) - Number(b.start.ticks);
@@ -1712,6 +1910,12 @@ var ThioUtils = (function () {
      * @returns {Time} A new Time object representing the sum of the two input Time objects.
      */
     pub.addTime = function (timeObj1, timeObj2) {
+        if (this.isThioUtilsLibLoaded()) {
+            var exactTicks = ThioUtilsLib.addTicks(timeObj1.ticks, timeObj2.ticks);
+            if (exactTicks !== null) {
+                return this.ticksToTimeObject(exactTicks);
+            }
+        }
         var totalTicks = Number(timeObj1.ticks) + Number(timeObj2.ticks);
         return this.ticksToTimeObject(totalTicks);
     };
@@ -1723,6 +1927,12 @@ var ThioUtils = (function () {
      * @return {Time} A new Time object representing the difference between the two input Time objects.
      */
     pub.subtractTime = function(timeObj1, timeObj2) {
+        if (this.isThioUtilsLibLoaded()) {
+            var exactTicks = ThioUtilsLib.subtractTicks(timeObj1.ticks, timeObj2.ticks);
+            if (exactTicks !== null) {
+                return this.ticksToTimeObject(exactTicks);
+            }
+        }
         var totalTicks = Number(timeObj1.ticks) - Number(timeObj2.ticks);
         return this.ticksToTimeObject(totalTicks);
     }
@@ -1788,6 +1998,10 @@ var ThioUtils = (function () {
 
         var vanillaClipsArray = ThioUtils.convertToArray(vanillaClips); // For some reason doing this.convertToArray doesn't work here? I forget why but this has happened before.
 
+        // With the library, each QE track is read once into a native index by start time, instead of once per clip on it.
+        // Keyed by media type and track index. Ids are the QE item indexes.
+        var qeTrackIndexes = ThioUtils.isThioUtilsLibLoaded() ? {} : null;
+
         // Process each selected vanilla clip
         for (var i = 0; i < vanillaClipsArray.length; i++) {
             var vanillaClip = vanillaClipsArray[i];
@@ -1804,8 +2018,28 @@ var ThioUtils = (function () {
                 continue;
             }
 
+            var matchIndexes = null; // QE item indexes to look at, or null for all of them
+            if (qeTrackIndexes !== null) {
+                var qeTrackKey = vanillaClip.mediaType + ":" + trackIndex;
+                if (!qeTrackIndexes.hasOwnProperty(qeTrackKey)) {
+                    var records = [];
+                    for (var r = 0; r < trackItem.numItems; r++) {
+                        var qeItem = trackItem.getItemAt(r);
+                        if (qeItem) {
+                            records.push([0, qeItem.start.ticks, qeItem.end.ticks, r]);
+                        }
+                    }
+                    qeTrackIndexes[qeTrackKey] = ThioUtilsLib.createTimelineIndexFromRecords(records);
+                }
+                if (qeTrackIndexes[qeTrackKey] !== null) {
+                    var matchId = qeTrackIndexes[qeTrackKey].clipStartingAt(0, vanillaClip.start.ticks);
+                    matchIndexes = (matchId === null) ? [] : [Number(matchId)];
+                }
+            }
+
             // Search through items in this track to find matching clip by start time
-            for (var j = 0; j < trackItem.numItems; j++) {
+            for (var m = 0; m < ((matchIndexes !== null) ? matchIndexes.length : trackItem.numItems); m++) {
+                var j = (matchIndexes !== null) ? matchIndexes[m] : m;
                 var qeClipObject = trackItem.getItemAt(j);
 
                 // Skip if this item is null or undefined (empty space)
@@ -2320,6 +2554,62 @@ var ThioUtils = (function () {
     //region Project
     // ------------------ Project ------------------
 
+    // Native index of the project panel from buildProjectIndex. When set, the path and name lookups below try it first.
+    var cachedProjectIndex = null;
+
+    /**
+     * Indexes every item in the project once, so getBinByPath, getItemByPath and getItemInBinByName don't walk the project panel on each call.
+     * Useful before many lookups in a large project. Items the index finds are checked against the project, and anything it
+     * doesn't find is still searched for normally, but call refreshProjectIndexBin after renaming or moving items in a bin.
+     * Requires the ThioUtils library.
+     * @returns {boolean} True if the index was built.
+     */
+    pub.buildProjectIndex = function() {
+        cachedProjectIndex = pub.isThioUtilsLibLoaded() ? ThioUtilsLib.createProjectIndex(app.project.rootItem) : null;
+        return cachedProjectIndex !== null;
+    }
+
+    /**
+     * Reads one bin into the project index again after its contents changed. Does nothing if there's no index.
+     * @param {ProjectItem} bin The bin that changed, or app.project.rootItem
+     */
+    pub.refreshProjectIndexBin = function(bin) {
+        if (cachedProjectIndex !== null && ThioUtilsLib.refreshProjectIndexBin(cachedProjectIndex, bin) === null) {
+            cachedProjectIndex = null; // The bin wasn't indexed, so the index is out of date
+        }
+    }
+
+    /**
+     * Stops using the project index, going back to walking the project panel for lookups.
+     */
+    pub.releaseProjectIndex = function() {
+        cachedProjectIndex = null;
+    }
+
+    // The id a bin has in the project index, where the root is ""
+    function getProjectIndexId(bin) {
+        return (bin.type === ProjectItemType.ROOT) ? "" : bin.nodeId;
+    }
+
+    // Maps ids from the project index to ProjectItems. Returns null if there are none, or any is gone or renamed since
+    // it was indexed, so the caller searches the project instead.
+    function getIndexedProjectItems(ids, expectedName) {
+        if (ids === null || ids.length === 0) {
+            return null;
+        }
+        var found = [];
+        for (var i = 0; i < ids.length; i++) {
+            var item = cachedProjectIndex.items[ids[i]];
+            try {
+                if (!item || item.name !== expectedName) { return null; }
+            } catch (e) {
+                return null; // The item was deleted
+            }
+            found.push(item);
+        }
+        return found;
+    }
+
     /**
      * Retrieves a bin from the project items panel. Can also find a bin within another bin if provided, otherwise searches root.
      * @param {string} binName The name of the bin
@@ -2353,6 +2643,13 @@ var ThioUtils = (function () {
         }
 
         var pathParts = binPath.split("/");
+        if (cachedProjectIndex !== null) {
+            var indexedBin = getIndexedProjectItems([cachedProjectIndex.index.binByPath(binPath, getProjectIndexId(binRelativeStart))], pathParts[pathParts.length - 1]);
+            if (indexedBin !== null) {
+                return indexedBin[0];
+            }
+        }
+
         var currentBin = binRelativeStart;
         for (var i = 0; i < pathParts.length; i++) {
             var part = pathParts[i];
@@ -2381,6 +2678,13 @@ var ThioUtils = (function () {
         // Get the last item of the path. This will be the item to find. Anything before it is the path
         var pathParts = itemPath.split("/");
         var itemName = pathParts.pop();
+        if (cachedProjectIndex !== null) {
+            var indexedItems = getIndexedProjectItems(cachedProjectIndex.index.byPath(itemPath, getProjectIndexId(binRelativeStart)), itemName);
+            if (indexedItems !== null) {
+                return indexedItems;
+            }
+        }
+
         var binPath = pathParts.join("/");
         var binToSearch = this.getBinByPath(binPath, binRelativeStart);
         if (!binToSearch) {
@@ -2412,6 +2716,13 @@ var ThioUtils = (function () {
             return foundItems
         }
 
+        if (cachedProjectIndex !== null) {
+            var indexedItems = getIndexedProjectItems(cachedProjectIndex.index.childrenNamed(getProjectIndexId(binObj), itemName), itemName);
+            if (indexedItems !== null) {
+                return indexedItems;
+            }
+        }
+
         for (var i = 0; i < binObj.children.numItems; i++) {
             var item = binObj.children[i];
             if (item.name === itemName) {
@@ -2464,6 +2775,46 @@ var ThioUtils = (function () {
         return this.getMarkerColorString_fromNumber(markerColorIndex);
     }
 
+    // Native marker indexes from getMarkerIndex, kept for the rest of the script run. Keyed by sequenceID.
+    var cachedMarkerIndexes = {};
+    // Bumped by markersChanged, so kept marker indexes are read again
+    var markerGeneration = 0;
+
+    /**
+     * Gets a native index of a sequence's markers, for queries by time without looping over every marker.
+     * It's read from the sequence on first use and kept for the rest of the script run, and getPredominantMarker_ForTimeRange
+     * and getMarkersAtTime use it too. Added or removed markers are noticed by their count, but call markersChanged after
+     * moving or recoloring markers. Requires the ThioUtils library.
+     * @param {Sequence=} sequence Optional: The sequence to use. If not provided, will use the active sequence.
+     * @returns {MarkerIndex|null} The index (ids are marker indexes, so the Marker is sequence.markers[Number(id)]), or null without the library.
+     */
+    pub.getMarkerIndex = function(sequence) {
+        if (!this.isThioUtilsLibLoaded()) { return null; }
+        var seq = this.checkOrGetActiveSequence(sequence);
+        var markers = seq.markers;
+        var numMarkers = markers.numMarkers;
+
+        var cached = cachedMarkerIndexes[seq.sequenceID];
+        if (cached && cached.numMarkers === numMarkers && cached.generation === markerGeneration) {
+            return cached.index;
+        }
+
+        var index = ThioUtilsLib.createMarkerIndex(markers);
+        if (index === null) {
+            delete cachedMarkerIndexes[seq.sequenceID];
+            return null;
+        }
+        cachedMarkerIndexes[seq.sequenceID] = { index: index, numMarkers: numMarkers, generation: markerGeneration };
+        return index;
+    }
+
+    /**
+     * Makes the kept marker indexes be read again on next use. Call after moving, resizing or recoloring markers.
+     */
+    pub.markersChanged = function() {
+        markerGeneration++;
+    }
+
     /**
      * Gets the name of the name of the marker which takes up the most time within the specified time range in the sequence
      * @param {Time|Number|string} start The start time of the range
@@ -2479,6 +2830,14 @@ var ThioUtils = (function () {
         // Get the markers within the in out region
         if (currSequence.markers.numMarkers > 0) {
             var markers = currSequence.markers
+
+            // The kept native index finds it without comparing every marker in script
+            var markerIndex = this.getMarkerIndex(currSequence);
+            if (markerIndex) {
+                var predominantId = markerIndex.predominant(startTime.ticks, endTime.ticks);
+                return (predominantId === null) ? null : markers[Number(predominantId)];
+            }
+
             var maxMarker = null // The marker that encompasses the largest percentage of the time range
             var maxMarkerPercent = -1 // The precentage of the time range that maxMarker takes up
 
@@ -2530,6 +2889,15 @@ var ThioUtils = (function () {
         if (sequenceToCheck.markers.numMarkers > 0) {
             var sequenceMarkers = sequenceToCheck.markers
 
+            var markerIndex = this.getMarkerIndex(sequenceToCheck);
+            if (markerIndex) {
+                var markerIds = markerIndex.at(timeToCheck.ticks);
+                for (var m = 0; m < markerIds.length; m++) {
+                    foundMarkers.push(sequenceMarkers[Number(markerIds[m])]);
+                }
+                return foundMarkers;
+            }
+
             for (var i = 0; i < sequenceMarkers.numMarkers; i++) {
                 var marker = sequenceMarkers[i]
                 var markerStartTime = marker.start
@@ -2552,11 +2920,20 @@ var ThioUtils = (function () {
 
     /**
      * Gets the first available file name path in a folder by appending an incrementing number if the desired file name already exists.
+     * With ThioUtils.dll the folder is only read once, however many numbered files there are already.
      * @param {string} desiredFileName The desired file name (with extension)
      * @param {string} folderPath The folder path to check within
+     * @param {boolean=} [reserve=false] Also create the (empty) file, so another script or export running at the same time can't take the name. Only with ThioUtils.dll.
      * @return {string} The full file path of the first available file name
      */
-    pub.getFirstAvailableFileNamePath = function(desiredFileName, folderPath) {
+    pub.getFirstAvailableFileNamePath = function(desiredFileName, folderPath, reserve) {
+        if (pub.isThioUtilsLibLoaded()) {
+            var reservedPath = ThioUtilsLib.reserveFileName(folderPath, desiredFileName, "_#", reserve === true);
+            if (reservedPath !== null) {
+                return reservedPath;
+            }
+        }
+
         // Get the file name's stem by splitting off the extension
         var lastDotIndex = desiredFileName.lastIndexOf(".")
         var fileNameStem = desiredFileName.substring(0, lastDotIndex)
@@ -2823,6 +3200,20 @@ var ThioUtils = (function () {
         return false; // Return false if copy failed or ThioUtils is not loaded
     };
 
+    /**
+     * Copy the given text to the clipboard in the background using the ThioUtils library if available. Doesn't wait for the clipboard,
+     * and retries for a moment if another app is using it.
+     * @param {string} text
+     * @returns {number|null} A ticket that ThioUtilsLib.getClipboardStatus(ticket) reports the result for, or null if it couldn't be queued.
+     */
+    pub.copyToClipboardAsync = function (text) {
+        if (this.isThioUtilsLibLoaded()) {
+            return ThioUtilsLib.copyTextToClipboardAsync(text);
+        }
+        $.writeln("ThioUtils.dll not loaded. Can't use copyToClipboardAsync function.");
+        return null;
+    };
+
     // region Categories
     // -----------------------------------------------------------------------------------------------------------------
     // --------------------------------------------------- Categories --------------------------------------------------
@@ -2864,6 +3255,9 @@ var ThioUtils = (function () {
         getBinByPath: pub.getBinByPath,
         getItemInBinByName: pub.getItemInBinByName,
         getItemByPath: pub.getItemByPath,
+        buildProjectIndex: pub.buildProjectIndex,
+        refreshProjectIndexBin: pub.refreshProjectIndexBin,
+        releaseProjectIndex: pub.releaseProjectIndex,
     };
 
     /**
@@ -2895,6 +3289,9 @@ var ThioUtils = (function () {
     pub.clips = {
         getTopTrackItemAtPlayhead: pub.getTopTrackItemAtPlayhead,
         getFirstAvailableTrackIndex: pub.getFirstAvailableTrackIndex,
+        getTimelineIndex: pub.getTimelineIndex,
+        updateTimelineIndex: pub.updateTimelineIndex,
+        removeFromTimelineIndex: pub.removeFromTimelineIndex,
         GetAllVideoClipsUnderPlayhead_AsObjectArray: pub.GetAllVideoClipsUnderPlayhead_AsObjectArray,
         GetSelectedVideoClips: pub.GetSelectedVideoClips,
         getSelectedClipInfoQE: pub.getSelectedClipInfoQE,
@@ -2972,6 +3369,8 @@ var ThioUtils = (function () {
         getMarkerColorString: pub.getMarkerColorString,
         getPredominantMarker_ForTimeRange: pub.getPredominantMarker_ForTimeRange,
         getMarkersAtTime: pub.getMarkersAtTime,
+        getMarkerIndex: pub.getMarkerIndex,
+        markersChanged: pub.markersChanged,
     }
 
     /**
@@ -2982,6 +3381,7 @@ var ThioUtils = (function () {
     pub.util = {
         convertToArray: pub.convertToArray,
         getResolutionFromProjectItem: pub.getResolutionFromProjectItem,
+        getResolutionsFromProjectItems: pub.getResolutionsFromProjectItems,
         getCurrentScriptDirectory: pub.getCurrentScriptDirectory,
         joinPath: pub.joinPath,
         relativeToFullPath: pub.relativeToFullPath,
@@ -3007,7 +3407,8 @@ var ThioUtils = (function () {
         playSuccessBeep: pub.playSuccessBeep,
         playSystemSoundID: pub.playSystemSoundID,
         playSystemSound: pub.playSystemSound,
-        copyToClipboard: pub.copyToClipboard
+        copyToClipboard: pub.copyToClipboard,
+        copyToClipboardAsync: pub.copyToClipboardAsync
     };
 
    
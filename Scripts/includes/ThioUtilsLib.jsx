@@ -16,7 +16,9 @@ var ThioUtils = (function() {
     // --- DLL Loading ---
     // This block attempts to load the DLL when ThioUtils.jsx is included.
     try {
-        var currentScriptFile = File($.fileName); // Path to this ThioUtils.jsx file
+        // Path to this ThioUtils.jsx file. When it came from an include bundle, $.fileName is the script that evaluated
+        // the bundle, and the bundle says where this file is instead.
+        var currentScriptFile = File((typeof thioIncludePath === 'string') ? thioIncludePath : $.fileName);
         
         // Assuming ThioUtils.dll is next to ThioUtils.jsx
         var libPath = currentScriptFile.parent.fullName + "/" + _libFilename;
@@ -26,6 +28,8 @@ var ThioUtils = (function() {
             var thioUtilsDll = new ExternalObject("lib:" + libPath);
             if (thioUtilsDll !== null) {
                 _isLoaded = true;
+                // Lets later scripts in this app session get their includes from the library (getIncludeBundle)
+                $.setenv("THIOUTILS_DLL_PATH", libPath);
             } else {
                 _isLoaded = false;
                 $.writeln("Failed to load ThioUtils library from: " + libPath);
@@ -201,6 +205,28 @@ var ThioUtils = (function() {
         }
     };
 
+    /**
+     * Loads a .wav file from the Windows Media folder into memory, so later playSoundAlias calls for it play without reading the disk. (Corresponds to C++ preloadSound_s)
+     * @param {string} filename - A simple .wav filename, like "Windows Information Bar.wav".
+     * @returns {number} 0 on success, otherwise an error code.
+     */
+    publicApi.preloadSound = function(filename) {
+        if (!publicApi.isLoaded()) { return -999; }
+
+        if (typeof filename !== 'string') {
+            alert("ThioUtils.preloadSound: The filename must be a string.");
+            return -1;
+        }
+
+        try {
+            thioUtilsDll.preloadSound(filename);
+            return 0;
+        } catch (e) {
+            $.writeln("ThioUtils.preloadSound: Exception during call - " + e);
+            return e.number;
+        }
+    };
+
     /**
      * Copies the given text to the system clipboard. (Corresponds to C++ copyTextToClipboard_s)
      * @param {string} textToCopy - The string to copy.
@@ -231,6 +257,1643 @@ var ThioUtils = (function() {
         }
     };
 
+    /**
+     * Queues text to be copied to the clipboard on a background thread and returns right away. (Corresponds to C++ copyTextToClipboardAsync_s)
+     * Use this for large text, or when the clipboard may be busy, so the script doesn't wait on it.
+     * If more text is queued before earlier text was copied, only the newest is copied.
+     * @param {string} textToCopy - The string to copy.
+     * @returns {number|null} A ticket to check with getClipboardStatus, or null if the call failed.
+     */
+    publicApi.copyTextToClipboardAsync = function(textToCopy) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        if (typeof textToCopy !== 'string') {
+            alert("ThioUtils.copyTextToClipboardAsync: The text to copy must be a string.");
+            return null;
+        }
+
+        try {
+            return thioUtilsDll.copyTextToClipboardAsync(textToCopy);
+        } catch (e) {
+            $.writeln("ThioUtils.copyTextToClipboardAsync: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Gets the status of a copy started with copyTextToClipboardAsync. (Corresponds to C++ getClipboardStatus_f)
+     * @param {number} ticket - The ticket returned by copyTextToClipboardAsync.
+     * @returns {number|null} 0 once copied, -1 while pending, -2 if replaced by newer text before being copied,
+     *                        -3 for an unknown ticket, or the error code the copy failed with (see ERROR_DEFINITIONS).
+     */
+    publicApi.getClipboardStatus = function(ticket) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.getClipboardStatus(ticket);
+        } catch (e) {
+            $.writeln("ThioUtils.getClipboardStatus: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Fits an ellipse to a set of points natively. (Corresponds to C++ fitEllipse_a)
+     * Same algorithm and results as fitEllipse() in Path-Points-To-Ellipse.jsx, without needing numeric.js.
+     * @param {Array|NativeBuffer} points - Array of [x, y] pairs, or an f64 NativeBuffer of x0, y0, x1, y1, ... At least six points are required.
+     * @returns {Object|null} Object with cx, cy, a, b, theta properties, or null if no ellipse could be fitted.
+     */
+    publicApi.fitEllipse = function(points) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        if (!(points instanceof Array) && !_isNativeBuffer(points)) {
+            alert("ThioUtils.fitEllipse: The points must be an array of [x, y] pairs.");
+            return null;
+        }
+
+        try {
+            // Nested arrays are flattened by join, so [[1,2],[3,4]] becomes "1,2,3,4"
+            return thioUtilsDll.fitEllipse(_packNumbers(points));
+        } catch (e) {
+            $.writeln("ThioUtils.fitEllipse: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Fits an ellipse to each of several sets of points in a single call. (Corresponds to C++ fitEllipseBatch_s)
+     * @param {Array} pointSets - Array where each element is an array of [x, y] pairs.
+     * @returns {Array|null} Array with one result per set (see fitEllipse), or null if the call failed.
+     */
+    publicApi.fitEllipseBatch = function(pointSets) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        if (!(pointSets instanceof Array)) {
+            alert("ThioUtils.fitEllipseBatch: The point sets must be an array of point arrays.");
+            return null;
+        }
+
+        var packedSets = [];
+        for (var i = 0; i < pointSets.length; i++) {
+            packedSets.push(pointSets[i].join(","));
+        }
+
+        try {
+            return thioUtilsDll.fitEllipseBatch(packedSets.join(";"));
+        } catch (e) {
+            $.writeln("ThioUtils.fitEllipseBatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Time Math ---
+    // Ticks are passed and returned as strings so they stay exact past 2^53 (about 9.8 hours).
+    // Batch functions take an array of ticks (strings or numbers) and return an array, or null if the call failed.
+    // They also take a NativeBuffer (see createNativeBuffer), which the library reads without copying.
+
+    /**
+     * Converts an array of ticks to frame indexes. (Corresponds to C++ ticksToFramesBatch_asd)
+     * @param {Array|NativeBuffer} ticksArray - Tick values (strings or numbers), or an i64 NativeBuffer.
+     * @param {string} timebase - Ticks per frame, such as Sequence.timebase. Or a rational fps like "30000/1001".
+     * @param {number=} rounding - 0 = frame containing the time (default), 1 = nearest frame, 2 = next frame boundary.
+     * @returns {number[]|null}
+     */
+    publicApi.ticksToFramesBatch = function(ticksArray, timebase, rounding) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (typeof rounding !== 'number') { rounding = 0; }
+
+        try {
+            return thioUtilsDll.ticksToFramesBatch(_packNumbers(ticksArray), String(timebase), rounding);
+        } catch (e) {
+            $.writeln("ThioUtils.ticksToFramesBatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Converts an array of frame counts to ticks. (Corresponds to C++ framesToTicksBatch_as)
+     * @param {number[]|NativeBuffer} framesArray - Frame counts, or an i64 NativeBuffer.
+     * @param {string} timebase - Ticks per frame, such as Sequence.timebase. Or a rational fps like "30000/1001".
+     * @returns {string[]|null} Tick strings.
+     */
+    publicApi.framesToTicksBatch = function(framesArray, timebase) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.framesToTicksBatch(_packNumbers(framesArray), String(timebase));
+        } catch (e) {
+            $.writeln("ThioUtils.framesToTicksBatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Rounds an array of ticks to the nearest frame boundary. (Corresponds to C++ roundTicksToFrameBatch_as)
+     * @param {Array|NativeBuffer} ticksArray - Tick values (strings or numbers), or an i64 NativeBuffer.
+     * @param {string} timebase - Ticks per frame, such as Sequence.timebase.
+     * @returns {string[]|null} Tick strings.
+     */
+    publicApi.roundTicksToFrameBatch = function(ticksArray, timebase) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.roundTicksToFrameBatch(_packNumbers(ticksArray), String(timebase));
+        } catch (e) {
+            $.writeln("ThioUtils.roundTicksToFrameBatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Formats an array of ticks as timecode strings. (Corresponds to C++ ticksToTimecodeBatch_asb)
+     * @param {Array|NativeBuffer} ticksArray - Tick values (strings or numbers), or an i64 NativeBuffer.
+     * @param {string} timebase - Ticks per frame, such as Sequence.timebase.
+     * @param {boolean=} dropFrame - Use drop frame timecode for 29.97 / 59.94. Defaults to false.
+     * @returns {string[]|null}
+     */
+    publicApi.ticksToTimecodeBatch = function(ticksArray, timebase, dropFrame) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.ticksToTimecodeBatch(_packNumbers(ticksArray), String(timebase), dropFrame === true);
+        } catch (e) {
+            $.writeln("ThioUtils.ticksToTimecodeBatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Converts an array of ticks to seconds. (Corresponds to C++ ticksToSecondsBatch_a)
+     * @param {Array|NativeBuffer} ticksArray - Tick values (strings or numbers), or an i64 NativeBuffer.
+     * @returns {number[]|null}
+     */
+    publicApi.ticksToSecondsBatch = function(ticksArray) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.ticksToSecondsBatch(_packNumbers(ticksArray));
+        } catch (e) {
+            $.writeln("ThioUtils.ticksToSecondsBatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Adds two tick values exactly. (Corresponds to C++ addTicks_ss)
+     * @param {string|number} ticks1
+     * @param {string|number} ticks2
+     * @returns {string|null} The sum as a tick string, or null if the call failed.
+     */
+    publicApi.addTicks = function(ticks1, ticks2) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.addTicks(String(ticks1), String(ticks2));
+        } catch (e) {
+            $.writeln("ThioUtils.addTicks: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Subtracts the second tick value from the first exactly. (Corresponds to C++ subtractTicks_ss)
+     * @param {string|number} ticks1
+     * @param {string|number} ticks2
+     * @returns {string|null} The difference as a tick string, or null if the call failed.
+     */
+    publicApi.subtractTicks = function(ticks1, ticks2) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.subtractTicks(String(ticks1), String(ticks2));
+        } catch (e) {
+            $.writeln("ThioUtils.subtractTicks: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Sorting ---
+
+    /**
+     * Sorts records of integer keys natively and returns the sorted order. Stable. (Corresponds to C++ sortOrder_sd)
+     * @param {Array} keys - One entry per item. Either a single key (tick string or whole number), or an array of keys
+     *                       with the most significant first, e.g. [clip.start.ticks, trackIndex].
+     * @param {number=} groupKeys - How many leading keys define a group in the result's 'groups'. Defaults to 0.
+     * @returns {{order: number[], groups: number[]}|null} 'order' holds item indexes in sorted order, and 'groups' the
+     *          position in 'order' where each group of equal leading keys starts.
+     */
+    publicApi.sortOrder = function(keys, groupKeys) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        var records = [];
+        for (var i = 0; i < keys.length; i++) {
+            records.push((keys[i] instanceof Array) ? keys[i].join(",") : String(keys[i]));
+        }
+
+        try {
+            return thioUtilsDll.sortOrder(records.join(";"), groupKeys || 0);
+        } catch (e) {
+            $.writeln("ThioUtils.sortOrder: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Returns a copy of 'items' sorted by the matching entries in 'keys' (see sortOrder for the key format).
+     * @param {Array} items - The items to sort, e.g. TrackItems.
+     * @param {Array} keys - One key or array of keys per item.
+     * @returns {Array|null} The sorted copy, or null if the library isn't loaded or the keys aren't valid.
+     */
+    publicApi.sortItemsByKeys = function(items, keys) {
+        var sorted = publicApi.sortOrder(keys, 0);
+        if (sorted === null) { return null; }
+
+        var result = [];
+        for (var i = 0; i < sorted.order.length; i++) {
+            result.push(items[sorted.order[i]]);
+        }
+        return result;
+    };
+
+    // --- Text Patterns ---
+
+    // Encodes an array of strings as a string list, one per line. See TextSearch.h for the format.
+    // An empty array would come out the same as one empty string, so callers return [] for it without calling the DLL.
+    function _encodeTextList(strings) {
+        var lines = [];
+        for (var i = 0; i < strings.length; i++) {
+            var str = String(strings[i]);
+            if (str.indexOf("\\") !== -1 || str.indexOf("\n") !== -1) {
+                str = str.replace(/\\/g, "\\\\").replace(/\n/g, "\\n");
+            }
+            lines.push(str);
+        }
+        return lines.join("\n");
+    }
+
+    /**
+     * Compiles a regular expression once, to run over many strings with the pattern functions below. (Corresponds to C++ compilePattern_ss)
+     * Matching is by UTF-8 byte, so '.', [...] classes and the "i" flag only understand ASCII, and non-ASCII characters
+     * can't go inside [...] (use alternatives instead, e.g. /“|”/ rather than /[“”]/).
+     * @param {RegExp|string} pattern - A RegExp (its source, global and ignoreCase are used), or the pattern source.
+     * @param {string=} flags - "g" and/or "i", when pattern is a string.
+     * @returns {number|null} The pattern's handle, or null if it couldn't be compiled.
+     */
+    publicApi.compilePattern = function(pattern, flags) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        if (pattern instanceof RegExp) {
+            flags = (pattern.global ? "g" : "") + (pattern.ignoreCase ? "i" : "");
+            pattern = pattern.source;
+        }
+
+        try {
+            return thioUtilsDll.compilePattern(String(pattern), flags || "");
+        } catch (e) {
+            $.writeln("ThioUtils.compilePattern: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Releases a pattern from compilePattern. (Corresponds to C++ releasePattern_d)
+     * @param {number} handle
+     * @returns {boolean} True if the handle was still held.
+     */
+    publicApi.releasePattern = function(handle) {
+        if (!publicApi.isLoaded()) { return false; }
+
+        try {
+            return thioUtilsDll.releasePattern(handle);
+        } catch (e) {
+            $.writeln("ThioUtils.releasePattern: Exception during call - " + e);
+            return false;
+        }
+    };
+
+    /**
+     * Tests a compiled pattern against every string, like RegExp.test. (Corresponds to C++ patternTestBatch_ds)
+     * @param {number} handle - From compilePattern.
+     * @param {string[]} strings
+     * @returns {boolean[]|null}
+     */
+    publicApi.patternTest = function(handle, strings) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (strings.length === 0) { return []; }
+
+        try {
+            return thioUtilsDll.patternTestBatch(handle, _encodeTextList(strings));
+        } catch (e) {
+            $.writeln("ThioUtils.patternTest: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Matches a compiled pattern against every string, like String.match. (Corresponds to C++ patternMatchBatch_ds)
+     * @param {number} handle - From compilePattern.
+     * @param {string[]} strings
+     * @returns {Array|null} One entry per string: null for no match, otherwise the match and its groups (or every match with "g").
+     */
+    publicApi.patternMatch = function(handle, strings) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (strings.length === 0) { return []; }
+
+        try {
+            return thioUtilsDll.patternMatchBatch(handle, _encodeTextList(strings));
+        } catch (e) {
+            $.writeln("ThioUtils.patternMatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Replaces matches of a compiled pattern in every string, like String.replace. (Corresponds to C++ patternReplaceBatch_dss)
+     * @param {number} handle - From compilePattern.
+     * @param {string[]} strings
+     * @param {string} replacement - Can use $&, $1, etc.
+     * @returns {string[]|null}
+     */
+    publicApi.patternReplace = function(handle, strings, replacement) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (strings.length === 0) { return []; }
+
+        try {
+            return thioUtilsDll.patternReplaceBatch(handle, _encodeTextList(strings), String(replacement));
+        } catch (e) {
+            $.writeln("ThioUtils.patternReplace: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Splits every string on a compiled pattern, like String.split. (Corresponds to C++ patternSplitBatch_ds)
+     * @param {number} handle - From compilePattern.
+     * @param {string[]} strings
+     * @returns {Array[]|null} An array of pieces per string.
+     */
+    publicApi.patternSplit = function(handle, strings) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (strings.length === 0) { return []; }
+
+        try {
+            return thioUtilsDll.patternSplitBatch(handle, _encodeTextList(strings));
+        } catch (e) {
+            $.writeln("ThioUtils.patternSplit: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Checks which strings contain a substring, ignoring ASCII case. (Corresponds to C++ containsIgnoreCaseBatch_ss)
+     * @param {string[]} strings
+     * @param {string} substring
+     * @returns {boolean[]|null}
+     */
+    publicApi.containsIgnoreCase = function(strings, substring) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (strings.length === 0) { return []; }
+
+        try {
+            return thioUtilsDll.containsIgnoreCaseBatch(_encodeTextList(strings), String(substring));
+        } catch (e) {
+            $.writeln("ThioUtils.containsIgnoreCase: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Times a replace over a list of strings with ExtendScript's RegExp and with the compiled native pattern, and writes
+     * the result to the console. Run it with real marker or clip names to see which is faster for a project.
+     * @param {string[]} strings - e.g. the names of every marker in a sequence.
+     * @param {RegExp} regex
+     * @param {string} replacement
+     * @returns {{scriptMs: number, nativeMs: number, sameResults: boolean}|null}
+     */
+    publicApi.benchmarkPatterns = function(strings, regex, replacement) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        $.hiresTimer; // Reading it resets it
+        var scriptResults = [];
+        for (var i = 0; i < strings.length; i++) {
+            scriptResults.push(strings[i].replace(regex, replacement));
+        }
+        var scriptMs = $.hiresTimer / 1000;
+
+        var handle = publicApi.compilePattern(regex);
+        if (handle === null) { return null; }
+        var nativeResults = publicApi.patternReplace(handle, strings, replacement);
+        var nativeMs = $.hiresTimer / 1000;
+        publicApi.releasePattern(handle);
+
+        var sameResults = (nativeResults !== null && nativeResults.join("\n") === scriptResults.join("\n"));
+        $.writeln("ThioUtils.benchmarkPatterns: " + strings.length + " strings, " + regex.toString() + ". RegExp: " + scriptMs.toFixed(2)
+            + " ms, native: " + nativeMs.toFixed(2) + " ms" + (sameResults ? "" : " (RESULTS DIFFER)"));
+        return { scriptMs: scriptMs, nativeMs: nativeMs, sameResults: sameResults };
+    };
+
+    // --- Batched Calls ---
+
+    // Encodes one argument for the callBatch command buffer. See BatchCall.cpp for the format.
+    function _encodeBatchArg(value) {
+        if (typeof value === 'string') {
+            return "s" + value.replace(/\\/g, "\\\\").replace(/\t/g, "\\t").replace(/\n/g, "\\n");
+        } else if (typeof value === 'number') {
+            return "n" + String(value);
+        } else if (typeof value === 'boolean') {
+            return value ? "b1" : "b0";
+        } else if (value instanceof Array) {
+            return _encodeBatchArg(value.join(",")); // Arrays are passed packed, like the other batch functions expect
+        }
+        return "u";
+    }
+
+    /**
+     * Runs many library functions in a single call to the DLL. (Corresponds to C++ callBatch_s)
+     * Use this instead of calling functions in a loop, since each separate call to the DLL has a fixed overhead.
+     * @param {Array} operations - Array of operations, each an array of [functionName, arg1, arg2, ...]
+     *                             The names are the DLL function names, e.g. ["addTicks", "100", "200"]
+     * @returns {Object|null} {results: [...], errors: [...]} with one entry per operation. errors[i] is 0 on success,
+     *                        otherwise the error code for that operation. Returns null if the whole call failed.
+     */
+    publicApi.callBatch = function(operations) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        if (!(operations instanceof Array)) {
+            alert("ThioUtils.callBatch: The operations must be an array of [functionName, args...] arrays.");
+            return null;
+        }
+
+        var lines = [];
+        for (var i = 0; i < operations.length; i++) {
+            var op = operations[i];
+            var fields = [String(op[0])];
+            for (var j = 1; j < op.length; j++) {
+                fields.push(_encodeBatchArg(op[j]));
+            }
+            lines.push(fields.join("\t"));
+        }
+
+        try {
+            return thioUtilsDll.callBatch(lines.join("\n"));
+        } catch (e) {
+            $.writeln("ThioUtils.callBatch: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Calls a library function whose result may be very large, and reads the result back in pieces. (Corresponds to C++ callChunked_s and readResultChunk_dd)
+     * @param {string} functionName - The DLL function name, e.g. "ticksToTimecodeBatch"
+     * @param {Array} args - The arguments for the function
+     * @param {Function=} onChunk - Optional: Called as onChunk(text, index) for each piece instead of building the whole result,
+     *                              e.g. to write it to a file as it arrives. Pieces never split a character.
+     * @returns {*} The function's result (evaluated if it's an object or array), true if onChunk was used, or null if the call failed.
+     */
+    publicApi.callChunked = function(functionName, args, onChunk) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        var fields = [String(functionName)];
+        for (var i = 0; i < args.length; i++) {
+            fields.push(_encodeBatchArg(args[i]));
+        }
+
+        var info = null;
+        try {
+            info = thioUtilsDll.callChunked(fields.join("\t"));
+            if (info.handle === 0) {
+                return info.value; // Not a string, returned directly
+            }
+
+            var pieces = [];
+            for (var c = 0; c < info.chunkCount; c++) {
+                var chunk = thioUtilsDll.readResultChunk(info.handle, c);
+                if (typeof onChunk === 'function') {
+                    onChunk(chunk, c);
+                } else {
+                    pieces.push(chunk);
+                }
+            }
+
+            if (typeof onChunk === 'function') {
+                return true;
+            }
+            return info.isScript ? eval(pieces.join("")) : pieces.join("");
+        } catch (e) {
+            $.writeln("ThioUtils.callChunked: Exception during call - " + e);
+            if (info && info.handle) {
+                try { thioUtilsDll.releaseResult(info.handle); } catch (e2) {} // Don't leave the rest of the result held
+            }
+            return null;
+        }
+    };
+
+    // --- JSON ---
+
+    /**
+     * Parses JSON text natively. Faster than eval for large documents, and only ever evaluates plain data. (Corresponds to C++ parseJson_ss)
+     * @param {string} text - The JSON text
+     * @param {string=} pointer - Optional: A JSON Pointer to return only part of the document, e.g. "/clips/0/name"
+     * @returns {*} The parsed value, or undefined if the text is invalid (see getJsonError) or the library isn't loaded.
+     */
+    publicApi.parseJson = function(text, pointer) {
+        if (!publicApi.isLoaded()) { return undefined; }
+
+        try {
+            return thioUtilsDll.parseJson(String(text), pointer ? String(pointer) : "");
+        } catch (e) {
+            $.writeln("ThioUtils.parseJson: " + thioUtilsDll.getJsonError());
+            return undefined;
+        }
+    };
+
+    /**
+     * Reads and parses a JSON file natively, without loading the text into ExtendScript first. (Corresponds to C++ parseJsonFile_ss)
+     * @param {File|string} file - The file, or its path
+     * @param {string=} pointer - Optional: A JSON Pointer to return only part of the document
+     * @returns {*} The parsed value, or undefined if the file couldn't be read or parsed (see getJsonError).
+     */
+    publicApi.parseJsonFile = function(file, pointer) {
+        if (!publicApi.isLoaded()) { return undefined; }
+
+        var path = (file instanceof File) ? file.fsName : String(file);
+        try {
+            return thioUtilsDll.parseJsonFile(path, pointer ? String(pointer) : "");
+        } catch (e) {
+            $.writeln("ThioUtils.parseJsonFile: " + thioUtilsDll.getJsonError());
+            return undefined;
+        }
+    };
+
+    /**
+     * Gets why the last parseJson / parseJsonFile call failed. (Corresponds to C++ getJsonError)
+     * @returns {string} The message, e.g. "Expected ':' at line 3, column 12", or an empty string.
+     */
+    publicApi.getJsonError = function() {
+        if (!publicApi.isLoaded()) { return ""; }
+
+        try {
+            return thioUtilsDll.getJsonError();
+        } catch (e) {
+            $.writeln("ThioUtils.getJsonError: Exception during call - " + e);
+            return "";
+        }
+    };
+
+    /**
+     * Builds JSON text for an array of objects with the same fields, e.g. to save settings or clip data to a file. (Corresponds to C++ recordsToJson_ss)
+     * @param {Array} fieldNames - The property names, e.g. ["name", "start"]. Can't contain commas.
+     * @param {Array} rows - One array of values per object, in the same order as fieldNames. Values can be strings, numbers,
+     *                       booleans or null. Arrays are joined with commas like the other batch functions.
+     * @returns {string|null} The JSON text, e.g. '[{"name":"Clip 1","start":0}]', or null if the call failed.
+     */
+    publicApi.recordsToJson = function(fieldNames, rows) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        var lines = [];
+        for (var i = 0; i < rows.length; i++) {
+            var fields = [];
+            for (var j = 0; j < rows[i].length; j++) {
+                fields.push(_encodeBatchArg(rows[i][j]));
+            }
+            lines.push(fields.join("\t"));
+        }
+
+        try {
+            return thioUtilsDll.recordsToJson(fieldNames.join(","), lines.join("\n"));
+        } catch (e) {
+            $.writeln("ThioUtils.recordsToJson: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // Compares two parsed JSON values. Key order is ignored, NaN can't occur in JSON so === is enough for the rest.
+    function _sameJsonValue(a, b) {
+        if (a === null || b === null || typeof a !== 'object' || typeof b !== 'object') { return a === b; }
+        if ((a instanceof Array) !== (b instanceof Array)) { return false; }
+
+        var key;
+        var count = 0;
+        for (key in a) {
+            if (!a.hasOwnProperty(key)) { continue; }
+            if (!b.hasOwnProperty(key) || !_sameJsonValue(a[key], b[key])) { return false; }
+            count++;
+        }
+        for (key in b) {
+            if (b.hasOwnProperty(key)) { count--; }
+        }
+        return count === 0;
+    }
+
+    /**
+     * Times parsing JSON text with eval, with JSON.parse if json2.js (or another JSON object) is loaded, and with
+     * parseJson, and writes the result to the console. Run it with a real settings or export file to see which is faster.
+     * The text is passed to eval, so only use it with trusted text.
+     * @param {string} text - The JSON text
+     * @param {number=} iterations - How many times to parse it with each, the times are per parse. Defaults to 1.
+     * @returns {{evalMs: number, jsonParseMs: (number|null), nativeMs: number, sameResults: boolean}|null}
+     *          jsonParseMs is null when there's no JSON.parse.
+     */
+    publicApi.benchmarkJson = function(text, iterations) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        text = String(text);
+        var runs = (iterations > 0) ? Math.floor(iterations) : 1;
+        var i;
+
+        $.hiresTimer; // Reading it resets it
+        var evalResult;
+        for (i = 0; i < runs; i++) {
+            evalResult = eval("(" + text + ")");
+        }
+        var evalMs = $.hiresTimer / 1000 / runs;
+
+        var jsonParseMs = null;
+        var jsonParseResult;
+        if (typeof JSON === 'object' && JSON !== null && typeof JSON.parse === 'function') {
+            for (i = 0; i < runs; i++) {
+                jsonParseResult = JSON.parse(text);
+            }
+            jsonParseMs = $.hiresTimer / 1000 / runs;
+        }
+
+        var nativeResult;
+        for (i = 0; i < runs; i++) {
+            nativeResult = publicApi.parseJson(text);
+        }
+        var nativeMs = $.hiresTimer / 1000 / runs;
+
+        var sameResults = (nativeResult !== undefined && _sameJsonValue(nativeResult, evalResult)
+            && (jsonParseMs === null || _sameJsonValue(nativeResult, jsonParseResult)));
+        $.writeln("ThioUtils.benchmarkJson: " + text.length + " characters, " + runs + " runs. eval: " + evalMs.toFixed(2) + " ms"
+            + (jsonParseMs === null ? "" : ", JSON.parse: " + jsonParseMs.toFixed(2) + " ms")
+            + ", native: " + nativeMs.toFixed(2) + " ms" + (sameResults ? "" : " (RESULTS DIFFER)"));
+        return { evalMs: evalMs, jsonParseMs: jsonParseMs, nativeMs: nativeMs, sameResults: sameResults };
+    };
+
+    // --- Result Cache ---
+
+    // Whether the result cache is open: null until the first try, then true or false
+    var _resultCacheOpen = null;
+
+    /**
+     * Opens the file results are cached in between script runs. (Corresponds to C++ cacheOpen_s)
+     * getCachedResult and putCachedResult open the default file on their own, so this is only needed for a different one.
+     * Only one Premiere or After Effects instance can have the file open. Others just run without the cache.
+     * @param {string=} path - Defaults to ThioUtils/ResultCache.bin in the user data folder
+     * @returns {boolean} True if the cache is open.
+     */
+    publicApi.openResultCache = function(path) {
+        if (!publicApi.isLoaded()) { return false; }
+        if (typeof path === 'undefined' || path === null) {
+            var folder = new Folder(Folder.userData.fsName + "/ThioUtils");
+            if (!folder.exists) { folder.create(); }
+            path = folder.fsName + "/ResultCache.bin";
+        }
+
+        try {
+            thioUtilsDll.cacheOpen(String(path));
+            _resultCacheOpen = true;
+        } catch (e) {
+            $.writeln("ThioUtils.openResultCache: Exception during call - " + e);
+            _resultCacheOpen = false;
+        }
+        return _resultCacheOpen;
+    };
+
+    function _ensureResultCache() {
+        return (_resultCacheOpen === null) ? publicApi.openResultCache() : _resultCacheOpen;
+    }
+
+    /**
+     * Gets a result stored by putCachedResult, as long as the file it was computed from hasn't been modified since. (Corresponds to C++ cacheGet_ss)
+     * @param {string} filePath - The file the result came from: usually the project (app.project.path), or e.g. a media file
+     * @param {string} kind - Any name for what the result is, e.g. "sequences"
+     * @returns {string|null} The stored string, or null if there's none for the file as it is now.
+     */
+    publicApi.getCachedResult = function(filePath, kind) {
+        if (!publicApi.isLoaded() || !filePath || !_ensureResultCache()) { return null; }
+
+        try {
+            return thioUtilsDll.cacheGet(String(filePath), String(kind));
+        } catch (e) {
+            $.writeln("ThioUtils.getCachedResult: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Stores a result computed from a file, for getCachedResult in this or a later run. (Corresponds to C++ cachePut_sss)
+     * Saving or otherwise modifying the file makes the result stale. Note a project's unsaved changes don't count, since
+     * the project file itself hasn't changed, so only cache results that unsaved edits can't affect, or save first.
+     * @param {string} filePath - The file the result came from
+     * @param {string} kind - Any name for what the result is
+     * @param {string} value - The result. Use e.g. recordsToJson or a packed string for anything that isn't a string.
+     * @returns {boolean} True if stored. False if the file doesn't exist (e.g. a project that was never saved) or there's no cache.
+     */
+    publicApi.putCachedResult = function(filePath, kind, value) {
+        if (!publicApi.isLoaded() || !filePath || !_ensureResultCache()) { return false; }
+
+        try {
+            return thioUtilsDll.cachePut(String(filePath), String(kind), String(value));
+        } catch (e) {
+            $.writeln("ThioUtils.putCachedResult: Exception during call - " + e);
+            return false;
+        }
+    };
+
+    /**
+     * Shrinks the cache file by dropping old results. Happens on its own once most of the file is unused. (Corresponds to C++ cacheCompact)
+     * @returns {number|null} Bytes freed, or null if the call failed.
+     */
+    publicApi.compactResultCache = function() {
+        if (!publicApi.isLoaded() || !_ensureResultCache()) { return null; }
+
+        try {
+            return thioUtilsDll.cacheCompact();
+        } catch (e) {
+            $.writeln("ThioUtils.compactResultCache: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Describes the result cache. (Corresponds to C++ cacheInfo)
+     * @returns {{path: string, records: number, liveRecords: number, fileBytes: number, liveBytes: number, hits: number, misses: number}|null}
+     */
+    publicApi.getResultCacheInfo = function() {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.cacheInfo();
+        } catch (e) {
+            $.writeln("ThioUtils.getResultCacheInfo: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Closes the result cache file, e.g. so another instance can use it. The next get or put opens it again.
+     */
+    publicApi.closeResultCache = function() {
+        if (!publicApi.isLoaded()) { return; }
+
+        try {
+            thioUtilsDll.cacheClose();
+        } catch (e) {
+            $.writeln("ThioUtils.closeResultCache: Exception during call - " + e);
+        }
+        _resultCacheOpen = null;
+    };
+
+    // --- Background Jobs ---
+
+    /**
+     * Starts a job on one of the DLL's worker threads and returns right away. (Corresponds to C++ startJob_ss)
+     * Check on it with pollJob between other work (or while updating a progress window), then fetch it with getJobResult.
+     * @param {string} kind - "call", "hashFile" or "readProject". See startCallJob, startHashFileJob and startReadProjectFileJob.
+     * @param {string} payload - What the job works on
+     * @returns {number|null} The job id, or null if it couldn't be started.
+     */
+    publicApi.startJob = function(kind, payload) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.startJob(String(kind), String(payload));
+        } catch (e) {
+            $.writeln("ThioUtils.startJob: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Runs a library function on a worker thread, e.g. a large batch conversion, without freezing the app meanwhile.
+     * @param {string} functionName - The DLL function name, e.g. "ticksToTimecodeBatch"
+     * @param {Array} args - The arguments for the function, as for callBatch
+     * @returns {number|null} The job id, or null if it couldn't be started.
+     */
+    publicApi.startCallJob = function(functionName, args) {
+        var fields = [String(functionName)];
+        for (var i = 0; i < args.length; i++) {
+            fields.push(_encodeBatchArg(args[i]));
+        }
+        return publicApi.startJob("call", fields.join("\t"));
+    };
+
+    /**
+     * Computes a file's CRC-32 on a worker thread. The result is {crc32: "1a2b3c4d", bytes: n}, and pollJob's done / total count bytes.
+     * @param {string} filePath - The file, e.g. a project item's media path
+     * @returns {number|null} The job id, or null if it couldn't be started.
+     */
+    publicApi.startHashFileJob = function(filePath) {
+        return publicApi.startJob("hashFile", filePath);
+    };
+
+    /**
+     * Gets a job's state and progress. (Corresponds to C++ pollJob_d)
+     * @param {number} jobId - From one of the start functions
+     * @returns {{state: string, done: number, total: number}|null} state is "queued", "running", "done", "failed" or "cancelled".
+     *          Null if there's no such job, e.g. its result was already fetched.
+     */
+    publicApi.pollJob = function(jobId) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.pollJob(jobId);
+        } catch (e) {
+            $.writeln("ThioUtils.pollJob: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Cancels a job. A running job stops as soon as it can. For a finished job, this just discards its result. (Corresponds to C++ cancelJob_d)
+     * @param {number} jobId - From one of the start functions
+     * @returns {boolean} True if the job hadn't finished yet.
+     */
+    publicApi.cancelJob = function(jobId) {
+        if (!publicApi.isLoaded()) { return false; }
+
+        try {
+            return thioUtilsDll.cancelJob(jobId);
+        } catch (e) {
+            $.writeln("ThioUtils.cancelJob: Exception during call - " + e);
+            return false;
+        }
+    };
+
+    /**
+     * Gets a finished job's result. The job is forgotten afterwards, so this only works once per job. (Corresponds to C++ getJobResult_d)
+     * @param {number} jobId - A job whose state is "done"
+     * @returns {*} The job's result, or null if it failed, was cancelled or hasn't finished.
+     */
+    publicApi.getJobResult = function(jobId) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            var result = thioUtilsDll.getJobResult(jobId);
+            return (typeof result === 'undefined') ? null : result;
+        } catch (e) {
+            $.writeln("ThioUtils.getJobResult: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Performance Stats ---
+
+    /**
+     * Gets the DLL's call counters and latencies since it was loaded or since resetStats. (Corresponds to C++ getStats_s)
+     * See getStats in ExportStats.cpp for the fields. Times are in nanoseconds.
+     * @param {string=} functionName - Optional: Only report this DLL function, e.g. "addTicks". Otherwise every function that was called.
+     * @returns {string|null} The stats as a JSON string, or null if the call failed.
+     */
+    publicApi.getStats = function(functionName) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.getStats(functionName ? String(functionName) : "");
+        } catch (e) {
+            $.writeln("ThioUtils.getStats: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Starts the DLL's call counters over from zero. (Corresponds to C++ resetStats)
+     */
+    publicApi.resetStats = function() {
+        if (!publicApi.isLoaded()) { return; }
+
+        try {
+            thioUtilsDll.resetStats();
+        } catch (e) {
+            $.writeln("ThioUtils.resetStats: Exception during call - " + e);
+        }
+    };
+
+    /**
+     * Writes a one line summary per DLL function to the console: calls, errors, and p50 / p99 / total time in milliseconds.
+     */
+    publicApi.logStats = function() {
+        var json = publicApi.getStats();
+        if (json === null) { return; }
+
+        var stats = publicApi.parseJson(json);
+        $.writeln("ThioUtils stats over the last " + stats.sinceResetMs + " ms:");
+        for (var name in stats.exports) {
+            if (stats.exports.hasOwnProperty(name)) {
+                var s = stats.exports[name];
+                $.writeln("  " + name + ": " + s.calls + " calls, " + s.errors + " errors, p50 " + (s.p50Ns / 1e6) +
+                    " ms, p99 " + (s.p99Ns / 1e6) + " ms, total " + (s.totalNs / 1e6) + " ms");
+            }
+        }
+    };
+
+    /**
+     * Saves the full stats JSON to a file, e.g. to compare runs.
+     * @param {string} filePath - Path of the file to write. It's overwritten if it exists.
+     * @returns {boolean} True if the file was written.
+     */
+    publicApi.saveStats = function(filePath) {
+        var json = publicApi.getStats();
+        if (json === null) { return false; }
+
+        var file = new File(filePath);
+        file.encoding = "UTF-8";
+        if (!file.open("w")) {
+            $.writeln("ThioUtils.saveStats: Could not open " + filePath + " for writing.");
+            return false;
+        }
+        file.write(json);
+        file.close();
+        return true;
+    };
+
+    // --- Timeline Index ---
+
+    /**
+     * Creates a native TimelineIndex holding every clip in a track collection, for fast lookups by time. (C++ class TimelineIndex)
+     * Clip ids are "trackIndex:clipIndex", so the TrackItem is tracks[trackIndex].clips[clipIndex].
+     * Methods on the returned object (times are tick strings, like Time.ticks):
+     *      clipAt(track, ticks), clipStartingAt(track, ticks)  -> id or null
+     *      overlaps(track, startTicks, endTicks)               -> array of ids
+     *      isRangeFree(track, startTicks, endTicks)            -> boolean
+     *      firstFreeTrack(startTicks, endTicks, minTrack, trackCount) -> track index, or -1
+     *      insert(track, startTicks, endTicks, id), remove(id), setTrackLocked(track, locked), load(packed), clear()
+     *      count, trackCount
+     * @param {TrackCollection} tracks - e.g. sequence.videoTracks
+     * @param {Object=} clipsById - If given, clip ids are nodeIds instead, and each TrackItem is stored in this object under
+     *     its id. Those ids stay valid as clips are inserted and removed, so the index can be kept and updated after edits.
+     * @returns {TimelineIndex|null} The index, or null if the library isn't loaded.
+     */
+    publicApi.createTimelineIndex = function(tracks, clipsById) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        var records = [];
+        for (var t = 0; t < tracks.numTracks; t++) {
+            var clips = tracks[t].clips;
+            for (var c = 0; c < clips.numItems; c++) {
+                var clip = clips[c];
+                var id = t + ":" + c;
+                if (clipsById) {
+                    id = clip.nodeId;
+                    clipsById[id] = clip;
+                }
+                records.push(t + "," + clip.start.ticks + "," + clip.end.ticks + "," + id);
+            }
+        }
+
+        try {
+            var index = new TimelineIndex(records.join(";"));
+            for (var i = 0; i < tracks.numTracks; i++) {
+                if (tracks[i].isLocked()) {
+                    index.setTrackLocked(i, true);
+                }
+            }
+            return index;
+        } catch (e) {
+            $.writeln("ThioUtils.createTimelineIndex: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Creates a native TimelineIndex from clips the caller already read, e.g. QE track items, which createTimelineIndex
+     * can't read. (C++ class TimelineIndex)
+     * @param {Array} records - One [track, startTicks, endTicks, id] array per clip. Ids can't contain ',' or ';'.
+     * @returns {TimelineIndex|null} The index, or null if the library isn't loaded or a record is malformed.
+     */
+    publicApi.createTimelineIndexFromRecords = function(records) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        var packed = [];
+        for (var i = 0; i < records.length; i++) {
+            packed.push(records[i].join(","));
+        }
+
+        try {
+            return new TimelineIndex(packed.join(";"));
+        } catch (e) {
+            $.writeln("ThioUtils.createTimelineIndexFromRecords: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Marker Index ---
+
+    /**
+     * Creates a native MarkerIndex holding every marker in a marker collection, for fast queries by time. (C++ class MarkerIndex)
+     * Marker ids are the marker's index, so the Marker is markers[Number(id)].
+     * Methods on the returned object (times are tick strings, like Time.ticks):
+     *      at(ticks)                           -> array of ids. Point markers exactly at the time, and markers with a duration that include it
+     *      inRange(startTicks, endTicks)       -> array of ids overlapping the range
+     *      predominant(startTicks, endTicks)   -> id of the marker with a duration covering the most of the range, or null
+     *      coverage(startTicks, endTicks)      -> object of color index -> tick string covered by markers of that color
+     *      load(packed), clear(), count
+     * @param {MarkerCollection} markers - e.g. sequence.markers
+     * @returns {MarkerIndex|null} The index, or null if the library isn't loaded.
+     */
+    publicApi.createMarkerIndex = function(markers) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        var records = [];
+        for (var i = 0; i < markers.numMarkers; i++) {
+            var marker = markers[i];
+            records.push(marker.start.ticks + "," + marker.end.ticks + "," + marker.getColorByIndex() + "," + i);
+        }
+
+        try {
+            return new MarkerIndex(records.join(";"));
+        } catch (e) {
+            $.writeln("ThioUtils.createMarkerIndex: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Project Index ---
+
+    // Escapes one field of a ProjectIndex record. See ProjectIndex.h for the format.
+    function _encodeProjectField(str) {
+        return String(str).replace(/\\/g, "\\\\").replace(/\t/g, "\\t").replace(/\n/g, "\\n");
+    }
+
+    // Premiere's ProjectItemType values: CLIP 1, BIN 2, ROOT 3, FILE 4
+    function _projectItemTypeName(item) {
+        if (item.type === 2) { return "bin"; }
+        if (item.type === 4) { return "file"; }
+        return item.isSequence() ? "sequence" : "clip";
+    }
+
+    // Appends a record for every item under 'bin' at every depth, and adds each item to 'items' by nodeId.
+    // Walks with a stack of bins rather than recursion, so nothing gets copied per level.
+    function _appendProjectRecords(bin, records, items) {
+        var pending = [bin];
+        while (pending.length > 0) {
+            var current = pending.pop();
+            var parentId = (current.type === 3) ? "" : _encodeProjectField(current.nodeId);
+            var children = current.children;
+            for (var i = 0; i < children.numItems; i++) {
+                var child = children[i];
+                var typeName = _projectItemTypeName(child);
+                items[child.nodeId] = child;
+                records.push(_encodeProjectField(child.nodeId) + "\t" + parentId + "\t" + typeName + "\t" + _encodeProjectField(child.name));
+                if (typeName === "bin") {
+                    pending.push(child);
+                }
+            }
+        }
+    }
+
+    /**
+     * Creates a native ProjectIndex of every item in a Premiere project, for lookups without walking the project panel. (C++ class ProjectIndex)
+     * Item ids are nodeIds, and the returned items object maps them back to ProjectItems. "" is the root.
+     * Methods on the returned index:
+     *      byPath(path, startBinId)        -> array of ids at a path like "Bin/Sub Bin/Item". Bins along the way are the first with that name
+     *      binByPath(path, startBinId)     -> id of the bin at the path, or null
+     *      childrenNamed(binId, name)      -> array of ids directly in a bin with exactly that name
+     *      byName(name, type)              -> array of ids anywhere with the name, ignoring case. Types: "bin", "sequence", "clip", "file"
+     *      sequences()                     -> array of ids of every sequence
+     *      pathOf(id)                      -> the item's path, or null
+     *      generationOf(binId)             -> generation of the newest change in the bin. Compare with an earlier value to see if it changed
+     *      update(binId, records), remove(id), load(records), clear(), count, generation
+     * After changing a bin, call refreshProjectIndexBin so only that bin is read again.
+     * @param {ProjectItem=} rootItem - Defaults to app.project.rootItem
+     * @returns {{index: ProjectIndex, items: Object}|null} The index and the items by nodeId, or null if the library isn't loaded.
+     */
+    publicApi.createProjectIndex = function(rootItem) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (typeof rootItem === 'undefined' || rootItem === null) { rootItem = app.project.rootItem; }
+
+        var records = [];
+        var items = {};
+        _appendProjectRecords(rootItem, records, items);
+
+        try {
+            return { index: new ProjectIndex(records.join("\n")), items: items };
+        } catch (e) {
+            $.writeln("ThioUtils.createProjectIndex: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Reads one bin again and replaces its contents in an index from createProjectIndex. Items that didn't change keep their generation.
+     * @param {{index: ProjectIndex, items: Object}} projectIndex - From createProjectIndex
+     * @param {ProjectItem} bin - The bin that changed, or the root item
+     * @returns {number|null} The index's generation afterwards, or null if the bin isn't in the index or the call failed.
+     */
+    publicApi.refreshProjectIndexBin = function(projectIndex, bin) {
+        if (!publicApi.isLoaded() || !projectIndex) { return null; }
+
+        var records = [];
+        _appendProjectRecords(bin, records, projectIndex.items);
+
+        try {
+            return projectIndex.index.update((bin.type === 3) ? "" : bin.nodeId, records.join("\n"));
+        } catch (e) {
+            $.writeln("ThioUtils.refreshProjectIndexBin: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Native Buffers ---
+
+    // True for a NativeBuffer. The class only exists once the library is loaded.
+    function _isNativeBuffer(value) {
+        return typeof NativeBuffer !== 'undefined' && value instanceof NativeBuffer;
+    }
+
+    // Packs an array of numbers for the library. A NativeBuffer is passed as it is, since the library reads it in place.
+    function _packNumbers(values) {
+        return _isNativeBuffer(values) ? values : values.join(",");
+    }
+
+    /**
+     * Creates a native typed array, for numbers that are filled once and then read, reduced or passed to other functions many times. (C++ class NativeBuffer)
+     * Functions that take arrays of ticks or points (the Time Math batch functions, fitEllipse) accept the buffer instead, without converting it to a string.
+     * Methods on the returned buffer (index arguments are numbers; begin and end are optional and work like Array.slice):
+     *      get(index), set(index, value)   -> i64 values are returned as strings, like Time.ticks, and can be set from strings
+     *      fill(value, begin, end)         -> sets a range to one value
+     *      load(packed)                    -> replaces the contents with comma separated numbers, returns the new length
+     *      min(begin, end), max(begin, end), sum(begin, end)  -> min and max are null for an empty range
+     *      slice(begin, end)               -> array of the values
+     *      join(separator), resize(length), length, type
+     * new NativeBuffer(buffer, begin, end) copies part of another buffer.
+     * @param {string} type - "f64" for doubles, "i64" for 64-bit integers such as ticks, or "i32".
+     * @param {Array|number|string=} values - Initial values as an array or a comma separated string, or a length to start with that many zeros.
+     * @returns {NativeBuffer|null} The buffer, or null if the library isn't loaded or a value doesn't fit the type.
+     */
+    publicApi.createNativeBuffer = function(type, values) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            if (typeof values === 'undefined') {
+                return new NativeBuffer(type);
+            }
+            return new NativeBuffer(type, (values instanceof Array) ? values.join(",") : values);
+        } catch (e) {
+            $.writeln("ThioUtils.createNativeBuffer: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Keyframes ---
+    // A curve is a packed string of keys, "ticks,value,interpolation" or "ticks,x,y,interpolation" for Position, which
+    // packKeyframes builds from a property. See Keyframes.h. Interpolation: 0 linear, 1 hold, 2 bezier.
+    // resampleKeyframes and simplifyKeyframes return {ticks: [...], values: [...], interpolation: [...]}, for writeKeyframes.
+
+    // A Time for a tick string
+    function _timeFromTicks(ticks) {
+        var time = new Time();
+        time.ticks = String(ticks);
+        return time;
+    }
+
+    /**
+     * Reads every keyframe of an effect property into a packed curve. Scripts can't read interpolation types, so every key gets the same one.
+     * @param {ComponentParam} param - e.g. the Motion component's Position property
+     * @param {number=} interpolation - Interpolation to record for every key. Defaults to 0 (linear).
+     * @returns {string|null} The packed curve, "" if the property has no keys, or null if its values aren't numbers or [x, y] points.
+     */
+    publicApi.packKeyframes = function(param, interpolation) {
+        if (typeof interpolation !== 'number') { interpolation = 0; }
+
+        var keys = param.getKeys();
+        if (!keys) { return ""; }
+        var records = [];
+        for (var i = 0; i < keys.length; i++) {
+            var value = param.getValueAtKey(keys[i]);
+            if (value instanceof Array) {
+                if (value.length !== 2) { return null; }
+                value = value[0] + "," + value[1];
+            } else if (typeof value !== 'number') {
+                return null;
+            }
+            records.push(keys[i].ticks + "," + value + "," + interpolation);
+        }
+        return records.join(";");
+    };
+
+    /**
+     * Evaluates a curve at many times, without a getValueAtTime call for each. (Corresponds to C++ evaluateKeyframes_sa)
+     * @param {string} packedKeys - From packKeyframes
+     * @param {Array|NativeBuffer} ticksArray - Times in ticks (strings or numbers), or an i64 NativeBuffer.
+     * @returns {Array|null} The value at each time: numbers, or [x, y] arrays for Position.
+     */
+    publicApi.evaluateKeyframes = function(packedKeys, ticksArray) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.evaluateKeyframes(packedKeys, _packNumbers(ticksArray));
+        } catch (e) {
+            $.writeln("ThioUtils.evaluateKeyframes: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Resamples a curve to one key per frame of a rate, e.g. before pasting motion into a sequence with another frame rate. (Corresponds to C++ resampleKeyframes_ss)
+     * @param {string} packedKeys - From packKeyframes
+     * @param {string} timebase - Ticks per frame, such as Sequence.timebase. Or a rational fps like "30000/1001".
+     * @returns {Object|null} {ticks, values, interpolation}, or null if the call failed.
+     */
+    publicApi.resampleKeyframes = function(packedKeys, timebase) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.resampleKeyframes(packedKeys, String(timebase));
+        } catch (e) {
+            $.writeln("ThioUtils.resampleKeyframes: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Removes keys that the keys around them already describe, to within a tolerance. Dense tracked motion usually drops to a few percent of its keys. (Corresponds to C++ simplifyKeyframes_sf)
+     * The result is linear between keys, so to keep the shape of sparse bezier keys, resample them first and simplify that.
+     * @param {string} packedKeys - From packKeyframes
+     * @param {number} tolerance - Largest allowed change, in the property's units. Position is in fractions of the frame, so 0.001 is about 2 pixels across 1920.
+     * @returns {Object|null} {ticks, values, interpolation} of the keys to keep, or null if the call failed.
+     */
+    publicApi.simplifyKeyframes = function(packedKeys, tolerance) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.simplifyKeyframes(packedKeys, Number(tolerance));
+        } catch (e) {
+            $.writeln("ThioUtils.simplifyKeyframes: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Replaces a property's keyframes in the time range of a curve with the curve's keys. Works without the library, since it only uses the DOM.
+     * @param {ComponentParam} param
+     * @param {Object} curve - {ticks, values, interpolation}, from resampleKeyframes or simplifyKeyframes
+     * @returns {boolean} false if the curve is empty or a DOM call failed.
+     */
+    publicApi.writeKeyframes = function(param, curve) {
+        if (!curve || curve.ticks.length === 0) { return false; }
+        var last = curve.ticks.length - 1;
+
+        try {
+            if (!param.isTimeVarying()) {
+                param.setTimeVarying(true, false);
+            }
+            param.removeKeyRange(_timeFromTicks(curve.ticks[0]), _timeFromTicks(curve.ticks[last]), false);
+            for (var i = 0; i <= last; i++) {
+                var time = _timeFromTicks(curve.ticks[i]);
+                param.addKey(time);
+                param.setValueAtKey(time, curve.values[i], false);
+                param.setInterpolationTypeAtKey(time, curve.interpolation[i], i === last); // Only update the UI once, at the end
+            }
+            return true;
+        } catch (e) {
+            $.writeln("ThioUtils.writeKeyframes: Exception during call - " + e);
+            return false;
+        }
+    };
+
+    // --- Project File ---
+
+    /**
+     * Reads a saved project file's bins, sequences, track items, markers and keyframes in one pass, without the DOM. (Corresponds to C++ readProjectFile_ss)
+     * Much faster than walking a large project through the DOM, but only sees what was last saved. See ProjectFile.h for the tables.
+     * Each table is an object of parallel arrays, e.g. result.trackItems.start[i]. Ticks are strings, as in Time.ticks.
+     * @param {string=} path - The .prproj file. Defaults to app.project.path
+     * @param {string=} tables - Comma separated table names: "bins", "sequences", "trackItems", "markers", "keyframes". Defaults to all.
+     * @param {boolean=} useCache - Keep the result in the result cache, so the same saved version is only read once. Default true.
+     * @returns {Object|null} The tables and a stats object, or null if the file couldn't be read.
+     */
+    publicApi.readProjectFile = function(path, tables, useCache) {
+        if (!publicApi.isLoaded()) { return null; }
+        if (typeof path === 'undefined' || path === null) { path = app.project.path; }
+        tables = (typeof tables === 'undefined' || tables === null) ? "" : String(tables);
+        var kind = "projectFile:" + tables;
+
+        if (useCache !== false) {
+            var cached = publicApi.getCachedResult(path, kind);
+            if (cached !== null) {
+                try {
+                    return eval(cached);
+                } catch (e) {
+                    // Fall through and read the file again
+                }
+            }
+        }
+
+        try {
+            var result = thioUtilsDll.readProjectFile(String(path), tables);
+            if (useCache !== false) {
+                publicApi.putCachedResult(path, kind, result.toSource());
+            }
+            return result;
+        } catch (e) {
+            $.writeln("ThioUtils.readProjectFile: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Reads a project file on a worker thread. The result is the same as readProjectFile's, and pollJob's done / total count bytes of the file.
+     * @param {string=} path - Defaults to app.project.path
+     * @param {string=} tables - As for readProjectFile
+     * @returns {number|null} The job id, or null if it couldn't be started.
+     */
+    publicApi.startReadProjectFileJob = function(path, tables) {
+        if (typeof path === 'undefined' || path === null) { path = app.project.path; }
+        var payload = String(path);
+        if (tables) { payload += "\t" + tables; }
+        return publicApi.startJob("readProject", payload);
+    };
+
+    // --- Project Metadata ---
+
+    /**
+     * Reads the resolution, frame rate, duration, media path and media type of many project items in one call. (Corresponds to C++ extractMetadata_sss)
+     * The library remembers each item's columns by nodeId together with a hash of its metadata, so asking about the same
+     * items again doesn't parse anything. See ProjectMetadata.h for the columns.
+     * @param {ProjectItem[]} items
+     * @param {string=} fields - Comma separated: "videoInfo" (width, height, pixelAspect), "frameRate", "duration", "mediaPath", "mediaType". Defaults to all.
+     * @param {boolean=} reuseKnown - Skip getProjectMetadata for items the library already knows. Faster, but won't notice
+     *        relinked media, so call clearMetadataMemo after relinking. Default false.
+     * @returns {Object|null} Parallel arrays in item order, e.g. result.width[i], with null for columns an item doesn't have.
+     */
+    publicApi.extractMetadata = function(items, fields, reuseKnown) {
+        if (!publicApi.isLoaded()) { return null; }
+        fields = (typeof fields === 'undefined' || fields === null) ? "" : String(fields);
+
+        var nodeIds = [];
+        var metadata = [];
+        for (var i = 0; i < items.length; i++) {
+            nodeIds.push(items[i].nodeId);
+            metadata.push("");
+        }
+
+        try {
+            var result = null;
+            if (reuseKnown === true) {
+                result = thioUtilsDll.extractMetadata(_encodeTextList(nodeIds), metadata.join("\u0001"), fields);
+                if (result.stats.missing === 0) { return result; }
+            }
+            for (var j = 0; j < items.length; j++) {
+                if (result === null || !result.found[j]) {
+                    metadata[j] = items[j].getProjectMetadata() || "";
+                }
+            }
+            return thioUtilsDll.extractMetadata(_encodeTextList(nodeIds), metadata.join("\u0001"), fields);
+        } catch (e) {
+            $.writeln("ThioUtils.extractMetadata: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Makes extractMetadata forget every item, e.g. after relinking media. (Corresponds to C++ clearMetadataMemo)
+     */
+    publicApi.clearMetadataMemo = function() {
+        if (!publicApi.isLoaded()) { return; }
+
+        try {
+            thioUtilsDll.clearMetadataMemo();
+        } catch (e) {
+            $.writeln("ThioUtils.clearMetadataMemo: Exception during call - " + e);
+        }
+    };
+
+    // --- Session Store ---
+    // Values kept in the library between script runs, for as long as the app has it loaded. Nothing is saved to disk,
+    // so pick keys (e.g. including a sequence's ID) or expiry times that make stale values go away. See SessionStore.h.
+
+    /**
+     * Stores a value under a key, replacing what was there. (Corresponds to C++ sessionSet_saf)
+     * @param {string} key
+     * @param {string|number|boolean|NativeBuffer} value - A NativeBuffer is copied, so later changes to it aren't stored.
+     * @param {number=} ttlSeconds - Seconds until the key expires. 0 or omitted keeps it until it's evicted or deleted.
+     * @returns {boolean|null} false if the value is over the store's memory limit on its own, null on error.
+     */
+    publicApi.sessionSet = function(key, value, ttlSeconds) {
+        if (!publicApi.isLoaded()) { return null; }
+        ttlSeconds = (typeof ttlSeconds === 'number' && isFinite(ttlSeconds)) ? ttlSeconds : 0;
+
+        try {
+            return thioUtilsDll.sessionSet(String(key), value, ttlSeconds);
+        } catch (e) {
+            $.writeln("ThioUtils.sessionSet: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Gets a stored value with the type it was stored with. A stored NativeBuffer comes back as an array of numbers;
+     * use sessionGetBuffer to get it into a buffer instead. (Corresponds to C++ sessionGet_s)
+     * @param {string} key
+     * @returns {string|number|boolean|number[]|null} null if the key is missing or expired.
+     */
+    publicApi.sessionGet = function(key) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            var value = thioUtilsDll.sessionGet(String(key));
+            return (typeof value === 'undefined') ? null : value;
+        } catch (e) {
+            $.writeln("ThioUtils.sessionGet: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Copies a stored NativeBuffer into another one, replacing its type and contents. (Corresponds to C++ sessionGetBuffer_sa)
+     * @param {string} key
+     * @param {NativeBuffer} buffer - From createNativeBuffer.
+     * @returns {boolean|null} false if the key is missing or expired, null on error or if the key holds another type of value.
+     */
+    publicApi.sessionGetBuffer = function(key, buffer) {
+        if (!publicApi.isLoaded() || !_isNativeBuffer(buffer)) { return null; }
+
+        try {
+            return thioUtilsDll.sessionGetBuffer(String(key), buffer);
+        } catch (e) {
+            $.writeln("ThioUtils.sessionGetBuffer: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Gets a stored value, or computes and stores it when it's missing.
+     * @param {string} key
+     * @param {function(): (string|number|boolean)} compute - Called only on a miss.
+     * @param {number=} ttlSeconds - See sessionSet.
+     * @returns {*} The stored or computed value. Without the library, compute is called every time.
+     */
+    publicApi.sessionMemo = function(key, compute, ttlSeconds) {
+        var value = publicApi.sessionGet(key);
+        if (value !== null) { return value; }
+        value = compute();
+        if (value !== null && typeof value !== 'undefined') {
+            publicApi.sessionSet(key, value, ttlSeconds);
+        }
+        return value;
+    };
+
+    /**
+     * Deletes one key. (Corresponds to C++ sessionDelete_s)
+     * @returns {boolean|null} false if it wasn't there.
+     */
+    publicApi.sessionDelete = function(key) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.sessionDelete(String(key));
+        } catch (e) {
+            $.writeln("ThioUtils.sessionDelete: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Deletes every key starting with a prefix. (Corresponds to C++ sessionClear_s)
+     * @param {string=} prefix - Omit to delete everything.
+     * @returns {number|null} How many keys were deleted.
+     */
+    publicApi.sessionClear = function(prefix) {
+        if (!publicApi.isLoaded()) { return null; }
+        prefix = (typeof prefix === 'undefined' || prefix === null) ? "" : String(prefix);
+
+        try {
+            return thioUtilsDll.sessionClear(prefix);
+        } catch (e) {
+            $.writeln("ThioUtils.sessionClear: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Changes the store's memory limit (64 MB by default), evicting the least recently used keys if it's now over it. (Corresponds to C++ sessionSetLimit_f)
+     * @param {number} bytes
+     * @returns {number|null} The previous limit.
+     */
+    publicApi.sessionSetLimit = function(bytes) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.sessionSetLimit(Number(bytes));
+        } catch (e) {
+            $.writeln("ThioUtils.sessionSetLimit: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Describes the store after dropping expired keys. (Corresponds to C++ sessionInfo)
+     * @returns {Object|null} { entries, bytes, limit, hits, misses, expired, evicted }
+     */
+    publicApi.getSessionInfo = function() {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.sessionInfo();
+        } catch (e) {
+            $.writeln("ThioUtils.getSessionInfo: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- Include Bundle ---
+    // ThioUtils.jsx gets its includes from the library in one call (getIncludeBundle) once this wrapper has been loaded
+    // in the app session. See getThioIncludeBundle there, and ScriptBundle.h.
+
+    /**
+     * Makes the library search for and read the include files again on the next script run, e.g. after copying a
+     * ThioUtilsLib.jsx into a folder that's searched before the one it was found in. Edited files are noticed without
+     * this. (Corresponds to C++ clearIncludeCache)
+     * @returns {number|null} How many files were kept.
+     */
+    publicApi.clearIncludeCache = function() {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.clearIncludeCache();
+        } catch (e) {
+            $.writeln("ThioUtils.clearIncludeCache: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    // --- File System ---
+    // Questions about many paths answered in one call, instead of a File object and a file system request per path.
+    // Paths can be strings or File/Folder objects. Modification times are milliseconds since 1970, for new Date(...).
+
+    /**
+     * Checks many paths at once. (Corresponds to C++ statPaths_s)
+     * @param {Array} paths - Paths of files or folders.
+     * @returns {Object|null} Parallel arrays in the order of paths: {exists, isFolder, size, modified}, with size and
+     *     modified null for paths that don't exist. Null if the call failed.
+     */
+    publicApi.statPaths = function(paths) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        if (!(paths instanceof Array)) {
+            alert("ThioUtils.statPaths: The paths must be an array.");
+            return null;
+        }
+        if (paths.length === 0) { return { exists: [], isFolder: [], size: [], modified: [] }; }
+
+        var pathStrings = [];
+        for (var i = 0; i < paths.length; i++) {
+            pathStrings.push((paths[i] instanceof File || paths[i] instanceof Folder) ? paths[i].fsName : String(paths[i]));
+        }
+
+        try {
+            return thioUtilsDll.statPaths(_encodeTextList(pathStrings));
+        } catch (e) {
+            $.writeln("ThioUtils.statPaths: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Lists a folder with each entry's size and modification time, in one call. Unlike Folder.getFiles() no File
+     * objects are made, and nothing else has to be asked per entry. (Corresponds to C++ listFolder_s)
+     * @param {string|Folder} folder - The folder to list.
+     * @returns {Object|null} Parallel arrays {names, isFolder, size, modified}, without "." and "..", in the order the
+     *     file system gives them. Null if the folder doesn't exist or can't be read.
+     */
+    publicApi.listFolder = function(folder) {
+        if (!publicApi.isLoaded()) { return null; }
+
+        try {
+            return thioUtilsDll.listFolder((folder instanceof Folder) ? folder.fsName : String(folder));
+        } catch (e) {
+            $.writeln("ThioUtils.listFolder: Exception during call - " + e);
+            return null;
+        }
+    };
+
+    /**
+     * Gets the first free name in a folder: fileName itself, or with a number before the extension ("clip (2).mp4",
+     * "clip (3).mp4", ...), from one scan of the folder. Names are compared ignoring case.
+     * With create, the file is also created (empty) in the same call, so two scripts or apps asking at once never get
+     * the same name. Write to the returned path afterwards. (Corresponds to C++ reserveFileName_sssb)
+     * @param {string|Folder} folder - The folder to put the file in.
+     * @param {string} fileName - The name wanted, without a path.
+     * @param {string=} numberFormat - How the number is added, with # for the number. Default " (#)".
+     * @param {boolean=} create - Create the file to reserve the name. Default false.
+     * @returns {string|null} The full path, or null if the folder can't be read, the file can't be created, or the
+     *     name or format are invalid.
+     */
+    publicApi.reserveFileName = function(folder, fileName, numberFormat, create) {
+        if (!publicApi.isLoaded()) { return null; }
+        numberFormat = (typeof numberFormat === 'undefined' || numberFormat === null) ? "" : String(numberFormat);
+
+        try {
+            return thioUtilsDll.reserveFileName((folder instanceof Folder) ? folder.fsName : String(folder), String(fileName), numberFormat, create === true);
+        } catch (e) {
+            $.writeln("ThioUtils.reserveFileName: Exception during call - " + e);
+            return null;
+        }
+    };
+
     publicApi.reloadDll = function() {
         // Reload the DLL if needed, or reinitialize the object
         try {
@@ -239,6 +1902,7 @@ var ThioUtils = (function() {
             }
             thioUtilsDll = new ExternalObject("lib:" + libPath);
             _isLoaded = (thioUtilsDll !== null);
+            _resultCacheOpen = null; // The new instance hasn't opened it
         } catch (e) {
             _isLoaded = false;
             $.writeln("Error reloading ThioUtils library: " + e);